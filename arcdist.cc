@@ -21,18 +21,26 @@
 
 #include "arcdist.h"
 
-#include <cmath>                  // for round
-#include <cstdio>                 // for printf, sscanf
+#include <algorithm>              // for max, min
+#include <cmath>                  // for round, floor, isfinite, sqrt, cos, sin
+#include <cstdio>                 // for printf
 #include <cstdlib>                // for strtod
+#include <numbers>                // for sqrt2
+#include <tuple>                  // for tie
+#include <utility>                // for as_const
+#include <vector>                 // for vector
 
 #include <QByteArray>             // for QByteArray
+#include <QList>                  // for QList
 #include <QString>                // for QString
-#include <QtGlobal>               // for foreach, qPrintable, qint64
+#include <QtGlobal>               // for qPrintable, qint64, qsizetype
 
 #include "defs.h"
 #include "grtcirc.h"              // for RAD, gcdist, linedistprj, radtomi
 #include "src/core/datetime.h"    // for DateTime
 #include "src/core/logging.h"     // for Fatal
+#include "src/core/numeric.h"     // for scan_doubles
+#include "src/core/scheduler.h"   // for parallel_for
 #include "src/core/textstream.h"  // for TextStream
 
 
@@ -44,54 +52,15 @@
 void ArcDistanceFilter::arcdist_arc_disp_wpt_cb(const Waypoint* arcpt2)
 {
   static const Waypoint* arcpt1 = nullptr;
-  PositionDeg prjpos;
-  double frac;
 
   if (arcpt2 && arcpt2->latitude != BADVAL && arcpt2->longitude != BADVAL &&
       (ptsopt || (arcpt1 &&
                   (arcpt1->latitude != BADVAL && arcpt1->longitude != BADVAL)))) {
-    foreach (Waypoint* waypointp, *global_waypoint_list) {
-      extra_data* ed;
-      if (waypointp->extra_data) {
-        ed = (extra_data*) waypointp->extra_data;
-      } else {
-        ed = new extra_data;
-        ed->distance = BADVAL;
-      }
-      if (ed->distance == BADVAL || projectopt || ed->distance >= pos_dist) {
-        double dist;
-        if (ptsopt) {
-          dist = gcdist(arcpt2->position(), waypointp->position());
-          prjpos = arcpt2->position();
-          frac = 1.0;
-        } else {
-          if (waypointp == nullptr) {
-            fatal(FatalMsg() << "Internal error. Attempt to project through a waypoint that doesn't exist");
-          }
-          if (arcpt1 == nullptr) {
-            fatal(FatalMsg() << "Internal error: Attempt to project waypoint without predecessor");
-          }
-
-          std::tie(dist, prjpos, frac) = linedistprj(arcpt1->position(),
-                                                     arcpt2->position(),
-                                                     waypointp->position());
-        }
-
-        /* convert radians to float point statute miles */
-        dist = radtomiles(dist);
-
-        if (ed->distance > dist) {
-          ed->distance = dist;
-          if (projectopt) {
-            ed->prjpos = prjpos;
-            ed->frac = frac;
-            ed->arcpt1 = arcpt1;
-            ed->arcpt2 = arcpt2;
-          }
-        }
-        waypointp->extra_data = ed;
-      }
-    }
+    /* The vertices read from a file are reused, so only their positions are kept. */
+    segments.append({
+      ptsopt ? arcpt2->position() : arcpt1->position(), arcpt2->position(),
+      arcfileopt ? nullptr : arcpt1, arcfileopt ? nullptr : arcpt2
+    });
   }
   arcpt1 = arcpt2;
 }
@@ -102,11 +71,148 @@ void ArcDistanceFilter::arcdist_arc_disp_hdr_cb(const route_head* /*unused*/)
   arcdist_arc_disp_wpt_cb(nullptr);
 }
 
+ArcDistanceFilter::Vector3 ArcDistanceFilter::unit_vector(const PositionRad& pos)
+{
+  return {
+    std::cos(pos.latR) * std::cos(pos.lonR),
+    std::cos(pos.latR) * std::sin(pos.lonR),
+    std::sin(pos.latR)
+  };
+}
+
+ArcDistanceFilter::GridCell ArcDistanceFilter::cell_of(const Vector3& v) const
+{
+  return {
+    static_cast<qint64>(std::floor(v.x / cell_size)),
+    static_cast<qint64>(std::floor(v.y / cell_size)),
+    static_cast<qint64>(std::floor(v.z / cell_size))
+  };
+}
+
+/*
+ * Bucket the segments on a grid over 3D unit vectors.  A segment's arc
+ * stays within its sagitta of the chord, and a point within the distance
+ * of the arc is no farther than that from it in space, so widening the
+ * box around the chord by both covers every point that could be close.
+ * Long segments, and any with non-finite ends, are tested everywhere.
+ */
+void ArcDistanceFilter::build_grid()
+{
+  constexpr double kMinCell = 1.0e-9;  // keeps the cell numbers in range
+  const double radius = std::max(pos_dist / radtomiles(1.0), 0.0);
+
+  // The grid doesn't pay for distances this large, or for a NaN.
+  use_grid = (radius < 0.25) && !segments.isEmpty();
+  if (!use_grid) {
+    return;
+  }
+
+  std::vector<double> margins(segments.size(), -1.0);
+  double chord_sum = 0.0;
+  qsizetype chord_count = 0;
+  for (qsizetype i = 0; i < segments.size(); ++i) {
+    const Segment& seg = segments.at(i);
+    if (!std::isfinite(seg.pos1.latD) || !std::isfinite(seg.pos1.lonD) ||
+        !std::isfinite(seg.pos2.latD) || !std::isfinite(seg.pos2.lonD)) {
+      continue;
+    }
+    const Vector3 a = unit_vector(seg.pos1);
+    const Vector3 b = unit_vector(seg.pos2);
+    const double chord = std::sqrt((a.x - b.x) * (a.x - b.x) +
+                                   (a.y - b.y) * (a.y - b.y) +
+                                   (a.z - b.z) * (a.z - b.z));
+    // Beyond a quarter circle the arc is poorly defined and covers too much anyway.
+    if (chord > std::numbers::sqrt2) {
+      continue;
+    }
+    const double sagitta = 1.0 - std::sqrt(std::max(1.0 - chord * chord / 4.0, 0.0));
+    // Widen the box a little so rounding can't move a close point out.
+    margins[i] = (sagitta + radius) * 1.001 + kMinCell;
+    chord_sum += chord;
+    ++chord_count;
+  }
+
+  cell_size = std::max(2.0 * radius, kMinCell);
+  if (chord_count > 0) {
+    cell_size = std::max(cell_size, chord_sum / chord_count);
+  }
+
+  for (qsizetype i = 0; i < segments.size(); ++i) {
+    if (margins[i] < 0.0) {
+      everywhere.append(i);
+      continue;
+    }
+    const Vector3 a = unit_vector(segments.at(i).pos1);
+    const Vector3 b = unit_vector(segments.at(i).pos2);
+    const GridCell lo = cell_of({
+      std::min(a.x, b.x) - margins[i], std::min(a.y, b.y) - margins[i], std::min(a.z, b.z) - margins[i]
+    });
+    const GridCell hi = cell_of({
+      std::max(a.x, b.x) + margins[i], std::max(a.y, b.y) + margins[i], std::max(a.z, b.z) + margins[i]
+    });
+    const double cells = static_cast<double>(hi.x - lo.x + 1) *
+                         static_cast<double>(hi.y - lo.y + 1) *
+                         static_cast<double>(hi.z - lo.z + 1);
+    if (cells > kMaxSegmentCells) {
+      everywhere.append(i);
+      continue;
+    }
+    for (qint64 x = lo.x; x <= hi.x; ++x) {
+      for (qint64 y = lo.y; y <= hi.y; ++y) {
+        for (qint64 z = lo.z; z <= hi.z; ++z) {
+          grid[GridCell{x, y, z}].append(i);
+        }
+      }
+    }
+  }
+}
+
+/* Measure one waypoint against one segment, as each segment is taken in arc order. */
+void ArcDistanceFilter::measure(const Segment& seg, const Waypoint* wpt, extra_data& ed) const
+{
+  if (ed.distance == BADVAL || projectopt || ed.distance >= pos_dist) {
+    double dist;
+    PositionDeg prjpos;
+    double frac;
+    if (ptsopt) {
+      dist = gcdist(seg.pos2, wpt->position());
+      prjpos = seg.pos2;
+      frac = 1.0;
+    } else {
+      std::tie(dist, prjpos, frac) = linedistprj(seg.pos1, seg.pos2, wpt->position());
+    }
+
+    /* convert radians to float point statute miles */
+    dist = radtomiles(dist);
+
+    if (ed.distance > dist) {
+      ed.distance = dist;
+      if (projectopt) {
+        ed.prjpos = prjpos;
+        ed.frac = frac;
+        ed.segment = &seg;
+      }
+    }
+  }
+}
+
+void ArcDistanceFilter::measure_all(const Waypoint* wpt, extra_data& ed) const
+{
+  ed = {BADVAL, PositionDeg(), 0.0, nullptr};
+  for (const Segment& seg : segments) {
+    measure(seg, wpt, ed);
+  }
+}
+
 void ArcDistanceFilter::process()
 {
   WayptFunctor<ArcDistanceFilter> arcdist_arc_disp_wpt_cb_f(this, &ArcDistanceFilter::arcdist_arc_disp_wpt_cb);
   RteHdFunctor<ArcDistanceFilter> arcdist_arc_disp_hdr_cb_f(this, &ArcDistanceFilter::arcdist_arc_disp_hdr_cb);
 
+  segments.clear();
+  grid.clear();
+  everywhere.clear();
+
   if (arcfileopt) {
     int fileline = 0;
     QString line;
@@ -130,8 +236,10 @@ void ArcDistanceFilter::process()
         line.truncate(pound);
       }
 
-      arcpt2->latitude = arcpt2->longitude = BADVAL;
-      int argsfound = sscanf(CSTR(line), "%lf %lf", &arcpt2->latitude, &arcpt2->longitude);
+      double vertex[2] = {BADVAL, BADVAL};
+      int argsfound = gpsbabel::scan_doubles(line, vertex, 2);
+      arcpt2->latitude = vertex[0];
+      arcpt2->longitude = vertex[1];
 
       if ((argsfound != 2) && (line.trimmed().size() > 0)) {
         warning(MYNAME ": Warning: Arc file contains unusable vertex on line %d.\n", fileline);
@@ -152,49 +260,102 @@ void ArcDistanceFilter::process()
     track_disp_all(arcdist_arc_disp_hdr_cb_f, nullptr, arcdist_arc_disp_wpt_cb_f);
   }
 
-  unsigned removed = 0;
-  foreach (Waypoint* wp, *global_waypoint_list) {
-    if (wp->extra_data) {
-      auto* ed = (extra_data*) wp->extra_data;
-      wp->extra_data = nullptr;
-      if ((ed->distance >= pos_dist) == (exclopt == nullptr)) {
-        wp->wpt_flags.marked_for_deletion = 1;
-        removed++;
-      } else if (projectopt) {
-        wp->SetPosition(ed->prjpos);
-        if (!arcfileopt &&
-            (ed->arcpt2->altitude != unknown_alt) &&
-            (ptsopt || (ed->arcpt1->altitude != unknown_alt))) {
-          /* Interpolate altitude */
-          if (ptsopt) {
-            wp->altitude = ed->arcpt2->altitude;
-          } else {
-            wp->altitude = ed->arcpt1->altitude +
-                           ed->frac * (ed->arcpt2->altitude - ed->arcpt1->altitude);
-          }
+  build_grid();
+
+  QList<Waypoint*> wpts;
+  if (!segments.isEmpty()) {
+    wpts.reserve(global_waypoint_list->count());
+    for (Waypoint* waypointp : std::as_const(*global_waypoint_list)) {
+      wpts.append(waypointp);
+    }
+  }
+  const qsizetype nelems = wpts.size();
+
+  /*
+   * Each waypoint only needs the segments of its cell, in arc order, as
+   * the others can't come within the distance.  A kept waypoint that is
+   * to be projected but is not close needs its truly nearest segment, so
+   * it is measured against all of them.
+   */
+  std::vector<extra_data> eds(nelems);
+  const QList<qsizetype> none;
+  auto classify = [this, &wpts, &eds, &none](qsizetype begin, qsizetype end)->void {
+    for (qsizetype i = begin; i < end; ++i) {
+      const Waypoint* wpt = wpts.at(i);
+      extra_data& ed = eds[i];
+      if (!use_grid || !std::isfinite(wpt->latitude) || !std::isfinite(wpt->longitude)) {
+        measure_all(wpt, ed);
+        continue;
+      }
+      ed = {BADVAL, PositionDeg(), 0.0, nullptr};
+      auto it = grid.constFind(cell_of(unit_vector(wpt->position())));
+      const QList<qsizetype>& local = (it != grid.constEnd()) ? *it : none;
+      qsizetype l = 0;
+      qsizetype e = 0;
+      while ((l < local.size()) || (e < everywhere.size())) {
+        qsizetype next;
+        if ((e == everywhere.size()) ||
+            ((l < local.size()) && (local.at(l) < everywhere.at(e)))) {
+          next = local.at(l++);
+        } else {
+          next = everywhere.at(e++);
         }
-        if (trkopt &&
-            (ed->arcpt2->GetCreationTime().isValid()) &&
-            (ptsopt || (ed->arcpt1->GetCreationTime().isValid()))) {
-          /* Interpolate time */
-          if (ptsopt) {
-            wp->SetCreationTime(ed->arcpt2->GetCreationTime());
-          } else {
-            // Apply the multiplier to the difference between the times
-            // of the two points.  Add that to the first for the
-            // interpolated time.
-            qint64 span =
-              ed->arcpt1->GetCreationTime().msecsTo(ed->arcpt2->GetCreationTime());
-            qint64 offset = std::round(ed->frac * span);
-            wp->SetCreationTime(ed->arcpt1->GetCreationTime().addMSecs(offset));
-          }
+        measure(segments.at(next), wpt, ed);
+      }
+      if (projectopt && exclopt && (ed.distance >= pos_dist)) {
+        measure_all(wpt, ed);
+      }
+    }
+  };
+  const int threads = (opt_threads != nullptr) ? xstrtoi(opt_threads, nullptr, 10) : 1;
+  if ((threads > 1) && (nelems >= kParallelMin)) {
+    gpsbabel::parallel_for(nelems, (nelems + threads - 1) / threads, classify);
+  } else {
+    classify(0, nelems);
+  }
+
+  unsigned removed = 0;
+  for (qsizetype i = 0; i < nelems; ++i) {
+    Waypoint* wp = wpts.at(i);
+    const extra_data* ed = &eds[i];
+    if ((ed->distance >= pos_dist) == (exclopt == nullptr)) {
+      wp->wpt_flags.marked_for_deletion = 1;
+      removed++;
+    } else if (projectopt && ed->segment) {
+      wp->SetPosition(ed->prjpos);
+      const Waypoint* arcpt1 = ed->segment->arcpt1;
+      const Waypoint* arcpt2 = ed->segment->arcpt2;
+      if (!arcfileopt &&
+          (arcpt2->altitude != unknown_alt) &&
+          (ptsopt || (arcpt1->altitude != unknown_alt))) {
+        /* Interpolate altitude */
+        if (ptsopt) {
+          wp->altitude = arcpt2->altitude;
+        } else {
+          wp->altitude = arcpt1->altitude +
+                         ed->frac * (arcpt2->altitude - arcpt1->altitude);
         }
-        if (global_opts.debug_level >= 1) {
-          warning("Including waypoint %s at dist:%f lat:%f lon:%f\n",
-                  qPrintable(wp->shortname), ed->distance, wp->latitude, wp->longitude);
+      }
+      if (trkopt &&
+          (arcpt2->GetCreationTime().isValid()) &&
+          (ptsopt || (arcpt1->GetCreationTime().isValid()))) {
+        /* Interpolate time */
+        if (ptsopt) {
+          wp->SetCreationTime(arcpt2->GetCreationTime());
+        } else {
+          // Apply the multiplier to the difference between the times
+          // of the two points.  Add that to the first for the
+          // interpolated time.
+          qint64 span =
+            arcpt1->GetCreationTime().msecsTo(arcpt2->GetCreationTime());
+          qint64 offset = std::round(ed->frac * span);
+          wp->SetCreationTime(arcpt1->GetCreationTime().addMSecs(offset));
         }
       }
-      delete ed;
+      if (global_opts.debug_level >= 1) {
+        warning("Including waypoint %s at dist:%f lat:%f lon:%f\n",
+                qPrintable(wp->shortname), ed->distance, wp->latitude, wp->longitude);
+      }
     }
   }
   del_marked_wpts();
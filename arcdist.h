@@ -22,9 +22,12 @@
 #ifndef ARCDIST_H_INCLUDED_
 #define ARCDIST_H_INCLUDED_
 
+#include <QHash>           // for QHash, qHashMulti
+#include <QList>           // for QList
 #include <QVector>         // for QVector
+#include <QtGlobal>        // for qint64, qsizetype
 
-#include "defs.h"    // for ARG_NOMINMAX, ARGTYPE_BOOL, Waypoint (ptr only)
+#include "defs.h"    // for ARG_NOMINMAX, ARGTYPE_BOOL, ARGTYPE_INT, PositionDeg, PositionRad, Waypoint (ptr only)
 #include "filter.h"  // for Filter
 
 #if FILTERS_ENABLED
@@ -42,18 +45,57 @@ public:
 private:
   /* Types */
 
+  /* One piece of the arc, or one vertex with the points option. */
+  struct Segment {
+    PositionDeg pos1;
+    PositionDeg pos2;
+    const Waypoint* arcpt1;
+    const Waypoint* arcpt2;
+  };
+
+  /* The closest piece of the arc found so far for a waypoint. */
   struct extra_data {
     double distance;
     PositionDeg prjpos;
     double frac;
-    const Waypoint* arcpt1;
-    const Waypoint* arcpt2;
+    const Segment* segment;
+  };
+
+  struct Vector3 {
+    double x;
+    double y;
+    double z;
   };
 
+  /* A cube of the grid over 3D unit vectors used to bucket segments. */
+  struct GridCell {
+    qint64 x{};
+    qint64 y{};
+    qint64 z{};
+
+    bool operator==(const GridCell& other) const = default;
+    friend size_t qHash(const GridCell& c, size_t seed = 0) noexcept
+    {
+      return qHashMulti(seed, c.x, c.y, c.z);
+    }
+  };
+
+  /* Constants */
+
+  /* Fewer waypoints than this aren't worth starting threads for. */
+  static constexpr qsizetype kParallelMin = 16 * 1024;
+  /* Segments that would cover more cells than this are tested everywhere. */
+  static constexpr qint64 kMaxSegmentCells = 4096;
+
   /* Member Functions */
 
   void arcdist_arc_disp_wpt_cb(const Waypoint* arcpt2);
   void arcdist_arc_disp_hdr_cb(const route_head* /*unused*/);
+  static Vector3 unit_vector(const PositionRad& pos);
+  GridCell cell_of(const Vector3& v) const;
+  void build_grid();
+  void measure(const Segment& seg, const Waypoint* wpt, extra_data& ed) const;
+  void measure_all(const Waypoint* wpt, extra_data& ed) const;
 
   /* Data Members */
 
@@ -65,6 +107,13 @@ private:
   char* exclopt = nullptr;
   char* ptsopt = nullptr;
   char* projectopt = nullptr;
+  char* opt_threads = nullptr;
+
+  QList<Segment> segments;
+  bool use_grid{false};
+  double cell_size{};
+  QHash<GridCell, QList<qsizetype>> grid;
+  QList<qsizetype> everywhere;	/* segments not in the grid, tested for every waypoint */
 
   QVector<arglist_t> args = {
     {
@@ -95,6 +144,10 @@ private:
       "project", &projectopt, "Move waypoints to its projection on lines or vertices",
       nullptr, ARGTYPE_BOOL, ARG_NOMINMAX, nullptr
     },
+    {
+      "threads", &opt_threads, "Test large waypoint lists on this many threads",
+      nullptr, ARGTYPE_INT, "1", nullptr, nullptr
+    },
   };
 
 };
@@ -25,12 +25,12 @@
 #include <utility>          // for as_const
 
 #include <QString>          // for QString
-#include <QtGlobal>         // for QForeachContainer, qMakeForeachContainer, foreach
+#include <QVector>          // for QVector
 
 #include "defs.h"
 #include "bend.h"
-#include "formspec.h"       // for FormatSpecificDataList
 #include "grtcirc.h"        // for RAD, heading_true_degrees, gcdist, linepart, radtometers, DEG
+#include "session.h"        // for curr_session
 
 
 #define MYNAME "bend"
@@ -48,9 +48,6 @@ void BendFilter::init()
   if (minangleopt) {
     minAngle = strtod(minangleopt, nullptr);
   }
-
-  route_backup(&routes_orig);
-  route_flush_all_routes();
 }
 
 Waypoint* BendFilter::create_wpt_dest(const Waypoint* wpt_orig, const Waypoint* wpt_orig_adj) const
@@ -85,32 +82,38 @@ int BendFilter::is_small_angle(const Waypoint* wpt_orig,
           || (std::abs(heading_diff - 360.0) < minAngle));
 }
 
-void BendFilter::process_route(const route_head* route_orig, route_head* route_dest)
+/*
+ * The points to keep are moved rather than copied, so only the points
+ * that are added at bends are new.  An original point that gives way to
+ * the points around its bend may still be needed for the next bend, so
+ * it is deleted once the whole route is done.
+ */
+void BendFilter::bend_route(Job& job) const
 {
+  job.output.reserve(job.input.size());
   const Waypoint* wpt_orig_prev = nullptr;
-  const Waypoint* wpt_orig = nullptr;
+  Waypoint* wpt_orig = nullptr;
 
-  foreach (const Waypoint* wpt_orig_next, route_orig->waypoint_list) {
+  for (Waypoint* wpt_orig_next : std::as_const(job.input)) {
 
     if (wpt_orig_prev == nullptr) {
       if (wpt_orig != nullptr) {
-        auto* waypoint_dest = new Waypoint(*wpt_orig);
-        route_add_wpt(route_dest, waypoint_dest);
+        job.output.append(wpt_orig);
       }
     } else {
 
       if (is_small_angle(wpt_orig, wpt_orig_prev, wpt_orig_next)) {
-        auto* waypoint_dest = new Waypoint(*wpt_orig);
-        route_add_wpt(route_dest, waypoint_dest);
+        job.output.append(wpt_orig);
       } else {
+        job.dropped.append(wpt_orig);
         Waypoint* wpt_dest_prev = create_wpt_dest(wpt_orig, wpt_orig_prev);
         if (wpt_dest_prev != nullptr) {
-          route_add_wpt(route_dest, wpt_dest_prev);
+          job.output.append(wpt_dest_prev);
         }
 
         Waypoint* wpt_dest_next = create_wpt_dest(wpt_orig, wpt_orig_next);
         if (wpt_dest_next != nullptr) {
-          route_add_wpt(route_dest, wpt_dest_next);
+          job.output.append(wpt_dest_next);
 
           wpt_orig = wpt_dest_next;
         }
@@ -122,36 +125,61 @@ void BendFilter::process_route(const route_head* route_orig, route_head* route_d
   }
 
   if (wpt_orig != nullptr) {
-    auto* waypoint_dest = new Waypoint(*wpt_orig);
-    route_add_wpt(route_dest, waypoint_dest);
+    job.output.append(wpt_orig);
   }
 }
 
-void BendFilter::process_route_orig(const route_head* route_orig)
+int BendFilter::route_threads() const
 {
-  auto* route_dest = new route_head;
-  route_dest->rte_name = route_orig->rte_name;
-  route_dest->rte_desc = route_orig->rte_desc;
-  route_dest->fs = route_orig->fs.FsChainCopy();
-  route_dest->rte_num = route_orig->rte_num;
+  return (opt_threads != nullptr) ? xstrtoi(opt_threads, nullptr, 10) : 1;
+}
 
-  route_add_head(route_dest);
+bool BendFilter::prepare_route(route_head* rte, bool is_track)
+{
+  if (is_track) {
+    return false;
+  }
 
-  process_route(route_orig, route_dest);
+  // The routes used to be rebuilt from copies that kept only their
+  // names, number and format specific data.
+  rte->rte_urls = UrlList();
+  rte->line_color = gb_color();
+  rte->line_width = -1;
+  rte->session = curr_session();
+
+  WaypointList wptlist;
+  route_swap_wpts(rte, wptlist);
+  Job& job = jobs[rte];
+  job.input = QVector<Waypoint*>(wptlist.cbegin(), wptlist.cend());
+  return true;
 }
 
-void BendFilter::process()
+void BendFilter::process_route(route_head* rte, bool /* is_track */)
 {
-  for (const auto* route_orig : std::as_const(*routes_orig)) {
-    process_route_orig(route_orig);
+  bend_route(jobs.find(rte)->second);
+}
+
+void BendFilter::finish_route(route_head* rte, bool is_track)
+{
+  if (is_track) {
+    return;
   }
+  auto it = jobs.find(rte);
+  Job& job = it->second;
+  rte->waypoint_list.reserve(job.output.size());
+  for (Waypoint* wpt : std::as_const(job.output)) {
+    route_add_wpt(rte, wpt);
+  }
+  for (Waypoint* wpt : std::as_const(job.dropped)) {
+    delete wpt;
+  }
+  jobs.erase(it);
 }
 
-void BendFilter::deinit()
+/* Each route is bent on its own. */
+void BendFilter::process()
 {
-  routes_orig->flush();
-  delete routes_orig;
-  routes_orig = nullptr;
+  process_routes();
 }
 
 #endif // FILTERS_ENABLED
@@ -23,6 +23,8 @@
 #ifndef BEND_H_INCLUDED_
 #define BEND_H_INCLUDED_
 
+#include <unordered_map>   // for unordered_map
+
 #include <QVector>         // for QVector
 
 #include "defs.h"    // for route_head (ptr only), ARGTYPE_FLOAT, ARG_NOMINMAX
@@ -39,16 +41,28 @@ public:
   }
   void init() override;
   void process() override;
-  void deinit() override;
+  int route_threads() const override;
+  bool prepare_route(route_head* rte, bool is_track) override;
+  void process_route(route_head* rte, bool is_track) override;
+  void finish_route(route_head* rte, bool is_track) override;
 
 private:
+  /* The points of a route on their way through the filter. */
+  struct Job {
+    QVector<Waypoint*> input;
+    QVector<Waypoint*> output;
+    QVector<Waypoint*> dropped;
+  };
+
   char* distopt = nullptr;
   char* minangleopt = nullptr;
+  char* opt_threads = nullptr;
 
   double maxDist{};
   double minAngle{};
 
-  RouteList* routes_orig = nullptr;
+  // Filled in before the routes are bent, so the workers only look up.
+  std::unordered_map<const route_head*, Job> jobs;
 
   QVector<arglist_t> args = {
     {
@@ -59,14 +73,17 @@ private:
       "minangle", &minangleopt, "Minimum bend angle in degrees", "5",
       ARGTYPE_FLOAT, ARG_NOMINMAX, nullptr
     },
+    {
+      "threads", &opt_threads, "Bend routes on this many threads",
+      nullptr, ARGTYPE_INT, "1", nullptr, nullptr
+    },
   };
 
   Waypoint* create_wpt_dest(const Waypoint* wpt_orig, const Waypoint* wpt_adj) const;
   int is_small_angle(const Waypoint* wpt_orig,
                      const Waypoint* wpt_orig_prev,
                      const Waypoint* wpt_orig_next) const;
-  void process_route(const route_head* route_orig, route_head* route_dest);
-  void process_route_orig(const route_head* route_orig);
+  void bend_route(Job& job) const;
 
 };
 
@@ -0,0 +1,34 @@
+# Optional compression libraries used by gbfile in addition to zlib.
+set(GPSBABEL_WITH_ZSTD "no" CACHE STRING "no*|pkgconfig|custom.")
+if(GPSBABEL_WITH_ZSTD STREQUAL "no")
+  message(STATUS "zstd disabled")
+elseif(GPSBABEL_WITH_ZSTD STREQUAL "pkgconfig")
+  message(STATUS "Using zstd found by pkg-config")
+  find_package(PkgConfig REQUIRED)
+  pkg_search_module(ZSTD REQUIRED libzstd>=1.4.0 IMPORTED_TARGET)
+  list(APPEND LIBS PkgConfig::ZSTD)
+  target_compile_definitions(gpsbabel PRIVATE HAVE_LIBZSTD)
+elseif(GPSBABEL_WITH_ZSTD STREQUAL "custom")
+  message(STATUS "zstd is enabled but but must be manually configured.")
+  message(STATUS "  e.g. GPSBABEL_WITH_ZSTD=custom GPSBABEL_EXTRA_LINK_LIBRARIES:STRING==... GPSBABEL_EXTRA_INCLUDE_DIRECTORIES:STRING=...")
+  target_compile_definitions(gpsbabel PRIVATE HAVE_LIBZSTD)
+else()
+  message(FATAL_ERROR "GPSBABEL_WITH_ZSTD=no*|pkgconfig|custom")
+endif()
+
+set(GPSBABEL_WITH_LZMA "no" CACHE STRING "no*|pkgconfig|custom.")
+if(GPSBABEL_WITH_LZMA STREQUAL "no")
+  message(STATUS "liblzma disabled")
+elseif(GPSBABEL_WITH_LZMA STREQUAL "pkgconfig")
+  message(STATUS "Using liblzma found by pkg-config")
+  find_package(PkgConfig REQUIRED)
+  pkg_search_module(LZMA REQUIRED liblzma IMPORTED_TARGET)
+  list(APPEND LIBS PkgConfig::LZMA)
+  target_compile_definitions(gpsbabel PRIVATE HAVE_LIBLZMA)
+elseif(GPSBABEL_WITH_LZMA STREQUAL "custom")
+  message(STATUS "liblzma is enabled but but must be manually configured.")
+  message(STATUS "  e.g. GPSBABEL_WITH_LZMA=custom GPSBABEL_EXTRA_LINK_LIBRARIES:STRING==... GPSBABEL_EXTRA_INCLUDE_DIRECTORIES:STRING=...")
+  target_compile_definitions(gpsbabel PRIVATE HAVE_LIBLZMA)
+else()
+  message(FATAL_ERROR "GPSBABEL_WITH_LZMA=no*|pkgconfig|custom")
+endif()
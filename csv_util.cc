@@ -20,18 +20,23 @@
 
  */
 
+#include <algorithm>           // for min
 #include <cmath>               // for fabs
 #include <cstdlib>             // for strtod
 #include <cstring>             // for strlen, strchr, strncmp, strcmp, memmove, strcpy, strcspn, strncpy
+#include <utility>             // for as_const
 
 #include <QByteArray>          // for QByteArray
 #include <QChar>               // for QChar
 #include <QDebug>              // for QDebug
 #include <QList>               // for QList
 #include <QString>             // for QString, operator+
+#include <QStringList>         // for QStringList
+#include <QStringView>         // for QStringView
 
 #include "defs.h"
 #include "csv_util.h"
+#include "src/core/charscan.h" // for find_first_of
 #include "src/core/logging.h"  // for Warning
 
 
@@ -56,12 +61,9 @@ csv_stringclean(const QString& source, const QString& to_nuke)
   return r;
 }
 
-// csv_stringtrim() - trim whitespace and leading and trailing
-//                    enclosures (quotes)
-//                    returns a copy of the modified string
-//    usage: p = csv_stringtrim(string, "\"", 0)
-QString
-csv_stringtrim(const QString& string, const QString& enclosure, int strip_max)
+// csv_stringtrim_view() - csv_stringtrim() without the copy
+static QStringView
+csv_stringtrim_view(QStringView string, const QString& enclosure, int strip_max)
 {
   if (string.isEmpty()) {
     return string;
@@ -70,7 +72,7 @@ csv_stringtrim(const QString& string, const QString& enclosure, int strip_max)
   int elen = enclosure.size();
 
   /* trim off leading and trailing whitespace */
-  QString retval = string.trimmed();
+  QStringView retval = string.trimmed();
 
   /* if no maximum strippage, assign a reasonable value to max */
   if (strip_max == 0) {
@@ -85,7 +87,7 @@ csv_stringtrim(const QString& string, const QString& enclosure, int strip_max)
       (retval.size() >= (elen * 2)) &&
       (retval.startsWith(enclosure)) &&
       (retval.endsWith(enclosure))) {
-      retval = retval.mid(elen, retval.size() - (elen * 2));
+      retval = retval.sliced(elen, retval.size() - (elen * 2));
       stripped++;
     }
   }
@@ -93,6 +95,16 @@ csv_stringtrim(const QString& string, const QString& enclosure, int strip_max)
   return retval;
 }
 
+// csv_stringtrim() - trim whitespace and leading and trailing
+//                    enclosures (quotes)
+//                    returns a copy of the modified string
+//    usage: p = csv_stringtrim(string, "\"", 0)
+QString
+csv_stringtrim(QStringView string, const QString& enclosure, int strip_max)
+{
+  return csv_stringtrim_view(string, enclosure, strip_max).toString();
+}
+
 // RFC4180 method, but we don't handle line breaks within a field.
 // for enclosure = "
 // make str = blank into nothing
@@ -141,6 +153,43 @@ csv_dequote(const QString& string, const QString& enclosure)
   return retval;
 }
 
+// csv_dequote_view() - csv_dequote() that only copies, to the end of
+//                      scratch, if there are escaped enclosures to undo.
+static QStringView
+csv_dequote_view(QStringView string, const QString& enclosure, QString& scratch)
+{
+  int elen = enclosure.size();
+
+  /* trim off leading and trailing whitespace */
+  QStringView retval = string.trimmed();
+
+  if ((elen > 0) && retval.startsWith(enclosure) && retval.endsWith(enclosure)) {
+    /* strip the enclosures */
+    if (retval.size() < (elen * 2)) {
+      retval = retval.sliced(std::min<qsizetype>(elen, retval.size()));
+    } else {
+      retval = retval.sliced(elen, retval.size() - (elen * 2));
+    }
+    /* replace any contained escaped enclosures */
+    const QString escaped = enclosure + enclosure;
+    if (retval.contains(escaped)) {
+      const qsizetype start = scratch.size();
+      for (qsizetype i = 0; i < retval.size();) {
+        if (retval.sliced(i).startsWith(escaped)) {
+          scratch.append(enclosure);
+          i += escaped.size();
+        } else {
+          scratch.append(retval.at(i));
+          ++i;
+        }
+      }
+      retval = QStringView(scratch).sliced(start);
+    }
+  }
+
+  return retval;
+}
+
 /*****************************************************************************/
 /* csv_linesplit() - extract data fields from a delimited string. designed   */
 /*                   to handle quoted and delimited data within quotes.      */
@@ -151,7 +200,35 @@ csv_linesplit(const QString& string, const QString& delimited_by,
               const QString& enclosed_in, const int line_no, CsvQuoteMethod method,
               bool* delimiter_detected)
 {
+  QList<QStringView> fields;
+  QString scratch;
+  csv_linesplit(string, delimited_by, enclosed_in, line_no, fields, scratch, method,
+                delimiter_detected);
+
   QStringList retval;
+  retval.reserve(fields.size());
+  for (const auto field : std::as_const(fields)) {
+    retval.append(field.toString());
+  }
+  return retval;
+}
+
+/*****************************************************************************/
+/* csv_linesplit() - split as above into views of string and of scratch,     */
+/*                   which are valid until either changes.  Reusing fields   */
+/*                   and scratch from line to line allocates nothing.        */
+/*****************************************************************************/
+void
+csv_linesplit(QStringView string, const QString& delimited_by,
+              const QString& enclosed_in, const int line_no,
+              QList<QStringView>& fields, QString& scratch, CsvQuoteMethod method,
+              bool* delimiter_detected)
+{
+  fields.clear();
+  /* Dequoted fields are never longer than the line, so with this much room
+   * scratch doesn't move while views into it are handed out. */
+  scratch.resize(0);
+  scratch.reserve(string.size());
 
   const bool hyper_whitespace_delimiter = delimited_by == "\\w";
 
@@ -175,6 +252,12 @@ csv_linesplit(const QString& string, const QString& delimited_by,
   }
   int elen = enclosed_in.size();
 
+  /* Nothing but a character that starts a delimiter or an enclosure can
+   * end a run of field text, so such runs are skipped a block at a time. */
+  const bool scan = (!hyper_whitespace_delimiter) && ((dlen > 0) || (elen > 0));
+  const char16_t echar = (elen > 0) ? enclosed_in.at(0).unicode() : u'\0';
+  const char16_t dchar = (dlen > 0) ? delimiter.at(0).unicode() : echar;
+
   int p = 0;
   bool endofline = false;
   while (!endofline) {
@@ -186,7 +269,13 @@ csv_linesplit(const QString& string, const QString& delimited_by,
     const int sp = p;
 
     while (p < string.size() && !dfound) {
-      if ((elen > 0) && string.mid(p).startsWith(enclosed_in)) {
+      if (scan) {
+        p = static_cast<int>(gpsbabel::find_first_of(string, p, dchar, echar));
+        if (p >= string.size()) {
+          break;
+        }
+      }
+      if ((elen > 0) && string.sliced(p).startsWith(enclosed_in)) {
         efound = true;
         p += elen;
         enclosed = !enclosed;
@@ -194,7 +283,7 @@ csv_linesplit(const QString& string, const QString& delimited_by,
       }
 
       if (!enclosed) {
-        if ((dlen > 0) && string.mid(p).startsWith(delimiter)) {
+        if ((dlen > 0) && string.sliced(p).startsWith(delimiter)) {
           dfound = true;
           delimiter_seen = true;
         } else if (hyper_whitespace_delimiter && string.at(p).isSpace()) {
@@ -211,13 +300,13 @@ csv_linesplit(const QString& string, const QString& delimited_by,
       }
     }
 
-    QString value = string.mid(sp, p - sp);
+    QStringView value = string.sliced(sp, p - sp);
 
     if (efound) {
       if (method == CsvQuoteMethod::rfc4180) {
-        value = csv_dequote(value, enclosed_in);
+        value = csv_dequote_view(value, enclosed_in, scratch);
       } else {
-        value = csv_stringtrim(value, enclosed_in, 0);
+        value = csv_stringtrim_view(value, enclosed_in, 0);
       }
     }
 
@@ -236,13 +325,12 @@ csv_linesplit(const QString& string, const QString& delimited_by,
               line_no;
     }
 
-    retval.append(value);
+    fields.append(value);
 
   }
   if (delimiter_detected != nullptr) {
     *delimiter_detected = delimiter_seen;
   }
-  return retval;
 }
 /*****************************************************************************/
 /* dec_to_intdeg() - convert decimal degrees to integer degreees             */
@@ -21,8 +21,10 @@
 #ifndef CSV_UTIL_H_INCLUDED_
 #define CSV_UTIL_H_INCLUDED_
 
+#include <QList>        // for QList
 #include <QString>      // for QString
 #include <QStringList>  // for QStringList
+#include <QStringView>  // for QStringView
 
 #include "defs.h"
 
@@ -33,7 +35,7 @@ QString
 csv_stringclean(const QString& source, const QString& to_nuke);
 
 QString
-csv_stringtrim(const QString& string, const QString& enclosure, int strip_max);
+csv_stringtrim(QStringView string, const QString& enclosure, int strip_max);
 QString
 csv_enquote(const QString& str, const QString& enclosure);
 QString
@@ -45,6 +47,12 @@ QStringList
 csv_linesplit(const QString& string, const QString& delimited_by,
               const QString& enclosed_in, int line_no, CsvQuoteMethod method = CsvQuoteMethod::historic,
               bool* delimiter_detected = nullptr);
+void
+csv_linesplit(QStringView string, const QString& delimited_by,
+              const QString& enclosed_in, int line_no,
+              QList<QStringView>& fields, QString& scratch,
+              CsvQuoteMethod method = CsvQuoteMethod::historic,
+              bool* delimiter_detected = nullptr);
 
 int
 dec_to_intdeg(double d);
@@ -19,11 +19,14 @@
 #ifndef DEFS_H_INCLUDED_
 #define DEFS_H_INCLUDED_
 
+#include <chrono>                    // for steady_clock
 #include <cmath>                     // for nan
 #include <cstddef>                   // for NULL, nullptr_t, size_t
 #include <cstdint>                   // for int32_t, uint32_t
 #include <cstdio>                    // for NULL, fprintf, FILE, stdout
 #include <ctime>                     // for time_t
+#include <iterator>                  // for forward_iterator_tag
+#include <memory>                    // for unique_ptr
 #include <numbers>                   // for inv_pi, pi
 #include <optional>                  // for optional
 #include <utility>                   // for move
@@ -33,10 +36,13 @@
 #include <QTime>                     // for QTime
 #include <QDateTime>                 // for QDateTime
 #include <QDebug>                    // for QDebug
+#include <QHash>                     // for QHash
+#include <QSharedData>               // for QSharedData, QSharedDataPointer
 #include <QList>                     // for QList, QList<>::const_iterator, QList<>::const_reverse_iterator, QList<>::count, QList<>::reverse_iterator
 #include <QString>                   // for QString
 #include <QStringView>               // for QStringView
 #include <QTextCodec>                // for QTextCodec
+#include <QVector>                   // for QVector
 #include <Qt>                        // for CaseInsensitive
 #include <QtGlobal>                  // for QForeachContainer, qMakeForeachContainer, foreach, qint64
 
@@ -44,8 +50,17 @@
 #include "formspec.h"                // for FormatSpecificData
 #include "inifile.h"                 // for inifile_t
 #include "session.h"                 // for session_t
+#include "src/core/budget.h"        // for Budget
 #include "src/core/datetime.h"       // for DateTime
+#include "src/core/nvector.h"        // for NVector
+#include "src/core/timeindex.h"      // for TimeIndex
+#include "src/core/utf8string.h"     // for Utf8String
 
+namespace gpsbabel
+{
+class ObjectPool;
+class PackedTrack;
+} // namespace gpsbabel
 
 #define CSTR(qstr) ((qstr).toUtf8().constData())
 #define CSTRc(qstr) ((qstr).toLatin1().constData())
@@ -153,6 +168,18 @@ enum gpsdata_type {
 #define	doing_rtes ((global_opts.masked_objective & RTEDATAMASK) == RTEDATAMASK)
 #define	doing_posn ((global_opts.masked_objective & POSNDATAMASK) == POSNDATAMASK)
 
+/*
+ * Data of points that only some outputs and filters use, see
+ * Format::wr_fields() and Filter::fields().  Readers may leave out what
+ * is not in global_opts.wanted_fields.
+ */
+enum wpt_field {
+  wpt_field_none = 0,
+  wpt_field_geocache = 1,	/* gc_data */
+  wpt_field_extensions = 2,	/* format specific data in fs, e.g. garmin_fs_t and GPX extensions */
+  wpt_field_all = wpt_field_geocache | wpt_field_extensions
+};
+
 struct global_options {
   int debug_level;
   gpsdata_type objective;
@@ -162,6 +189,7 @@ struct global_options {
   bool synthesize_shortnames;
   bool smart_icons;
   bool smart_names;
+  unsigned int wanted_fields{wpt_field_all};	/* wpt_fields the run's outputs and filters use */
 };
 
 extern global_options global_opts;
@@ -313,29 +341,48 @@ private:
     */
   };
 
+  /*
+   * Fields that are rarely set, particularly for track points, live in a
+   * side record that is only allocated once one of them is given a value.
+   * This keeps a bare track point small.  Copies of a waypoint share the
+   * record until one of them changes it.
+   */
+  class ColdData : public QSharedData
+  {
+  public:
+    double geoidheight{0};	/* Height (in meters) of geoid (mean sea level) above WGS84 earth ellipsoid. */
+
+    /*
+     * The "thickness" of a waypoint; adds an element of 3D.  Can be
+     * used to construct rudimentary polygons for, say, airspace
+     * definitions.   The units are meters.
+     */
+    double depth{0};
+
+    /*
+     * An alarm trigger value that can be considered to be a circle
+     * surrounding a waypoint (or cylinder if depth is also defined).
+     * The units are meters.
+     */
+    double proximity{0};
+    float temperature{0}; /* Degrees celsius */
+    UrlList urls;
+  };
+
   /* Data Members */
 
   static Geocache empty_gc_data;
+  static const UrlList empty_urls;
 
-  double geoidheight;	/* Height (in meters) of geoid (mean sea level) above WGS84 earth ellipsoid. */
-
-  /*
-   * The "thickness" of a waypoint; adds an element of 3D.  Can be
-   * used to construct rudimentary polygons for, say, airspace
-   * definitions.   The units are meters.
-   */
-  double depth;
-
-  /*
-   * An alarm trigger value that can be considered to be a circle
-   * surrounding a waypoint (or cylinder if depth is also defined).
-   * The units are meters.
-   */
-  double proximity;
   float course;	/* Optional: degrees true */
   float speed;   	/* Optional: meters per second. */
-  float temperature; /* Degrees celsius */
   op_flags opt_flags;
+  QSharedDataPointer<ColdData> cold_data;
+
+  /* Member Functions */
+
+  ColdData* AllocColdData();
+  void ReleaseGCData();
 
 public:
 
@@ -345,12 +392,24 @@ public:
   ~Waypoint();
   Waypoint(const Waypoint& other);
   Waypoint& operator=(const Waypoint& rhs);
+  // Moving hands the geocache data and the fs chain over instead of
+  // cloning them.  The moved from waypoint is left without any of them.
+  Waypoint(Waypoint&& other) noexcept;
+  Waypoint& operator=(Waypoint&& rhs) noexcept;
+  static void* operator new(std::size_t size);
+  static void operator delete(void* ptr, std::size_t size) noexcept;
 
   /* Member Functions */
 
+  static gpsbabel::ObjectPool& pool();
+
   bool HasUrlLink() const;
   const UrlLink& GetUrlLink() const;
+  const UrlList& GetUrlList() const;
   void AddUrlLink(const UrlLink& l);
+  // The bytes the waypoint takes, including its strings, its URLs, its
+  // geocache data and its format specific data, see heap_bytes().
+  std::size_t memory_usage() const;
   QString CreationTimeXML() const;
   gpsbabel::DateTime GetCreationTime() const;
   void SetCreationTime(const gpsbabel::DateTime& t);
@@ -398,13 +457,46 @@ public:
     opt_flags.field = 0; \
   }
 
-  GEN_WAYPT_METHODS(temperature)
-  GEN_WAYPT_METHODS(proximity)
+// the same for the fields kept in the cold data side record.
+#define GEN_COLD_WAYPT_METHODS(field) \
+  bool field##_has_value() const \
+  { \
+    return opt_flags.field; \
+  } \
+  decltype(ColdData::field) field##_value() const \
+  { \
+    if (!opt_flags.field) { \
+      throw std::bad_optional_access(); \
+    } \
+    return cold_data->field; \
+  } \
+  bool field##s_equal(const Waypoint& other) const \
+  { \
+    return (opt_flags.field && other.opt_flags.field && (cold_data->field == other.cold_data->field)) || \
+           (!opt_flags.field && !other.opt_flags.field); \
+  } \
+  decltype(ColdData::field) field##_value_or(decltype(ColdData::field) p) const \
+  { \
+    return (opt_flags.field)? cold_data->field : p; \
+  } \
+  void set_##field(decltype(ColdData::field) p) \
+  { \
+    AllocColdData()->field = p; \
+    opt_flags.field = 1; \
+  } \
+  void reset_##field() \
+  { \
+    opt_flags.field = 0; \
+  }
+
+  GEN_COLD_WAYPT_METHODS(temperature)
+  GEN_COLD_WAYPT_METHODS(proximity)
   GEN_WAYPT_METHODS(course)
   GEN_WAYPT_METHODS(speed)
-  GEN_WAYPT_METHODS(geoidheight)
-  GEN_WAYPT_METHODS(depth)
+  GEN_COLD_WAYPT_METHODS(geoidheight)
+  GEN_COLD_WAYPT_METHODS(depth)
 
+#undef GEN_COLD_WAYPT_METHODS
 #undef GEN_WAYPT_METHODS
 
   /* Data Members */
@@ -430,11 +522,9 @@ public:
    * notes are relatively long - over 100 characters - prose associated
    * with the above.   Unlike shortname and description, these are never
    * used to compute anything else and are strictly "passed through".
-   * Few formats support this.
+   * Few formats support this.  They are kept as UTF-8, see Utf8String.
    */
-  QString notes;
-
-  UrlList urls;
+  gpsbabel::Utf8String notes;
 
   QString icon_descr;
 
@@ -455,6 +545,8 @@ public:
   unsigned char cadence;	 /* revolutions per minute */
   float power; /* watts, as measured by cyclists */
   float odometer_distance; /* Meters */
+  // Shared by copies of the waypoint, AllocGCData() gives a copy that
+  // may be changed.
   Geocache* gc_data;
   FormatSpecificDataList fs;
   const session_t* session;	/* pointer to a session struct */
@@ -464,26 +556,49 @@ public:
 using waypt_cb = void (*)(const Waypoint*);
 
 // TODO: Consider using composition instead of private inheritance.
+/*
+ * Readers that know how many points or routes are coming from a count in
+ * the file, or can estimate it from the file's size, may make room for
+ * them up front with waypt_reserve(), track_reserve_wpts() and the like,
+ * so a large load isn't spent growing and copying the lists.  The counts
+ * come from files, so no more than this many are reserved at once; a
+ * list that turns out to need more just grows as usual.
+ */
+constexpr qsizetype kCapacityHintLimit = 1 << 22;
+
 class WaypointList : private QList<Waypoint*>
 {
 public:
   void waypt_add(Waypoint* wpt); // a.k.a. append(), push_back()
   void add_rte_waypt(int waypt_ct, Waypoint* wpt, bool synth, QStringView namepart, int number_digits);
-  // FIXME: Generally it is inefficient to use an element pointer or reference to define the element to be deleted, use iterator instead,
-  //        and/or implement pop_back() a.k.a. removeLast(), and/or pop_front() a.k.a. removeFirst().
+  // Deleting by element pointer has to search for the element, deleting by
+  // iterator does not.  To delete many elements use del_rte_waypts_if().
   void waypt_del(Waypoint* wpt); // a.k.a. erase()
+  QList<Waypoint*>::iterator waypt_del(QList<Waypoint*>::iterator it); // a.k.a. erase()
   void del_marked_wpts();
-  // FIXME: Generally it is inefficient to use an element pointer or reference to define the element to be deleted, use iterator instead,
-  //        and/or implement pop_back() a.k.a. removeLast(), and/or pop_front() a.k.a. removeFirst().
   void del_rte_waypt(Waypoint* wpt);
+  QList<Waypoint*>::iterator del_rte_waypt(QList<Waypoint*>::iterator it);
+  template <typename Pred>
+  int del_rte_waypts_if(Pred pred);
   void waypt_compute_bounds(bounds* bounds) const;
+  // Make room for count more waypoints, see kCapacityHintLimit.
+  void reserve_more(qsizetype count);
   Waypoint* find_waypt_by_name(const QString& name) const;
   void flush(); // a.k.a. clear()
   void copy(WaypointList** dst) const;
   void restore(WaypointList* src);
   void swap(WaypointList& other);
+  // Move all of src's waypoints to the end of this list without copying them.
+  void splice(WaypointList& src);
   template <typename Compare>
-  void sort(Compare cmp) {std::stable_sort(begin(), end(), cmp);}
+  void sort(Compare cmp)
+  {
+    std::stable_sort(begin(), end(), cmp);
+    invalidate_name_index();
+  }
+  // Put the waypoints in the order given, which holds exactly the
+  // waypoints of this list.
+  void reorder(const QVector<Waypoint*>& order);
   template <typename T>
   void waypt_disp_session(const session_t* se, T cb);
 
@@ -496,6 +611,7 @@ public:
   // public functions
   using QList<Waypoint*>::back; // a.k.a. last()
   using QList<Waypoint*>::begin;
+  using QList<Waypoint*>::capacity;
   using QList<Waypoint*>::cbegin;
   using QList<Waypoint*>::cend;
   using QList<Waypoint*>::count; // a.k.a. size()
@@ -507,12 +623,26 @@ public:
   using QList<Waypoint*>::front; // a.k.a. first()
   using QList<Waypoint*>::rbegin;
   using QList<Waypoint*>::rend;
+  using QList<Waypoint*>::reserve;
   using QList<Waypoint*>::size_type;
+
+private:
+  // find_waypt_by_name() builds an index from shortname to the first
+  // waypoint with that name on first use.  Once built it is maintained
+  // by waypt_add and add_rte_waypt, and discarded by anything that
+  // removes or reorders waypoints.  Renaming a waypoint in place isn't
+  // seen, so lookups that miss fall back to a linear search.
+  void index_name(Waypoint* wpt) const;
+  void invalidate_name_index() const;
+
+  mutable QHash<QString, Waypoint*> name_index;
+  mutable bool name_index_valid{false};
 };
 
 void waypt_init();
 //void update_common_traits(const Waypoint* wpt);
 void waypt_add(Waypoint* wpt);
+void waypt_reserve(qsizetype count);
 void waypt_del(Waypoint* wpt);
 void del_marked_wpts();
 int waypt_count();
@@ -522,6 +652,8 @@ void waypt_status_disp(int total_ct, int myct);
 void waypt_init_bounds(bounds* bounds);
 bool waypt_bounds_valid(bounds* bounds);
 void waypt_add_to_bounds(bounds* bounds, const Waypoint* waypointp);
+void waypt_merge_bounds(bounds* dst, const bounds& src);
+std::size_t url_list_heap_bytes(const UrlList& urls);
 void waypt_compute_bounds(bounds* bounds);
 Waypoint* find_waypt_by_name(const QString& name);
 void waypt_flush_all();
@@ -530,13 +662,38 @@ void waypt_append(WaypointList* src);
 void waypt_backup(WaypointList** head_bak);
 void waypt_restore(WaypointList* head_bak);
 void waypt_swap(WaypointList& other);
+void waypt_splice(WaypointList* src);
+// Direct this thread's waypoint functions to another list.
+void waypt_use_list(WaypointList* list);
 template <typename Compare>
 void waypt_sort(Compare cmp)
 {
-  extern WaypointList* global_waypoint_list;
+  extern thread_local WaypointList* global_waypoint_list;
 
   global_waypoint_list->sort(cmp);
 }
+void waypt_reorder(const QVector<Waypoint*>& order);
+/*
+ * In streaming mode (-Z) waypoints and track points are handed to a
+ * PointSink as soon as a reader adds them instead of being collected in
+ * the global lists.  The sink takes ownership of each point.  Points
+ * of a kind that wasn't asked for, see -w and -t, are deleted instead.
+ * Route points are still collected, as routes are rarely large.
+ */
+class PointSink
+{
+public:
+  PointSink() = default;
+  virtual ~PointSink() = default;
+  PointSink(const PointSink&) = delete;
+  PointSink& operator=(const PointSink&) = delete;
+  PointSink(PointSink&&) = delete;
+  PointSink& operator=(PointSink&&) = delete;
+
+  virtual void consume(Waypoint* wpt) = 0;
+};
+void waypt_set_sink(PointSink* sink);
+PointSink* waypt_sink();
 void waypt_add_url(Waypoint* wpt, const QString& link,
                    const QString& url_link_text);
 void waypt_add_url(Waypoint* wpt, const QString& link,
@@ -552,6 +709,41 @@ double waypt_vertical_speed(const Waypoint* A, const Waypoint* B);
 double waypt_gradient(const Waypoint* A, const Waypoint* B);
 double waypt_course(const Waypoint* A, const Waypoint* B);
 
+/*
+ * Remove and delete every waypoint for which pred is true in a single
+ * pass.  As with del_rte_waypt a new track segment that starts at a
+ * removed point starts at the next surviving point instead.
+ * Returns the number of waypoints removed.
+ */
+template <typename Pred>
+int
+WaypointList::del_rte_waypts_if(Pred pred)
+{
+  bool inherit_new_trkseg = false;
+  auto dst = begin();
+  for (auto src = begin(); src != end(); ++src) {
+    Waypoint* wpt = *src;
+    if (pred(wpt)) {
+      if (wpt->wpt_flags.new_trkseg) {
+        inherit_new_trkseg = true;
+      }
+      delete wpt;
+    } else {
+      if (inherit_new_trkseg) {
+        wpt->wpt_flags.new_trkseg = 1;
+        inherit_new_trkseg = false;
+      }
+      *dst++ = wpt;
+    }
+  }
+  const int removed = end() - dst;
+  if (removed > 0) {
+    erase(dst, end());
+    invalidate_name_index();
+  }
+  return removed;
+}
+
 template <typename T>
 void
 WaypointList::waypt_disp_session(const session_t* se, T cb)
@@ -559,6 +751,7 @@ WaypointList::waypt_disp_session(const session_t* se, T cb)
   int i = 0;
   foreach (Waypoint* waypointp, *this) {
     if ((se == nullptr) || (waypointp->session == se)) {
+      gpsbabel::Budget::check();
       if (global_opts.verbose_status) {
         i++;
         waypt_status_disp(waypt_count(), i);
@@ -575,7 +768,7 @@ template <typename T>
 void
 waypt_disp_session(const session_t* se, T cb)
 {
-  extern WaypointList* global_waypoint_list;
+  extern thread_local WaypointList* global_waypoint_list;
 
   global_waypoint_list->waypt_disp_session(se, cb);
 }
@@ -584,7 +777,7 @@ template <typename T>
 void
 waypt_disp_all(T cb)
 {
-  extern WaypointList* global_waypoint_list;
+  extern thread_local WaypointList* global_waypoint_list;
 
   global_waypoint_list->waypt_disp_session(nullptr, cb);
 }
@@ -609,6 +802,35 @@ struct computed_trkdata {
   std::optional<float> max_pwr;	  /* Max Power */
 };
 
+/*
+ * A dense, column oriented copy of the hot fields of a track's points.
+ * Geometric kernels can run over these arrays instead of chasing a
+ * Waypoint pointer for every field access.
+ * Element i corresponds to waypoint_list position i.
+ * Times are milliseconds since the epoch, 0 if the point has no valid time.
+ * Speeds are NaN if the point has no speed.
+ */
+struct TrackColumns {
+  QVector<double> latitude;
+  QVector<double> longitude;
+  QVector<double> altitude;
+  QVector<qint64> time;
+  QVector<float> speed;
+
+  qsizetype size() const {return latitude.size();}
+};
+
+/*
+ * The bounding box of a route's points, as waypt_add_to_bounds()
+ * accumulates it, and the first points with the earliest and the
+ * latest valid creation time, nullptr if no point has one.
+ */
+struct route_extent {
+  bounds bbox{};
+  const Waypoint* earliest{nullptr};
+  const Waypoint* latest{nullptr};
+};
+
 class route_head
 {
 public:
@@ -630,9 +852,73 @@ public:
   route_head(const route_head& other) = delete;
   route_head& operator=(const route_head& rhs) = delete;
   ~route_head();
+  static void* operator new(std::size_t size);
+  static void operator delete(void* ptr, std::size_t size) noexcept;
+
+  static gpsbabel::ObjectPool& pool();
+  int rte_waypt_ct() const {return waypoint_list.count() + packed_ct_;}		/* # waypoints in waypoint list */
+  // The bytes the route takes, not counting its points or the caches
+  // below, see heap_bytes().
+  std::size_t memory_usage() const;
+  bool rte_waypt_empty() const {return waypoint_list.empty() && (packed_ct_ == 0);}
+
+  // With --track-store packed the points of tracks that are only plain
+  // points are kept in a gpsbabel::PackedTrack between the stages of a
+  // run, and waypoint_list is empty meanwhile.  Readers may see packed
+  // tracks of earlier inputs, filters and writers never do.  Packing a
+  // track with any other point leaves it as it is.
+  void pack_points();
+  void unpack_points();
+  bool points_packed() const {return packed_ != nullptr;}
+
+  // The columnar view, the time index, the n-vectors of the positions,
+  // the extent and the track statistics are computed on first use and dropped whenever points are added or removed
+  // through RouteList.  Code that changes the list or the waypoints' hot
+  // fields directly must call invalidate_cache().  None of them may be
+  // first used from more than one thread at a time.
+  const TrackColumns& columns() const;
+  const gpsbabel::TimeIndex& time_index() const;
+  const QVector<gpsbabel::NVector>& nvectors() const;
+  const route_extent& extent() const;
+  const computed_trkdata& trkdata() const;
+  void invalidate_cache() const
+  {
+    columns_.reset();
+    time_index_.reset();
+    nvectors_.reset();
+    extent_.reset();
+    trkdata_.reset();
+  }
+  // Copy (possibly modified) coordinates and speeds back to the waypoints.
+  void store_columns(const TrackColumns& cols);
+
+private:
+  mutable std::unique_ptr<TrackColumns> columns_;
+  mutable std::unique_ptr<gpsbabel::TimeIndex> time_index_;
+  mutable std::unique_ptr<QVector<gpsbabel::NVector>> nvectors_;
+  mutable std::unique_ptr<route_extent> extent_;
+  mutable std::unique_ptr<computed_trkdata> trkdata_;
+  std::unique_ptr<gpsbabel::PackedTrack> packed_;
+  int packed_ct_{0};
+};
 
-  int rte_waypt_ct() const {return waypoint_list.count();}		/* # waypoints in waypoint list */
-  bool rte_waypt_empty() const {return waypoint_list.empty();}
+/*
+ * Readers that create a great many points may instantiate an
+ * AllocationArena for the duration of their read.  While it is alive
+ * Waypoints and route_heads are carved out of pooled chunks rather than
+ * being allocated one at a time, and once they have all been deleted
+ * again, e.g. by waypt_flush_all() and route_flush_all_tracks(),
+ * the chunks are returned in one go.
+ */
+class AllocationArena
+{
+public:
+  AllocationArena();
+  ~AllocationArena();
+  AllocationArena(const AllocationArena&) = delete;
+  AllocationArena& operator=(const AllocationArena&) = delete;
+  AllocationArena(AllocationArena&&) = delete;
+  AllocationArena& operator=(AllocationArena&&) = delete;
 };
 
 using route_hdr = void (*)(const route_head*);
@@ -644,21 +930,33 @@ class RouteList : private QList<route_head*>
 public:
   int waypt_count() const;
   void add_head(route_head* rte); // a.k.a. append(), push_back()
+  void reserve_more(qsizetype count);
   // FIXME: Generally it is inefficient to use an element pointer or reference to define the element to be deleted, use iterator instead,
   //        and/or implement pop_back() a.k.a. removeLast(), and/or pop_front() a.k.a. removeFirst().
   void del_head(route_head* rte); // a.k.a. erase()
   // FIXME: Generally it is inefficient to use an element pointer or reference to define the insertion point, use iterator instead.
   void insert_head(route_head* rte, route_head* predecessor); // a.k.a. insert
   void add_wpt(route_head* rte, Waypoint* wpt, bool synth, QStringView namepart, int number_digits);
-  // FIXME: Generally it is inefficient to use an element pointer or reference to define the insertion point, use iterator instead.
+  // Deleting by element pointer has to search for the element, deleting by
+  // iterator does not.  To delete many elements use del_wpts_if().
   void del_wpt(route_head* rte, Waypoint* wpt);
+  WaypointList::iterator del_wpt(route_head* rte, WaypointList::iterator it);
   void del_marked_wpts(route_head* rte);
+  template <typename Pred>
+  void del_wpts_if(route_head* rte, Pred pred)
+  {
+    waypt_ct -= rte->waypoint_list.del_rte_waypts_if(pred);
+    rte->invalidate_cache();
+  }
   void common_disp_session(const session_t* se, route_hdr rh, route_trl rt, waypt_cb wc);
   void flush(); // a.k.a. clear()
   void copy(RouteList** dst) const;
   void restore(RouteList* src);
   void swap(RouteList& other);
+  // Move all of src's routes to the end of this list without copying them.
+  void splice(RouteList& src);
   void swap_wpts(route_head* rte, WaypointList& other);
+  void invalidate_caches() const;
   template <typename Compare>
   void sort(Compare cmp) {std::sort(begin(), end(), cmp);}
   template <typename T1, typename T2, typename T3>
@@ -711,10 +1009,30 @@ void track_del_head(route_head* rte);
 void track_insert_head(route_head* rte, route_head* predecessor);
 void route_add_wpt(route_head* rte, Waypoint* wpt, QStringView namepart = u"RPT", int number_digits = 3);
 void track_add_wpt(route_head* rte, Waypoint* wpt, QStringView namepart = u"RPT", int number_digits = 3);
+void route_reserve_heads(qsizetype count);
+void track_reserve_heads(qsizetype count);
+void route_reserve_wpts(route_head* rte, qsizetype count);
+void track_reserve_wpts(route_head* rte, qsizetype count);
 void route_del_wpt(route_head* rte, Waypoint* wpt);
 void track_del_wpt(route_head* rte, Waypoint* wpt);
+WaypointList::iterator route_del_wpt(route_head* rte, WaypointList::iterator it);
+WaypointList::iterator track_del_wpt(route_head* rte, WaypointList::iterator it);
 void route_del_marked_wpts(route_head* rte);
 void track_del_marked_wpts(route_head* rte);
+template <typename Pred>
+void route_del_wpts_if(route_head* rte, Pred pred)
+{
+  extern thread_local RouteList* global_route_list;
+
+  global_route_list->del_wpts_if(rte, pred);
+}
+template <typename Pred>
+void track_del_wpts_if(route_head* rte, Pred pred)
+{
+  extern thread_local RouteList* global_track_list;
+
+  global_track_list->del_wpts_if(rte, pred);
+}
 void route_swap_wpts(route_head* rte, WaypointList& other);
 void track_swap_wpts(route_head* rte, WaypointList& other);
 //void route_disp(const route_head* rte, waypt_cb); /* template */
@@ -725,26 +1043,33 @@ void route_disp_session(const session_t* se, route_hdr rh, route_trl rt, waypt_c
 void track_disp_session(const session_t* se, route_hdr rh, route_trl rt, waypt_cb wc);
 void route_flush_all_routes();
 void route_flush_all_tracks();
+void route_invalidate_caches();
+void track_pack_all();
+void track_unpack_all();
+// Direct this thread's route and track functions to other lists.
+void route_use_lists(RouteList* routes, RouteList* tracks);
 void route_deinit();
 void route_append(const RouteList* src);
 void track_append(const RouteList* src);
 void route_backup(RouteList** head_bak);
 void route_restore(RouteList* head_bak);
 void route_swap(RouteList& other);
+void route_splice(RouteList* src);
 template <typename Compare>
 void route_sort(Compare cmp)
 {
-  extern RouteList* global_route_list;
+  extern thread_local RouteList* global_route_list;
 
   global_route_list->sort(cmp);
 }
 void track_backup(RouteList** head_bak);
 void track_restore(RouteList* head_bak);
 void track_swap(RouteList& other);
+void track_splice(RouteList* src);
 template <typename Compare>
 void track_sort(Compare cmp)
 {
-  extern RouteList* global_track_list;
+  extern thread_local RouteList* global_track_list;
 
   global_track_list->sort(cmp);
 }
@@ -756,6 +1081,7 @@ route_disp(const route_head* rh, T cb)
 {
 // cb != nullptr, caught with an overload of route_disp
   foreach (const Waypoint* waypointp, rh->waypoint_list) {
+    gpsbabel::Budget::check();
     cb(waypointp);
   }
 }
@@ -812,7 +1138,7 @@ template <typename T1, typename T2, typename T3>
 void
 route_disp_all(T1 rh, T2 rt, T3 wc)
 {
-  extern RouteList* global_route_list;
+  extern thread_local RouteList* global_route_list;
 
   global_route_list->disp_all(rh, rt, wc);
 }
@@ -821,13 +1147,201 @@ template <typename T1, typename T2, typename T3>
 void
 track_disp_all(T1 rh, T2 rt, T3 wc)
 {
-  extern RouteList* global_track_list;
+  extern thread_local RouteList* global_track_list;
 
   global_track_list->disp_all(rh, rt, wc);
 }
 
+/*
+ * Ranges over the data for plain loops, e.g.
+ *
+ *   for (Waypoint* wpt : waypt_range()) {...}
+ *   for (const route_head* trk : track_range(session)) {...}
+ *   for (Waypoint* wpt : track_points()) {...}
+ *
+ * Unlike the disp functions a loop over them can stop early, and they
+ * work with the standard algorithms.  Given a session they only hold
+ * what was read in it, without one they hold everything.  They view the
+ * lists of the calling thread, which must not change while they are
+ * used.
+ */
+template <typename T, typename List>
+class SessionRange
+{
+public:
+  class const_iterator
+  {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T*;
+    using difference_type = std::ptrdiff_t;
+    using pointer = T* const*;
+    using reference = T* const&;
+
+    const_iterator() = default;
+    const_iterator(typename List::const_iterator it, typename List::const_iterator end,
+                   const session_t* se) : it_(it), end_(end), se_(se)
+    {
+      skip();
+    }
+
+    reference operator*() const {return *it_;}
+    const_iterator& operator++()
+    {
+      ++it_;
+      skip();
+      return *this;
+    }
+    const_iterator operator++(int)
+    {
+      const_iterator prev = *this;
+      ++*this;
+      return prev;
+    }
+    bool operator==(const const_iterator& other) const {return it_ == other.it_;}
+    bool operator!=(const const_iterator& other) const {return it_ != other.it_;}
+
+  private:
+    void skip()
+    {
+      if (se_ != nullptr) {
+        while ((it_ != end_) && ((*it_)->session != se_)) {
+          ++it_;
+        }
+      }
+    }
+
+    typename List::const_iterator it_{};
+    typename List::const_iterator end_{};
+    const session_t* se_{nullptr};
+  };
+  using iterator = const_iterator;
+
+  SessionRange(const List& list, const session_t* se) : list_(list), se_(se) {}
+
+  const_iterator begin() const {return const_iterator(list_.cbegin(), list_.cend(), se_);}
+  const_iterator end() const {return const_iterator(list_.cend(), list_.cend(), se_);}
+  bool empty() const {return begin() == end();}
+
+private:
+  const List& list_;
+  const session_t* se_;
+};
+
+using WaypointRange = SessionRange<Waypoint, WaypointList>;
+using RouteRange = SessionRange<route_head, RouteList>;
+
+/* The points of every route or track of a RouteRange in turn. */
+class RoutePointRange
+{
+public:
+  class const_iterator
+  {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Waypoint*;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Waypoint* const*;
+    using reference = Waypoint* const&;
+
+    const_iterator() = default;
+    const_iterator(RouteRange::const_iterator rte, RouteRange::const_iterator end) :
+      rte_(rte), end_(end)
+    {
+      if (rte_ != end_) {
+        pt_ = (*rte_)->waypoint_list.cbegin();
+        settle();
+      }
+    }
+
+    reference operator*() const {return *pt_;}
+    const_iterator& operator++()
+    {
+      ++pt_;
+      settle();
+      return *this;
+    }
+    const_iterator operator++(int)
+    {
+      const_iterator prev = *this;
+      ++*this;
+      return prev;
+    }
+    bool operator==(const const_iterator& other) const
+    {
+      return (rte_ == other.rte_) && ((rte_ == end_) || (pt_ == other.pt_));
+    }
+    bool operator!=(const const_iterator& other) const {return !(*this == other);}
+
+  private:
+    // Moves on to the next route with points if this one has no more.
+    void settle()
+    {
+      while (pt_ == (*rte_)->waypoint_list.cend()) {
+        if (++rte_ == end_) {
+          return;
+        }
+        pt_ = (*rte_)->waypoint_list.cbegin();
+      }
+    }
+
+    RouteRange::const_iterator rte_{};
+    RouteRange::const_iterator end_{};
+    WaypointList::const_iterator pt_{};
+  };
+  using iterator = const_iterator;
+
+  explicit RoutePointRange(const RouteRange& routes) : routes_(routes) {}
+
+  const_iterator begin() const {return const_iterator(routes_.begin(), routes_.end());}
+  const_iterator end() const {return const_iterator(routes_.end(), routes_.end());}
+  bool empty() const {return begin() == end();}
+
+private:
+  RouteRange routes_;
+};
+
+inline WaypointRange
+waypt_range(const session_t* se = nullptr)
+{
+  extern thread_local WaypointList* global_waypoint_list;
+
+  return WaypointRange(*global_waypoint_list, se);
+}
+
+inline RouteRange
+route_range(const session_t* se = nullptr)
+{
+  extern thread_local RouteList* global_route_list;
+
+  return RouteRange(*global_route_list, se);
+}
+
+inline RouteRange
+track_range(const session_t* se = nullptr)
+{
+  extern thread_local RouteList* global_track_list;
+
+  return RouteRange(*global_track_list, se);
+}
+
+inline RoutePointRange
+route_points(const session_t* se = nullptr)
+{
+  return RoutePointRange(route_range(se));
+}
+
+inline RoutePointRange
+track_points(const session_t* se = nullptr)
+{
+  return RoutePointRange(track_range(se));
+}
+
 struct posn_status {
   volatile int request_terminate;
+  // When the fix returned arrived, if the reader knows better than the
+  // time rd_position() returned.
+  std::chrono::steady_clock::time_point received;
 };
 
 extern posn_status tracking_status;
@@ -914,6 +1428,8 @@ enum ff_cap {
 // negativeIndex, arrayIndexOutOfBoundsCond.
 [[gnu::format(printf, 1, 2)]] [[noreturn]] void fatal(const char* fmt, ...);
 [[gnu::format(printf, 1, 2)]] void warning(const char* fmt, ...);
+void fatal_set_throws(bool throws);
+bool fatal_throws();
 
 void printposn(double c, bool is_lat);
 
@@ -427,7 +427,7 @@ data_write()
 {
   int ct = waypt_count();
   struct hdr* htable, *bh;
-  extern WaypointList* global_waypoint_list;
+  extern thread_local WaypointList* global_waypoint_list;
   double minlon = 200;
   double maxlon = -200;
   double minlat = 200;
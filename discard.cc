@@ -26,93 +26,160 @@
 
 #include <cstdlib>             // for strtod
 
-#include "defs.h"              // for Waypoint, fatal, route_head (ptr only), xstrtoi, del_marked_wpts, route_del_marked_wpts, route_disp_all, track_del_marked_wpts, track_disp_all, waypt_disp_all, fix_none, fix_unknown
+#include "defs.h"              // for Waypoint, fatal, route_head (ptr only), xstrtoi, del_marked_wpts, route_del_marked_wpts, route_disp_all, track_del_marked_wpts, track_disp_all, fix_none, fix_unknown
+#include "filter.h"            // for global_waypoint_list
 #include "src/core/logging.h"  // for FatalMsg
 
 
 #if FILTERS_ENABLED
 
 /*
- * Decide whether to keep or toss this point.
+ * Turn the options into the tests and patterns evaluate_block() runs.
  */
-void DiscardFilter::fix_process_wpt(const Waypoint* wpt)
+void DiscardFilter::compile()
 {
-  bool del = false;
-  bool delh = false;
-  bool delv = false;
-
-  if ((hdopf >= 0.0) && (wpt->hdop > hdopf)) {
-    delh = true;
-  }
-  if ((vdopf >= 0.0) && (wpt->vdop > vdopf)) {
-    delv = true;
-  }
+  tests.clear();
+  patterns.clear();
 
   if (andopt) {
-    del = delh && delv;
+    // Both limits must be given for the linked test to discard anything.
+    if ((hdopf >= 0.0) && (vdopf >= 0.0)) {
+      tests.append({Test::kind_t::hdop_and_vdop_above, hdopf, vdopf});
+    }
   } else {
-    del = delh || delv;
+    if (hdopf >= 0.0) {
+      tests.append({Test::kind_t::hdop_above, hdopf});
+    }
+    if (vdopf >= 0.0) {
+      tests.append({Test::kind_t::vdop_above, vdopf});
+    }
   }
-
-  if ((satpf >= 0) && (wpt->sat < satpf)) {
-    del = true;
+  if (satpf >= 0) {
+    tests.append({Test::kind_t::sat_below, static_cast<double>(satpf)});
   }
-
-  if ((fixnoneopt) && (wpt->fix == fix_none)) {
-    del = true;
+  if (fixnoneopt) {
+    tests.append({Test::kind_t::fix_is, static_cast<double>(fix_none)});
   }
-
-  if ((fixunknownopt) && (wpt->fix == fix_unknown)) {
-    del = true;
+  if (fixunknownopt) {
+    tests.append({Test::kind_t::fix_is, static_cast<double>(fix_unknown)});
   }
-
-  if ((eleminopt) && (wpt->altitude < eleminpf)) {
-    del = true;
+  if (eleminopt) {
+    tests.append({Test::kind_t::altitude_below, static_cast<double>(eleminpf)});
   }
-
-  if ((elemaxopt) && (wpt->altitude > elemaxpf)) {
-    del = true;
+  if (elemaxopt) {
+    tests.append({Test::kind_t::altitude_above, static_cast<double>(elemaxpf)});
   }
 
-  if (nameopt && name_regex.match(wpt->shortname).hasMatch()) {
-    del = true;
+  if (nameopt) {
+    patterns.append({&name_regex, &Waypoint::shortname});
   }
-  if (descopt && desc_regex.match(wpt->description).hasMatch()) {
-    del = true;
+  if (descopt) {
+    patterns.append({&desc_regex, &Waypoint::description});
   }
-  if (cmtopt && cmt_regex.match(wpt->notes).hasMatch()) {
-    del = true;
+  if (cmtopt) {
+    patterns.append({&cmt_regex, &Waypoint::notes});
   }
-  if (iconopt && icon_regex.match(wpt->icon_descr).hasMatch()) {
-    del = true;
+  if (iconopt) {
+    patterns.append({&icon_regex, &Waypoint::icon_descr});
   }
+}
 
-  if (del) {
-    const_cast<Waypoint*>(wpt)->wpt_flags.marked_for_deletion = 1;
+/*
+ * Decide whether to keep or toss a block of points.  Each numeric test
+ * is one pass over the block, and the patterns are only matched against
+ * the points no test discarded.
+ */
+void DiscardFilter::evaluate_block(Waypoint* const* wpts, int count) const
+{
+  bool del[kBlockSize] = {};
+
+  for (const Test& test : tests) {
+    const double limit = test.limit;
+    switch (test.kind) {
+    case Test::kind_t::hdop_above:
+      for (int i = 0; i < count; ++i) {
+        del[i] |= wpts[i]->hdop > limit;
+      }
+      break;
+    case Test::kind_t::vdop_above:
+      for (int i = 0; i < count; ++i) {
+        del[i] |= wpts[i]->vdop > limit;
+      }
+      break;
+    case Test::kind_t::hdop_and_vdop_above:
+      for (int i = 0; i < count; ++i) {
+        del[i] |= (wpts[i]->hdop > limit) & (wpts[i]->vdop > test.limit2);
+      }
+      break;
+    case Test::kind_t::sat_below:
+      for (int i = 0; i < count; ++i) {
+        del[i] |= wpts[i]->sat < limit;
+      }
+      break;
+    case Test::kind_t::fix_is:
+      for (int i = 0; i < count; ++i) {
+        del[i] |= static_cast<double>(wpts[i]->fix) == limit;
+      }
+      break;
+    case Test::kind_t::altitude_below:
+      for (int i = 0; i < count; ++i) {
+        del[i] |= wpts[i]->altitude < limit;
+      }
+      break;
+    case Test::kind_t::altitude_above:
+      for (int i = 0; i < count; ++i) {
+        del[i] |= wpts[i]->altitude > limit;
+      }
+      break;
+    }
+  }
+
+  for (int i = 0; i < count; ++i) {
+    for (auto pattern = patterns.cbegin(); !del[i] && (pattern != patterns.cend()); ++pattern) {
+      del[i] = pattern->regex->match(wpts[i]->*(pattern->field)).hasMatch();
+    }
+    if (del[i]) {
+      wpts[i]->wpt_flags.marked_for_deletion = 1;
+    }
   }
 }
 
-void DiscardFilter::process()
+template <typename List>
+void DiscardFilter::mark_points(const List& wpts) const
 {
-  auto waypoint_cb_lambda = [this](const Waypoint* wpt) -> void {
-    fix_process_wpt(wpt);
-  };
+  Waypoint* block[kBlockSize];
+  int count = 0;
+  for (auto it = wpts.cbegin(); it != wpts.cend(); ++it) {
+    block[count++] = *it;
+    if (count == kBlockSize) {
+      evaluate_block(block, count);
+      count = 0;
+    }
+  }
+  if (count > 0) {
+    evaluate_block(block, count);
+  }
+}
 
+void DiscardFilter::process()
+{
   // Filter waypoints.
-  waypt_disp_all(waypoint_cb_lambda);
+  mark_points(*global_waypoint_list);
   del_marked_wpts();
 
   // Filter tracks
-  auto track_tlr_lambda = [](const route_head* rte)->void {
+  auto track_hdr_lambda = [this](const route_head* rte)->void {
+    mark_points(rte->waypoint_list);
     track_del_marked_wpts(const_cast<route_head*>(rte));
   };
-  track_disp_all(nullptr, track_tlr_lambda, waypoint_cb_lambda);
+  track_disp_all(track_hdr_lambda, nullptr, nullptr);
 
   // And routes
-  auto route_tlr_lambda = [](const route_head* rte)->void {
+  auto route_hdr_lambda = [this](const route_head* rte)->void {
+    mark_points(rte->waypoint_list);
     route_del_marked_wpts(const_cast<route_head*>(rte));
   };
-  route_disp_all(nullptr, route_tlr_lambda, waypoint_cb_lambda);
+  route_disp_all(route_hdr_lambda, nullptr, nullptr);
 }
 
 QRegularExpression DiscardFilter::generateRegExp(const QString& glob_pattern)
@@ -180,6 +247,8 @@ void DiscardFilter::init()
       fatal(FatalMsg() << "discard: matchicon option is an invalid expression.");
     }
   }
+
+  compile();
 }
 
 #endif
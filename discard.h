@@ -23,6 +23,7 @@
 #define DISCARD_H_INCLUDED_
 
 #include <QRegularExpression>  // for QRegularExpression
+#include <QList>               // for QList
 #include <QString>             // for QString
 #include <QVector>             // for QVector
 
@@ -41,9 +42,43 @@ public:
   void process() override;
 
 private:
+  /* Types */
+
+  /*
+   * One numeric condition of the predicate program.  A point is
+   * discarded if any test holds or any pattern matches.
+   */
+  struct Test {
+    enum class kind_t {
+      hdop_above,
+      vdop_above,
+      hdop_and_vdop_above,
+      sat_below,
+      fix_is,
+      altitude_below,
+      altitude_above
+    };
+
+    kind_t kind;
+    double limit;
+    double limit2{0};  // vdop limit of hdop_and_vdop_above
+  };
+
+  struct Pattern {
+    const QRegularExpression* regex;
+    QString Waypoint::* field;
+  };
+
+  /* Constants */
+
+  static constexpr int kBlockSize = 256;
+
   /* Member Functions */
 
-  void fix_process_wpt(const Waypoint* wpt);
+  void compile();
+  void evaluate_block(Waypoint* const* wpts, int count) const;
+  template <typename List>
+  void mark_points(const List& wpts) const;
   static QRegularExpression generateRegExp(const QString& glob_pattern);
 
   /* Data Members */
@@ -71,6 +106,9 @@ private:
   int eleminpf{};
   int elemaxpf{};
 
+  QList<Test> tests;
+  QList<Pattern> patterns;
+
   QVector<arglist_t> args = {
     {
       "hdop", &hdopopt, "Suppress points with higher hdop",
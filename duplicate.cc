@@ -21,12 +21,19 @@
 
 #include "duplicate.h"
 
+#include <cmath>                 // for abs, floor, isfinite, isnan, llround, signbit
+#include <limits>                // for numeric_limits
 #include <utility>               // for as_const
 
+#include <QHash>                 // for QHash, qHashMulti
+#include <QLatin1Char>           // for QLatin1Char
 #include <QList>                 // for QList, QList<>::iterator, QList<>::const_iterator
-#include <QMultiHash>            // for QMultiHash
+#include <QSet>                  // for QSet
+#include <QString>               // for QString
 
 #include "defs.h"
+#include "src/core/bloomfilter.h"  // for BloomFilter
+#include "src/core/scheduler.h"    // for parallel_for
 
 
 #if FILTERS_ENABLED
@@ -40,43 +47,176 @@ void DuplicateFilter::init()
   }
 }
 
-void DuplicateFilter::process()
+/*
+ * The location part of the key.  The key used to be the text of
+ * degrees2ddmm() with three decimals, a feeble attempt to get everything
+ * rounded the same way in a precision that's "close enough" for
+ * determining duplicates.  This is that text as a number: the value in
+ * thousandths, with "-0.000" and the non-finite values kept apart.
+ */
+qint64 DuplicateFilter::ddmm_key(double deg)
 {
-  QMultiHash<QString, Waypoint*> wpthash;
-  for (Waypoint* waypointp : std::as_const(*global_waypoint_list)) {
+  constexpr qint64 kNegativeZero = std::numeric_limits<qint64>::min();
+  constexpr qint64 kNan = kNegativeZero + 1;
+  constexpr qint64 kInfinity = kNegativeZero + 2;
+  constexpr qint64 kMinusInfinity = kNegativeZero + 3;
+
+  double ddmm = degrees2ddmm(deg);
+  if (!std::isfinite(ddmm)) {
+    return std::isnan(ddmm) ? kNan : (ddmm > 0) ? kInfinity : kMinusInfinity;
+  }
 
-    QString key;
-    if (lcopt) {
-      /* The degrees2ddmm stuff is a feeble attempt to
-       * get everything rounded the same way in a precision
-       * that's "close enough" for determining duplicates.
-       */
-      key = QStringLiteral("%1%2")
-        .arg(degrees2ddmm(waypointp->latitude), 11, 'f', 3)
-        .arg(degrees2ddmm(waypointp->longitude), 11, 'f', 3);
+  double scaled = ddmm * 1000.0;
+  qint64 key;
+  if (std::abs(scaled - std::floor(scaled) - 0.5) < 1.0e-6) {
+    // Too close to a tie for the product to settle it, round like the text.
+    key = QString::number(ddmm, 'f', 3).remove(QLatin1Char('.')).toLongLong();
+  } else {
+    key = std::llround(scaled);
+  }
+  if ((key == 0) && std::signbit(ddmm)) {
+    return kNegativeZero;
+  }
+  return key;
+}
+
+DuplicateFilter::DupKey DuplicateFilter::make_key(const Waypoint* wpt) const
+{
+  DupKey key;
+  if (lcopt) {
+    key.lat = ddmm_key(wpt->latitude);
+    key.lon = ddmm_key(wpt->longitude);
+  }
+  if (snopt) {
+    key.name = wpt->shortname;
+  }
+  key.hash = qHashMulti(0, key.lat, key.lon, key.name);
+  return key;
+}
+
+/*
+ * The same result as process() without holding a key for every
+ * waypoint.  A first pass puts the hash of every key in a Bloom filter,
+ * and the hashes the filter may have seen before are the candidates.
+ * Only the candidates get keys in the second pass.  Most waypoints of a
+ * large list are unique, so this takes a few bytes a waypoint instead
+ * of a key, a group and an index entry.
+ */
+void DuplicateFilter::process_compact()
+{
+  struct Group {
+    Waypoint* first;
+    Waypoint* last;
+  };
+
+  gpsbabel::BloomFilter seen(global_waypoint_list->count());
+  QSet<quint64> candidates;
+  for (const Waypoint* waypointp : std::as_const(*global_waypoint_list)) {
+    const quint64 hash = make_key(waypointp).hash;
+    if (seen.insert(hash)) {
+      candidates.insert(hash);
     }
+  }
 
-    if (snopt) {
-      key.append(waypointp->shortname);
+  QHash<DupKey, Group> groups;
+  groups.reserve(candidates.size());
+  for (Waypoint* waypointp : std::as_const(*global_waypoint_list)) {
+    DupKey key = make_key(waypointp);
+    if (!candidates.contains(key.hash)) {
+      continue;
+    }
+    auto it = groups.find(key);
+    if (it == groups.end()) {
+      groups.insert(key, {waypointp, waypointp});
+      continue;
+    }
+    if (purge_duplicates) {
+      it->first->wpt_flags.marked_for_deletion = 1;
     }
+    it->last = waypointp;
+    waypointp->wpt_flags.marked_for_deletion = 1;
+  }
+
+  if (correct_coords) {
+    for (const Group& group : std::as_const(groups)) {
+      if (group.last != group.first) {
+        group.first->latitude = group.last->latitude;
+        group.first->longitude = group.last->longitude;
+      }
+    }
+  }
+  del_marked_wpts();
+}
 
-    wpthash.insert(key, waypointp);
+void DuplicateFilter::process()
+{
+  if (opt_compact) {
+    process_compact();
+    return;
   }
 
-  const QList<QString> keys = wpthash.uniqueKeys();
-  for (const auto& key : keys) {
-    const QList<Waypoint*> values = wpthash.values(key);
-    if (values.size() > 1) {
-      Waypoint* wptfirst = values.last(); // first inserted
-      if (correct_coords) {
-        Waypoint* wptlast = values.front(); // last inserted
-        wptfirst->latitude = wptlast->latitude;
-        wptfirst->longitude = wptlast->longitude;
+  /* The waypoints with one key, in the order they were read. */
+  struct Group {
+    Waypoint* first;
+    Waypoint* last;
+    bool duplicated;
+  };
+
+  QList<Waypoint*> wpts;
+  wpts.reserve(global_waypoint_list->count());
+  for (Waypoint* waypointp : std::as_const(*global_waypoint_list)) {
+    wpts.append(waypointp);
+  }
+  const qsizetype nelems = wpts.size();
+
+  /* Building the keys is the expensive part, and it doesn't depend on order. */
+  QList<DupKey> keys(nelems);
+  const int threads = (opt_threads != nullptr) ? xstrtoi(opt_threads, nullptr, 10) : 1;
+  if ((threads > 1) && (nelems >= kParallelMin)) {
+    Waypoint* const* in = wpts.constData();
+    DupKey* out = keys.data();
+    gpsbabel::parallel_for(nelems, (nelems + threads - 1) / threads, [this, in, out](qsizetype begin, qsizetype end) {
+      for (qsizetype i = begin; i < end; ++i) {
+        out[i] = make_key(in[i]);
       }
-      for (Waypoint* wpt : values) {
-        if (purge_duplicates || (wpt != wptfirst)) {
-          wpt->wpt_flags.marked_for_deletion = 1;
-        }
+    });
+  } else {
+    for (qsizetype i = 0; i < nelems; ++i) {
+      keys[i] = make_key(wpts.at(i));
+    }
+  }
+
+  QHash<DupKey, qsizetype> group_index;
+  group_index.reserve(nelems);
+  QList<Group> groups;
+  QList<qsizetype> group_of(nelems);
+  for (qsizetype i = 0; i < nelems; ++i) {
+    auto it = group_index.constFind(keys.at(i));
+    if (it == group_index.constEnd()) {
+      group_of[i] = groups.size();
+      group_index.insert(keys.at(i), groups.size());
+      groups.append({wpts.at(i), wpts.at(i), false});
+    } else {
+      group_of[i] = *it;
+      Group& group = groups[*it];
+      group.last = wpts.at(i);
+      group.duplicated = true;
+    }
+  }
+  keys.clear();
+  group_index.clear();
+
+  for (qsizetype i = 0; i < nelems; ++i) {
+    const Group& group = groups.at(group_of.at(i));
+    if (group.duplicated && (purge_duplicates || (wpts.at(i) != group.first))) {
+      wpts.at(i)->wpt_flags.marked_for_deletion = 1;
+    }
+  }
+  if (correct_coords) {
+    for (const Group& group : std::as_const(groups)) {
+      if (group.duplicated) {
+        group.first->latitude = group.last->latitude;
+        group.first->longitude = group.last->longitude;
       }
     }
   }
@@ -22,8 +22,10 @@
 #ifndef DUPLICATE_H_INCLUDED_
 #define DUPLICATE_H_INCLUDED_
 
+#include <QHash>     // for qHashMulti
 #include <QString>   // for QString
 #include <QVector>   // for QVector
+#include <QtGlobal>  // for qint64
 
 #include "defs.h"    // for ARGTYPE_BOOL, ARG_NOMINMAX, Waypoint (ptr only)
 #include "filter.h"  // for Filter
@@ -41,10 +43,44 @@ public:
   void process() override;
 
 private:
+  /* Types */
+
+  /* What makes two waypoints duplicates of each other. */
+  struct DupKey {
+    qint64 lat{};	/* degrees2ddmm() to three decimals, see ddmm_key() */
+    qint64 lon{};
+    QString name;
+    size_t hash{};
+
+    bool operator==(const DupKey& other) const
+    {
+      return (lat == other.lat) && (lon == other.lon) && (name == other.name);
+    }
+    friend size_t qHash(const DupKey& k, size_t seed = 0) noexcept
+    {
+      return k.hash ^ seed;
+    }
+  };
+
+  /* Constants */
+
+  /* Fewer waypoints than this aren't worth starting threads for. */
+  static constexpr qsizetype kParallelMin = 64 * 1024;
+
+  /* Member Functions */
+
+  static qint64 ddmm_key(double deg);
+  DupKey make_key(const Waypoint* wpt) const;
+  void process_compact();
+
+  /* Data Members */
+
   char* snopt = nullptr;
   char* lcopt = nullptr;
   char* purge_duplicates = nullptr;
   char* correct_coords = nullptr;
+  char* opt_threads = nullptr;
+  char* opt_compact = nullptr;
 
   QVector<arglist_t> args = {
     {
@@ -63,6 +99,14 @@ private:
       "correct", &correct_coords, "Use coords from duplicate points",
       nullptr, ARGTYPE_BOOL, ARG_NOMINMAX, nullptr
     },
+    {
+      "threads", &opt_threads, "Compare large waypoint lists on this many threads",
+      nullptr, ARGTYPE_INT, "1", nullptr, nullptr
+    },
+    {
+      "compact", &opt_compact, "Find candidates with a Bloom filter to save memory",
+      nullptr, ARGTYPE_BOOL, ARG_NOMINMAX, nullptr
+    },
   };
 
 };
@@ -39,12 +39,15 @@
 #include <QByteArray>           // for QByteArray
 #include <QDate>                // for QDate
 #include <QDateTime>            // for QDateTime
+#include <QDir>                 // for QDir, QDir::Files, QDir::Name
 #include <QFile>                // for QFile
 #include <QFileInfo>            // for QFileInfo
+#include <QIODevice>            // for QIODevice
 #include <QList>                // for QList
 #include <QPair>                // for QPair
 #include <QRegularExpression>   // for QRegularExpressionMatch, QRegularExpression
 #include <QString>              // for QString
+#include <QStringList>          // for QStringList
 #include <QTextCodec>           // for QTextCodec
 #include <QTime>                // for QTime
 #include <QVariant>             // for QVariant
@@ -52,7 +55,8 @@
 #include <Qt>                   // for UTC, ISODate
 #include <QtGlobal>             // for qPrintable, qint64
 
-#include <algorithm>            // for sort, min
+#include <algorithm>            // for sort, min, max, lower_bound
+#include <atomic>               // for atomic
 #include <cassert>              // for assert
 #include <cctype>               // for isprint, isspace
 #include <cfloat>               // for DBL_EPSILON
@@ -61,13 +65,19 @@
 #include <cstdio>               // for printf, SEEK_SET, snprintf, SEEK_CUR
 #include <cstdlib>              // for abs
 #include <cstring>              // for memcmp, strlen
-#include <utility>              // for as_const
+#include <iterator>             // for prev
+#include <memory>               // for unique_ptr, make_unique
+#include <utility>              // for as_const, move
+#include <vector>               // for vector
 
 #include "defs.h"               // for Waypoint, fatal, warning, global_options, global_opts, unknown_alt, xfree, route_disp_all, track_disp_all, waypt_disp_all, wp_flags, KNOTS_TO_MPS, KPH_TO_MPS, MPH_TO_MPS, MPS_TO_KPH, WAYPT_HAS, case_ignore_strcmp, waypt_add, xstrdup, xstrndup, fix_2d
 #include "garmin_tables.h"      // for gt_lookup_datum_index
 #include "gbfile.h"             // for gbfputuint32, gbfputuint16, gbfgetuint16, gbfgetuint32, gbfseek, gbftell, gbfile, gbfclose, gbfcopyfrom, gbfwrite, gbfopen_be, gbfread, gbfrewind, gbfgetflt, gbfgetint16, gbfopen, gbfputc, gbfputflt, gbsize_t, gbfeof, gbfgetdbl, gbfputdbl, gbfile::(anonymous)
 #include "jeeps/gpsmath.h"      // for GPS_Math_WGS84_To_Known_Datum_M
+#include "session.h"            // for curr_session, use_session, ThreadScope
 #include "src/core/datetime.h"  // for DateTime
+#include "src/core/logging.h"   // for FatalError
+#include "src/core/scheduler.h"  // for parallel_for
 
 
 #define MYNAME "exif"
@@ -306,25 +316,40 @@ ExifFormat::exif_ifd_size(ExifIfd* ifd)
   return res;
 }
 
+/*
+ * Cache the segments of the image.  With headers_only, as when only
+ * reading the position, stop after the Exif segment, or at the start of
+ * the compressed data if there is none, so the image data is never read.
+ */
 ExifFormat::ExifApp*
-ExifFormat::exif_load_apps()
+ExifFormat::exif_load_apps(bool headers_only)
 {
   exif_app_ = nullptr;
 
   while (! gbfeof(fin_)) {
+    if (headers_only && exif_app_) {
+      break;
+    }
+    const gboff_t offs = gbftell(fin_);
+    const uint16_t marker = gbfgetuint16(fin_);
+    if (headers_only && (marker == 0xFFDA)) {
+      break;
+    }
+
     exif_apps->append(new ExifApp);
     ExifApp* app = exif_apps->last();
     app->fcache = gbfopen(nullptr, "wb", MYNAME);
 
-    app->marker = gbfgetuint16(fin_);
+    app->offs = offs;
+    app->marker = marker;
     app->len = gbfgetuint16(fin_);
     if (global_opts.debug_level >= 3) {
-      printf(MYNAME ": api = %02X, len = %u (0x%04x), offs = 0x%08X\n", app->marker & 0xFF, app->len, app->len, gbftell(fin_));
+      printf(MYNAME ": api = %02X, len = %u (0x%04x), offs = 0x%08llX\n", app->marker & 0xFF, app->len, app->len, (long long) gbftell(fin_));
     }
     if (exif_app_ || (app->marker == 0xFFDA)) { /* compressed data */
-      gbfcopyfrom(app->fcache, fin_, 0x7FFFFFFF);
+      gbfcopyfrom(app->fcache, fin_, kCopyAll);
       if (global_opts.debug_level >= 3) {
-        printf(MYNAME ": compressed data size = %u\n", gbftell(app->fcache));
+        printf(MYNAME ": compressed data size = %lld\n", (long long) gbftell(app->fcache));
       }
     } else {
       gbfcopyfrom(app->fcache, fin_, app->len - 2);
@@ -645,7 +670,7 @@ ExifFormat::exif_examine_app(ExifApp* app)
   gbfseek(ftmp, 6, SEEK_SET);
   app->fexif = gbfopen(nullptr, "wb", MYNAME);
   app->fexif->big_endian = ftmp->big_endian;
-  gbfcopyfrom(app->fexif, ftmp, 0x7FFFFFFF);
+  gbfcopyfrom(app->fexif, ftmp, kCopyAll);
 
   exif_read_app(app);
 }
@@ -1176,6 +1201,132 @@ ExifFormat::exif_find_wpt_by_name(const Waypoint* wpt)
   }
 }
 
+void
+ExifFormat::exif_find_named_wpt()
+{
+  auto exif_find_wpt_by_name_lambda = [this](const Waypoint* waypointp)->void {
+    exif_find_wpt_by_name(waypointp);
+  };
+  waypt_disp_all(exif_find_wpt_by_name_lambda);
+  if (exif_wpt_ref == nullptr) {
+    route_disp_all(nullptr, nullptr, exif_find_wpt_by_name_lambda);
+  }
+  if (exif_wpt_ref == nullptr) {
+    track_disp_all(nullptr, nullptr, exif_find_wpt_by_name_lambda);
+  }
+  if (exif_wpt_ref == nullptr) {
+    warning(MYNAME ": No matching point with name \"%s\" found.\n", opt_name);
+  }
+}
+
+/*
+ * Return wpt if it is within the time frame of time, otherwise say why
+ * not and return nullptr.
+ */
+const Waypoint*
+ExifFormat::exif_check_frame(const QDateTime& time, const Waypoint* wpt) const
+{
+  qint64 frame = xstrtoi(opt_frame, nullptr, 10);
+
+  if (wpt == nullptr) {
+    warning(MYNAME ": No point with a valid timestamp found.\n");
+  } else if (std::abs(time.secsTo(wpt->creation_time)) > frame) {
+    QString time_str = exif_time_str(time);
+    warning(MYNAME ": No matching point found for image date %s!\n", qPrintable(time_str));
+    QString str = exif_time_str(wpt->creation_time);
+    warning(MYNAME ": Best is from %s, %lld second(s) away.\n",
+            qPrintable(str), std::abs(time.secsTo(wpt->creation_time)));
+    return nullptr;
+  }
+  return wpt;
+}
+
+/*
+ * Collect the points with a timestamp, sorted by time, so that the
+ * point closest to an image's time can be found by a binary search.
+ * Points are visited in the order exif_find_wpt_by_time sees them, and
+ * kept in that order among equal times, so both pick the same point.
+ */
+ExifFormat::ExifTimeIndex
+ExifFormat::exif_build_time_index()
+{
+  ExifTimeIndex index;
+  auto exif_index_wpt_lambda = [&index](const Waypoint* waypointp)->void {
+    if (waypointp->creation_time.isValid()) {
+      index.push_back({waypointp->creation_time.toMSecsSinceEpoch(), static_cast<int>(index.size()), waypointp});
+    }
+  };
+  track_disp_all(nullptr, nullptr, exif_index_wpt_lambda);
+  route_disp_all(nullptr, nullptr, exif_index_wpt_lambda);
+  waypt_disp_all(exif_index_wpt_lambda);
+
+  std::sort(index.begin(), index.end(), [](const ExifTimePoint& a, const ExifTimePoint& b)->bool {
+    return (a.msecs < b.msecs) || ((a.msecs == b.msecs) && (a.seq < b.seq));
+  });
+  return index;
+}
+
+const Waypoint*
+ExifFormat::exif_nearest_wpt(const ExifTimeIndex& index, const QDateTime& time)
+{
+  auto earlier = [](const ExifTimePoint& point, qint64 msecs)->bool {
+    return point.msecs < msecs;
+  };
+  const qint64 msecs = time.toMSecsSinceEpoch();
+  auto after = std::lower_bound(index.cbegin(), index.cend(), msecs, earlier);
+  if (after == index.cbegin()) {
+    return (after == index.cend()) ? nullptr : after->wpt;
+  }
+  // The first of the points at the latest time before the image.
+  auto before = std::lower_bound(index.cbegin(), after, std::prev(after)->msecs, earlier);
+  if (after == index.cend()) {
+    return before->wpt;
+  }
+
+  // Like the scan, prefer the point seen first when both are as close.
+  qint64 before_diff = msecs - before->msecs;
+  qint64 after_diff = after->msecs - msecs;
+  if ((before_diff < after_diff) || ((before_diff == after_diff) && (before->seq < after->seq))) {
+    return before->wpt;
+  }
+  return after->wpt;
+}
+
+/*
+ * When the output is a directory, or a file listing images with the
+ * list option, return the images to tag.
+ */
+QStringList
+ExifFormat::exif_batch_images(const QString& fname) const
+{
+  QStringList images;
+  if (opt_list) {
+    QFile list(fname);
+    if (!list.open(QIODevice::ReadOnly | QIODevice::Text)) {
+      fatal(MYNAME ": Cannot open image list \"%s\".\n", qPrintable(fname));
+    }
+    while (!list.atEnd()) {
+      QString image = QString::fromUtf8(list.readLine()).trimmed();
+      if (!image.isEmpty()) {
+        images.append(image);
+      }
+    }
+  } else if (QFileInfo(fname).isDir()) {
+    const QDir dir(fname);
+    const QStringList names = dir.entryList({"*.jpg", "*.jpeg"}, QDir::Files, QDir::Name);
+    for (const auto& name : names) {
+      images.append(dir.filePath(name));
+    }
+  } else {
+    return images;
+  }
+
+  if (images.isEmpty()) {
+    fatal(MYNAME ": No images to tag in \"%s\".\n", qPrintable(fname));
+  }
+  return images;
+}
+
 
 bool
 ExifFormat::exif_sort_tags_cb(const ExifTag& A, const ExifTag& B)
@@ -1301,114 +1452,166 @@ ExifFormat::exif_write_ifd(ExifIfd* ifd, const char next, gbfile* fout)
   }
 }
 
-void
-ExifFormat::exif_write_apps() const
+/*
+ * Lay out the TIFF structure of the Exif APP1 segment, the part that
+ * follows the "Exif\0\0" header, with the updated tags.
+ */
+QByteArray
+ExifFormat::exif_build_tiff(ExifApp* app) const
 {
-  gbfputuint16(0xFFD8, fout_);
-
-  for (auto* app : std::as_const(*exif_apps)) {
+  assert(app->marker == 0xFFE1);
+  uint32_t len = 8;
 
-    gbfputuint16(app->marker, fout_);
+  exif_put_long(IFD0, IFD0_TAG_GPS_IFD_OFFS, 0, 0);
+  exif_put_value(GPS_IFD, GPS_IFD_TAG_VERSION, EXIF_TYPE_BYTE, 4, 0, writer_gps_tag_version);
 
-    if (app == exif_app_) {
-      assert(app->marker == 0xFFE1);
-      uint32_t len = 8;
+  std::sort(app->ifds.begin(), app->ifds.end(), exif_sort_ifds_cb);
 
-      exif_put_long(IFD0, IFD0_TAG_GPS_IFD_OFFS, 0, 0);
-      exif_put_value(GPS_IFD, GPS_IFD_TAG_VERSION, EXIF_TYPE_BYTE, 4, 0, writer_gps_tag_version);
+  for (auto& ifd_instance : app->ifds) {
+    ExifIfd* ifd = &ifd_instance;
 
-      std::sort(app->ifds.begin(), app->ifds.end(), exif_sort_ifds_cb);
+    if (ifd->nr == GPS_IFD) {
+      exif_put_long(IFD0, IFD0_TAG_GPS_IFD_OFFS, 0, len);
+    } else if (ifd->nr == EXIF_IFD) {
+      exif_put_long(IFD0, IFD0_TAG_EXIF_IFD_OFFS, 0, len);
+    } else if (ifd->nr == INTER_IFD) {
+      exif_put_long(EXIF_IFD, EXIF_IFD_TAG_INTER_IFD_OFFS, 0, len);
+    }
 
-      for (auto& ifd_instance : app->ifds) {
-        ExifIfd* ifd = &ifd_instance;
+    len += exif_ifd_size(ifd);
+  }
 
-        if (ifd->nr == GPS_IFD) {
-          exif_put_long(IFD0, IFD0_TAG_GPS_IFD_OFFS, 0, len);
-        } else if (ifd->nr == EXIF_IFD) {
-          exif_put_long(IFD0, IFD0_TAG_EXIF_IFD_OFFS, 0, len);
-        } else if (ifd->nr == INTER_IFD) {
-          exif_put_long(EXIF_IFD, EXIF_IFD_TAG_INTER_IFD_OFFS, 0, len);
-        }
+  len += 4; /* DWORD(0) after last ifd */
 
-        len += exif_ifd_size(ifd);
+  // gather offsets and sizes of thumbnail image data to relocate.
+  // update offsets to point to relocated data.
+  ExifTag* tag_offset;
+  ExifTag* tag_size;
+  QVector<QPair<uint32_t, uint32_t>> image_data;
+  if ((tag_offset = exif_find_tag(app, IFD1, IFD1_TAG_JPEG_OFFS))) {
+    // IFD1_TAG_COMPRESSION should be 6 indicating JPEG compressed image data.
+    tag_size = exif_find_tag(app, IFD1, IFD1_TAG_JPEG_SIZE);
+    if (tag_size == nullptr) {
+      fatal(MYNAME ": Invalid image file, in IFD1 both JPEGInterchangeFormat and JPEGInterchangeFormatLength must exist for compressed thumbnails.");
+    }
+    auto offset = tag_offset->data.at(0).value<uint32_t>();
+    auto size = tag_size->data.at(0).value<uint32_t>();
+    image_data.append(QPair<uint32_t, uint32_t>(offset, size));
+    exif_put_long(IFD1, IFD1_TAG_JPEG_OFFS, 0, len);
+    len += size;
+  } else if ((tag_offset = exif_find_tag(app, IFD1, IFD1_TAG_STRIP_OFFS))) {
+    // IFD1_TAG_COMPRESSION should be 1 indicating uncompressed image data.
+    tag_size = exif_find_tag(app, IFD1, IFD1_TAG_STRIP_BYTE_COUNTS);
+    if ((tag_size == nullptr) || (tag_size->count != tag_offset->count)) {
+      fatal(MYNAME ": Invalid image file, in IFD1 both StripOffsets and StripByteCounts must exist and have equal counts for uncompressed thumbnails.");
+    }
+    for (unsigned idx = 0; idx < tag_offset->count; idx++) {
+      auto offset = tag_offset->data.at(idx).value<uint32_t>();
+      auto size = tag_size->data.at(idx).value<uint32_t>();
+      image_data.append(QPair<uint32_t, uint32_t>(offset, size));
+      if (tag_offset->type == EXIF_TYPE_SHORT) {
+        exif_put_short(IFD1, IFD1_TAG_STRIP_OFFS, idx, len);
+      } else {
+        exif_put_long(IFD1, IFD1_TAG_STRIP_OFFS, idx, len);
       }
+      len += size;
+    }
+  }
 
-      len += 4; /* DWORD(0) after last ifd */
-
-      // gather offsets and sizes of thumbnail image data to relocate.
-      // update offsets to point to relocated data.
-      ExifTag* tag_offset;
-      ExifTag* tag_size;
-      QVector<QPair<uint32_t, uint32_t>> image_data;
-      if ((tag_offset = exif_find_tag(app, IFD1, IFD1_TAG_JPEG_OFFS))) {
-        // IFD1_TAG_COMPRESSION should be 6 indicating JPEG compressed image data.
-        tag_size = exif_find_tag(app, IFD1, IFD1_TAG_JPEG_SIZE);
-        if (tag_size == nullptr) {
-          fatal(MYNAME ": Invalid image file, in IFD1 both JPEGInterchangeFormat and JPEGInterchangeFormatLength must exist for compressed thumbnails.");
-        }
-        auto offset = tag_offset->data.at(0).value<uint32_t>();
-        auto size = tag_size->data.at(0).value<uint32_t>();
-        image_data.append(QPair<uint32_t, uint32_t>(offset, size));
-        exif_put_long(IFD1, IFD1_TAG_JPEG_OFFS, 0, len);
-        len += size;
-      } else if ((tag_offset = exif_find_tag(app, IFD1, IFD1_TAG_STRIP_OFFS))) {
-        // IFD1_TAG_COMPRESSION should be 1 indicating uncompressed image data.
-        tag_size = exif_find_tag(app, IFD1, IFD1_TAG_STRIP_BYTE_COUNTS);
-        if ((tag_size == nullptr) || (tag_size->count != tag_offset->count)) {
-          fatal(MYNAME ": Invalid image file, in IFD1 both StripOffsets and StripByteCounts must exist and have equal counts for uncompressed thumbnails.");
-        }
-        for (unsigned idx = 0; idx < tag_offset->count; idx++) {
-          auto offset = tag_offset->data.at(idx).value<uint32_t>();
-          auto size = tag_size->data.at(idx).value<uint32_t>();
-          image_data.append(QPair<uint32_t, uint32_t>(offset, size));
-          if (tag_offset->type == EXIF_TYPE_SHORT) {
-            exif_put_short(IFD1, IFD1_TAG_STRIP_OFFS, idx, len);
-          } else {
-            exif_put_long(IFD1, IFD1_TAG_STRIP_OFFS, idx, len);
-          }
-          len += size;
-        }
-      }
+  for (auto& ifd_instance : app->ifds) {
+    ExifIfd* ifd = &ifd_instance;
+    std::sort(ifd->tags.begin(), ifd->tags.end(), exif_sort_tags_cb);
+  }
 
-      for (auto& ifd_instance : app->ifds) {
-        ExifIfd* ifd = &ifd_instance;
-        std::sort(ifd->tags.begin(), ifd->tags.end(), exif_sort_tags_cb);
-      }
+  gbfile* ftmp = gbfopen_be(nullptr, "wb", MYNAME);
+  ftmp->big_endian = app->fcache->big_endian;
 
-      gbfile* ftmp = gbfopen_be(nullptr, "wb", MYNAME);
-      ftmp->big_endian = app->fcache->big_endian;
+  gbfwrite((ftmp->big_endian) ? "MM" : "II", 2, 1, ftmp);
+  gbfputuint16(0x2A, ftmp);
+  gbfputuint32(0x08, ftmp); /* offset to first IFD */
 
-      gbfwrite((ftmp->big_endian) ? "MM" : "II", 2, 1, ftmp);
-      gbfputuint16(0x2A, ftmp);
-      gbfputuint32(0x08, ftmp); /* offset to first IFD */
+  for (int i = 0; i < app->ifds.size(); ++i) {
+    ExifIfd* ifd = &app->ifds[i];
 
-      for (int i = 0; i < app->ifds.size(); ++i) {
-        ExifIfd* ifd = &app->ifds[i];
+    char next = ((ifd->nr == IFD0) && ((i + 1) < app->ifds.size()) && (app->ifds[i+1].nr == IFD1));
 
-        char next = ((ifd->nr == IFD0) && ((i + 1) < app->ifds.size()) && (app->ifds[i+1].nr == IFD1));
+    exif_write_ifd(ifd, next, ftmp);
+  }
 
-        exif_write_ifd(ifd, next, ftmp);
-      }
+  gbfputuint32(0, ftmp); /* DWORD(0) after last ifd */
 
-      gbfputuint32(0, ftmp); /* DWORD(0) after last ifd */
+  // relocate thumbnail image data.
+  for (const auto& segment : image_data) {
+    gbfseek(app->fexif, segment.first, SEEK_SET);
+    gbfcopyfrom(ftmp, app->fexif, segment.second);
+  }
 
-      // relocate thumbnail image data.
-      for (const auto& segment : image_data) {
-        gbfseek(app->fexif, segment.first, SEEK_SET);
-        gbfcopyfrom(ftmp, app->fexif, segment.second);
-      }
+  len = gbftell(ftmp);
+  gbfrewind(ftmp);
+  QByteArray tiff(len, '\0');
+  gbfread(tiff.data(), len, 1, ftmp);
 
-      len = gbftell(ftmp);
-      gbfrewind(ftmp);
-      gbfputuint16(len + 8, fout_);
-      gbfwrite("Exif\0\0", 6, 1, fout_);
-      gbfcopyfrom(fout_, ftmp, len);
+  gbfclose(ftmp);
+  return tiff;
+}
+
+/*
+ * Write the new tags straight into the original file when they fit into
+ * the space of its Exif segment, which is then padded with zeros.  Nothing
+ * else in the file moves, so only the segment itself is rewritten.
+ * Returns false, leaving the file alone, if the tags do not fit or the
+ * segment is not where it was read from.
+ */
+bool
+ExifFormat::exif_patch_app(const QByteArray& tiff) const
+{
+  const qint64 room = static_cast<qint64>(exif_app_->len) - 8;
+  if (tiff.size() > room) {
+    return false;
+  }
+
+  QFile file(exif_fout_name);
+  if (!file.open(QIODevice::ReadWrite) || !file.seek(exif_app_->offs)) {
+    return false;
+  }
+  const QByteArray header = file.read(10);
+  const QByteArray expected = QByteArray("\xFF\xE1", 2) +
+                              static_cast<char>(exif_app_->len >> 8) +
+                              static_cast<char>(exif_app_->len & 0xFF) +
+                              QByteArray("Exif\0\0", 6);
+  if (header != expected) {
+    return false;
+  }
+
+  if ((file.write(tiff) != tiff.size()) ||
+      (file.write(QByteArray(room - tiff.size(), '\0')) != room - tiff.size())) {
+    fatal(MYNAME ": Error updating \"%s\" in place: %s\n",
+          qPrintable(exif_fout_name), qPrintable(file.errorString()));
+  }
+  if (global_opts.debug_level >= 3) {
+    printf(MYNAME ": patched %lld of %lld bytes in place\n",
+           static_cast<long long>(tiff.size()), static_cast<long long>(room));
+  }
+  return true;
+}
+
+void
+ExifFormat::exif_write_apps(const QByteArray& tiff) const
+{
+  gbfputuint16(0xFFD8, fout_);
+
+  for (auto* app : std::as_const(*exif_apps)) {
+
+    gbfputuint16(app->marker, fout_);
 
-      gbfclose(ftmp);
+    if (app == exif_app_) {
+      gbfputuint16(tiff.size() + 8, fout_);
+      gbfwrite("Exif\0\0", 6, 1, fout_);
+      gbfwrite(tiff.constData(), tiff.size(), 1, fout_);
     } else {
       gbfputuint16(app->len, fout_);
       gbfrewind(app->fcache);
-      gbfcopyfrom(fout_, app->fcache, 0x7FFFFFFF);
+      gbfcopyfrom(fout_, app->fcache, kCopyAll);
     }
   }
 }
@@ -1440,7 +1643,7 @@ ExifFormat::read()
     fatal(MYNAME ": Unknown image file.");
   }
 
-  exif_app_ = exif_load_apps();
+  exif_app_ = exif_load_apps(true);
   if (exif_app_ == nullptr) {
     fatal(MYNAME ": No EXIF header in source file \"%s\".", fin_->name);
   }
@@ -1455,6 +1658,11 @@ ExifFormat::read()
 void
 ExifFormat::wr_init(const QString& fname)
 {
+  exif_batch = exif_batch_images(fname);
+  if (!exif_batch.isEmpty()) {
+    return;
+  }
+
   exif_success = 0;
   exif_fout_name = fname;
 
@@ -1469,38 +1677,51 @@ ExifFormat::wr_init(const QString& fname)
   if (soi != 0xFFD8) {
     fatal(MYNAME ": Unknown image file.");
   }
-  exif_app_ = exif_load_apps();
+  exif_app_ = exif_load_apps(false);
   if (exif_app_ == nullptr) {
     fatal(MYNAME ": No EXIF header found in source file \"%s\".", fin_->name);
   }
   exif_examine_app(exif_app_);
   gbfclose(fin_);
+  fin_ = nullptr;
 
   exif_time_ref = exif_get_exif_time(exif_app_);
   if (!exif_time_ref.isValid()) {
     fatal(MYNAME ": No valid timestamp found in picture!\n");
   }
 
-  QString filename(fname);
-  filename += ".jpg";
-  fout_ = gbfopen_be(filename, "wb", MYNAME);
+  // When overwriting the image is patched in place if the new tags fit,
+  // so the copy is only opened once it turns out to be needed.
+  fout_ = nullptr;
+  if (*opt_overwrite != '1') {
+    QString filename(fname);
+    filename += ".jpg";
+    fout_ = gbfopen_be(filename, "wb", MYNAME);
+  }
 }
 
 void
 ExifFormat::wr_deinit()
 {
+  if (!exif_batch.isEmpty()) {
+    exif_batch.clear();
+    return;
+  }
 
   exif_release_apps();
-  QString tmpname = QString(fout_->name);
-  gbfclose(fout_);
-
-  if (exif_success) {
-    if (*opt_overwrite == '1') {
-      QFile::remove(exif_fout_name);
-      QFile::rename(tmpname, exif_fout_name);
+  if (fout_ != nullptr) {
+    QString tmpname = QString(fout_->name);
+    gbfclose(fout_);
+    fout_ = nullptr;
+
+    if (exif_success) {
+      if (*opt_overwrite == '1') {
+        QFile::remove(exif_fout_name);
+        QFile::rename(tmpname, exif_fout_name);
+      }
+    } else {
+      QFile::remove(tmpname);
     }
-  } else {
-    QFile::remove(tmpname);
   }
 
   exif_fout_name.clear();
@@ -1509,22 +1730,15 @@ ExifFormat::wr_deinit()
 void
 ExifFormat::write()
 {
+  if (!exif_batch.isEmpty()) {
+    exif_write_batch();
+    return;
+  }
+
   exif_wpt_ref = nullptr;
 
   if (opt_name) {
-    auto exif_find_wpt_by_name_lambda = [this](const Waypoint* waypointp)->void {
-      exif_find_wpt_by_name(waypointp);
-    };
-    waypt_disp_all(exif_find_wpt_by_name_lambda);
-    if (exif_wpt_ref == nullptr) {
-      route_disp_all(nullptr, nullptr, exif_find_wpt_by_name_lambda);
-    }
-    if (exif_wpt_ref == nullptr) {
-      track_disp_all(nullptr, nullptr, exif_find_wpt_by_name_lambda);
-    }
-    if (exif_wpt_ref == nullptr) {
-      warning(MYNAME ": No matching point with name \"%s\" found.\n", opt_name);
-    }
+    exif_find_named_wpt();
   } else {
     auto exif_find_wpt_by_time_lambda = [this](const Waypoint* waypointp)->void {
       exif_find_wpt_by_time(waypointp);
@@ -1533,91 +1747,176 @@ ExifFormat::write()
     route_disp_all(nullptr, nullptr, exif_find_wpt_by_time_lambda);
     waypt_disp_all(exif_find_wpt_by_time_lambda);
 
-    qint64 frame = xstrtoi(opt_frame, nullptr, 10);
+    exif_wpt_ref = exif_check_frame(exif_time_ref, exif_wpt_ref);
+  }
 
+  if (exif_wpt_ref != nullptr) {
+    exif_tag_image(exif_wpt_ref);
+  }
+}
+
+/*
+ * Tag each image of the batch with the named point or the point closest
+ * to its time, on as many threads as asked for.  Every image gets a
+ * writer of its own, which does just what it would do for that image
+ * alone, except for looking its point up in one shared time index.
+ */
+void
+ExifFormat::exif_write_batch()
+{
+  const Waypoint* named = nullptr;
+  ExifTimeIndex index;
+  if (opt_name) {
+    exif_wpt_ref = nullptr;
+    exif_find_named_wpt();
     if (exif_wpt_ref == nullptr) {
-      warning(MYNAME ": No point with a valid timestamp found.\n");
-    } else if (std::abs(exif_time_ref.secsTo(exif_wpt_ref->creation_time)) > frame) {
-      QString time_str = exif_time_str(exif_time_ref);
-      warning(MYNAME ": No matching point found for image date %s!\n", qPrintable(time_str));
-      if (exif_wpt_ref != nullptr) {
-        QString str = exif_time_str(exif_wpt_ref->creation_time);
-        warning(MYNAME ": Best is from %s, %lld second(s) away.\n",
-                qPrintable(str), std::abs(exif_time_ref.secsTo(exif_wpt_ref->creation_time)));
-      }
-      exif_wpt_ref = nullptr;
+      return;
     }
+    named = exif_wpt_ref;
+  } else {
+    index = exif_build_time_index();
   }
 
-  if (exif_wpt_ref != nullptr) {
-    const Waypoint* wpt = exif_wpt_ref;
-
-    exif_put_long(IFD0, IFD0_TAG_GPS_IFD_OFFS, 0, 0);
-    exif_put_value(GPS_IFD, GPS_IFD_TAG_VERSION, EXIF_TYPE_BYTE, 4, 0, writer_gps_tag_version);
-    exif_put_str(GPS_IFD, GPS_IFD_TAG_DATUM, "WGS-84");
+  std::vector<std::unique_ptr<ExifFormat>> taggers;
+  for (int i = 0; i < exif_batch.size(); ++i) {
+    auto tagger = std::make_unique<ExifFormat>();
+    for (int j = 0; j < exif_args.size(); ++j) {
+      *tagger->exif_args.at(j).argval = *exif_args.at(j).argval;
+    }
+    tagger->opt_list = nullptr;
+    taggers.push_back(std::move(tagger));
+  }
+
+  const session_t* session = curr_session();
+  std::atomic<int> failed{0};
+  // One task for each thread asked for, each tagging its share of the images.
+  const qsizetype count = exif_batch.size();
+  const int threads = std::max(1, (opt_threads != nullptr) ? xstrtoi(opt_threads, nullptr, 10) : 1);
+  gpsbabel::parallel_for(count, (count + threads - 1) / threads,
+  [this, &taggers, named, &index, session, &failed](qsizetype begin, qsizetype end) {
+    const ThreadScope scope;
+    use_session(session);
+    fatal_set_throws(true);
+    for (qsizetype i = begin; i < end; ++i) {
+      ExifFormat* tagger = taggers.at(i).get();
+      try {
+        tagger->wr_init(exif_batch.at(i));
+        const Waypoint* wpt = (named != nullptr) ? named :
+                              tagger->exif_check_frame(tagger->exif_time_ref,
+                                  exif_nearest_wpt(index, tagger->exif_time_ref));
+        if (wpt != nullptr) {
+          tagger->exif_tag_image(wpt);
+        }
+        tagger->wr_deinit();
+      } catch (const FatalError&) {
+        // The message has been logged already, go on with the other images.
+        tagger->exif_abandon();
+        ++failed;
+      }
+    }
+  });
 
-    exif_put_str(GPS_IFD, GPS_IFD_TAG_LATREF, wpt->latitude < 0 ? "S" : "N");
-    exif_put_coord(GPS_IFD, GPS_IFD_TAG_LAT, fabs(wpt->latitude));
-    exif_put_str(GPS_IFD, GPS_IFD_TAG_LONREF, wpt->longitude < 0 ? "W" : "E");
-    exif_put_coord(GPS_IFD, GPS_IFD_TAG_LON, fabs(wpt->longitude));
+  if (failed > 0) {
+    warning(MYNAME ": %d of %d images could not be tagged.\n", failed.load(), static_cast<int>(exif_batch.size()));
+  }
+}
 
-    if (wpt->altitude == unknown_alt) {
-      exif_remove_tag(GPS_IFD, GPS_IFD_TAG_ALT);
-      exif_remove_tag(GPS_IFD, GPS_IFD_TAG_ALTREF);
-    } else {
-      uint8_t alt_ref = (wpt->altitude >= 0.0) ? 0 : 1;
-      exif_put_value(GPS_IFD, GPS_IFD_TAG_ALTREF, EXIF_TYPE_BYTE, 1, 0, &alt_ref);
-      exif_put_double(GPS_IFD, GPS_IFD_TAG_ALT, 0, fabs(wpt->altitude));
-    }
+/*
+ * Let go of what a writer that failed part way through has open, and of
+ * the copy of the image it may have begun.
+ */
+void
+ExifFormat::exif_abandon()
+{
+  if (fin_ != nullptr) {
+    gbfclose(fin_);
+    fin_ = nullptr;
+  }
+  if (exif_apps != nullptr) {
+    exif_release_apps();
+  }
+  if (fout_ != nullptr) {
+    QString tmpname = QString(fout_->name);
+    gbfclose(fout_);
+    fout_ = nullptr;
+    QFile::remove(tmpname);
+  }
+  exif_fout_name.clear();
+}
 
-    if (wpt->creation_time.isValid()) {
-      const QDateTime dt = wpt->GetCreationTime().toUTC();
+void
+ExifFormat::exif_tag_image(const Waypoint* wpt)
+{
+  exif_put_long(IFD0, IFD0_TAG_GPS_IFD_OFFS, 0, 0);
+  exif_put_value(GPS_IFD, GPS_IFD_TAG_VERSION, EXIF_TYPE_BYTE, 4, 0, writer_gps_tag_version);
+  exif_put_str(GPS_IFD, GPS_IFD_TAG_DATUM, "WGS-84");
+
+  exif_put_str(GPS_IFD, GPS_IFD_TAG_LATREF, wpt->latitude < 0 ? "S" : "N");
+  exif_put_coord(GPS_IFD, GPS_IFD_TAG_LAT, fabs(wpt->latitude));
+  exif_put_str(GPS_IFD, GPS_IFD_TAG_LONREF, wpt->longitude < 0 ? "W" : "E");
+  exif_put_coord(GPS_IFD, GPS_IFD_TAG_LON, fabs(wpt->longitude));
+
+  if (wpt->altitude == unknown_alt) {
+    exif_remove_tag(GPS_IFD, GPS_IFD_TAG_ALT);
+    exif_remove_tag(GPS_IFD, GPS_IFD_TAG_ALTREF);
+  } else {
+    uint8_t alt_ref = (wpt->altitude >= 0.0) ? 0 : 1;
+    exif_put_value(GPS_IFD, GPS_IFD_TAG_ALTREF, EXIF_TYPE_BYTE, 1, 0, &alt_ref);
+    exif_put_double(GPS_IFD, GPS_IFD_TAG_ALT, 0, fabs(wpt->altitude));
+  }
 
-      exif_put_double(GPS_IFD, GPS_IFD_TAG_TIMESTAMP, 0, dt.time().hour());
-      exif_put_double(GPS_IFD, GPS_IFD_TAG_TIMESTAMP, 1, dt.time().minute());
-      exif_put_double(GPS_IFD, GPS_IFD_TAG_TIMESTAMP, 2,
-                      static_cast<double>(dt.time().second()) +
-                      static_cast<double>(dt.time().msec())/1000.0);
+  if (wpt->creation_time.isValid()) {
+    const QDateTime dt = wpt->GetCreationTime().toUTC();
 
-      exif_put_str(GPS_IFD, GPS_IFD_TAG_DATESTAMP, CSTR(dt.toString(u"yyyy:MM:dd")));
-    } else {
-      exif_remove_tag(GPS_IFD, GPS_IFD_TAG_TIMESTAMP);
-      exif_remove_tag(GPS_IFD, GPS_IFD_TAG_DATESTAMP);
-    }
+    exif_put_double(GPS_IFD, GPS_IFD_TAG_TIMESTAMP, 0, dt.time().hour());
+    exif_put_double(GPS_IFD, GPS_IFD_TAG_TIMESTAMP, 1, dt.time().minute());
+    exif_put_double(GPS_IFD, GPS_IFD_TAG_TIMESTAMP, 2,
+                    static_cast<double>(dt.time().second()) +
+                    static_cast<double>(dt.time().msec())/1000.0);
 
-    if (wpt->sat > 0) {
-      char buf[16];
-      snprintf(buf, sizeof(buf), "%d", wpt->sat);
-      exif_put_str(GPS_IFD, GPS_IFD_TAG_SAT, buf);
-    } else {
-      exif_remove_tag(GPS_IFD, GPS_IFD_TAG_SAT);
-    }
+    exif_put_str(GPS_IFD, GPS_IFD_TAG_DATESTAMP, CSTR(dt.toString(u"yyyy:MM:dd")));
+  } else {
+    exif_remove_tag(GPS_IFD, GPS_IFD_TAG_TIMESTAMP);
+    exif_remove_tag(GPS_IFD, GPS_IFD_TAG_DATESTAMP);
+  }
 
-    if (wpt->fix == fix_2d) {
-      exif_put_str(GPS_IFD, GPS_IFD_TAG_MODE, "2");
-    } else if (wpt->fix == fix_3d) {
-      exif_put_str(GPS_IFD, GPS_IFD_TAG_MODE, "3");
-    } else {
-      exif_remove_tag(GPS_IFD, GPS_IFD_TAG_MODE);
-    }
+  if (wpt->sat > 0) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%d", wpt->sat);
+    exif_put_str(GPS_IFD, GPS_IFD_TAG_SAT, buf);
+  } else {
+    exif_remove_tag(GPS_IFD, GPS_IFD_TAG_SAT);
+  }
 
-    if (wpt->hdop > 0) {
-      exif_put_double(GPS_IFD, GPS_IFD_TAG_DOP, 0, wpt->hdop);
-    } else {
-      exif_remove_tag(GPS_IFD, GPS_IFD_TAG_DOP);
-    }
+  if (wpt->fix == fix_2d) {
+    exif_put_str(GPS_IFD, GPS_IFD_TAG_MODE, "2");
+  } else if (wpt->fix == fix_3d) {
+    exif_put_str(GPS_IFD, GPS_IFD_TAG_MODE, "3");
+  } else {
+    exif_remove_tag(GPS_IFD, GPS_IFD_TAG_MODE);
+  }
 
-    if (wpt->speed_has_value()) {
-      exif_put_str(GPS_IFD, GPS_IFD_TAG_SPEEDREF, "K");
-      exif_put_double(GPS_IFD, GPS_IFD_TAG_SPEED, 0, MPS_TO_KPH(wpt->speed_value()));
-    } else {
-      exif_remove_tag(GPS_IFD, GPS_IFD_TAG_SPEEDREF);
-      exif_remove_tag(GPS_IFD, GPS_IFD_TAG_SPEED);
-    }
+  if (wpt->hdop > 0) {
+    exif_put_double(GPS_IFD, GPS_IFD_TAG_DOP, 0, wpt->hdop);
+  } else {
+    exif_remove_tag(GPS_IFD, GPS_IFD_TAG_DOP);
+  }
 
-    exif_write_apps();  /* Success, write the new file */
+  if (wpt->speed_has_value()) {
+    exif_put_str(GPS_IFD, GPS_IFD_TAG_SPEEDREF, "K");
+    exif_put_double(GPS_IFD, GPS_IFD_TAG_SPEED, 0, MPS_TO_KPH(wpt->speed_value()));
+  } else {
+    exif_remove_tag(GPS_IFD, GPS_IFD_TAG_SPEEDREF);
+    exif_remove_tag(GPS_IFD, GPS_IFD_TAG_SPEED);
+  }
 
-    exif_success = 1;
+  const QByteArray tiff = exif_build_tiff(exif_app_);
+  if ((*opt_overwrite != '1') || !exif_patch_app(tiff)) {
+    if (fout_ == nullptr) {
+      fout_ = gbfopen_be(exif_fout_name + ".jpg", "wb", MYNAME);
+    }
+    exif_write_apps(tiff);  /* Success, write the new file */
   }
 
+  exif_success = 1;
 }
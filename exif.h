@@ -40,15 +40,18 @@
 #include <QDateTime>  // for QDateTime
 #include <QList>      // for QList
 #include <QString>    // for QString
+#include <QStringList>  // for QStringList
 #include <QTime>      // for QTime
 #include <QVariant>   // for QVariant
 #include <QVector>    // for QVector
+#include <QtGlobal>   // for qint64
 
-#include <cstdint>    // for uint32_t, uint16_t, uint8_t, int16_t, int32_t
+#include <cstdint>    // for uint32_t, uint16_t, uint8_t, int16_t, int32_t, INT64_MAX
+#include <vector>     // for vector
 
 #include "defs.h"     // for arglist_t, ff_cap, Waypoint, ARG_NOMINMAX, ARGTYPE_BOOL, ff_cap_none, ARGTYPE_INT, ARGTYPE_STRING, ff_cap_read, ff_cap_write, ff_type, ff_type_file
 #include "format.h"   // for Format
-#include "gbfile.h"   // for gbfile, gbsize_t
+#include "gbfile.h"   // for gbfile, gbsize_t, gboff_t
 
 
 class ExifFormat : public Format
@@ -131,11 +134,21 @@ private:
   struct ExifApp {
     uint16_t marker{0};
     gbsize_t len{0};
+    gboff_t offs{0};          // file offset of the marker
     gbfile* fcache{nullptr};
     gbfile* fexif{nullptr};
     QList<ExifIfd> ifds;
   };
 
+  /* A point with a timestamp, in the order the points are visited */
+  struct ExifTimePoint {
+    qint64 msecs;
+    int seq;
+    const Waypoint* wpt;
+  };
+
+  using ExifTimeIndex = std::vector<ExifTimePoint>;
+
   template <class T>
   class Rational
   {
@@ -150,6 +163,8 @@ private:
   /* Constants */
 
   static constexpr uint8_t writer_gps_tag_version[4] = {2, 0, 0, 0};
+  /* Copy all that is left of a stream with gbfcopyfrom. */
+  static constexpr gboff_t kCopyAll = INT64_MAX;
 
   /* Member Functions */
 
@@ -163,7 +178,7 @@ private:
   static QDate exif_read_datestamp(const ExifTag* tag);
   void exif_release_apps();
   static uint32_t exif_ifd_size(ExifIfd* ifd);
-  ExifApp* exif_load_apps();
+  ExifApp* exif_load_apps(bool headers_only);
 #ifndef NDEBUG
   static void exif_validate_tag_structure(const ExifTag* tag);
 #endif
@@ -184,11 +199,21 @@ private:
   void exif_remove_tag(int ifd_nr, int tag_id) const;
   void exif_find_wpt_by_time(const Waypoint* wpt);
   void exif_find_wpt_by_name(const Waypoint* wpt);
+  void exif_find_named_wpt();
+  const Waypoint* exif_check_frame(const QDateTime& time, const Waypoint* wpt) const;
+  static ExifTimeIndex exif_build_time_index();
+  static const Waypoint* exif_nearest_wpt(const ExifTimeIndex& index, const QDateTime& time);
+  QStringList exif_batch_images(const QString& fname) const;
+  void exif_tag_image(const Waypoint* wpt);
+  void exif_write_batch();
+  void exif_abandon();
   static bool exif_sort_tags_cb(const ExifTag& A, const ExifTag& B);
   static bool exif_sort_ifds_cb(const ExifIfd& A, const ExifIfd& B);
   static void exif_write_value(ExifTag* tag, gbfile* fout);
   static void exif_write_ifd(ExifIfd* ifd, char next, gbfile* fout);
-  void exif_write_apps() const;
+  QByteArray exif_build_tiff(ExifApp* app) const;
+  bool exif_patch_app(const QByteArray& tiff) const;
+  void exif_write_apps(const QByteArray& tiff) const;
 
   /* Data Members */
 
@@ -200,12 +225,15 @@ private:
   QDateTime exif_time_ref;
   char exif_success{};
   QString exif_fout_name;
+  QStringList exif_batch;	// images to tag, when writing several
 
   char* opt_filename{};
   char* opt_overwrite{};
   char* opt_frame{};
   char* opt_name{};
   char* opt_offsettime{};
+  char* opt_list{};
+  char* opt_threads{};
 
   QVector<arglist_t> exif_args = {
     { "filename", &opt_filename, "Set waypoint name to source filename", "Y", ARGTYPE_BOOL, ARG_NOMINMAX, nullptr },
@@ -213,6 +241,8 @@ private:
     { "name", &opt_name, "Locate waypoint for tagging by this name", nullptr, ARGTYPE_STRING, ARG_NOMINMAX, nullptr },
     { "overwrite", &opt_overwrite, "!OVERWRITE! the original file. Default=N", "N", ARGTYPE_BOOL, ARG_NOMINMAX, nullptr },
     { "offset", &opt_offsettime, "Image Offset Time (+HH:MM or -HH:MM)", nullptr, ARGTYPE_STRING, ARG_NOMINMAX, nullptr },
+    { "list", &opt_list, "Tag the images listed in the output file", nullptr, ARGTYPE_BOOL, ARG_NOMINMAX, nullptr },
+    { "threads", &opt_threads, "Tag several images on this many threads", nullptr, ARGTYPE_INT, "1", nullptr, nullptr },
   };
 };
 #endif // EXIF_H_INCLUDED_
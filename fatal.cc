@@ -20,18 +20,37 @@
  */
 
 #include <cstdarg>             // for va_end, va_list, va_start
-#include <cstdio>              // for vfprintf, stderr, fflush, fprintf, stdout
+#include <cstdio>              // for vfprintf, stderr, fflush, fprintf, fputs, stdout
 #include <cstdlib>             // for exit
 
+#include <QString>             // for QString
+
 #include "defs.h"              // for Fatal, debug_print, fatal, warning
-#include "src/core/logging.h"  // for FatalMsg
+#include "src/core/logging.h"  // for FatalMsg, FatalError
+
+
+static thread_local bool thread_throws = false;
 
+void
+fatal_set_throws(bool throws)
+{
+  thread_throws = throws;
+}
+
+bool
+fatal_throws()
+{
+  return thread_throws;
+}
 
 [[noreturn]] void fatal(QDebug& msginstance)
 {
   auto* myinstance = new FatalMsg;
   myinstance->swap(msginstance);
   delete myinstance;
+  if (thread_throws) {
+    throw FatalError("fatal error, see the log for details");
+  }
   exit(1);
 }
 
@@ -43,6 +62,12 @@ fatal(const char* fmt, ...)
 
   va_list ap;
   va_start(ap, fmt);
+  if (thread_throws) {
+    const QString msg = QString::vasprintf(fmt, ap);
+    va_end(ap);
+    fputs(msg.toLocal8Bit().constData(), stderr);
+    throw FatalError(msg.trimmed().toStdString());
+  }
   vfprintf(stderr, fmt, ap);
   va_end(ap);
   exit(1);
@@ -0,0 +1,81 @@
+/*
+    Filter Base Class
+
+    Copyright (C) 2026 Robert Lipe, robertlipe+source@gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "filter.h"
+
+#include <utility>                // for as_const
+
+#include <QList>                  // for QList
+
+#include "defs.h"                 // for route_head, route_disp_all, track_disp_all
+#include "src/core/scheduler.h"   // for TaskGroup
+
+
+void Filter::process_routes()
+{
+  struct Job {
+    route_head* rte;
+    bool is_track;
+    bool run;
+  };
+
+  QList<Job> jobs;
+  auto route_lambda = [&jobs](const route_head* rte)->void {
+    jobs.append({const_cast<route_head*>(rte), false, false});
+  };
+  auto track_lambda = [&jobs](const route_head* rte)->void {
+    jobs.append({const_cast<route_head*>(rte), true, false});
+  };
+  route_disp_all(route_lambda, nullptr, nullptr);
+  track_disp_all(track_lambda, nullptr, nullptr);
+
+  int runs = 0;
+  for (Job& job : jobs) {
+    job.run = prepare_route(job.rte, job.is_track);
+    if (job.run) {
+      ++runs;
+    }
+  }
+
+  const int threads = route_threads();
+  if ((threads > 1) && (runs > 1)) {
+    // Each route is a task of its own, so a long one doesn't hold up
+    // the others.
+    gpsbabel::TaskGroup group;
+    for (const Job& job : std::as_const(jobs)) {
+      if (job.run) {
+        group.run([this, job]() {
+          process_route(job.rte, job.is_track);
+        });
+      }
+    }
+    group.wait();
+  } else {
+    for (const Job& job : std::as_const(jobs)) {
+      if (job.run) {
+        process_route(job.rte, job.is_track);
+      }
+    }
+  }
+
+  for (const Job& job : std::as_const(jobs)) {
+    finish_route(job.rte, job.is_track);
+  }
+}
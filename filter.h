@@ -24,7 +24,7 @@
 
 // Filter have access to the global_waypoint_list, which formats really
 // shouldn't have.
-extern WaypointList* global_waypoint_list;
+extern thread_local WaypointList* global_waypoint_list;
 
 class Filter
 {
@@ -45,6 +45,15 @@ public:
 
   virtual QVector<arglist_t>* get_args() = 0;
 
+  /*
+   * The wpt_fields the filter looks at, see Format::wr_fields().  The
+   * filter only passes the others on, so most use none.
+   */
+  virtual unsigned int fields() const
+  {
+    return wpt_field_none;
+  }
+
   virtual void init()
   {
     /* Called before filter processing */
@@ -63,6 +72,53 @@ public:
 // track_disp_all(head, tail, trkpt);
 //}
 
+  /*
+   * Filters that change each waypoint, route point and track point on
+   * its own, without adding, deleting or looking at any other point,
+   * may return true here and do that work in process_point().  A run
+   * of such filters on the command line is then applied in a single
+   * pass over the data instead of calling process() on each of them.
+   */
+  virtual bool can_process_points() const
+  {
+    return false;
+  }
+
+  virtual void process_point(Waypoint* /* wpt */)
+  {
+  }
+
+  /*
+   * Filters whose work on a route or track only depends on that route
+   * or track may implement process() by calling process_routes(), which
+   * visits every route and then every track in three passes:
+   * prepare_route() on each of them in list order, process_route() on
+   * those it returned true for, as tasks of the scheduler if
+   * route_threads() is more than one, and finish_route() on each of
+   * them in list order again.
+   * process_route() may change its own route's points and whatever the
+   * filter set aside for that route in prepare_route(), but must not add
+   * or delete points, report errors or touch anything else; that is left
+   * to the other two, which run on the calling thread.
+   */
+  virtual int route_threads() const
+  {
+    return 1;
+  }
+
+  virtual bool prepare_route(route_head* /* rte */, bool /* is_track */)
+  {
+    return true;
+  }
+
+  virtual void process_route(route_head* /* rte */, bool /* is_track */)
+  {
+  }
+
+  virtual void finish_route(route_head* /* rte */, bool /* is_track */)
+  {
+  }
+
   virtual void deinit()
   {
     /* called after filter processing */
@@ -88,6 +144,8 @@ public:
   }
 
 protected:
+  void process_routes();
+
   template <class MyFilter>
   class RteHdFunctor
   {
@@ -31,6 +31,7 @@
 #include <algorithm>        // for sort
 #include <cassert>          // for assert
 #include <cstdio>           // for printf
+#include <memory>           // for make_shared
 
 #include "arcdist.h"        // for ArcDistanceFilter
 #include "bend.h"           // for BendFilter
@@ -39,6 +40,7 @@
 #include "duplicate.h"      // for DuplicateFilter
 #include "filter.h"         // for Filter
 #include "gbversion.h"      // for WEB_DOC_DIR
+#include "geofence.h"       // for GeofenceFilter
 #include "height.h"         // for HeightFilter
 #include "inifile.h"        // for inifile_readstr
 #include "interpolate.h"    // for InterpolateFilter
@@ -93,6 +95,12 @@ struct FilterVecs::Impl {
       "Remove Duplicates",
       &fltfactory<DuplicateFilter>
     },
+    {
+      nullptr,
+      "geofence",
+      "Classify Points by the Geofences They Are In",
+      &fltfactory<GeofenceFilter>
+    },
     {
       nullptr,
       "interpolate",
@@ -201,40 +209,56 @@ FilterVecs& FilterVecs::Instance()
   return instance;
 }
 
-void FilterVecs::prepare_filter(const fltinfo_t& fltdata)
+/*
+ * The converted value of every argument: the one of the inifile or the
+ * default, overridden by the one given in the options.
+ */
+QVector<QString> FilterVecs::resolve_options(const fltinfo_t& fltdata, const QVector<arglist_t>* args)
 {
-  QVector<arglist_t>* args = fltdata->get_args();
-
   Vecs::validate_options(fltdata.options, args, fltdata.fltname);
 
-  /* step 1: initialize by inifile or default values */
+  QVector<QString> values;
   if (args && !args->isEmpty()) {
-    assert(args->isDetached());
-    for (auto& arg : *args) {
+    values.reserve(args->size());
+    for (const auto& arg : *args) {
+      /* step 1: initialize by inifile or default values */
       QString qtemp = inifile_readstr(global_opts.inifile, fltdata.fltname, arg.argstring);
       if (qtemp.isNull()) {
         qtemp = inifile_readstr(global_opts.inifile, "Common filter settings", arg.argstring);
       }
       if (qtemp.isNull()) {
-        Vecs::assign_option(fltdata.fltname, &arg, arg.defaultvalue);
+        values.append(Vecs::convert_option(fltdata.fltname, &arg, arg.defaultvalue));
       } else {
-        Vecs::assign_option(fltdata.fltname, &arg, qtemp);
+        values.append(Vecs::convert_option(fltdata.fltname, &arg, qtemp));
       }
     }
-  }
 
-  /* step 2: override settings with command-line values */
-  if (!fltdata.options.isEmpty()) {
-    if (args && !args->isEmpty()) {
-      assert(args->isDetached());
-      for (auto& arg : *args) {
+    /* step 2: override settings with command-line values */
+    if (!fltdata.options.isEmpty()) {
+      for (qsizetype i = 0; i < args->size(); ++i) {
+        const arglist_t& arg = args->at(i);
         const QString opt = Vecs::get_option(fltdata.options, arg.argstring);
         if (!opt.isNull()) {
-          Vecs::assign_option(fltdata.fltname, &arg, opt);
+          values[i] = Vecs::convert_option(fltdata.fltname, &arg, opt);
         }
       }
     }
   }
+  return values;
+}
+
+void FilterVecs::prepare_filter(const fltinfo_t& fltdata)
+{
+  QVector<arglist_t>* args = fltdata->get_args();
+
+  const QVector<QString> values = fltdata.resolved_options ?
+                                  *fltdata.resolved_options : resolve_options(fltdata, args);
+  if (args && !args->isEmpty()) {
+    assert(args->isDetached());
+    for (qsizetype i = 0; i < args->size(); ++i) {
+      Vecs::set_option(&(*args)[i], values.at(i));
+    }
+  }
 
   if (global_opts.debug_level >= 1) {
     Vecs::disp_vec_options(fltdata.fltname, args);
@@ -242,6 +266,20 @@ void FilterVecs::prepare_filter(const fltinfo_t& fltdata)
 
 }
 
+/*
+ * Checks, looks up and converts the options of fltdata ahead of time, so
+ * that it can be prepared many times without the cost.  Later changes of
+ * the inifile are not seen.
+ */
+void FilterVecs::compile_filter(fltinfo_t& fltdata)
+{
+  Filter* flt = fltdata.isDynamic() ? fltdata.factory() : fltdata.flt;
+  fltdata.resolved_options = std::make_shared<const QVector<QString>>(resolve_options(fltdata, flt->get_args()));
+  if (fltdata.isDynamic()) {
+    delete flt;
+  }
+}
+
 FilterVecs::fltinfo_t FilterVecs::find_filter_vec(const QString& fltargstring)
 {
   QStringList options = fltargstring.split(',');
@@ -255,7 +293,7 @@ FilterVecs::fltinfo_t FilterVecs::find_filter_vec(const QString& fltargstring)
       continue;
     }
 
-    return {vec.vec, vec.name, options, vec.factory};
+    return {vec.vec, vec.name, options, vec.factory, nullptr};
   }
 
   /*
@@ -22,6 +22,9 @@
 #define FILTER_VECS_H_INCLUDED_
 
 #include <QString>          // for QString
+#include <QVector>          // for QVector
+
+#include <memory>           // for shared_ptr
 
 #include "defs.h"           // for arglist_t
 #include "filter.h"         // for Filter
@@ -53,6 +56,9 @@ public:
     QString fltname;
     QStringList options;
     FilterFactory factory{nullptr};
+    // Set by compile_filter(): the converted value of every option, in
+    // the order of the filter's arguments.
+    std::shared_ptr<const QVector<QString>> resolved_options;
   };
 
   /* Special Member Functions */
@@ -66,6 +72,7 @@ public:
   /* Member Functions */
 
   static void prepare_filter(const fltinfo_t& fltdata);
+  static void compile_filter(fltinfo_t& fltdata);
   fltinfo_t find_filter_vec(const QString& fltargstring);
   static void free_filter_vec(Filter* flt);
   static void init_filter_vec(Filter* flt);
@@ -86,6 +93,9 @@ private:
     QString name;
     QString desc;
     FilterFactory factory{nullptr};
+    // Set by compile_filter(): the converted value of every option, in
+    // the order of the filter's arguments.
+    std::shared_ptr<const QVector<QString>> resolved_options;
   };
 
   /* Special Member Functions */
@@ -98,6 +108,7 @@ private:
   static void disp_help_url(const fl_vecs_t& vec, const arglist_t* arg);
   static void disp_v1(const fl_vecs_t& vec);
   static bool validate_filter_vec(const fl_vecs_t& vec);
+  static QVector<QString> resolve_options(const fltinfo_t& fltdata, const QVector<arglist_t>* args);
 
   /* Data Members */
 
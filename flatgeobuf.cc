@@ -0,0 +1,652 @@
+/*
+    FlatGeobuf output with a packed Hilbert R-tree index.
+
+    Copyright (C) 2026 Robert Lipe, robertlipe+source@gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+/*
+ * See https://flatgeobuf.org/ and its schema files header.fbs and
+ * feature.fbs for the layout written here.
+ */
+
+#include "flatgeobuf.h"
+
+#include <algorithm>           // for max, min, stable_sort
+#include <cmath>               // for floor
+#include <cstring>             // for memcpy
+#include <limits>              // for numeric_limits
+
+#include <QByteArray>          // for QByteArray
+#include <QIODevice>           // for QIODevice, QIODevice::WriteOnly
+#include <QString>             // for QString
+#include <QVector>             // for QVector
+#include <QtEndian>            // for qToLittleEndian
+#include <QtGlobal>            // for quint8, quint16, quint32, quint64, qsizetype
+
+#include "defs.h"              // for Waypoint, route_head, fatal, unknown_alt, waypt_range, route_range, track_range, xstrtoi
+#include "src/core/file.h"     // for File
+
+
+namespace
+{
+
+constexpr char kMagic[8] = {'f', 'g', 'b', 3, 'f', 'g', 'b', 0};
+
+/* Column types of header.fbs */
+constexpr quint8 kColumnString = 11;
+constexpr quint8 kColumnDateTime = 13;
+
+/* Our columns, in the order of the header. */
+enum Column : quint16 {
+  kName,
+  kDescription,
+  kTime
+};
+
+constexpr quint32 kHilbertMax = (1U << 16) - 1;
+
+/*
+ * A minimal FlatBuffers encoder.  Unlike the FlatBuffers library it
+ * writes front to back: a table is written with placeholders for its
+ * references, and every object referred to is written after it and
+ * linked in, so that all offsets point forward, as they have to.
+ */
+class FlatBuffer
+{
+public:
+  /* Types */
+
+  struct Field {
+    int id;
+    int size;           // 1, 2, 4 or 8 bytes
+    quint64 value{0};   // little endian, ignored for references
+    bool reference{false};
+  };
+
+  /* Special Member Functions */
+
+  // A buffer starts with the reference to its root table.
+  FlatBuffer() : buf_(4, '\0') {}
+
+  /* Member Functions */
+
+  static Field ref(int id)
+  {
+    return {id, 4, 0, true};
+  }
+
+  template <typename T>
+  static Field scalar(int id, T value)
+  {
+    const T le = qToLittleEndian(value);
+    quint64 bits = 0;
+    memcpy(&bits, &le, sizeof(T));
+    return {id, static_cast<int>(sizeof(T)), bits, false};
+  }
+
+  /*
+   * Writes a table referred to from the given position and gives the
+   * positions of its fields, in the order given.
+   */
+  QVector<qsizetype> table(qsizetype referrer, const QVector<Field>& fields)
+  {
+    int slots = 0;
+    int alignment = 4;
+    for (const Field& field : fields) {
+      slots = std::max(slots, field.id + 1);
+      alignment = std::max(alignment, field.size);
+    }
+
+    // The vtable, which gives the offsets of the fields in the table.
+    align(2);
+    const qsizetype vtable = buf_.size();
+    buf_.append(4 + 2 * slots, '\0');
+
+    align(alignment);
+    const qsizetype start = buf_.size();
+    link(referrer);
+    put<qint32>(start - vtable);
+
+    // Largest fields first, so they need the least padding.
+    QVector<qsizetype> positions(fields.size());
+    for (int size = 8; size >= 1; size /= 2) {
+      for (int i = 0; i < fields.size(); ++i) {
+        const Field& field = fields.at(i);
+        if (field.size != size) {
+          continue;
+        }
+        align(size);
+        positions[i] = buf_.size();
+        store<quint16>(vtable + 4 + 2 * field.id, buf_.size() - start);
+        buf_.append(reinterpret_cast<const char*>(&field.value), size);
+      }
+    }
+    store<quint16>(vtable, 4 + 2 * slots);
+    store<quint16>(vtable + 2, buf_.size() - start);
+    return positions;
+  }
+
+  void string(qsizetype referrer, const QByteArray& utf8)
+  {
+    align(4);
+    link(referrer);
+    put<quint32>(utf8.size());
+    buf_.append(utf8);
+    buf_.append('\0');
+  }
+
+  template <typename T>
+  void vector(qsizetype referrer, const QVector<T>& values)
+  {
+    // The elements, not the count before them, need to be aligned.
+    align(std::max<int>(4, sizeof(T)), 4);
+    link(referrer);
+    put<quint32>(values.size());
+    for (const T& value : values) {
+      put<T>(value);
+    }
+  }
+
+  void bytes(qsizetype referrer, const QByteArray& data)
+  {
+    align(4);
+    link(referrer);
+    put<quint32>(data.size());
+    buf_.append(data);
+  }
+
+  /* Writes a vector of tables and gives the positions of its elements. */
+  QVector<qsizetype> table_vector(qsizetype referrer, int size)
+  {
+    align(4);
+    link(referrer);
+    put<quint32>(size);
+    QVector<qsizetype> positions(size);
+    for (int i = 0; i < size; ++i) {
+      positions[i] = buf_.size();
+      put<quint32>(0);
+    }
+    return positions;
+  }
+
+  const QByteArray& data()
+  {
+    align(4);
+    return buf_;
+  }
+
+private:
+  /* Member Functions */
+
+  template <typename T>
+  void put(T value)
+  {
+    const T le = qToLittleEndian(value);
+    buf_.append(reinterpret_cast<const char*>(&le), sizeof(T));
+  }
+
+  template <typename T>
+  void store(qsizetype at, T value)
+  {
+    const T le = qToLittleEndian(value);
+    memcpy(buf_.data() + at, &le, sizeof(T));
+  }
+
+  void align(int alignment, int ahead = 0)
+  {
+    while ((buf_.size() + ahead) % alignment != 0) {
+      buf_.append('\0');
+    }
+  }
+
+  /* Points the reference at the given position to the end of the buffer. */
+  void link(qsizetype referrer)
+  {
+    store<quint32>(referrer, buf_.size() - referrer);
+  }
+
+  /* Data Members */
+
+  QByteArray buf_;
+};
+
+/*
+ * The position of (x, y) along a Hilbert curve filling a 2^16 by 2^16
+ * square, as computed by FlatGeobuf's reference implementation, after
+ * "Fast Hilbert curve generation, sorting and range queries" by
+ * rawrunprotected.
+ */
+quint32 hilbert(quint32 x, quint32 y)
+{
+  quint32 a = x ^ y;
+  quint32 b = 0xFFFF ^ a;
+  quint32 c = 0xFFFF ^ (x | y);
+  quint32 d = x & (y ^ 0xFFFF);
+
+  quint32 A = a | (b >> 1);
+  quint32 B = (a >> 1) ^ a;
+  quint32 C = ((c >> 1) ^ (b & (d >> 1))) ^ c;
+  quint32 D = ((a & (c >> 1)) ^ (d >> 1)) ^ d;
+
+  a = A;
+  b = B;
+  c = C;
+  d = D;
+  A = ((a & (a >> 2)) ^ (b & (b >> 2)));
+  B = ((a & (b >> 2)) ^ (b & ((a ^ b) >> 2)));
+  C ^= ((a & (c >> 2)) ^ (b & (d >> 2)));
+  D ^= ((b & (c >> 2)) ^ ((a ^ b) & (d >> 2)));
+
+  a = A;
+  b = B;
+  c = C;
+  d = D;
+  A = ((a & (a >> 4)) ^ (b & (b >> 4)));
+  B = ((a & (b >> 4)) ^ (b & ((a ^ b) >> 4)));
+  C ^= ((a & (c >> 4)) ^ (b & (d >> 4)));
+  D ^= ((b & (c >> 4)) ^ ((a ^ b) & (d >> 4)));
+
+  a = A;
+  b = B;
+  c = C;
+  d = D;
+  C ^= ((a & (c >> 8)) ^ (b & (d >> 8)));
+  D ^= ((b & (c >> 8)) ^ ((a ^ b) & (d >> 8)));
+
+  a = C ^ (C >> 1);
+  b = D ^ (D >> 1);
+
+  quint32 i0 = x ^ y;
+  quint32 i1 = b | (0xFFFF ^ (i0 | a));
+
+  i0 = (i0 | (i0 << 8)) & 0x00FF00FF;
+  i0 = (i0 | (i0 << 4)) & 0x0F0F0F0F;
+  i0 = (i0 | (i0 << 2)) & 0x33333333;
+  i0 = (i0 | (i0 << 1)) & 0x55555555;
+
+  i1 = (i1 | (i1 << 8)) & 0x00FF00FF;
+  i1 = (i1 | (i1 << 4)) & 0x0F0F0F0F;
+  i1 = (i1 | (i1 << 2)) & 0x33333333;
+  i1 = (i1 | (i1 << 1)) & 0x55555555;
+
+  return (i1 << 1) | i0;
+}
+
+/* An index node: its bounding box and where its first child is. */
+struct NodeItem {
+  double min_x{std::numeric_limits<double>::infinity()};
+  double min_y{std::numeric_limits<double>::infinity()};
+  double max_x{-std::numeric_limits<double>::infinity()};
+  double max_y{-std::numeric_limits<double>::infinity()};
+  quint64 offset{0};
+
+  void expand(const NodeItem& other)
+  {
+    min_x = std::min(min_x, other.min_x);
+    min_y = std::min(min_y, other.min_y);
+    max_x = std::max(max_x, other.max_x);
+    max_y = std::max(max_y, other.max_y);
+  }
+};
+
+void put_string_property(QByteArray& properties, quint16 column, const QString& value)
+{
+  const QByteArray utf8 = value.toUtf8();
+  const quint16 le_column = qToLittleEndian(column);
+  const quint32 le_size = qToLittleEndian<quint32>(utf8.size());
+  properties.append(reinterpret_cast<const char*>(&le_column), sizeof(le_column));
+  properties.append(reinterpret_cast<const char*>(&le_size), sizeof(le_size));
+  properties.append(utf8);
+}
+
+} // namespace
+
+void
+FlatgeobufFormat::wr_init(const QString& fname)
+{
+  fname_ = fname;
+  features_.clear();
+  has_z_ = false;
+}
+
+void
+FlatgeobufFormat::add_waypoint(const Waypoint* wpt)
+{
+  Feature feature;
+  feature.wpt = wpt;
+  feature.type = kPoint;
+  feature.min_x = feature.max_x = wpt->longitude;
+  feature.min_y = feature.max_y = wpt->latitude;
+  if (wpt->altitude != unknown_alt) {
+    has_z_ = true;
+  }
+  features_.append(feature);
+}
+
+void
+FlatgeobufFormat::add_line(const route_head* rte, bool is_track)
+{
+  if (rte->rte_waypt_empty()) {
+    return;
+  }
+  Feature feature;
+  feature.rte = rte;
+  feature.type = kLineString;
+  NodeItem box;
+  bool first = true;
+  for (const Waypoint* wpt : rte->waypoint_list) {
+    if (is_track && wpt->wpt_flags.new_trkseg && !first) {
+      feature.type = kMultiLineString;
+    }
+    first = false;
+    box.expand({wpt->longitude, wpt->latitude, wpt->longitude, wpt->latitude});
+    if (wpt->altitude != unknown_alt) {
+      has_z_ = true;
+    }
+  }
+  feature.min_x = box.min_x;
+  feature.min_y = box.min_y;
+  feature.max_x = box.max_x;
+  feature.max_y = box.max_y;
+  features_.append(feature);
+}
+
+QByteArray
+FlatgeobufFormat::encode_feature(const Feature& feature) const
+{
+  QVector<double> xy;
+  QVector<double> z;
+  QVector<quint32> ends;
+  auto add = [this, &xy, &z](const Waypoint* wpt)->void {
+    xy.append(wpt->longitude);
+    xy.append(wpt->latitude);
+    if (has_z_) {
+      z.append((wpt->altitude != unknown_alt) ? wpt->altitude : std::numeric_limits<double>::quiet_NaN());
+    }
+  };
+
+  QByteArray properties;
+  if (feature.wpt != nullptr) {
+    const Waypoint* wpt = feature.wpt;
+    add(wpt);
+    if (!wpt->shortname.isEmpty()) {
+      put_string_property(properties, kName, wpt->shortname);
+    }
+    if (!wpt->description.isEmpty()) {
+      put_string_property(properties, kDescription, wpt->description);
+    }
+    if (wpt->creation_time.isValid()) {
+      put_string_property(properties, kTime, wpt->creation_time.toPrettyString());
+    }
+  } else {
+    const route_head* rte = feature.rte;
+    quint32 count = 0;
+    for (const Waypoint* wpt : rte->waypoint_list) {
+      if ((feature.type == kMultiLineString) && wpt->wpt_flags.new_trkseg && (count > 0)) {
+        ends.append(count);
+      }
+      add(wpt);
+      ++count;
+    }
+    if (feature.type == kMultiLineString) {
+      ends.append(count);
+    }
+    if (!rte->rte_name.isEmpty()) {
+      put_string_property(properties, kName, rte->rte_name);
+    }
+    if (!rte->rte_desc.isEmpty()) {
+      put_string_property(properties, kDescription, rte->rte_desc);
+    }
+  }
+
+  FlatBuffer fb;
+  QVector<FlatBuffer::Field> fields = {FlatBuffer::ref(0)};
+  if (!properties.isEmpty()) {
+    fields.append(FlatBuffer::ref(1));
+  }
+  const QVector<qsizetype> table = fb.table(0, fields);
+
+  QVector<FlatBuffer::Field> geometry_fields = {FlatBuffer::ref(1)};
+  if (!ends.isEmpty()) {
+    geometry_fields.append(FlatBuffer::ref(0));
+  }
+  if (has_z_) {
+    geometry_fields.append(FlatBuffer::ref(2));
+  }
+  geometry_fields.append(FlatBuffer::scalar<quint8>(6, feature.type));
+  const QVector<qsizetype> geometry = fb.table(table.at(0), geometry_fields);
+  fb.vector(geometry.at(0), xy);
+  int next = 1;
+  if (!ends.isEmpty()) {
+    fb.vector(geometry.at(next++), ends);
+  }
+  if (has_z_) {
+    fb.vector(geometry.at(next++), z);
+  }
+
+  if (!properties.isEmpty()) {
+    fb.bytes(table.at(1), properties);
+  }
+  return fb.data();
+}
+
+QByteArray
+FlatgeobufFormat::encode_header(GeometryType type, quint16 node_size) const
+{
+  NodeItem extent;
+  for (const Feature& feature : features_) {
+    extent.expand({feature.min_x, feature.min_y, feature.max_x, feature.max_y});
+  }
+
+  FlatBuffer fb;
+  QVector<FlatBuffer::Field> fields = {
+    FlatBuffer::ref(0),                                     // name
+    FlatBuffer::ref(7),                                     // columns
+    FlatBuffer::ref(10),                                    // crs
+    FlatBuffer::scalar<quint64>(8, features_.size()),       // features_count
+    FlatBuffer::scalar<quint16>(9, node_size),              // index_node_size
+    FlatBuffer::scalar<quint8>(2, type),                    // geometry_type
+    FlatBuffer::scalar<quint8>(3, has_z_)                   // has_z
+  };
+  if (!features_.isEmpty()) {
+    fields.append(FlatBuffer::ref(1));                      // envelope
+  }
+  const QVector<qsizetype> header = fb.table(0, fields);
+  fb.string(header.at(0), QByteArrayLiteral("GPSBabel"));
+
+  const QVector<qsizetype> columns = fb.table_vector(header.at(1), 3);
+  const struct {
+    const char* name;
+    quint8 type;
+  } column_defs[] = {
+    {"name", kColumnString},
+    {"description", kColumnString},
+    {"time", kColumnDateTime}
+  };
+  for (int c = 0; c < 3; ++c) {
+    const QVector<qsizetype> column = fb.table(columns.at(c), {
+      FlatBuffer::ref(0),
+      FlatBuffer::scalar<quint8>(1, column_defs[c].type)
+    });
+    fb.string(column.at(0), column_defs[c].name);
+  }
+
+  const QVector<qsizetype> crs = fb.table(header.at(2), {
+    FlatBuffer::ref(0),
+    FlatBuffer::scalar<qint32>(1, 4326)
+  });
+  fb.string(crs.at(0), QByteArrayLiteral("EPSG"));
+
+  if (!features_.isEmpty()) {
+    fb.vector(header.at(7), QVector<double> {extent.min_x, extent.min_y, extent.max_x, extent.max_y});
+  }
+  return fb.data();
+}
+
+/*
+ * The packed R-tree: the levels from the root down to the leaves, each
+ * node holding the box around its children and the index of the first
+ * of them, and each leaf the box of a feature and its offset among the
+ * features.
+ */
+QByteArray
+FlatgeobufFormat::encode_index(const QVector<quint64>& offsets, quint16 node_size) const
+{
+  // The number of nodes on each level, from the leaves up.
+  QVector<quint64> level_nodes;
+  quint64 n = features_.size();
+  quint64 total = n;
+  level_nodes.append(n);
+  do {
+    n = (n + node_size - 1) / node_size;
+    total += n;
+    level_nodes.append(n);
+  } while (n != 1);
+
+  // Where each level starts and ends, from the leaves up.
+  QVector<quint64> level_begin;
+  quint64 end = total;
+  for (quint64 nodes : std::as_const(level_nodes)) {
+    end -= nodes;
+    level_begin.append(end);
+  }
+
+  QVector<NodeItem> nodes(total);
+  const quint64 leaves = total - features_.size();
+  for (qsizetype i = 0; i < features_.size(); ++i) {
+    const Feature& feature = features_.at(i);
+    nodes[leaves + i] = {feature.min_x, feature.min_y, feature.max_x, feature.max_y, offsets.at(i)};
+  }
+  for (qsizetype level = 0; level < level_nodes.size() - 1; ++level) {
+    quint64 pos = level_begin.at(level);
+    const quint64 level_end = pos + level_nodes.at(level);
+    quint64 parent = level_begin.at(level + 1);
+    while (pos < level_end) {
+      NodeItem node;
+      node.offset = pos;
+      for (quint32 j = 0; (j < node_size) && (pos < level_end); ++j) {
+        node.expand(nodes.at(pos++));
+      }
+      nodes[parent++] = node;
+    }
+  }
+
+  QByteArray index;
+  index.reserve(total * 40);
+  for (const NodeItem& node : std::as_const(nodes)) {
+    for (const double v : {node.min_x, node.min_y, node.max_x, node.max_y}) {
+      const double le = qToLittleEndian(v);
+      index.append(reinterpret_cast<const char*>(&le), sizeof(le));
+    }
+    const quint64 le = qToLittleEndian(node.offset);
+    index.append(reinterpret_cast<const char*>(&le), sizeof(le));
+  }
+  return index;
+}
+
+void
+FlatgeobufFormat::write()
+{
+  const int node_size = xstrtoi(opt_nodesize, nullptr, 10);
+  if (node_size == 1) {
+    fatal("%s: The index node size must be 0 or at least 2.\n", MYNAME);
+  }
+
+  for (const Waypoint* wpt : waypt_range()) {
+    add_waypoint(wpt);
+  }
+  for (const route_head* rte : route_range()) {
+    add_line(rte, false);
+  }
+  for (const route_head* rte : track_range()) {
+    add_line(rte, true);
+  }
+
+  GeometryType type = features_.isEmpty() ? kUnknown : features_.first().type;
+  for (const Feature& feature : std::as_const(features_)) {
+    if (feature.type != type) {
+      type = kUnknown;
+      break;
+    }
+  }
+
+  const bool indexed = (node_size > 0) && !features_.isEmpty();
+  if (indexed) {
+    // Sort as the reference implementation does, by descending Hilbert
+    // value of the centers within the extent of all features.
+    NodeItem extent;
+    for (const Feature& feature : std::as_const(features_)) {
+      extent.expand({feature.min_x, feature.min_y, feature.max_x, feature.max_y});
+    }
+    const double width = extent.max_x - extent.min_x;
+    const double height = extent.max_y - extent.min_y;
+    for (Feature& feature : features_) {
+      quint32 x = 0;
+      quint32 y = 0;
+      if (width != 0) {
+        x = static_cast<quint32>(std::floor(kHilbertMax * ((feature.min_x + feature.max_x) / 2 - extent.min_x) / width));
+      }
+      if (height != 0) {
+        y = static_cast<quint32>(std::floor(kHilbertMax * ((feature.min_y + feature.max_y) / 2 - extent.min_y) / height));
+      }
+      feature.hilbert = hilbert(x, y);
+    }
+    std::stable_sort(features_.begin(), features_.end(), [](const Feature& a, const Feature& b)->bool {
+      return a.hilbert > b.hilbert;
+    });
+  }
+
+  QVector<QByteArray> encoded;
+  encoded.reserve(features_.size());
+  QVector<quint64> offsets;
+  offsets.reserve(features_.size());
+  quint64 offset = 0;
+  for (const Feature& feature : std::as_const(features_)) {
+    encoded.append(encode_feature(feature));
+    offsets.append(offset);
+    offset += 4 + encoded.last().size();
+  }
+
+  gpsbabel::File file(fname_);
+  file.open(QIODevice::WriteOnly);
+  auto put_size = [&file](quint32 size)->void {
+    const quint32 le = qToLittleEndian(size);
+    file.write(reinterpret_cast<const char*>(&le), sizeof(le));
+  };
+  file.write(kMagic, sizeof(kMagic));
+  const QByteArray header = encode_header(type, node_size);
+  put_size(header.size());
+  file.write(header);
+  if (indexed) {
+    file.write(encode_index(offsets, node_size));
+  }
+  for (const QByteArray& feature : std::as_const(encoded)) {
+    put_size(feature.size());
+    if (file.write(feature) != feature.size()) {
+      fatal("%s: Cannot write to \"%s\".\n", MYNAME, qPrintable(fname_));
+    }
+  }
+  file.close();
+}
+
+void
+FlatgeobufFormat::wr_deinit()
+{
+  features_.clear();
+  fname_.clear();
+}
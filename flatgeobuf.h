@@ -0,0 +1,119 @@
+/*
+    FlatGeobuf output with a packed Hilbert R-tree index.
+
+    Copyright (C) 2026 Robert Lipe, robertlipe+source@gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+#ifndef FLATGEOBUF_H_INCLUDED_
+#define FLATGEOBUF_H_INCLUDED_
+
+#include <QByteArray>          // for QByteArray
+#include <QString>             // for QString
+#include <QVector>             // for QVector
+#include <QtGlobal>            // for quint8, quint32, quint64
+
+#include "defs.h"              // for arglist_t, ff_cap, ff_cap_write, ff_type, ff_type_file, ARGTYPE_INT, Waypoint, route_head
+#include "format.h"            // for Format
+
+/*
+ * Every waypoint becomes a Point feature, every route a LineString and
+ * every track a LineString, or a MultiLineString if it has more than
+ * one segment.  Features carry name, description and, for waypoints,
+ * time properties.
+ *
+ * A FlatGeobuf file holds its index ahead of the features, and the
+ * index orders the features by the Hilbert value of their bounding
+ * boxes.  The features are gathered with their boxes in a single pass
+ * over the data, then sorted, encoded and written with the index.
+ */
+class FlatgeobufFormat : public Format
+{
+public:
+  /* Member Functions */
+
+  QVector<arglist_t>* get_args() override
+  {
+    return &flatgeobuf_args;
+  }
+
+  ff_type get_type() const override
+  {
+    return ff_type_file;
+  }
+
+  QVector<ff_cap> get_cap() const override
+  {
+    return {
+      ff_cap_write,  // waypoints
+      ff_cap_write,  // tracks
+      ff_cap_write   // routes
+    };
+  }
+
+  void wr_init(const QString& fname) override;
+  void write() override;
+  void wr_deinit() override;
+
+private:
+  /* Types */
+
+  enum GeometryType : quint8 {
+    kUnknown = 0,
+    kPoint = 1,
+    kLineString = 2,
+    kMultiLineString = 5
+  };
+
+  struct Feature {
+    // Exactly one of them is set.
+    const Waypoint* wpt{nullptr};
+    const route_head* rte{nullptr};
+    GeometryType type{kUnknown};
+    double min_x;
+    double min_y;
+    double max_x;
+    double max_y;
+    quint32 hilbert{0};
+  };
+
+  /* Member Functions */
+
+  void add_waypoint(const Waypoint* wpt);
+  void add_line(const route_head* rte, bool is_track);
+  QByteArray encode_feature(const Feature& feature) const;
+  QByteArray encode_header(GeometryType type, quint16 node_size) const;
+  QByteArray encode_index(const QVector<quint64>& offsets, quint16 node_size) const;
+
+  /* Data Members */
+
+  static constexpr char MYNAME[] = "flatgeobuf";
+
+  char* opt_nodesize{nullptr};
+
+  QVector<arglist_t> flatgeobuf_args = {
+    {
+      "nodesize", &opt_nodesize, "Index node size, 0 for no index",
+      "16", ARGTYPE_INT, "0", "65535", nullptr
+    },
+  };
+
+  QString fname_;
+  QVector<Feature> features_;
+  bool has_z_{false};
+};
+
+#endif // FLATGEOBUF_H_INCLUDED_
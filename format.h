@@ -38,6 +38,9 @@
 #ifndef FORMAT_H_INCLUDED_
 #define FORMAT_H_INCLUDED_
 
+#include <QString>      // for QString
+#include <QStringList>  // for QStringList
+
 #include "defs.h"
 
 
@@ -136,6 +139,16 @@ public:
     fatal("Realtime tracking (-T) is not supported by this input type.\n");
   }
 
+  /*
+   * Realtime tracking from all the inputs given with -f at once, when
+   * there is more than one.  rd_position() then returns the fixes of all
+   * of them as they come.
+   */
+  virtual void rd_position_init_many(const QStringList& /* fnames */)
+  {
+    fatal("Realtime tracking (-T) from several inputs is not supported by this input type.\n");
+  }
+
   virtual Waypoint* rd_position(posn_status* /* status */)
   {
     return nullptr;
@@ -158,6 +171,44 @@ public:
   {
   }
 
+  /*
+   * Streaming (-Z) support.
+   * A reader that can stream adds each waypoint and track point with
+   * waypt_add() or track_add_wpt() once it is complete and never looks at
+   * it again.  A writer that can stream writes each point passed to
+   * wr_position() without rewriting its earlier output.
+   */
+  virtual bool rd_can_stream() const
+  {
+    return false;
+  }
+
+  virtual bool wr_can_stream() const
+  {
+    return false;
+  }
+
+  /*
+   * A dynamic (factory created) reader that returns true keeps all of its
+   * state in the instance, looks at no data but its own and may therefore
+   * read its file on a worker thread while other inputs are being read.
+   */
+  virtual bool rd_can_run_concurrently() const
+  {
+    return false;
+  }
+
+  /*
+   * A writer that returns true only reads the data, keeps all of its state
+   * in the instance and may therefore write on a worker thread while other
+   * outputs are being written.  Of the routes' lazy caches it may only use
+   * extent(), which is built before the writers start.
+   */
+  virtual bool wr_can_run_concurrently() const
+  {
+    return false;
+  }
+
   /*******************************************************************************
   * %%%                          Accessors                                   %%% *
   *******************************************************************************/
@@ -170,6 +221,16 @@ public:
   virtual ff_type get_type() const = 0;
   virtual QVector<ff_cap> get_cap() const = 0;
 
+  /*
+   * The wpt_fields the writer uses.  Readers may leave out those no
+   * output or filter of a run uses, so a writer that returns less than
+   * wpt_field_all must never look at the others.
+   */
+  virtual unsigned int wr_fields() const
+  {
+    return wpt_field_all;
+  }
+
   QString fname;
 
 protected:
@@ -19,40 +19,150 @@
 
  */
 
+#include <cstddef>       // for size_t
+#include <memory>        // for make_unique, unique_ptr
+
 #include <QList>         // for QList
 
 #include "defs.h"
 #include "formspec.h"    // for FormatSpecificData, FsChainAdd, FsChainCopy, FsChainDestroy, FsChainFind
+#include "src/core/counters.h"  // for Counter
+#include "src/core/footprint.h" // for heap_bytes
+
+static gpsbabel::Counter find_counter("fs.chain_find");
+
+FormatSpecificDataList::FormatSpecificDataList(const FormatSpecificDataList& other) :
+  inline_items(other.inline_items),
+  overflow_items(other.overflow_items ? new QList<FormatSpecificData*>(*other.overflow_items) : nullptr),
+  present_types(other.present_types)
+{
+}
+
+FormatSpecificDataList& FormatSpecificDataList::operator=(const FormatSpecificDataList& rhs)
+{
+  if (this != &rhs) {
+    inline_items = rhs.inline_items;
+    overflow_items.reset(rhs.overflow_items ? new QList<FormatSpecificData*>(*rhs.overflow_items) : nullptr);
+    present_types = rhs.present_types;
+  }
+  return *this;
+}
 
 FormatSpecificDataList FormatSpecificDataList::FsChainCopy() const
 {
   FormatSpecificDataList dest;
-  for (const auto* item : *this) {
-    dest.append(item->clone());
+  for (auto* item : inline_items) {
+    if (item == nullptr) {
+      return dest;
+    }
+    dest.FsChainAdd(share(item));
+  }
+  if (overflow_items) {
+    for (auto* item : *overflow_items) {
+      dest.FsChainAdd(share(item));
+    }
   }
   return dest;
 }
 
 void FormatSpecificDataList::FsChainDestroy()
 {
-  while (!isEmpty()) {
-    delete takeFirst();
+  for (auto*& item : inline_items) {
+    if (item != nullptr) {
+      release(item);
+      item = nullptr;
+    }
+  }
+  if (overflow_items) {
+    for (auto* item : *overflow_items) {
+      release(item);
+    }
+    overflow_items.reset();
   }
+  present_types = 0;
 }
 
-FormatSpecificData* FormatSpecificDataList::FsChainFind(FsType type) const
+FormatSpecificData** FormatSpecificDataList::find_slot(FsType type) const
 {
-  for (auto* item : *this) {
+  find_counter.add();
+  if ((present_types & type_bit(type)) == 0) {
+    return nullptr;
+  }
+  // The slots are ours, the const is only that of the lookup.
+  auto& items = const_cast<std::array<FormatSpecificData*, kInlineCount>&>(inline_items);
+  for (auto& item : items) {
+    if (item == nullptr) {
+      return nullptr;
+    }
     if (item->fs_type == type) {
-      return item;
+      return &item;
+    }
+  }
+  if (overflow_items) {
+    for (auto& item : *overflow_items) {
+      if (item->fs_type == type) {
+        return &item;
+      }
     }
   }
   return nullptr;
 }
 
+const FormatSpecificData* FormatSpecificDataList::FsChainFind(FsType type) const
+{
+  FormatSpecificData** slot = find_slot(type);
+  return (slot == nullptr) ? nullptr : *slot;
+}
+
+FormatSpecificData* FormatSpecificDataList::FsChainFind(FsType type)
+{
+  FormatSpecificData** slot = find_slot(type);
+  if (slot == nullptr) {
+    return nullptr;
+  }
+  if ((*slot)->ref.loadRelaxed() > 1) {
+    // Shared with a copy, so make our own before it is changed.
+    FormatSpecificData* own = (*slot)->clone();
+    release(*slot);
+    *slot = own;
+  }
+  return *slot;
+}
+
 void FormatSpecificDataList::FsChainAdd(FormatSpecificData* data)
 {
-  if (data != nullptr) {
-    append(data);
+  if (data == nullptr) {
+    return;
+  }
+
+  present_types |= type_bit(data->fs_type);
+  for (auto*& item : inline_items) {
+    if (item == nullptr) {
+      item = data;
+      return;
+    }
+  }
+  if (!overflow_items) {
+    overflow_items = std::make_unique<QList<FormatSpecificData*>>();
+  }
+  overflow_items->append(data);
+}
+
+// A shared entry is counted in equal parts by the lists that hold it.
+std::size_t FormatSpecificDataList::memory_usage() const
+{
+  std::size_t bytes = 0;
+  for (const auto* item : inline_items) {
+    if (item == nullptr) {
+      return bytes;
+    }
+    bytes += item->memory_usage() / item->ref.loadRelaxed();
+  }
+  if (overflow_items) {
+    bytes += sizeof(*overflow_items) + gpsbabel::heap_bytes(*overflow_items);
+    for (const auto* item : *overflow_items) {
+      bytes += item->memory_usage() / item->ref.loadRelaxed();
+    }
   }
+  return bytes;
 }
@@ -21,6 +21,12 @@
 #ifndef FORMSPEC_H_INCLUDED_
 #define FORMSPEC_H_INCLUDED_
 
+#include <array>         // for array
+#include <cstddef>       // for size_t
+#include <cstdint>       // for uint32_t
+#include <memory>        // for unique_ptr
+
+#include <QAtomicInt>    // for QAtomicInt
 #include <QList>         // for QList
 
 enum FsType {
@@ -34,27 +40,101 @@ enum FsType {
   kFsIGC = 69676308L,     /* IGC format, amendment 8 (2023-02-08) */
 };
 
+/*
+ * Entries are shared between the copies of a list, so one that is in a
+ * list must only be changed through the non-const FsChainFind, which
+ * gives the list its own copy first.
+ */
 struct FormatSpecificData {
   FormatSpecificData() = default;
   explicit FormatSpecificData(FsType type) : fs_type(type) {}
-  FormatSpecificData(const FormatSpecificData&) = default;
-  FormatSpecificData& operator=(const FormatSpecificData&) = default;
+  // A copy, as made by clone(), is not shared yet.
+  FormatSpecificData(const FormatSpecificData& other) : fs_type(other.fs_type) {}
+  FormatSpecificData& operator=(const FormatSpecificData& rhs)
+  {
+    fs_type = rhs.fs_type;
+    return *this;
+  }
   FormatSpecificData(FormatSpecificData&&) = delete;
   FormatSpecificData& operator=(FormatSpecificData&&) = delete;
   virtual ~FormatSpecificData() = default;
 
   virtual FormatSpecificData* clone() const = 0;
+  // The bytes the data takes, including what it holds on the heap.
+  // Subclasses that are larger than this one or hold strings override it.
+  virtual std::size_t memory_usage() const {return sizeof(FormatSpecificData);}
 
   FsType fs_type{kFsUnknown};
+
+private:
+  friend class FormatSpecificDataList;
+
+  // The lists that hold this entry.
+  mutable QAtomicInt ref{1};
 };
 
-class FormatSpecificDataList : private QList<FormatSpecificData*>
+/*
+ * Most waypoints carry no format specific data and those that do rarely
+ * have more than a couple of entries, so the first entries are stored
+ * inline and only a longer chain spills into a heap allocated list.
+ * A bitmap of the types present lets FsChainFind answer "not present"
+ * without looking at any entries.
+ *
+ * Copying the list copies the pointers, not the data.  FsChainCopy()
+ * makes a list that shares the entries, counting the references, and
+ * the non-const FsChainFind clones a shared entry before handing it out,
+ * so a copied waypoint costs nothing until one of the copies is changed.
+ */
+class FormatSpecificDataList
 {
 public:
+  FormatSpecificDataList() = default;
+  FormatSpecificDataList(const FormatSpecificDataList& other);
+  FormatSpecificDataList& operator=(const FormatSpecificDataList& rhs);
+  FormatSpecificDataList(FormatSpecificDataList&& other) noexcept = default;
+  FormatSpecificDataList& operator=(FormatSpecificDataList&& rhs) noexcept = default;
+  ~FormatSpecificDataList() = default;
+
   FormatSpecificDataList FsChainCopy() const;
   void FsChainDestroy();
-  FormatSpecificData* FsChainFind(FsType type) const;
+  const FormatSpecificData* FsChainFind(FsType type) const;
+  // For changing the entry, which is then no longer shared.
+  FormatSpecificData* FsChainFind(FsType type);
   void FsChainAdd(FormatSpecificData* data);
+  // Whether nothing was ever added, so FsChainFind finds nothing.
+  bool FsChainEmpty() const {return present_types == 0;}
+  // The heap bytes of the entries and of a spilled list.
+  std::size_t memory_usage() const;
+
+private:
+  static constexpr int kInlineCount = 2;
+
+  // Fold the 32 bit type tag down to one of 32 bits.  Distinct types may
+  // share a bit, so a set bit only means the type may be present.
+  static constexpr uint32_t type_bit(FsType type)
+  {
+    auto t = static_cast<uint32_t>(type);
+    t ^= t >> 16;
+    t ^= t >> 8;
+    return uint32_t{1} << (t & 31);
+  }
+
+  static FormatSpecificData* share(FormatSpecificData* data)
+  {
+    data->ref.ref();
+    return data;
+  }
+  static void release(FormatSpecificData* data)
+  {
+    if (!data->ref.deref()) {
+      delete data;
+    }
+  }
+  FormatSpecificData** find_slot(FsType type) const;
+
+  std::array<FormatSpecificData*, kInlineCount> inline_items{};
+  std::unique_ptr<QList<FormatSpecificData*>> overflow_items;
+  uint32_t present_types{0};
 };
 
 #endif // FORMSPEC_H_INCLUDED_
@@ -21,14 +21,19 @@
 
 #include "garmin.h"
 
+#include <chrono>                // for steady_clock, milliseconds, seconds
 #include <climits>               // for INT_MAX
 #include <cmath>                 // for atan2, modf, sqrt
 #include <cstdio>                // for fprintf, fflush, snprintf, snprintf
 #include <cstdint>               // for int32_t
-#include <cstdlib>               // for strtol
+#include <cstdlib>               // for exit, strtol
 #include <cstring>               // for memcpy, strlen, strncpy, strchr
 #include <ctime>                 // for time_t
-#include <utility>               // for as_const
+#include <exception>             // for current_exception, exception_ptr, rethrow_exception
+#include <memory>                // for make_shared, shared_ptr
+#include <mutex>                 // for lock_guard, mutex, unique_lock
+#include <thread>                // for thread
+#include <utility>               // for as_const, exchange
 
 #include <QByteArray>            // for QByteArray
 #include <QChar>                 // for QChar
@@ -38,19 +43,21 @@
 #include <Qt>                    // for CaseInsensitive
 #include <QtGlobal>              // for qPrintable, qRound64, Q_INT64_C, qint64
 
-#include "defs.h"
+#include "defs.h"                // for fatal_set_throws, fatal_throws
 #include "formspec.h"            // for FormatSpecificDataList
 #include "garmin_fs.h"           // for garmin_fs_garmin_after_read, garmin_fs_garmin_before_write
 #include "garmin_tables.h"       // for gt_find_icon_number_from_desc, PCX, gt_find_desc_from_icon_number
 #include "geocache.h"            // for Geocache, Geocache::type_t, Geocache...
 #include "jeeps/gpsapp.h"        // for GPS_Set_Baud_Rate, GPS_Init, GPS_Pre...
 #include "jeeps/gpscom.h"        // for GPS_Command_Get_Lap, GPS_Command_Get...
+#include "jeeps/gpsdevice.h"     // for GPS_Device_Wait
 #include "jeeps/gpsmem.h"        // for GPS_Track_Del, GPS_Way_Del, GPS_Pvt_Del
 #include "jeeps/gpsprot.h"       // for gps_waypt_type, gps_category_type
 #include "jeeps/gpssend.h"       // for GPS_SWay, GPS_PWay, GPS_STrack, GPS_...
 #include "jeeps/gpsserial.h"     // for DEFAULT_BAUD
 #include "jeeps/gpsutil.h"       // for GPS_User, GPS_Enable_Diagnose, GPS_E...
 #include "src/core/datetime.h"   // for DateTime
+#include "src/core/logging.h"    // for FatalError
 #include "mkshort.h"             // for MakeShort
 
 
@@ -435,86 +442,73 @@ unsigned int GarminFormat::checkWayPointIsAtSplit(Waypoint* wpt, GPS_PLap* laps,
 }
 
 void
-GarminFormat::track_read()
+GarminFormat::track_read_cb(const GPS_OTrack* trk, void* sink_data)
 {
-  GPS_PTrack* array;
-  route_head* trk_head = nullptr;
-  int trk_num = 0;
-  const char* trk_name = "";
-  GPS_PLap* laps = nullptr;
-  int nlaps = 0;
-  int next_is_new_trkseg = 0;
+  auto* state = static_cast<TrackReadState*>(sink_data);
 
-  if (gps_lap_type != -1) {
-    nlaps = GPS_Command_Get_Lap(portname, &laps, &lap_read_nop_cb);
+  /*
+   * This is probably always in slot zero, but the Garmin
+   * serial spec says these can appear anywhere.  Toss them
+   * out so we don't treat it as an extraneous trackpoint.
+   */
+  if (trk->ishdr) {
+    state->trk_name = trk->trk_ident;
   }
 
+  if (state->trk_head == nullptr || trk->ishdr) {
+    state->trk_head = new route_head;
+    state->trk_head->rte_num = state->trk_num;
+    state->trk_head->rte_name = state->format->str_to_unicode(state->trk_name);
+    state->trk_num++;
+    track_add_head(state->trk_head);
+  }
 
-  int32_t ntracks = GPS_Command_Get_Track(portname, &array, waypt_read_cb);
+  /* Need to do this here because fitness devices set tnew
+   * on a trackpoint without lat/lon.
+   */
+  if (trk->tnew) {
+    state->next_is_new_trkseg = 1;
+  }
 
-  if (ntracks <= 0) {
+  if (trk->no_latlon || trk->ishdr) {
     return;
   }
+  auto* wpt = new Waypoint;
 
-  for (int i = 0; i < ntracks; i++) {
-    /*
-     * This is probably always in slot zero, but the Garmin
-     * serial spec says these can appear anywhere.  Toss them
-     * out so we don't treat it as an extraneous trackpoint.
-     */
-    if (array[i]->ishdr) {
-      trk_name = array[i]->trk_ident;
-      if (!trk_name) {
-        trk_name = "";
-      }
-    }
-
-    if (trk_head == nullptr || array[i]->ishdr) {
-      trk_head = new route_head;
-      trk_head->rte_num = trk_num;
-      trk_head->rte_name = str_to_unicode(trk_name);
-      trk_num++;
-      track_add_head(trk_head);
-    }
+  wpt->longitude = trk->lon;
+  wpt->latitude = trk->lat;
+  wpt->altitude = trk->alt;
+  wpt->heartrate = trk->heartrate;
+  wpt->cadence = trk->cadence;
+  wpt->shortname = state->format->str_to_unicode(trk->trk_ident);
+  wpt->SetCreationTime(trk->Time);
+  wpt->wpt_flags.is_split = checkWayPointIsAtSplit(wpt, state->laps,
+                            state->nlaps);
+  wpt->wpt_flags.new_trkseg = state->next_is_new_trkseg;
+  state->next_is_new_trkseg = 0;
 
-    /* Need to do this here because fitness devices set tnew
-     * on a trackpoint without lat/lon.
-     */
-    if (array[i]->tnew) {
-      next_is_new_trkseg = 1;
-    }
+  if (trk->dpth < 1.0e25f) {
+    wpt->set_depth(trk->dpth);
+  }
+  if (trk->temperature_populated) {
+    wpt->set_temperature(trk->temperature);
+  }
 
-    if (array[i]->no_latlon || array[i]->ishdr) {
-      continue;
-    }
-    auto* wpt = new Waypoint;
+  track_add_wpt(state->trk_head, wpt);
+}
 
-    wpt->longitude = array[i]->lon;
-    wpt->latitude = array[i]->lat;
-    wpt->altitude = array[i]->alt;
-    wpt->heartrate = array[i]->heartrate;
-    wpt->cadence = array[i]->cadence;
-    wpt->shortname = str_to_unicode(array[i]->trk_ident);
-    wpt->SetCreationTime(array[i]->Time);
-    wpt->wpt_flags.is_split = checkWayPointIsAtSplit(wpt, laps,
-                              nlaps);
-    wpt->wpt_flags.new_trkseg = next_is_new_trkseg;
-    next_is_new_trkseg = 0;
-
-    if (array[i]->dpth < 1.0e25f) {
-      wpt->set_depth(array[i]->dpth);
-    }
-    if (array[i]->temperature_populated) {
-      wpt->set_temperature(array[i]->temperature);
-    }
+void
+GarminFormat::track_read()
+{
+  TrackReadState state;
+  state.format = this;
 
-    track_add_wpt(trk_head, wpt);
+  if (gps_lap_type != -1) {
+    state.nlaps = GPS_Command_Get_Lap(portname, &state.laps, &lap_read_nop_cb);
   }
 
-  while (ntracks) {
-    GPS_Track_Del(&array[--ntracks]);
-  }
-  xfree(array);
+  /* Waypoints are made as the track packets arrive, no track array is built. */
+  GPS_Command_Get_Track_Sink(portname, track_read_cb, &state, waypt_read_cb);
 }
 
 void
@@ -643,44 +637,165 @@ GarminFormat::pvt2wpt(GPS_PPvt_Data pvt, Waypoint* wpt)
   }
 }
 
+GarminFormat::~GarminFormat()
+{
+  // Only left running when a fatal error ends the program.
+  if (pvt_thread.joinable()) {
+    pvt_thread.detach();
+  }
+}
+
+GarminFormat::PvtQueue::~PvtQueue()
+{
+  for (auto& fix : fixes) {
+    GPS_Pvt_Del(&fix.pvt);
+  }
+}
+
 void
 GarminFormat::rd_position_init(const QString& fname)
 {
   rw_init(fname);
   GPS_Command_Pvt_On(qPrintable(fname), &pvt_fd);
+  pvt_queue = std::make_shared<PvtQueue>();
+  pvt_thread = std::thread(pvt_drain, pvt_fd, pvt_queue);
 }
 
-Waypoint*
-GarminFormat::rd_position(posn_status* posn_status)
+/*
+ * Reads the PVT packets on a thread of their own as the receiver sends
+ * them and notes when each arrived, so neither the serial port nor the
+ * USB pipe backs up while a fix is being written and no fix waits for
+ * the next call of rd_position().  The jeeps stack is only used on this
+ * thread until it ends, and a fatal() in it is handed to the reading
+ * thread instead of ending the program from here.
+ */
+void
+GarminFormat::pvt_drain(gpsdevh* fd, const std::shared_ptr<PvtQueue>& queue)
 {
-  auto* wpt = new Waypoint;
-  GPS_PPvt_Data pvt = GPS_Pvt_New();
+  fatal_set_throws(true);
+  try {
+    for (;;) {
+      // Wait for the next packet in short slices, so that pvt_stop() is
+      // not held up by a receiver that has gone quiet.  Past the usual
+      // timeout the read below reports it as before.  USB cannot be
+      // waited on, its reads give up after their own timeout.
+      const auto quiet = std::chrono::steady_clock::now() + std::chrono::seconds(GPS_TIME_OUT);
+      while (!GPS_Device_Wait(fd) && (std::chrono::steady_clock::now() < quiet)) {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        if (queue->stopping) {
+          return;
+        }
+      }
 
-  if (GPS_Command_Pvt_Get(pvt_fd, &pvt)) {
-    pvt2wpt(pvt, wpt);
-    GPS_Pvt_Del(&pvt);
+      GPS_PPvt_Data pvt = GPS_Pvt_New();
+      const int32_t rv = GPS_Command_Pvt_Get(fd, &pvt);
+      const auto received = std::chrono::steady_clock::now();
 
-    wpt->shortname = "Position";
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      if (rv > 0) {
+        queue->fixes.push_back({pvt, received});
+        queue->arrived.notify_one();
+      } else {
+        GPS_Pvt_Del(&pvt);
+      }
+      if (gps_errno) {
+        // As before, an error with a fix ends tracking after it.
+        if (rv > 0) {
+          queue->ended = true;
+        } else {
+          queue->failed = true;
+        }
+        queue->arrived.notify_one();
+        return;
+      }
+      if (queue->stopping) {
+        return;
+      }
+    }
+  } catch (const FatalError&) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->error = std::current_exception();
+    queue->failed = true;
+    queue->arrived.notify_one();
+  }
+}
 
-    if (gps_errno && posn_status) {
-      posn_status->request_terminate = 1;
+void
+GarminFormat::pvt_stop()
+{
+  if (pvt_thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(pvt_queue->mutex);
+      pvt_queue->stopping = true;
     }
+    pvt_thread.join();
+  }
+  std::exception_ptr error;
+  if (pvt_queue) {
+    error = std::exchange(pvt_queue->error, nullptr);
+  }
+  pvt_queue.reset();
+  if (error) {
+    pvt_report(error);
+  }
+}
 
-    return wpt;
+/* Ends the program, or throws on to the caller, for a fatal() of the drain thread. */
+void
+GarminFormat::pvt_report(const std::exception_ptr& error)
+{
+  // fatal() has reported the error already.
+  if (!fatal_throws()) {
+    exit(1);
   }
+  std::rethrow_exception(error);
+}
 
-  /*
-   * If the caller has not given us a better way to return the
-   * error, do it now.
-   */
-  if (gps_errno) {
-    fatal(MYNAME ": Fatal error reading position.\n");
+Waypoint*
+GarminFormat::rd_position(posn_status* posn_status)
+{
+  std::unique_lock<std::mutex> lock(pvt_queue->mutex);
+  while (pvt_queue->fixes.empty() && !pvt_queue->ended && !pvt_queue->failed) {
+    // Look now and then whether tracking was interrupted.
+    if ((posn_status != nullptr) && posn_status->request_terminate) {
+      return nullptr;
+    }
+    pvt_queue->arrived.wait_for(lock, std::chrono::milliseconds(100));
   }
 
-  delete wpt;
-  GPS_Pvt_Del(&pvt);
+  if (pvt_queue->fixes.empty()) {
+    if (pvt_queue->failed) {
+      const std::exception_ptr error = std::exchange(pvt_queue->error, nullptr);
+      lock.unlock();
+      pvt_thread.join();
+      if (error) {
+        pvt_report(error);
+      }
+      fatal(MYNAME ": Fatal error reading position.\n");
+    }
+    if (posn_status != nullptr) {
+      posn_status->request_terminate = 1;
+    }
+    return nullptr;
+  }
 
-  return nullptr;
+  PvtQueue::Fix fix = pvt_queue->fixes.front();
+  pvt_queue->fixes.pop_front();
+  const bool last = pvt_queue->fixes.empty() && pvt_queue->ended;
+  lock.unlock();
+
+  auto* wpt = new Waypoint;
+  pvt2wpt(fix.pvt, wpt);
+  GPS_Pvt_Del(&fix.pvt);
+  wpt->shortname = "Position";
+
+  if (posn_status != nullptr) {
+    posn_status->received = fix.received;
+    if (last) {
+      posn_status->request_terminate = 1;
+    }
+  }
+  return wpt;
 }
 
 void
@@ -782,7 +897,6 @@ GarminFormat::waypoint_prepare()
 {
   int i;
   int n = waypt_count();
-  extern WaypointList* global_waypoint_list;
   int icon;
 
   tx_waylist = (GPS_SWay**) xcalloc(n,sizeof(*tx_waylist));
@@ -793,8 +907,7 @@ GarminFormat::waypoint_prepare()
 
   i = 0;
 
-  // Iterate with waypt_disp_all?
-  for (const Waypoint* wpt : std::as_const(*global_waypoint_list)) {
+  for (const Waypoint* wpt : waypt_range()) {
     char obuf[256];
 
     QString src;
@@ -21,7 +21,14 @@
 #ifndef GARMIN_H_INCLUDED_
 #define GARMIN_H_INCLUDED_
 
+#include <chrono>              // for steady_clock
+#include <condition_variable>  // for condition_variable
 #include <cstdio>              // for size_t
+#include <deque>               // for deque
+#include <exception>           // for exception_ptr
+#include <memory>              // for shared_ptr
+#include <mutex>               // for mutex
+#include <thread>              // for thread
 
 #include <QByteArray>          // for QByteArray
 #include <QString>             // for QString
@@ -31,13 +38,20 @@
 #include "defs.h"
 #include "format.h"            // for Format
 #include "jeeps/gpsdevice.h"   // for gpsdevh
-#include "jeeps/gpssend.h"     // for GPS_PWay, GPS_SWay, GPS_PTrack, GPS_PPvt_Data, GPS_SLap
+#include "jeeps/gpssend.h"     // for GPS_PWay, GPS_SWay, GPS_PTrack, GPS_OTrack, GPS_PPvt_Data, GPS_SLap
 #include "mkshort.h"           // for MakeShort
 
 
 class GarminFormat : public Format
 {
 public:
+  GarminFormat() = default;
+  GarminFormat(const GarminFormat&) = delete;
+  GarminFormat& operator=(const GarminFormat&) = delete;
+  GarminFormat(GarminFormat&&) = delete;
+  GarminFormat& operator=(GarminFormat&&) = delete;
+  ~GarminFormat() override;
+
   QVector<arglist_t>* get_args() override
   {
     return &garmin_args;
@@ -72,12 +86,50 @@ public:
   Waypoint* rd_position(posn_status* status) override;
   void rd_position_deinit() override
   {
+    pvt_stop();
     rw_deinit();
   }
 
 private:
+  /* Types */
+
+  struct TrackReadState {
+    GarminFormat* format{nullptr};
+    route_head* trk_head{nullptr};
+    int trk_num{0};
+    QByteArray trk_name;
+    GPS_PLap* laps{nullptr};
+    int nlaps{0};
+    int next_is_new_trkseg{0};
+  };
+
+  /*
+   * The PVT packets read by the drain thread and not yet returned by
+   * rd_position(), shared with the thread so that it may outlive the
+   * format at exit.
+   */
+  struct PvtQueue {
+    struct Fix {
+      GPS_PPvt_Data pvt;
+      std::chrono::steady_clock::time_point received;
+    };
+
+    ~PvtQueue();
+
+    std::mutex mutex;
+    std::condition_variable arrived;
+    std::deque<Fix> fixes;
+    bool stopping{false};
+    bool ended{false};   // the receiver reported an error with the last fix
+    bool failed{false};  // reading failed
+    std::exception_ptr error;  // the fatal() that ended the thread
+  };
+
   /* Member Functions */
 
+  static void pvt_drain(gpsdevh* fd, const std::shared_ptr<PvtQueue>& queue);
+  void pvt_stop();
+  [[noreturn]] static void pvt_report(const std::exception_ptr& error);
   QByteArray str_from_unicode(const QString& qstr);
   QString str_to_unicode(const QByteArray& cstr);
   static void write_char_string(char* dest, const char* source, size_t destsize);
@@ -87,6 +139,7 @@ private:
   void waypt_read();
   static int lap_read_nop_cb(int /* unused */, GPS_SWay** /* unused */);
   static unsigned int checkWayPointIsAtSplit(Waypoint* wpt, GPS_SLap** laps, int nlaps);
+  static void track_read_cb(const GPS_OTrack* trk, void* sink_data);
   void track_read();
   void route_read();
   static void pvt2wpt(GPS_PPvt_Data pvt, Waypoint* wpt);
@@ -182,6 +235,8 @@ private:
   };
 
   gpsdevh* pvt_fd{};
+  std::shared_ptr<PvtQueue> pvt_queue;
+  std::thread pvt_thread;
 
   static constexpr const char* d103_icons[16] = {
     "dot",
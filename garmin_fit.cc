@@ -22,25 +22,28 @@
 
  */
 
+#include <algorithm>           // for min
+#include <array>               // for array
+#include <cstddef>             // for size_t
 #include <cstdint>             // for uint8_t, uint16_t, uint32_t, int32_t, int8_t, uint64_t
 #include <cstdio>              // for EOF, SEEK_SET, snprintf
+#include <cstring>             // for memcpy
 #include <deque>               // for deque, _Deque_iterator, operator!=
 #include <memory>              // for allocator_traits<>::value_type
 #include <string>              // for operator+, to_string, char_traits
-#include <utility>             // for pair
+#include <utility>             // for as_const, pair
 #include <vector>              // for vector
 
-#include <QByteArray>          // for QByteArray
+#include <QByteArray>          // for QByteArray, qstrnlen
 #include <QDateTime>           // for QDateTime
-#include <QFileInfo>           // for QFileInfo
 #include <QLatin1Char>         // for QLatin1Char
 #include <QString>             // for QString
 #include <Qt>                  // for CaseInsensitive
-#include <QtGlobal>            // for uint, qint64
+#include <QtGlobal>            // for uint, qsizetype
 
 #include "defs.h"
 #include "garmin_fit.h"
-#include "gbfile.h"            // for gbfputc, gbfputuint16, gbfputuint32, gbfgetc, gbfread, gbfseek, gbfclose, gbfgetuint16, gbfopen_le, gbfputint32, gbfflush, gbfgetuint32, gbfputs, gbftell, gbfwrite, gbfile, gbsize_t
+#include "gbfile.h"            // for gbfputc, gbfputuint16, gbfputuint32, gbfread, gbfseek, gbfclose, gbfopen_le, gbfputint32, gbfputs, gbftell, gbfwrite, gbfpatchint16, gbfpatchint32, gbfile, gbsize_t
 #include "jeeps/gpsmath.h"     // for GPS_Math_Semi_To_Deg, GPS_Math_Gtime_To_Utime, GPS_Math_Deg_To_Semi, GPS_Math_Utime_To_Gtime
 #include "src/core/logging.h"  // for Warning, Fatal
 
@@ -61,6 +64,8 @@ void
 GarminFitFormat::rd_deinit()
 {
   fit_data = fit_data_t();
+  fit_buf.clear();
+  fit_pos = 0;
 
   gbfclose(fin);
 }
@@ -83,18 +88,22 @@ GarminFitFormat::wr_deinit()
 void
 GarminFitFormat::fit_parse_header()
 {
-  char sig[4];
+  const auto* data = reinterpret_cast<const uint8_t*>(fit_buf.constData());
+  const qsizetype size = fit_buf.size();
 
-  int len = gbfgetc(fin);
+  int len = (size >= 1) ? data[0] : EOF;
   if (len == EOF || len < 12) {
     fatal(MYNAME ": Bad header\n");
   }
   if (global_opts.debug_level >= 1) {
     Debug(1) << MYNAME ": header len=" << len;
   }
+  if (size < 12) {
+    fatal(MYNAME ": Unexpected end of file\n");
+  }
 
-  int ver = gbfgetc(fin);
-  if (ver == EOF || (ver >> 4) > 2)
+  int ver = data[1];
+  if ((ver >> 4) > 2)
     fatal(MYNAME ": Unsupported protocol version %d.%d\n",
           ver >> 4, ver & 0xf);
   if (global_opts.debug_level >= 1) {
@@ -102,14 +111,11 @@ GarminFitFormat::fit_parse_header()
   }
 
   // profile version
-  ver = gbfgetuint16(fin);
+  ver = le_readu16(data + 2);
   // data length
-  fit_data.len = gbfgetuint32(fin);
+  fit_data.len = le_read32(data + 4);
   // File signature
-  if (gbfread(sig, 4, 1, fin) != 1) {
-    fatal(MYNAME ": Unexpected end of file\n");
-  }
-  if (sig[0] != '.' || sig[1] != 'F' || sig[2] != 'I' || sig[3] != 'T') {
+  if (data[8] != '.' || data[9] != 'F' || data[10] != 'I' || data[11] != 'T') {
     fatal(MYNAME ": .FIT signature missing\n");
   }
 
@@ -120,19 +126,14 @@ GarminFitFormat::fit_parse_header()
 
   // Header CRC may be omitted entirely
   if (len >= kReadHeaderCrcLen) {
-    uint16_t hdr_crc = gbfgetuint16(fin);
+    if (size < kReadHeaderCrcLen) {
+      fatal(MYNAME ": File %s truncated\n", fin->name);
+    }
+    uint16_t hdr_crc = le_readu16(data + 12);
     // Header CRC may be set to 0, or contain the CRC over previous bytes.
     if (hdr_crc != 0) {
       // Check the header CRC
-      uint16_t crc = 0;
-      gbfseek(fin, 0, SEEK_SET);
-      for (unsigned int i = 0; i < kReadHeaderCrcLen; ++i) {
-        int data = gbfgetc(fin);
-        if (data == EOF) {
-          fatal(MYNAME ": File %s truncated\n", fin->name);
-        }
-        crc = fit_crc16(data, crc);
-      }
+      uint16_t crc = fit_crc16(data, kReadHeaderCrcLen, 0);
       if (crc != 0) {
         Warning().nospace() << MYNAME ": Header CRC mismatch in file " <<  fin->name << ".";
         if (!opt_recoverymode) {
@@ -144,46 +145,45 @@ GarminFitFormat::fit_parse_header()
     }
   }
 
-  QFileInfo fi(fin->name);
-  qint64 size = fi.size();
   if ((len + fit_data.len + 2) != size) {
     Warning().nospace() << MYNAME ": File size " << size << " is not expected given header len " << len << ", data length " << fit_data.len << " and a 2 byte file CRC.";
   } else if (global_opts.debug_level >= 1) {
     Debug(1) << MYNAME ": File size matches expectations from information in the header.";
   }
 
-  gbfseek(fin, len, SEEK_SET);
+  fit_pos = len;
 
   fit_data.global_utc_offset = 0;
 }
 
-uint8_t
-GarminFitFormat::fit_getuint8()
+/*
+ * Hand out the next size bytes of the record data and step over them.
+ */
+const uint8_t*
+GarminFitFormat::fit_take(int size)
 {
-  if (fit_data.len < 1) {
-    throw ReaderException("record truncated: expecting char[1], but only got " + std::to_string(fit_data.len) + ".");
+  if (fit_data.len < size) {
+    throw ReaderException("record truncated: expecting " + std::to_string(size) + " bytes, but only got " + std::to_string(fit_data.len) + ".");
   }
-  int val = gbfgetc(fin);
-  if (val == EOF) {
+  if (fit_buf.size() - fit_pos < size) {
     throw ReaderException("unexpected end of file with fit_data.len=" + std::to_string(fit_data.len) + ".");
   }
-  --fit_data.len;
-  return static_cast<uint8_t>(val);
+  const auto* data = reinterpret_cast<const uint8_t*>(fit_buf.constData()) + fit_pos;
+  fit_pos += size;
+  fit_data.len -= size;
+  return data;
+}
+
+uint8_t
+GarminFitFormat::fit_getuint8()
+{
+  return *fit_take(1);
 }
 
 uint16_t
 GarminFitFormat::fit_getuint16()
 {
-  char buf[2];
-
-  if (fit_data.len < 2) {
-    throw ReaderException("record truncated: expecting char[2], but only got " + std::to_string(fit_data.len) + ".");
-  }
-  gbsize_t count = gbfread(buf, 2, 1, fin);
-  if (count != 1) {
-    throw ReaderException("unexpected end of file with fit_data.len=" + std::to_string(fit_data.len) + ".");
-  }
-  fit_data.len -= 2;
+  const uint8_t* buf = fit_take(2);
   if (fit_data.endian) {
     return be_read16(buf);
   } else {
@@ -194,16 +194,7 @@ GarminFitFormat::fit_getuint16()
 uint32_t
 GarminFitFormat::fit_getuint32()
 {
-  char buf[4];
-
-  if (fit_data.len < 4) {
-    throw ReaderException("record truncated: expecting char[4], but only got " + std::to_string(fit_data.len) + ".");
-  }
-  gbsize_t count = gbfread(buf, 4, 1, fin);
-  if (count != 1) {
-    throw ReaderException("unexpected end of file with fit_data.len=" + std::to_string(fit_data.len) + ".");
-  }
-  fit_data.len -= 4;
+  const uint8_t* buf = fit_take(4);
   if (fit_data.endian) {
     return be_read32(buf);
   } else {
@@ -211,19 +202,145 @@ GarminFitFormat::fit_getuint32()
   }
 }
 
+/*
+ * The string ends at the first NUL or after size bytes.
+ */
 QString
-GarminFitFormat::fit_getstring(int size)
+GarminFitFormat::fit_string(const uint8_t* buf, int size)
 {
-  if (fit_data.len < size) {
-    throw ReaderException("record truncated: expecting " + std::to_string(size) + " bytes, but only got " + std::to_string(fit_data.len) + ".");
+  const auto* chars = reinterpret_cast<const char*>(buf);
+  return QString::fromUtf8(chars, qstrnlen(chars, size));
+}
+
+/*******************************************************************************
+* fit_field_target- what we keep of field id in messages of global_id
+*******************************************************************************/
+GarminFitFormat::fit_target
+GarminFitFormat::fit_field_target(int global_id, int id)
+{
+  if (id == kFieldTimestamp) {
+    return fit_target::timestamp;
   }
-  QByteArray buf(size + 1, 0); // almost certainly an extra byte, QByteArray should guarnatee a terminator.
-  gbsize_t count = gbfread(buf.data(), size, 1, fin);
-  if (count != 1) {
-    throw ReaderException("unexpected end of file with fit_data.len=" + std::to_string(fit_data.len) + ".");
+  switch (global_id) {
+  case kIdDeviceSettings:
+    switch (id) {
+    case kFieldGlobalUtcOffset:
+      return fit_target::utc_offset;
+    }
+    break;
+  case kIdRecord:
+    switch (id) {
+    case kFieldLatitude:
+      return fit_target::lat;
+    case kFieldLongitude:
+      return fit_target::lon;
+    case kFieldAltitude:
+    case kFieldEnhancedAltitude:
+      return fit_target::alt;
+    case kFieldHeartRate:
+      return fit_target::heartrate;
+    case kFieldCadence:
+      return fit_target::cadence;
+    case kFieldSpeed:
+    case kFieldEnhancedSpeed:
+      return fit_target::speed;
+    case kFieldPower:
+      return fit_target::power;
+    case kFieldTemperature:
+      return fit_target::temperature;
+    }
+    break;
+  case kIdLap:
+    switch (id) {
+    case kFieldEndLatitude:
+      return fit_target::endlat;
+    case kFieldEndLongitude:
+      return fit_target::endlon;
+    }
+    break;
+  case kIdEvent:
+    switch (id) {
+    case kFieldEvent:
+      return fit_target::event;
+    case kFieldEventType:
+      return fit_target::eventtype;
+    }
+    break;
+  case kIdLocations:
+    switch (id) {
+    case kFieldLocLatitude:
+      return fit_target::lat;
+    case kFieldLocLongitude:
+      return fit_target::lon;
+    case kFieldLocAltitude:
+      return fit_target::alt;
+    case kFieldLocationName:
+      return fit_target::name;
+    case kFieldLocationDescription:
+      return fit_target::description;
+    }
+    break;
+  }
+  return fit_target::none;
+}
+
+/*******************************************************************************
+* fit_compile_definition- work out where to find the fields we keep
+*******************************************************************************/
+void
+GarminFitFormat::fit_compile_definition(fit_message_def& def)
+{
+  /* https://forums.garmin.com/showthread.php?223645-Vivoactive-problems-plus-suggestions-for-future-firmwares&p=610929#post610929
+   * Per section 4.2.1.4.2 of the FIT Protocol the size of a field may be a
+   * multiple of the size of the underlying type, indicating the field
+   * contains multiple elements represented as an array.
+   *
+   * Garmin Product Support
+   */
+  // In the case that the field contains one value of the indicated type we decode that value,
+  // otherwise we just skip over the data.
+  def.size = 0;
+  def.decoders.clear();
+  for (const auto& f : std::as_const(def.fields)) {
+    const int offset = def.size;
+    def.size += f.size;
+
+    fit_target target = fit_field_target(def.global_id, f.id);
+    if (target == fit_target::none) {
+      if (global_opts.debug_level >= 1) {
+        Debug(1) << MYNAME ": unrecognized data type in GARMIN FIT message " << def.global_id << ": f.id=" << f.id;
+      }
+      continue;
+    }
+
+    fit_kind kind;
+    switch (f.type) {
+    case 0: // enum
+    case 1: // sint8
+    case 2: // uint8
+      kind = (f.size == 1) ? fit_kind::u8 : fit_kind::array;
+      break;
+    case 0x7:
+      kind = fit_kind::string;
+      break;
+    case 0x83: // sint16
+    case 0x84: // uint16
+      kind = (f.size == 2) ? fit_kind::u16 : fit_kind::array;
+      break;
+    case 0x85: // sint32
+    case 0x86: // uint32
+      kind = (f.size == 4) ? fit_kind::u32 : fit_kind::array;
+      break;
+    default: // Ignore everything else for now.
+      kind = fit_kind::array;
+      break;
+    }
+    if ((kind == fit_kind::array) && (global_opts.debug_level >= 8)) {
+      Debug(8) << MYNAME ": skipping field with f.type=0x" <<
+               Qt::hex << f.type << " and f.size=" << Qt::dec << f.size;
+    }
+    def.decoders.append({offset, f.size, kind, target});
   }
-  fit_data.len -= size;
-  return QString(buf.constData());
 }
 
 void
@@ -239,7 +356,7 @@ GarminFitFormat::fit_parse_definition_message(uint8_t header)
   // second byte is endianness
   def.endian = fit_getuint8();
   if (def.endian > 1) {
-    throw ReaderException(QStringLiteral("Bad endian field 0x%1 at file position 0x%2.").arg(def.endian, 0, 16).arg(gbftell(fin) - 1, 0, 16).toStdString());
+    throw ReaderException(QStringLiteral("Bad endian field 0x%1 at file position 0x%2.").arg(def.endian, 0, 16).arg(fit_pos - 1, 0, 16).toStdString());
   }
   fit_data.endian = def.endian;
 
@@ -276,14 +393,9 @@ GarminFitFormat::fit_parse_definition_message(uint8_t header)
   // For simplicity using the existing infrastructure we do it in the following way:
   //   * We read it in as normal fields
   //   * We set the field id to kFieldInvalid so that it do not interfere with valid id's from
-  //     the normal fields.
+  //     the normal fields, and fit_compile_definition() skips over them.
   //       -In our opinion in practice this will not happen, because we do not expect
   //        developer fields e.g. inside lap or record records. But we want to be safe here.
-  //   * We do not have to change the type as we did for the id above, because fit_read_field()
-  //     already uses the size information to read the data, if the type does not match the size.
-  //
-  // If we want to change this or if we want to avoid the xrealloc call, we can change
-  // it in the future by e.g. extending the fit_message_def struct.
 
   // Bit 5 of the header specify if we have developer fields in the data message
   bool hasDevFields = static_cast<bool>(header & 0x20);
@@ -313,82 +425,10 @@ GarminFitFormat::fit_parse_definition_message(uint8_t header)
     }
   }
 
+  fit_compile_definition(def);
   fit_data.message_def.insert(local_id, def);
 }
 
-QVariant
-GarminFitFormat::fit_read_field(const fit_field_t& f)
-{
-  /* https://forums.garmin.com/showthread.php?223645-Vivoactive-problems-plus-suggestions-for-future-firmwares&p=610929#post610929
-   * Per section 4.2.1.4.2 of the FIT Protocol the size of a field may be a
-   * multiple of the size of the underlying type, indicating the field
-   * contains multiple elements represented as an array.
-   *
-   * Garmin Product Support
-   */
-  // In the case that the field contains one value of the indicated type we return that value,
-  // otherwise we just skip over the data.
-
-  if (global_opts.debug_level >= 8) {
-    Debug(8) << MYNAME ": fit_read_field: read data field with f.type=0x" <<
-             Qt::hex << f.type << " and f.size=" <<
-             Qt::dec << f.size << " fit_data.len=" << fit_data.len;
-  }
-  switch (f.type) {
-  case 0: // enum
-  case 1: // sint8
-  case 2: // uint8
-    if (f.size == 1) {
-      return fit_getuint8();
-    } else { // ignore array data
-      for (int i = 0; i < f.size; ++i) {
-        fit_getuint8();
-      }
-      if (global_opts.debug_level >= 8) {
-        Debug(8) << MYNAME ": fit_read_field: skipping 1-byte array data";
-      }
-      return -1;
-    }
-  case 0x7:
-    return fit_getstring(f.size);
-
-  case 0x83: // sint16
-  case 0x84: // uint16
-    if (f.size == 2) {
-      return fit_getuint16();
-    } else { // ignore array data
-      for (int i = 0; i < f.size; ++i) {
-        fit_getuint8();
-      }
-      if (global_opts.debug_level >= 8) {
-        Debug(8) << MYNAME ": fit_read_field: skipping 2-byte array data";
-      }
-      return -1;
-    }
-  case 0x85: // sint32
-  case 0x86: // uint32
-    if (f.size == 4) {
-      return fit_getuint32();
-    } else { // ignore array data
-      for (int i = 0; i < f.size; ++i) {
-        fit_getuint8();
-      }
-      if (global_opts.debug_level >= 8) {
-        Debug(8) << MYNAME ": fit_read_field: skipping 4-byte array data";
-      }
-      return -1;
-    }
-  default: // Ignore everything else for now.
-    for (int i = 0; i < f.size; ++i) {
-      fit_getuint8();
-    }
-    if (global_opts.debug_level >= 8) {
-      Debug(8) << MYNAME ": fit_read_field: skipping unrecognized data type";
-    }
-    return -1;
-  }
-}
-
 void
 GarminFitFormat::fit_parse_data(const fit_message_def& def, int time_offset)
 {
@@ -401,11 +441,8 @@ GarminFitFormat::fit_parse_data(const fit_message_def& def, int time_offset)
   uint8_t cadence = 0xff;
   uint16_t power = 0xffff;
   int8_t temperature = 0x7f;
-  //int32_t startlat = 0x7fffffff;
-  //int32_t startlon = 0x7fffffff;
   int32_t endlat = 0x7fffffff;
   int32_t endlon = 0x7fffffff;
-  //uint32_t starttime = 0; // ??? default ?
   uint8_t event = 0xff;
   uint8_t eventtype = 0xff;
   QString name;
@@ -414,17 +451,41 @@ GarminFitFormat::fit_parse_data(const fit_message_def& def, int time_offset)
   if (global_opts.debug_level >= 7) {
     Debug(7) << MYNAME ": parsing fit data ID " << def.global_id << " with num_fields=" << def.fields.size();
   }
-  for (int i = 0; i < def.fields.size(); ++i) {
-    if (global_opts.debug_level >= 7) {
-      Debug(7) << MYNAME ": parsing field " << i;
-    }
-    const fit_field_t& f = def.fields.at(i);
-    QVariant field = fit_read_field(f);
+
+  // All fields of the message are in the buffer, so only the ones we keep
+  // are looked at.
+  const uint8_t* content = fit_take(def.size);
+  for (const auto& d : def.decoders) {
+    const uint8_t* p = content + d.offset;
     uint32_t val = -1;
-    if (field.canConvert<uint>()) {
-      val = field.toUInt();
+    QString str;
+    switch (d.kind) {
+    case fit_kind::u8:
+      val = *p;
+      break;
+    case fit_kind::u16:
+      val = static_cast<uint16_t>(def.endian ? be_read16(p) : le_read16(p));
+      break;
+    case fit_kind::u32:
+      val = def.endian ? be_read32(p) : le_read32(p);
+      break;
+    case fit_kind::string:
+      str = fit_string(p, d.size);
+      val = str.toUInt();
+      break;
+    case fit_kind::array:
+      break;
+    }
+    if ((d.target == fit_target::name) || (d.target == fit_target::description)) {
+      if (d.kind == fit_kind::array) {
+        str = QStringLiteral("-1");
+      } else if (d.kind != fit_kind::string) {
+        str = QString::number(val);
+      }
     }
-    if (f.id == kFieldTimestamp) {
+
+    switch (d.target) {
+    case fit_target::timestamp:
       if (global_opts.debug_level >= 7) {
         Debug(7) << MYNAME ": parsing fit data: timestamp=" << static_cast<int32_t>(val);
       }
@@ -435,229 +496,103 @@ GarminFitFormat::fit_parse_data(const fit_message_def& def, int time_offset)
         timestamp += fit_data.global_utc_offset;
       }
       fit_data.last_timestamp = timestamp;
-    } else {
-      switch (def.global_id) {
-      case kIdDeviceSettings: // device settings message
-        switch (f.id) {
-        case kFieldGlobalUtcOffset:
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: global utc_offset=" << static_cast<int32_t>(val);
-          }
-          fit_data.global_utc_offset = val;
-          break;
-        default:
-          if (global_opts.debug_level >= 1) {
-            Debug(1) << MYNAME ": unrecognized data type in GARMIN FIT device settings: f.id=" << f.id;
-          }
-          break;
-        } // switch (f.id)
-        // end of case def.global_id = kIdDeviceSettings
-        break;
-
-      case kIdRecord: // record message - trkType is a track
-        switch (f.id) {
-        case kFieldLatitude:
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: lat=" << static_cast<int32_t>(val);
-          }
-          lat = val;
-          break;
-        case kFieldLongitude:
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: lon=" << static_cast<int32_t>(val);
-          }
-          lon = val;
-          break;
-        case kFieldAltitude:
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: alt=" << static_cast<int32_t>(val);
-          }
-          if (val != 0xffff) {
-            alt = val;
-          }
-          break;
-        case kFieldHeartRate:
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: heartrate=" << static_cast<int32_t>(val);
-          }
-          heartrate = val;
-          break;
-        case kFieldCadence:
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: cadence=" << static_cast<int32_t>(val);
-          }
-          cadence = val;
-          break;
-        case kFieldDistance:
-          // NOTE: 5 is DISTANCE in cm ... unused.
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": unrecognized data type in GARMIN FIT record: f.id=" << f.id;
-          }
-          break;
-        case kFieldSpeed:
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: speed=" << static_cast<int32_t>(val);
-          }
-          if (val != 0xffff) {
-            speed = val;
-          }
-          break;
-        case kFieldPower:
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: power=" << static_cast<int32_t>(val);
-          }
-          power = val;
-          break;
-        case kFieldTemperature:
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: temperature=" << static_cast<int32_t>(val);
-          }
-          temperature = val;
-          break;
-        case kFieldEnhancedSpeed:
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: enhanced_speed=" << static_cast<int32_t>(val);
-          }
-          if (val != 0xffff) {
-            speed = val;
-          }
-          break;
-        case kFieldEnhancedAltitude:
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: enhanced_altitude=" << static_cast<int32_t>(val);
-          }
-          if (val != 0xffff) {
-            alt = val;
-          }
-          break;
-        default:
-          if (global_opts.debug_level >= 1) {
-            Debug(1) << MYNAME ": unrecognized data type in GARMIN FIT record: f.id=" << f.id;
-          }
-          break;
-        } // switch (f.id)
-        // end of case def.global_id = kIdRecord
-        break;
-
-      case kIdLap: // lap wptType , endlat+lon is wpt
-        switch (f.id) {
-        case kFieldStartTime:
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: starttime=" << static_cast<int32_t>(val);
-          }
-          //starttime = val;
-          break;
-        case kFieldStartLatitude:
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: startlat=" << static_cast<int32_t>(val);
-          }
-          //startlat = val;
-          break;
-        case kFieldStartLongitude:
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: startlon=" << static_cast<int32_t>(val);
-          }
-          //startlon = val;
-          break;
-        case kFieldEndLatitude:
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: endlat=" << static_cast<int32_t>(val);
-          }
-          endlat = val;
-          break;
-        case kFieldEndLongitude:
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: endlon=" << static_cast<int32_t>(val);
-          }
-          endlon = val;
-          break;
-        case kFieldElapsedTime:
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: elapsedtime=" << static_cast<int32_t>(val);
-          }
-          //elapsedtime = val;
-          break;
-        case kFieldTotalDistance:
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: totaldistance=" << static_cast<int32_t>(val);
-          }
-          //totaldistance = val;
-          break;
-        default:
-          if (global_opts.debug_level >= 1) {
-            Debug(1) << MYNAME ": unrecognized data type in GARMIN FIT lap: f.id=" << f.id;
-          }
-          break;
-        } // switch (f.id)
-        // end of case def.global_id = kIdLap
-        break;
-
-      case kIdEvent:
-        switch (f.id) {
-        case kFieldEvent:
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: event=" << static_cast<int32_t>(val);
-          }
-          event = val;
-          break;
-        case kFieldEventType:
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: eventtype=" << static_cast<int32_t>(val);
-          }
-          eventtype = val;
-          break;
-        } // switch (f.id)
-        // end of case def.global_id = kIdEvent
-        break;
-
-      case kIdLocations:
-        switch (f.id) {
-        case kFieldLocLatitude:
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: lat=" << static_cast<int32_t>(val);
-          }
-          lat = val;
-          break;
-        case kFieldLocLongitude:
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: lon=" << static_cast<int32_t>(val);
-          }
-          lon = val;
-          break;
-        case kFieldLocAltitude:
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: alt=" << static_cast<int32_t>(val);
-          }
-          if (val != 0xffff) {
-            alt = val;
-          }
-          break;
-        case kFieldLocationName:
-          name = field.toString();
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: location name=" << name;
-          }
-          break;
-        case kFieldLocationDescription:
-          description = field.toString();
-          if (global_opts.debug_level >= 7) {
-            Debug(7) << MYNAME ": parsing fit data: location description=" << description;
-          }
-          break;
-        default:
-          if (global_opts.debug_level >= 1) {
-            Debug(1) << MYNAME ": unrecognized data type in GARMIN FIT locations: f.id=" << f.id;
-          }
-          break;
-        } // switch (f.id)
-        // end of case def.global_id = kIdLocations
-        break;
-      default:
-        if (global_opts.debug_level >= 1) {
-          Debug(1) << MYNAME ": unrecognized/unhandled global ID for GARMIN FIT: " << def.global_id;
-        }
-        break;
-      } // switch (def.global_id)
+      break;
+    case fit_target::utc_offset:
+      if (global_opts.debug_level >= 7) {
+        Debug(7) << MYNAME ": parsing fit data: global utc_offset=" << static_cast<int32_t>(val);
+      }
+      fit_data.global_utc_offset = val;
+      break;
+    case fit_target::lat:
+      if (global_opts.debug_level >= 7) {
+        Debug(7) << MYNAME ": parsing fit data: lat=" << static_cast<int32_t>(val);
+      }
+      lat = val;
+      break;
+    case fit_target::lon:
+      if (global_opts.debug_level >= 7) {
+        Debug(7) << MYNAME ": parsing fit data: lon=" << static_cast<int32_t>(val);
+      }
+      lon = val;
+      break;
+    case fit_target::alt:
+      if (global_opts.debug_level >= 7) {
+        Debug(7) << MYNAME ": parsing fit data: alt=" << static_cast<int32_t>(val);
+      }
+      if (val != 0xffff) {
+        alt = val;
+      }
+      break;
+    case fit_target::heartrate:
+      if (global_opts.debug_level >= 7) {
+        Debug(7) << MYNAME ": parsing fit data: heartrate=" << static_cast<int32_t>(val);
+      }
+      heartrate = val;
+      break;
+    case fit_target::cadence:
+      if (global_opts.debug_level >= 7) {
+        Debug(7) << MYNAME ": parsing fit data: cadence=" << static_cast<int32_t>(val);
+      }
+      cadence = val;
+      break;
+    case fit_target::speed:
+      if (global_opts.debug_level >= 7) {
+        Debug(7) << MYNAME ": parsing fit data: speed=" << static_cast<int32_t>(val);
+      }
+      if (val != 0xffff) {
+        speed = val;
+      }
+      break;
+    case fit_target::power:
+      if (global_opts.debug_level >= 7) {
+        Debug(7) << MYNAME ": parsing fit data: power=" << static_cast<int32_t>(val);
+      }
+      power = val;
+      break;
+    case fit_target::temperature:
+      if (global_opts.debug_level >= 7) {
+        Debug(7) << MYNAME ": parsing fit data: temperature=" << static_cast<int32_t>(val);
+      }
+      temperature = val;
+      break;
+    case fit_target::endlat:
+      if (global_opts.debug_level >= 7) {
+        Debug(7) << MYNAME ": parsing fit data: endlat=" << static_cast<int32_t>(val);
+      }
+      endlat = val;
+      break;
+    case fit_target::endlon:
+      if (global_opts.debug_level >= 7) {
+        Debug(7) << MYNAME ": parsing fit data: endlon=" << static_cast<int32_t>(val);
+      }
+      endlon = val;
+      break;
+    case fit_target::event:
+      if (global_opts.debug_level >= 7) {
+        Debug(7) << MYNAME ": parsing fit data: event=" << static_cast<int32_t>(val);
+      }
+      event = val;
+      break;
+    case fit_target::eventtype:
+      if (global_opts.debug_level >= 7) {
+        Debug(7) << MYNAME ": parsing fit data: eventtype=" << static_cast<int32_t>(val);
+      }
+      eventtype = val;
+      break;
+    case fit_target::name:
+      name = str;
+      if (global_opts.debug_level >= 7) {
+        Debug(7) << MYNAME ": parsing fit data: location name=" << name;
+      }
+      break;
+    case fit_target::description:
+      description = str;
+      if (global_opts.debug_level >= 7) {
+        Debug(7) << MYNAME ": parsing fit data: location description=" << description;
+      }
+      break;
+    case fit_target::none:
+      break;
     }
   }
 
@@ -756,7 +691,7 @@ GarminFitFormat::fit_parse_data_message(uint8_t header)
   } else {
     throw ReaderException(
       QString("Message %1 hasn't been defined before being used at file position 0x%2.").
-      arg(local_id).arg(gbftell(fin) - 1, 0, 16).toStdString());
+      arg(local_id).arg(fit_pos - 1, 0, 16).toStdString());
   }
 }
 
@@ -769,7 +704,7 @@ GarminFitFormat::fit_parse_compressed_message(uint8_t header)
   } else {
     throw ReaderException(
       QString("Compressed message %1 hasn't been defined before being used at file position 0x%2.").
-      arg(local_id).arg(gbftell(fin) - 1, 0, 16).toStdString());
+      arg(local_id).arg(fit_pos - 1, 0, 16).toStdString());
   }
 }
 
@@ -779,7 +714,7 @@ GarminFitFormat::fit_parse_compressed_message(uint8_t header)
 void
 GarminFitFormat::fit_parse_record()
 {
-  gbsize_t position = gbftell(fin);
+  qsizetype position = fit_pos;
   uint8_t header = fit_getuint8();
   // high bit 7 set -> compressed message (0 for normal)
   // second bit 6 set -> 0 for data message, 1 for definition message
@@ -818,17 +753,7 @@ GarminFitFormat::fit_check_file_crc() const
 {
   // Check file CRC
 
-  gbsize_t position = gbftell(fin);
-
-  uint16_t crc = 0;
-  gbfseek(fin, 0, SEEK_SET);
-  while (true) {
-    int data = gbfgetc(fin);
-    if (data == EOF) {
-      break;
-    }
-    crc = fit_crc16(data, crc);
-  }
+  uint16_t crc = fit_crc16(fit_buf.constData(), fit_buf.size(), 0);
   if (crc != 0) {
     Warning().nospace() << MYNAME ": File CRC mismatch in file " <<  fin->name << ".";
     if (!opt_recoverymode) {
@@ -837,8 +762,6 @@ GarminFitFormat::fit_check_file_crc() const
   } else if (global_opts.debug_level >= 1) {
     Debug(1) << MYNAME ": File CRC verified.";
   }
-
-  gbfseek(fin, position, SEEK_SET);
 }
 
 /*******************************************************************************
@@ -849,12 +772,28 @@ GarminFitFormat::fit_check_file_crc() const
 void
 GarminFitFormat::read()
 {
+  // Pool the (potentially many) points we create.
+  AllocationArena arena;
+
+  // Decode from memory, FIT files are small next to the points made of them.
+  constexpr gbsize_t kBlockSize = 64 * 1024;
+  gbsize_t count;
+  do {
+    const qsizetype used = fit_buf.size();
+    fit_buf.resize(used + kBlockSize);
+    count = gbfread(fit_buf.data() + used, 1, kBlockSize, fin);
+    fit_buf.resize(used + count);
+  } while (count == kBlockSize);
+
   fit_check_file_crc();
 
   fit_parse_header();
 
   fit_data.track = new route_head;
   track_add_head(fit_data.track);
+  // A point takes a record message of at least a header, a timestamp and
+  // a position, so there can't be more points than this.
+  track_reserve_wpts(fit_data.track, std::min<qsizetype>(fit_data.len, fit_buf.size()) / 13);
   if (global_opts.debug_level >= 1) {
     Debug(1) << MYNAME ": starting to read data with fit_data.len=" << fit_data.len;
   }
@@ -891,16 +830,49 @@ GarminFitFormat::fit_write_message_def(uint8_t local_id, uint16_t global_id, con
   }
 }
 
+/*
+ * The FIT CRC is the reflected CRC-16 with polynomial 0xa001.
+ * kCrcTables[0] advances it over one byte, and kCrcTables[k] over one byte
+ * followed by k zero bytes, so that eight bytes can be taken at once.
+ */
+static constexpr std::array<std::array<uint16_t, 256>, 8> kCrcTables = [] {
+  std::array<std::array<uint16_t, 256>, 8> tables{};
+  for (unsigned int i = 0; i < 256; ++i) {
+    uint16_t crc = i;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc & 1) ? ((crc >> 1) ^ 0xa001) : (crc >> 1);
+    }
+    tables[0][i] = crc;
+  }
+  for (unsigned int k = 1; k < tables.size(); ++k) {
+    for (unsigned int i = 0; i < 256; ++i) {
+      const uint16_t prev = tables[k - 1][i];
+      tables[k][i] = (prev >> 8) ^ tables[0][prev & 0xff];
+    }
+  }
+  return tables;
+}();
+
 uint16_t
 GarminFitFormat::fit_crc16(uint8_t data, uint16_t crc)
 {
-  static const uint16_t crc_table[] = {
-    0x0000, 0xcc01, 0xd801, 0x1400, 0xf001, 0x3c00, 0x2800, 0xe401,
-    0xa001, 0x6c00, 0x7800, 0xb401, 0x5000, 0x9c01, 0x8801, 0x4400
-  };
+  return (crc >> 8) ^ kCrcTables[0][(crc ^ data) & 0xff];
+}
 
-  crc = (crc >> 4) ^ crc_table[crc & 0xf] ^ crc_table[data & 0xf];
-  crc = (crc >> 4) ^ crc_table[crc & 0xf] ^ crc_table[(data >> 4) & 0xf];
+uint16_t
+GarminFitFormat::fit_crc16(const void* data, std::size_t len, uint16_t crc)
+{
+  const auto* p = static_cast<const uint8_t*>(data);
+  for (; len >= 8; len -= 8, p += 8) {
+    const uint16_t x = crc ^ (p[0] | (p[1] << 8));
+    crc = kCrcTables[7][x & 0xff] ^ kCrcTables[6][x >> 8] ^
+          kCrcTables[5][p[2]] ^ kCrcTables[4][p[3]] ^
+          kCrcTables[3][p[4]] ^ kCrcTables[2][p[5]] ^
+          kCrcTables[1][p[6]] ^ kCrcTables[0][p[7]];
+  }
+  for (; len > 0; --len, ++p) {
+    crc = fit_crc16(*p, crc);
+  }
   return crc;
 }
 
@@ -1094,36 +1066,31 @@ void
 GarminFitFormat::fit_write_file_finish() const
 {
   // Update data records size in file header
-  gbsize_t file_size = gbftell(fout);
+  gboff_t file_size = gbftell(fout);
   if (file_size < kWriteHeaderCrcLen) {
     fatal(MYNAME ": File %s truncated\n", fout->name);
   }
-  gbfseek(fout, 0, SEEK_SET);
-  fit_write_file_header(file_size - kWriteHeaderCrcLen, 0);
-
-  // Update file header CRC
-  uint16_t crc = 0;
-  gbfseek(fout, 0, SEEK_SET);
-  for (unsigned int i = 0; i < kWriteHeaderLen; ++i) {
-    int data = gbfgetc(fout);
-    if (data == EOF) {
-      fatal(MYNAME ": File %s truncated\n", fout->name);
-    }
-    crc = fit_crc16(data, crc);
-  }
-  gbfseek(fout, 0, SEEK_SET);
-  fit_write_file_header(file_size - kWriteHeaderCrcLen, crc);
-
-  // Write file CRC
-  gbfflush(fout);
+  uint32_t data_size = file_size - kWriteHeaderCrcLen;
+  gbfpatchint32(fout, 4, data_size);
+
+  // Update file header CRC, the header is ours so there is no need to read it back
+  unsigned char header[kWriteHeaderLen] = {kWriteHeaderCrcLen, 0x10, 0x11, 0x08};
+  le_write32(header + 4, data_size);
+  memcpy(header + 8, ".FIT", 4);
+  uint16_t crc = fit_crc16(header, sizeof(header), 0);
+  gbfpatchint16(fout, kWriteHeaderLen, crc);
+
+  // Write file CRC.  A CRC run over data followed by its own CRC ends at
+  // zero, so the header can be skipped.
+  gbfseek(fout, kWriteHeaderCrcLen, SEEK_SET);
   crc = 0;
-  while (true) {
-    int data = gbfgetc(fout);
-    if (data == EOF) {
-      break;
-    }
-    crc = fit_crc16(data, crc);
-  }
+  constexpr gbsize_t kBlockSize = 64 * 1024;
+  QByteArray block(kBlockSize, 0);
+  gbsize_t count;
+  do {
+    count = gbfread(block.data(), 1, kBlockSize, fout);
+    crc = fit_crc16(block.constData(), count, crc);
+  } while (count == kBlockSize);
   gbfputuint16(crc, fout);
 }
 
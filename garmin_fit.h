@@ -24,17 +24,19 @@
 #ifndef GARMIN_FIT_H_INCLUDED_
 #define GARMIN_FIT_H_INCLUDED_
 
+#include <cstddef>              // for size_t
 #include <cstdint>              // for uint8_t, uint16_t, uint32_t
 #include <deque>                // for deque
 #include <stdexcept>            // for runtime_error
 #include <utility>              // for pair
 #include <vector>               // for vector
 
+#include <QByteArray>           // for QByteArray
 #include <QHash>                // for QHash
 #include <QList>                // for QList
 #include <QString>              // for QString
-#include <QVariant>             // for QVariant
 #include <QVector>              // for QVector
+#include <QtGlobal>             // for qsizetype
 
 #include "defs.h"
 #include "format.h"             // for Format
@@ -64,6 +66,11 @@ public:
     };
   }
 
+  unsigned int wr_fields() const override
+  {
+    return wpt_field_none;
+  }
+
   void rd_init(const QString& fname) override;
   void read() override;
   void rd_deinit() override;
@@ -80,10 +87,43 @@ private:
     int type{};
   };
 
+  /* What we keep of a field, i.e. where fit_parse_data() stores it. */
+  enum class fit_target {
+    none,
+    timestamp,
+    utc_offset,
+    lat,
+    lon,
+    alt,
+    heartrate,
+    cadence,
+    speed,
+    power,
+    temperature,
+    endlat,
+    endlon,
+    event,
+    eventtype,
+    name,
+    description
+  };
+
+  /* How the bytes of a field are read. */
+  enum class fit_kind {u8, u16, u32, string, array};
+
+  struct fit_field_decoder {
+    int offset{};	// from the start of the data message content
+    int size{};
+    fit_kind kind{fit_kind::array};
+    fit_target target{fit_target::none};
+  };
+
   struct fit_message_def {
     int endian{};
     int global_id{};
     QList<fit_field_t> fields;
+    int size{};	// of the data message content
+    QList<fit_field_decoder> decoders;	// for the fields we keep, in order
   };
 
   struct fit_data_t {
@@ -226,12 +266,14 @@ private:
   /* Member Functions */
 
   void fit_parse_header();
+  const uint8_t* fit_take(int size);
   uint8_t fit_getuint8();
   uint16_t fit_getuint16();
   uint32_t fit_getuint32();
-  QString fit_getstring(int size);
+  static QString fit_string(const uint8_t* buf, int size);
+  static fit_target fit_field_target(int global_id, int id);
+  static void fit_compile_definition(fit_message_def& def);
   void fit_parse_definition_message(uint8_t header);
-  QVariant fit_read_field(const fit_field_t& f);
   void fit_parse_data(const fit_message_def& def, int time_offset);
   void fit_parse_data_message(uint8_t header);
   void fit_parse_compressed_message(uint8_t header);
@@ -239,6 +281,7 @@ private:
   void fit_check_file_crc() const;
   void fit_write_message_def(uint8_t local_id, uint16_t global_id, const std::vector<fit_field_t>& fields) const;
   static uint16_t fit_crc16(uint8_t data, uint16_t crc);
+  static uint16_t fit_crc16(const void* data, std::size_t len, uint16_t crc);
   void fit_write_timestamp(const gpsbabel::DateTime& t) const;
   void fit_write_fixed_string(const QString& s, unsigned int len) const;
   void fit_write_position(double pos) const;
@@ -296,6 +339,8 @@ private:
   std::deque<FitCourseRecordPoint> course, waypoints;
 
   gbfile* fin{nullptr};
+  QByteArray fit_buf;	// the whole input file
+  qsizetype fit_pos{0};	// of the next byte to read in fit_buf
   gbfile* fout{nullptr};
 
   /*******************************************************************************
@@ -22,12 +22,27 @@
 
 #include "garmin_fs.h"
 
+#include <cstddef>           // for size_t
+#include <initializer_list>  // for initializer_list
+
 #include <QString>    // for QString
 #include <Qt>         // for CaseInsensitive
 
 #include "defs.h"
 #include "inifile.h"  // for inifile_readstr
+#include "src/core/footprint.h"  // for heap_bytes
+
 
+std::size_t
+garmin_fs_t::memory_usage() const
+{
+  std::size_t bytes = sizeof(*this) + gpsbabel::heap_bytes(ilinks);
+  for (const QString* s : {&city, &facility, &state, &cc, &cross_road, &addr, &country,
+                           &phone_nr, &phone_nr2, &fax_nr, &postal_code, &email}) {
+    bytes += gpsbabel::heap_bytes(*s);
+  }
+  return bytes;
+}
 
 std::optional<uint16_t>
 garmin_fs_t::convert_category(const QString& category_name)
@@ -116,7 +116,13 @@ public:
     return new garmin_fs_t(*this);
   }
 
-  static garmin_fs_t* find(const Waypoint* wpt) {
+  std::size_t memory_usage() const override;
+
+  static const garmin_fs_t* find(const Waypoint* wpt) {
+    return reinterpret_cast<const garmin_fs_t*>(wpt->fs.FsChainFind(kFsGmsd));
+  }
+  // For changing the data, which is then no longer shared with copies.
+  static garmin_fs_t* find(Waypoint* wpt) {
     return reinterpret_cast<garmin_fs_t*>(wpt->fs.FsChainFind(kFsGmsd));
   }
 
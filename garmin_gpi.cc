@@ -26,18 +26,21 @@
 #include <QByteArray>              // for QByteArray, operator==
 #include <QDateTime>               // for QDateTime
 #include <QList>                   // for QList
+#include <QMultiHash>              // for QMultiHash
+#include <QPair>                   // for QPair
 #include <QString>                 // for QString, operator+, operator<
 #include <QThread>                 // for QThread
 #include <Qt>                      // for CaseInsensitive
 #include <QtGlobal>                // for foreach, Q_UNUSED
 
-#include <algorithm>               // for stable_sort
+#include <algorithm>               // for stable_sort, copy
 #include <cctype>                  // for tolower
 #include <cstdint>                 // for uint32_t, int32_t
 #include <cstdio>                  // for SEEK_CUR, SEEK_SET
 #include <cstring>                 // for strlen, strncmp
 #include <ctime>                   // for time, time_t
 #include <memory>                  // for unique_ptr
+#include <vector>                  // for vector
 
 #include "defs.h"
 #include "formspec.h"              // for FormatSpecificDataList
@@ -61,7 +64,7 @@
 #define GPI_BITMAP_SIZE sizeof(gpi_bitmap)
 
 #define GPI_DBG global_opts.debug_level >= 3
-#define PP if (GPI_DBG) warning("@%1$6x (%1$8d): ", gbftell(fin))
+#define PP if (GPI_DBG) warning("@%1$6llx (%1$8lld): ", (long long) gbftell(fin))
 
 /*******************************************************************************
 * %%%                             gpi reader                               %%% *
@@ -239,7 +242,7 @@ GarminGPIFormat::read_poi(const int sz, const int tag)
   warning("poi sublen = %d (0x%x)\n", len, len);
   }
   (void) len;
-  int pos = gbftell(fin);
+  gboff_t pos = gbftell(fin);
 
   auto* wpt = new Waypoint;
   wpt->icon_descr = DEFAULT_ICON;
@@ -251,7 +254,7 @@ GarminGPIFormat::read_poi(const int sz, const int tag)
   (void) gbfgetc(fin);    /* seems to 1 when extra options present */
   wpt->shortname = gpi_read_string("Shortname");
 
-  while (gbftell(fin) < (gbsize_t)(pos + sz - 4)) {
+  while (gbftell(fin) < pos + sz - 4) {
     int skip_tag = gbfgetint32(fin);
     if (! read_tag("read_poi", skip_tag, wpt)) {
       break;
@@ -277,10 +280,10 @@ GarminGPIFormat::read_poi(const int sz, const int tag)
 void
 GarminGPIFormat::read_poi_list(const int sz)
 {
-  int pos = gbftell(fin);
+  gboff_t pos = gbftell(fin);
   if (GPI_DBG) {
     PP;
-    warning("> reading poi list (-> %x / %d )\n", pos + sz, pos + sz);
+    warning("> reading poi list (-> %llx / %lld )\n", (long long)(pos + sz), (long long)(pos + sz));
   }
   PP;
   int i = gbfgetint32(fin);  /* mostly 23 (0x17) */
@@ -300,7 +303,7 @@ GarminGPIFormat::read_poi_list(const int sz)
 
   (void) gbfgetint32(fin);  /* ? const 0x1000100 ? */
 
-  while (gbftell(fin) < (gbsize_t)(pos + sz - 4)) {
+  while (gbftell(fin) < pos + sz - 4) {
     int tag = gbfgetint32(fin);
     if (! read_tag("read_poi_list", tag, nullptr)) {
       return;
@@ -315,22 +318,22 @@ GarminGPIFormat::read_poi_list(const int sz)
 void
 GarminGPIFormat::read_poi_group(const int sz, const int tag)
 {
-  int pos = gbftell(fin);
+  gboff_t pos = gbftell(fin);
   if (GPI_DBG) {
     PP;
-    warning("> reading poi group (-> %x / %d)\n", pos + sz, pos + sz);
+    warning("> reading poi group (-> %llx / %lld)\n", (long long)(pos + sz), (long long)(pos + sz));
   }
   if (tag == 0x80009) {
     PP;
     int subsz = gbfgetint32(fin);  /* ? offset to category data ? */
     if (GPI_DBG) {
-      warning("group sublen = %d (-> %x / %d)\n", subsz, pos + subsz + 4, pos + subsz + 4);
+      warning("group sublen = %d (-> %llx / %lld)\n", subsz, (long long)(pos + subsz + 4), (long long)(pos + subsz + 4));
     }
     (void)subsz;
   }
   rdata->group = gpi_read_string("Group");
 
-  while (gbftell(fin) < (gbsize_t)(pos + sz)) {
+  while (gbftell(fin) < pos + sz) {
     int subtag = gbfgetint32(fin);
     if (! read_tag("read_poi_group", subtag, nullptr)) {
       break;
@@ -361,7 +364,7 @@ GarminGPIFormat::read_tag(const char* caller, const int tag, Waypoint* wpt)
   garmin_fs_t* gmsd;
 
   int sz = gbfgetint32(fin);
-  int pos = gbftell(fin);
+  gboff_t pos = gbftell(fin);
 
   if (GPI_DBG) {
     PP;
@@ -594,11 +597,6 @@ void
 GarminGPIFormat::wdata_free(writer_data_t* data)
 {
   foreach (Waypoint* wpt, data->waypt_list) {
-
-    if (wpt->extra_data) {
-      auto* dt = (gpi_waypt_t*) wpt->extra_data;
-      delete dt;
-    }
     delete wpt;
   }
 
@@ -625,15 +623,33 @@ GarminGPIFormat::wdata_add_wpt(writer_data_t* data, Waypoint* wpt)
   waypt_add_to_bounds(&data->bds, wpt);
 }
 
+/*
+ * Split the points into blocks of at most WAYPOINTS_PER_BLOCK.  The points
+ * are partitioned in one array, each block being a range of it, and only
+ * the final blocks get a list of their own.
+ */
 void
 GarminGPIFormat::wdata_check(writer_data_t* data) const
 {
-  double center_lon;
+  std::vector<Waypoint*> wpts(data->waypt_list.cbegin(), data->waypt_list.cend());
+  std::vector<Waypoint*> scratch(wpts.size());
+  data->waypt_list.clear();
+  wdata_split(data, wpts.data(), wpts.size(), scratch.data());
+}
 
-  if ((data->waypt_list.size() <= WAYPOINTS_PER_BLOCK) ||
+/*
+ * Split a block of count points around their mean center into four
+ * quadrants, keeping the order of the points within each.  data's bounds
+ * must already cover the points.
+ */
+void
+GarminGPIFormat::wdata_split(writer_data_t* data, Waypoint** wpts, qsizetype count, Waypoint** scratch) const
+{
+  if ((count <= WAYPOINTS_PER_BLOCK) ||
       /* avoid endless loop for points (more than WAYPOINTS_PER_BLOCK)
          at same coordinates */
       ((data->bds.min_lat >= data->bds.max_lat) && (data->bds.min_lon >= data->bds.max_lon))) {
+    data->waypt_list = QList<Waypoint*>(wpts, wpts + count);
     if (data->waypt_list.size() > 1) {
       std::stable_sort(data->waypt_list.begin(), data->waypt_list.end(), compare_wpt_cb);
     }
@@ -642,50 +658,55 @@ GarminGPIFormat::wdata_check(writer_data_t* data) const
 
   /* compute the (mean) center of current bounds */
 
-  double center_lat = center_lon = 0;
-  foreach (const Waypoint* wpt, data->waypt_list) {
-    center_lat += wpt->latitude;
-    center_lon += wpt->longitude;
+  double center_lat = 0;
+  double center_lon = 0;
+  for (qsizetype i = 0; i < count; ++i) {
+    center_lat += wpts[i]->latitude;
+    center_lon += wpts[i]->longitude;
   }
-  center_lat /= data->waypt_list.size();
-  center_lon /= data->waypt_list.size();
-
-  while (!data->waypt_list.isEmpty()) {
-    Waypoint* wpt = data->waypt_list.takeFirst();
-    writer_data_t** ref;
+  center_lat /= count;
+  center_lon /= count;
 
+  /* quadrants in the order they are written */
+  enum {top_left, top_right, bottom_left, bottom_right, quadrants};
+  auto quadrant = [center_lat, center_lon](const Waypoint* wpt)->int {
     if (wpt->latitude < center_lat) {
-      if (wpt->longitude < center_lon) {
-        ref = &data->bottom_left;
-      } else {
-        ref = &data->bottom_right;
-      }
-    } else {
-      if (wpt->longitude < center_lon) {
-        ref = &data->top_left;
-      } else {
-        ref = &data->top_right;
-      }
-    }
-
-    if (*ref == nullptr) {
-      *ref = wdata_alloc();
+      return (wpt->longitude < center_lon) ? bottom_left : bottom_right;
     }
+    return (wpt->longitude < center_lon) ? top_left : top_right;
+  };
 
-    wdata_add_wpt(*ref, wpt);
-  }
-
-  if (data->top_left) {
-    wdata_check(data->top_left);
+  qsizetype offset[quadrants + 1] = {};
+  for (qsizetype i = 0; i < count; ++i) {
+    ++offset[quadrant(wpts[i]) + 1];
   }
-  if (data->top_right) {
-    wdata_check(data->top_right);
+  for (int q = 0; q < quadrants; ++q) {
+    offset[q + 1] += offset[q];
   }
-  if (data->bottom_left) {
-    wdata_check(data->bottom_left);
+
+  writer_data_t* child[quadrants] = {};
+  qsizetype next[quadrants];
+  std::copy(offset, offset + quadrants, next);
+  for (qsizetype i = 0; i < count; ++i) {
+    Waypoint* wpt = wpts[i];
+    int q = quadrant(wpt);
+    if (child[q] == nullptr) {
+      child[q] = wdata_alloc();
+    }
+    waypt_add_to_bounds(&child[q]->bds, wpt);
+    scratch[next[q]++] = wpt;
   }
-  if (data->bottom_right) {
-    wdata_check(data->bottom_right);
+  std::copy(scratch, scratch + count, wpts);
+
+  data->top_left = child[top_left];
+  data->top_right = child[top_right];
+  data->bottom_left = child[bottom_left];
+  data->bottom_right = child[bottom_right];
+
+  for (int q = 0; q < quadrants; ++q) {
+    if (child[q] != nullptr) {
+      wdata_split(child[q], wpts + offset[q], offset[q + 1] - offset[q], scratch + offset[q]);
+    }
   }
 }
 
@@ -700,7 +721,10 @@ GarminGPIFormat::wdata_compute_size(writer_data_t* data) const
 
   res = 23;  /* bounds, ... of tag 0x80008 */
 
-  foreach (Waypoint* wpt, data->waypt_list) {
+  data->waypt_extra.fill(gpi_waypt_t(), data->waypt_list.size());
+  for (qsizetype i = 0; i < data->waypt_list.size(); ++i) {
+    Waypoint* wpt = data->waypt_list.at(i);
+    gpi_waypt_t* dt = &data->waypt_extra[i];
     const garmin_fs_t* gmsd;
 
     res += 12;    /* tag/sz/sub-sz */
@@ -710,9 +734,6 @@ GarminGPIFormat::wdata_compute_size(writer_data_t* data) const
       res += 10;  /* tag(4) */
     }
 
-    auto* dt = new gpi_waypt_t;
-    wpt->extra_data = dt;
-
     if (alerts) {
       if (int pidx = wpt->shortname.indexOf('@'); pidx != -1) {
         double scale;
@@ -852,9 +873,10 @@ GarminGPIFormat::wdata_write(const writer_data_t* data) const
   gbfputint16(1, fout);
   gbfputc(data->alert, fout);
 
-  foreach (const Waypoint* wpt, data->waypt_list) {
+  for (qsizetype i = 0; i < data->waypt_list.size(); ++i) {
+    const Waypoint* wpt = data->waypt_list.at(i);
+    const gpi_waypt_t* dt = &data->waypt_extra.at(i);
     int s1;
-    auto* dt = (gpi_waypt_t*) wpt->extra_data;
 
     QString str = wpt->description;
     if (str.isEmpty()) {
@@ -1028,14 +1050,13 @@ GarminGPIFormat::write_header() const
 }
 
 void
-GarminGPIFormat::enum_waypt_cb(const Waypoint* ref) const
+GarminGPIFormat::enum_waypt_cb(const Waypoint* ref)
 {
-  foreach (const Waypoint* cmp, wdata->waypt_list) {
-
-    /* sort out nearly equal waypoints */
+  /* sort out nearly equal waypoints, only those at the same place can be */
+  const QPair<double, double> place(ref->latitude, ref->longitude);
+  for (auto it = wdata_places.constFind(place); (it != wdata_places.cend()) && (it.key() == place); ++it) {
+    const Waypoint* cmp = it.value();
     if ((compare_strings(cmp->shortname, ref->shortname) == 0) &&
-        (cmp->latitude == ref->latitude) &&
-        (cmp->longitude == ref->longitude) &&
         (compare_strings(cmp->description, ref->description) == 0) &&
         (compare_strings(cmp->notes, ref->notes) == 0)) {
       return;
@@ -1049,6 +1070,7 @@ GarminGPIFormat::enum_waypt_cb(const Waypoint* ref) const
   }
 
   wdata_add_wpt(wdata, wpt);
+  wdata_places.insert(place, wpt);
 }
 
 void
@@ -1310,6 +1332,7 @@ GarminGPIFormat::wr_init(const QString& fname)
     parse_distance(opt_proximity, &defproximity, scale, MYNAME);
   }
   wdata = wdata_alloc();
+  wdata_places.clear();
 }
 
 void
@@ -1323,6 +1346,7 @@ void
 GarminGPIFormat::wr_deinit()
 {
   wdata_free(wdata);
+  wdata_places.clear();
   delete short_h;
   short_h = nullptr;
   gbfclose(fout);
@@ -48,9 +48,12 @@
 
 #include <QByteArray>   // for QByteArray
 #include <QList>        // for QList
+#include <QMultiHash>   // for QMultiHash
+#include <QPair>        // for QPair
 #include <QString>      // for QString
 #include <QTextCodec>   // for QTextCodec
 #include <QVector>      // for QVector
+#include <QtGlobal>     // for qsizetype
 
 #include <cstdint>      // for int32_t, int16_t, uint16_t
 #include <ctime>        // for time_t
@@ -104,8 +107,21 @@ private:
     QString category;
   };
 
+  struct gpi_waypt_t {
+    int sz{0};
+    int alerts{0};
+    short mask{0};
+    QString addr;
+    QString city;
+    QString country;
+    QString phone_nr;
+    QString postal_code;
+    QString state;
+  };
+
   struct writer_data_t {
     QList<Waypoint*> waypt_list;
+    QList<gpi_waypt_t> waypt_extra;  // one for each of waypt_list, see wdata_compute_size()
     int sz{0};
     int alert{0};
     bounds bds{};
@@ -154,18 +170,6 @@ private:
     int32_t size_2c;
   };
 
-  struct gpi_waypt_t {
-    int sz{0};
-    int alerts{0};
-    short mask{0};
-    QString addr;
-    QString city;
-    QString country;
-    QString phone_nr;
-    QString postal_code;
-    QString state;
-  };
-
   struct lc_string {
     QByteArray lc;
     QByteArray str;
@@ -296,11 +300,12 @@ private:
   static void wdata_free(writer_data_t* data);
   static void wdata_add_wpt(writer_data_t* data, Waypoint* wpt);
   void wdata_check(writer_data_t* data) const;
+  void wdata_split(writer_data_t* data, Waypoint** wpts, qsizetype count, Waypoint** scratch) const;
   int wdata_compute_size(writer_data_t* data) const;
   void wdata_write(const writer_data_t* data) const;
   void write_category(const char* unused, const unsigned char* image, int image_sz) const;
   void write_header() const;
-  void enum_waypt_cb(const Waypoint* ref) const;
+  void enum_waypt_cb(const Waypoint* ref);
   static void load_bitmap_from_file(const char* fname, const unsigned char** data, int* data_sz);
   QByteArray str_from_unicode(const QString& qstr) const {return codec->fromUnicode(qstr);}
   QString str_to_unicode(const QByteArray& cstr) const {return codec->toUnicode(cstr);}
@@ -378,6 +383,7 @@ private:
   uint16_t codepage{};	/* code-page, e.g. 1252, 65001 */
   reader_data_t* rdata{};
   writer_data_t* wdata{};
+  QMultiHash<QPair<double, double>, const Waypoint*> wdata_places;  /* the points of wdata by place */
   MakeShort* short_h{};
   char units{};
   time_t gpi_timestamp = 0;
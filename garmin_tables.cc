@@ -24,6 +24,8 @@
 #include <cstring>               // for strncpy, strchr, strlen, strncmp
 #include <QChar>                 // for operator==, QChar
 #include <QDebug>                // for QDebug
+#include <QHash>                 // for QHash
+#include <QString>               // for QString
 #include <Qt>                    // for CaseInsensitive
 #include "defs.h"
 #include "garmin_tables.h"
@@ -420,6 +422,63 @@ gt_switch_display_mode_value(const unsigned char display_mode, const int protoid
   }
 }
 
+/*
+ * The icon tables keyed by case folded description.  Of several equal
+ * descriptions the first wins, as it did when the tables were scanned.
+ */
+static QHash<QString, const icon_mapping_t*>
+gt_icon_desc_index(const icon_mapping_t* table)
+{
+  QHash<QString, const icon_mapping_t*> index;
+  for (const icon_mapping_t* i = table; i->icon; i++) {
+    QString key = QString(i->icon).toCaseFolded();
+    if (!index.contains(key)) {
+      index.insert(key, i);
+    }
+  }
+  return index;
+}
+
+/*
+ * The tables are ASCII.  Other input could still compare equal to an
+ * entry through case folding (e.g. KELVIN SIGN), so it gets the scan.
+ */
+static const icon_mapping_t*
+gt_find_icon_from_desc(const QString& desc, const icon_mapping_t* table,
+                       const QHash<QString, const icon_mapping_t*>& index)
+{
+  for (const QChar c : desc) {
+    if (c.unicode() >= 0x80) {
+      for (const icon_mapping_t* i = table; i->icon; i++) {
+        if (desc.compare(i->icon, Qt::CaseInsensitive) == 0) {
+          return i;
+        }
+      }
+      return nullptr;
+    }
+  }
+  return index.value(desc.toCaseFolded(), nullptr);
+}
+
+/* The descriptions of garmin_icon_table by MapSource or PCX number, first wins. */
+static const QHash<int, const char*>&
+gt_icon_number_index(bool mapsource)
+{
+  auto build = [](bool mps) {
+    QHash<int, const char*> index;
+    for (const icon_mapping_t* i = garmin_icon_table; i->icon; i++) {
+      int number = mps ? i->mpssymnum : i->pcxsymnum;
+      if (!index.contains(number)) {
+        index.insert(number, i->icon);
+      }
+    }
+    return index;
+  };
+  static const QHash<int, const char*> mps_index = build(true);
+  static const QHash<int, const char*> pcx_index = build(false);
+  return mapsource ? mps_index : pcx_index;
+}
+
 QString
 gt_find_desc_from_icon_number(const int icon, garmin_formats_e garmin_format)
 {
@@ -431,23 +490,21 @@ gt_find_desc_from_icon_number(const int icon, garmin_formats_e garmin_format)
     return QStringLiteral("Custom %1").arg(icon - 7680);
   }
 
-  for (const icon_mapping_t* i = garmin_icon_table; i->icon; i++) {
-    switch (garmin_format) {
-    case MAPSOURCE:
-    case GDB:
-      if (icon == i->mpssymnum) {
-        return i->icon;
-      }
-      break;
-    case PCX:
-    case GARMIN_SERIAL:
-      if (icon == i->pcxsymnum) {
-        return i->icon;
-      }
-      break;
-    default:
-      fatal(MYNAME ": unknown garmin format.\n");
-    }
+  const QHash<int, const char*>* index;
+  switch (garmin_format) {
+  case MAPSOURCE:
+  case GDB:
+    index = &gt_icon_number_index(true);
+    break;
+  case PCX:
+  case GARMIN_SERIAL:
+    index = &gt_icon_number_index(false);
+    break;
+  default:
+    fatal(MYNAME ": unknown garmin format.\n");
+  }
+  if (const char* descr = index->value(icon, nullptr)) {
+    return descr;
   }
   return DEFAULT_ICON_DESCR;
 }
@@ -485,32 +542,25 @@ int gt_find_icon_number_from_desc(const QString& desc, garmin_formats_e garmin_f
     }
   }
 
-  for (i = garmin_smart_icon_table; global_opts.smart_icons && i->icon; i++) {
-    if (desc.compare(i->icon, Qt::CaseInsensitive) == 0) {
-      switch (garmin_format) {
-      case MAPSOURCE:
-      case GDB:
-        return i->mpssymnum;
-      case PCX:
-      case GARMIN_SERIAL:
-        return i->pcxsymnum;
-      default:
-        fatal(MYNAME ": unknown garmin format.\n");
-      }
-    }
+  static const QHash<QString, const icon_mapping_t*> smart_index = gt_icon_desc_index(garmin_smart_icon_table);
+  static const QHash<QString, const icon_mapping_t*> index = gt_icon_desc_index(garmin_icon_table);
+  i = nullptr;
+  if (global_opts.smart_icons) {
+    i = gt_find_icon_from_desc(desc, garmin_smart_icon_table, smart_index);
   }
-  for (i = garmin_icon_table; i->icon; i++) {
-    if (desc.compare(i->icon, Qt::CaseInsensitive) == 0) {
-      switch (garmin_format) {
-      case MAPSOURCE:
-      case GDB:
-        return i->mpssymnum;
-      case PCX:
-      case GARMIN_SERIAL:
-        return i->pcxsymnum;
-      default:
-        fatal(MYNAME ": unknown garmin format.\n");
-      }
+  if (i == nullptr) {
+    i = gt_find_icon_from_desc(desc, garmin_icon_table, index);
+  }
+  if (i != nullptr) {
+    switch (garmin_format) {
+    case MAPSOURCE:
+    case GDB:
+      return i->mpssymnum;
+    case PCX:
+    case GARMIN_SERIAL:
+      return i->pcxsymnum;
+    default:
+      fatal(MYNAME ": unknown garmin format.\n");
     }
   }
 
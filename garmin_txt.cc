@@ -56,7 +56,7 @@
 #include "formspec.h"              // for FormatSpecificDataList
 #include "garmin_fs.h"             // for garmin_fs_t
 #include "garmin_tables.h"         // for gt_display_modes_e, gt_find_desc_from_icon_number, gt_find_icon_number_from_desc, gt_get_mps_grid_longname, gt_lookup_datum_index, gt_lookup_grid_type, GDB, gt_get_icao_cc, gt_get_icao_country, gt_get_mps_datum_name, gt_waypt_class_names, GT_DISPLAY_MODE...
-#include "jeeps/gpsmath.h"         // for GPS_Math_Known_Datum_To_UTM_EN, GPS_Math_WGS84_To_Known_Datum_M, GPS_Math_WGS84_To_Swiss_EN, GPS_Math_WGS84_To_UKOSMap_H
+#include "jeeps/gpsmath.h"         // for GPS_Math_Known_Datum_To_UTM_Setup, GPS_Math_WGS84_To_Known_Datum_Setup, GPS_Math_WGS84_To_Swiss_EN, GPS_Math_WGS84_To_UKOSMap_H
 #include "src/core/datetime.h"     // for DateTime
 #include "src/core/logging.h"      // for FatalMsg
 #include "src/core/textstream.h"   // for TextStream
@@ -122,8 +122,8 @@ GarminTxtFormat::convert_datum(const Waypoint* wpt, double* dest_lat, double* de
   if (datum_index == kDatumWGS84) {
     *dest_lat = wpt->latitude;
     *dest_lon = wpt->longitude;
-  } else GPS_Math_WGS84_To_Known_Datum_M(wpt->latitude, wpt->longitude, 0.0,
-                                           dest_lat, dest_lon, &alt, datum_index);
+  } else datum_transform.convert(wpt->latitude, wpt->longitude, 0.0,
+                                   dest_lat, dest_lon, &alt);
 }
 
 /* WRITER *****************************************************************/
@@ -251,8 +251,7 @@ GarminTxtFormat::print_position(const Waypoint* wpt)
 
   case grid_utm:
 
-    valid = GPS_Math_Known_Datum_To_UTM_EN(lat, lon,
-                                           &east, &north, &zone, &zonec, datum_index);
+    valid = utm.convert(lat, lon, &east, &north, &zone, &zonec);
     if (valid) {
       *fout << QString::asprintf("%02d %c %.0f %.0f\t", zone, zonec, east, north);
     }
@@ -702,6 +701,8 @@ GarminTxtFormat::wr_init(const QString& fname)
   default:
     datum_index = gt_lookup_datum_index(datum_str, MYNAME);
   }
+  datum_transform = GPS_Math_WGS84_To_Known_Datum_Setup(datum_index);
+  utm = GPS_Math_Known_Datum_To_UTM_Setup(datum_index);
 
   garmin_txt_utc_option();
 }
@@ -1110,7 +1111,7 @@ GarminTxtFormat::parse_waypoint(const QStringList& lineparts)
     case 11:
       i = gt_find_icon_number_from_desc(str, GDB);
       garmin_fs_t::set_icon(gmsd, i);
-      wpt->icon_descr = gt_find_desc_from_icon_number(i, GDB);
+      wpt->icon_descr = icon_pool.intern(gt_find_desc_from_icon_number(i, GDB));
       break;
     case 12:
       garmin_fs_t::set_facility(gmsd, str);
@@ -1325,6 +1326,7 @@ GarminTxtFormat::rd_deinit()
   fin = nullptr;
   date_time_format.clear();
   date_time_format.squeeze();
+  icon_pool.clear();
 }
 
 void
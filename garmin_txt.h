@@ -38,6 +38,8 @@
 
 #include "defs.h"
 #include "format.h"               // for Format
+#include "jeeps/gpsmath.h"        // for GPS_Molodensky, GPS_UTM
+#include "src/core/stringpool.h"  // for StringPool
 #include "src/core/textstream.h"  // for TextStream
 
 
@@ -156,6 +158,7 @@ private:
 
   gpsbabel::TextStream* fin = nullptr;
   gpsbabel::TextStream* fout = nullptr;
+  gpsbabel::StringPool icon_pool;
   route_head* current_trk{};
   route_head* current_rte{};
   int waypoints{};
@@ -164,6 +167,8 @@ private:
   int wpt_a_ct{};
   grid_type grid_index{};
   int datum_index{};
+  GPS_Molodensky datum_transform;  // from WGS 84, for writing
+  GPS_UTM utm;                     // on the datum's ellipse, for writing
   const char* datum_str{};
   int current_line{};
   QString date_time_format;
@@ -0,0 +1,909 @@
+/*
+    GPSBabel's own binary cache format.
+
+    Copyright (C) 2026 Robert Lipe, robertlipe+source@gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include "gbcache.h"
+
+#include <cstring>             // for memcpy, memcmp
+#include <memory>              // for make_unique
+
+#include <QByteArray>          // for QByteArray
+#include <QDataStream>         // for QDataStream, QDataStream::LittleEndian, QDataStream::Qt_6_0
+#include <QDateTime>           // for QDateTime
+#include <QIODevice>           // for QIODevice, QIODevice::ReadOnly, QIODevice::WriteOnly
+#include <QString>             // for QString
+#include <QTimeZone>           // for QTimeZone
+#include <QtEndian>            // for qFromLittleEndian, qToLittleEndian
+#include <Qt>                  // for UTC, LocalTime, OffsetFromUTC, TimeZone
+#include <QtGlobal>            // for quint32, quint64, qint64, qint32, quint8, qint8
+
+#include "defs.h"              // for Waypoint, route_head, fatal, waypt_add, route_add_head, route_add_wpt, track_add_head, track_add_wpt, waypt_range, route_range, track_range
+#include "garmin_fs.h"         // for garmin_fs_t, garmin_ilink_t
+#include "geocache.h"          // for Geocache
+#include "session.h"           // for start_session, session_t
+#include "src/core/datetime.h" // for DateTime
+#include "src/core/file.h"     // for File
+
+
+namespace
+{
+
+/* The columns of the points section, in the order they are stored. */
+enum Column {
+  kLat, kLon, kAlt, kTime, kOffset, kFlags, kHdop, kVdop, kPdop,
+  kCourse, kSpeed, kPower, kOdometer, kSat, kFix, kHeartrate, kCadence,
+  kSession, kName, kDesc, kNotes, kIcon, kExtra, kColumnCount
+};
+
+constexpr int kColumnWidth[kColumnCount] = {
+  8, 8, 8, 8, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 4, 1, 1, 1,
+  4, 4, 4, 4, 4, 4
+};
+
+/* The cold fields that are set, stored with the point flags. */
+constexpr quint32 kHasTemperature = 1U << 13;
+constexpr quint32 kHasProximity = 1U << 14;
+constexpr quint32 kHasGeoidheight = 1U << 15;
+constexpr quint32 kHasDepth = 1U << 16;
+
+/* The parts of an extra record. */
+constexpr quint8 kExtraCold = 1;
+constexpr quint8 kExtraUrls = 2;
+constexpr quint8 kExtraGeocache = 4;
+constexpr quint8 kExtraGarmin = 8;
+
+constexpr int kHeaderSize = 16;
+constexpr int kIndexEntrySize = 24;
+constexpr int kSectionCount = 5;
+constexpr int kRouteEntrySize = 56;
+
+quint64 padded(quint64 size)
+{
+  return (size + 7) & ~quint64{7};
+}
+
+template <typename T>
+void put(QByteArray& buf, T value)
+{
+  T le = qToLittleEndian(value);
+  buf.append(reinterpret_cast<const char*>(&le), sizeof(T));
+}
+
+template <typename T>
+T get(const char* p)
+{
+  T value;
+  memcpy(&value, p, sizeof(T));
+  return qFromLittleEndian(value);
+}
+
+void pad(QByteArray& buf)
+{
+  buf.append(padded(buf.size()) - buf.size(), '\0');
+}
+
+/* The start of every column of a points section with count points. */
+void column_offsets(quint64 count, quint64* offsets)
+{
+  quint64 offset = 8;
+  for (int c = 0; c < kColumnCount; ++c) {
+    offsets[c] = offset;
+    offset += padded(count * kColumnWidth[c]);
+  }
+  offsets[kColumnCount] = offset;
+}
+
+void write_urls(QDataStream& stream, const UrlList& urls)
+{
+  stream << static_cast<quint32>(urls.size());
+  for (const auto& url : urls) {
+    stream << url.url_ << url.url_link_text_ << url.url_link_type_;
+  }
+}
+
+UrlList read_urls(QDataStream& stream)
+{
+  UrlList urls;
+  quint32 count;
+  stream >> count;
+  for (quint32 i = 0; (i < count) && (stream.status() == QDataStream::Ok); ++i) {
+    QString url;
+    QString text;
+    QString type;
+    stream >> url >> text >> type;
+    urls.AddUrlLink(UrlLink(url, text, type));
+  }
+  return urls;
+}
+
+void write_utf_string(QDataStream& stream, const Geocache::UtfString& s)
+{
+  stream << s.is_html << s.get_text();
+}
+
+void read_utf_string(QDataStream& stream, Geocache::UtfString* s)
+{
+  QString text;
+  stream >> s->is_html >> text;
+  s->set_text(text);
+}
+
+} // namespace
+
+/*******************************************************************************
+* %%%        writing                                                       %%% *
+*******************************************************************************/
+
+void
+GbcacheFormat::wr_init(const QString& fname)
+{
+  fname_ = fname;
+  string_index_.clear();
+  strings_ = {QByteArray()};
+  session_index_.clear();
+  sessions_.clear();
+  points_.clear();
+  routes_.clear();
+  extras_ = {QByteArray()};
+}
+
+quint32
+GbcacheFormat::string_ref(const QString& s)
+{
+  if (s.isNull()) {
+    return 0;
+  }
+  auto it = string_index_.constFind(s);
+  if (it != string_index_.constEnd()) {
+    return *it;
+  }
+  auto ref = static_cast<quint32>(strings_.size());
+  strings_.append(s.toUtf8());
+  string_index_.insert(s, ref);
+  return ref;
+}
+
+quint32
+GbcacheFormat::point_extra(const Waypoint* wpt)
+{
+  quint8 parts = 0;
+  if (wpt->temperature_has_value() || wpt->proximity_has_value() ||
+      wpt->geoidheight_has_value() || wpt->depth_has_value()) {
+    parts |= kExtraCold;
+  }
+  if (wpt->HasUrlLink()) {
+    parts |= kExtraUrls;
+  }
+  if (!wpt->EmptyGCData()) {
+    parts |= kExtraGeocache;
+  }
+  const garmin_fs_t* gmsd = garmin_fs_t::find(wpt);
+  if (gmsd != nullptr) {
+    parts |= kExtraGarmin;
+  }
+  if (parts == 0) {
+    return 0;
+  }
+
+  QByteArray record;
+  QDataStream stream(&record, QIODevice::WriteOnly);
+  stream.setVersion(QDataStream::Qt_6_0);
+  stream << parts;
+  if (parts & kExtraCold) {
+    stream << wpt->temperature_value_or(0) << wpt->proximity_value_or(0)
+           << wpt->geoidheight_value_or(0) << wpt->depth_value_or(0);
+  }
+  if (parts & kExtraUrls) {
+    write_urls(stream, wpt->GetUrlList());
+  }
+  if (parts & kExtraGeocache) {
+    const Geocache* gc = wpt->gc_data;
+    stream << static_cast<qint64>(gc->id) << static_cast<qint32>(gc->type)
+           << static_cast<qint32>(gc->container)
+           << static_cast<quint32>(gc->diff) << static_cast<quint32>(gc->terr)
+           << static_cast<qint32>(gc->is_archived) << static_cast<qint32>(gc->is_available)
+           << static_cast<qint32>(gc->is_memberonly) << static_cast<qint32>(gc->has_customcoords)
+           << static_cast<const QDateTime&>(gc->last_found)
+           << gc->placer << static_cast<qint32>(gc->placer_id) << gc->hint;
+    write_utf_string(stream, gc->desc_short);
+    write_utf_string(stream, gc->desc_long);
+    stream << static_cast<qint32>(gc->favorite_points) << gc->personal_note;
+  }
+  if (parts & kExtraGarmin) {
+    const garmin_fs_flags_t& f = gmsd->flags;
+    quint32 flags = f.icon | (f.wpt_class << 1) | (f.display << 2) | (f.category << 3) |
+                    (f.city << 4) | (f.state << 5) | (f.facility << 6) | (f.cc << 7) |
+                    (f.cross_road << 8) | (f.addr << 9) | (f.country << 10) |
+                    (f.phone_nr << 11) | (f.phone_nr2 << 12) | (f.fax_nr << 13) |
+                    (f.postal_code << 14) | (f.email << 15) | (f.duration << 16);
+    stream << flags << static_cast<qint32>(gmsd->protocol) << static_cast<qint32>(gmsd->icon)
+           << static_cast<qint32>(gmsd->wpt_class) << static_cast<qint32>(gmsd->display)
+           << static_cast<qint16>(gmsd->category)
+           << gmsd->city << gmsd->facility << gmsd->state << gmsd->cc << gmsd->cross_road
+           << gmsd->addr << gmsd->country << gmsd->phone_nr << gmsd->phone_nr2
+           << gmsd->fax_nr << gmsd->postal_code << gmsd->email
+           << static_cast<quint32>(gmsd->duration)
+           << static_cast<quint32>(gmsd->ilinks.size());
+    for (const auto& link : gmsd->ilinks) {
+      stream << link.lat << link.lon << link.alt;
+    }
+  }
+  auto ref = static_cast<quint32>(extras_.size());
+  extras_.append(record);
+  return ref;
+}
+
+quint32
+GbcacheFormat::route_extra(const route_head* rte)
+{
+  if (rte->rte_urls.isEmpty()) {
+    return 0;
+  }
+  QByteArray record;
+  QDataStream stream(&record, QIODevice::WriteOnly);
+  stream.setVersion(QDataStream::Qt_6_0);
+  stream << kExtraUrls;
+  write_urls(stream, rte->rte_urls);
+  auto ref = static_cast<quint32>(extras_.size());
+  extras_.append(record);
+  return ref;
+}
+
+void
+GbcacheFormat::add_point(const Waypoint* wpt)
+{
+  points_.append(wpt);
+  if ((wpt->session != nullptr) && !session_index_.contains(wpt->session)) {
+    session_index_.insert(wpt->session, sessions_.size() + 1);
+    sessions_.append(wpt->session);
+  }
+}
+
+void
+GbcacheFormat::add_route(const route_head* rte, bool is_track)
+{
+  routes_.append({rte, is_track, static_cast<quint64>(points_.size())});
+  if ((rte->session != nullptr) && !session_index_.contains(rte->session)) {
+    session_index_.insert(rte->session, sessions_.size() + 1);
+    sessions_.append(rte->session);
+  }
+  for (const Waypoint* wpt : rte->waypoint_list) {
+    add_point(wpt);
+  }
+}
+
+void
+GbcacheFormat::write()
+{
+  for (const Waypoint* wpt : waypt_range()) {
+    add_point(wpt);
+  }
+  const auto waypoint_count = static_cast<quint64>(points_.size());
+  for (const route_head* rte : route_range()) {
+    add_route(rte, false);
+  }
+  for (const route_head* rte : track_range()) {
+    add_route(rte, true);
+  }
+
+  const auto count = static_cast<quint64>(points_.size());
+
+  // The strings come first in the file but last here, as the other
+  // sections add to them.
+  QByteArray points;
+  put<quint64>(points, count);
+  for (int c = 0; c < kColumnCount; ++c) {
+    for (const Waypoint* wpt : std::as_const(points_)) {
+      switch (c) {
+      case kLat:
+        put<double>(points, wpt->latitude);
+        break;
+      case kLon:
+        put<double>(points, wpt->longitude);
+        break;
+      case kAlt:
+        put<double>(points, wpt->altitude);
+        break;
+      case kTime:
+        put<qint64>(points, wpt->creation_time.QDateTime::isValid() ? wpt->creation_time.toMSecsSinceEpoch() : 0);
+        break;
+      case kOffset:
+        put<qint32>(points, wpt->creation_time.QDateTime::isValid() ? wpt->creation_time.offsetFromUtc() : 0);
+        break;
+      case kFlags: {
+        const wp_flags& f = wpt->wpt_flags;
+        quint32 flags = f.shortname_is_synthetic | (f.fmt_use << 1) | (f.is_split << 3) |
+                        (f.new_trkseg << 4) | (f.marked_for_deletion << 5);
+        if (wpt->course_has_value()) {
+          flags |= kHasCourse;
+        }
+        if (wpt->speed_has_value()) {
+          flags |= kHasSpeed;
+        }
+        if (wpt->creation_time.QDateTime::isValid()) {
+          flags |= kTimeValid;
+          if (wpt->creation_time.timeSpec() == Qt::LocalTime) {
+            flags |= kTimeLocal;
+          } else if (wpt->creation_time.timeSpec() != Qt::UTC) {
+            flags |= kTimeOffset;
+          }
+        }
+        if (wpt->temperature_has_value()) {
+          flags |= kHasTemperature;
+        }
+        if (wpt->proximity_has_value()) {
+          flags |= kHasProximity;
+        }
+        if (wpt->geoidheight_has_value()) {
+          flags |= kHasGeoidheight;
+        }
+        if (wpt->depth_has_value()) {
+          flags |= kHasDepth;
+        }
+        put<quint32>(points, flags);
+        break;
+      }
+      case kHdop:
+        put<float>(points, wpt->hdop);
+        break;
+      case kVdop:
+        put<float>(points, wpt->vdop);
+        break;
+      case kPdop:
+        put<float>(points, wpt->pdop);
+        break;
+      case kCourse:
+        put<float>(points, wpt->course_value_or(0));
+        break;
+      case kSpeed:
+        put<float>(points, wpt->speed_value_or(0));
+        break;
+      case kPower:
+        put<float>(points, wpt->power);
+        break;
+      case kOdometer:
+        put<float>(points, wpt->odometer_distance);
+        break;
+      case kSat:
+        put<qint32>(points, wpt->sat);
+        break;
+      case kFix:
+        put<qint8>(points, static_cast<qint8>(wpt->fix));
+        break;
+      case kHeartrate:
+        put<quint8>(points, wpt->heartrate);
+        break;
+      case kCadence:
+        put<quint8>(points, wpt->cadence);
+        break;
+      case kSession:
+        put<quint32>(points, session_index_.value(wpt->session, 0));
+        break;
+      case kName:
+        put<quint32>(points, string_ref(wpt->shortname));
+        break;
+      case kDesc:
+        put<quint32>(points, string_ref(wpt->description));
+        break;
+      case kNotes:
+        put<quint32>(points, string_ref(wpt->notes));
+        break;
+      case kIcon:
+        put<quint32>(points, string_ref(wpt->icon_descr));
+        break;
+      case kExtra:
+        put<quint32>(points, point_extra(wpt));
+        break;
+      default:
+        break;
+      }
+    }
+    pad(points);
+  }
+
+  QByteArray routes;
+  put<quint64>(routes, waypoint_count);
+  put<quint64>(routes, routes_.size());
+  for (const RouteEntry& entry : std::as_const(routes_)) {
+    const route_head* rte = entry.rte;
+    put<quint32>(routes, entry.is_track);
+    put<quint32>(routes, string_ref(rte->rte_name));
+    put<quint32>(routes, string_ref(rte->rte_desc));
+    put<qint32>(routes, rte->rte_num);
+    put<quint32>(routes, session_index_.value(rte->session, 0));
+    put<qint32>(routes, rte->line_color.bbggrr);
+    put<qint32>(routes, rte->line_color.opacity);
+    put<qint32>(routes, rte->line_width);
+    put<quint64>(routes, entry.first);
+    put<quint64>(routes, rte->rte_waypt_ct());
+    put<quint32>(routes, route_extra(rte));
+    put<quint32>(routes, 0);
+  }
+
+  QByteArray sessions;
+  put<quint32>(sessions, sessions_.size());
+  put<quint32>(sessions, 0);
+  for (const session_t* se : std::as_const(sessions_)) {
+    put<quint32>(sessions, string_ref(se->name));
+    put<quint32>(sessions, string_ref(se->filename));
+  }
+
+  QByteArray extras;
+  put<quint64>(extras, extras_.size());
+  quint64 extra_offset = 0;
+  for (const QByteArray& record : std::as_const(extras_)) {
+    put<quint64>(extras, extra_offset);
+    extra_offset += record.size();
+  }
+  put<quint64>(extras, extra_offset);
+  for (const QByteArray& record : std::as_const(extras_)) {
+    extras.append(record);
+  }
+  pad(extras);
+
+  QByteArray strings;
+  put<quint32>(strings, strings_.size());
+  quint32 string_offset = 0;
+  for (const QByteArray& s : std::as_const(strings_)) {
+    put<quint32>(strings, string_offset);
+    string_offset += s.size();
+  }
+  put<quint32>(strings, string_offset);
+  for (const QByteArray& s : std::as_const(strings_)) {
+    strings.append(s);
+  }
+  pad(strings);
+
+  const QByteArray* sections[kSectionCount] = {&strings, &sessions, &points, &routes, &extras};
+  QByteArray header(kMagic, sizeof(kMagic));
+  put<quint32>(header, kVersion);
+  put<quint32>(header, kSectionCount);
+  quint64 offset = kHeaderSize + kSectionCount * kIndexEntrySize;
+  for (int s = 0; s < kSectionCount; ++s) {
+    put<quint32>(header, kStrings + s);
+    put<quint32>(header, 0);
+    put<quint64>(header, offset);
+    put<quint64>(header, sections[s]->size());
+    offset += padded(sections[s]->size());
+  }
+
+  gpsbabel::File file(fname_);
+  file.open(QIODevice::WriteOnly);
+  file.write(header);
+  for (const QByteArray* section : sections) {
+    QByteArray padding(padded(section->size()) - section->size(), '\0');
+    if ((file.write(*section) != section->size()) || (file.write(padding) != padding.size())) {
+      fatal("%s: Cannot write to \"%s\".\n", MYNAME, qPrintable(fname_));
+    }
+  }
+  file.close();
+}
+
+void
+GbcacheFormat::wr_deinit()
+{
+  string_index_.clear();
+  strings_.clear();
+  session_index_.clear();
+  sessions_.clear();
+  points_.clear();
+  routes_.clear();
+  extras_.clear();
+}
+
+/*******************************************************************************
+* %%%        reading                                                       %%% *
+*******************************************************************************/
+
+void
+GbcacheFormat::rd_init(const QString& fname)
+{
+  fname_ = fname;
+  file_ = std::make_unique<gpsbabel::File>(fname);
+  file_->open(QIODevice::ReadOnly);
+  // Mapped files are used in place, anything else is read in.
+  if (!file_->isSequential()) {
+    mapping_ = file_->map(0, file_->size());
+  }
+  if (mapping_ != nullptr) {
+    base_ = reinterpret_cast<const char*>(mapping_);
+    length_ = file_->size();
+  } else {
+    contents_ = file_->readAll();
+    base_ = contents_.constData();
+    length_ = contents_.size();
+  }
+
+  if ((length_ < kHeaderSize) || (memcmp(base_, kMagic, sizeof(kMagic)) != 0)) {
+    fatal("%s: \"%s\" is not a GPSBabel cache file.\n", MYNAME, qPrintable(fname));
+  }
+  if (get<quint32>(base_ + 8) != kVersion) {
+    fatal("%s: \"%s\" was written by a different version of GPSBabel.\n", MYNAME, qPrintable(fname));
+  }
+}
+
+GbcacheFormat::SectionView
+GbcacheFormat::section(quint32 id) const
+{
+  const auto count = get<quint32>(base_ + 12);
+  if (kHeaderSize + static_cast<quint64>(count) * kIndexEntrySize <= static_cast<quint64>(length_)) {
+    for (quint32 s = 0; s < count; ++s) {
+      const char* entry = base_ + kHeaderSize + s * kIndexEntrySize;
+      const auto offset = get<quint64>(entry + 8);
+      const auto size = get<quint64>(entry + 16);
+      if ((get<quint32>(entry) == id) && (offset <= static_cast<quint64>(length_)) &&
+          (size <= static_cast<quint64>(length_) - offset)) {
+        return {base_ + offset, size};
+      }
+    }
+  }
+  fatal("%s: \"%s\" is damaged.\n", MYNAME, qPrintable(fname_));
+}
+
+QString
+GbcacheFormat::string_at(quint32 ref) const
+{
+  if ((ref == 0) || (ref >= static_cast<quint32>(string_offsets_.size() - 1))) {
+    return QString();
+  }
+  const SectionView strings = section(kStrings);
+  const char* bytes = strings.data + 4 + 4 * string_offsets_.size();
+  const quint32 begin = string_offsets_.at(ref);
+  const quint32 end = string_offsets_.at(ref + 1);
+  return QString::fromUtf8(bytes + begin, end - begin);
+}
+
+void
+GbcacheFormat::read_extra(quint32 ref, Waypoint* wpt) const
+{
+  const SectionView extras = section(kExtras);
+  const auto count = get<quint64>(extras.data);
+  if ((ref == 0) || (ref >= count) || ((count + 2) * 8 > extras.size)) {
+    return;
+  }
+  const char* offsets = extras.data + 8;
+  const char* records = offsets + (count + 1) * 8;
+  const auto begin = get<quint64>(offsets + ref * 8);
+  const auto end = get<quint64>(offsets + (ref + 1) * 8);
+  if ((begin > end) || (records + end > extras.data + extras.size)) {
+    fatal("%s: \"%s\" is damaged.\n", MYNAME, qPrintable(fname_));
+  }
+
+  QByteArray record = QByteArray::fromRawData(records + begin, end - begin);
+  QDataStream stream(record);
+  stream.setVersion(QDataStream::Qt_6_0);
+  quint8 parts;
+  stream >> parts;
+  if (parts & kExtraCold) {
+    float temperature;
+    double proximity;
+    double geoidheight;
+    double depth;
+    stream >> temperature >> proximity >> geoidheight >> depth;
+    // The point flags tell which of them are set.
+    if (wpt->temperature_has_value()) {
+      wpt->set_temperature(temperature);
+    }
+    if (wpt->proximity_has_value()) {
+      wpt->set_proximity(proximity);
+    }
+    if (wpt->geoidheight_has_value()) {
+      wpt->set_geoidheight(geoidheight);
+    }
+    if (wpt->depth_has_value()) {
+      wpt->set_depth(depth);
+    }
+  }
+  if (parts & kExtraUrls) {
+    for (const auto& url : read_urls(stream)) {
+      wpt->AddUrlLink(url);
+    }
+  }
+  if (parts & kExtraGeocache) {
+    Geocache* gc = wpt->AllocGCData();
+    qint64 id;
+    qint32 type;
+    qint32 container;
+    quint32 diff;
+    quint32 terr;
+    qint32 is_archived;
+    qint32 is_available;
+    qint32 is_memberonly;
+    qint32 has_customcoords;
+    QDateTime last_found;
+    qint32 placer_id;
+    qint32 favorite_points;
+    stream >> id >> type >> container >> diff >> terr >> is_archived >> is_available
+           >> is_memberonly >> has_customcoords >> last_found >> gc->placer >> placer_id >> gc->hint;
+    read_utf_string(stream, &gc->desc_short);
+    read_utf_string(stream, &gc->desc_long);
+    stream >> favorite_points >> gc->personal_note;
+    gc->id = id;
+    gc->type = static_cast<Geocache::type_t>(type);
+    gc->container = static_cast<Geocache::container_t>(container);
+    gc->diff = diff;
+    gc->terr = terr;
+    gc->is_archived = static_cast<Geocache::status_t>(is_archived);
+    gc->is_available = static_cast<Geocache::status_t>(is_available);
+    gc->is_memberonly = static_cast<Geocache::status_t>(is_memberonly);
+    gc->has_customcoords = static_cast<Geocache::status_t>(has_customcoords);
+    gc->last_found = last_found;
+    gc->placer_id = placer_id;
+    gc->favorite_points = favorite_points;
+  }
+  if (parts & kExtraGarmin) {
+    quint32 flags;
+    qint32 protocol;
+    qint32 icon;
+    qint32 wpt_class;
+    qint32 display;
+    qint16 category;
+    quint32 duration;
+    quint32 links;
+    stream >> flags >> protocol;
+    auto* gmsd = new garmin_fs_t(protocol);
+    stream >> icon >> wpt_class >> display >> category
+           >> gmsd->city >> gmsd->facility >> gmsd->state >> gmsd->cc >> gmsd->cross_road
+           >> gmsd->addr >> gmsd->country >> gmsd->phone_nr >> gmsd->phone_nr2
+           >> gmsd->fax_nr >> gmsd->postal_code >> gmsd->email >> duration >> links;
+    gmsd->icon = icon;
+    gmsd->wpt_class = wpt_class;
+    gmsd->display = display;
+    gmsd->category = category;
+    gmsd->duration = duration;
+    for (quint32 i = 0; (i < links) && (stream.status() == QDataStream::Ok); ++i) {
+      garmin_ilink_t link;
+      stream >> link.lat >> link.lon >> link.alt;
+      gmsd->ilinks.append(link);
+    }
+    garmin_fs_flags_t& f = gmsd->flags;
+    f.icon = flags & 1;
+    f.wpt_class = (flags >> 1) & 1;
+    f.display = (flags >> 2) & 1;
+    f.category = (flags >> 3) & 1;
+    f.city = (flags >> 4) & 1;
+    f.state = (flags >> 5) & 1;
+    f.facility = (flags >> 6) & 1;
+    f.cc = (flags >> 7) & 1;
+    f.cross_road = (flags >> 8) & 1;
+    f.addr = (flags >> 9) & 1;
+    f.country = (flags >> 10) & 1;
+    f.phone_nr = (flags >> 11) & 1;
+    f.phone_nr2 = (flags >> 12) & 1;
+    f.fax_nr = (flags >> 13) & 1;
+    f.postal_code = (flags >> 14) & 1;
+    f.email = (flags >> 15) & 1;
+    f.duration = (flags >> 16) & 1;
+    wpt->fs.FsChainAdd(gmsd);
+  }
+  if (stream.status() != QDataStream::Ok) {
+    fatal("%s: \"%s\" is damaged.\n", MYNAME, qPrintable(fname_));
+  }
+}
+
+void
+GbcacheFormat::read_extra(quint32 ref, route_head* rte) const
+{
+  const SectionView extras = section(kExtras);
+  const auto count = get<quint64>(extras.data);
+  if ((ref == 0) || (ref >= count) || ((count + 2) * 8 > extras.size)) {
+    return;
+  }
+  const char* offsets = extras.data + 8;
+  const char* records = offsets + (count + 1) * 8;
+  const auto begin = get<quint64>(offsets + ref * 8);
+  const auto end = get<quint64>(offsets + (ref + 1) * 8);
+  if ((begin > end) || (records + end > extras.data + extras.size)) {
+    fatal("%s: \"%s\" is damaged.\n", MYNAME, qPrintable(fname_));
+  }
+
+  QByteArray record = QByteArray::fromRawData(records + begin, end - begin);
+  QDataStream stream(record);
+  stream.setVersion(QDataStream::Qt_6_0);
+  quint8 parts;
+  stream >> parts;
+  if (parts & kExtraUrls) {
+    rte->rte_urls = read_urls(stream);
+  }
+  if (stream.status() != QDataStream::Ok) {
+    fatal("%s: \"%s\" is damaged.\n", MYNAME, qPrintable(fname_));
+  }
+}
+
+Waypoint*
+GbcacheFormat::read_point(quint64 i) const
+{
+  const SectionView points = section(kPoints);
+  const auto count = get<quint64>(points.data);
+  quint64 offsets[kColumnCount + 1];
+  column_offsets(count, offsets);
+  auto col = [&points, &offsets, i](int c)->const char* {
+    return points.data + offsets[c] + i * kColumnWidth[c];
+  };
+
+  auto* wpt = new Waypoint;
+  wpt->latitude = get<double>(col(kLat));
+  wpt->longitude = get<double>(col(kLon));
+  wpt->altitude = get<double>(col(kAlt));
+
+  const auto flags = get<quint32>(col(kFlags));
+  wpt->wpt_flags.shortname_is_synthetic = flags & 1;
+  wpt->wpt_flags.fmt_use = (flags >> 1) & 3;
+  wpt->wpt_flags.is_split = (flags >> 3) & 1;
+  wpt->wpt_flags.new_trkseg = (flags >> 4) & 1;
+  wpt->wpt_flags.marked_for_deletion = (flags >> 5) & 1;
+
+  if (flags & kTimeValid) {
+    const auto msecs = get<qint64>(col(kTime));
+    if (flags & kTimeLocal) {
+      wpt->creation_time = QDateTime::fromMSecsSinceEpoch(msecs, Qt::LocalTime);
+    } else if (flags & kTimeOffset) {
+      wpt->creation_time = QDateTime::fromMSecsSinceEpoch(msecs, QTimeZone(get<qint32>(col(kOffset))));
+    } else {
+      wpt->creation_time = gpsbabel::DateTime::fromMSecsSinceEpochUtc(msecs);
+    }
+  } else {
+    wpt->creation_time = QDateTime();
+  }
+
+  wpt->hdop = get<float>(col(kHdop));
+  wpt->vdop = get<float>(col(kVdop));
+  wpt->pdop = get<float>(col(kPdop));
+  if (flags & kHasCourse) {
+    wpt->set_course(get<float>(col(kCourse)));
+  }
+  if (flags & kHasSpeed) {
+    wpt->set_speed(get<float>(col(kSpeed)));
+  }
+  wpt->power = get<float>(col(kPower));
+  wpt->odometer_distance = get<float>(col(kOdometer));
+  wpt->sat = get<qint32>(col(kSat));
+  wpt->fix = static_cast<fix_type>(get<qint8>(col(kFix)));
+  wpt->heartrate = get<quint8>(col(kHeartrate));
+  wpt->cadence = get<quint8>(col(kCadence));
+
+  const auto se = get<quint32>(col(kSession));
+  wpt->session = ((se > 0) && (se <= static_cast<quint32>(read_sessions_.size()))) ?
+                 read_sessions_.at(se - 1) : nullptr;
+  wpt->shortname = string_at(get<quint32>(col(kName)));
+  wpt->description = string_at(get<quint32>(col(kDesc)));
+  wpt->notes = string_at(get<quint32>(col(kNotes)));
+  wpt->icon_descr = string_at(get<quint32>(col(kIcon)));
+
+  // Placeholders tell read_extra() which cold fields are set.
+  if (flags & kHasTemperature) {
+    wpt->set_temperature(0);
+  }
+  if (flags & kHasProximity) {
+    wpt->set_proximity(0);
+  }
+  if (flags & kHasGeoidheight) {
+    wpt->set_geoidheight(0);
+  }
+  if (flags & kHasDepth) {
+    wpt->set_depth(0);
+  }
+  read_extra(get<quint32>(col(kExtra)), wpt);
+  return wpt;
+}
+
+void
+GbcacheFormat::read()
+{
+  const SectionView strings = section(kStrings);
+  const auto string_count = get<quint32>(strings.data);
+  if (4 + 4 * (static_cast<quint64>(string_count) + 1) > strings.size) {
+    fatal("%s: \"%s\" is damaged.\n", MYNAME, qPrintable(fname_));
+  }
+  string_offsets_.resize(string_count + 1);
+  for (quint32 s = 0; s <= string_count; ++s) {
+    string_offsets_[s] = get<quint32>(strings.data + 4 + 4 * s);
+    if ((string_offsets_[s] > strings.size - (4 + 4 * (string_count + 1))) ||
+        ((s > 0) && (string_offsets_[s] < string_offsets_[s - 1]))) {
+      fatal("%s: \"%s\" is damaged.\n", MYNAME, qPrintable(fname_));
+    }
+  }
+
+  const SectionView sessions = section(kSessions);
+  const auto session_count = get<quint32>(sessions.data);
+  if (8 + 8 * static_cast<quint64>(session_count) > sessions.size) {
+    fatal("%s: \"%s\" is damaged.\n", MYNAME, qPrintable(fname_));
+  }
+  read_sessions_.clear();
+  for (quint32 s = 0; s < session_count; ++s) {
+    const char* entry = sessions.data + 8 + 8 * s;
+    read_sessions_.append(start_session(string_at(get<quint32>(entry)),
+                                        string_at(get<quint32>(entry + 4))));
+  }
+
+  const SectionView points = section(kPoints);
+  const auto count = get<quint64>(points.data);
+  quint64 offsets[kColumnCount + 1];
+  column_offsets(count, offsets);
+  if ((count > points.size) || (offsets[kColumnCount] > points.size)) {
+    fatal("%s: \"%s\" is damaged.\n", MYNAME, qPrintable(fname_));
+  }
+
+  const SectionView routes = section(kRoutes);
+  const auto waypoint_count = get<quint64>(routes.data);
+  const auto route_count = get<quint64>(routes.data + 8);
+  if ((waypoint_count > count) || (route_count > routes.size) ||
+      (16 + route_count * kRouteEntrySize > routes.size)) {
+    fatal("%s: \"%s\" is damaged.\n", MYNAME, qPrintable(fname_));
+  }
+
+  for (quint64 i = 0; i < waypoint_count; ++i) {
+    waypt_add(read_point(i));
+  }
+  for (quint64 r = 0; r < route_count; ++r) {
+    const char* entry = routes.data + 16 + r * kRouteEntrySize;
+    const bool is_track = get<quint32>(entry) != 0;
+    const auto first = get<quint64>(entry + 32);
+    const auto points_in_route = get<quint64>(entry + 40);
+    if ((first > count) || (points_in_route > count - first)) {
+      fatal("%s: \"%s\" is damaged.\n", MYNAME, qPrintable(fname_));
+    }
+
+    auto* rte = new route_head;
+    rte->rte_name = string_at(get<quint32>(entry + 4));
+    rte->rte_desc = string_at(get<quint32>(entry + 8));
+    rte->rte_num = get<qint32>(entry + 12);
+    const auto se = get<quint32>(entry + 16);
+    rte->session = ((se > 0) && (se <= static_cast<quint32>(read_sessions_.size()))) ?
+                   read_sessions_.at(se - 1) : nullptr;
+    rte->line_color.bbggrr = get<qint32>(entry + 20);
+    rte->line_color.opacity = get<qint32>(entry + 24);
+    rte->line_width = get<qint32>(entry + 28);
+    read_extra(get<quint32>(entry + 48), rte);
+
+    if (is_track) {
+      track_add_head(rte);
+    } else {
+      route_add_head(rte);
+    }
+    rte->waypoint_list.reserve(points_in_route);
+    for (quint64 i = first; i < first + points_in_route; ++i) {
+      Waypoint* wpt = read_point(i);
+      const wp_flags flags = wpt->wpt_flags;
+      if (is_track) {
+        track_add_wpt(rte, wpt);
+      } else {
+        route_add_wpt(rte, wpt);
+      }
+      wpt->wpt_flags = flags;
+    }
+  }
+}
+
+void
+GbcacheFormat::rd_deinit()
+{
+  if (mapping_ != nullptr) {
+    file_->unmap(mapping_);
+    mapping_ = nullptr;
+  }
+  file_.reset();
+  contents_.clear();
+  base_ = nullptr;
+  length_ = 0;
+  string_offsets_.clear();
+  read_sessions_.clear();
+}
@@ -0,0 +1,154 @@
+/*
+    GPSBabel's own binary cache format.
+
+    Copyright (C) 2026 Robert Lipe, robertlipe+source@gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+#ifndef GBCACHE_H_INCLUDED_
+#define GBCACHE_H_INCLUDED_
+
+#include <memory>              // for unique_ptr
+
+#include <QByteArray>          // for QByteArray
+#include <QHash>               // for QHash
+#include <QString>             // for QString
+#include <QVector>             // for QVector
+#include <QtGlobal>            // for quint32, quint64, qint64
+
+#include "defs.h"              // for ff_cap, ff_cap_read, ff_cap_write, ff_type, ff_type_file, Waypoint, route_head
+#include "format.h"            // for Format
+#include "session.h"           // for session_t
+#include "src/core/file.h"     // for File
+
+/*
+ * Everything a run holds in memory, written so that it reads back
+ * without any parsing: the points are stored column by column, each
+ * column a plain little endian array that is used in place from a
+ * mapping of the file.
+ *
+ * The file starts with a header and an index of its sections, each of
+ * which starts on an 8 byte boundary:
+ *
+ *   strings   every distinct string once, as UTF-8 with their offsets
+ *   sessions  the format and file name of every input
+ *   points    the waypoints, then the points of every route and track
+ *   routes    the routes and tracks, each a range of the points
+ *   extras    the rarely set fields of some points and routes, e.g.
+ *             URLs, geocache data and Garmin specific data
+ *
+ * Strings are referred to by number, 0 being the null string, and
+ * extras likewise.
+ */
+class GbcacheFormat : public Format
+{
+public:
+  using Format::Format;
+
+  ff_type get_type() const override
+  {
+    return ff_type_file;
+  }
+
+  QVector<ff_cap> get_cap() const override
+  {
+    return {
+      (ff_cap)(ff_cap_read | ff_cap_write),  // waypoints
+      (ff_cap)(ff_cap_read | ff_cap_write),  // tracks
+      (ff_cap)(ff_cap_read | ff_cap_write)   // routes
+    };
+  }
+
+  void rd_init(const QString& fname) override;
+  void read() override;
+  void rd_deinit() override;
+  void wr_init(const QString& fname) override;
+  void write() override;
+  void wr_deinit() override;
+
+private:
+  /* Constants */
+
+  static constexpr char MYNAME[] = "gbcache";
+  static constexpr char kMagic[8] = {'G', 'B', 'C', 'A', 'C', 'H', 'E', '\0'};
+  static constexpr quint32 kVersion = 1;
+
+  enum Section : quint32 {
+    kStrings = 1,
+    kSessions,
+    kPoints,
+    kRoutes,
+    kExtras
+  };
+
+  /* Point flags, besides the wp_flags in the low bits. */
+  static constexpr quint32 kHasCourse = 1U << 8;
+  static constexpr quint32 kHasSpeed = 1U << 9;
+  static constexpr quint32 kTimeValid = 1U << 10;
+  static constexpr quint32 kTimeLocal = 1U << 11;
+  static constexpr quint32 kTimeOffset = 1U << 12;
+
+  /* Types */
+
+  /* A section as mapped or read. */
+  struct SectionView {
+    const char* data{nullptr};
+    quint64 size{0};
+  };
+
+  /* Member Functions */
+
+  quint32 string_ref(const QString& s);
+  quint32 point_extra(const Waypoint* wpt);
+  quint32 route_extra(const route_head* rte);
+  void add_point(const Waypoint* wpt);
+  void add_route(const route_head* rte, bool is_track);
+
+  SectionView section(quint32 id) const;
+  QString string_at(quint32 ref) const;
+  Waypoint* read_point(quint64 i) const;
+  void read_extra(quint32 ref, Waypoint* wpt) const;
+  void read_extra(quint32 ref, route_head* rte) const;
+
+  /* Data Members */
+
+  QString fname_;
+
+  // writing
+  QHash<QString, quint32> string_index_;
+  QVector<QByteArray> strings_;
+  QHash<const session_t*, quint32> session_index_;
+  QVector<const session_t*> sessions_;
+  QVector<const Waypoint*> points_;
+  struct RouteEntry {
+    const route_head* rte;
+    bool is_track;
+    quint64 first;
+  };
+  QVector<RouteEntry> routes_;
+  QVector<QByteArray> extras_;
+
+  // reading
+  QByteArray contents_;
+  const char* base_{nullptr};
+  qint64 length_{0};
+  uchar* mapping_{nullptr};
+  std::unique_ptr<gpsbabel::File> file_;
+  QVector<quint32> string_offsets_;
+  QVector<const session_t*> read_sessions_;
+};
+
+#endif // GBCACHE_H_INCLUDED_
@@ -23,18 +23,37 @@
 #include <QByteArray>          // for QByteArray
 #include <QChar>               // for QChar, operator==, operator!=
 #include <QDebug>              // for QDebug
+#include <QFile>               // for QFile
+#include <QFileDevice>         // for QFileDevice::MapPrivateOption
+#include <QIODevice>           // for QIODevice::ReadOnly
 #include <QString>             // for QString
 #include <QtGlobal>            // for qPrintable
 
+#include <algorithm>           // for min
 #include <cassert>             // for assert
 #include <cctype>              // for tolower
 #include <cstdarg>             // for va_list, va_end, va_copy, va_start
-#include <cstdio>              // for EOF, ferror, ftell, SEEK_SET, SEEK_CUR, SEEK_END, clearerr, fclose, feof, fflush, fileno, fread, fseek, fwrite, ungetc, vsnprintf, FILE, stdin, stdout
+#include <cstddef>             // for size_t
+#include <cstdint>             // for uint32_t
+#include <cstdio>              // for EOF, ferror, SEEK_SET, SEEK_CUR, SEEK_END, clearerr, fclose, feof, fflush, fileno, fread, fwrite, setvbuf, ungetc, vsnprintf, FILE, stdin, stdout
 #include <cstring>             // for memcpy, strlen, strchr, strcpy, strncat
 
 #include "defs.h"
 #include "gbfile.h"
+#include "src/core/counters.h"  // for Counter
+#include "src/core/inputmapping.h"  // for InputMapping
 #include "src/core/logging.h"
+#include "src/core/memoryfile.h"  // for MemoryFiles
+#include "src/core/paralleldeflate.h"  // for ParallelDeflate
+#include "src/core/progress.h"    // for Progress
+#include "src/core/readahead.h"   // for ReadAhead
+
+#if HAVE_LIBZSTD
+#include <zstd.h>
+#endif
+#if HAVE_LIBLZMA
+#include <lzma.h>
+#endif
 
 #if __WIN32__
 /* taken from minigzip.c (part of the zlib project) */
@@ -45,9 +64,25 @@
 #  define SET_BINARY_MODE(file)
 #endif
 
+/* fseek and ftell take a long, which is only 32 bits on Windows. */
+#if __WIN32__
+#  define gb_fseek(file, offset, whence) _fseeki64((file), (offset), (whence))
+#  define gb_ftell(file) _ftelli64(file)
+#else
+#  define gb_fseek(file, offset, whence) fseeko((file), static_cast<off_t>(offset), (whence))
+#  define gb_ftell(file) static_cast<gboff_t>(ftello(file))
+#endif
+
 #define MYNAME "gbfile"
 #define NO_ZLIB MYNAME ": No zlib support.\n"
 
+static gpsbabel::Counter mem_read_counter("gbfile.bytes_read.memory");
+static gpsbabel::Counter mmap_read_counter("gbfile.bytes_read.mmap");
+static gpsbabel::Counter gzip_read_counter("gbfile.bytes_read.gzip");
+static gpsbabel::Counter zstd_read_counter("gbfile.bytes_read.zstd");
+static gpsbabel::Counter xz_read_counter("gbfile.bytes_read.xz");
+static gpsbabel::Counter std_read_counter("gbfile.bytes_read.stdio");
+
 /* About the ZLIB_INHIBITED stuff:
  *
  * If a user goes out of his way to build with ZLIB_INHIBITED set,
@@ -81,6 +116,11 @@ gzapi_open(gbfile* self, const char* mode)
   if (strchr(mode, 'b') == nullptr) {
     strncat(openmode, "b", sizeof(openmode) - strlen(openmode) - 1);
   }
+  int level = gpsbabel::ParallelDeflate::default_level();
+  if ((self->mode == 'w') && (level >= 0) && (level <= 9)) {
+    char digit[2] = {static_cast<char>('0' + level), '\0'};
+    strncat(openmode, digit, sizeof(openmode) - strlen(openmode) - 1);
+  }
 
   if (self->is_pipe) {
     FILE* fd;
@@ -119,14 +159,14 @@ gzapi_close(gbfile* self)
 }
 
 static int
-gzapi_seek(gbfile* self, int32_t offset, int whence)
+gzapi_seek(gbfile* self, gboff_t offset, int whence)
 {
   assert(whence != SEEK_END);
 
   if ((whence == SEEK_CUR) && (self->back != -1)) {
     offset--;
   }
-  int result = gzseek(self->handle.gz, offset, whence);
+  z_off_t result = gzseek(self->handle.gz, static_cast<z_off_t>(offset), whence);
   self->back = -1;
 
   if (result < 0) {
@@ -188,10 +228,10 @@ gzapi_flush(gbfile* self)
   return gzflush(self->handle.gz, Z_SYNC_FLUSH);
 }
 
-static gbsize_t
+static gboff_t
 gzapi_tell(gbfile* self)
 {
-  gbsize_t result = gztell(self->handle.gz);
+  gboff_t result = gztell(self->handle.gz);
   if (self->back != -1) {
     result--;
   }
@@ -258,6 +298,484 @@ gzapi_error(gbfile* self)
 #endif	// #if !ZLIB_INHIBITED
 
 
+#if !ZLIB_INHIBITED || HAVE_LIBZSTD || HAVE_LIBLZMA
+
+/*******************************************************************************/
+/* %%%           zstd, xz and parallel gzip streams (codecapi)             %%% */
+/*******************************************************************************/
+
+/*
+ * The stream is decoded or encoded a buffer at a time while it is read or
+ * written, so compressed files never have to be expanded in full.  Like
+ * zlib streams they can only be rewound or skipped forward.
+ */
+
+class GbfCodec
+{
+public:
+  GbfCodec(FILE* fd, const char* module) : fd_(fd), module_(module) {}
+  virtual ~GbfCodec() = default;
+  GbfCodec(const GbfCodec&) = delete;
+  GbfCodec& operator=(const GbfCodec&) = delete;
+
+  /* Returns the number of bytes decoded, less than len only at the end. */
+  virtual std::size_t decode(unsigned char* dst, std::size_t len) = 0;
+  virtual void encode(const void* src, std::size_t len) = 0;
+  virtual void flush() = 0;
+  virtual void finish() = 0;
+  /* Start decoding the stream again from the beginning. */
+  virtual void restart() = 0;
+
+  FILE* fd_;
+  const char* module_;
+  gboff_t pos_{0};	/* position in the decoded stream */
+
+protected:
+  static constexpr std::size_t kBufferSize = 128 * 1024;
+
+  /* Makes compressed input available, returns false at the end of the file. */
+  bool fill()
+  {
+    if (in_pos_ < in_len_) {
+      return true;
+    }
+    in_pos_ = 0;
+    in_len_ = fread(in_, 1, sizeof(in_), fd_);
+    if ((in_len_ == 0) && ferror(fd_)) {
+      fatal("%s: Error reading compressed file!\n", module_);
+    }
+    return in_len_ > 0;
+  }
+
+  void put(const unsigned char* data, std::size_t len)
+  {
+    if (fwrite(data, 1, len, fd_) != len) {
+      fatal("%s: Error writing compressed file!\n", module_);
+    }
+  }
+
+  void rewind_input()
+  {
+    if (fseek(fd_, 0, SEEK_SET) != 0) {
+      fatal("%s: This format cannot be used in piped commands!\n", module_);
+    }
+    in_pos_ = in_len_ = 0;
+    pos_ = 0;
+  }
+
+  unsigned char in_[kBufferSize];
+  std::size_t in_pos_{0};
+  std::size_t in_len_{0};
+  unsigned char out_[kBufferSize];
+};
+
+#if !ZLIB_INHIBITED
+/*
+ * gzip output compressed on several threads.  Reading is left to zlib,
+ * and as blocks are compressed ahead the stream can't be flushed.
+ */
+class GzipCodec : public GbfCodec
+{
+public:
+  GzipCodec(FILE* fd, const char* module) :
+    GbfCodec(fd, module),
+    deflater_([this](const char* data, qint64 len) {
+    put(reinterpret_cast<const unsigned char*>(data), len);
+  }, gpsbabel::ParallelDeflate::default_threads(), gpsbabel::ParallelDeflate::default_level())
+  {
+    /* magic, deflate, no flags, no time, no extra flags, unknown OS */
+    static const unsigned char header[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff};
+    put(header, sizeof(header));
+  }
+
+  std::size_t decode(unsigned char* /* dst */, std::size_t /* len */) override
+  {
+    fatal("%s: Cannot read from file opened for writing!\n", module_);
+  }
+
+  void encode(const void* src, std::size_t len) override
+  {
+    deflater_.write(static_cast<const char*>(src), len);
+    pos_ += len;
+  }
+
+  void flush() override {}
+
+  void finish() override
+  {
+    deflater_.finish();
+    unsigned char trailer[8];
+    le_write32(trailer, deflater_.crc());
+    le_write32(trailer + 4, deflater_.size());
+    put(trailer, sizeof(trailer));
+  }
+
+  void restart() override {}
+
+private:
+  gpsbabel::ParallelDeflate deflater_;
+};
+#endif // !ZLIB_INHIBITED
+
+#if HAVE_LIBZSTD
+class ZstdCodec : public GbfCodec
+{
+public:
+  ZstdCodec(FILE* fd, const char* module, bool writing) : GbfCodec(fd, module)
+  {
+    if (writing) {
+      cctx_ = ZSTD_createCCtx();
+    } else {
+      dctx_ = ZSTD_createDCtx();
+    }
+  }
+  ~ZstdCodec() override
+  {
+    ZSTD_freeCCtx(cctx_);
+    ZSTD_freeDCtx(dctx_);
+  }
+
+  std::size_t decode(unsigned char* dst, std::size_t len) override
+  {
+    ZSTD_outBuffer out{dst, len, 0};
+    while (out.pos < out.size) {
+      /* At the end of the file zstd may still hold decoded output, so
+       * keep asking with no input until it has nothing more to give. */
+      bool more = fill();
+      ZSTD_inBuffer in{in_, in_len_, in_pos_};
+      std::size_t out_before = out.pos;
+      std::size_t rc = ZSTD_decompressStream(dctx_, &out, &in);
+      if (ZSTD_isError(rc)) {
+        fatal("%s: zstd returned error '%s'!\n", module_, ZSTD_getErrorName(rc));
+      }
+      bool progress = (in.pos != in_pos_) || (out.pos != out_before);
+      in_pos_ = in.pos;
+      if (progress) {
+        in_frame_ = (rc != 0);
+      } else if (!more) {
+        if (in_frame_) {
+          fatal("%s: zstd stream is truncated!\n", module_);
+        }
+        break;
+      }
+    }
+    pos_ += out.pos;
+    return out.pos;
+  }
+
+  void encode(const void* src, std::size_t len) override
+  {
+    ZSTD_inBuffer in{src, len, 0};
+    while (in.pos < in.size) {
+      compress(&in, ZSTD_e_continue);
+    }
+    pos_ += len;
+  }
+
+  void flush() override
+  {
+    ZSTD_inBuffer in{nullptr, 0, 0};
+    while (compress(&in, ZSTD_e_flush) != 0) {}
+  }
+
+  void finish() override
+  {
+    ZSTD_inBuffer in{nullptr, 0, 0};
+    while (compress(&in, ZSTD_e_end) != 0) {}
+  }
+
+  void restart() override
+  {
+    rewind_input();
+    ZSTD_DCtx_reset(dctx_, ZSTD_reset_session_only);
+    in_frame_ = false;
+  }
+
+private:
+  std::size_t compress(ZSTD_inBuffer* in, ZSTD_EndDirective mode)
+  {
+    ZSTD_outBuffer out{out_, sizeof(out_), 0};
+    std::size_t rc = ZSTD_compressStream2(cctx_, &out, in, mode);
+    if (ZSTD_isError(rc)) {
+      fatal("%s: zstd returned error '%s'!\n", module_, ZSTD_getErrorName(rc));
+    }
+    put(out_, out.pos);
+    return rc;
+  }
+
+  ZSTD_CCtx* cctx_{nullptr};
+  ZSTD_DCtx* dctx_{nullptr};
+  bool in_frame_{false};	/* the last frame read from isn't complete */
+};
+#endif // HAVE_LIBZSTD
+
+#if HAVE_LIBLZMA
+class XzCodec : public GbfCodec
+{
+public:
+  XzCodec(FILE* fd, const char* module, bool writing) : GbfCodec(fd, module), writing_(writing)
+  {
+    init();
+  }
+  ~XzCodec() override
+  {
+    lzma_end(&strm_);
+  }
+
+  std::size_t decode(unsigned char* dst, std::size_t len) override
+  {
+    strm_.next_out = dst;
+    strm_.avail_out = len;
+    while ((strm_.avail_out > 0) && !ended_) {
+      bool more = fill();
+      strm_.next_in = in_ + in_pos_;
+      strm_.avail_in = in_len_ - in_pos_;
+      lzma_ret rc = lzma_code(&strm_, more ? LZMA_RUN : LZMA_FINISH);
+      in_pos_ = in_len_ - strm_.avail_in;
+      if (rc == LZMA_STREAM_END) {
+        ended_ = true;
+      } else if (rc != LZMA_OK) {
+        fatal("%s: liblzma returned error %d!\n", module_, static_cast<int>(rc));
+      }
+    }
+    std::size_t count = len - strm_.avail_out;
+    pos_ += count;
+    return count;
+  }
+
+  void encode(const void* src, std::size_t len) override
+  {
+    strm_.next_in = static_cast<const uint8_t*>(src);
+    strm_.avail_in = len;
+    while (strm_.avail_in > 0) {
+      compress(LZMA_RUN);
+    }
+    pos_ += len;
+  }
+
+  void flush() override
+  {
+    while (compress(LZMA_FULL_FLUSH) != LZMA_STREAM_END) {}
+  }
+
+  void finish() override
+  {
+    while (compress(LZMA_FINISH) != LZMA_STREAM_END) {}
+  }
+
+  void restart() override
+  {
+    rewind_input();
+    lzma_end(&strm_);
+    init();
+  }
+
+private:
+  void init()
+  {
+    strm_ = LZMA_STREAM_INIT;
+    ended_ = false;
+    lzma_ret rc = writing_ ? lzma_easy_encoder(&strm_, 6, LZMA_CHECK_CRC64) :
+                  lzma_stream_decoder(&strm_, UINT64_MAX, LZMA_CONCATENATED);
+    if (rc != LZMA_OK) {
+      fatal("%s: liblzma returned error %d!\n", module_, static_cast<int>(rc));
+    }
+  }
+
+  lzma_ret compress(lzma_action action)
+  {
+    strm_.next_out = out_;
+    strm_.avail_out = sizeof(out_);
+    lzma_ret rc = lzma_code(&strm_, action);
+    if ((rc != LZMA_OK) && (rc != LZMA_STREAM_END)) {
+      fatal("%s: liblzma returned error %d!\n", module_, static_cast<int>(rc));
+    }
+    put(out_, sizeof(out_) - strm_.avail_out);
+    return rc;
+  }
+
+  lzma_stream strm_ = LZMA_STREAM_INIT;
+  bool writing_;
+  bool ended_{false};
+};
+#endif // HAVE_LIBLZMA
+
+static gbfile*
+codecapi_open(gbfile* self, const char* mode)
+{
+  char openmode[32];
+
+  /* under non-posix systems files MUST be opened in binary mode */
+
+  strcpy(openmode, mode);
+  if (strchr(mode, 'b') == nullptr) {
+    strncat(openmode, "b", sizeof(openmode) - strlen(openmode) - 1);
+  }
+
+  FILE* fd;
+  if (self->is_pipe) {
+    fd = (self->mode == 'r') ? stdin : stdout;
+    SET_BINARY_MODE(fd);
+  } else {
+    fd = xfopen(self->name, openmode, self->module);
+  }
+
+  bool writing = (self->mode == 'w');
+#if !ZLIB_INHIBITED
+  if (self->gzapi) {
+    self->handle.codec = new GzipCodec(fd, self->module);
+  }
+#endif
+#if HAVE_LIBZSTD
+  if (self->zstdapi) {
+    self->handle.codec = new ZstdCodec(fd, self->module, writing);
+  }
+#endif
+#if HAVE_LIBLZMA
+  if (self->xzapi) {
+    self->handle.codec = new XzCodec(fd, self->module, writing);
+  }
+#endif
+  return self;
+}
+
+static int
+codecapi_close(gbfile* self)
+{
+  GbfCodec* codec = self->handle.codec;
+  if (self->mode == 'w') {
+    codec->finish();
+  }
+  FILE* fd = codec->fd_;
+  delete codec;
+  self->handle.codec = nullptr;
+  return self->is_pipe ? fflush(fd) : fclose(fd);
+}
+
+static gbsize_t
+codecapi_read(void* buf, const gbsize_t size, const gbsize_t members, gbfile* self)
+{
+  gbsize_t result = 0;
+  auto* target = (unsigned char*) buf;
+  gbsize_t count = size * members;
+
+  if (self->back != -1) {
+    *target++ = self->back;
+    count--;
+    result++;
+    self->back = -1;
+  }
+  result += self->handle.codec->decode(target, count);
+
+  /* Check for an incomplete READ */
+  if ((members == 1) && (size > 1) && (result > 0) && (result < size)) {
+    fatal("%s: Unexpected end of file (EOF)!\n", self->module);
+  }
+
+  return result / size;
+}
+
+static gbsize_t
+codecapi_write(const void* buf, const gbsize_t size, const gbsize_t members, gbfile* self)
+{
+  self->handle.codec->encode(buf, size * members);
+  return members;
+}
+
+static int
+codecapi_flush(gbfile* self)
+{
+  if (self->mode == 'w') {
+    self->handle.codec->flush();
+    return fflush(self->handle.codec->fd_);
+  }
+  return 0;
+}
+
+static gboff_t
+codecapi_tell(gbfile* self)
+{
+  gboff_t result = self->handle.codec->pos_;
+  if (self->back != -1) {
+    result--;
+  }
+  return result;
+}
+
+static int
+codecapi_seek(gbfile* self, gboff_t offset, int whence)
+{
+  if ((self->mode != 'r') || (whence == SEEK_END)) {
+    fatal("%s: online compression not yet supported for this format!", self->module);
+  }
+
+  gboff_t target = (whence == SEEK_SET) ? offset : codecapi_tell(self) + offset;
+  if (target < 0) {
+    fatal("%s: Unable to set file (%s) to position (%lld)!\n",
+          self->module, self->name, (long long) target);
+  }
+
+  GbfCodec* codec = self->handle.codec;
+  if (target == codecapi_tell(self)) {
+    return 0;
+  }
+  if (target < codecapi_tell(self)) {
+    codec->restart();
+  }
+  self->back = -1;
+
+  unsigned char skip[4096];
+  while (codec->pos_ < target) {
+    std::size_t len = std::min<gboff_t>(sizeof(skip), target - codec->pos_);
+    if (codec->decode(skip, len) != len) {
+      fatal("%s: Unable to set file (%s) to position (%lld)!\n",
+            self->module, self->name, (long long) target);
+    }
+  }
+  return 0;
+}
+
+static int
+codecapi_eof(gbfile* self)
+{
+  if (self->back != -1) {
+    return 0;
+  }
+
+  unsigned char test;
+  if (self->handle.codec->decode(&test, 1) == 1) {
+    /* No EOF, put the single byte back into stream */
+    self->back = test;
+    return 0;
+  }
+  return 1;
+}
+
+static int
+codecapi_ungetc(const int c, gbfile* self)
+{
+  if (self->back == -1) {
+    self->back = c;
+  } else {
+    fatal(MYNAME ": Cannot store more than one byte back!\n");
+  }
+  return c;
+}
+
+static void
+codecapi_clearerr(gbfile* self)
+{
+  clearerr(self->handle.codec->fd_);
+}
+
+static int
+codecapi_error(gbfile* self)
+{
+  return ferror(self->handle.codec->fd_);
+}
+#endif	// #if !ZLIB_INHIBITED || HAVE_LIBZSTD || HAVE_LIBLZMA
+
+
 /*******************************************************************************/
 /* %%%                         Standard C file api                         %%% */
 /*******************************************************************************/
@@ -266,6 +784,10 @@ static gbfile*
 stdapi_open(gbfile* self, const char* mode)
 {
   self->handle.std = xfopen(self->name, mode, self->module);
+  /* Writers hand over a record at a time; let them pile up. */
+  if ((self->mode == 'w') && !self->is_pipe) {
+    setvbuf(self->handle.std, nullptr, _IOFBF, 64 * 1024);
+  }
   return self;
 }
 
@@ -276,15 +798,15 @@ stdapi_close(gbfile* self)
 }
 
 static int
-stdapi_seek(gbfile* self, int32_t offset, int whence)
+stdapi_seek(gbfile* self, gboff_t offset, int whence)
 {
-  gbsize_t pos = 0;
+  gboff_t pos = 0;
 
   if (whence != SEEK_SET) {
-    pos = ftell(self->handle.std);
+    pos = gb_ftell(self->handle.std);
   }
 
-  int result = fseek(self->handle.std, offset, whence);
+  int result = gb_fseek(self->handle.std, offset, whence);
   if (result != 0) {
     switch (whence) {
     case SEEK_CUR:
@@ -298,8 +820,8 @@ stdapi_seek(gbfile* self, int32_t offset, int whence)
       fatal("%s: Unknown seek operation (%d) for file %s!\n",
             self->module, whence, self->name);
     }
-    fatal("%s: Unable to set file (%s) to position (%llu)!\n",
-          self->module, self->name, (long long unsigned) pos);
+    fatal("%s: Unable to set file (%s) to position (%lld)!\n",
+          self->module, self->name, (long long) pos);
   }
   return 0;
 }
@@ -329,10 +851,10 @@ stdapi_flush(gbfile* self)
   return fflush(self->handle.std);
 }
 
-static gbsize_t
+static gboff_t
 stdapi_tell(gbfile* self)
 {
-  return ftell(self->handle.std);
+  return gb_ftell(self->handle.std);
 }
 
 static int
@@ -373,13 +895,24 @@ memapi_open(gbfile* self, const char* mode)
   self->memsz = 0;
   self->handle.mem = nullptr;
 
+  if (self->memfile && (self->mode == 'r')) {
+    const QByteArray data = gpsbabel::MemoryFiles::value(self->name);
+    self->memsz = self->memlen = data.size();
+    self->handle.mem = (unsigned char*) xmalloc(data.size() + 1);
+    memcpy(self->handle.mem, data.constData(), data.size());
+  }
+
   return self;
 }
 
 static int
 memapi_close(gbfile* self)
 {
-  if (self->handle.mem) {
+  if (self->memfile && (self->mode == 'w')) {
+    gpsbabel::MemoryFiles::insert(self->name,
+                                  QByteArray(reinterpret_cast<const char*>(self->handle.mem), self->memlen));
+  }
+  if (self->handle.mem && !self->borrowed) {
     xfree(self->handle.mem);
   }
 
@@ -387,15 +920,17 @@ memapi_close(gbfile* self)
 }
 
 static int
-memapi_seek(gbfile* self, int32_t offset, int whence)
+memapi_seek(gbfile* self, gboff_t offset, int whence)
 {
-  long long pos = (int)self->mempos;
+  gboff_t pos = self->mempos;
 
   switch (whence) {
   case SEEK_CUR:
-  case SEEK_END:
     pos = pos + offset;
     break;
+  case SEEK_END:
+    pos = self->memlen + offset;
+    break;
   case SEEK_SET:
     pos = offset;
     break;
@@ -412,11 +947,7 @@ memapi_seek(gbfile* self, int32_t offset, int whence)
 static gbsize_t
 memapi_read(void* buf, const gbsize_t size, const gbsize_t members, gbfile* self)
 {
-  gbsize_t result = (self->memlen - self->mempos) / size;
-
-  if (result > members) {
-    result = members;
-  }
+  const gbsize_t result = std::min<gboff_t>((self->memlen - self->mempos) / size, members);
   gbsize_t count = result * size;
   if (count) {
     memcpy(buf, self->handle.mem + self->mempos, count);
@@ -436,6 +967,13 @@ memapi_write(const void* buf, const gbsize_t size, const gbsize_t members, gbfil
 
   gbsize_t count = size * members;
 
+  if (self->borrowed) {	/* take a copy before changing what gbfview showed */
+    auto* mem = (unsigned char*) xmalloc(self->memlen + 1);
+    memcpy(mem, self->handle.mem, self->memlen);
+    self->handle.mem = mem;
+    self->memsz = self->memlen;
+    self->borrowed = 0;
+  }
   if (self->mempos + count > self->memsz) {
     self->memsz = ((self->mempos + count + 4095) / 4096) * 4096;
     self->handle.mem = (unsigned char*) xrealloc(self->handle.mem, self->memsz);
@@ -456,7 +994,7 @@ memapi_flush(gbfile* self)
   return 0;
 }
 
-static gbsize_t
+static gboff_t
 memapi_tell(gbfile* self)
 {
   return self->mempos;
@@ -494,6 +1032,361 @@ memapi_error(gbfile* self)
 }
 
 
+/*******************************************************************************/
+/* %%%                   Mapped file, read only (mmapi)                    %%% */
+/*******************************************************************************/
+
+/*
+ * Uncompressed local files opened for reading are mapped into memory and
+ * then read just like a memory stream, which turns every gbfread into a
+ * memcpy instead of a trip through stdio or zlib.  The mapping is private,
+ * so gbfungetc may write into it without touching the file.
+ */
+
+/*
+ * Identify compressed input by its first bytes: 'g' for gzip, 'z' for
+ * zstd, 'x' for xz and 0 for anything else.
+ */
+static char
+compression_of(const gbfile* self)
+{
+  QFile qfile(QString::fromUtf8(self->name));
+  if (!qfile.open(QIODevice::ReadOnly)) {
+    return 0;
+  }
+  const QByteArray magic = qfile.read(6);
+  if (magic.startsWith("\x1f\x8b")) {
+    return 'g';
+  }
+  if (magic.startsWith("\x28\xb5\x2f\xfd")) {
+    return 'z';
+  }
+  if (magic == QByteArray("\xfd" "7zXZ\0", 6)) {
+    return 'x';
+  }
+  return 0;
+}
+
+static bool
+mmapi_map(gbfile* self)
+{
+  auto* qfile = new QFile(QString::fromUtf8(self->name));
+  if (!qfile->open(QIODevice::ReadOnly)) {
+    delete qfile;
+    return false;
+  }
+
+  /* Empty files can't be mapped and big ones don't fit in 32 bit memory. */
+  qint64 size = qfile->size();
+  if ((size == 0) || (static_cast<quint64>(size) > SIZE_MAX / 2)) {
+    delete qfile;
+    return false;
+  }
+
+  uchar* data = qfile->map(0, size, QFileDevice::MapPrivateOption);
+  if (data == nullptr) {
+    delete qfile;
+    return false;
+  }
+
+  self->mapped = qfile;
+  self->handle.mem = data;
+  self->mempos = 0;
+  self->memsz = self->memlen = size;
+  return true;
+}
+
+static gbfile*
+mmapi_open(gbfile* self, const char* mode)
+{
+  (void)mode;
+  /* The mapping was made in gbfopen. */
+  return self;
+}
+
+static int
+mmapi_close(gbfile* self)
+{
+  self->mapped->unmap(self->handle.mem);
+  delete self->mapped;
+  self->mapped = nullptr;
+  self->handle.mem = nullptr;
+  return 0;
+}
+
+static int
+mmapi_seek(gbfile* self, gboff_t offset, int whence)
+{
+  if (memapi_seek(self, offset, whence) != 0) {
+    fatal("%s: Unable to set file (%s) to position (%lld)!\n",
+          self->module, self->name, (long long) offset);
+  }
+  return 0;
+}
+
+static gbsize_t
+mmapi_read(void* buf, const gbsize_t size, const gbsize_t members, gbfile* self)
+{
+  gboff_t left = self->memlen - self->mempos;
+
+  /* Check for an incomplete READ, as zlib does */
+  if ((members == 1) && (size > 1) && (left > 0) && (left < size)) {
+    fatal("%s: Unexpected end of file (EOF)!\n", self->module);
+  }
+  return memapi_read(buf, size, members, self);
+}
+
+static gbsize_t
+mmapi_write(const void* buf, const gbsize_t size, const gbsize_t members, gbfile* self)
+{
+  (void)buf;
+  (void)size;
+  (void)members;
+  fatal("%s: Cannot write to file '%s' opened for reading!\n", self->module, self->name);
+}
+
+
+/*******************************************************************************/
+/* %%%               Read ahead in front of a backend (raapi)              %%% */
+/*******************************************************************************/
+
+/*
+ * With -R the backend of a file opened for reading is called from a
+ * background thread that keeps a few blocks ahead of the reader.  Seeks
+ * stop that thread, move the backend and start it again.
+ */
+
+struct gbfreadahead {
+  gpsbabel::ReadAhead* ahead;
+  gbfclose_cb close;
+  gbfseek_cb seek;
+  gbftell_cb tell;
+};
+
+static int
+raapi_close(gbfile* self)
+{
+  gbfreadahead* ra = self->readahead;
+  delete ra->ahead;
+  self->readahead = nullptr;
+  int result = ra->close(self);
+  delete ra;
+  return result;
+}
+
+static gbsize_t
+raapi_read(void* buf, const gbsize_t size, const gbsize_t members, gbfile* self)
+{
+  qint64 result = self->readahead->ahead->read(static_cast<char*>(buf), (qint64) size * members);
+
+  /* Check for an incomplete READ */
+  if ((members == 1) && (size > 1) && (result > 0) && (result < size)) {
+    fatal("%s: Unexpected end of file (EOF)!\n", self->module);
+  }
+  return result / size;
+}
+
+static int
+raapi_seek(gbfile* self, gboff_t offset, int whence)
+{
+  gbfreadahead* ra = self->readahead;
+  gboff_t target = (whence == SEEK_CUR) ? ra->ahead->pos() + offset : offset;
+
+  ra->ahead->stop();
+  int result;
+  if (whence == SEEK_END) {
+    result = ra->seek(self, offset, SEEK_END);
+  } else {
+    result = ra->seek(self, target, SEEK_SET);
+  }
+  ra->ahead->start(ra->tell(self));
+  return result;
+}
+
+static gboff_t
+raapi_tell(gbfile* self)
+{
+  return self->readahead->ahead->pos();
+}
+
+static int
+raapi_eof(gbfile* self)
+{
+  return self->readahead->ahead->atEnd();
+}
+
+static int
+raapi_ungetc(const int c, gbfile* self)
+{
+  return self->readahead->ahead->unget(c) ? c : EOF;
+}
+
+static void
+raapi_attach(gbfile* self)
+{
+  auto* ra = new gbfreadahead;
+  ra->close = self->fileclose;
+  ra->seek = self->fileseek;
+  ra->tell = self->filetell;
+  gbfread_cb read = self->fileread;
+  ra->ahead = new gpsbabel::ReadAhead([self, read](char* data, qint64 maxlen) -> qint64 {
+    return read(data, 1, maxlen, self);
+  }, gpsbabel::ReadAhead::depth());
+  self->readahead = ra;
+
+  self->fileclose = raapi_close;
+  self->fileeof = raapi_eof;
+  self->fileread = raapi_read;
+  self->fileseek = raapi_seek;
+  self->filetell = raapi_tell;
+  self->fileungetc = raapi_ungetc;
+  ra->ahead->start(0);
+}
+
+
+/*******************************************************************************/
+/* %%%               Write buffer in front of a backend (wbapi)            %%% */
+/*******************************************************************************/
+
+/*
+ * Files opened for writing collect their output here and hand it to the
+ * backend in large blocks, so binary writers emitting a field at a time
+ * don't pay for a stdio call per field.  Anything else that touches the
+ * file position drains the buffer first.  While bytes are still in the
+ * buffer gbfpatch can rewrite them in place without seeking.
+ */
+
+struct gbfwritebuf {
+  static constexpr gbsize_t kCapacity = 1024 * 1024;
+
+  QByteArray data;
+  gboff_t base{0};	/* file position of data[0] */
+  gbfclose_cb close;
+  gbfeof_cb eof;
+  gbfflush_cb flush;
+  gbfread_cb read;
+  gbfseek_cb seek;
+  gbftell_cb tell;
+  gbfungetc_cb ungetc;
+  gbfwrite_cb write;
+};
+
+static void
+wbapi_drain(gbfile* self)
+{
+  gbfwritebuf* wb = self->writebuf;
+  if (wb->data.isEmpty()) {
+    return;
+  }
+  gbsize_t len = wb->data.size();
+  gbsize_t result = wb->write(wb->data.constData(), 1, len, self);
+  if (result != len) {
+    fatal("%s: Could not write %lld bytes to %s (result %d)!\n",
+          self->module, (long long int)(len - result), self->name, result);
+  }
+  wb->data.clear();
+}
+
+static int
+wbapi_close(gbfile* self)
+{
+  gbfwritebuf* wb = self->writebuf;
+  wbapi_drain(self);
+  self->writebuf = nullptr;
+  int result = wb->close(self);
+  delete wb;
+  return result;
+}
+
+static gbsize_t
+wbapi_write(const void* buf, const gbsize_t size, const gbsize_t members, gbfile* self)
+{
+  gbfwritebuf* wb = self->writebuf;
+  gbsize_t len = size * members;
+
+  if ((gbsize_t) wb->data.size() + len > gbfwritebuf::kCapacity) {
+    wbapi_drain(self);
+    if (len >= gbfwritebuf::kCapacity) {
+      return wb->write(buf, size, members, self);
+    }
+  }
+  if (wb->data.isEmpty()) {
+    wb->base = wb->tell(self);
+  }
+  wb->data.append(static_cast<const char*>(buf), len);
+  return members;
+}
+
+static int
+wbapi_flush(gbfile* self)
+{
+  wbapi_drain(self);
+  return self->writebuf->flush(self);
+}
+
+static gbsize_t
+wbapi_read(void* buf, const gbsize_t size, const gbsize_t members, gbfile* self)
+{
+  wbapi_drain(self);
+  return self->writebuf->read(buf, size, members, self);
+}
+
+static int
+wbapi_seek(gbfile* self, gboff_t offset, int whence)
+{
+  wbapi_drain(self);
+  return self->writebuf->seek(self, offset, whence);
+}
+
+static gboff_t
+wbapi_tell(gbfile* self)
+{
+  gbfwritebuf* wb = self->writebuf;
+  if (wb->data.isEmpty() || (wb->base == -1)) {
+    return wb->tell(self);
+  }
+  return wb->base + wb->data.size();
+}
+
+static int
+wbapi_eof(gbfile* self)
+{
+  wbapi_drain(self);
+  return self->writebuf->eof(self);
+}
+
+static int
+wbapi_ungetc(const int c, gbfile* self)
+{
+  wbapi_drain(self);
+  return self->writebuf->ungetc(c, self);
+}
+
+static void
+wbapi_attach(gbfile* self)
+{
+  auto* wb = new gbfwritebuf;
+  wb->close = self->fileclose;
+  wb->eof = self->fileeof;
+  wb->flush = self->fileflush;
+  wb->read = self->fileread;
+  wb->seek = self->fileseek;
+  wb->tell = self->filetell;
+  wb->ungetc = self->fileungetc;
+  wb->write = self->filewrite;
+  self->writebuf = wb;
+
+  self->fileclose = wbapi_close;
+  self->fileeof = wbapi_eof;
+  self->fileflush = wbapi_flush;
+  self->fileread = wbapi_read;
+  self->fileseek = wbapi_seek;
+  self->filetell = wbapi_tell;
+  self->fileungetc = wbapi_ungetc;
+  self->filewrite = wbapi_write;
+}
+
+
 /* GPSBabel 'file' standard calls */
 
 /*
@@ -509,7 +1402,8 @@ gbfopen(const QString& filename, const char* mode, const char* module)
   file->mode = 'r'; // default
   file->binary = (strchr(mode, 'b') != nullptr);
   file->back = -1;
-  file->memapi = (filename == nullptr);
+  file->memfile = (filename != nullptr) && gpsbabel::MemoryFiles::contains(filename);
+  file->memapi = (filename == nullptr) || file->memfile;
 
   for (const char* m = mode; *m; m++) {
     switch (tolower(*m)) {
@@ -527,7 +1421,7 @@ gbfopen(const QString& filename, const char* mode, const char* module)
 
   if (file->memapi) {
     file->gzapi = 0;
-    file->name = xstrdup("(Memory stream)");
+    file->name = xstrdup(file->memfile? filename : QStringLiteral("(Memory stream)"));
 
     file->fileclearerr = memapi_clearerr;
     file->fileclose = memapi_close;
@@ -543,6 +1437,9 @@ gbfopen(const QString& filename, const char* mode, const char* module)
   } else {
     file->name = xstrdup(filename);
     file->is_pipe = (filename == '-');
+    if ((file->mode == 'w') && !file->is_pipe) {
+      gpsbabel::InputMapping::release(filename);
+    }
 
     /* Do we have a '.gz' extension in the filename ? */
     int len = strlen(file->name);
@@ -555,7 +1452,69 @@ gbfopen(const QString& filename, const char* mode, const char* module)
 #endif
     }
 
-    if (file->gzapi) {
+    /* zstd and xz are told by their magic on input, by the extension on output. */
+    char compression = 0;
+    if (file->mode == 'r') {
+      compression = file->is_pipe ? 0 : compression_of(file);
+    } else if ((len > 4) && (case_ignore_strcmp(&file->name[len-4], ".zst") == 0)) {
+      compression = 'z';
+    } else if ((len > 3) && (case_ignore_strcmp(&file->name[len-3], ".xz") == 0)) {
+      compression = 'x';
+    }
+#if !HAVE_LIBZSTD
+    if (compression == 'z') {
+      fatal("%s: Zstandard support was not included in this build.\n", file->module);
+    }
+#endif
+#if !HAVE_LIBLZMA
+    if (compression == 'x') {
+      fatal("%s: xz support was not included in this build.\n", file->module);
+    }
+#endif
+
+#if !ZLIB_INHIBITED
+    /* gzip output goes to several threads with -z. */
+    bool parallel_gzip = file->gzapi && (file->mode == 'w') &&
+                         (gpsbabel::ParallelDeflate::default_threads() > 1);
+#else
+    bool parallel_gzip = false;
+#endif
+
+    if ((compression == 'z') || (compression == 'x') || parallel_gzip) {
+#if !ZLIB_INHIBITED || HAVE_LIBZSTD || HAVE_LIBLZMA
+      file->gzapi = parallel_gzip;
+      file->zstdapi = (compression == 'z');
+      file->xzapi = (compression == 'x');
+
+      file->fileclearerr = codecapi_clearerr;
+      file->fileclose = codecapi_close;
+      file->fileeof = codecapi_eof;
+      file->fileerror = codecapi_error;
+      file->fileflush = codecapi_flush;
+      file->fileopen = codecapi_open;
+      file->fileread = codecapi_read;
+      file->fileseek = codecapi_seek;
+      file->filetell = codecapi_tell;
+      file->fileungetc = codecapi_ungetc;
+      file->filewrite = codecapi_write;
+#endif
+    } else if ((file->mode == 'r') && !file->is_pipe && (compression != 'g') &&
+               (gpsbabel::ReadAhead::depth() == 0) && mmapi_map(file)) {
+      file->gzapi = 0;
+      file->mmapi = 1;
+
+      file->fileclearerr = memapi_clearerr;
+      file->fileclose = mmapi_close;
+      file->fileeof = memapi_eof;
+      file->fileerror = memapi_error;
+      file->fileflush = memapi_flush;
+      file->fileopen = mmapi_open;
+      file->fileread = mmapi_read;
+      file->fileseek = mmapi_seek;
+      file->filetell = memapi_tell;
+      file->fileungetc = memapi_ungetc;
+      file->filewrite = mmapi_write;
+    } else if (file->gzapi) {
 #if !ZLIB_INHIBITED
 
       file->fileclearerr = gzapi_clearerr;
@@ -590,6 +1549,15 @@ gbfopen(const QString& filename, const char* mode, const char* module)
 
   file->fileopen(file, mode);
 
+  /* Memory streams and mapped files have nothing to read ahead. */
+  if ((file->mode == 'r') && !file->memapi && !file->mmapi && (gpsbabel::ReadAhead::depth() > 0)) {
+    raapi_attach(file);
+  }
+  /* Memory streams are their own buffer. */
+  if ((file->mode == 'w') && !file->memapi) {
+    wbapi_attach(file);
+  }
+
   file->buffsz = 256;
   file->buff = (char*) xmalloc(file->buffsz);
 
@@ -629,11 +1597,11 @@ gbfclose(gbfile* file)
 }
 
 /*
- * gbfgetc: (as fgetc)
+ * gbfgetc: (as fgetc), when the inline path in gbfile.h can't be taken
  */
 
 int
-gbfgetc(gbfile* file)
+gbfgetc_slow(gbfile* file)
 {
   unsigned char c;
 
@@ -681,6 +1649,25 @@ gbfgets(char* buf, int len, gbfile* file)
 
 }
 
+/* Bytes read go to the counter of the backend that read them. */
+static void
+gbfcount_read(const gbfile* file, qint64 bytes)
+{
+  if (file->memapi) {
+    mem_read_counter.add(bytes);
+  } else if (file->mmapi) {
+    mmap_read_counter.add(bytes);
+  } else if (file->zstdapi) {
+    zstd_read_counter.add(bytes);
+  } else if (file->xzapi) {
+    xz_read_counter.add(bytes);
+  } else if (file->gzapi) {
+    gzip_read_counter.add(bytes);
+  } else {
+    std_read_counter.add(bytes);
+  }
+}
+
 /*
  * gbfread: (as fread)
  */
@@ -691,7 +1678,12 @@ gbfread(void* buf, const gbsize_t size, const gbsize_t members, gbfile* file)
   if ((size == 0) || (members == 0)) {
     return 0;
   }
-  return file->fileread(buf, size, members, file);
+  gbsize_t result = file->fileread(buf, size, members, file);
+  gpsbabel::Progress::bytes(static_cast<qint64>(result) * size);
+  if (gpsbabel::Counters::enabled()) {
+    gbfcount_read(file, static_cast<qint64>(result) * size);
+  }
+  return result;
 }
 // This probably makes an unnecessary alloc/copy, but keeps the above (kinda
 
@@ -870,7 +1862,7 @@ gbfrewind(gbfile* file)
  */
 
 int
-gbfseek(gbfile* file, int32_t offset, int whence)
+gbfseek(gbfile* file, gboff_t offset, int whence)
 {
   return file->fileseek(file, offset, whence);
 }
@@ -879,11 +1871,11 @@ gbfseek(gbfile* file, int32_t offset, int whence)
  * gbftell: (as ftell)
  */
 
-gbsize_t
+gboff_t
 gbftell(gbfile* file)
 {
-  gbsize_t result = file->filetell(file);
-  if ((signed) result == -1)
+  gboff_t result = file->filetell(file);
+  if (result == -1)
     fatal("%s: Could not determine position of file '%s'!\n",
           file->module, file->name);
   return result;
@@ -916,7 +1908,7 @@ gbfungetc(const int c, gbfile* file)
  */
 
 int32_t
-gbfgetint32(gbfile* file)
+gbfgetint32_slow(gbfile* file)
 {
   char buf[4];
 
@@ -936,7 +1928,7 @@ gbfgetint32(gbfile* file)
  */
 
 int16_t
-gbfgetint16(gbfile* file)
+gbfgetint16_slow(gbfile* file)
 {
   char buf[2];
 
@@ -1109,6 +2101,7 @@ gbfgetutf16str(gbfile* file)
   for (;;) {
     QChar qch = gbfgetutf16char(file);
     if (qch.isNull()) {
+      file->line_ended = 0;
       if (len == 0) {
         return nullptr;
       } else {
@@ -1124,8 +2117,10 @@ gbfgetutf16str(gbfile* file)
               file->module,
               file->big_endian ? 'B' : 'L');
       }
+      file->line_ended = 1;
       break;
     } else if (qch == u'\n') {
+      file->line_ended = 1;
       break;
     }
 
@@ -1180,6 +2175,7 @@ gbfgetstr(gbfile* file)
     int c = gbfgetc(file);
 
     if ((c == EOF) || (c == 0x1A)) {
+      file->line_ended = 0;
       if (len == 0) {
         return nullptr;
       }
@@ -1189,8 +2185,10 @@ gbfgetstr(gbfile* file)
       if ((c != '\n') && (c != EOF)) {
         gbfungetc(c, file);
       }
+      file->line_ended = 1;
       break;
     } else if (c == '\n') {
+      file->line_ended = 1;
       break;
     } else if (((c == 0xFE) || (c == 0xFF)) && (! file->unicode_checked)) {
       int c1 = gbfgetc(file);
@@ -1320,14 +2318,14 @@ gbfputpstr(const QString& s, gbfile* file)
 
 /* Much more higher level functions */
 
-gbsize_t
-gbfcopyfrom(gbfile* file, gbfile* src, gbsize_t count)
+gboff_t
+gbfcopyfrom(gbfile* file, gbfile* src, gboff_t count)
 {
   char buf[1024];
-  gbsize_t copied = 0;
+  gboff_t copied = 0;
 
-  while (count) {
-    gbsize_t n = gbfread(buf, 1, (count < sizeof(buf)) ? count : sizeof(buf), src);
+  while (count > 0) {
+    gbsize_t n = gbfread(buf, 1, std::min<gboff_t>(count, sizeof(buf)), src);
     if (n > 0) {
       gbfwrite(buf, 1, n, file);
       count -= n;
@@ -1339,5 +2337,104 @@ gbfcopyfrom(gbfile* file, gbfile* src, gbsize_t count)
   return copied;
 }
 
+/*
+ * gbfview: make the memory stream file hold the next count bytes of src,
+ *          and step src over them, like a truncate and gbfcopyfrom.  When
+ *          src has its data in memory file reads those bytes in place, which
+ *          stays valid until src is closed.  Writing to file then takes a
+ *          copy first.  Returns the number of bytes taken from src.
+ */
+
+gbsize_t
+gbfview(gbfile* file, gbfile* src, gbsize_t count)
+{
+  if (!file->memapi || file->memfile) {
+    fatal("%s: gbfview needs a memory stream!\n", file->module);
+  }
+
+  if (!src->memapi && !src->mmapi) {
+    if (file->borrowed) {
+      file->handle.mem = nullptr;
+      file->memsz = file->memlen = 0;
+      file->borrowed = 0;
+    }
+    gbfrewind(file);
+    gbfwrite(nullptr, 0, 0, file);	/* truncate */
+    gbsize_t copied = gbfcopyfrom(file, src, count);
+    gbfrewind(file);
+    return copied;
+  }
+
+  if (file->handle.mem && !file->borrowed) {
+    xfree(file->handle.mem);
+  }
+  const gboff_t left = src->memlen - src->mempos;
+  if (count > left) {
+    count = left;
+  }
+  file->handle.mem = src->handle.mem + src->mempos;
+  file->mempos = 0;
+  file->memsz = file->memlen = count;
+  file->borrowed = 1;
+  src->mempos += count;
+  gpsbabel::Progress::bytes(count);
+  return count;
+}
+
+/*
+ * gbfpatch: overwrite len bytes at pos, which must already have been written.
+ *           The current position is left unchanged.
+ */
+
+void
+gbfpatch(gbfile* file, gboff_t pos, const void* buf, gbsize_t len)
+{
+  gbfwritebuf* wb = file->writebuf;
+  if ((wb != nullptr) && !wb->data.isEmpty() && (wb->base != -1) &&
+      (pos >= wb->base) && (pos + len <= wb->base + wb->data.size())) {
+    memcpy(wb->data.data() + (pos - wb->base), buf, len);
+    return;
+  }
+
+  gboff_t here = gbftell(file);
+  gbfseek(file, pos, SEEK_SET);
+  gbfwrite(buf, 1, len, file);
+  gbfseek(file, here, SEEK_SET);
+}
+
+/*
+ * gbfpatchint16: overwrite a signed 16-bit integer value at pos
+ */
+
+void
+gbfpatchint16(gbfile* file, gboff_t pos, const int16_t i)
+{
+  char buf[2];
+
+  if (file->big_endian) {
+    be_write16(buf, i);
+  } else {
+    le_write16(buf, i);
+  }
+  gbfpatch(file, pos, buf, sizeof(buf));
+}
+
+/*
+ * gbfpatchint32: overwrite a signed 32-bit integer value at pos
+ */
+
+void
+gbfpatchint32(gbfile* file, gboff_t pos, const int32_t i)
+{
+  char buf[4];
+
+  if (file->big_endian) {
+    be_write32(buf, i);
+  } else {
+    le_write32(buf, i);
+  }
+  gbfpatch(file, pos, buf, sizeof(buf));
+}
+
 
 /* That's all, sorry. */
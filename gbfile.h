@@ -26,9 +26,11 @@
 #include <QByteArray>           // for QByteArray
 #include <QString>              // for QString
 
-#include <cstdint>             // for int32_t, int16_t, uint32_t
+#include <cstdint>             // for int32_t, int16_t, int64_t, uint32_t, uint16_t
 #include <cstdio>              // for FILE
 
+#include "src/core/progress.h" // for Progress
+
 #if HAVE_LIBZ
 #include <zlib.h>
 #elif !ZLIB_INHIBITED
@@ -36,8 +38,13 @@
 #endif
 
 
+class GbfCodec;
+class QFile;
 struct gbfile;
-using gbsize_t = uint32_t;
+struct gbfreadahead;
+struct gbfwritebuf;
+using gbsize_t = uint32_t;	/* sizes of single reads and writes */
+using gboff_t = int64_t;	/* positions in and sizes of whole files */
 
 using gbfclearerr_cb = void (*)(gbfile* self);
 using gbfclose_cb = int (*)(gbfile* self);
@@ -46,8 +53,8 @@ using gbferror_cb = int (*)(gbfile* self);
 using gbfflush_cb = int (*)(gbfile* self);
 using gbfopen_cb = gbfile* (*)(gbfile* self, const char* mode);
 using gbfread_cb = gbsize_t (*)(void* buf, const gbsize_t size, const gbsize_t members, gbfile* self);
-using gbfseek_cb = int (*)(gbfile* self, int32_t offset, int whence);
-using gbftell_cb = gbsize_t (*)(gbfile* self);
+using gbfseek_cb = int (*)(gbfile* self, gboff_t offset, int whence);
+using gbftell_cb = gboff_t (*)(gbfile* self);
 using gbfwrite_cb = gbsize_t (*)(const void* buf, const gbsize_t size, const gbsize_t members, gbfile* self);
 using gbfungetc_cb = int (*)(const int c, gbfile* self);
 
@@ -58,6 +65,7 @@ struct gbfile {
 #if !ZLIB_INHIBITED
     gzFile gz;
 #endif
+    GbfCodec* codec;	/* zstd or xz stream */
   } handle;
   char*   name;
   char*   module;
@@ -65,16 +73,22 @@ struct gbfile {
   int    buffsz;
   char   mode;
   int    back;
-  gbsize_t mempos;	/* curr. position in memory */
-  gbsize_t memlen;	/* max. number of written bytes to memory */
-  gbsize_t memsz;		/* curr. size of allocated memory */
+  gboff_t mempos;	/* curr. position in memory */
+  gboff_t memlen;	/* max. number of written bytes to memory */
+  gboff_t memsz;		/* curr. size of allocated memory */
   unsigned char big_endian:1;
   unsigned char binary:1;
   unsigned char gzapi:1;
+  unsigned char zstdapi:1;
+  unsigned char xzapi:1;
   unsigned char memapi:1;
+  unsigned char memfile:1;	/* memapi stand-in for a file, see MemoryFiles */
+  unsigned char mmapi:1;	/* memapi over a read-only mapping of the file */
+  unsigned char borrowed:1;	/* memapi showing another stream's memory, see gbfview */
   unsigned char unicode:1;
   unsigned char unicode_checked:1;
   unsigned char is_pipe:1;
+  unsigned char line_ended:1;	/* the last line gbfgetstr read ended with a line break */
   gbfclearerr_cb fileclearerr;
   gbfclose_cb fileclose;
   gbfeof_cb fileeof;
@@ -86,6 +100,9 @@ struct gbfile {
   gbftell_cb filetell;
   gbfungetc_cb fileungetc;
   gbfwrite_cb filewrite;
+  QFile* mapped;	/* owner of the mapping for mmapi */
+  gbfreadahead* readahead;	/* backend behind a read ahead thread, see -R */
+  gbfwritebuf* writebuf;	/* output waiting to be handed to the backend */
 };
 
 
@@ -101,7 +118,26 @@ gbsize_t gbfread(void* buf, gbsize_t size, gbsize_t members, gbfile* file);
 gbsize_t gbfread(QString& buf, gbsize_t size, gbsize_t members, gbfile* file);
 // Convenience wrapper for above, but ignoring the possibility of endian swapping.
 QByteArray gbfreadbuf(gbsize_t size, gbfile* file);
-int gbfgetc(gbfile* file);
+
+/*
+ * Memory streams and mapped files already hold all of their data, so the
+ * small readers below take it from there directly and only call into the
+ * backend when the stream is elsewhere or about to run out.
+ */
+inline bool gbfbuffered(const gbfile* file, gbsize_t count)
+{
+  return (file->memapi || file->mmapi) && ((file->memlen - file->mempos) >= count);
+}
+
+int gbfgetc_slow(gbfile* file);
+inline int gbfgetc(gbfile* file)
+{
+  if (gbfbuffered(file, 1)) {
+    gpsbabel::Progress::bytes(1);
+    return file->handle.mem[file->mempos++];
+  }
+  return gbfgetc_slow(file);
+}
 QString gbfgets(char* buf, int len, gbfile* file);
 
 [[gnu::format(printf, 2, 0)]] int gbvfprintf(gbfile* file, const char* format, va_list ap);
@@ -114,17 +150,45 @@ int gbfflush(gbfile* file);
 void gbfclearerr(gbfile* file);
 int gbferror(gbfile* file);
 void gbfrewind(gbfile* file);
-int gbfseek(gbfile* file, int32_t offset, int whence);
-gbsize_t gbftell(gbfile* file);
+int gbfseek(gbfile* file, gboff_t offset, int whence);
+gboff_t gbftell(gbfile* file);
 int gbfeof(gbfile* file);
 int gbfungetc(int c, gbfile* file);
 
-int32_t gbfgetint32(gbfile* file);
+int32_t gbfgetint32_slow(gbfile* file);
+inline int32_t gbfgetint32(gbfile* file)
+{
+  if (gbfbuffered(file, 4)) {
+    const unsigned char* p = file->handle.mem + file->mempos;
+    file->mempos += 4;
+    gpsbabel::Progress::bytes(4);
+    if (file->big_endian) {
+      return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+    } else {
+      return (uint32_t(p[3]) << 24) | (uint32_t(p[2]) << 16) | (uint32_t(p[1]) << 8) | p[0];
+    }
+  }
+  return gbfgetint32_slow(file);
+}
 inline uint32_t gbfgetuint32(gbfile* file)
 {
   return gbfgetint32(file);
 }
-int16_t gbfgetint16(gbfile* file);
+int16_t gbfgetint16_slow(gbfile* file);
+inline int16_t gbfgetint16(gbfile* file)
+{
+  if (gbfbuffered(file, 2)) {
+    const unsigned char* p = file->handle.mem + file->mempos;
+    file->mempos += 2;
+    gpsbabel::Progress::bytes(2);
+    if (file->big_endian) {
+      return uint16_t((p[0] << 8) | p[1]);
+    } else {
+      return uint16_t((p[1] << 8) | p[0]);
+    }
+  }
+  return gbfgetint16_slow(file);
+}
 inline uint16_t gbfgetuint16(gbfile* file)
 {
   return gbfgetint16(file);
@@ -155,6 +219,12 @@ int gbfputcstr(const char* s, gbfile* file);	// write string including '\0'
 
 int gbfputpstr(const QString& s, gbfile* file);	// write as pascal string
 
-gbsize_t gbfcopyfrom(gbfile* file, gbfile* src, gbsize_t count);
+gboff_t gbfcopyfrom(gbfile* file, gbfile* src, gboff_t count);
+gbsize_t gbfview(gbfile* file, gbfile* src, gbsize_t count);
+
+/* overwrite bytes written earlier, typically a length field or a checksum */
+void gbfpatch(gbfile* file, gboff_t pos, const void* buf, gbsize_t len);
+void gbfpatchint16(gbfile* file, gboff_t pos, int16_t i);
+void gbfpatchint32(gbfile* file, gboff_t pos, int32_t i);
 
 #endif
@@ -66,6 +66,13 @@ int gbser_avail(void* handle);
  */
 int gbser_read(void* handle, void* buf, unsigned len);
 
+/* Wait up to |ms| milliseconds for any of the |count| ports in |handles|
+ * to have input.  On return ready[i] is nonzero for every port that has
+ * input or has been closed at the other end.  Returns the number of such
+ * ports, 0 if the time ran out or a signal arrived, or gbser_ERROR.
+ */
+int gbser_poll(void* const* handles, unsigned char* ready, unsigned count, unsigned ms);
+
 /* Read the specified number of bytes. Block until the requested number
  * of bytes have been read or the timeout (in ms) is exceeded.
  */
@@ -28,9 +28,11 @@
 #include <cstdarg>
 #include <cstdio>
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/time.h>
 #include <termios.h>
 #include <unistd.h>
+#include <vector>
 
 struct gbser_handle {
   struct termios  old_tio;
@@ -39,7 +41,9 @@ struct gbser_handle {
   unsigned        vmin, vtime;
   unsigned long   magic;
 
+  /* Received bytes not yet handed out are inbuf[inbuf_start, inbuf_start + inbuf_used). */
   unsigned char   inbuf[BUFSIZE];
+  unsigned        inbuf_start;
   unsigned        inbuf_used;
 };
 
@@ -260,16 +264,33 @@ unsigned gbser_read_buffer(void* handle, void** buf, unsigned* len)
     count = h->inbuf_used;
   }
 
-  memcpy(cp, h->inbuf, count);
-  memmove(h->inbuf, h->inbuf + count,
-          h->inbuf_used - count);
+  memcpy(cp, h->inbuf + h->inbuf_start, count);
+  h->inbuf_start += count;
   h->inbuf_used -= count;
+  if (h->inbuf_used == 0) {
+    h->inbuf_start = 0;
+  }
   *len -= count;
   cp   += count;
   *buf = (void*) cp;
   return count;
 }
 
+/* Make room behind the buffered bytes and return the number of bytes
+ * that can be read into h->inbuf + h->inbuf_start + h->inbuf_used, at
+ * least |want| - h->inbuf_used.  The buffered bytes are only moved to
+ * the front once the free space behind them runs short, so handing out
+ * bytes rarely moves data.
+ */
+static unsigned inbuf_room(gbser_handle* h, unsigned want)
+{
+  if (h->inbuf_start > BUFSIZE / 2 || h->inbuf_start + want > BUFSIZE) {
+    memmove(h->inbuf, h->inbuf + h->inbuf_start, h->inbuf_used);
+    h->inbuf_start = 0;
+  }
+  return BUFSIZE - h->inbuf_start - h->inbuf_used;
+}
+
 /* Return when the input buffer contains at least |want| bytes or |*ms|
  * milliseconds have elapsed. |ms| may be NULL or |*ms| may be zero to
  * poll the port for available bytes and return immediately. |*ms| will
@@ -290,10 +311,15 @@ int gbser_fill_buffer(void* handle, unsigned want, unsigned* ms)
     return h->inbuf_used;
   }
 
+  /* Reads take everything the tty has, up to the free space in the
+   * buffer, rather than just the missing bytes.  VMIN and VTIME are
+   * zero when the port is read, so read() never waits for more.
+   */
   if (nullptr == ms || 0 == *ms) {
+    unsigned room = inbuf_room(h, want);
     if ((rc = set_rx_timeout(h, 0, 0), rc < 0) ||
-        (rc = read(h->fd, h->inbuf + h->inbuf_used,
-                   want - h->inbuf_used), rc < 0)) {
+        (rc = read(h->fd, h->inbuf + h->inbuf_start + h->inbuf_used,
+                   room), rc < 0)) {
       return gbser_ERROR;
     }
     h->inbuf_used += rc;
@@ -304,52 +330,48 @@ int gbser_fill_buffer(void* handle, unsigned want, unsigned* ms)
     get_time(&tv);
 
     for (;;) {
-      fd_set rec;
-      struct timeval t;
+      struct pollfd pfd;
 
       time_left = *ms - elapsed(&tv);
       if (time_left <= 0 || h->inbuf_used >= want) {
         break;
       }
 
-      FD_ZERO(&rec);
-      FD_SET(h->fd, &rec);
+      pfd.fd      = h->fd;
+      pfd.events  = POLLIN;
+      pfd.revents = 0;
 
-      t.tv_sec  = (time_t) time_left / 1000;
-      t.tv_usec = ((unsigned) time_left % 1000) * 1000;
-
-      if (select(h->fd + 1, &rec, nullptr, nullptr, &t) < 0) {
+      /* Round up so a fraction of a millisecond doesn't spin. */
+      if (poll(&pfd, 1, (int) time_left + 1) < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
         return gbser_ERROR;
       }
 
       time_left = *ms - elapsed(&tv);
 
-      if (FD_ISSET(h->fd, &rec)) {
-#if 0
-        // See below comment.
-
-        unsigned vmin = 0, vtime = 0;
-        if (time_left >= 100) {
-          vmin  = want - h->inbuf_used;
-          vtime = (unsigned) time_left / 100;
-        }
-#endif
-        // The commented out call to set_rx_timeout here is totally
-        // legal by POSIX standards but does result in a flurry of
+      if (pfd.revents & (POLLIN | POLLHUP | POLLERR)) {
+        // Setting VMIN/VTIME here to wait for the rest of the bytes
+        // is totally legal by POSIX standards but results in a flurry
         // of tcsetattrs that slightly tweak VMIN/VTIME while there
         // is incoming data.   This has been shown to trigger driver
         // bugs in the Prolific drivers for Mac and in certain Linux
         // kernels, thought the latter has since been fixed.
-        // So although removing this means that the timeout behaviour
+        // So although this means that the timeout behaviour
         // is actually different on POSIX and WIN32, it triggers
         // fewer buts this way.  2/12/2008 RJL
-        if (/* (rc = set_rx_timeout(h, vmin, vtime), rc < 0) || */
-          (rc = read(h->fd, h->inbuf + h->inbuf_used,
-                     want - h->inbuf_used), rc < 0)) {
+        unsigned room = inbuf_room(h, want);
+        if (rc = read(h->fd, h->inbuf + h->inbuf_start + h->inbuf_used,
+                      room), rc < 0) {
           return gbser_ERROR;
         }
         h->inbuf_used += rc;
         /*printf("Got %d bytes\n", rc);*/
+        if (rc == 0 && (pfd.revents & (POLLHUP | POLLERR))) {
+          /* The device went away; don't spin until the timeout. */
+          break;
+        }
       }
     }
     *ms = (time_left < 0) ? 0 : time_left;
@@ -358,11 +380,43 @@ int gbser_fill_buffer(void* handle, unsigned want, unsigned* ms)
   return h->inbuf_used;
 }
 
+/* All the ports are waited for in one poll(), so one process can follow
+ * many receivers.  Bytes already buffered count as input.
+ */
+int gbser_poll(void* const* handles, unsigned char* ready, unsigned count, unsigned ms)
+{
+  std::vector<struct pollfd> pfds(count);
+  int timeout = (int) ms;
+  for (unsigned i = 0; i < count; ++i) {
+    gbser_handle* h = gbser_get_handle(handles[i]);
+    pfds[i].fd      = h->fd;
+    pfds[i].events  = POLLIN;
+    pfds[i].revents = 0;
+    if (h->inbuf_used > 0) {
+      timeout = 0;
+    }
+  }
+
+  int rc = poll(pfds.data(), count, timeout);
+  if ((rc < 0) && (errno != EINTR)) {
+    return gbser_ERROR;
+  }
+
+  int n = 0;
+  for (unsigned i = 0; i < count; ++i) {
+    const gbser_handle* h = gbser_get_handle(handles[i]);
+    ready[i] = (h->inbuf_used > 0) || ((rc > 0) && (pfds[i].revents & (POLLIN | POLLHUP | POLLERR)));
+    n += ready[i];
+  }
+  return n;
+}
+
 /* Discard any pending input on the serial port.
  */
 int gbser_flush(void* handle)
 {
   gbser_handle* h = gbser_get_handle(handle);
+  h->inbuf_start = 0;
   h->inbuf_used = 0;
   if (tcflush(h->fd, TCIFLUSH)) {
     return gbser_ERROR;
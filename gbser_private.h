@@ -22,7 +22,7 @@
 #define GBSER_PRIVATE_H_
 
 #define MYMAGIC 0x91827364
-#define BUFSIZE 512
+#define BUFSIZE 4096
 
 [[gnu::format(printf, 2, 3)]] void gbser_db(int l, const char* msg, ...);
 int gbser_fill_buffer(void* handle, unsigned want, unsigned* ms);
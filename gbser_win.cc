@@ -35,7 +35,9 @@ struct gbser_handle {
   DWORD           timeout;
   unsigned long   magic;
 
+  /* Received bytes not yet handed out are inbuf[inbuf_start, inbuf_start + inbuf_used). */
   unsigned char   inbuf[BUFSIZE];
+  unsigned        inbuf_start;
   unsigned        inbuf_used;
 };
 
@@ -275,22 +277,69 @@ unsigned gbser_read_buffer(void* handle, void** buf, unsigned* len)
     count = h->inbuf_used;
   }
 
-  memcpy(cp, h->inbuf, count);
-  memmove(h->inbuf, h->inbuf + count,
-          h->inbuf_used - count);
+  memcpy(cp, h->inbuf + h->inbuf_start, count);
+  h->inbuf_start += count;
   h->inbuf_used -= count;
+  if (h->inbuf_used == 0) {
+    h->inbuf_start = 0;
+  }
   *len -= count;
   cp   += count;
   *buf = (void*) cp;
   return count;
 }
 
+/* Make room behind the buffered bytes and return the number of bytes
+ * that can be read into h->inbuf + h->inbuf_start + h->inbuf_used, at
+ * least |want| - h->inbuf_used.  The buffered bytes are only moved to
+ * the front once the free space behind them runs short, so handing out
+ * bytes rarely moves data.
+ */
+static unsigned inbuf_room(gbser_handle* h, unsigned want)
+{
+  if (h->inbuf_start > BUFSIZE / 2 || h->inbuf_start + want > BUFSIZE) {
+    memmove(h->inbuf, h->inbuf + h->inbuf_start, h->inbuf_used);
+    h->inbuf_start = 0;
+  }
+  return BUFSIZE - h->inbuf_start - h->inbuf_used;
+}
+
 /* Return when the input buffer contains at least |want| bytes or |*ms|
  * milliseconds have elapsed. |ms| may be NULL or |*ms| may be zero to
  * poll the port for available bytes and return immediately. |*ms| will
  * be updated to indicate the remaining time on exit.
  * Returns the number of bytes available (>=0) or an error code (<0).
  */
+/* Move whatever the driver has already received into the buffer, up
+ * to the free space in it, without waiting.
+ */
+static int drain_driver_queue(gbser_handle* h, unsigned want)
+{
+  DWORD err, nread = 0;
+  COMSTAT stat{};
+  int rc;
+
+  ClearCommError(h->comport, &err, &stat);
+  if (stat.cbInQue > 0) {
+    DWORD count = inbuf_room(h, want);
+    if (count > stat.cbInQue) {
+      count = stat.cbInQue;
+    }
+    if (rc = set_rx_timeout(h, 1), rc) {
+      return rc;
+    }
+    if (!ReadFile(h->comport, h->inbuf + h->inbuf_start + h->inbuf_used,
+                  count, &nread, NULL)) {
+      err = GetLastError();
+      if (err != ERROR_COUNTER_TIMEOUT && err != ERROR_TIMEOUT) {
+        return gbser_ERROR;
+      }
+    }
+    h->inbuf_used += nread;
+  }
+  return gbser_OK;
+}
+
 int gbser_fill_buffer(void* handle, unsigned want, unsigned* ms)
 {
   int rc;
@@ -305,35 +354,22 @@ int gbser_fill_buffer(void* handle, unsigned want, unsigned* ms)
     return h->inbuf_used;
   }
 
-  if (NULL == ms || 0 == *ms) {
-    DWORD err, nread;
-    COMSTAT stat;
-    ClearCommError(h->comport, &err, &stat);
-    if (stat.cbInQue > 0) {
-      DWORD count = want - h->inbuf_used;
-      if (count > stat.cbInQue) {
-        count = stat.cbInQue;
-      }
-      if (rc = set_rx_timeout(h, 1), rc) {
-        return rc;
-      }
-      if (!ReadFile(h->comport, h->inbuf + h->inbuf_used,
-                    count, &nread, NULL)) {
-        err = GetLastError();
-        if (err != ERROR_COUNTER_TIMEOUT && err != ERROR_TIMEOUT) {
-          return gbser_ERROR;
-        }
-      }
-      h->inbuf_used += nread;
-    }
-  } else {
+  /* Take everything the driver has queued first, so a fast stream is
+   * read in large blocks instead of just the missing bytes.
+   */
+  if (rc = drain_driver_queue(h, want), rc) {
+    return rc;
+  }
+
+  if (NULL != ms && 0 != *ms && h->inbuf_used < want) {
     hp_time tv;
-    DWORD nread;
+    DWORD nread = 0;
     get_time(&tv);
     if (rc = set_rx_timeout(h, *ms), rc) {
       return rc;
     }
-    if (!ReadFile(h->comport, h->inbuf + h->inbuf_used,
+    inbuf_room(h, want);
+    if (!ReadFile(h->comport, h->inbuf + h->inbuf_start + h->inbuf_used,
                   want - h->inbuf_used,
                   &nread, NULL)) {
       DWORD err = GetLastError();
@@ -349,11 +385,37 @@ int gbser_fill_buffer(void* handle, unsigned want, unsigned* ms)
   return h->inbuf_used;
 }
 
+/* There is nothing like poll() for the handles of serial ports short of
+ * overlapped I/O, so look at the driver queues of all the ports every few
+ * milliseconds until one of them has something.
+ */
+int gbser_poll(void* const* handles, unsigned char* ready, unsigned count, unsigned ms)
+{
+  hp_time tv;
+  get_time(&tv);
+  for (;;) {
+    int n = 0;
+    for (unsigned i = 0; i < count; ++i) {
+      gbser_handle* h = gbser_get_handle(handles[i]);
+      if (int rc = drain_driver_queue(h, BUFSIZE); rc) {
+        return rc;
+      }
+      ready[i] = h->inbuf_used > 0;
+      n += ready[i];
+    }
+    if (n > 0 || elapsed(&tv) >= ms) {
+      return n;
+    }
+    Sleep(5);
+  }
+}
+
 /* Discard any pending input on the serial port.
  */
 int gbser_flush(void* handle)
 {
   gbser_handle* h = gbser_get_handle(handle);
+  h->inbuf_start = 0;
   h->inbuf_used = 0;
   if (!PurgeComm(h->comport, PURGE_RXCLEAR)) {
     return gbser_ERROR;
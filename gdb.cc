@@ -44,8 +44,8 @@
 #include "formspec.h"               // for FormatSpecificDataList
 #include "garmin_fs.h"              // for garmin_fs_t, garmin_ilink_t
 #include "garmin_tables.h"          // for gt_waypt_class_map_point, gt_color_index_by_rgb, gt_color_value, gt_waypt_classes_e, gt_find_desc_from_icon_number, gt_find_icon_number_from_desc, gt_gdb_display_mode_symbol, gt_get_icao_country, gt_waypt_class_user_waypoint, GDB, gt_display_mode_symbol
-#include "gbfile.h"                 // for gbfgetint32, gbfputint32, gbfgetc, gbfread, gbfwrite, gbfgetdbl, gbfputc, gbfgetcstr, gbfclose, gbfgetnativecstr, gbfopen_le, gbfputint16, gbfile, gbfcopyfrom, gbfputcstr, gbfrewind, gbfseek, gbftell, gbfgetcstr_old, gbfgetint16, gbfgetuint32, gbfputdbl
-#include "grtcirc.h"                // for RAD, gcdist, radtometers
+#include "gbfile.h"                 // for gbfgetint32, gbfputint32, gbfgetc, gbfread, gbfwrite, gbfgetdbl, gbfputc, gbfgetcstr, gbfclose, gbfgetnativecstr, gbfopen_le, gbfputint16, gbfile, gbfcopyfrom, gbfview, gbfpatchint32, gbfputcstr, gbfseek, gbftell, gbfgetcstr_old, gbfgetint16, gbfgetuint32, gbfputdbl
+#include "grtcirc.h"                // for RAD, gcdist, gcdist_meters_within, radtometers
 #include "jeeps/gpsmath.h"          // for GPS_Math_Deg_To_Semi, GPS_Math_Semi_To_Deg
 #include "mkshort.h"                // for MakeShort
 #include "src/core/datetime.h"      // for DateTime
@@ -89,13 +89,7 @@ GdbFormat::gdb_flush_waypt_queue(WptNamePosnHash& Q)
 {
 
   for (auto it = Q.cbegin(), end = Q.cend(); it != end; ++it) {
-    const Waypoint* wpt = it.value();
-    if (wpt->extra_data) {
-      // wpt->extra_data may be holding a pointer to a QString, courtesy
-      // the grossness at the end of write_waypoint_cb().
-      delete static_cast<QString*>(wpt->extra_data);
-    }
-    delete wpt;
+    delete it.value();
   }
   Q = WptNamePosnHash();
 }
@@ -258,9 +252,8 @@ GdbFormat::gdb_add_route_waypt(route_head* rte, Waypoint* ref, const int wpt_cla
     /* At this point we have found a waypoint with same name,
        but probably from another data stream. Check coordinates!
     */
-    double dist = radtometers(gcdist(ref->position(), tmp->position()));
-
-    if (fabs(dist) > 100) {
+    if (!gcdist_meters_within(ref->position(), tmp->position(), 100)) {
+      double dist = radtometers(gcdist(ref->position(), tmp->position()));
       fatal(MYNAME ": Route point mismatch!\n" \
             "  \"%s\" from waypoints differs to \"%s\"\n" \
             "  from route table by more than %0.1f meters!\n", \
@@ -597,9 +590,9 @@ GdbFormat::read_waypoint(gt_waypt_classes_e* waypt_class_out)
   DBG(GDB_DBG_WPTe, !res->description.isNull())
   printf(MYNAME "-wpt \"%s\" (%d): description = %s\n",
          qPrintable(res->shortname), wpt_class, qPrintable(res->description));
-  DBG(GDB_DBG_WPTe, res->urls.HasUrlLink())
+  DBG(GDB_DBG_WPTe, res->HasUrlLink())
   printf(MYNAME "-wpt \"%s\" (%d): url = %s\n",
-         qPrintable(res->shortname), wpt_class, qPrintable(res->urls.GetUrlLink().url_));
+         qPrintable(res->shortname), wpt_class, qPrintable(res->GetUrlLink().url_));
 #endif
   int category = FREAD_i16;
   if (category != 0) {
@@ -901,6 +894,7 @@ GdbFormat::read_track()
 
   int points = FREAD_i32;
 
+  track_reserve_wpts(res, points);
   for (int index = 0; index < points; index++) {
     auto* wpt = new Waypoint;
 
@@ -973,8 +967,8 @@ void
 GdbFormat::rd_deinit()
 {
   disp_summary(fin);
-  gdb_flush_waypt_queue(waypt_nameposn_in_hash);
-  waypt_name_in_hash = WptNameHash(); /* values already flushed */
+  waypt_nameposn_in_hash = WptNamePosnHash(); /* values in the global list */
+  waypt_name_in_hash = WptNameHash();
   gdb_flush_waypt_queue(waypt_nameposn_in_hidden_hash);
   waypt_name_in_hidden_hash = WptNameHash(); /* values already flushed */
   gbfclose(ftmp);
@@ -1001,10 +995,8 @@ GdbFormat::read()
       break;  /* break the loop */
     }
 
-    gbfrewind(ftmp);
-    gbfwrite(nullptr, 0, 0, ftmp);	/* truncate */
-    gbfcopyfrom(ftmp, fin, len);
-    gbfrewind(ftmp);
+    /* Decode the record in place, reads in it stop at its end. */
+    gbfview(ftmp, fin, len);
 
     gbfile* fsave = fin;			/* swap standard 'fin' with cached input */
     fin = ftmp;
@@ -1017,9 +1009,9 @@ GdbFormat::read()
       wpt = read_waypoint(&wpt_class);
       if (!gdb_hide_wpt || (wpt_class == 0)) {
         waypt_add(wpt);
-        auto* dupe = new Waypoint(*wpt);
-        waypt_nameposn_in_hash.insert(WptNamePosnKey(wpt->shortname, wpt->latitude, wpt->longitude), dupe);
-        waypt_name_in_hash.insert(wpt->shortname, dupe);
+        /* Route points are copied from these, the list owns them. */
+        waypt_nameposn_in_hash.insert(WptNamePosnKey(wpt->shortname, wpt->latitude, wpt->longitude), wpt);
+        waypt_name_in_hash.insert(wpt->shortname, wpt);
       } else {
         waypt_nameposn_in_hidden_hash.insert(WptNamePosnKey(wpt->shortname, wpt->latitude, wpt->longitude), wpt);
         waypt_name_in_hidden_hash.insert(wpt->shortname, wpt);
@@ -1123,8 +1115,7 @@ GdbFormat::write_header()
   FWRITE_C('D');     // Record Type
   FWRITE_i16(gdb_ver + 0x6a); // File Format
 
-  gbfile* fsave = fout;
-  fout = ftmp;
+  begin_item('A');
   FWRITE_i16(605); // program version 6.5 -> 6*100 + 5
 
    /*
@@ -1136,7 +1127,7 @@ GdbFormat::write_header()
   gdb_write_cstr(gdb_release_dt.toString(u"MMM dd yyyy"));
   gdb_write_cstr(gdb_release_dt.toString(u"HH:mm:ss"));
 
-  finalize_item(fsave, 'A');
+  finalize_item();
 
   gdb_write_cstr(u"MapSource");		/* MapSource magic */
 }
@@ -1159,8 +1150,8 @@ GdbFormat::gdb_check_waypt(Waypoint* wpt)
 
 void
 GdbFormat::write_waypoint(
-  const Waypoint* wpt, const QString& shortname, const garmin_fs_t* gmsd,
-  const int icon, const int display)
+  const Waypoint* wpt, const QString& shortname, const int wpt_class,
+  const garmin_fs_t* gmsd, const int icon, const int display)
 {
   char zbuf[32];
   char ffbuf[32];
@@ -1170,8 +1161,6 @@ GdbFormat::write_waypoint(
   memset(zbuf, 0, sizeof(zbuf));
   memset(ffbuf, 0xFF, sizeof(ffbuf));
 
-  int wpt_class = wpt->wpt_flags.fmt_use;		/* trick */
-
   gdb_write_cstr(shortname);			/* unique (!!!) shortname */
   FWRITE_i32(wpt_class);			/* waypoint class */
   gdb_write_cstr(garmin_fs_t::get_cc(gmsd, ""));		/* country code */
@@ -1196,7 +1185,7 @@ GdbFormat::write_waypoint(
   FWRITE_LATLON(wpt->longitude);		/* longitude */
   FWRITE_DBL(wpt->altitude, unknown_alt);	/* altitude */
   if (!wpt->notes.isEmpty()) {
-    gdb_write_cstr(wpt->notes);
+    gdb_write_cstr(wpt->notes.toString());
   } else {
     gdb_write_cstr(wpt->description);
   }
@@ -1261,8 +1250,8 @@ GdbFormat::write_waypoint(
     gdb_write_cstr(str);				/* instruction */
 #endif
 
-    FWRITE_i32(wpt->urls.size());
-    foreach (UrlLink l, wpt->urls) {
+    FWRITE_i32(wpt->GetUrlList().size());
+    foreach (UrlLink l, wpt->GetUrlList()) {
       gdb_write_cstr(l.url_);
     }
   }
@@ -1289,11 +1278,19 @@ GdbFormat::write_waypoint(
 void
 GdbFormat::route_compute_bounds(const route_head* rte, bounds* bounds)
 {
-  waypt_init_bounds(bounds);
+  bool moved = false;
   foreach (Waypoint* wpt, rte->waypoint_list) {
+    const double lat = wpt->latitude;
+    const double lon = wpt->longitude;
     gdb_check_waypt(wpt);
-    waypt_add_to_bounds(bounds, wpt);
+    if ((wpt->latitude != lat) || (wpt->longitude != lon)) {
+      moved = true;
+    }
+  }
+  if (moved) {
+    rte->invalidate_cache();
   }
+  *bounds = rte->extent().bbox;
 }
 
 void
@@ -1335,7 +1332,7 @@ GdbFormat::write_route(const route_head* rte, const QString& rte_name)
 
   for (auto it =rte->waypoint_list.cbegin(); it != rte->waypoint_list.cend(); ++it) {
 
-    Waypoint* wpt = *it;
+    Waypoint* rtept = *it;
     Waypoint* next = nullptr;
     if (index < points) {
       next = *std::next(it);
@@ -1345,25 +1342,24 @@ GdbFormat::write_route(const route_head* rte, const QString& rte_name)
     rtept_ct++;	/* increase informational number of written route points */
 
     if (index == 1) {
-      gdb_check_waypt(wpt);
+      gdb_check_waypt(rtept);
     }
     if (index < points) {
       gdb_check_waypt(next);
     }
 
-    Waypoint* test = gdb_find_wayptq(waypt_nameposn_out_hash, wpt);
-    if (test != nullptr) {
-      wpt = test;
-    } else {
+    const WptOut* written = gdb_find_written(rtept);
+    if (written == nullptr) {
       fatal(MYNAME ": Sorry, that should never happen!!!\n");
     }
+    const Waypoint* wpt = written->wpt;
 
     const garmin_fs_t* gmsd = garmin_fs_t::find(wpt);
 
-    /* extra_data may contain a modified shortname */
-    gdb_write_cstr((wpt->extra_data) ? *static_cast<QString*>(wpt->extra_data) : wpt->shortname);
+    /* the name may have been made unique when it was written */
+    gdb_write_cstr(written->name);
 
-    int wpt_class = wpt->wpt_flags.fmt_use;			/* trick */
+    int wpt_class = written->wpt_class;
 
     FWRITE_i32(wpt_class);				/* waypoint class */
     gdb_write_cstr(garmin_fs_t::get_cc(gmsd, ""));			/* country */
@@ -1480,22 +1476,55 @@ GdbFormat::write_track(const route_head* trk, const QString& trk_name)
 
 /*-----------------------------------------------------------------------------*/
 
+/*
+ * Every item is written behind its length and identifier.  Where the
+ * output can seek the length is written as a placeholder and patched once
+ * the item is complete, otherwise the item is collected in ftmp first.
+ */
+
+void
+GdbFormat::begin_item(const char identifier)
+{
+  item_identifier = identifier;
+  if (gdb_stream_items) {
+    item_start = gbftell(fout);
+    FWRITE_i32(0);		/* patched by finalize_item */
+    FWRITE_C(identifier);
+  } else {
+    item_origin = fout;
+    fout = ftmp;
+  }
+}
+
 void
-GdbFormat::finalize_item(gbfile* origin, const char identifier)
+GdbFormat::finalize_item()
 {
+  if (gdb_stream_items) {
+    int len = gbftell(fout) - item_start - 5;
+    gbfpatchint32(fout, item_start, len);
+    return;
+  }
+
   int len = gbftell(fout);
 
-  fout = origin;
+  fout = item_origin;
   gbfseek(ftmp, 0, SEEK_SET);
 
   FWRITE_i32(len);
-  FWRITE_C(identifier);
+  FWRITE_C(item_identifier);
   gbfcopyfrom(fout, ftmp, len);
 
   gbfseek(ftmp, 0, SEEK_SET);	/* Truncate memory stream */
   gbfwrite(nullptr, 0, 0, ftmp);
 }
 
+const GdbFormat::WptOut*
+GdbFormat::gdb_find_written(const Waypoint* wpt) const
+{
+  auto it = waypt_nameposn_out_hash.constFind(WptNamePosnKey(wpt->shortname, wpt->latitude, wpt->longitude));
+  return (it != waypt_nameposn_out_hash.cend()) ? &it.value() : nullptr;
+}
+
 /*-----------------------------------------------------------------------------*/
 
 void
@@ -1504,7 +1533,8 @@ GdbFormat::write_waypoint_cb(const Waypoint* refpt)
   /* do this when backup always happens in main */
 // but, but, casting away the const here is wrong...
   (const_cast<Waypoint*>(refpt))->shortname = refpt->shortname.trimmed();
-  Waypoint* test = gdb_find_wayptq(waypt_nameposn_out_hash, refpt);
+  const WptOut* written = gdb_find_written(refpt);
+  const Waypoint* test = (written != nullptr) ? written->wpt : nullptr;
 
   if (refpt->HasUrlLink() && test && test->HasUrlLink() && route_flag == 0) {
     const UrlLink& orig_link = refpt->GetUrlLink();
@@ -1522,13 +1552,11 @@ GdbFormat::write_waypoint_cb(const Waypoint* refpt)
 
   if (test == nullptr) {
     int display;
-    auto* wpt = new Waypoint(*refpt);
+    const Waypoint* wpt = refpt;
 
-    gdb_check_waypt(wpt);
-    waypt_nameposn_out_hash.insert(WptNamePosnKey(wpt->shortname, wpt->latitude, wpt->longitude), wpt);
+    gdb_check_waypt(const_cast<Waypoint*>(refpt));
 
-    gbfile* fsave = fout;
-    fout = ftmp;
+    begin_item('W');
 
     /* prepare the waypoint */
     const garmin_fs_t* gmsd = garmin_fs_t::find(wpt);
@@ -1537,7 +1565,6 @@ GdbFormat::write_waypoint_cb(const Waypoint* refpt)
     if (wpt_class == -1) {
       wpt_class = (route_flag) ? GDB_DEF_HIDDEN_CLASS : GDB_DEF_CLASS;
     }
-    wpt->wpt_flags.fmt_use = wpt_class; 	/* trick, we need this for the route(s) */
 
     int icon = garmin_fs_t::get_icon(gmsd, -1);
     if (icon < 0) {
@@ -1580,10 +1607,12 @@ GdbFormat::write_waypoint_cb(const Waypoint* refpt)
     }
 
     name = short_h->mkshort(name);
-    wpt->extra_data = new QString(name);
-    write_waypoint(wpt, name, gmsd, icon, display);
+    /* the routes refer to the written name and class */
+    waypt_nameposn_out_hash.insert(WptNamePosnKey(wpt->shortname, wpt->latitude, wpt->longitude),
+                                   {wpt, name, wpt_class});
+    write_waypoint(wpt, name, wpt_class, gmsd, icon, display);
 
-    finalize_item(fsave, 'W');
+    finalize_item();
   }
 }
 
@@ -1603,10 +1632,9 @@ GdbFormat::write_route_cb(const route_head* rte)
 
   rte_ct++;	/* increase informational number of written routes */
 
-  gbfile* fsave = fout;
-  fout = ftmp;
+  begin_item('R');
   write_route(rte, name);
-  finalize_item(fsave, 'R');
+  finalize_item();
 }
 
 void
@@ -1625,11 +1653,10 @@ GdbFormat::write_track_cb(const route_head* trk)
 
   trk_ct++;	/* increase informational number of written tracks */
 
-  gbfile* fsave = fout;
-  fout = ftmp;
+  begin_item('T');
   write_track(trk, name);
 
-  finalize_item(fsave, 'T');
+  finalize_item();
 }
 
 /*-----------------------------------------------------------------------------*/
@@ -1639,6 +1666,8 @@ GdbFormat::wr_init(const QString& fname)
 {
   fout = gbfopen_le(fname, "wb", MYNAME);
   ftmp = gbfopen_le(nullptr, "wb", MYNAME);
+  /* Compressed output and pipes can't go back to patch item lengths. */
+  gdb_stream_items = !fout->gzapi && !fout->zstdapi && !fout->xzapi && !fout->is_pipe;
 
   gdb_category = (gdb_opt_category) ? xstrtoi(gdb_opt_category, nullptr, 10) : 0;
   gdb_ver = (gdb_opt_ver && *gdb_opt_ver) ? xstrtoi(gdb_opt_ver, nullptr, 10) : 0;
@@ -1669,7 +1698,7 @@ void
 GdbFormat::wr_deinit()
 {
   disp_summary(fout);
-  gdb_flush_waypt_queue(waypt_nameposn_out_hash);
+  waypt_nameposn_out_hash = WptNamePosnOutHash();
   delete short_h;
   short_h = nullptr;
   gbfclose(fout);
@@ -35,7 +35,7 @@
 #include "format.h"         // for Format
 #include "garmin_fs.h"      // for garmin_fs_t
 #include "garmin_tables.h"  // for gt_waypt_classes_e
-#include "gbfile.h"         // for gbfile
+#include "gbfile.h"         // for gbfile, gbsize_t
 #include "mkshort.h"        // for MakeShort
 
 
@@ -83,6 +83,14 @@ public:
     double lon{};
   };
 
+  /* A waypoint as it was written, for the routes that refer to it. */
+  struct WptOut {
+    const Waypoint* wpt{nullptr};
+    QString name;	/* made unique by mkshort */
+    int wpt_class{};
+  };
+  using WptNamePosnOutHash = QHash<WptNamePosnKey, WptOut>;
+
   class WptNameKey;
   using WptNameHash = QHash<WptNameKey, Waypoint*>;
   class WptNameKey {
@@ -135,12 +143,14 @@ private:
   void reset_short_handle(const char* defname);
   void write_header();
   static void gdb_check_waypt(Waypoint* wpt);
-  void write_waypoint(const Waypoint* wpt, const QString& shortname, const garmin_fs_t* gmsd, int icon, int display);
+  void write_waypoint(const Waypoint* wpt, const QString& shortname, int wpt_class, const garmin_fs_t* gmsd, int icon, int display);
   static void route_compute_bounds(const route_head* rte, bounds* bounds);
   void route_write_bounds(bounds* bounds) const;
   void write_route(const route_head* rte, const QString& rte_name);
   void write_track(const route_head* trk, const QString& trk_name);
-  void finalize_item(gbfile* origin, char identifier);
+  void begin_item(char identifier);
+  void finalize_item();
+  const WptOut* gdb_find_written(const Waypoint* wpt) const;
   void write_waypoint_cb(const Waypoint* refpt);
   void write_route_cb(const route_head* rte);
   void write_track_cb(const route_head* trk);
@@ -148,6 +158,10 @@ private:
   /* Data Members */
 
   gbfile* fin{}, *fout{}, *ftmp{};
+  bool gdb_stream_items{};	/* patch item lengths in fout rather than staging in ftmp */
+  gbfile* item_origin{};
+  gboff_t item_start{};
+  char item_identifier{};
   int gdb_ver{}, gdb_category{};
   bool gdb_roadbook{};
   bool gdb_hide_wpt{};
@@ -157,7 +171,7 @@ private:
   WptNameHash waypt_name_in_hash;
   WptNamePosnHash waypt_nameposn_in_hidden_hash;
   WptNameHash waypt_name_in_hidden_hash;
-  WptNamePosnHash waypt_nameposn_out_hash;
+  WptNamePosnOutHash waypt_nameposn_out_hash;
   MakeShort* short_h{};
 
   char* gdb_opt_category{};
@@ -55,6 +55,14 @@ public:
   void wr_init(const QString& fname) override
   {}
   void write() override;
+  bool rd_can_run_concurrently() const override
+  {
+    return true;
+  }
+  bool wr_can_run_concurrently() const override
+  {
+    return true;
+  }
 
 private:
 
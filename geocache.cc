@@ -19,6 +19,8 @@
 
 #include "geocache.h"
 
+#include <cstddef>               // for size_t
+
 #include <QString>               // for QString
 #include <QVector>               // for QVector
 #include <Qt>                    // for CaseInsensitive
@@ -62,7 +64,7 @@ const QVector<Geocache::container_mapping> Geocache::container_map = {
 
 QString Geocache::UtfString::strip_html() const
 {
-  return is_html? ::strip_html(utf_string) : utf_string;
+  return is_html? ::strip_html(get_text()) : get_text();
 }
 
 void Geocache::set_type(const QString& type_name)
@@ -151,3 +153,10 @@ QString Geocache::get_icon() const
 
   return nullptr;
 }
+
+std::size_t Geocache::memory_usage() const
+{
+  return sizeof(*this) + gpsbabel::heap_bytes(placer) + gpsbabel::heap_bytes(hint) +
+         desc_short.heap_bytes() + desc_long.heap_bytes() +
+         gpsbabel::heap_bytes(personal_note);
+}
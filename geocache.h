@@ -19,17 +19,25 @@
 #ifndef GEOCACHE_H_INCLUDED_
 #define GEOCACHE_H_INCLUDED_
 
+#include <cstddef>              // for size_t
+
+#include <QSharedData>          // for QSharedData
 #include <QString>              // for QString
 #include <QVector>              // for QVector
 
 #include "src/core/datetime.h"  // for DateTime
+#include "src/core/footprint.h" // for heap_bytes
+#include "src/core/utf8string.h" // for Utf8String
 
 
 /*
  * Extended data if waypoint happens to represent a geocache.  This is
  * totally voluntary data...
+ *
+ * Copies of a Waypoint share their Geocache until one of them asks to
+ * change it with Waypoint::AllocGCData().
  */
-class Geocache
+class Geocache : public QSharedData
 {
 public:
 
@@ -69,14 +77,28 @@ public:
     gs_false
   };
 
+  /*
+   * Descriptions are mostly carried along and never looked at, so they
+   * are kept as UTF-8, which is about half the size, and only decoded
+   * when asked for.  Those read from a GPX file by the fast XML parser
+   * may refer to the file instead.
+   */
   class UtfString
   {
   public:
 
+    QString get_text() const {return utf8_.toString();}
+    void set_text(const QString& text) {utf8_ = text;}
+    // The text as it is, which may refer to the input.
+    void set_utf8(const gpsbabel::Utf8String& text) {utf8_ = text;}
+    bool isEmpty() const {return utf8_.isEmpty();}
     QString strip_html() const;
+    std::size_t heap_bytes() const {return gpsbabel::heap_bytes(utf8_.utf8());}
 
     bool is_html{false};
-    QString utf_string;
+
+  private:
+    gpsbabel::Utf8String utf8_;
   };
 
   /* Member Functions */
@@ -86,6 +108,7 @@ public:
   void set_container(const QString& container_name);
   QString get_container() const;
   QString get_icon() const;
+  std::size_t memory_usage() const;
 
   /* Data Members */
 
@@ -0,0 +1,342 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include "geofence.h"
+
+#include <algorithm>              // for find_if, max, min
+#include <cmath>                  // for isfinite
+#include <utility>                // for as_const
+
+#include <QJsonArray>             // for QJsonArray
+#include <QJsonDocument>          // for QJsonDocument
+#include <QJsonObject>            // for QJsonObject
+#include <QJsonParseError>        // for QJsonParseError
+#include <QJsonValue>             // for QJsonValue
+#include <QString>                // for QString
+#include <QStringList>            // for QStringList
+#include <QVariant>               // for QVariant
+#include <QtGlobal>               // for qsizetype
+
+#include "defs.h"
+#include "src/core/numeric.h"     // for scan_doubles
+#include "src/core/rtree.h"       // for RTree
+#include "src/core/scheduler.h"   // for parallel_for
+#include "src/core/textstream.h"  // for TextStream
+
+
+#if FILTERS_ENABLED
+#define MYNAME "geofence"
+
+void GeofenceFilter::start_fence(const QString& name)
+{
+  fences.append({name, edges.size(), 0, {}});
+  named = true;
+}
+
+/*
+ * Add a ring to the current geofence, or to a new one numbered after
+ * those before it if no geofence was named yet.  A ring needn't repeat
+ * its first vertex at the end, it is closed anyway.
+ */
+void GeofenceFilter::add_ring(QVector<Vertex>& ring)
+{
+  if ((ring.size() > 1) && (ring.first().lat == ring.last().lat) &&
+      (ring.first().lon == ring.last().lon)) {
+    ring.removeLast();
+  }
+  if (ring.size() < 3) {
+    ring.clear();
+    return;
+  }
+
+  if (!named) {
+    fences.append({QString::number(fences.size() + 1), edges.size(), 0, {}});
+  }
+  Fence& fence = fences.last();
+  if (fence.count == 0) {
+    fence.box = {ring.first().lat, ring.first().lat, ring.first().lon, ring.first().lon};
+  }
+  for (qsizetype i = 0; i < ring.size(); ++i) {
+    const Vertex& v1 = ring.at(i);
+    const Vertex& v2 = ring.at((i + 1) % ring.size());
+    edges.append({v1.lat, v1.lon, v2.lat, v2.lon});
+    fence.box.min_latitude = std::min(fence.box.min_latitude, v1.lat);
+    fence.box.max_latitude = std::max(fence.box.max_latitude, v1.lat);
+    fence.box.min_longitude = std::min(fence.box.min_longitude, v1.lon);
+    fence.box.max_longitude = std::max(fence.box.max_longitude, v1.lon);
+  }
+  fence.count += ring.size();
+  ring.clear();
+}
+
+/*
+ * The syntax of the polygon filter, one ring after another.  A comment
+ * "# geofence name" starts a geofence, which takes the rings up to the
+ * next one; before the first, every ring is a geofence of its own.
+ */
+void GeofenceFilter::read_polygons(const QString& text)
+{
+  QVector<Vertex> ring;
+  int fileline = 0;
+  for (QString line : text.split('\n')) {
+    fileline++;
+
+    auto pound = line.indexOf('#');
+    if (pound >= 0) {
+      const QString comment = line.mid(pound + 1).trimmed();
+      if ((comment == u"geofence") || comment.startsWith(u"geofence ")) {
+        add_ring(ring);
+        start_fence(comment.mid(8).trimmed());
+      }
+      line.truncate(pound);
+    }
+
+    double vertex[2] = {0, 0};
+    int argsfound = gpsbabel::scan_doubles(line, vertex, 2);
+    if ((argsfound != 2) || !std::isfinite(vertex[0]) || !std::isfinite(vertex[1])) {
+      if (line.trimmed().size() > 0) {
+        warning(MYNAME ": Warning: Geofence file contains unusable vertex on line %d.\n",
+                fileline);
+      }
+      continue;
+    }
+    ring.append({vertex[0], vertex[1]});
+    if ((ring.size() > 1) && (ring.first().lat == vertex[0]) &&
+        (ring.first().lon == vertex[1])) {
+      add_ring(ring);
+    }
+  }
+  add_ring(ring);
+}
+
+/*
+ * A FeatureCollection, a Feature or a bare geometry.  Every feature is
+ * a geofence named by its id, or by the name among its properties.
+ */
+void GeofenceFilter::read_geojson(const QString& text)
+{
+  QJsonParseError error;
+  const QJsonDocument document = QJsonDocument::fromJson(text.toUtf8(), &error);
+  if (!document.isObject()) {
+    fatal(MYNAME ": %s is not a GeoJSON object: %s\n", fileopt, qPrintable(error.errorString()));
+  }
+  const QJsonObject root = document.object();
+  const QString type = root.value(u"type").toString();
+  QJsonArray features;
+  if (type == u"FeatureCollection") {
+    features = root.value(u"features").toArray();
+  } else if (type == u"Feature") {
+    features.append(root);
+  } else {
+    start_fence(QString::number(fences.size() + 1));
+    read_geometry(root);
+    return;
+  }
+
+  for (const QJsonValue& value : std::as_const(features)) {
+    const QJsonObject feature = value.toObject();
+    const QJsonValue id = feature.value(u"id");
+    QString name = (id.isString() || id.isDouble()) ? id.toVariant().toString() :
+                   feature.value(u"properties").toObject().value(u"name").toString();
+    if (name.isEmpty()) {
+      name = QString::number(fences.size() + 1);
+    }
+    start_fence(name);
+    read_geometry(feature.value(u"geometry").toObject());
+  }
+}
+
+/* Polygons join the current geofence, other geometries are ignored. */
+void GeofenceFilter::read_geometry(const QJsonObject& geometry)
+{
+  const QString type = geometry.value(u"type").toString();
+  if (type == u"Polygon") {
+    read_rings(geometry.value(u"coordinates"));
+  } else if (type == u"MultiPolygon") {
+    const QJsonArray polygons = geometry.value(u"coordinates").toArray();
+    for (const QJsonValue& polygon : polygons) {
+      read_rings(polygon);
+    }
+  } else if (type == u"GeometryCollection") {
+    const QJsonArray geometries = geometry.value(u"geometries").toArray();
+    for (const QJsonValue& member : geometries) {
+      read_geometry(member.toObject());
+    }
+  }
+}
+
+/* GeoJSON positions are longitude first. */
+void GeofenceFilter::read_rings(const QJsonValue& rings)
+{
+  QVector<Vertex> ring;
+  const QJsonArray array = rings.toArray();
+  for (const QJsonValue& value : array) {
+    const QJsonArray positions = value.toArray();
+    for (const QJsonValue& position : positions) {
+      const QJsonArray p = position.toArray();
+      if ((p.size() >= 2) && p.at(0).isDouble() && p.at(1).isDouble()) {
+        ring.append({p.at(1).toDouble(), p.at(0).toDouble()});
+      }
+    }
+    add_ring(ring);
+  }
+}
+
+/* The odd/even test with a ray to the east; a side counts from its lower end up. */
+bool GeofenceFilter::inside(const Fence& fence, double lat, double lon) const
+{
+  bool in = false;
+  for (qsizetype i = fence.first; i < fence.first + fence.count; ++i) {
+    const Edge& e = edges.at(i);
+    if ((e.lat1 > lat) != (e.lat2 > lat)) {
+      const double crossing = e.lon1 + (lat - e.lat1) * (e.lon2 - e.lon1) / (e.lat2 - e.lat1);
+      if (lon < crossing) {
+        in = !in;
+      }
+    }
+  }
+  return in;
+}
+
+/*
+ * Store the geofence the point is in, the first in the file if there
+ * are several, or all of them separated by commas.  Points outside of
+ * every geofence are left alone.
+ */
+void GeofenceFilter::classify(Waypoint* wpt, QVector<qsizetype>& candidates) const
+{
+  tree->containing(wpt->latitude, wpt->longitude, candidates);
+  bool matched = false;
+  QString zones;
+  for (qsizetype i : std::as_const(candidates)) {
+    const Fence& fence = fences.at(i);
+    if (!inside(fence, wpt->latitude, wpt->longitude)) {
+      continue;
+    }
+    if (matched) {
+      zones += ',';
+      zones += fence.name;
+    } else {
+      zones = fence.name;
+      matched = true;
+      if (!allopt) {
+        break;
+      }
+    }
+  }
+  if (!matched) {
+    return;
+  }
+
+  switch (field) {
+  case Field::description:
+    wpt->description = zones;
+    break;
+  case Field::notes:
+    wpt->notes = zones;
+    break;
+  case Field::symbol:
+    wpt->icon_descr = zones;
+    break;
+  }
+}
+
+void GeofenceFilter::init()
+{
+  const QString fieldname = fieldopt;
+  if (fieldname == u"description") {
+    field = Field::description;
+  } else if (fieldname == u"notes") {
+    field = Field::notes;
+  } else if (fieldname == u"symbol") {
+    field = Field::symbol;
+  } else {
+    fatal(MYNAME ": the field option must be description, notes or symbol, not '%s'.\n", fieldopt);
+  }
+
+  gpsbabel::TextStream stream;
+  stream.open(fileopt, QIODevice::ReadOnly, MYNAME);
+  const QString text = stream.readAll();
+  stream.close();
+
+  const auto start = std::find_if(text.cbegin(), text.cend(), [](QChar c) {
+    return !c.isSpace();
+  });
+  if ((start != text.cend()) && (*start == '{')) {
+    read_geojson(text);
+  } else {
+    read_polygons(text);
+  }
+
+  /* A geofence line without rings after it leaves an empty geofence. */
+  fences.removeIf([](const Fence& fence) {
+    return fence.count == 0;
+  });
+  QVector<gpsbabel::RTree::Box> boxes;
+  boxes.reserve(fences.size());
+  for (const Fence& fence : std::as_const(fences)) {
+    boxes.append(fence.box);
+  }
+  tree = std::make_unique<gpsbabel::RTree>(boxes);
+}
+
+void GeofenceFilter::process_point(Waypoint* wpt)
+{
+  classify(wpt, found);
+}
+
+void GeofenceFilter::process()
+{
+  QVector<Waypoint*> points;
+  for (Waypoint* wpt : waypt_range()) {
+    points.append(wpt);
+  }
+  for (Waypoint* wpt : route_points()) {
+    points.append(wpt);
+  }
+  for (Waypoint* wpt : track_points()) {
+    points.append(wpt);
+  }
+  const qsizetype count = points.size();
+
+  /* Every point is classified on its own, so they may be classified side by side. */
+  auto work = [this, &points](qsizetype begin, qsizetype end)->void {
+    QVector<qsizetype> candidates;
+    for (qsizetype i = begin; i < end; ++i) {
+      classify(points.at(i), candidates);
+    }
+  };
+  const int threads = (opt_threads != nullptr) ? xstrtoi(opt_threads, nullptr, 10) : 1;
+  if ((threads > 1) && (count >= kParallelMin)) {
+    gpsbabel::parallel_for(count, (count + threads - 1) / threads, work);
+  } else {
+    work(0, count);
+  }
+}
+
+void GeofenceFilter::deinit()
+{
+  tree.reset();
+  fences.clear();
+  edges.clear();
+  found.clear();
+  named = false;
+}
+
+#endif // FILTERS_ENABLED
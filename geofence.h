@@ -0,0 +1,137 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef GEOFENCE_H_INCLUDED_
+#define GEOFENCE_H_INCLUDED_
+
+#include <memory>              // for unique_ptr
+
+#include <QJsonObject>         // for QJsonObject
+#include <QJsonValue>          // for QJsonValue
+#include <QString>             // for QString
+#include <QVector>             // for QVector
+#include <QtGlobal>            // for qsizetype
+
+#include "defs.h"              // for arglist_t, ARG_NOMINMAX, ARGTYPE_BOOL, ARGTYPE_FILE, ARGTYPE_INT, ARGTYPE_REQUIRED, ARGTYPE_STRING, Waypoint
+#include "filter.h"            // for Filter
+#include "src/core/rtree.h"    // for RTree
+
+#if FILTERS_ENABLED
+
+class GeofenceFilter:public Filter
+{
+public:
+  QVector<arglist_t>* get_args() override
+  {
+    return &args;
+  }
+  void init() override;
+  void process() override;
+  bool can_process_points() const override
+  {
+    return true;
+  }
+  void process_point(Waypoint* wpt) override;
+  void deinit() override;
+
+private:
+  /* Types */
+
+  enum class Field {
+    description,
+    notes,
+    symbol
+  };
+
+  /* A vertex, in degrees. */
+  struct Vertex {
+    double lat;
+    double lon;
+  };
+
+  /* One side of a ring. */
+  struct Edge {
+    double lat1, lon1;
+    double lat2, lon2;
+  };
+
+  /*
+   * The edges of all rings of a geofence are edges[first, first + count).
+   * A point is inside if a ray from it crosses them an odd number of
+   * times, so rings within rings are holes.
+   */
+  struct Fence {
+    QString name;
+    qsizetype first{};
+    qsizetype count{};
+    gpsbabel::RTree::Box box;
+  };
+
+  /* Constants */
+
+  /* Fewer points than this aren't worth starting threads for. */
+  static constexpr qsizetype kParallelMin = 16 * 1024;
+
+  /* Member Functions */
+
+  void start_fence(const QString& name);
+  void add_ring(QVector<Vertex>& ring);
+  void read_polygons(const QString& text);
+  void read_geojson(const QString& text);
+  void read_geometry(const QJsonObject& geometry);
+  void read_rings(const QJsonValue& rings);
+  bool inside(const Fence& fence, double lat, double lon) const;
+  void classify(Waypoint* wpt, QVector<qsizetype>& found) const;
+
+  /* Data Members */
+
+  char* fileopt = nullptr;
+  char* fieldopt = nullptr;
+  char* allopt = nullptr;
+  char* opt_threads = nullptr;
+
+  Field field{Field::description};
+  QVector<Fence> fences;
+  QVector<Edge> edges;
+  bool named{false};  // the current fence was named, so later rings join it
+  std::unique_ptr<gpsbabel::RTree> tree;
+  QVector<qsizetype> found;  // for process_point()
+
+  QVector<arglist_t> args = {
+    {
+      "file", &fileopt, "File containing the geofences",
+      nullptr, ARGTYPE_FILE | ARGTYPE_REQUIRED, ARG_NOMINMAX, nullptr
+    },
+    {
+      "field", &fieldopt, "Store geofences in description, notes or symbol",
+      "description", ARGTYPE_STRING, ARG_NOMINMAX, nullptr
+    },
+    {
+      "all", &allopt, "List every geofence a point is in",
+      nullptr, ARGTYPE_BOOL, ARG_NOMINMAX, nullptr
+    },
+    {
+      "threads", &opt_threads, "Classify large point lists on this many threads",
+      nullptr, ARGTYPE_INT, "1", nullptr, nullptr
+    },
+  };
+
+};
+#endif // FILTERS_ENABLED
+#endif // GEOFENCE_H_INCLUDED_
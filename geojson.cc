@@ -22,13 +22,13 @@
 #include <QJsonArray>              // for QJsonArray
 #include <QJsonDocument>           // for QJsonDocument, QJsonDocument::Compact, QJsonDocument::Indented, QJsonDocument::JsonFormat
 #include <QJsonObject>             // for QJsonObject
-#include <QJsonParseError>         // for QJsonParseError
 #include <QJsonValue>              // for QJsonValue
 #include <QJsonValueRef>           // for QJsonValueRef
 
 #include "defs.h"
 #include "geojson.h"
 #include "src/core/file.h"         // for File
+#include "src/core/jsonstream.h"   // for JsonArrayStream
 #include "src/core/logging.h"      // for Fatal
 
 
@@ -42,13 +42,44 @@ GeoJsonFormat::rd_init(const QString& fname)
 void
 GeoJsonFormat::wr_init(const QString& fname)
 {
-  feature_collection = new QJsonArray;
   ofd = new gpsbabel::File(fname);
   ofd->open(QIODevice::WriteOnly);
+
+  /*
+   * Features are written as they are produced, laid out exactly as
+   * QJsonDocument lays out the whole FeatureCollection, whose members
+   * it sorts by name.
+   */
+  style = compact_opt ? QJsonDocument::Compact : QJsonDocument::Indented;
+  ofd->write(style == QJsonDocument::Compact ? "{\"features\":[" : "{\n    \"features\": [\n");
+  feature_count = 0;
 }
 
 void
-GeoJsonFormat::geojson_waypt_pr(const Waypoint* waypoint) const
+GeoJsonFormat::geojson_write_feature(const QJsonObject& feature)
+{
+  QByteArray json = QJsonDocument(feature).toJson(style);
+  if (style == QJsonDocument::Compact) {
+    if (feature_count > 0) {
+      ofd->write(",");
+    }
+  } else {
+    // Indent the feature to its place in the features array.
+    if (feature_count > 0) {
+      ofd->write(",\n");
+    }
+    if (json.endsWith('\n')) {
+      json.chop(1);
+    }
+    json.replace('\n', "\n        ");
+    json.prepend("        ");
+  }
+  ofd->write(json);
+  ++feature_count;
+}
+
+void
+GeoJsonFormat::geojson_waypt_pr(const Waypoint* waypoint)
 {
   QJsonObject geometry;
   geometry[TYPE] = POINT;
@@ -85,7 +116,7 @@ GeoJsonFormat::geojson_waypt_pr(const Waypoint* waypoint) const
     feature[PROPERTIES] = properties;
   }
 
-  feature_collection->append(feature);
+  geojson_write_feature(feature);
 }
 
 void
@@ -99,19 +130,18 @@ GeoJsonFormat::rd_deinit()
 void
 GeoJsonFormat::wr_deinit()
 {
-  QJsonObject object;
-  object[TYPE] = FEATURE_COLLECTION;
-  object[FEATURES]  = *feature_collection;
-
-  QJsonDocument save(object);
-  QJsonDocument::JsonFormat style = compact_opt ? QJsonDocument::Compact : QJsonDocument::Indented;
-  ofd->write(save.toJson(style));
+  if (style == QJsonDocument::Compact) {
+    ofd->write("],\"type\":\"FeatureCollection\"}");
+  } else {
+    if (feature_count > 0) {
+      ofd->write("\n");
+    }
+    ofd->write("    ],\n    \"type\": \"FeatureCollection\"\n}\n");
+  }
   ofd->close();
 
   delete ofd;
   ofd = nullptr;
-  delete feature_collection;
-  feature_collection = nullptr;
 }
 
 Waypoint*
@@ -143,89 +173,94 @@ GeoJsonFormat::routes_from_polygon_coordinates(const QJsonArray& polygon)
 void
 GeoJsonFormat::read()
 {
-  QString file_content = ifd->readAll();
-  QJsonParseError error{};
-  QJsonDocument document = QJsonDocument::fromJson(file_content.toUtf8(), &error);
-  if (error.error != QJsonParseError::NoError) {
-    fatal(FatalMsg().nospace() << MYNAME << ": GeoJSON parse error in " << ifd->fileName() << ": " << error.errorString());
+  /*
+   * Features are read one at a time, so only the largest of them, not the
+   * whole file, has to fit in memory at once.  Anything but a
+   * FeatureCollection is ignored, and as QJsonDocument writes the type
+   * after the features the stream may have to scan ahead for it.
+   */
+  gpsbabel::JsonArrayStream stream(ifd, FEATURES);
+  QJsonValue type;
+  bool is_collection = stream.peek_member(TYPE, type) && (type == FEATURE_COLLECTION);
+  QJsonValue feature;
+  while (is_collection && stream.next(feature)) {
+    geojson_read_feature(feature.toObject());
   }
-  QJsonObject rootObject = document.object();
-
-  if (rootObject[TYPE] != FEATURE_COLLECTION) {
-    return;
+  if (stream.has_error()) {
+    fatal(FatalMsg().nospace() << MYNAME << ": GeoJSON parse error in " << ifd->fileName() << ": " << stream.error_string());
   }
-  QJsonArray features = rootObject.value(FEATURES).toArray();
-  for (auto&& iterator : features) {
-    QJsonObject feature = iterator.toObject();
-    QJsonObject properties = (feature.value(PROPERTIES)).toObject();
-    QString name;
-    QString description;
-    if (!properties.empty()) {
-      if (properties.contains(NAME)) {
-        name = properties[NAME].toString();
-      }
-      if (properties.contains(DESCRIPTION)) {
-        description = properties[DESCRIPTION].toString();
-      }
+}
+
+void
+GeoJsonFormat::geojson_read_feature(const QJsonObject& feature) const
+{
+  QJsonObject properties = (feature.value(PROPERTIES)).toObject();
+  QString name;
+  QString description;
+  if (!properties.empty()) {
+    if (properties.contains(NAME)) {
+      name = properties[NAME].toString();
+    }
+    if (properties.contains(DESCRIPTION)) {
+      description = properties[DESCRIPTION].toString();
     }
+  }
 
-    QJsonObject geometry = feature.value(GEOMETRY).toObject();
-    auto geometry_type = geometry[TYPE];
-    if (geometry_type == POINT) {
-      QJsonArray coordinates = geometry.value(COORDINATES).toArray();
-      auto* waypoint = waypoint_from_coordinates(coordinates);
-      waypoint->shortname = name;
-      waypoint->description = description;
-      if (properties.contains(URL)) {
-        QString url = properties[URL].toString();
-        if (properties.contains(URLNAME)) {
-          QString url_text = properties[URLNAME].toString();
-          waypoint->AddUrlLink(UrlLink(url, url_text));
-        } else {
-          waypoint->AddUrlLink(UrlLink(url));
-        }
+  QJsonObject geometry = feature.value(GEOMETRY).toObject();
+  auto geometry_type = geometry[TYPE];
+  if (geometry_type == POINT) {
+    QJsonArray coordinates = geometry.value(COORDINATES).toArray();
+    auto* waypoint = waypoint_from_coordinates(coordinates);
+    waypoint->shortname = name;
+    waypoint->description = description;
+    if (properties.contains(URL)) {
+      QString url = properties[URL].toString();
+      if (properties.contains(URLNAME)) {
+        QString url_text = properties[URLNAME].toString();
+        waypoint->AddUrlLink(UrlLink(url, url_text));
+      } else {
+        waypoint->AddUrlLink(UrlLink(url));
       }
+    }
+    waypt_add(waypoint);
+  } else if (geometry_type == MULTIPOINT) {
+    QJsonArray coordinates = geometry.value(COORDINATES).toArray();
+    for (auto&& coordinate : coordinates) {
+      auto* waypoint = waypoint_from_coordinates(coordinate.toArray());
       waypt_add(waypoint);
-    } else if (geometry_type == MULTIPOINT) {
-      QJsonArray coordinates = geometry.value(COORDINATES).toArray();
-      for (auto&& coordinate : coordinates) {
-        auto* waypoint = waypoint_from_coordinates(coordinate.toArray());
-        waypt_add(waypoint);
-      }
-    } else if (geometry_type == LINESTRING) {
-      QJsonArray coordinates = geometry.value(COORDINATES).toArray();
+    }
+  } else if (geometry_type == LINESTRING) {
+    QJsonArray coordinates = geometry.value(COORDINATES).toArray();
+    auto* route = new route_head;
+    route->rte_name = name;
+    route_add_head(route);
+    for (auto&& coordinate : coordinates) {
+      auto* waypoint = waypoint_from_coordinates(coordinate.toArray());
+      route_add_wpt(route, waypoint);
+    }
+  } else if (geometry_type == POLYGON) {
+    QJsonArray polygon = geometry.value(COORDINATES).toArray();
+    routes_from_polygon_coordinates(polygon);
+  } else if (geometry_type == MULTIPOLYGON) {
+    QJsonArray polygons = geometry.value(COORDINATES).toArray();
+    for (auto&& polygons_iterator : polygons) {
+      QJsonArray polygon = polygons_iterator.toArray();
+      routes_from_polygon_coordinates(polygon);
+    }
+  } else if (geometry_type == MULTILINESTRING) {
+    QJsonArray line_strings = geometry.value(COORDINATES).toArray();
+    for (auto&& line_string : line_strings) {
+      QJsonArray coordinates = line_string.toArray();
       auto* route = new route_head;
-      route->rte_name = name;
-      route_add_head(route);
+      track_add_head(route);
       for (auto&& coordinate : coordinates) {
         auto* waypoint = waypoint_from_coordinates(coordinate.toArray());
         route_add_wpt(route, waypoint);
       }
-    } else if (geometry_type == POLYGON) {
-      QJsonArray polygon = geometry.value(COORDINATES).toArray();
-      routes_from_polygon_coordinates(polygon);
-    } else if (geometry_type == MULTIPOLYGON) {
-      QJsonArray polygons = geometry.value(COORDINATES).toArray();
-      for (auto&& polygons_iterator : polygons) {
-        QJsonArray polygon = polygons_iterator.toArray();
-        routes_from_polygon_coordinates(polygon);
-      }
-    } else if (geometry_type == MULTILINESTRING) {
-      QJsonArray line_strings = geometry.value(COORDINATES).toArray();
-      for (auto&& line_string : line_strings) {
-        QJsonArray coordinates = line_string.toArray();
-        auto* route = new route_head;
-        track_add_head(route);
-        for (auto&& coordinate : coordinates) {
-          auto* waypoint = waypoint_from_coordinates(coordinate.toArray());
-          route_add_wpt(route, waypoint);
-        }
-      }
     }
   }
 }
 
-
 void GeoJsonFormat::geojson_track_hdr(const route_head* track)
 {
   track_object = new QJsonObject();
@@ -258,7 +293,7 @@ void GeoJsonFormat::geojson_track_tlr(const route_head* /*unused*/)
   geometry[TYPE] = LINESTRING;
   geometry[COORDINATES] = *track_coords;
   (*track_object)[GEOMETRY] = geometry;
-  feature_collection->append(*track_object);
+  geojson_write_feature(*track_object);
   delete track_object;
   track_object = nullptr;
   delete track_coords;
@@ -20,6 +20,7 @@
 #define GEOJSON_H_INCLUDED_
 
 #include <QJsonArray>                // for QJsonArray
+#include <QJsonDocument>             // for QJsonDocument, QJsonDocument::JsonFormat
 #include <QJsonObject>               // for QJsonObject
 #include <QString>                   // for QString, QStringLiteral
 #include <QVector>                   // for QVector
@@ -48,6 +49,11 @@ public:
     return FF_CAP_RW_ALL;
   }
 
+  unsigned int wr_fields() const override
+  {
+    return wpt_field_none;
+  }
+
   void rd_init(const QString& fname) override;
   void read() override;
   void rd_deinit() override;
@@ -58,7 +64,9 @@ public:
 private:
   /* Member Functions */
 
-  void geojson_waypt_pr(const Waypoint* waypoint) const;
+  void geojson_write_feature(const QJsonObject& feature);
+  void geojson_read_feature(const QJsonObject& feature) const;
+  void geojson_waypt_pr(const Waypoint* waypoint);
   static Waypoint* waypoint_from_coordinates(const QJsonArray& coordinates);
   static void routes_from_polygon_coordinates(const QJsonArray& polygon);
   void geojson_track_hdr(const route_head* track);
@@ -99,7 +107,8 @@ private:
     },
   };
 
-  QJsonArray* feature_collection = nullptr;
+  QJsonDocument::JsonFormat style{QJsonDocument::Indented};
+  int feature_count{0};
 
 };
 #endif // GEOJSON_H_INCLUDED_
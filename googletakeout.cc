@@ -22,6 +22,10 @@
 
 #include "googletakeout.h"
 
+#include <memory>               // for unique_ptr, make_unique
+#include <utility>              // for move
+#include <vector>               // for vector
+
 #include <QChar>                // for operator==, QChar
 #include <QDateTime>            // for QDateTime
 #include <QDebug>               // for QDebug
@@ -30,15 +34,17 @@
 #include <QFileInfoList>        // for QFileInfoList
 #include <QIODevice>            // for operator|, QIODevice
 #include <QJsonArray>           // for QJsonArray, QJsonArray::const_iterator
-#include <QJsonDocument>        // for QJsonDocument
 #include <QJsonObject>          // for QJsonObject, QJsonObject::const_iterator
-#include <QJsonParseError>      // for QJsonParseError, QJsonParseError::NoError
+#include <QJsonValue>           // for QJsonValue
 #include <QJsonValueRef>        // for QJsonValueRef
 #include <QtCore>               // for ISODate, QIODeviceBase::ReadOnly, QIODeviceBase::Text
 
+#include "session.h"            // for curr_session, use_session, ThreadScope
 #include "src/core/datetime.h"  // for DateTime
 #include "src/core/file.h"      // for File
-#include "src/core/logging.h"   // for Debug, FatalMsg, Warning
+#include "src/core/jsonstream.h"  // for JsonArrayStream
+#include "src/core/logging.h"   // for Debug, FatalError, FatalMsg, Warning
+#include "src/core/scheduler.h"  // for parallel_for
 
 
 void GoogleTakeoutFormat::takeout_fatal(const QString& message) {
@@ -88,54 +94,49 @@ bool GoogleTakeoutFormat::track_maybe_add_wpt(route_head* route, Waypoint* waypo
   return true;
 }
 
-QList<QJsonObject> GoogleTakeoutFormat::GoogleTakeoutInputStream::readJson(
-    const QString& source)
+/*
+ * Read the timelineObjects of one file as they are parsed, so only the
+ * one being converted is held in memory, not the whole file.
+ */
+void GoogleTakeoutFormat::readJson(const QString& source, TakeoutCounts& counts) const
 {
   if (global_opts.debug_level >= 2) {
     Debug(2) << "Reading from JSON " << source;
   }
-  auto* ifd = new gpsbabel::File(source);
-  ifd->open(QIODevice::ReadOnly | QIODevice::Text);
-  const QString content = ifd->readAll();
-  QJsonParseError error{};
-  const QJsonDocument doc = QJsonDocument::fromJson(content.toUtf8(), &error);
-  if (error.error != QJsonParseError::NoError) {
+  gpsbabel::File ifd(source);
+  ifd.open(QIODevice::ReadOnly | QIODevice::Text);
+  gpsbabel::JsonArrayStream stream(&ifd, TIMELINE_OBJECTS);
+  int items = 0;
+  QJsonValue val;
+  while (stream.next(val)) {
+    if (!val.isObject()) {
+      takeout_fatal(ifd.fileName() + " has non-object in timelineObjects");
+    }
+    add_timeline_object(val.toObject(), counts);
+    ++items;
+  }
+  if (stream.has_error()) {
     takeout_fatal(
-      QString("JSON parse error in ") + ifd->fileName() + ": " +
-      error.errorString()
+      QString("JSON parse error in ") + ifd.fileName() + ": " +
+      stream.error_string()
     );
   }
-
-  const QJsonObject root = doc.object();
-  const QJsonValue timelineObjectsIn = root.value(TIMELINE_OBJECTS);
-  if (timelineObjectsIn.isNull()) {
+  if (!stream.seen_array() && stream.members().value(TIMELINE_OBJECTS).isNull()) {
     takeout_fatal(
-      ifd->fileName() + " is missing required \"" +
+      ifd.fileName() + " is missing required \"" +
       TIMELINE_OBJECTS + "\" section"
     );
   }
-
-  const QJsonArray timelineJson = timelineObjectsIn.toArray();
-  QList<QJsonObject> timeline;
-  for (QJsonValue&& val : timelineJson) {
-    if (val.isObject()) {
-      timeline.append(val.toObject());
-    } else {
-      takeout_fatal(ifd->fileName() + " has non-object in timelineObjects");
-    }
-  }
-  ifd->close();
-  delete ifd;
-  if (timeline.isEmpty()) {
+  ifd.close();
+  if (items == 0) {
     takeout_warning(QString(source) + " does not contain any timelineObjects");
   }
   if (global_opts.debug_level >= 2) {
-    Debug(2) << "Saw " << timeline.size() << " timelineObjects in " << source;
+    Debug(2) << "Saw " << items << " timelineObjects in " << source;
   }
-  return timeline;
 }
 
-QList<QString> GoogleTakeoutFormat::GoogleTakeoutInputStream::readDir(
+QList<QString> GoogleTakeoutFormat::readDir(
     const QString& source)
 {
   if (global_opts.debug_level >= 2) {
@@ -219,59 +220,114 @@ GoogleTakeoutFormat::read()
   if (global_opts.debug_level >= 4) {
     Debug(4) << "rd_init(" << fname << ")";
   }
-  GoogleTakeoutInputStream inputStream(fname);
+  const QList<QString> sources = takeout_sources(fname);
 
-  int items = 0;
-  int points = 0;
-  int place_visits = 0;
-  int activity_segments = 0;
-  QJsonValue iterator = inputStream.next();
+  TakeoutCounts counts;
+  int threads = (opt_threads != nullptr) ? xstrtoi(opt_threads, nullptr, 10) : 1;
+  if ((threads > 1) && (sources.size() > 1) && (waypt_sink() == nullptr)) {
+    read_parallel(sources, threads, counts);
+  } else {
+    for (const auto& source : sources) {
+      readJson(source, counts);
+    }
+  }
+  if (global_opts.debug_level >= 1) {
+    Debug(1) << MYNAME << ": Processed " << counts.items << " items: " <<
+      counts.place_visits << " " << PLACE_VISIT << ", " << counts.activity_segments <<
+      " " << ACTIVITY_SEGMENT << " (" << counts.points << " points total)";
+  }
+}
+
+/*
+ * Read the files on several threads, each into lists of its own, and
+ * splice their points in in the order of the files, which is
+ * chronological, so the result is the same as reading them one by one.
+ */
+void
+GoogleTakeoutFormat::read_parallel(const QList<QString>& sources, int threads, TakeoutCounts& counts) const
+{
+  std::vector<std::unique_ptr<TakeoutFile>> files;
+  for (const auto& source : sources) {
+    auto file = std::make_unique<TakeoutFile>();
+    file->source = source;
+    files.push_back(std::move(file));
+  }
 
-  for (; !iterator.isNull(); iterator = inputStream.next()) {
-    ++ items;
-    /*
-     * A timelineObject is stored in a single-element dictionary.
-     * The key will be either a "placeVisit" (waypoint) or
-     * "activitySegment" (movement), and the value is another dictionary
-     * containing the timelineObject's details.
-     *
-     */
-    const QJsonObject timelineObjectContainer = iterator.toObject();
-    int len = timelineObjectContainer.size();
-    if (len != 1) {
-      takeout_fatal(
-        QString("expected a single key dict, got ") + QString::number(len) +
-        " keys"
-      );
+  const session_t* session = curr_session();
+  const auto count = static_cast<qsizetype>(files.size());
+  gpsbabel::parallel_for(count, (count + threads - 1) / threads,
+  [this, &files, session](qsizetype begin, qsizetype end) {
+    const ThreadScope scope;
+    use_session(session);
+    fatal_set_throws(true);
+    for (qsizetype i = begin; i < end; ++i) {
+      TakeoutFile* f = files.at(i).get();
+      waypt_use_list(&f->waypoints);
+      route_use_lists(&f->routes, &f->tracks);
+      try {
+        readJson(f->source, f->counts);
+      } catch (const FatalError&) {
+        // The message has been logged already.
+        f->failed = true;
+      }
     }
-    const QJsonObject::const_iterator timelineObjectIterator =
-      timelineObjectContainer.constBegin();
-    const QString& timelineObjectType = timelineObjectIterator.key();
-    const QJsonObject& timelineObjectDetail =
-      timelineObjectIterator.value().toObject();
-    if (timelineObjectType == PLACE_VISIT) {
-      add_place_visit(timelineObjectDetail);
-      ++ place_visits;
-      ++ points;
-    } else if (timelineObjectType == ACTIVITY_SEGMENT) {
-      points += add_activity_segment(timelineObjectDetail);
-      ++ activity_segments;
-    } else {
-      takeout_fatal(
-        QString("unknown timeline object type \"") + timelineObjectType +
-        "\""
-      );
+  });
+
+  for (const auto& file : files) {
+    if (file->failed) {
+      takeout_fatal(QString("giving up after errors reading ") + file->source);
     }
   }
-  if (global_opts.debug_level >= 1) {
-    Debug(1) << MYNAME << ": Processed " << items << " items: " <<
-      place_visits << " " << PLACE_VISIT << ", " << activity_segments <<
-      " " << ACTIVITY_SEGMENT << " (" << points << " points total)";
+  for (const auto& file : files) {
+    waypt_splice(&file->waypoints);
+    track_splice(&file->tracks);
+    counts.items += file->counts.items;
+    counts.points += file->counts.points;
+    counts.place_visits += file->counts.place_visits;
+    counts.activity_segments += file->counts.activity_segments;
   }
 }
 
 void
-GoogleTakeoutFormat::add_place_visit(const QJsonObject& placeVisit)
+GoogleTakeoutFormat::add_timeline_object(const QJsonObject& timelineObjectContainer, TakeoutCounts& counts) const
+{
+  ++ counts.items;
+  /*
+   * A timelineObject is stored in a single-element dictionary.
+   * The key will be either a "placeVisit" (waypoint) or
+   * "activitySegment" (movement), and the value is another dictionary
+   * containing the timelineObject's details.
+   *
+   */
+  int len = timelineObjectContainer.size();
+  if (len != 1) {
+    takeout_fatal(
+      QString("expected a single key dict, got ") + QString::number(len) +
+      " keys"
+    );
+  }
+  const QJsonObject::const_iterator timelineObjectIterator =
+    timelineObjectContainer.constBegin();
+  const QString& timelineObjectType = timelineObjectIterator.key();
+  const QJsonObject& timelineObjectDetail =
+    timelineObjectIterator.value().toObject();
+  if (timelineObjectType == PLACE_VISIT) {
+    add_place_visit(timelineObjectDetail);
+    ++ counts.place_visits;
+    ++ counts.points;
+  } else if (timelineObjectType == ACTIVITY_SEGMENT) {
+    counts.points += add_activity_segment(timelineObjectDetail);
+    ++ counts.activity_segments;
+  } else {
+    takeout_fatal(
+      QString("unknown timeline object type \"") + timelineObjectType +
+      "\""
+    );
+  }
+}
+
+void
+GoogleTakeoutFormat::add_place_visit(const QJsonObject& placeVisit) const
 {
   /*
    * placeVisits:
@@ -317,7 +373,7 @@ GoogleTakeoutFormat::add_place_visit(const QJsonObject& placeVisit)
  * returns the total number of points added
  */
 int
-GoogleTakeoutFormat::add_activity_segment(const QJsonObject& activitySegment)
+GoogleTakeoutFormat::add_activity_segment(const QJsonObject& activitySegment) const
 {
   /*
    * activitySegment:
@@ -400,30 +456,25 @@ GoogleTakeoutFormat::add_activity_segment(const QJsonObject& activitySegment)
   return n_points;
 }
 
-void GoogleTakeoutFormat::GoogleTakeoutInputStream::loadSource(const QString& source) {
-  const QFileInfo info{source};
-  if (info.isDir()) {
-    sources += readDir(source);
-  } else if (info.exists()) {
-    timelineObjects.append(readJson(source));
-  } else {
-    takeout_fatal(source + ": No such file or directory");
-  }
-}
-
-QJsonValue GoogleTakeoutFormat::GoogleTakeoutInputStream::next() {
-  if (!timelineObjects.isEmpty()) {
-    QJsonValue nextObject = timelineObjects.first();
-    timelineObjects.removeFirst();
-    return nextObject;
-  }
-
-  if (!sources.isEmpty()) {
-    const QString filename = sources.first();
-    sources.removeFirst();
-    loadSource(filename);
-    return next();
+/*
+ * Expand the source into the files to read, in the order they were
+ * found: the year folders of the all-time folder, and the months of
+ * each year.
+ */
+QList<QString> GoogleTakeoutFormat::takeout_sources(const QString& source)
+{
+  QList<QString> pending{source};
+  QList<QString> files;
+  while (!pending.isEmpty()) {
+    const QString path = pending.takeFirst();
+    const QFileInfo info{path};
+    if (info.isDir()) {
+      pending += readDir(path);
+    } else if (info.exists()) {
+      files.append(path);
+    } else {
+      takeout_fatal(path + ": No such file or directory");
+    }
   }
-
-  return QJsonValue();
+  return files;
 }
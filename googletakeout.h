@@ -23,7 +23,6 @@
 #define GOOGLETAKEOUT_H_INCLUDED_
 
 #include <QJsonObject>     // for QJsonObject
-#include <QJsonValue>      // for QJsonValue
 #include <QList>           // for QList
 #include <QString>         // for QString
 #include <QVector>         // for QVector
@@ -94,29 +93,21 @@ private:
 
   /* Types */
 
-  class GoogleTakeoutInputStream
-  {
-  public:
-    /* Special Member Functions */
-    GoogleTakeoutInputStream() = default;
-    GoogleTakeoutInputStream(const QString& source) : sources({source}) {}
-
-    /* Member Functions */
-
-    // Returns the next timelineObject, or a null QJsonValue if we're at the end
-    QJsonValue next();
-
-  private:
-    /* Member Functions */
-
-    static QList<QJsonObject> readJson(const QString& source);
-    static QList<QString> readDir(const QString& source);
-    void loadSource(const QString& source);
-
-    /* Data Members */
+  struct TakeoutCounts {
+    int items{0};
+    int points{0};
+    int place_visits{0};
+    int activity_segments{0};
+  };
 
-    QList<QString> sources;
-    QList<QJsonObject> timelineObjects;
+  /* One Location History file read on a worker thread */
+  struct TakeoutFile {
+    QString source;
+    TakeoutCounts counts;
+    WaypointList waypoints;
+    RouteList routes;
+    RouteList tracks;
+    bool failed{false};
   };
 
   /* Member Functions */
@@ -125,13 +116,26 @@ private:
   static void takeout_warning(const QString& message);
   static Waypoint* takeout_waypoint(int lat_e7, int lon_e7, const QString* shortname, const QString* description, const QString* start_str);
   static bool track_maybe_add_wpt(route_head* route, Waypoint* waypoint);
+  static QList<QString> readDir(const QString& source);
+  static QList<QString> takeout_sources(const QString& source);
+  void readJson(const QString& source, TakeoutCounts& counts) const;
+  void add_timeline_object(const QJsonObject& timelineObjectContainer, TakeoutCounts& counts) const;
+  void read_parallel(const QList<QString>& sources, int threads, TakeoutCounts& counts) const;
   static void title_case(QString& title);
-  void add_place_visit(const QJsonObject& placeVisit);
-  int add_activity_segment(const QJsonObject& activitySegment);
+  void add_place_visit(const QJsonObject& placeVisit) const;
+  int add_activity_segment(const QJsonObject& activitySegment) const;
 
   /* Data Members */
 
-  QVector<arglist_t> googletakeout_args;
+  char* opt_threads{nullptr};
+
+  QVector<arglist_t> googletakeout_args = {
+    {
+      "threads", &opt_threads,
+      "Read the monthly files on this many threads",
+      nullptr, ARGTYPE_INT, "1", nullptr, nullptr
+    },
+  };
 };
 
 #endif /* GOOGLETAKEOUT_H_INCLUDED_ */
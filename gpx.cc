@@ -21,18 +21,23 @@
 
 #include "gpx.h"
 
+#include <algorithm>                        // for find, max, min, stable_sort
 #include <cassert>                          // for assert
-#include <cmath>                            // for lround
+#include <cmath>                            // for lround, fabs, isfinite, pow
 #include <cstdio>                           // for sscanf
-#include <cstdint>                          // for uint16_t
-#include <cstring>                          // for strchr, strncpy
+#include <cstdint>                          // for uint16_t, uint32_t, uint64_t
+#include <cstring>                          // for memchr, strchr, strncpy
+#include <exception>                        // for exception_ptr, current_exception, rethrow_exception
+#include <iterator>                         // for size
+#include <memory>                           // for unique_ptr, make_unique
 #include <optional>                         // for optional
-#include <utility>                          // for as_const
+#include <string_view>                      // for string_view
+#include <utility>                          // for as_const, move
+#include <vector>                           // for vector
 
 #include <QByteArray>                       // for QByteArray
 #include <QDate>                            // for QDate
 #include <QDateTime>                        // for QDateTime
-#include <QHash>                            // for QHash
 #include <QIODevice>                        // for QIODevice, operator|, QIODevice::ReadOnly, QIODevice::Text, QIODevice::WriteOnly
 #include <QLatin1Char>                      // for QLatin1Char
 #include <QLatin1String>                    // for QLatin1String
@@ -53,9 +58,15 @@
 #include "garmin_tables.h"                  // for gt_color_index_by_rgb, gt_color_name, gt_color_value_by_name
 #include "geocache.h"                       // for Geocache, Geocache::UtfSt...
 #include "mkshort.h"                        // for MakeShort
+#include "src/core/budget.h"                // for Budget
 #include "src/core/datetime.h"              // for DateTime
 #include "src/core/file.h"                  // for File
-#include "src/core/logging.h"               // for Warning, Fatal
+#include "src/core/formatbuffer.h"          // for FormatBuffer
+#include "src/core/logging.h"               // for Warning, Fatal, FatalError
+#include "src/core/memoryfile.h"            // for MemoryFiles
+#include "src/core/numeric.h"               // for to_fixed
+#include "src/core/scheduler.h"             // for TaskGroup
+#include "src/core/xmlpullreader.h"         // for XmlPullReader
 #include "src/core/xmlstreamwriter.h"       // for XmlStreamWriter
 #include "src/core/xmltag.h"                // for xml_tag, fs_xml, fs_xml_alloc, free_gpx_extras
 
@@ -65,6 +76,16 @@
 #  define CREATOR_NAME_URL "GPSBabel - https://www.gpsbabel.org"
 #endif
 
+/*
+ * Whether an output or filter of the run uses the field, see wpt_field.
+ * Geocache data and extensions that none does are not kept.
+ */
+static bool
+gpx_wanted(unsigned int field)
+{
+  return (global_opts.wanted_fields & field) != 0;
+}
+
 void
 GpxFormat::gpx_add_to_global(QStringList& ge, const QString& s)
 {
@@ -78,12 +99,12 @@ GpxFormat::gpx_add_to_global(QStringList& ge, const QString& s)
 // zillion reference files.
 inline QString GpxFormat::toString(double d)
 {
-  return QString::number(d, 'f', 9);
+  return gpsbabel::to_fixed(d, 9);
 }
 
 inline QString GpxFormat::toString(float f)
 {
-  return QString::number(f, 'f', 6);
+  return gpsbabel::to_fixed(f, 6);
 }
 
 
@@ -127,11 +148,132 @@ GpxFormat::gpx_write_gdata(const QStringList& ge, const QString& tag) const
   }
 }
 
+/*
+ * A perfect hash of the tag paths, built once from tag_entries.
+ *
+ * Every path gets a slot of its own in a table of at least twice as
+ * many slots, hash and displace style: the paths are spread over
+ * buckets by one part of their hash, and each bucket, largest first, is
+ * given the first displacement that moves all of its paths to free
+ * slots.  A lookup hashes the path once, finds its slot through the
+ * displacement of its bucket and compares it to the one path there.
+ */
+class GpxFormat::TagTable
+{
+public:
+  TagTable()
+  {
+    std::uint32_t size = 1;
+    while (size < 2 * std::size(tag_entries)) {
+      size <<= 1;
+    }
+    mask_ = size - 1;
+    bucket_mask_ = std::max<std::uint32_t>(size / 8, 1) - 1;
+    slots_.resize(size);
+    displacements_.resize(bucket_mask_ + 1);
+
+    std::vector<std::vector<std::uint64_t>> buckets(bucket_mask_ + 1);
+    std::vector<std::vector<const tag_entry*>> bucket_entries(bucket_mask_ + 1);
+    for (const auto& entry : tag_entries) {
+      const std::uint64_t h = hash(QString::fromLatin1(entry.path));
+      std::vector<std::uint64_t>& bucket = buckets[bucket_of(h)];
+      auto it = std::find(bucket.begin(), bucket.end(), h);
+      if (it == bucket.end()) {
+        bucket.push_back(h);
+        bucket_entries[bucket_of(h)].push_back(&entry);
+      } else {
+        // Like a QHash, keep the last of the same paths.
+        bucket_entries[bucket_of(h)][it - bucket.begin()] = &entry;
+      }
+    }
+    std::vector<std::uint32_t> order(buckets.size());
+    for (std::uint32_t i = 0; i < order.size(); ++i) {
+      order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&buckets](std::uint32_t a, std::uint32_t b) {
+      return buckets[a].size() > buckets[b].size();
+    });
+
+    std::vector<std::uint32_t> placed;
+    for (std::uint32_t b : order) {
+      for (std::uint32_t d = 0;; ++d) {
+        assert(d < (1U << 20));
+        placed.clear();
+        bool fits = true;
+        for (std::uint64_t h : buckets[b]) {
+          const std::uint32_t slot = slot_of(h, d);
+          if ((slots_[slot].path.data() != nullptr) ||
+              (std::find(placed.begin(), placed.end(), slot) != placed.end())) {
+            fits = false;
+            break;
+          }
+          placed.push_back(slot);
+        }
+        if (fits) {
+          displacements_[b] = d;
+          for (std::size_t i = 0; i < placed.size(); ++i) {
+            const tag_entry* entry = bucket_entries[b][i];
+            slots_[placed[i]] = {QLatin1String(entry->path), entry->mapping};
+          }
+          break;
+        }
+      }
+    }
+  }
+
+  tag_mapping find(QStringView path) const
+  {
+    const std::uint64_t h = hash(path);
+    const Slot& slot = slots_[slot_of(h, displacements_[bucket_of(h)])];
+    if ((slot.path.data() != nullptr) && (path == slot.path)) {
+      return slot.mapping;
+    }
+    // a default constructed value if the path isn't known.
+    return {};
+  }
+
+private:
+  struct Slot {
+    QLatin1String path;
+    tag_mapping mapping;
+  };
+
+  /* FNV-1a over the UTF-16 code units. */
+  static std::uint64_t hash(QStringView path)
+  {
+    std::uint64_t h = 14695981039346656037ULL;
+    for (QChar c : path) {
+      h ^= c.unicode();
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+
+  std::uint32_t bucket_of(std::uint64_t h) const
+  {
+    return static_cast<std::uint32_t>(h >> 32) & bucket_mask_;
+  }
+
+  std::uint32_t slot_of(std::uint64_t h, std::uint32_t d) const
+  {
+    std::uint64_t x = h + d * 0x9e3779b97f4a7c15ULL;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return static_cast<std::uint32_t>(x) & mask_;
+  }
+
+  std::vector<Slot> slots_;
+  std::vector<std::uint32_t> displacements_;
+  std::uint32_t mask_{0};
+  std::uint32_t bucket_mask_{0};
+};
+
 GpxFormat::tag_mapping
-GpxFormat::get_tag(const QString& t) const
+GpxFormat::get_tag(QStringView path)
 {
-  // returns default constructed value if key not found.
-  return hash.value(t);
+  static const TagTable table;
+  return table.find(path);
 }
 
 void
@@ -218,10 +360,18 @@ GpxFormat::tag_gs_cache(const QXmlStreamAttributes& attr) const
 void
 GpxFormat::tag_garmin_fs(tag_type tag, const QString& text, Waypoint* waypt)
 {
-  garmin_fs_t* gmsd = garmin_fs_t::find(waypt);
-  if (gmsd == nullptr) {
-    gmsd = new garmin_fs_t(-1);
-    waypt->fs.FsChainAdd(gmsd);
+  garmin_fs_t* gmsd = nullptr;
+  if (gpx_wanted(wpt_field_extensions)) {
+    gmsd = garmin_fs_t::find(waypt);
+    if (gmsd == nullptr) {
+      gmsd = new garmin_fs_t(-1);
+      waypt->fs.FsChainAdd(gmsd);
+    }
+  } else if ((tag != tag_type::garmin_wpt_proximity) &&
+             (tag != tag_type::garmin_wpt_temperature) &&
+             (tag != tag_type::garmin_wpt_depth)) {
+    // Only these are kept in the waypoint itself.
+    return;
   }
 
   switch (tag) {
@@ -281,10 +431,98 @@ GpxFormat::tag_garmin_fs(tag_type tag, const QString& text, Waypoint* waypt)
   }
 }
 
+/* Appends s to raw, escaped so that reading it back gives s again. */
+static void
+gpx_raw_append(QByteArray& raw, QStringView s, bool attribute)
+{
+  qsizetype plain = 0;
+  for (qsizetype i = 0; i < s.size(); ++i) {
+    const char* entity = nullptr;
+    switch (s.at(i).unicode()) {
+    case '&':
+      entity = "&amp;";
+      break;
+    case '<':
+      entity = "&lt;";
+      break;
+    case '>':
+      entity = "&gt;";
+      break;
+    case '\r':
+      entity = "&#13;";
+      break;
+    // Attribute values would have their white space normalized.
+    case '"':
+      entity = attribute ? "&quot;" : nullptr;
+      break;
+    case '\n':
+      entity = attribute ? "&#10;" : nullptr;
+      break;
+    case '\t':
+      entity = attribute ? "&#9;" : nullptr;
+      break;
+    default:
+      break;
+    }
+    if (entity != nullptr) {
+      raw.append(s.sliced(plain, i - plain).toUtf8());
+      raw.append(entity);
+      plain = i + 1;
+    }
+  }
+  raw.append(s.sliced(plain).toUtf8());
+}
+
+/* Writes out the text run so far as gpx_cdata would have kept it. */
+void
+GpxFormat::raw_flush_text()
+{
+  QStringView text = QStringView(raw_text).trimmed();
+  if (!text.isEmpty()) {
+    gpx_raw_append(*raw_xml, text, false);
+  }
+  raw_text.clear();
+}
+
 void
 GpxFormat::start_something_else(QStringView el, const QXmlStreamAttributes& attr)
 {
-  if (!fs_ptr) {
+  if (!fs_ptr || !gpx_wanted(wpt_field_extensions)) {
+    return;
+  }
+
+  /*
+   * With rawext the elements are kept as UTF-8 text in the fs_xml
+   * instead of as a tree of XmlTags, which takes far less memory and is
+   * written back without building anything.  Without rawext the children
+   * of geocache logs, the bulk of a pocket query, are kept that way in
+   * their XmlTag.
+   */
+  if (opt_rawext || (raw_depth > 0)) {
+    if (raw_depth == 0) {
+      auto* fs_gpx = reinterpret_cast<fs_xml*>(fs_ptr->FsChainFind(kFsGpx));
+      if (!fs_gpx) {
+        fs_gpx = new fs_xml(kFsGpx);
+        fs_ptr->FsChainAdd(fs_gpx);
+      }
+      raw_xml = &fs_gpx->raw;
+    } else {
+      raw_flush_text();
+    }
+    ++raw_depth;
+    raw_xml->append('<').append(el.toUtf8());
+    for (const auto& a : attr) {
+      raw_xml->append(' ').append(a.qualifiedName().toUtf8()).append("=\"");
+      gpx_raw_append(*raw_xml, a.value(), true);
+      raw_xml->append('"');
+    }
+    const QXmlStreamNamespaceDeclarations ns = reader->namespaceDeclarations();
+    for (const auto& n : ns) {
+      raw_xml->append(n.prefix().isEmpty() ? " xmlns" : " xmlns:").append(n.prefix().toUtf8()).append("=\"");
+      gpx_raw_append(*raw_xml, n.namespaceUri(), true);
+      raw_xml->append('"');
+    }
+    raw_xml->append('>');
     return;
   }
 
@@ -309,6 +547,12 @@ GpxFormat::start_something_else(QStringView el, const QXmlStreamAttributes& attr
     new_tag->attributes.append(prefix, namespaceUri);
   }
 
+  if (current_tag == u"/gpx/wpt/groundspeak:cache/groundspeak:logs") {
+    raw_xml = &new_tag->raw;
+    raw_depth = 1;
+    raw_collapsed = true;
+  }
+
   if (cur_tag) {
     if (cur_tag->child) {
       cur_tag = cur_tag->child;
@@ -322,7 +566,7 @@ GpxFormat::start_something_else(QStringView el, const QXmlStreamAttributes& attr
       new_tag->parent = cur_tag;
     }
   } else {
-    const auto* fs_gpx = reinterpret_cast<fs_xml*>(fs_ptr->FsChainFind(kFsGpx));
+    const auto* fs_gpx = reinterpret_cast<const fs_xml*>(fs_ptr->FsChainFind(kFsGpx));
 
     if (fs_gpx && fs_gpx->tag) {
       cur_tag = fs_gpx->tag;
@@ -344,6 +588,21 @@ GpxFormat::start_something_else(QStringView el, const QXmlStreamAttributes& attr
 void
 GpxFormat::end_something_else()
 {
+  if (raw_depth > 0) {
+    raw_flush_text();
+    // The collapsed element itself is an XmlTag.
+    bool tag_end = raw_collapsed && (raw_depth == 1);
+    if (!tag_end) {
+      raw_xml->append("</").append(reader->qualifiedName().toUtf8()).append('>');
+    }
+    if (--raw_depth == 0) {
+      raw_xml = nullptr;
+      raw_collapsed = false;
+    }
+    if (!tag_end) {
+      return;
+    }
+  }
   if (cur_tag) {
     cur_tag = cur_tag->parent;
   }
@@ -380,9 +639,11 @@ void
 GpxFormat::gpx_start(QStringView el, const QXmlStreamAttributes& attr)
 {
   /*
-   * Reset end-of-string without actually emptying/reallocing cdatastr.
+   * Reset end-of-string without actually emptying/reallocing cdata_buffer.
    */
-  cdatastr = QString();
+  cdata_buffer.resize(0);
+  cdata_seen = false;
+  cdata_reference.clear();
 
   tag_mapping tag = get_tag(current_tag);
   switch (tag.type) {
@@ -434,7 +695,9 @@ GpxFormat::gpx_start(QStringView el, const QXmlStreamAttributes& attr)
     start_something_else(el, attr);
     return;
   case tag_type::cache:
-    tag_gs_cache(attr);
+    if (gpx_wanted(wpt_field_geocache)) {
+      tag_gs_cache(attr);
+    }
     break;
   case tag_type::cache_log_wpt:
     if (opt_logpoint) {
@@ -446,7 +709,7 @@ GpxFormat::gpx_start(QStringView el, const QXmlStreamAttributes& attr)
     tag_cache_desc(attr);
     break;
   case tag_type::cache_placer:
-    if (attr.hasAttribute(QLatin1String("id"))) {
+    if (gpx_wanted(wpt_field_geocache) && attr.hasAttribute(QLatin1String("id"))) {
       wpt_tmp->AllocGCData()->placer_id = attr.value(QLatin1String("id")).toInt();
     }
     break;
@@ -458,9 +721,93 @@ GpxFormat::gpx_start(QStringView el, const QXmlStreamAttributes& attr)
   }
 }
 
+/*
+ * Parses the YYYY-MM-DDThh:mm:ss[.s...][Z|+hh:mm|-hh:mm] form nearly all
+ * files use straight to milliseconds since the epoch, giving the same
+ * result as the general code below.  Anything else, including out of
+ * range fields, is left to that code.
+ */
+static std::optional<qint64>
+xml_parse_time_fast(QStringView s)
+{
+  auto digits = [s](qsizetype pos, qsizetype count, int* value)->bool {
+    if (pos + count > s.size()) {
+      return false;
+    }
+    int v = 0;
+    for (qsizetype i = pos; i < pos + count; ++i) {
+      char16_t c = s[i].unicode();
+      if ((c < u'0') || (c > u'9')) {
+        return false;
+      }
+      v = (v * 10) + (c - u'0');
+    }
+    *value = v;
+    return true;
+  };
+
+  int year;
+  int mon;
+  int mday;
+  int hour;
+  int min;
+  int sec;
+  if ((s.size() < 19) || (s[4] != u'-') || (s[7] != u'-') || (s[10] != u'T') ||
+      (s[13] != u':') || (s[16] != u':') ||
+      !digits(0, 4, &year) || !digits(5, 2, &mon) || !digits(8, 2, &mday) ||
+      !digits(11, 2, &hour) || !digits(14, 2, &min) || !digits(17, 2, &sec)) {
+    return std::nullopt;
+  }
+  if (!QDate::isValid(year, mon, mday) || (hour > 23) || (min > 59) || (sec > 59)) {
+    return std::nullopt;
+  }
+
+  qsizetype pos = 19;
+  qint64 msecs = 0;
+  if ((pos < s.size()) && (s[pos] == u'.')) {
+    // Round the fraction as a double, like sscanf and lround would.
+    qint64 num = 0;
+    qint64 den = 1;
+    for (++pos; (pos < s.size()) && s[pos].isDigit(); ++pos) {
+      if (den == 1000000000) {
+        return std::nullopt;
+      }
+      num = (num * 10) + s[pos].digitValue();
+      den *= 10;
+    }
+    if (den == 1) {
+      return std::nullopt;
+    }
+    msecs = lround(static_cast<double>(num) / static_cast<double>(den) * 1000);
+  }
+
+  int offset = 0;
+  if (pos < s.size()) {
+    int off_hr;
+    int off_min;
+    if ((s[pos] == u'Z') && (pos + 1 == s.size())) {
+      // zulu time
+    } else if (((s[pos] == u'+') || (s[pos] == u'-')) && (pos + 6 == s.size()) &&
+               (s[pos + 3] == u':') && digits(pos + 1, 2, &off_hr) && digits(pos + 4, 2, &off_min)) {
+      offset = ((off_hr * 3600) + (off_min * 60)) * ((s[pos] == u'-') ? -1 : 1);
+    } else {
+      return std::nullopt;
+    }
+  }
+
+  constexpr qint64 kEpochJulianDay = 2440588;  // 1970-01-01
+  qint64 days = QDate(year, mon, mday).toJulianDay() - kEpochJulianDay;
+  qint64 secs = (days * 86400) + (hour * 3600) + (min * 60) + sec - offset;
+  return (secs * 1000) + msecs;
+}
+
 gpsbabel::DateTime
 xml_parse_time(const QString& dateTimeString)
 {
+  if (auto msecs = xml_parse_time_fast(dateTimeString); msecs.has_value()) {
+    return gpsbabel::DateTime::fromMSecsSinceEpochUtc(*msecs);
+  }
+
   int off_hr = 0;
   int off_min = 0;
   int off_sign = 1;
@@ -530,16 +877,44 @@ xml_parse_time(const QString& dateTimeString)
   return dt;
 }
 
+/* The tags that only give geocache data, see gpx_end(). */
+bool
+GpxFormat::is_geocache_data(tag_type type)
+{
+  switch (type) {
+  case tag_type::cache_container:
+  case tag_type::cache_type:
+  case tag_type::cache_difficulty:
+  case tag_type::cache_terrain:
+  case tag_type::cache_hint:
+  case tag_type::cache_desc_short:
+  case tag_type::cache_desc_long:
+  case tag_type::cache_log_type:
+  case tag_type::cache_log_date:
+  case tag_type::cache_placer:
+  case tag_type::cache_favorite_points:
+  case tag_type::cache_personal_note:
+    return true;
+  default:
+    return false;
+  }
+}
+
 void
 GpxFormat::gpx_end(QStringView /*unused*/)
 {
-  static gpsbabel::DateTime gc_log_date;
-
   // Remove leading, trailing whitespace.
-  cdatastr = cdatastr.trimmed();
+  cdatastr = cdata_seen ? QStringView(cdata_buffer).trimmed().toString() : QString();
 
   tag_mapping tag = get_tag(current_tag);
 
+  if (is_geocache_data(tag.type) && !gpx_wanted(wpt_field_geocache)) {
+    if (tag.passthrough) {
+      end_something_else();
+    }
+    return;
+  }
+
   switch (tag.type) {
   /*
    * First, the tags that are file-global.
@@ -617,13 +992,21 @@ GpxFormat::gpx_end(QStringView /*unused*/)
   case tag_type::cache_desc_long: {
     Geocache* gc_data = wpt_tmp->AllocGCData();
     gc_data->desc_long.is_html = cache_descr_is_html;
-    gc_data->desc_long.utf_string = cdatastr;
+    if (cdata_reference.isNull()) {
+      gc_data->desc_long.set_text(cdatastr);
+    } else {
+      gc_data->desc_long.set_utf8(cdata_reference);
+    }
   }
   break;
   case tag_type::cache_desc_short: {
     Geocache* gc_data = wpt_tmp->AllocGCData();
     gc_data->desc_short.is_html = cache_descr_is_html;
-    gc_data->desc_short.utf_string = cdatastr;
+    if (cdata_reference.isNull()) {
+      gc_data->desc_short.set_text(cdatastr);
+    } else {
+      gc_data->desc_short.set_utf8(cdata_reference);
+    }
   }
   break;
   case tag_type::cache_terrain:
@@ -815,7 +1198,7 @@ GpxFormat::gpx_end(QStringView /*unused*/)
     wpt_tmp->shortname = cdatastr;
     break;
   case tag_type::wpttype_sym:
-    wpt_tmp->icon_descr = cdatastr;
+    wpt_tmp->icon_descr = icon_pool.intern(cdatastr);
     break;
   case tag_type::wpttype_time:
     wpt_tmp->SetCreationTime(xml_parse_time(cdatastr));
@@ -833,7 +1216,11 @@ GpxFormat::gpx_end(QStringView /*unused*/)
     wpt_tmp->description = cdatastr;
     break;
   case tag_type::wpttype_desc:
-    wpt_tmp->notes = cdatastr;
+    if (cdata_reference.isNull()) {
+      wpt_tmp->notes = cdatastr;
+    } else {
+      wpt_tmp->notes = cdata_reference;
+    }
     break;
   case tag_type::wpttype_src:
     if (wpt_fsdata == nullptr) {
@@ -922,8 +1309,13 @@ void
 GpxFormat::gpx_cdata(QStringView s)
 {
   QString* cdata;
-  cdatastr += s.toString();
+  cdata_buffer.append(s);
+  cdata_seen = true;
 
+  if (raw_depth > 0) {
+    raw_text += s;
+    return;
+  }
   if (!cur_tag) {
     return;
   }
@@ -937,7 +1329,7 @@ GpxFormat::gpx_cdata(QStringView s)
   } else {
     cdata = &(cur_tag->cdata);
   }
-  *cdata = cdatastr.trimmed();
+  *cdata = QStringView(cdata_buffer).trimmed().toString();
 }
 
 void
@@ -945,11 +1337,19 @@ GpxFormat::rd_init(const QString& fname)
 {
   iqfile = new gpsbabel::File(fname);
   iqfile->open(QIODevice::ReadOnly);
-  reader = new QXmlStreamReader(iqfile);
+  reader = gpsbabel::XmlPullReader::create(iqfile);
 
   current_tag.clear();
+  tag_starts.clear();
 
+  cdata_buffer.clear();
+  cdata_seen = false;
   cdatastr = QString();
+  cdata_reference.clear();
+  raw_xml = nullptr;
+  raw_depth = 0;
+  raw_collapsed = false;
+  raw_text.clear();
 
   if (nullptr == gpx_global) {
     gpx_global = new GpxGlobal;
@@ -961,19 +1361,20 @@ GpxFormat::rd_init(const QString& fname)
 void
 GpxFormat::rd_deinit()
 {
-  delete reader;
-  reader = nullptr;
+  reader.reset();
   iqfile->close();
   delete iqfile;
   iqfile = nullptr;
   wpt_tmp = nullptr;
   cur_tag = nullptr;
+  icon_pool.clear();
 }
 
 void
 GpxFormat::wr_init(const QString& fname)
 {
   mkshort_handle = nullptr;
+  write_threads = (opt_threads != nullptr) ? std::max(xstrtoi(opt_threads, nullptr, 10), 1) : 1;
   oqfile = new gpsbabel::File(fname);
   oqfile->open(QIODevice::WriteOnly | QIODevice::Text);
 
@@ -1097,51 +1498,83 @@ GpxFormat::wr_deinit()
   mkshort_handle = nullptr;
 }
 
-QString
-GpxFormat::qualifiedName() const
+void
+GpxFormat::append_qualified_name(QString& path) const
 {
-  /* The prefixes used in our hash table may not match those used in the input
+  /* The prefixes used in our tag table may not match those used in the input
    * file.  So we map from the namespaceUris to the prefixes used in our
-   * hash table.
+   * tag table.
    */
-  static const QHash<QString, QString> tag_ns_prefixes = {
-    {"http://www.garmin.com/xmlschemas/GpxExtensions/v3", "gpxx"},
-    {"http://www.garmin.com/xmlschemas/TrackPointExtension/v1", "gpxtpx"},
-    {"http://www.groundspeak.com/cache/1/0", "groundspeak"},
-    {"http://www.groundspeak.com/cache/1/0/1", "groundspeak"},
-    {"http://humminbird.com", "h"}
+  struct ns_prefix {
+    QStringView uri;
+    QStringView prefix;
+  };
+  static constexpr ns_prefix tag_ns_prefixes[] = {
+    {u"http://www.garmin.com/xmlschemas/GpxExtensions/v3", u"gpxx"},
+    {u"http://www.garmin.com/xmlschemas/TrackPointExtension/v1", u"gpxtpx"},
+    {u"http://www.groundspeak.com/cache/1/0", u"groundspeak"},
+    {u"http://www.groundspeak.com/cache/1/0/1", u"groundspeak"},
+    {u"http://humminbird.com", u"h"}
   };
 
-  if (auto uri = reader->namespaceUri().toString(); tag_ns_prefixes.contains(uri)) {
-    return QStringLiteral("%1:%2").arg(tag_ns_prefixes.value(uri)).arg(reader->name());
-  } else {
-    return reader->qualifiedName().toString();
+  const QStringView uri = reader->namespaceUri();
+  for (const auto& ns : tag_ns_prefixes) {
+    if (uri == ns.uri) {
+      path.append(ns.prefix).append(QLatin1Char(':')).append(reader->name());
+      return;
+    }
   }
+  path.append(reader->qualifiedName());
 }
 
 void
 GpxFormat::read()
+{
+  // Pool the (potentially many) points we create.
+  AllocationArena arena;
+
+  if ((opt_threads != nullptr) && read_parallel(xstrtoi(opt_threads, nullptr, 10))) {
+    return;
+  }
+
+  read_stream();
+
+  if (reader->hasError()) {
+    fatal(FatalMsg() << MYNAME << "Read error:" << reader->errorString()
+          << "File:" << iqfile->fileName()
+          << "Line:" << reader->lineNumber()
+          << "Column:" << reader->columnNumber());
+  }
+}
+
+void
+GpxFormat::read_stream()
 {
   for (bool atEnd = false; !reader->atEnd() && !atEnd;) {
+    gpsbabel::Budget::check();
     reader->readNext();
     // do processing
     switch (reader->tokenType()) {
     case QXmlStreamReader::StartElement:
+      tag_starts.append(current_tag.size());
       current_tag.append(QLatin1Char('/'));
-      current_tag.append(qualifiedName());
+      append_qualified_name(current_tag);
       gpx_start(reader->qualifiedName(), reader->attributes());
       break;
 
     case QXmlStreamReader::EndElement:
       gpx_end(reader->qualifiedName());
-      current_tag.chop(qualifiedName().length() + 1);
-      cdatastr.clear();
+      current_tag.truncate(tag_starts.takeLast());
+      cdata_buffer.resize(0);
+      cdata_seen = false;
+      cdata_reference.clear();
       break;
 
     case QXmlStreamReader::Characters:
 //    It is tempting to skip this if reader->isWhitespace().
 //    That would lose all whitespace element values if the exist,
 //    but it would skip line endings and indentation that doesn't matter.
+      cdata_reference = cdata_seen ? gpsbabel::Utf8String() : reader->textReference();
       gpx_cdata(reader->text());
       break;
 
@@ -1171,12 +1604,293 @@ GpxFormat::read()
       break;
     }
   }
+}
 
-  if (reader->hasError()) {
-    fatal(FatalMsg() << MYNAME << "Read error:" << reader->errorString()
-          << "File:" << iqfile->fileName()
-          << "Line:" << reader->lineNumber()
-          << "Column:" << reader->columnNumber());
+/*
+ * Finds where the children of the root element begin with a quick scan
+ * of the markup.  Nothing is checked beyond what the scan needs; a
+ * malformed document is left for the parser to report.
+ */
+static bool
+gpx_scan_children(const char* data, qint64 size, qint64* root_end,
+                  qint64* close_begin, qint64* close_end, std::vector<qint64>* children)
+{
+  // Anything but an ASCII compatible encoding goes to the serial parser.
+  if ((size < 2) || (data[0] == '\0') || (data[1] == '\0') ||
+      (static_cast<unsigned char>(data[0]) >= 0xfe)) {
+    return false;
+  }
+
+  const char* const end = data + size;
+  auto skip_past = [end](const char* from, std::string_view terminator) -> const char* {
+    std::string_view rest(from, end - from);
+    auto pos = rest.find(terminator);
+    return (pos == std::string_view::npos) ? nullptr : from + pos + terminator.size();
+  };
+
+  *root_end = -1;
+  *close_begin = -1;
+  int depth = 0;
+  for (const char* p = data; p < end;) {
+    p = static_cast<const char*>(memchr(p, '<', end - p));
+    if (p == nullptr) {
+      break;
+    }
+    std::string_view rest(p, end - p);
+    const char* next;
+    if (rest.starts_with("<!--")) {
+      next = skip_past(p + 4, "-->");
+    } else if (rest.starts_with("<![CDATA[")) {
+      next = skip_past(p + 9, "]]>");
+    } else if (rest.starts_with("<?")) {
+      next = skip_past(p + 2, "?>");
+    } else if (rest.starts_with("<!")) {
+      // A DOCTYPE may declare entities, leave those to the parser.
+      return false;
+    } else {
+      // A tag, in which only quoted attribute values can hide a '>'.
+      const char* q = p + 1;
+      for (char quote = '\0'; q < end; ++q) {
+        if (quote != '\0') {
+          if (*q == quote) {
+            quote = '\0';
+          }
+        } else if ((*q == '"') || (*q == '\'')) {
+          quote = *q;
+        } else if (*q == '>') {
+          break;
+        }
+      }
+      if (q == end) {
+        return false;
+      }
+      next = q + 1;
+      if (p[1] == '/') {
+        if (--depth < 0) {
+          return false;
+        }
+        if (depth == 0) {
+          *close_begin = p - data;
+          *close_end = next - data;
+        }
+      } else {
+        bool empty = (q[-1] == '/');
+        if (depth == 0) {
+          if ((*root_end >= 0) || empty) {
+            return false;
+          }
+          *root_end = next - data;
+        } else if (depth == 1) {
+          children->push_back(p - data);
+        }
+        if (!empty) {
+          ++depth;
+        }
+      }
+    }
+    if (next == nullptr) {
+      return false;
+    }
+    p = next;
+  }
+  return (depth == 0) && (*close_begin >= 0);
+}
+
+static bool
+gpx_has_synthetic_names(const RouteList& routes)
+{
+  for (const route_head* rte : routes) {
+    for (const Waypoint* wpt : rte->waypoint_list) {
+      if (wpt->wpt_flags.shortname_is_synthetic) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/*
+ * Splits the children of the gpx element into runs that are parsed on
+ * a thread pool, each as a document of its own made of the text before
+ * the first child, the run and the closing tag.  The results are then
+ * appended in document order, so they are the same as from a serial
+ * read.  Returns false, having read nothing, if the file doesn't lend
+ * itself to this or any run fails to parse; the serial read will then
+ * report the error.
+ */
+bool
+GpxFormat::read_parallel(int threads)
+{
+  // Runs smaller than this aren't worth a thread.
+  constexpr qint64 kMinChunkSize = 64 * 1024;
+
+  const QString fname = iqfile->fileName();
+  if ((threads < 2) || (waypt_sink() != nullptr) || (fname == "-") ||
+      gpsbabel::MemoryFiles::contains(fname)) {
+    return false;
+  }
+  const qint64 size = iqfile->size();
+  if (size < 2 * kMinChunkSize) {
+    return false;
+  }
+  uchar* map = iqfile->map(0, size);
+  if (map == nullptr) {
+    return false;
+  }
+  const char* data = reinterpret_cast<const char*>(map);
+
+  qint64 root_end;
+  qint64 close_begin;
+  qint64 close_end;
+  std::vector<qint64> children;
+  if (!gpx_scan_children(data, size, &root_end, &close_begin, &close_end, &children)) {
+    iqfile->unmap(map);
+    return false;
+  }
+
+  const qint64 target = std::max((close_begin - root_end) / (threads * 4), kMinChunkSize);
+  std::vector<std::unique_ptr<ParallelChunk>> chunks;
+  qint64 begin = root_end;
+  for (qint64 child : children) {
+    if (child - begin >= target) {
+      auto chunk = std::make_unique<ParallelChunk>();
+      chunk->begin = begin;
+      chunk->end = child;
+      chunks.push_back(std::move(chunk));
+      begin = child;
+    }
+  }
+  if (chunks.empty()) {
+    iqfile->unmap(map);
+    return false;
+  }
+  auto last = std::make_unique<ParallelChunk>();
+  last->begin = begin;
+  last->end = close_begin;
+  chunks.push_back(std::move(last));
+
+  const session_t* session = curr_session();
+  const QVector<arglist_t>& args = gpx_args;
+  gpsbabel::TaskGroup group;
+  for (const auto& chunk : chunks) {
+    chunk->parser = std::make_unique<GpxFormat>();
+    for (int i = 0; i < args.size(); ++i) {
+      *chunk->parser->gpx_args.at(i).argval = *args.at(i).argval;
+    }
+    chunk->parser->gpx_global = new GpxGlobal;
+    ParallelChunk* c = chunk.get();
+    // The last run keeps whatever follows the root, errors included.
+    qint64 suffix_end = (c == chunks.back().get()) ? size : close_end;
+    group.run([c, data, root_end, close_begin, suffix_end, session]() {
+      QByteArray doc;
+      doc.reserve(root_end + (c->end - c->begin) + (suffix_end - close_begin));
+      doc.append(data, root_end);
+      doc.append(data + c->begin, c->end - c->begin);
+      doc.append(data + close_begin, suffix_end - close_begin);
+      read_chunk(*c, doc, session);
+    });
+  }
+  // A fatal error in a run only gets here when fatal() throws, as in
+  // the library, and then everything the runs read is let go of first.
+  std::exception_ptr error;
+  try {
+    group.wait();
+  } catch (const FatalError&) {
+    error = std::current_exception();
+  }
+  iqfile->unmap(map);
+
+  // Synthesized route point names are numbered across all routes, so
+  // they only match a serial read if no routes came before them.
+  bool ok = !error;
+  int route_points = route_waypt_count();
+  for (const auto& chunk : chunks) {
+    ok = ok && chunk->ok && ((route_points == 0) || !gpx_has_synthetic_names(chunk->routes));
+    route_points += chunk->routes.waypt_count();
+  }
+
+  for (const auto& chunk : chunks) {
+    if (ok) {
+      merge_chunk(*chunk->parser);
+      waypt_splice(&chunk->waypoints);
+      route_splice(&chunk->routes);
+      track_splice(&chunk->tracks);
+    } else {
+      chunk->waypoints.flush();
+      chunk->routes.flush();
+      chunk->tracks.flush();
+    }
+    chunk->parser->exit();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  return ok;
+}
+
+void
+GpxFormat::read_chunk(ParallelChunk& chunk, const QByteArray& doc, const session_t* session)
+{
+  const ThreadScope scope;
+  waypt_use_list(&chunk.waypoints);
+  route_use_lists(&chunk.routes, &chunk.tracks);
+  use_session(session);
+
+  GpxFormat* parser = chunk.parser.get();
+  parser->reader = gpsbabel::XmlPullReader::create(doc);
+  try {
+    parser->read_stream();
+  } catch (const FatalError&) {
+    // The reader must not outlive doc.
+    parser->reader.reset();
+    parser->icon_pool.clear();
+    throw;
+  }
+  chunk.ok = !parser->reader->hasError();
+  parser->reader.reset();
+  parser->icon_pool.clear();
+}
+
+/* Takes on the file level data a chunk's parser read, as tag_gpx and
+ * gpx_end would have. */
+void
+GpxFormat::merge_chunk(const GpxFormat& parser)
+{
+  const QVersionNumber& version = parser.gpx_highest_version_read;
+  if (gpx_highest_version_read.isNull() ||
+      (!version.isNull() && (gpx_highest_version_read < version))) {
+    gpx_highest_version_read = version;
+  }
+  for (const auto& attribute : parser.gpx_namespace_attribute) {
+    if (!gpx_namespace_attribute.hasAttribute(attribute.qualifiedName())) {
+      gpx_namespace_attribute.append(attribute);
+    }
+  }
+
+  const GpxGlobal* global = parser.gpx_global;
+  for (const auto& str : global->name) {
+    gpx_add_to_global(gpx_global->name, str);
+  }
+  for (const auto& str : global->desc) {
+    gpx_add_to_global(gpx_global->desc, str);
+  }
+  for (const auto& str : global->author) {
+    gpx_add_to_global(gpx_global->author, str);
+  }
+  for (const auto& str : global->email) {
+    gpx_add_to_global(gpx_global->email, str);
+  }
+  for (const auto& str : global->url) {
+    gpx_add_to_global(gpx_global->url, str);
+  }
+  for (const auto& str : global->urlname) {
+    gpx_add_to_global(gpx_global->urlname, str);
+  }
+  for (const auto& str : global->keywords) {
+    gpx_add_to_global(gpx_global->keywords, str);
+  }
+  for (const auto& link : global->link) {
+    gpx_global->link.AddUrlLink(link);
   }
 }
 
@@ -1194,7 +1908,7 @@ GpxFormat::fprint_xml_chain(const XmlTag* tag) const
   while (tag) {
     writer->writeStartElement(tag->tagname);
     write_attributes(tag->attributes);
-    if (tag->cdata.isEmpty() && !tag->child) {
+    if (tag->cdata.isEmpty() && !tag->child && tag->raw.isEmpty()) {
       // No children?  Self-closing tag.
       writer->writeEndElement();
     } else {
@@ -1203,6 +1917,8 @@ GpxFormat::fprint_xml_chain(const XmlTag* tag) const
       }
       if (tag->child) {
         fprint_xml_chain(tag->child);
+      } else {
+        fprint_xml_raw(tag->raw);
       }
       writer->writeEndElement();
     }
@@ -1215,6 +1931,62 @@ GpxFormat::fprint_xml_chain(const XmlTag* tag) const
   }
 }
 
+/* Writes the same as fprint_xml_chain(fs_gpx->tree()) would. */
+void
+GpxFormat::fprint_xml(const fs_xml* fs_gpx) const
+{
+  if (fs_gpx->tag || fs_gpx->raw.isEmpty()) {
+    fprint_xml_chain(fs_gpx->tag);
+  } else {
+    fprint_xml_raw(fs_gpx->raw);
+  }
+}
+
+/* Writes the elements and text kept as in fs_xml::raw. */
+void
+GpxFormat::fprint_xml_raw(const QByteArray& xml) const
+{
+  if (xml.isEmpty()) {
+    return;
+  }
+
+  QXmlStreamReader raw;
+  raw.setNamespaceProcessing(false);
+  raw.addData(QByteArrayLiteral("<raw>"));
+  raw.addData(xml);
+  raw.addData(QByteArrayLiteral("</raw>"));
+
+  QString text;
+  int depth = 0;
+  while (!raw.atEnd()) {
+    QXmlStreamReader::TokenType token = raw.readNext();
+    if ((token == QXmlStreamReader::StartElement) || (token == QXmlStreamReader::EndElement)) {
+      if (!text.isEmpty()) {
+        writer->writeCharacters(text);
+        text.clear();
+      }
+    }
+    switch (token) {
+    case QXmlStreamReader::StartElement:
+      if (depth++ > 0) {
+        writer->writeStartElement(raw.qualifiedName().toString());
+        write_attributes(raw.attributes());
+      }
+      break;
+    case QXmlStreamReader::EndElement:
+      if (--depth > 0) {
+        writer->writeEndElement();
+      }
+      break;
+    case QXmlStreamReader::Characters:
+      text += raw.text();
+      break;
+    default:
+      break;
+    }
+  }
+}
+
 /*
  * Handle the grossness of GPX 1.0 vs. 1.1 handling of linky links.
  */
@@ -1244,7 +2016,7 @@ void
 GpxFormat::write_gpx_url(const Waypoint* waypointp) const
 {
   if (waypointp->HasUrlLink()) {
-    write_gpx_url(waypointp->urls);
+    write_gpx_url(waypointp->GetUrlList());
   }
 }
 
@@ -1463,7 +2235,7 @@ GpxFormat::gpx_write_common_description(const Waypoint* waypointp, const gpx_poi
 
   writer->writeOptionalTextElement(QStringLiteral("cmt"), waypointp->description);
   if (!waypointp->notes.isEmpty()) {
-    writer->writeTextElement(QStringLiteral("desc"), waypointp->notes);
+    writer->writeTextElement(QStringLiteral("desc"), waypointp->notes.toString());
   } else {
     writer->writeOptionalTextElement(QStringLiteral("desc"), waypointp->description);
   }
@@ -1480,7 +2252,7 @@ GpxFormat::gpx_write_common_description(const Waypoint* waypointp, const gpx_poi
 void GpxFormat::gpx_write_common_core(const Waypoint* waypointp,
                                       const gpx_point_type point_type) const
 {
-  const auto* fs_gpxwpt = reinterpret_cast<gpx_wpt_fsdata*>(waypointp->fs.FsChainFind(kFsGpxWpt));
+  const auto* fs_gpxwpt = reinterpret_cast<const gpx_wpt_fsdata*>(waypointp->fs.FsChainFind(kFsGpxWpt));
 
   gpx_write_common_position(waypointp, point_type, fs_gpxwpt);
   gpx_write_common_description(waypointp, point_type, fs_gpxwpt);
@@ -1497,9 +2269,9 @@ GpxFormat::gpx_waypt_pr(const Waypoint* waypointp) const
   gpx_write_common_core(waypointp, gpxpt_waypoint);
 
   if (!(opt_humminbirdext || opt_garminext)) {
-    const auto* fs_gpx = reinterpret_cast<fs_xml*>(waypointp->fs.FsChainFind(kFsGpx));
-    if (fs_gpx && fs_gpx->tag) {
-      fprint_xml_chain(fs_gpx->tag);
+    const auto* fs_gpx = reinterpret_cast<const fs_xml*>(waypointp->fs.FsChainFind(kFsGpx));
+    if (fs_gpx && !fs_gpx->empty()) {
+      fprint_xml(fs_gpx);
     }
   } else {
     gpx_write_common_extensions(waypointp, gpxpt_waypoint);
@@ -1511,6 +2283,11 @@ void
 GpxFormat::gpx_track_hdr(const route_head* rte)
 {
   current_trk_head = rte;
+  if (write_threads > 1) {
+    render_next = rte->waypoint_list.cbegin();
+    render_end = rte->waypoint_list.cend();
+    gpx_render_ahead();
+  }
 
   writer->writeStartElement(QStringLiteral("trk"));
   writer->writeOptionalTextElement(QStringLiteral("name"), rte->rte_name);
@@ -1522,9 +2299,9 @@ GpxFormat::gpx_track_hdr(const route_head* rte)
   }
 
   if (!(opt_humminbirdext || opt_garminext)) {
-    const auto* fs_gpx = reinterpret_cast<fs_xml*>(rte->fs.FsChainFind(kFsGpx));
+    const auto* fs_gpx = reinterpret_cast<const fs_xml*>(rte->fs.FsChainFind(kFsGpx));
     if (fs_gpx) {
-      fprint_xml_chain(fs_gpx->tag);
+      fprint_xml(fs_gpx);
     }
   } else if (opt_garminext) {
     if (rte->line_color.bbggrr > unknown_color) {
@@ -1541,6 +2318,312 @@ GpxFormat::gpx_track_hdr(const route_head* rte)
   }
 }
 
+/*
+ * Plain track points, the bulk of most large files, are formatted straight
+ * into fast_trkpts instead of going through the XmlStreamWriter one element
+ * at a time.  The text is exactly what the writer would produce with its
+ * auto formatting, and is handed to it in batches through writeDTD, which
+ * writes verbatim after a newline.  As that leaves the writer believing it
+ * has just written content, the batch ends with the indentation the writer
+ * would have put before its next element.
+ *
+ * Points with anything that would need escaping, extensions or other
+ * elements we carry along go the usual way.
+ */
+namespace
+{
+
+constexpr int kTrkptLevel = 3;  // gpx/trk/trkseg/trkpt
+constexpr qsizetype kFastTrkptBatch = 64 * 1024;
+constexpr qsizetype kRenderedTrkptRun = 4096;  // points
+
+bool gpx_plain(const QString& s)
+{
+  for (const QChar c : s) {
+    char16_t u = c.unicode();
+    if ((u < 0x20) || (u > 0x7e) || (u == '<') || (u == '>') || (u == '&') ||
+        (u == '"') || (u == '\'')) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void gpx_put_indent(gpsbabel::FormatBuffer& buf, int level)
+{
+  buf.put('\n');
+  for (int i = 0; i < level; ++i) {
+    buf.put("  ");
+  }
+}
+
+void gpx_put_element(gpsbabel::FormatBuffer& buf, const char* tag, const QString& text)
+{
+  gpx_put_indent(buf, kTrkptLevel + 1);
+  buf.put('<').put(tag).put('>');
+  for (const QChar c : text) {
+    buf.put(static_cast<char>(c.unicode()));
+  }
+  buf.put("</").put(tag).put('>');
+}
+
+void gpx_put_optional_element(gpsbabel::FormatBuffer& buf, const char* tag, const QString& text)
+{
+  if (!text.isEmpty()) {
+    gpx_put_element(buf, tag, text);
+  }
+}
+
+// QString::number(value, 'f', precision)
+void gpx_put_qt_fixed(gpsbabel::FormatBuffer& buf, const char* tag, double value, int precision)
+{
+  gpx_put_indent(buf, kTrkptLevel + 1);
+  buf.put('<').put(tag).put('>');
+  // Leave the sign of values that round to zero, and huge values, to Qt.
+  if (((value <= 0) && (std::fabs(value) < std::pow(10.0, -precision))) ||
+      (std::fabs(value) >= 1e15)) {
+    buf.put(QString::number(value, 'f', precision).toLatin1());
+  } else {
+    buf.put_fixed(value, precision);
+  }
+  buf.put("</").put(tag).put('>');
+}
+
+// GpxFormat::toString
+void gpx_put_fixed(gpsbabel::FormatBuffer& buf, const char* tag, double value, int precision)
+{
+  gpx_put_indent(buf, kTrkptLevel + 1);
+  buf.put('<').put(tag).put('>').put_fixed(value, precision).put("</").put(tag).put('>');
+}
+
+} // namespace
+
+/*
+ * Appends the trkpt writer would write for a plain point to out, using
+ * children for the text of its child elements.  Besides out and children
+ * nothing is changed, so points may be formatted on several threads.
+ */
+bool
+GpxFormat::gpx_fast_trkpt(const Waypoint* waypointp, gpsbabel::FormatBuffer& out,
+                          gpsbabel::FormatBuffer& children) const
+{
+  if (opt_humminbirdext || opt_garminext) {
+    return false;
+  }
+  const auto* fs_gpx = reinterpret_cast<const fs_xml*>(waypointp->fs.FsChainFind(kFsGpx));
+  if (fs_gpx && !fs_gpx->empty()) {
+    return false;
+  }
+  if (waypointp->HasUrlLink() || !waypointp->notes.isEmpty() ||
+      !gpx_plain(waypointp->description) || !gpx_plain(waypointp->icon_descr)) {
+    return false;
+  }
+  // mkshort remembers the names it hands out, so it can't be asked twice.
+  QString oname;
+  if (!waypointp->wpt_flags.shortname_is_synthetic) {
+    if (global_opts.synthesize_shortnames) {
+      return false;
+    }
+    oname = waypointp->shortname;
+  }
+  if (!gpx_plain(oname)) {
+    return false;
+  }
+  const auto* fs_gpxwpt = reinterpret_cast<const gpx_wpt_fsdata*>(waypointp->fs.FsChainFind(kFsGpxWpt));
+  if (fs_gpxwpt && !(gpx_plain(fs_gpxwpt->magvar) && gpx_plain(fs_gpxwpt->src) &&
+                     gpx_plain(fs_gpxwpt->type) && gpx_plain(fs_gpxwpt->ageofdgpsdata) &&
+                     gpx_plain(fs_gpxwpt->dgpsid))) {
+    return false;
+  }
+  bool track_1_0 = gpx_write_version == gpx_1_0;
+  if (!std::isfinite(waypointp->latitude) || !std::isfinite(waypointp->longitude) ||
+      !std::isfinite(waypointp->hdop) || !std::isfinite(waypointp->vdop) ||
+      !std::isfinite(waypointp->pdop) ||
+      ((waypointp->altitude != unknown_alt) && !std::isfinite(waypointp->altitude)) ||
+      (waypointp->geoidheight_has_value() && !std::isfinite(waypointp->geoidheight_value())) ||
+      (track_1_0 && waypointp->course_has_value() && !std::isfinite(waypointp->course_value())) ||
+      (track_1_0 && waypointp->speed_has_value() && !std::isfinite(waypointp->speed_value()))) {
+    return false;
+  }
+
+  /* gpx_write_common_position */
+  children.clear();
+  if (waypointp->altitude != unknown_alt) {
+    gpx_put_qt_fixed(children, "ele", waypointp->altitude, elevation_precision);
+  }
+  gpx_put_optional_element(children, "time", waypointp->CreationTimeXML());
+  if (track_1_0) {
+    if (waypointp->course_has_value()) {
+      gpx_put_fixed(children, "course", waypointp->course_value(), 6);
+    }
+    if (waypointp->speed_has_value()) {
+      gpx_put_fixed(children, "speed", waypointp->speed_value(), 6);
+    }
+  }
+  if (fs_gpxwpt) {
+    gpx_put_optional_element(children, "magvar", fs_gpxwpt->magvar);
+  }
+  if (waypointp->geoidheight_has_value()) {
+    gpx_put_qt_fixed(children, "geoidheight", waypointp->geoidheight_value(), 1);
+  }
+
+  /* gpx_write_common_description */
+  gpx_put_optional_element(children, "name", oname);
+  gpx_put_optional_element(children, "cmt", waypointp->description);
+  gpx_put_optional_element(children, "desc", waypointp->description);
+  if (fs_gpxwpt) {
+    gpx_put_optional_element(children, "src", fs_gpxwpt->src);
+  }
+  gpx_put_optional_element(children, "sym", waypointp->icon_descr);
+  if (fs_gpxwpt) {
+    gpx_put_optional_element(children, "type", fs_gpxwpt->type);
+  }
+
+  /* gpx_write_common_acc */
+  const char* fix = nullptr;
+  switch (waypointp->fix) {
+  case fix_2d:
+    fix = "2d";
+    break;
+  case fix_3d:
+    fix = "3d";
+    break;
+  case fix_dgps:
+    fix = "dgps";
+    break;
+  case fix_pps:
+    fix = "pps";
+    break;
+  case fix_none:
+    fix = "none";
+    break;
+  case fix_unknown:
+  default:
+    break;
+  }
+  if (fix) {
+    gpx_put_indent(children, kTrkptLevel + 1);
+    children.put("<fix>").put(fix).put("</fix>");
+  }
+  if (waypointp->sat > 0) {
+    gpx_put_indent(children, kTrkptLevel + 1);
+    children.put("<sat>").put_int(waypointp->sat).put("</sat>");
+  }
+  if (waypointp->hdop) {
+    gpx_put_fixed(children, "hdop", waypointp->hdop, 6);
+  }
+  if (waypointp->vdop) {
+    gpx_put_fixed(children, "vdop", waypointp->vdop, 6);
+  }
+  if (waypointp->pdop) {
+    gpx_put_fixed(children, "pdop", waypointp->pdop, 6);
+  }
+  if (fs_gpxwpt) {
+    gpx_put_optional_element(children, "ageofdgpsdata", fs_gpxwpt->ageofdgpsdata);
+    gpx_put_optional_element(children, "dgpsid", fs_gpxwpt->dgpsid);
+  }
+
+  gpx_put_indent(out, kTrkptLevel);
+  out.put("<trkpt lat=\"").put_fixed(waypointp->latitude, 9);
+  out.put("\" lon=\"").put_fixed(waypointp->longitude, 9).put('"');
+  if (children.isEmpty()) {
+    out.put("/>");
+  } else {
+    out.put('>').put(std::string_view(children.data(), children.size()));
+    gpx_put_indent(out, kTrkptLevel);
+    out.put("</trkpt>");
+  }
+  return true;
+}
+
+bool
+GpxFormat::gpx_fast_track_disp(const Waypoint* waypointp) const
+{
+  if (!gpx_fast_trkpt(waypointp, fast_trkpts, fast_trkpt_children)) {
+    return false;
+  }
+  if (fast_trkpts.size() >= kFastTrkptBatch) {
+    gpx_fast_flush(-1);
+  }
+  return true;
+}
+
+/*
+ * With threads the points of a track are formatted ahead in runs on the
+ * shared threads, up to two runs a thread, while gpx_track_disp() writes
+ * the runs that are done in order.  The text is the same as without.
+ */
+void
+GpxFormat::gpx_render_ahead() const
+{
+  while ((render_next != render_end) &&
+         (rendered_trkpts.size() < 2 * static_cast<std::size_t>(write_threads))) {
+    const auto begin = render_next;
+    const qsizetype count = std::min<qsizetype>(kRenderedTrkptRun, render_end - render_next);
+    render_next += count;
+
+    auto run = std::make_unique<RenderedTrkpts>();
+    RenderedTrkpts* r = run.get();
+    r->group.run([this, r, begin, count]() {
+      gpsbabel::FormatBuffer children;
+      r->points.resize(count);
+      auto it = begin;
+      for (qsizetype i = 0; i < count; ++i, ++it) {
+        const qsizetype offset = r->text.size();
+        if (gpx_fast_trkpt(*it, r->text, children)) {
+          r->points[i] = {offset, r->text.size() - offset};
+        }
+      }
+    });
+    rendered_trkpts.push_back(std::move(run));
+  }
+}
+
+/* Takes the next point of the track from the runs, writing it if it is
+ * plain and in a trkseg. */
+bool
+GpxFormat::gpx_rendered_track_disp() const
+{
+  RenderedTrkpts& run = *rendered_trkpts.front();
+  run.group.wait();
+  const RenderedPoint point = run.points.at(run.next++);
+  const bool written = trkseg_open && (point.size >= 0);
+  if (written) {
+    fast_trkpts.put(std::string_view(run.text.data() + point.offset, point.size));
+  }
+  if (run.next == run.points.size()) {
+    rendered_trkpts.pop_front();
+    gpx_render_ahead();
+  }
+  if (written && (fast_trkpts.size() >= kFastTrkptBatch)) {
+    gpx_fast_flush(-1);
+  }
+  return written;
+}
+
+/*
+ * Hand the batched track points to the writer.  next_level is the depth of
+ * the next element the writer will write, or -1 if more fast track points
+ * follow.
+ */
+void
+GpxFormat::gpx_fast_flush(int next_level) const
+{
+  if (fast_trkpts.isEmpty() && !fast_trkpts_unended) {
+    return;
+  }
+  if (next_level >= 0) {
+    gpx_put_indent(fast_trkpts, next_level);
+  }
+  // The points go straight to the file, the writer only closes the start
+  // tag it may have pending.  As after any text it won't indent the next
+  // element itself, so the points end with that indent.
+  writer->writeCharacters(QString());
+  oqfile->write(fast_trkpts.data(), fast_trkpts.size());
+  fast_trkpts_unended = next_level < 0;
+  fast_trkpts.clear();
+}
+
 void
 GpxFormat::gpx_track_disp(const Waypoint* waypointp) const
 {
@@ -1548,11 +2631,22 @@ GpxFormat::gpx_track_disp(const Waypoint* waypointp) const
 
   if (waypointp->wpt_flags.new_trkseg) {
     if (!first_in_trk) {
+      gpx_fast_flush(kTrkptLevel - 1);
       writer->writeEndElement();
     }
     writer->writeStartElement(QStringLiteral("trkseg"));
+    trkseg_open = true;
   }
 
+  if (write_threads > 1) {
+    if (gpx_rendered_track_disp()) {
+      return;
+    }
+  } else if (trkseg_open && gpx_fast_track_disp(waypointp)) {
+    return;
+  }
+  gpx_fast_flush(kTrkptLevel);
+
   writer->writeStartElement(QStringLiteral("trkpt"));
   writer->writeAttribute(QStringLiteral("lat"), toString(waypointp->latitude));
   writer->writeAttribute(QStringLiteral("lon"), toString(waypointp->longitude));
@@ -1560,9 +2654,9 @@ GpxFormat::gpx_track_disp(const Waypoint* waypointp) const
   gpx_write_common_core(waypointp, gpxpt_track);
 
   if (!(opt_humminbirdext || opt_garminext)) {
-    const auto* fs_gpx = reinterpret_cast<fs_xml*>(waypointp->fs.FsChainFind(kFsGpx));
+    const auto* fs_gpx = reinterpret_cast<const fs_xml*>(waypointp->fs.FsChainFind(kFsGpx));
     if (fs_gpx) {
-      fprint_xml_chain(fs_gpx->tag);
+      fprint_xml(fs_gpx);
     }
   } else {
     gpx_write_common_extensions(waypointp, gpxpt_track);
@@ -1573,6 +2667,8 @@ GpxFormat::gpx_track_disp(const Waypoint* waypointp) const
 void
 GpxFormat::gpx_track_tlr(const route_head* /*unused*/)
 {
+  gpx_fast_flush(kTrkptLevel - 1);
+  trkseg_open = false;
   if (!current_trk_head->waypoint_list.empty()) {
     writer->writeEndElement();
   }
@@ -1610,9 +2706,9 @@ GpxFormat::gpx_route_hdr(const route_head* rte) const
   }
 
   if (!(opt_humminbirdext || opt_garminext)) {
-    const auto* fs_gpx = reinterpret_cast<fs_xml*>(rte->fs.FsChainFind(kFsGpx));
+    const auto* fs_gpx = reinterpret_cast<const fs_xml*>(rte->fs.FsChainFind(kFsGpx));
     if (fs_gpx) {
-      fprint_xml_chain(fs_gpx->tag);
+      fprint_xml(fs_gpx);
     }
   } else if (opt_garminext) {
     if (rte->line_color.bbggrr > unknown_color) {
@@ -1641,9 +2737,9 @@ GpxFormat::gpx_route_disp(const Waypoint* waypointp) const
   gpx_write_common_core(waypointp, gpxpt_route);
 
   if (!(opt_humminbirdext || opt_garminext)) {
-    const auto* fs_gpx = reinterpret_cast<fs_xml*>(waypointp->fs.FsChainFind(kFsGpx));
+    const auto* fs_gpx = reinterpret_cast<const fs_xml*>(waypointp->fs.FsChainFind(kFsGpx));
     if (fs_gpx) {
-      fprint_xml_chain(fs_gpx->tag);
+      fprint_xml(fs_gpx);
     }
   } else {
     gpx_write_common_extensions(waypointp, gpxpt_route);
@@ -1687,9 +2783,12 @@ GpxFormat::gpx_write_bounds()
   auto gpx_waypt_bound_calc_lambda = [this](const Waypoint* waypointp)->void {
     gpx_waypt_bound_calc(waypointp);
   };
+  auto gpx_route_bound_calc_lambda = [this](const route_head* rte)->void {
+    waypt_merge_bounds(&all_bounds, rte->extent().bbox);
+  };
   waypt_disp_all(gpx_waypt_bound_calc_lambda);
-  route_disp_all(nullptr, nullptr, gpx_waypt_bound_calc_lambda);
-  track_disp_all(nullptr, nullptr, gpx_waypt_bound_calc_lambda);
+  route_disp_all(gpx_route_bound_calc_lambda, nullptr, nullptr);
+  track_disp_all(gpx_route_bound_calc_lambda, nullptr, nullptr);
 
   if (waypt_bounds_valid(&all_bounds)) {
     writer->writeStartElement(QStringLiteral("bounds"));
@@ -21,7 +21,10 @@
 #ifndef GPX_H_INCLUDED_
 #define GPX_H_INCLUDED_
 
-#include <QHash>                       // for QHash
+#include <deque>                       // for deque
+#include <memory>                      // for unique_ptr
+
+#include <QByteArray>                  // for QByteArray
 #include <QList>                       // for QList
 #include <QString>                     // for QString
 #include <QStringList>                 // for QStringList
@@ -29,13 +32,20 @@
 #include <QVector>                     // for QVector
 #include <QVersionNumber>              // for QVersionNumber
 #include <QXmlStreamAttributes>        // for QXmlStreamAttributes
-#include <QXmlStreamReader>            // for QXmlStreamReader
+#include <QtGlobal>                    // for qsizetype
 
 #include "defs.h"
 #include "format.h"                    // for Format
 #include "formspec.h"                  // for FormatSpecificData
 #include "mkshort.h"                   // for MakeShort
+#include "src/core/datetime.h"         // for DateTime
 #include "src/core/file.h"             // for File
+#include "src/core/footprint.h"        // for heap_bytes
+#include "src/core/formatbuffer.h"     // for FormatBuffer
+#include "src/core/scheduler.h"        // for TaskGroup
+#include "src/core/stringpool.h"       // for StringPool
+#include "src/core/utf8string.h"       // for Utf8String
+#include "src/core/xmlpullreader.h"    // for XmlPullReader
 #include "src/core/xmlstreamwriter.h"  // for XmlStreamWriter
 #include "src/core/xmltag.h"           // for xml_tag
 
@@ -65,6 +75,14 @@ public:
   void write() override;
   void wr_deinit() override;
   void exit() override;
+  bool rd_can_stream() const override
+  {
+    return true;
+  }
+  bool wr_can_run_concurrently() const override
+  {
+    return true;
+  }
 
 private:
   /*
@@ -82,6 +100,13 @@ private:
       return new gpx_wpt_fsdata(*this);
     }
 
+    std::size_t memory_usage() const override
+    {
+      return sizeof(*this) + gpsbabel::heap_bytes(magvar) + gpsbabel::heap_bytes(src) +
+             gpsbabel::heap_bytes(type) + gpsbabel::heap_bytes(ageofdgpsdata) +
+             gpsbabel::heap_bytes(dgpsid);
+    }
+
     QString magvar;
     QString src;
     QString type;
@@ -210,13 +235,51 @@ private:
     bool passthrough{true};
   };
 
+  struct tag_entry {
+    const char* path;
+    tag_mapping mapping;
+  };
+
+  class TagTable;
+
+  /*
+   * A run of top level elements that read_parallel() hands to a parser
+   * of its own on a worker thread, along with what that parser read.
+   */
+  struct ParallelChunk {
+    qint64 begin{0};
+    qint64 end{0};
+    std::unique_ptr<GpxFormat> parser;
+    WaypointList waypoints;
+    RouteList routes;
+    RouteList tracks;
+    bool ok{false};
+  };
+
+  /*
+   * A run of track points that gpx_render_ahead() formats on a worker
+   * thread, as gpx_fast_trkpt() would, for gpx_track_disp() to write.
+   */
+  struct RenderedPoint {
+    qsizetype offset{0};
+    qsizetype size{-1};  // -1 for points the writer has to write
+  };
+
+  struct RenderedTrkpts {
+    gpsbabel::TaskGroup group;
+    gpsbabel::FormatBuffer text;
+    QVector<RenderedPoint> points;
+    qsizetype next{0};  // the next point to write
+  };
+
 
   static void gpx_add_to_global(QStringList& ge, const QString& s);
   static inline QString toString(double d);
   static inline QString toString(float f);
   void gpx_reset_short_handle();
   void gpx_write_gdata(const QStringList& ge, const QString& tag) const;
-  tag_mapping get_tag(const QString& t) const;
+  static tag_mapping get_tag(QStringView path);
+  static bool is_geocache_data(tag_type type);
   void tag_gpx(const QXmlStreamAttributes& attr);
   void tag_wpt(const QXmlStreamAttributes& attr);
   void tag_cache_desc(const QXmlStreamAttributes& attr);
@@ -224,13 +287,20 @@ private:
   static void tag_garmin_fs(tag_type tag, const QString& text, Waypoint* waypt);
   void start_something_else(QStringView el, const QXmlStreamAttributes& attr);
   void end_something_else();
+  void raw_flush_text();
   void tag_log_wpt(const QXmlStreamAttributes& attr) const;
   void gpx_start(QStringView el, const QXmlStreamAttributes& attr);
   void gpx_end(QStringView unused);
   void gpx_cdata(QStringView s);
-  QString qualifiedName() const;
+  void append_qualified_name(QString& path) const;
+  void read_stream();
+  bool read_parallel(int threads);
+  static void read_chunk(ParallelChunk& chunk, const QByteArray& doc, const session_t* session);
+  void merge_chunk(const GpxFormat& parser);
   void write_attributes(const QXmlStreamAttributes& attributes) const;
   void fprint_xml_chain(const XmlTag* tag) const;
+  void fprint_xml(const fs_xml* fs_gpx) const;
+  void fprint_xml_raw(const QByteArray& xml) const;
   void write_gpx_url(const UrlList& urls) const;
   void write_gpx_url(const Waypoint* waypointp) const;
   void write_gpx_url(const route_head* rh) const;
@@ -242,6 +312,12 @@ private:
   void gpx_write_common_core(const Waypoint* waypointp, gpx_point_type point_type) const;
   void gpx_track_hdr(const route_head* rte);
   void gpx_track_disp(const Waypoint* waypointp) const;
+  bool gpx_fast_trkpt(const Waypoint* waypointp, gpsbabel::FormatBuffer& out,
+                      gpsbabel::FormatBuffer& children) const;
+  bool gpx_fast_track_disp(const Waypoint* waypointp) const;
+  void gpx_render_ahead() const;
+  bool gpx_rendered_track_disp() const;
+  void gpx_fast_flush(int next_level) const;
   void gpx_track_tlr(const route_head* unused);
   void gpx_track_pr();
   void gpx_route_hdr(const route_head* rte) const;
@@ -251,13 +327,29 @@ private:
   void gpx_waypt_bound_calc(const Waypoint* waypointp);
   void gpx_write_bounds();
 
-  QXmlStreamReader* reader{};
+  std::unique_ptr<gpsbabel::XmlPullReader> reader;
   XmlTag* cur_tag{};
+  QByteArray* raw_xml{};	// the fs_xml::raw being read into
+  int raw_depth{0};
+  bool raw_collapsed{false};	// raw_xml belongs to an XmlTag
+  QString raw_text;
+  /*
+   * The character data of the current element, kept between elements so
+   * its capacity is reused, and whether there was any.  cdatastr is the
+   * trimmed text that gpx_end works with.
+   */
+  QString cdata_buffer;
+  bool cdata_seen{false};
   QString cdatastr;
+  // The same text if it came as one token that needn't be copied, see
+  // XmlPullReader::textReference().
+  gpsbabel::Utf8String cdata_reference;
   char* opt_logpoint = nullptr;
   char* opt_humminbirdext = nullptr;
   char* opt_garminext = nullptr;
   char* opt_elevation_precision = nullptr;
+  char* opt_threads = nullptr;
+  char* opt_rawext = nullptr;
   int logpoint_ct = 0;
   int elevation_precision{};
 
@@ -270,11 +362,14 @@ private:
   QXmlStreamAttributes gpx_namespace_attribute;
 
   QString current_tag;
+  QVector<qsizetype> tag_starts;	// where each open element's part of current_tag starts
 
   Waypoint* wpt_tmp{};
+  gpsbabel::StringPool icon_pool;
   UrlLink* link_{};
   UrlLink* rh_link_{};
   bool cache_descr_is_html{};
+  gpsbabel::DateTime gc_log_date;
   gpsbabel::File* iqfile{};
   gpsbabel::File* oqfile{};
   gpsbabel::XmlStreamWriter* writer{};
@@ -290,6 +385,15 @@ private:
   route_head* trk_head{};
   route_head* rte_head{};
   const route_head* current_trk_head{};		// Output.
+  mutable gpsbabel::FormatBuffer fast_trkpts;	// Output, see gpx_fast_track_disp.
+  mutable gpsbabel::FormatBuffer fast_trkpt_children;
+  mutable bool fast_trkpts_unended{false};	// Written without the indent of what follows.
+  mutable bool trkseg_open{false};
+  int write_threads{1};
+  // The points of the current track not yet handed to gpx_render_ahead().
+  mutable WaypointList::const_iterator render_next;
+  mutable WaypointList::const_iterator render_end;
+  mutable std::deque<std::unique_ptr<RenderedTrkpts>> rendered_trkpts;
   /* used for bounds calculation on output */
   bounds all_bounds{};
   int next_trkpt_is_new_seg{};
@@ -345,8 +449,8 @@ private:
 #define GARMIN_WPT_EXT "/gpx/wpt/extensions/gpxx:WaypointExtension"
 #define GARMIN_TRKPT_EXT "/gpx/trk/trkseg/trkpt/extensions/gpxtpx:TrackPointExtension"
 
-// Maintain a fast mapping from full tag names to the struct above.
-  const QHash<QString, tag_mapping> hash = {
+// The full tag names, looked up through a perfect hash of them, see TagTable.
+  static constexpr tag_entry tag_entries[] = {
     {"/gpx", {tag_type::gpx, false}},
     METATAG(tag_type::name, "name"),
     METATAG(tag_type::desc, "desc"),
@@ -498,6 +602,16 @@ private:
       "Precision of elevations, number of decimals",
       "3", ARGTYPE_INT, ARG_NOMINMAX, nullptr
     },
+    {
+      "rawext", &opt_rawext,
+      "Keep passed through elements as raw XML",
+      nullptr, ARGTYPE_BOOL, ARG_NOMINMAX, nullptr
+    },
+    {
+      "threads", &opt_threads,
+      "Read and write large files on this many threads",
+      nullptr, ARGTYPE_INT, "1", nullptr, nullptr
+    },
   };
 
 };
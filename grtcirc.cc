@@ -23,14 +23,20 @@
 
 #include <algorithm>  // for clamp
 #include <cerrno>     // for errno, EDOM
-#include <cmath>      // for cos, sin, fabs, atan2, sqrt, asin, atan, isnan
+#include <cmath>      // for cos, sin, fabs, atan2, sqrt, asin, atan, isnan, isfinite
 #include <numbers>    // for pi
 #include <tuple>      // for tie, tuple, make_tuple, ignore
 
-#include "defs.h"     // for PositionRad, DEG, METERS_TO_MILES, PositionDeg
+#include <QtGlobal>   // for qsizetype
+
+#include "defs.h"     // for PositionRad, DEG, RAD, METERS_TO_MILES, PositionDeg
+#include "src/core/counters.h"  // for Counter
 
 static constexpr double EARTH_RAD = 6378137.0;
 
+static gpsbabel::Counter gcdist_counter("distance.gcdist");
+static gpsbabel::Counter linedist_counter("distance.linedist");
+
 std::tuple<double, double, double>
 crossproduct(double x1, double y1, double z1, double x2, double y2, double z2)
 {
@@ -57,44 +63,32 @@ double radtometers(double rads)
   return (rads * EARTH_RAD);
 }
 
-double gcdist(PositionRad pos1, PositionRad pos2)
+/*
+ * The kernels take each point's cosine (and sine) of latitude ready made,
+ * so the batch forms below can work them out once per point and still
+ * do exactly the arithmetic of the scalar functions.
+ */
+static inline double gcdist_core(double lat1, double lon1, double coslat1,
+                                 double lat2, double lon2, double coslat2)
 {
-  errno = 0;
-
-  const double lat1 = pos1.latR;
-  const double lon1 = pos1.lonR;
-  const double lat2 = pos2.latR;
-  const double lon2 = pos2.lonR;
-
   double sdlat = sin((lat1 - lat2) / 2.0);
   double sdlon = sin((lon1 - lon2) / 2.0);
 
-  double res = sqrt(sdlat * sdlat + cos(lat1) * cos(lat2) * sdlon * sdlon);
+  double res = sqrt(sdlat * sdlat + coslat1 * coslat2 * sdlon * sdlon);
 
   res = std::clamp(res, -1.0, 1.0);
 
-  res = asin(res);
-
-  if (std::isnan(res) || (errno == EDOM)) { /* this should never happen: */
-    errno = 0; /* Math argument out of domain of function, */
-    return 0;  /* or value returned is not a number */
-  }
-
-  return 2.0 * res;
+  return 2.0 * asin(res);
 }
 
 /* This value is the heading you'd leave point 1 at to arrive at point 2.
  * Inputs and outputs are in radians.
  */
-static double heading(PositionRad pos1, PositionRad pos2)
+static inline double heading_core(double sinlat1, double coslat1, double lon1,
+                                  double sinlat2, double coslat2, double lon2)
 {
-  const double lat1 = pos1.latR;
-  const double lon1 = pos1.lonR;
-  const double lat2 = pos2.latR;
-  const double lon2 = pos2.lonR;
-
-  double v1 = sin(lon2 - lon1) * cos(lat2);
-  double v2 = cos(lat1) * sin(lat2) - sin(lat1) * cos(lat2) * cos(lon2 - lon1);
+  double v1 = sin(lon2 - lon1) * coslat2;
+  double v2 = coslat1 * sinlat2 - sinlat1 * coslat2 * cos(lon2 - lon1);
   /* rounding error protection */
   if (fabs(v1) < 1e-15) {
     v1 = 0.0;
@@ -105,9 +99,9 @@ static double heading(PositionRad pos1, PositionRad pos2)
   return atan2(v1, v2);
 }
 
-double heading_true_degrees(PositionRad pos1, PositionRad pos2)
+static inline double heading_degrees(double h)
 {
-  double h = 360.0 + DEG(heading(pos1, pos2));
+  h = 360.0 + DEG(h);
   if (h >= 360.0) {
     h -= 360.0;
   }
@@ -115,28 +109,159 @@ double heading_true_degrees(PositionRad pos1, PositionRad pos2)
   return h;
 }
 
+double gcdist(PositionRad pos1, PositionRad pos2)
+{
+  gcdist_counter.add();
+  errno = 0;
+
+  double res = gcdist_core(pos1.latR, pos1.lonR, cos(pos1.latR),
+                           pos2.latR, pos2.lonR, cos(pos2.latR));
+
+  if (std::isnan(res) || (errno == EDOM)) { /* this should never happen: */
+    errno = 0; /* Math argument out of domain of function, */
+    return 0;  /* or value returned is not a number */
+  }
+
+  return res;
+}
+
+double heading_true_degrees(PositionRad pos1, PositionRad pos2)
+{
+  return heading_degrees(heading_core(sin(pos1.latR), cos(pos1.latR), pos1.lonR,
+                                      sin(pos2.latR), cos(pos2.latR), pos2.lonR));
+}
+
+/*
+ * Two points are at least their difference in latitude apart, and at
+ * most that plus their difference in longitude, as a parallel is never
+ * longer than the equator.  Neither bound takes any trigonometry, so a
+ * limit that is clearly outside them decides the comparison at once.
+ * The margins are far wider than the rounding in gcdist(), so only a
+ * limit within about a part in a billion (or a micrometre) of a bound
+ * is left for the caller to measure.  Positions that are off the globe,
+ * which gcdist() may measure as 0, are always left to the caller.
+ */
+int gcdist_meters_cmp(PositionRad pos1, PositionRad pos2, double limit)
+{
+  constexpr double kRelMargin = 1.0e-9;
+  constexpr double kAbsMargin = 1.0e-6;  // meters
+
+  constexpr double kHalfPi = std::numbers::pi / 2.0;
+  if (!(std::fabs(pos1.latR) <= kHalfPi) || !(std::fabs(pos2.latR) <= kHalfPi) ||
+      !std::isfinite(pos1.lonR) || !std::isfinite(pos2.lonR)) {
+    return 0;
+  }
+  const double dlat = std::fabs(pos1.latR - pos2.latR);
+  if (radtometers(dlat) > limit * (1.0 + kRelMargin) + kAbsMargin) {
+    return 1;
+  }
+  double dlon = std::fabs(pos1.lonR - pos2.lonR);
+  if (dlon > std::numbers::pi) {
+    dlon = 2.0 * std::numbers::pi - dlon;
+  }
+  if ((dlon >= 0.0) && (radtometers(dlat + dlon) < limit * (1.0 - kRelMargin) - kAbsMargin)) {
+    return -1;
+  }
+  return 0;
+}
+
+bool gcdist_meters_within(PositionRad pos1, PositionRad pos2, double limit)
+{
+  int cmp = gcdist_meters_cmp(pos1, pos2, limit);
+  if (cmp != 0) {
+    return cmp < 0;
+  }
+  return radtometers(gcdist(pos1, pos2)) <= limit;
+}
+
+bool gcdist_meters_below(PositionRad pos1, PositionRad pos2, double limit)
+{
+  int cmp = gcdist_meters_cmp(pos1, pos2, limit);
+  if (cmp != 0) {
+    return cmp < 0;
+  }
+  return radtometers(gcdist(pos1, pos2)) < limit;
+}
+
+/*
+ * The domain errors gcdist() checks errno for all come with a NaN, so
+ * the batch forms only look at the result.
+ */
+void gcdist_to(const double* lat, const double* lon, qsizetype count,
+               PositionRad pos, double* dist)
+{
+  gcdist_counter.add(count);
+  const double coslat = cos(pos.latR);
+  for (qsizetype i = 0; i < count; ++i) {
+    const double latr = RAD(lat[i]);
+    const double d = gcdist_core(latr, RAD(lon[i]), cos(latr), pos.latR, pos.lonR, coslat);
+    dist[i] = std::isnan(d) ? 0 : d;
+  }
+}
+
+void gcdist_along(const double* lat, const double* lon, qsizetype count, double* dist)
+{
+  if (count < 2) {
+    return;
+  }
+  gcdist_counter.add(count - 1);
+  double lat1 = RAD(lat[0]);
+  double lon1 = RAD(lon[0]);
+  double coslat1 = cos(lat1);
+  for (qsizetype i = 1; i < count; ++i) {
+    const double lat2 = RAD(lat[i]);
+    const double lon2 = RAD(lon[i]);
+    const double coslat2 = cos(lat2);
+    const double d = gcdist_core(lat1, lon1, coslat1, lat2, lon2, coslat2);
+    dist[i - 1] = std::isnan(d) ? 0 : d;
+    lat1 = lat2;
+    lon1 = lon2;
+    coslat1 = coslat2;
+  }
+}
+
+void heading_true_degrees_along(const double* lat, const double* lon, qsizetype count, double* heading)
+{
+  if (count < 2) {
+    return;
+  }
+  double sinlat1 = sin(RAD(lat[0]));
+  double coslat1 = cos(RAD(lat[0]));
+  double lon1 = RAD(lon[0]);
+  for (qsizetype i = 1; i < count; ++i) {
+    const double sinlat2 = sin(RAD(lat[i]));
+    const double coslat2 = cos(RAD(lat[i]));
+    const double lon2 = RAD(lon[i]);
+    heading[i - 1] = heading_degrees(heading_core(sinlat1, coslat1, lon1, sinlat2, coslat2, lon2));
+    sinlat1 = sinlat2;
+    coslat1 = coslat2;
+    lon1 = lon2;
+  }
+}
+
 // Note: This is probably not going to vectorize as it uses statics internally,
 // so it's hard for the optimizer to prove it's a pure function with no side
-// effects, right?
+// effects, right?  The statics are per thread, so threads may call it at once.
 std::tuple<double, PositionDeg, double> linedistprj(PositionRad pos1,
                                                     PositionRad pos2,
                                                     PositionRad pos3)
 {
-  static double _lat1 = -9999;
-  static double _lat2 = -9999;
-  static double _lon1 = -9999;
-  static double _lon2 = -9999;
-
-  static double x1;
-  static double y1;
-  static double z1;
-  static double x2;
-  static double y2;
-  static double z2;
-  static double xa;
-  static double ya;
-  static double za;
-  static double la;
+  linedist_counter.add();
+  static thread_local double _lat1 = -9999;
+  static thread_local double _lat2 = -9999;
+  static thread_local double _lon1 = -9999;
+  static thread_local double _lon2 = -9999;
+
+  static thread_local double x1;
+  static thread_local double y1;
+  static thread_local double z1;
+  static thread_local double x2;
+  static thread_local double y2;
+  static thread_local double z2;
+  static thread_local double xa;
+  static thread_local double ya;
+  static thread_local double za;
+  static thread_local double la;
 
   double dot;
 
@@ -23,6 +23,9 @@
 #define GRTCIRC_H
 
 #include <tuple>   // for tuple
+
+#include <QtGlobal>  // for qsizetype
+
 #include "defs.h"  // for PositionRad, PositionDeg
 
 /* Note PositionDeg and PositionRad can be implicity converted to
@@ -32,6 +35,26 @@
 double gcdist(PositionRad pos1, PositionRad pos2);
 double heading_true_degrees(PositionRad pos1, PositionRad pos2);
 
+/* Compare radtometers(gcdist(pos1, pos2)) with limit, measuring only
+ * when the points are too near the limit to tell otherwise.
+ * gcdist_meters_cmp() returns -1 or 1 if they are clearly nearer or
+ * farther, and 0 if the caller has to measure.
+ */
+int gcdist_meters_cmp(PositionRad pos1, PositionRad pos2, double limit);
+bool gcdist_meters_within(PositionRad pos1, PositionRad pos2, double limit);  // <= limit
+bool gcdist_meters_below(PositionRad pos1, PositionRad pos2, double limit);   // < limit
+
+/* Batch forms over arrays of latitudes and longitudes in degrees, with
+ * the same results as calling the scalar functions on each point:
+ * dist[i] = gcdist(point i, pos) for count points,
+ * dist[i] = gcdist(point i, point i + 1) for count - 1 pairs, and
+ * heading[i] = heading_true_degrees(point i, point i + 1) likewise.
+ */
+void gcdist_to(const double* lat, const double* lon, qsizetype count,
+               PositionRad pos, double* dist);
+void gcdist_along(const double* lat, const double* lon, qsizetype count, double* dist);
+void heading_true_degrees_along(const double* lat, const double* lon, qsizetype count, double* heading);
+
 std::tuple<double, PositionDeg, double> linedistprj(PositionRad pos1,
                                                     PositionRad pos2,
                                                     PositionRad pos3);
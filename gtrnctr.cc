@@ -28,7 +28,7 @@
 
 #include <QByteArray>            // for QByteArray
 #include <QDateTime>             // for QDateTime
-#include <QtGlobal>              // for qRound, qPrintable
+#include <QtGlobal>              // for qRound
 #include <QXmlStreamAttributes>  // for QXmlStreamAttributes
 
 #include <cstdarg>               // for va_end, va_list, va_start
@@ -37,7 +37,8 @@
 #include <optional>              // for optional
 #include <type_traits>           // for add_const<>::type
 
-#include "defs.h"                // for Waypoint, route_head, computed_trkdata, waypt_add, route_disp, track_disp_all, case_ignore_strncmp, track_add_head, track_add_wpt, track_recompute, xml_parse_time, CSTR, wp_flags, WAYPT_SET, unknown_alt
+#include "defs.h"                // for Waypoint, route_head, computed_trkdata, route_extent, waypt_add, track_disp_all, case_ignore_strncmp, track_add_head, track_add_wpt, xml_parse_time, CSTR, wp_flags, WAYPT_SET, unknown_alt
+#include "gbfile.h"              // for gbfwrite
 #include "xmlgeneric.h"          // for xml_deinit, xml_init, xml_read
 
 
@@ -128,30 +129,54 @@ GtrnctrFormat::gtc_lap_start(const route_head* /*unused*/)
   gtc_most_time = gpsbabel::DateTime();
 }
 
-computed_trkdata
-GtrnctrFormat::gtc_new_study_lap(const route_head* rte)
-{
-  return track_recompute(rte);
+/*
+ * The start and the end of the lap of a whole track come from the
+ * track's extent, the rest from its statistics, both of which the track
+ * computes once.  Like the first, the latest point is only taken if its
+ * time is after the epoch.
+ */
+const computed_trkdata&
+GtrnctrFormat::gtc_study_lap(const route_head* rte)
+{
+  const route_extent& extent = rte->extent();
+  if (extent.earliest != nullptr) {
+    gtc_least_time = extent.earliest->GetCreationTime();
+    gtc_start_lat = extent.earliest->latitude;
+    gtc_start_long = extent.earliest->longitude;
+  }
+  if ((extent.latest != nullptr) && (extent.latest->creation_time > gtc_most_time)) {
+    gtc_most_time = extent.latest->GetCreationTime();
+    gtc_end_lat = extent.latest->latitude;
+    gtc_end_long = extent.latest->longitude;
+  }
+  return rte->trkdata();
 }
 
-void
-GtrnctrFormat::gtc_study_lap(const Waypoint* wpt)
+/*
+ * Track points are formatted into gtc_points, which is written out in
+ * large pieces, with the indentation gtc_write_xml would give.
+ */
+gpsbabel::FormatBuffer&
+GtrnctrFormat::gtc_point_line(int indent)
 {
-  if (wpt->creation_time.isValid() && (!gtc_least_time.isValid())) {
-    gtc_least_time = wpt->GetCreationTime();
-    gtc_start_lat = wpt->latitude;
-    gtc_start_long = wpt->longitude;
+  if (indent < 0) {
+    gtc_indent_level--;
   }
-
-  if (wpt->creation_time.isValid() && (gtc_least_time > wpt->GetCreationTime())) {
-    gtc_least_time = wpt->GetCreationTime();
-    gtc_start_lat = wpt->latitude;
-    gtc_start_long = wpt->longitude;
+  for (int i = 0; i < gtc_indent_level; ++i) {
+    gtc_points.put("  ");
   }
-  if (wpt->creation_time > gtc_most_time)  {
-    gtc_most_time = wpt->GetCreationTime();
-    gtc_end_lat = wpt->latitude;
-    gtc_end_long = wpt->longitude;
+  if (indent > 0) {
+    gtc_indent_level++;
+  }
+  return gtc_points;
+}
+
+void
+GtrnctrFormat::gtc_flush_points()
+{
+  if (!gtc_points.isEmpty()) {
+    gbfwrite(gtc_points.data(), 1, gtc_points.size(), ofd);
+    gtc_points.clear();
   }
 }
 
@@ -159,56 +184,57 @@ void
 GtrnctrFormat::gtc_waypt_pr(const Waypoint* wpt)
 {
   if (wpt->wpt_flags.is_split != 0) {
-    gtc_write_xml(1, "<Trackpoint split=\"yes\">\n");
+    gtc_point_line(1).put("<Trackpoint split=\"yes\">\n");
   } else {
-    gtc_write_xml(1, "<Trackpoint>\n");
+    gtc_point_line(1).put("<Trackpoint>\n");
   }
 
   if (wpt->creation_time.isValid()) {
     QString time_string = wpt->CreationTimeXML();
     if (!time_string.isEmpty()) {
-      gtc_write_xml(0, "<Time>%s</Time>\n",
-                    qPrintable(time_string));
+      gtc_point_line(0).put("<Time>").put(time_string.toLatin1()).put("</Time>\n");
     }
   }
   if (wpt->latitude && wpt->longitude) {
-    gtc_write_xml(1, "<Position>\n");
-    gtc_write_xml(0, "<LatitudeDegrees>%.7f</LatitudeDegrees>\n", wpt->latitude);
-    gtc_write_xml(0, "<LongitudeDegrees>%.7f</LongitudeDegrees>\n", wpt->longitude);
-    gtc_write_xml(-1, "</Position>\n");
+    gtc_point_line(1).put("<Position>\n");
+    gtc_point_line(0).put("<LatitudeDegrees>").put_fixed(wpt->latitude, 7).put("</LatitudeDegrees>\n");
+    gtc_point_line(0).put("<LongitudeDegrees>").put_fixed(wpt->longitude, 7).put("</LongitudeDegrees>\n");
+    gtc_point_line(-1).put("</Position>\n");
   }
   if (wpt->altitude != unknown_alt) {
-    gtc_write_xml(0, "<AltitudeMeters>%.1f</AltitudeMeters>\n", wpt->altitude);
+    gtc_point_line(0).put("<AltitudeMeters>").put_fixed(wpt->altitude, 1).put("</AltitudeMeters>\n");
   }
   if (wpt->odometer_distance) {
-    gtc_write_xml(0, "<DistanceMeters>%.2f</DistanceMeters>\n", wpt->odometer_distance);
+    gtc_point_line(0).put("<DistanceMeters>").put_fixed(wpt->odometer_distance, 2).put("</DistanceMeters>\n");
   }
   // TODO: find a schema extension to include wpt->course and wpt->temperature
   // TODO: find a way to include DistanceMeters from odometer information
   if (wpt->heartrate) {
-    //gtc_write_xml(0, "<HeartRateBpm>%d</HeartRateBpm>\n", wpt->heartrate);
-    gtc_write_xml(1, "<HeartRateBpm xsi:type=\"HeartRateInBeatsPerMinute_t\">\n");
-    gtc_write_xml(0,"<Value>%d</Value>\n", wpt->heartrate);
-    gtc_write_xml(-1,"</HeartRateBpm>\n");
+    gtc_point_line(1).put("<HeartRateBpm xsi:type=\"HeartRateInBeatsPerMinute_t\">\n");
+    gtc_point_line(0).put("<Value>").put_int(wpt->heartrate).put("</Value>\n");
+    gtc_point_line(-1).put("</HeartRateBpm>\n");
   }
   if (wpt->cadence) {
-    gtc_write_xml(0, "<Cadence>%d</Cadence>\n", wpt->cadence);
+    gtc_point_line(0).put("<Cadence>").put_int(wpt->cadence).put("</Cadence>\n");
   }
   if (wpt->speed_has_value() || wpt->power) {
-    gtc_write_xml(1, "<Extensions>\n");
-    gtc_write_xml(1, "<TPX xmlns=\"http://www.garmin.com/xmlschemas/ActivityExtension/v2\">\n");
+    gtc_point_line(1).put("<Extensions>\n");
+    gtc_point_line(1).put("<TPX xmlns=\"http://www.garmin.com/xmlschemas/ActivityExtension/v2\">\n");
     /* see http://www8.garmin.com/xmlschemas/ActivityExtensionv2.xsd */
     if (wpt->speed_has_value()) {
-      gtc_write_xml(0, "<Speed>%.3f</Speed>\n", wpt->speed_value());
+      gtc_point_line(0).put("<Speed>").put_fixed(wpt->speed_value(), 3).put("</Speed>\n");
     }
     if (wpt->power) {
-      gtc_write_xml(0, "<Watts>%.0f</Watts>\n", wpt->power);
+      gtc_point_line(0).put("<Watts>").put_fixed(wpt->power, 0).put("</Watts>\n");
     }
-    gtc_write_xml(-1, "</TPX>\n");
-    gtc_write_xml(-1, "</Extensions>\n");
+    gtc_point_line(-1).put("</TPX>\n");
+    gtc_point_line(-1).put("</Extensions>\n");
   }
 
-  gtc_write_xml(-1, "</Trackpoint>\n");
+  gtc_point_line(-1).put("</Trackpoint>\n");
+  if (gtc_points.size() >= kGtcFlushSize) {
+    gtc_flush_points();
+  }
 }
 
 void
@@ -268,11 +294,7 @@ GtrnctrFormat::gtc_act_hdr(const route_head* rte)
 {
   gtc_write_xml(1, "<Activity Sport=\"%s\">\n", gtc_sportlist[gtc_sport]);
   gtc_lap_start(nullptr);
-  computed_trkdata tdata = gtc_new_study_lap(rte);
-  auto gtc_study_lap_lambda = [this](const Waypoint* waypointp)->void {
-    gtc_study_lap(waypointp);
-  };
-  route_disp(rte, gtc_study_lap_lambda);
+  const computed_trkdata& tdata = gtc_study_lap(rte);
   if (gtc_least_time.isValid()) {
     gtc_write_xml(0, "<Id>%s</Id>\n",
                   CSTR(gtc_least_time.toPrettyString()));
@@ -288,6 +310,7 @@ GtrnctrFormat::gtc_act_hdr(const route_head* rte)
 void
 GtrnctrFormat::gtc_act_ftr(const route_head* /*unused*/)
 {
+  gtc_flush_points();
   gtc_write_xml(-1, "</Track>\n");
   gtc_write_xml(-1, "</Lap>\n");
   gtc_write_xml(-1, "</Activity>\n");
@@ -299,11 +322,7 @@ GtrnctrFormat::gtc_crs_hdr(const route_head* rte)
 
   gtc_write_xml(1, "<Course>\n");
   gtc_lap_start(nullptr);
-  computed_trkdata tdata = gtc_new_study_lap(rte);
-  auto gtc_study_lap_lambda = [this](const Waypoint* waypointp)->void {
-    gtc_study_lap(waypointp);
-  };
-  route_disp(rte, gtc_study_lap_lambda);
+  const computed_trkdata& tdata = gtc_study_lap(rte);
 
   if (!rte->rte_name.isEmpty()) {
     QString name = rte->rte_name.left(kGtcMaxNameLen);
@@ -321,6 +340,7 @@ GtrnctrFormat::gtc_crs_hdr(const route_head* rte)
 void
 GtrnctrFormat::gtc_crs_ftr(const route_head* /*unused*/)
 {
+  gtc_flush_points();
   gtc_write_xml(-1,"</Track>\n");
   gtc_write_xml(-1, "</Course>\n");
 
@@ -35,6 +35,7 @@
 #include "format.h"              // for Format
 #include "gbfile.h"              // for gbfile
 #include "src/core/datetime.h"   // for DateTime
+#include "src/core/formatbuffer.h" // for FormatBuffer
 #include "xmlgeneric.h"          // for cb_cdata, xg_functor_map_entry, cb_start, cb_end
 
 
@@ -60,6 +61,11 @@ public:
     };
   }
 
+  unsigned int wr_fields() const override
+  {
+    return wpt_field_none;
+  }
+
   void rd_init(const QString& fname) override;
   void read() override;
   void rd_deinit() override;
@@ -71,6 +77,7 @@ private:
   /* Constants */
 
   static constexpr int kGtcMaxNameLen = 15;
+  static constexpr int kGtcFlushSize = 64 * 1024;
   static constexpr const char* gtc_sportlist[] = { "Biking", "Running", "MultiSport", "Other" };
 
   static constexpr const char* gtc_tags_to_ignore[] = {
@@ -88,8 +95,9 @@ private:
   [[gnu::format(printf, 3, 4)]] void gtc_write_xml(int indent, const char* fmt, ...);
   void gtc_write_xml(int indent, const QString& s);
   void gtc_lap_start(const route_head*  /* unused */);
-  static computed_trkdata gtc_new_study_lap(const route_head* rte);
-  void gtc_study_lap(const Waypoint* wpt);
+  const computed_trkdata& gtc_study_lap(const route_head* rte);
+  gpsbabel::FormatBuffer& gtc_point_line(int indent);
+  void gtc_flush_points();
   void gtc_waypt_pr(const Waypoint* wpt);
   void gtc_fake_hdr(const computed_trkdata& tdata);
   void gtc_act_hdr(const route_head* rte);
@@ -125,6 +133,7 @@ private:
   /* Data Members */
 
   gbfile* ofd{};
+  gpsbabel::FormatBuffer gtc_points;	/* track points not yet written to ofd */
   int lap_ct = 0;
   int lap_s = 0;
   Waypoint* wpt_tmp{};
@@ -13,7 +13,7 @@ int main(int argc, char** argv)
   QApplication app(argc, argv);
   QStringList qargs = QApplication::arguments();
 
-  QList<Format> formatList;
+  QList<FormatInfo> formatList;
 
   if (qargs.size() != 2) {
     qFatal("Usage: %s output_file_name", qPrintable(qargs.at(0)));
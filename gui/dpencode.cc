@@ -171,13 +171,10 @@ double PolylineEncoder::distance(const LatLng& p0, const LatLng& p1, const LatLn
 }
 
 //------------------------------------------------------------------------
-void PolylineEncoder::dpEncode(string& encPts, string& encLevels, const vector<LatLng>& points)
+// The distance of each point from the line that the Douglas-Peucker
+// algorithm drew when it kept the point, -1 for points not kept.
+vector<double> PolylineEncoder::dpDistances(const vector<LatLng>& points)
 {
-  if (points.size() < 2) {
-    encPts = encLevels = "";  // no solution here.
-    return;
-
-  }
   stack <IntervalPair> stk;
   vector <double>  dists(points.size(), -1.0);
 
@@ -202,6 +199,47 @@ void PolylineEncoder::dpEncode(string& encPts, string& encLevels, const vector<L
       stk.push(IntervalPair(maxLoc, current.i1));
     }
   }
+  return dists;
+}
+
+//------------------------------------------------------------------------
+void PolylineEncoder::dpEncode(string& encPts, string& encLevels, const vector<LatLng>& points)
+{
+  if (points.size() < 2) {
+    encPts = encLevels = "";  // no solution here.
+    return;
+
+  }
+  vector <double> dists = dpDistances(points);
   createEncodings(encPts, points, dists);
   encodeLevels(encLevels, points, dists);
 }
+
+//------------------------------------------------------------------------
+void PolylineEncoder::dpLevels(vector<int>& levels, const vector<LatLng>& points)
+{
+  levels.assign(points.size(), numLevels-1);
+  if (points.size() < 3) {
+    return;
+  }
+  vector <double> dists = dpDistances(points);
+  for (unsigned int i=1; i<points.size()-1; i++) {
+    levels[i] = (dists[i] >= 0.0) ? numLevels-computeLevel(dists[i])-1 : -1;
+  }
+}
+
+//------------------------------------------------------------------------
+// All the points, in Google's encoded polyline format.
+void PolylineEncoder::encodePoints(string& encPts, const vector<LatLng>& points)
+{
+  encPts = "";
+  int plat = 0;
+  int plng = 0;
+  for (const auto& pt : points) {
+    int late5 = roundToInt(pt.lat() * 1e5);
+    int lnge5 = roundToInt(pt.lng() * 1e5);
+    encPts += encodeSignedNumber(late5 - plat) + encodeSignedNumber(lnge5 - plng);
+    plat = late5;
+    plng = lnge5;
+  }
+}
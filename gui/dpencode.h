@@ -35,9 +35,15 @@ class PolylineEncoder
 public:
   PolylineEncoder(int numLevels=19, double zoomFactor=2.0, double verySmall = 0.00001);
   void dpEncode(string& encPts, string& encLevels, const vector<LatLng>& points);
+  // The level of each point, from numLevels-1 for the most significant
+  // down to 0, or -1 for points too close to the line to ever be drawn.
+  void dpLevels(vector<int>& levels, const vector<LatLng>& points);
+  static void encodePoints(string& encPts, const vector<LatLng>& points);
 
 private:
 
+  vector<double> dpDistances(const vector<LatLng>& points);
+
   int computeLevel(double dd);
   double distance(const LatLng&, const LatLng&, const LatLng&);
   void encodeLevels(string&, const vector<LatLng>& points, const vector<double>& dists);
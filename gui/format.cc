@@ -23,7 +23,7 @@
 #include "format.h"
 #include "mainwindow.h"
 
-QString Format::htmlBase_ = QString();
+QString FormatInfo::htmlBase_ = QString();
 
 static void saveOptions(QSettings& settings, const QString& prefix, const QList<FormatOption>& options)
 {
@@ -49,7 +49,7 @@ static void restoreOptions(QSettings& settings, const QString& prefix, QList<For
   }
 }
 
-void Format::saveSettings(QSettings& settings)
+void FormatInfo::saveSettings(QSettings& settings)
 {
   saveOptions(settings, name_+".input", inputOptions_);
   saveOptions(settings, name_+".output", outputOptions_);
@@ -58,7 +58,7 @@ void Format::saveSettings(QSettings& settings)
   settings.setValue(name_+".hidden", isHidden());
 }
 
-void Format::restoreSettings(QSettings& settings)
+void FormatInfo::restoreSettings(QSettings& settings)
 {
   restoreOptions(settings, name_ + ".input", inputOptions_);
   restoreOptions(settings, name_ + ".output", outputOptions_);
@@ -67,7 +67,7 @@ void Format::restoreSettings(QSettings& settings)
   hidden_ = settings.value(name_ + ".hidden", false).toBool();
 }
 
-void Format::setToDefault()
+void FormatInfo::setToDefault()
 {
   for (int i=0; i<inputOptions_.size(); i++) {
     if (inputOptions_[i].getType() == FormatOption::OPTbool && inputOptions_[i].getDefaultValue().toBool()) {
@@ -139,27 +139,27 @@ private:
 
 
 //------------------------------------------------------------------------
-class Format
+class FormatInfo
 {
 public:
 
   /* Special Member Functions */
 
-  Format() = default;
-  Format(const QString& name,
-         const QString& description,
-         bool readWaypoints,
-         bool readTracks,
-         bool readRoutes,
-         bool writeWaypoints,
-         bool writeTracks,
-         bool writeRoutes,
-         bool fileFormat,
-         bool deviceFormat,
-         const QStringList& extensions,
-         QList<FormatOption>& inputOptions,
-         QList<FormatOption>& outputOptions,
-         const QString& html):
+  FormatInfo() = default;
+  FormatInfo(const QString& name,
+             const QString& description,
+             bool readWaypoints,
+             bool readTracks,
+             bool readRoutes,
+             bool writeWaypoints,
+             bool writeTracks,
+             bool writeRoutes,
+             bool fileFormat,
+             bool deviceFormat,
+             const QStringList& extensions,
+             QList<FormatOption>& inputOptions,
+             QList<FormatOption>& outputOptions,
+             const QString& html):
     name_(name),
     description_(description),
     readWaypoints_(readWaypoints),
@@ -25,16 +25,28 @@
 #include <QByteArray>                      // for QByteArray
 #include <QChar>                           // for operator==, QChar
 #include <QCoreApplication>                // for QCoreApplication
+#include <QDateTime>                       // for QDateTime
+#include <QDir>                            // for QDir
+#include <QFile>                           // for QFile
+#include <QFileInfo>                       // for QFileInfo
+#include <QIODevice>                       // for QIODevice, QIODevice::ReadOnly, QIODevice::WriteOnly
+#include <QJsonArray>                      // for QJsonArray
+#include <QJsonDocument>                   // for QJsonDocument
+#include <QJsonObject>                     // for QJsonObject
+#include <QJsonValue>                      // for QJsonValue
 #include <QObject>                         // for QObject
 #include <QProcess>                        // for QProcess
 #include <QRegularExpression>              // for QRegularExpression
-#include <QRegularExpressionMatch>         // for QRegularExpressionMatch
+#include <QStandardPaths>                  // for QStandardPaths, QStandardPaths::CacheLocation
 #include <QString>                         // for QString, operator+
 #include <QTextStream>                     // for QTextStream
 #include <QVariant>                        // for QVariant
 #include <QApplication>                    // for QApplication
 #include <QMessageBox>                     // for QMessageBox
 #include "appname.h"                       // for appName
+#ifndef GENERATE_CORE_STRINGS
+#include "gbversion.h"                     // for VERSION, kVersionSHA
+#endif
 
 
 #ifdef GENERATE_CORE_STRINGS
@@ -51,37 +63,30 @@ static QString xlt(const QString& f)
 }
 
 //------------------------------------------------------------------------
-bool FormatLoad::skipToValidLine()
-{
-  static const QRegularExpression regex("^file|serial");
-  while ((currentLine_ < lines_.size()) && !regex.match(lines_[currentLine_]).hasMatch()) {
-    currentLine_++;
-  }
-  return (currentLine_<lines_.size());
-}
-
-//------------------------------------------------------------------------
-bool FormatLoad::processFormat(Format& format)
+bool FormatLoad::processFormat(const QJsonObject& object, FormatInfo& format)
 {
-  QStringList hfields = lines_[currentLine_++].split("\t");
-  if (hfields.size() < 5) {
+  QString formatType = object.value("type").toString();
+  QString caps = object.value("caps").toString();
+  QString formatName = object.value("name").toString();
+  if (caps.size() != 6 || formatName.isEmpty()) {
     return false;
   }
-  QString htmlPage = lines_[currentLine_++].trimmed();
+  QString htmlPage = object.value("url").toString();
 
   QList <FormatOption> optionList;
-  while ((currentLine_ < lines_.size()) && lines_[currentLine_].startsWith("option")) {
-    QStringList ofields = lines_[currentLine_].split("\t");
-    if (ofields.size() < 9) {
+  const QJsonArray options = object.value("options").toArray();
+  for (const auto& value : options) {
+    QJsonObject option = value.toObject();
+    QString name        = option.value("name").toString();
+    QString description = option.value("description").toString();
+    QString optionType  = option.value("type").toString();
+    QString optionDef   = option.value("default").toString();
+    QString optionMin   = option.value("min").toString();
+    QString optionMax   = option.value("max").toString();
+    QString optionHtml  = option.value("url").toString();
+    if (name.isEmpty()) {
       return false;
     }
-    QString name        = ofields[2];
-    QString description = ofields[3];
-    QString optionType  = ofields[4];
-    QString optionDef   = ofields[5];
-    QString optionMin   = ofields[6];
-    QString optionMax   = ofields[7];
-    QString optionHtml  = ofields[8];
     FormatOption::optionType type = FormatOption::OPTbool;
     if (optionType == "boolean") {
       type = FormatOption::OPTbool;
@@ -113,66 +118,144 @@ bool FormatLoad::processFormat(Format& format)
     optionList << FormatOption(name, xlt(description),
                                type, QVariant(optionDef), QVariant(optionMin),
                                QVariant(optionMax), optionHtml);
-    currentLine_++;
   }
   QList <FormatOption> optionList2 = optionList;
 
-  format = Format(hfields[2], xlt(hfields[4]),
-                  hfields[1][0] == QChar('r'),  hfields[1][2] == QChar('r'),  hfields[1][4] == QChar('r'),
-                  hfields[1][1] == QChar('w'),  hfields[1][3] == QChar('w'),  hfields[1][5] == QChar('w'),
-                  hfields[0] == "file",
-                  hfields[0] == "serial",
-                  hfields[3].split('/'),
-                  optionList,
-                  optionList2, htmlPage);
+  QStringList extensions;
+  const QJsonArray extensionArray = object.value("extensions").toArray();
+  for (const auto& value : extensionArray) {
+    extensions << value.toString();
+  }
+
+  format = FormatInfo(formatName, xlt(object.value("description").toString()),
+                      caps[0] == QChar('r'),  caps[2] == QChar('r'),  caps[4] == QChar('r'),
+                      caps[1] == QChar('w'),  caps[3] == QChar('w'),  caps[5] == QChar('w'),
+                      formatType == "file",
+                      formatType == "serial",
+                      extensions,
+                      optionList,
+                      optionList2, htmlPage);
 #ifndef GENERATE_CORE_STRINGS
-  if (htmlPage.length() > 0 && Format::getHtmlBase().length() == 0) {
+  if (htmlPage.length() > 0 && FormatInfo::getHtmlBase().length() == 0) {
     QString base = htmlPage;
     static const QRegularExpression re("/[^/]+$");
     base.replace(re, "/");
-    Format::setHtmlBase(base);
+    FormatInfo::setHtmlBase(base);
   }
 #endif
   return true;
 }
 
 //------------------------------------------------------------------------
-bool FormatLoad::getFormats(QList<Format>& formatList)
+QByteArray FormatLoad::runBabel(const QString& program)
 {
-  formatList.clear();
-
   QProcess babel;
-  babel.start(QApplication::applicationDirPath() + "/gpsbabel", QStringList() << "-^3");
+  babel.start(program, QStringList() << "-^4");
   if (!babel.waitForStarted()) {
-    return false;
+    return QByteArray();
   }
   babel.closeWriteChannel();
   if (!babel.waitForFinished()) {
-    return false;
+    return QByteArray();
   }
   if (babel.exitCode() != 0) {
-    return false;
+    return QByteArray();
+  }
+  return babel.readAll();
+}
+
+#ifndef GENERATE_CORE_STRINGS
+//------------------------------------------------------------------------
+// The catalog is cached together with what it was made by: the build of
+// gpsbabel, which must be the one this program was built with, and the
+// size and time of the executable, so that a replaced gpsbabel of the
+// same build is asked again.
+QJsonObject FormatLoad::cacheKey(const QString& program)
+{
+  QFileInfo info(program);
+  if (!info.exists()) {
+    info.setFile(program + ".exe");
+  }
+  if (!info.exists()) {
+    return QJsonObject();
   }
+  return QJsonObject{
+    {"gpsbabel", VERSION},
+    {"build", kVersionSHA},
+    {"path", info.absoluteFilePath()},
+    {"size", QString::number(info.size())},
+    {"modified", QString::number(info.lastModified().toMSecsSinceEpoch())}
+  };
+}
 
-  QTextStream tstream(babel.readAll());
-  QList<int>lineList;
-  int k=0;
-  while (!tstream.atEnd()) {
-    QString l = tstream.readLine();
-    k++;
-    if (!l.trimmed().isEmpty()) {
-      lines_ << l;
-      lineList<<k;
+//------------------------------------------------------------------------
+QString FormatLoad::cacheFileName()
+{
+  QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+  if (dir.isEmpty()) {
+    return QString();
+  }
+  return dir + "/formats.json";
+}
+#endif
+
+//------------------------------------------------------------------------
+bool FormatLoad::getFormats(QList<FormatInfo>& formatList)
+{
+  formatList.clear();
+
+  QString program = QApplication::applicationDirPath() + "/gpsbabel";
+  QJsonObject catalog;
+
+#ifndef GENERATE_CORE_STRINGS
+  QJsonObject key = cacheKey(program);
+  QString cacheName = cacheFileName();
+  if (!key.isEmpty() && !cacheName.isEmpty()) {
+    QFile cache(cacheName);
+    if (cache.open(QIODevice::ReadOnly)) {
+      QJsonObject cached = QJsonDocument::fromJson(cache.readAll()).object();
+      if (cached.value("key").toObject() == key) {
+        catalog = cached.value("catalog").toObject();
+      }
     }
   }
-  currentLine_ = 0;
+#endif
+
+  if (catalog.isEmpty()) {
+    QByteArray output = runBabel(program);
+    if (output.isEmpty()) {
+      return false;
+    }
+    catalog = QJsonDocument::fromJson(output).object();
+#ifndef GENERATE_CORE_STRINGS
+    // gpsbabel of another build still works, it just isn't cached.
+    if (!key.isEmpty() && !cacheName.isEmpty() &&
+        catalog.value("gpsbabel") == key.value("gpsbabel") &&
+        catalog.value("build") == key.value("build")) {
+      QDir().mkpath(QFileInfo(cacheName).path());
+      QFile cache(cacheName);
+      if (cache.open(QIODevice::WriteOnly)) {
+        QJsonObject cached{{"key", key}, {"catalog", catalog}};
+        cache.write(QJsonDocument(cached).toJson(QJsonDocument::Compact));
+      }
+    }
+#endif
+  }
+
+  if (catalog.value("version").toInt() != kCatalogVersion) {
+    QMessageBox::information
+    (nullptr, appName,
+     QObject::tr("Unknown format catalog from running process \"gpsbabel -^4\""));
+    return false;
+  }
 
-  for (bool dataPresent = skipToValidLine(); dataPresent; dataPresent=skipToValidLine()) {
-    Format format;
-    if (!processFormat(format)) {
+  const QJsonArray formats = catalog.value("formats").toArray();
+  for (int i = 0; i < formats.size(); ++i) {
+    FormatInfo format;
+    if (!processFormat(formats.at(i).toObject(), format)) {
       QMessageBox::information
       (nullptr, appName,
-       QObject::tr("Error processing formats from running process \"gpsbabel -^3\" at line %1").arg(lineList[currentLine_]));
+       QObject::tr("Error processing formats from running process \"gpsbabel -^4\" at format %1").arg(i + 1));
     } else {
       formatList << format;
     }
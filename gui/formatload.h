@@ -25,30 +25,40 @@
 #ifndef FORMATLOAD_H
 #define FORMATLOAD_H
 
+#include <QByteArray>          // for QByteArray
+#include <QJsonObject>         // for QJsonObject
 #include <QList>               // for QList
+#include <QString>             // for QString
 #include <QStringList>         // for QStringList
 
-#include "format.h"            // for Format
+#include "format.h"            // for FormatInfo
 
+/*
+ * Loads the formats from the catalog printed by "gpsbabel -^4", which is
+ * cached so that later starts need not run gpsbabel.
+ */
 class FormatLoad
 {
 public:
 
   /* Member Functions */
 
-  bool getFormats(QList<Format>& formatList);
+  bool getFormats(QList<FormatInfo>& formatList);
 
 private:
 
-  /* Member Functions */
+  /* Constants */
 
-  bool skipToValidLine();
-  bool processFormat(Format& format);
+  static constexpr int kCatalogVersion = 1;
 
-  /* Data Members */
+  /* Member Functions */
 
-  QStringList lines_;
-  int currentLine_{0};
+  static QByteArray runBabel(const QString& program);
+#ifndef GENERATE_CORE_STRINGS
+  static QJsonObject cacheKey(const QString& program);
+  static QString cacheFileName();
+#endif
+  bool processFormat(const QJsonObject& object, FormatInfo& format);
 };
 
 #endif
@@ -34,7 +34,7 @@ class GMapDialog: public QDialog
 {
   Q_OBJECT
 public:
-  GMapDialog(QWidget* parent, const QString& gpxFileName, QPlainTextEdit* te);
+  GMapDialog(QWidget* parent, const Gpx& gpx, QPlainTextEdit* te);
 
 private:
   Ui_GMapDlg ui_;
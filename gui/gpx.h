@@ -26,6 +26,7 @@
 #include <QDateTime>             // for QDateTime
 #include <QList>                 // for QList
 #include <QString>               // for QString
+#include <QStringList>           // for QStringList
 #include <QtGlobal>              // for foreach
 #include "latlng.h"              // for LatLng
 
@@ -455,6 +456,13 @@ class Gpx
 public:
   Gpx() {}
   bool read(const QString& fileName);
+#ifdef HAVE_LIBGPSBABEL
+  // Read and filter the files with libgpsbabel instead of reading its
+  // GPX output, see gpxconvert.cc.
+  bool convert(const QStringList& fileNames, const QString& format,
+               const QStringList& filters, bool withWaypoints,
+               bool withTracks, bool withRoutes, QString& errorString);
+#endif
 
   QList <GpxWaypoint>& getWaypoints()
   {
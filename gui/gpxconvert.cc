@@ -0,0 +1,133 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+// The preview read in process by libgpsbabel.  This is the only file of
+// the GUI that sees gpsbabel's own data structures.
+
+#include <QDateTime>             // for QDateTime
+#include <QList>                 // for QList
+#include <QString>               // for QString
+#include <QStringList>           // for QStringList
+
+#include "gpx.h"                 // for Gpx, GpxWaypoint, GpxTrack, GpxTrackSegment, GpxTrackPoint, GpxRoute, GpxRoutePoint
+#include "latlng.h"              // for LatLng
+#include "defs.h"                // for Waypoint, route_head, waypt_range, route_range, track_range, unknown_alt
+#include "libgpsbabel.h"         // for visit, FatalError
+
+
+static GpxWaypoint makeWaypoint(const Waypoint* wpt)
+{
+  // Fill in what the gpx writer would have written for the GPX reader.
+  GpxWaypoint gwpt;
+  gwpt.setLocation(LatLng(wpt->latitude, wpt->longitude));
+  if (wpt->altitude != unknown_alt) {
+    gwpt.setElevation(wpt->altitude);
+  }
+  gwpt.setName(wpt->shortname);
+  gwpt.setComment(wpt->description);
+  gwpt.setDescription(wpt->notes.isEmpty() ? wpt->description : wpt->notes);
+  gwpt.setSymbol(wpt->icon_descr);
+  return gwpt;
+}
+
+static GpxTrack makeTrack(const route_head* trk)
+{
+  GpxTrack gtrk;
+  gtrk.setName(trk->rte_name);
+  gtrk.setNumber(trk->rte_num);
+  GpxTrackSegment seg;
+  for (const Waypoint* wpt : trk->waypoint_list) {
+    if (wpt->wpt_flags.new_trkseg && !seg.getTrackPoints().isEmpty()) {
+      gtrk.addSegment(seg);
+      seg.clear();
+    }
+    GpxTrackPoint pt;
+    pt.setLocation(LatLng(wpt->latitude, wpt->longitude));
+    if (wpt->altitude != unknown_alt) {
+      pt.setElevation(wpt->altitude);
+    }
+    if (wpt->GetCreationTime().isValid()) {
+      pt.setDateTime(wpt->GetCreationTime().toUTC());
+    }
+    seg.addPoint(pt);
+  }
+  if (!seg.getTrackPoints().isEmpty()) {
+    gtrk.addSegment(seg);
+  }
+  return gtrk;
+}
+
+static GpxRoute makeRoute(const route_head* rte)
+{
+  GpxRoute grte;
+  grte.setName(rte->rte_name);
+  for (const Waypoint* wpt : rte->waypoint_list) {
+    GpxRoutePoint pt;
+    pt.setLocation(LatLng(wpt->latitude, wpt->longitude));
+    pt.setName(wpt->shortname);
+    grte.addPoint(pt);
+  }
+  return grte;
+}
+
+//------------------------------------------------------------------------
+
+bool Gpx::convert(const QStringList& fileNames, const QString& format,
+                  const QStringList& filters, bool withWaypoints,
+                  bool withTracks, bool withRoutes, QString& errorString)
+{
+  QList<GpxWaypoint> wptList;
+  QList<GpxTrack> trkList;
+  QList<GpxRoute> rteList;
+
+  auto collect = [&]() {
+    if (withWaypoints) {
+      for (const Waypoint* wpt : waypt_range()) {
+        wptList << makeWaypoint(wpt);
+      }
+    }
+    if (withTracks) {
+      for (const route_head* trk : track_range()) {
+        // Like Gpx::read, leave out tracks with one point or none.
+        if (trk->rte_waypt_ct() > 1) {
+          trkList << makeTrack(trk);
+        }
+      }
+    }
+    if (withRoutes) {
+      for (const route_head* rte : route_range()) {
+        if (rte->rte_waypt_ct() >= 2) {
+          rteList << makeRoute(rte);
+        }
+      }
+    }
+  };
+
+  try {
+    gpsbabel::visit(fileNames, format, filters, collect);
+  } catch (const FatalError& e) {
+    errorString = e.what();
+    return false;
+  }
+
+  wayPoints = wptList;
+  tracks = trkList;
+  routes = rteList;
+  return true;
+}
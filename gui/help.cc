@@ -27,7 +27,7 @@
 #include <QUrl>                       // for QUrl
 #include <QDesktopServices>           // for QDesktopServices
 
-#include "format.h"                   // for Format
+#include "format.h"                   // for FormatInfo
 
 //------------------------------------------------------------------------
 void ShowHelp(const QString& urlIn)
@@ -36,7 +36,7 @@ void ShowHelp(const QString& urlIn)
   QString url = urlIn;
   static const QRegularExpression re(R"(^https?://)");
   if (!url.contains(re)) {
-    url = Format::getHtmlBase() + url;
+    url = FormatInfo::getHtmlBase() + url;
   }
   QDesktopServices::openUrl(QUrl(url));
 }
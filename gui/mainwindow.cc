@@ -68,6 +68,7 @@
 #include "formatload.h"                // for FormatLoad
 #ifndef DISABLE_MAPPREVIEW
 #include "gmapdlg.h"                   // for GMapDialog
+#include "gpx.h"                       // for Gpx
 #endif
 #include "help.h"                      // for ShowHelp
 #include "optionsdlg.h"                // for OptionsDlg
@@ -665,8 +666,8 @@ void MainWindow::crossCheckInOutFormats()
     // During format/device switch this is true
     return;
   }
-  Format ifmt = formatList_[currentComboFormatIndex(ui_.inputFormatCombo)];
-  Format ofmt = formatList_[currentComboFormatIndex(ui_.outputFormatCombo)];
+  FormatInfo ifmt = formatList_[currentComboFormatIndex(ui_.inputFormatCombo)];
+  FormatInfo ofmt = formatList_[currentComboFormatIndex(ui_.outputFormatCombo)];
 
   ui_.xlateWayPtsCk->setEnabled(ifmt.isReadWaypoints() && ofmt.isWriteWaypoints());
   ui_.xlateTracksCk->setEnabled(ifmt.isReadTracks()    && ofmt.isWriteTracks());
@@ -889,16 +890,19 @@ void MainWindow::applyActionX()
     args << "-s";
   }
 
-  Format ifmt = formatList_[currentComboFormatIndex(ui_.inputFormatCombo)];
-  Format ofmt = formatList_[currentComboFormatIndex(ui_.outputFormatCombo)];
+  FormatInfo ifmt = formatList_[currentComboFormatIndex(ui_.inputFormatCombo)];
+  FormatInfo ofmt = formatList_[currentComboFormatIndex(ui_.outputFormatCombo)];
 
-  if (babelData_.xlateWayPts_ && ifmt.isReadWaypoints() && ofmt.isWriteWaypoints()) {
+  bool xlateWayPts = babelData_.xlateWayPts_ && ifmt.isReadWaypoints() && ofmt.isWriteWaypoints();
+  bool xlateRoutes = babelData_.xlateRoutes_ && ifmt.isReadRoutes()    && ofmt.isWriteRoutes();
+  bool xlateTracks = babelData_.xlateTracks_ && ifmt.isReadTracks()    && ofmt.isWriteTracks();
+  if (xlateWayPts) {
     args << "-w";
   }
-  if (babelData_.xlateRoutes_ && ifmt.isReadRoutes()    && ofmt.isWriteRoutes()) {
+  if (xlateRoutes) {
     args << "-r";
   }
-  if (babelData_.xlateTracks_ && ifmt.isReadTracks()    && ofmt.isWriteTracks()) {
+  if (xlateTracks) {
     args << "-t";
   }
 
@@ -906,8 +910,9 @@ void MainWindow::applyActionX()
   bool iisFile = (babelData_.inputType_ == BabelData::fileType_);
   int fidx = formatIndexFromName(iisFile, iisFile ?
                                  babelData_.inputFileFormat_ : babelData_.inputDeviceFormat_);
+  QString inputSpec = formatList_[fidx].getName() + MakeOptions(formatList_[fidx].getInputOptions());
   args << "-i";
-  args << (formatList_[fidx].getName() + MakeOptions(formatList_[fidx].getInputOptions()));
+  args << inputSpec;
 
   // Input file(s) or device
   int read_use_count = 0;
@@ -945,10 +950,17 @@ void MainWindow::applyActionX()
     formatList_[fidx].bumpWriteUseCount(1);
   }
 
+  bool previewInProcess = false;
 #ifndef DISABLE_MAPPREVIEW
   // Now output for preview in google maps
   QString tempName;
-  if (babelData_.previewGmap_) {
+#ifdef HAVE_LIBGPSBABEL
+  // libgpsbabel reads input files once more for the preview, which
+  // saves writing it as GPX and reading that back.  Devices can only
+  // be read once.
+  previewInProcess = babelData_.previewGmap_ && iisFile;
+#endif
+  if (babelData_.previewGmap_ && !previewInProcess) {
     QTemporaryFile ftemp;
     ftemp.open();
     tempName = ftemp.fileName();
@@ -963,6 +975,7 @@ void MainWindow::applyActionX()
     args << "gpx";
     args << "-F" << tempName;
   }
+  Gpx previewGpx;
 #endif
 
   ui_.outputWindow->clear();
@@ -971,7 +984,19 @@ void MainWindow::applyActionX()
   QString errorString;
   QString outputString;
   QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-  bool x = runGpsbabel(args, errorString, outputString);
+  bool x = true;
+  // A preview without output needs no gpsbabel process at all.
+  if (!previewInProcess || babelData_.outputType_ != BabelData::noType_) {
+    x = runGpsbabel(args, errorString, outputString);
+  }
+#ifdef HAVE_LIBGPSBABEL
+  if (x && previewInProcess) {
+    QStringList filters = filterData_.getAllFilterStrings();
+    filters.removeAll("-x");
+    x = previewGpx.convert(babelData_.inputFileNames_, inputSpec, filters,
+                           xlateWayPts, xlateTracks, xlateRoutes, errorString);
+  }
+#endif
   QApplication::restoreOverrideCursor();
 
   ui_.outputWindow->appendPlainText(outputString);
@@ -979,11 +1004,14 @@ void MainWindow::applyActionX()
     ui_.outputWindow->appendPlainText(tr("Translation successful"));
 #ifndef DISABLE_MAPPREVIEW
     if (babelData_.previewGmap_) {
+      if (!previewInProcess) {
+        previewGpx.read(tempName);
+        QFile(tempName).remove();
+      }
       this->hide();
-      GMapDialog dlg(nullptr, tempName, babelData_.debugLevel_ >=1 ? ui_.outputWindow : nullptr);
+      GMapDialog dlg(nullptr, previewGpx, babelData_.debugLevel_ >=1 ? ui_.outputWindow : nullptr);
       dlg.show();
       dlg.exec();
-      QFile(tempName).remove();
       this->show();
     }
 #endif
@@ -41,7 +41,7 @@
 
 #include "babeldata.h"            // for BabelData
 #include "filterdata.h"           // for AllFiltersData
-#include "format.h"               // for Format
+#include "format.h"               // for FormatInfo
 #include "ui_mainwinui.h"         // for Ui_MainWindow
 #include "upgrade.h"              // for UpgradeCheck
 
@@ -57,7 +57,7 @@ public:
 
 private:
   Ui_MainWindow     ui_;
-  QList<Format>  formatList_;
+  QList<FormatInfo>  formatList_;
   QString        babelVersion_;
   bool		 isBeta_;
   QPixmap        lights_[4];
@@ -26,6 +26,7 @@
 #include <QChar>                  // for QChar, operator!=
 #include <QCursor>                // for QCursor
 #include <QFile>                  // for QFile
+#include <QHash>                  // for QHash
 #include <QIODevice>              // for QIODevice, operator|, QIODevice::ReadOnly, QIODevice::Truncate, QIODevice::WriteOnly
 #include <QLatin1String>          // for QLatin1String
 #include <QMessageBox>            // for QMessageBox
@@ -39,11 +40,15 @@
 #include <Qt>                     // for WaitCursor
 #include <QtGlobal>               // for foreach
 
-#include <algorithm>              // for max
+#include <algorithm>              // for max, min
+#include <cmath>                  // for floor, fmod, log, sin
+#include <numbers>                // for pi
 #include <string>                 // for string
+#include <utility>                // for as_const
 #include <vector>                 // for vector
 
 #include "appname.h"              // for appName
+#include "dpencode.h"             // for PolylineEncoder
 #include "gpx.h"                  // for GpxRoute, GpxTrack, GpxWaypoint, Gpx, GpxRoutePoint, GpxTrackPoint, GpxTrackSegment
 #include "latlng.h"               // for LatLng
 
@@ -51,6 +56,17 @@
 using std::string;
 using std::vector;
 
+// The levels given by PolylineEncoder.  A point of level l is needed
+// from zoom level kLevels - 2 - l on, where a pixel is about as many
+// degrees as the point is away from the simplified line.
+static constexpr int kLevels = 19;
+// Outside the view lines are drawn this many zoom levels coarser.
+static constexpr int kCoarserOutside = 4;
+// Up to this zoom level waypoints closer than kClusterPixels on the
+// screen are drawn as one marker.
+static constexpr int kMaxClusterZoom = 13;
+static constexpr int kClusterPixels = 48;
+
 //------------------------------------------------------------------------
 static QString stripDoubleQuotes(const QString& s)
 {
@@ -86,6 +102,7 @@ Map::Map(QWidget* parent,
   connect(mclicker, &MarkerClicker::loadFinished, this, &Map::loadFinishedX);
   connect(mclicker, &MarkerClicker::markerClicked, this, &Map::markerClicked);
   connect(mclicker, &MarkerClicker::logTime, this, &Map::logTime);
+  connect(mclicker, &MarkerClicker::viewChanged, this, &Map::viewChanged);
 
   // We search the following locations:
   // 1. In the file system in the same directory as the executable.
@@ -198,29 +215,24 @@ static QString fmtLatLng(const LatLng& l)
 }
 
 //------------------------------------------------------------------------
-static QString makePath(const vector <LatLng>& pts)
+static QString fmtBounds(const vector <LatLng>& pts)
 {
-  // maps v3 Polylines do not use encoded paths.
-  QString path;
-  int lncount = 0;
-  bool someoutput = false;
+  double south = pts.front().lat();
+  double north = south;
+  double west = pts.front().lng();
+  double east = west;
   for (const auto& ll : pts) {
-    if (lncount == 0) {
-      if (someoutput) {
-        path.append(QChar(','));
-      }
-      path.append(QLatin1String("\n            "));
-    } else if (lncount == 1) {
-      path.append(QLatin1String(", "));
-    }
-    path.append(fmtLatLng(ll));
-    someoutput = true;
-    lncount = (lncount + 1) % 2;
+    south = std::min(south, ll.lat());
+    north = std::max(north, ll.lat());
+    west = std::min(west, ll.lng());
+    east = std::max(east, ll.lng());
   }
-  return path;
+  return QString("new google.maps.LatLngBounds(%1, %2)")
+         .arg(fmtLatLng(LatLng(south, west)), fmtLatLng(LatLng(north, east)));
 }
 
 //------------------------------------------------------------------------
+// The lines are only sent as the map asks for them, see viewChanged().
 void Map::showGpxData()
 {
   this->logTime("Start defining JS string");
@@ -237,15 +249,18 @@ void Map::showGpxData()
       ;
 
   mapPresent_ = true;
+  PolylineEncoder encoder(kLevels);
 
-  // Waypoints.
+  // Waypoints, which are put on the map by showWaypointDetail().
   int num=0;
+  waypointVisible_.clear();
   foreach (const  GpxWaypoint& pt, gpx_.getWaypoints()) {
     scriptStr
-        << QString("waypts[%1] = new google.maps.Marker({map: map, position: %2, "
+        << QString("waypts[%1] = new google.maps.Marker({position: %2, "
                    "title: \"%3\", icon: blueIcon});")
         .arg(num)
         .arg(fmtLatLng(pt.getLocation()), stripDoubleQuotes(pt.getName()));
+    waypointVisible_.append(pt.getVisible());
     num++;
   }
 
@@ -259,26 +274,30 @@ void Map::showGpxData()
 
   // Tracks
   num = 0;
+  trackLod_.clear();
   foreach (const GpxTrack& trk, gpx_.getTracks()) {
-    vector <LatLng> pts;
+    LodPath lod;
     foreach (const GpxTrackSegment seg, trk.getTrackSegments()) {
       foreach (const GpxTrackPoint pt, seg.getTrackPoints()) {
-        pts.push_back(pt.getLocation());
+        lod.points.push_back(pt.getLocation());
       }
     }
-    QString path = makePath(pts);
+    encoder.dpLevels(lod.levels, lod.points);
+    const vector <LatLng>& pts = lod.points;
 
     scriptStr
         << QString("trks[%1] = new RTPolyline(\n"
                    "    map,\n"
-                   "    new google.maps.Polyline({\n        map: map,\n        strokeColor: \"#0000E0\",\n        strokeWeight: 2,\n        strokeOpacity: 0.6,\n        path: [%2\n        ]\n    }),\n"
+                   "    new google.maps.Polyline({\n        map: map,\n        strokeColor: \"#0000E0\",\n        strokeWeight: 2,\n        strokeOpacity: 0.6\n    }),\n"
+                   "    new google.maps.LatLng(%2),\n"
                    "    new google.maps.LatLng(%3),\n"
-                   "    new google.maps.LatLng(%4),\n"
-                   "    \"%5\",\n"
-                   "    new MarkerHandler(1, %1)\n);"
-                  ).arg(num).arg(path, fmtLatLng(pts.front()), fmtLatLng(pts.back()), stripDoubleQuotes(trk.getName()))
+                   "    \"%4\",\n"
+                   "    new MarkerHandler(1, %1),\n"
+                   "    %5\n);"
+                  ).arg(num).arg(fmtLatLng(pts.front()), fmtLatLng(pts.back()), stripDoubleQuotes(trk.getName()), fmtBounds(pts))
         << QString("bounds.union(trks[%1].getBounds());").arg(num)
         ;
+    trackLod_.append(lod);
     num++;
   }
 
@@ -288,24 +307,28 @@ void Map::showGpxData()
 
   // Routes
   num = 0;
+  routeLod_.clear();
   foreach (const GpxRoute& rte, gpx_.getRoutes()) {
-    vector <LatLng> pts;
+    LodPath lod;
     foreach (const GpxRoutePoint& pt, rte.getRoutePoints()) {
-      pts.push_back(pt.getLocation());
+      lod.points.push_back(pt.getLocation());
     }
-    QString path = makePath(pts);
+    encoder.dpLevels(lod.levels, lod.points);
+    const vector <LatLng>& pts = lod.points;
 
     scriptStr
         << QString("rtes[%1] = new RTPolyline(\n"
                    "    map,\n"
-                   "    new google.maps.Polyline({\n        map: map,\n        strokeColor: \"#8000B0\",\n        strokeWeight: 2,\n        strokeOpacity: 0.6,\n        path: [%2\n        ]\n    }),\n"
+                   "    new google.maps.Polyline({\n        map: map,\n        strokeColor: \"#8000B0\",\n        strokeWeight: 2,\n        strokeOpacity: 0.6\n    }),\n"
+                   "    new google.maps.LatLng(%2),\n"
                    "    new google.maps.LatLng(%3),\n"
-                   "    new google.maps.LatLng(%4),\n"
-                   "    \"%5\",\n"
-                   "    new MarkerHandler(2, %1)\n);"
-                  ).arg(num).arg(path, fmtLatLng(pts.front()), fmtLatLng(pts.back()), stripDoubleQuotes(rte.getName()))
+                   "    \"%4\",\n"
+                   "    new MarkerHandler(2, %1),\n"
+                   "    %5\n);"
+                  ).arg(num).arg(fmtLatLng(pts.front()), fmtLatLng(pts.back()), stripDoubleQuotes(rte.getName()), fmtBounds(pts))
         << QString("bounds.union(rtes[%1].getBounds());").arg(num)
         ;
+    routeLod_.append(lod);
     num++;
   }
 
@@ -316,14 +339,150 @@ void Map::showGpxData()
   scriptStr
       << "map.setCenter(bounds.getCenter());"
       << "map.fitBounds(bounds);"
+      << "map.addListener(\"idle\", reportView);"
       << "mclicker.logTimeX(\"Done setCenter\");"
       ;
 
   this->logTime("Done defining JS string");
+  view_ = Viewport();
   evaluateJS(scriptStr);
   this->logTime("Done JS evaluation");
 }
 
+//------------------------------------------------------------------------
+bool Map::Viewport::contains(const LatLng& pt) const
+{
+  return (pt.lat() >= south) && (pt.lat() <= north) &&
+         (std::fmod(pt.lng() - west + 720.0, 360.0) <= width);
+}
+
+//------------------------------------------------------------------------
+// Called by the map whenever it comes to rest after a pan or zoom.
+void Map::viewChanged(int zoom, double south, double west, double north, double east)
+{
+  const double height = north - south;
+  double width = east - west;
+  if (width < 0) {
+    width += 360.0;
+  }
+  view_.zoom = zoom;
+  view_.south = std::max(-90.0, south - height / 2);
+  view_.north = std::min(90.0, north + height / 2);
+  view_.west = west - width / 2;
+  view_.width = std::min(360.0, 2 * width);
+  showDetail();
+}
+
+//------------------------------------------------------------------------
+// The points of a path as needed for the view: those the zoom level
+// needs within it, and a coarser line outside it.
+QString Map::detailPath(const LodPath& path) const
+{
+  const int fine = std::max(0, kLevels - 2 - view_.zoom);
+  const int coarse = std::min(kLevels - 1, fine + kCoarserOutside);
+
+  vector <int> candidates;
+  vector <bool> inside;
+  for (unsigned int i = 0; i < path.points.size(); i++) {
+    if (path.levels[i] >= fine) {
+      candidates.push_back(i);
+      inside.push_back(view_.contains(path.points[i]));
+    }
+  }
+
+  // The points next to those inside keep the lines leaving the view.
+  vector <LatLng> pts;
+  for (unsigned int c = 0; c < candidates.size(); c++) {
+    if (inside[c] || (path.levels[candidates[c]] >= coarse) ||
+        (c > 0 && inside[c-1]) || (c + 1 < candidates.size() && inside[c+1])) {
+      pts.push_back(path.points[candidates[c]]);
+    }
+  }
+
+  string enc;
+  PolylineEncoder::encodePoints(enc, pts);
+  return QString::fromStdString(enc).replace(QChar('\\'), QLatin1String("\\\\"));
+}
+
+//------------------------------------------------------------------------
+// The visible waypoints in the view, those that are close together at
+// low zoom levels as clusters.
+QString Map::waypointDetail() const
+{
+  struct Cluster {
+    QList<int> members;
+    double latSum{0};
+    double lngSum{0};
+    double south{90};
+    double north{-90};
+    double west{180};
+    double east{-180};
+  };
+
+  const QList<GpxWaypoint>& waypoints = gpx_.getWaypoints();
+  const double worldPixels = 256.0 * (1 << std::max(0, std::min(view_.zoom, 30)));
+  QHash<quint64, Cluster> cells;
+  QList<quint64> order;
+  for (int i = 0; i < waypoints.size() && i < waypointVisible_.size(); i++) {
+    const LatLng& ll = waypoints.at(i).getLocation();
+    if (!waypointVisible_.at(i) || !view_.contains(ll)) {
+      continue;
+    }
+    quint64 key = i;
+    if (view_.zoom <= kMaxClusterZoom) {
+      // Web Mercator pixel coordinates.
+      const double siny = std::min(std::max(std::sin(ll.lat() * std::numbers::pi / 180.0), -0.9999), 0.9999);
+      const double x = (ll.lng() + 180.0) / 360.0 * worldPixels;
+      const double y = (0.5 - std::log((1 + siny) / (1 - siny)) / (4 * std::numbers::pi)) * worldPixels;
+      key = (quint64(std::floor(x / kClusterPixels)) << 32) | quint64(std::floor(y / kClusterPixels));
+    }
+    if (!cells.contains(key)) {
+      order.append(key);
+    }
+    Cluster& cell = cells[key];
+    cell.members.append(i);
+    cell.latSum += ll.lat();
+    cell.lngSum += ll.lng();
+    cell.south = std::min(cell.south, ll.lat());
+    cell.north = std::max(cell.north, ll.lat());
+    cell.west = std::min(cell.west, ll.lng());
+    cell.east = std::max(cell.east, ll.lng());
+  }
+
+  QStringList shown;
+  QStringList clusters;
+  for (quint64 key : std::as_const(order)) {
+    const Cluster& cell = cells[key];
+    if (cell.members.size() == 1) {
+      shown << QString::number(cell.members.front());
+    } else {
+      const int n = cell.members.size();
+      clusters << QString("[%1, %2, %3, %4, %5, %6, %7]")
+               .arg(cell.latSum / n, 0, 'f', 5).arg(cell.lngSum / n, 0, 'f', 5).arg(n)
+               .arg(cell.south, 0, 'f', 5).arg(cell.west, 0, 'f', 5)
+               .arg(cell.north, 0, 'f', 5).arg(cell.east, 0, 'f', 5);
+    }
+  }
+  return QString("showWaypointDetail([%1], [%2]);").arg(shown.join(','), clusters.join(','));
+}
+
+//------------------------------------------------------------------------
+void Map::showDetail()
+{
+  if (view_.zoom < 0) {
+    return;
+  }
+  QStringList scriptStr;
+  for (int i = 0; i < trackLod_.size(); i++) {
+    scriptStr << QString("trks[%1].setEncodedPath(\"%2\");").arg(i).arg(detailPath(trackLod_.at(i)));
+  }
+  for (int i = 0; i < routeLod_.size(); i++) {
+    scriptStr << QString("rtes[%1].setEncodedPath(\"%2\");").arg(i).arg(detailPath(routeLod_.at(i)));
+  }
+  scriptStr << waypointDetail();
+  evaluateJS(scriptStr);
+}
+
 //------------------------------------------------------------------------
 void Map::markerClicked(int t, int i)
 {
@@ -377,7 +536,14 @@ void Map::showWaypoints(const QList<GpxWaypoint>& waypoints)
   QStringList scriptStr;
   int i=0;
   foreach (const GpxWaypoint& pt, waypoints) {
-    scriptStr << QString("waypts[%1].setVisible(%2);").arg(i++).arg(pt.getVisible()?"true":"false");
+    scriptStr << QString("waypts[%1].setVisible(%2);").arg(i).arg(pt.getVisible()?"true":"false");
+    if (i < waypointVisible_.size()) {
+      waypointVisible_[i] = pt.getVisible();
+    }
+    i++;
+  }
+  if (view_.zoom >= 0) {
+    scriptStr << waypointDetail();
   }
   evaluateJS(scriptStr);
 }
@@ -390,6 +556,10 @@ void Map::hideAllWaypoints()
       << "    waypts[idx].setVisible(false);"
       << "}"
       ;
+  waypointVisible_.fill(false);
+  if (view_.zoom >= 0) {
+    scriptStr << waypointDetail();
+  }
   evaluateJS(scriptStr);
 }
 
@@ -418,8 +588,15 @@ void Map::hideAllRoutes()
 //------------------------------------------------------------------------
 void Map::setWaypointVisibility(int i, bool show)
 {
-  evaluateJS(QString("waypts[%1].setVisible(%2);")
-             .arg(i).arg(show?"true": "false"));
+  QStringList scriptStr;
+  scriptStr << QString("waypts[%1].setVisible(%2);").arg(i).arg(show?"true": "false");
+  if (i < waypointVisible_.size()) {
+    waypointVisible_[i] = show;
+  }
+  if (view_.zoom >= 0) {
+    scriptStr << waypointDetail();
+  }
+  evaluateJS(scriptStr);
 }
 
 //------------------------------------------------------------------------
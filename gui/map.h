@@ -37,6 +37,8 @@
 #include <QWebEngineView>         // for QWebEngineView
 #include <QWidget>                // for QWidget
 
+#include <vector>                 // for vector
+
 #include "gpx.h"                  // for Gpx, GpxRoute, GpxTrack, GpxWaypoint
 #include "latlng.h"               // for LatLng
 
@@ -64,11 +66,16 @@ public slots:
   {
     emit loadFinished(true);
   }
+  void viewChangedX(int zoom, double south, double west, double north, double east)
+  {
+    emit viewChanged(zoom, south, west, north, east);
+  }
 
 signals:
   void markerClicked(int t, int i);
   void logTime(const QString& s);
   void loadFinished(bool b);
+  void viewChanged(int zoom, double south, double west, double north, double east);
 };
 
 
@@ -105,10 +112,30 @@ public slots:
   void frameRoute(int i);
 
   void logTime(const QString&);
+  void viewChanged(int zoom, double south, double west, double north, double east);
 
 private:
+  // A track or route with the Douglas-Peucker level of each point.
+  struct LodPath {
+    std::vector<LatLng> points;
+    std::vector<int> levels;
+  };
+
+  // What the map shows, widened by half its size on every side.
+  struct Viewport {
+    int zoom{-1};
+    double south{0};
+    double north{0};
+    double west{0};
+    double width{0};
+    bool contains(const LatLng& pt) const;
+  };
+
   QByteArray encodeKey(const QByteArray& key);
   QByteArray decodeKey(const QByteArray& key);
+  QString detailPath(const LodPath& path) const;
+  QString waypointDetail() const;
+  void showDetail();
 
 signals:
   void waypointClicked(int i);
@@ -126,6 +153,10 @@ private:
   bool busyCursor_;
   QElapsedTimer stopWatch_;
   QPlainTextEdit* textEdit_;
+  QList<LodPath> trackLod_;
+  QList<LodPath> routeLod_;
+  QList<bool> waypointVisible_;
+  Viewport view_;
 
   void evaluateJS(const QString& s, bool update = true);
   void evaluateJS(const QStringList& s, bool update = true);
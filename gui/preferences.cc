@@ -22,7 +22,7 @@
 class FormatListEntry : public QListWidgetItem
 {
 public:
-  FormatListEntry(Format& fmt) /* : fmt_(fmt) */
+  FormatListEntry(FormatInfo& fmt) /* : fmt_(fmt) */
   {
     setText(fmt.getDescription());
     bool enabled = !fmt.isHidden();
@@ -30,10 +30,10 @@ public:
   }
 
 private:
-  //Format& fmt_;
+  //FormatInfo& fmt_;
 };
 
-Preferences::Preferences(QWidget* parent, QList<Format>& formatList,
+Preferences::Preferences(QWidget* parent, QList<FormatInfo>& formatList,
                          BabelData& bd) : QDialog(parent),
   formatList_(formatList),
   babelData_(bd)
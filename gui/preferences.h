@@ -29,10 +29,10 @@ class Preferences : public QDialog
   Q_OBJECT
 
 public:
-  Preferences(QWidget* parent, QList<Format>& formatList, BabelData& bd);
+  Preferences(QWidget* parent, QList<FormatInfo>& formatList, BabelData& bd);
 
 private:
-  QList<Format>& formatList_;
+  QList<FormatInfo>& formatList_;
   Ui_Preferences ui_;
   BabelData& babelData_;
 
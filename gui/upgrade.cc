@@ -41,7 +41,7 @@
 #include <QtGlobal>               // for qDebug, qsizetype, QT_VERSION, QT_VERSION_CHECK
 
 #include "babeldata.h"            // for BabelData
-#include "format.h"               // for Format
+#include "format.h"               // for FormatInfo
 #include "gbversion.h"            // for VERSION
 
 
@@ -51,7 +51,7 @@ static const bool testing = true;
 static const bool testing = false;
 #endif
 
-UpgradeCheck::UpgradeCheck(QWidget* parent, QList<Format>& formatList,
+UpgradeCheck::UpgradeCheck(QWidget* parent, QList<FormatInfo>& formatList,
                            BabelData& bd) :
   QObject(parent),
   manager_(nullptr),
@@ -28,14 +28,14 @@
 #include <QNetworkReply>                    // for QNetworkReply
 #include <QWidget>                          // for QWidget
 #include "babeldata.h"                      // for BabelData
-#include "format.h"                         // for Format
+#include "format.h"                         // for FormatInfo
 
 
 class UpgradeCheck : public QObject
 {
   Q_OBJECT
 public:
-  UpgradeCheck(QWidget* parent, QList<Format>& formatList, BabelData& bd);
+  UpgradeCheck(QWidget* parent, QList<FormatInfo>& formatList, BabelData& bd);
 
   enum updateStatus {
     updateUnknown,
@@ -57,7 +57,7 @@ private:
   QUrl upgradeUrl_;
   QString latestVersion_;
   QDateTime upgradeWarningTime_;  // invalid time if this object never issued.
-  QList<Format>& formatList_;
+  QList<FormatInfo>& formatList_;
   updateStatus updateStatus_;
   BabelData& babelData_;
 
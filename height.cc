@@ -24,9 +24,21 @@
 
 #include "defs.h"
 #include "height.h"
-#include <cmath>    // for floor
-#include <cstdint>  // for int8_t
-#include <cstdlib>  // for strtod
+#include <algorithm>  // for clamp, min, stable_sort
+#include <cmath>      // for floor, isfinite, isnan, nan, sqrt
+#include <cstdint>    // for int8_t
+#include <cstdlib>    // for abs, strtod
+#include <memory>     // for make_unique
+#include <utility>    // for as_const, move, pair
+#include <vector>     // for vector
+
+#include <QDir>       // for QDir
+#include <QFile>      // for QFile
+#include <QIODevice>  // for QIODevice::ReadOnly
+#include <QString>    // for QString, QLatin1Char
+#include <QVector>    // for QVector
+#include <QtEndian>   // for qFromBigEndian
+#include <QtGlobal>   // for qint16, qint64, qsizetype, qPrintable
 
 #define MYNAME "height"
 
@@ -79,6 +91,170 @@ double HeightFilter::wgs84_separation(double lat, double lon)
          );
 }
 
+/*
+ * Compute the geoid separations of n positions at once.  The loop has no
+ * calls or data dependent branches, so the compiler can vectorize it,
+ * using gathers for the table where the target has them.  Positions the
+ * checks of wgs84_separation would reject, and those on the last row or
+ * column of the grid, which need the degenerate cases of bilinear, get
+ * NaN and must be done one at a time.  All others are computed exactly
+ * as wgs84_separation does.
+ */
+void HeightFilter::wgs84_separations(const double* lat, const double* lon, double* sep, qsizetype n)
+{
+  for (qsizetype i = 0; i < n; ++i) {
+    const double y = lat[i];
+    const double x = lon[i];
+    const bool valid = (y >= -90.0) && (y <= 90.0) && (x >= -180.0) && (x <= 180.0);
+    const int ilat = valid ? static_cast<int>(floor((90.0+y)/geoid_grid_deg)) : 0;
+    const int ilon = valid ? static_cast<int>(floor((180.0+x)/geoid_grid_deg)) : 0;
+    const bool inner = valid && (ilat < geoid_row-1) && (ilon < geoid_col-1);
+
+    const int ilat1 = inner ? ilat : 0;
+    const int ilon1 = inner ? ilon : 0;
+    const int ilat2 = ilat1 + 1;
+    const int ilon2 = ilon1 + 1;
+
+    const double x1 = ilon1*geoid_grid_deg-180.0;
+    const double y1 = ilat1*geoid_grid_deg-90.0;
+    const double x2 = ilon2*geoid_grid_deg-180.0;
+    const double y2 = ilat2*geoid_grid_deg-90.0;
+    const double z11 = static_cast<double>(geoid_delta[ilat1][ilon1])/geoid_scale;
+    const double z12 = static_cast<double>(geoid_delta[ilat1][ilon2])/geoid_scale;
+    const double z21 = static_cast<double>(geoid_delta[ilat2][ilon1])/geoid_scale;
+    const double z22 = static_cast<double>(geoid_delta[ilat2][ilon2])/geoid_scale;
+
+    const double delta = (y2-y1)*(x2-x1);
+    const double value = (z22*(y-y1)*(x-x1)+z12*(y2-y)*(x-x1)+z21*(y-y1)*(x2-x)+z11*(y2-y)*(x2-x))/delta;
+    sep[i] = inner ? value : std::nan("");
+  }
+}
+
+/* correct the points of list, whose positions are also given as columns */
+void HeightFilter::correct_heights(const WaypointList& list, const QVector<double>& lat, const QVector<double>& lon)
+{
+  std::vector<double> sep;
+  if (wgs84tomslopt != nullptr) {
+    sep.resize(lat.size());
+    wgs84_separations(lat.constData(), lon.constData(), sep.data(), lat.size());
+  }
+
+  qsizetype i = 0;
+  for (Waypoint* waypointp : list) {
+    if (waypointp->altitude != unknown_alt) {
+      if (addopt != nullptr) {
+        waypointp->altitude += addf;
+      }
+
+      if (wgs84tomslopt != nullptr) {
+        waypointp->altitude -= std::isnan(sep[i]) ?
+                               wgs84_separation(waypointp->latitude, waypointp->longitude) : sep[i];
+      }
+    }
+    ++i;
+  }
+}
+
+/* return the number of the tile holding lat/lon, or -1 if there is none */
+int HeightFilter::dem_key(double lat, double lon)
+{
+  if (!std::isfinite(lat) || !std::isfinite(lon) ||
+      (lat > 90.0) || (lat < -90.0) || (lon > 180.0) || (lon < -180.0)) {
+    return -1;
+  }
+  /* the northern and eastern edges of the grid belong to the last tiles */
+  int ilat = std::clamp(static_cast<int>(floor(lat)), -90, 89);
+  int ilon = std::clamp(static_cast<int>(floor(lon)), -180, 179);
+  return (ilat + 90) * 360 + (ilon + 180);
+}
+
+/*
+ * Find a tile in the cache, or map it from the dem directory.  Tiles
+ * that don't exist are remembered too, so they are only looked for once.
+ * The tile may be evicted by the next call.
+ */
+const HeightFilter::DemTile* HeightFilter::dem_tile(int key)
+{
+  if (const DemTile* tile = dem_tiles.object(key)) {
+    return tile;
+  }
+
+  int ilat = key / 360 - 90;
+  int ilon = key % 360 - 180;
+  QString name = QStringLiteral("%1%2%3%4.hgt")
+                 .arg((ilat < 0) ? 'S' : 'N').arg(abs(ilat), 2, 10, QLatin1Char('0'))
+                 .arg((ilon < 0) ? 'W' : 'E').arg(abs(ilon), 3, 10, QLatin1Char('0'));
+
+  auto* tile = new DemTile;
+  QDir dir(QString::fromUtf8(demopt));
+  for (const QString& candidate : {name, name.toLower()}) {
+    auto file = std::make_unique<QFile>(dir.filePath(candidate));
+    if (!file->open(QIODevice::ReadOnly)) {
+      continue;
+    }
+    qint64 size = file->size();
+    auto samples = static_cast<int>(std::sqrt(static_cast<double>(size / 2)));
+    if ((samples < 2) || (2LL * samples * samples != size)) {
+      warning(MYNAME ": %s is not an SRTM tile, ignored.\n", qPrintable(file->fileName()));
+      break;
+    }
+    tile->data = file->map(0, size);
+    if (tile->data == nullptr) {
+      fatal(MYNAME ": Cannot map %s: %s\n", qPrintable(file->fileName()), qPrintable(file->errorString()));
+    }
+    tile->samples = samples;
+    tile->file = std::move(file);
+    break;
+  }
+
+  /* a tile larger than the whole cache is still kept until the next one */
+  qsizetype cost = (tile->data != nullptr) ? qsizetype(2) * tile->samples * tile->samples : 1;
+  const DemTile* result = tile;
+  dem_tiles.setMaxCost(std::max(dem_tiles.maxCost(), cost));
+  dem_tiles.insert(key, tile, cost);
+  return result;
+}
+
+/* replace the altitude by the terrain's, where the dem has it */
+void HeightFilter::dem_height(Waypoint* wpt)
+{
+  int key = dem_key(wpt->latitude, wpt->longitude);
+  if (key < 0) {
+    return;
+  }
+  const DemTile* tile = dem_tile(key);
+  if (tile->data == nullptr) {
+    return;
+  }
+
+  int ilat = key / 360 - 90;
+  int ilon = key % 360 - 180;
+  const int n = tile->samples;
+  const double step = 1.0 / (n - 1);
+  /* row 0 is the northern edge of the tile */
+  int row = std::min(static_cast<int>(floor((ilat + 1 - wpt->latitude) * (n - 1))), n - 2);
+  int col = std::min(static_cast<int>(floor((wpt->longitude - ilon) * (n - 1))), n - 2);
+  row = std::max(row, 0);
+  col = std::max(col, 0);
+
+  auto sample = [tile, n](int r, int c)->int {
+    return qFromBigEndian<qint16>(tile->data + 2 * (static_cast<qint64>(r) * n + c));
+  };
+  int z11 = sample(row + 1, col);
+  int z12 = sample(row + 1, col + 1);
+  int z21 = sample(row, col);
+  int z22 = sample(row, col + 1);
+  if ((z11 == kDemVoid) || (z12 == kDemVoid) || (z21 == kDemVoid) || (z22 == kDemVoid)) {
+    return;
+  }
+
+  wpt->altitude = bilinear(
+                    ilon + col * step, ilat + 1 - (row + 1) * step,
+                    ilon + (col + 1) * step, ilat + 1 - row * step,
+                    wpt->longitude, wpt->latitude,
+                    z11, z12, z21, z22);
+}
+
 void HeightFilter::correct_height(const Waypoint* wpt)
 {
   auto* waypointp = const_cast<Waypoint*>(wpt);
@@ -94,6 +270,14 @@ void HeightFilter::correct_height(const Waypoint* wpt)
   }
 }
 
+void HeightFilter::process_point(Waypoint* wpt)
+{
+  if (demopt != nullptr) {
+    dem_height(wpt);
+  }
+  correct_height(wpt);
+}
+
 void HeightFilter::init()
 {
   char* unit;
@@ -109,15 +293,60 @@ void HeightFilter::init()
   } else {
     addf = 0.0;
   }
+
+  if (demopt != nullptr) {
+    if (wgs84tomslopt != nullptr) {
+      fatal(MYNAME ": dem altitudes are already orthometric, wgs84tomsl can't be used with them.\n");
+    }
+    int megabytes = (demcacheopt != nullptr) ? xstrtoi(demcacheopt, nullptr, 10) : 256;
+    dem_tiles.setMaxCost(static_cast<qsizetype>(std::max(megabytes, 1)) * 1024 * 1024);
+  }
+}
+
+void HeightFilter::deinit()
+{
+  dem_tiles.clear();
 }
 
 void HeightFilter::process()
 {
-  WayptFunctor<HeightFilter> correct_height_f(this, &HeightFilter::correct_height);
+  if (demopt != nullptr) {
+    /* visit the points tile by tile, so each tile is mapped only once */
+    std::vector<std::pair<int, Waypoint*>> points;
+    auto collect_lambda = [&points](const Waypoint* wpt)->void {
+      points.emplace_back(dem_key(wpt->latitude, wpt->longitude), const_cast<Waypoint*>(wpt));
+    };
+    waypt_disp_all(collect_lambda);
+    route_disp_all(nullptr, nullptr, collect_lambda);
+    track_disp_all(nullptr, nullptr, collect_lambda);
+    std::stable_sort(points.begin(), points.end(),
+    [](const std::pair<int, Waypoint*>& a, const std::pair<int, Waypoint*>& b)->bool {
+      return a.first < b.first;
+    });
+    for (const auto& [key, wpt] : points) {
+      dem_height(wpt);
+    }
+  }
+
+  {
+    QVector<double> lat;
+    QVector<double> lon;
+    lat.reserve(global_waypoint_list->count());
+    lon.reserve(global_waypoint_list->count());
+    for (const Waypoint* wpt : std::as_const(*global_waypoint_list)) {
+      lat.append(wpt->latitude);
+      lon.append(wpt->longitude);
+    }
+    correct_heights(*global_waypoint_list, lat, lon);
+  }
 
-  waypt_disp_all(correct_height_f);
-  route_disp_all(nullptr, nullptr, correct_height_f);
-  track_disp_all(nullptr, nullptr, correct_height_f);
+  auto correct_heights_lambda = [this](const route_head* rte)->void {
+    const TrackColumns& cols = rte->columns();
+    correct_heights(rte->waypoint_list, cols.latitude, cols.longitude);
+    rte->invalidate_cache();
+  };
+  route_disp_all(correct_heights_lambda, nullptr, nullptr);
+  track_disp_all(correct_heights_lambda, nullptr, nullptr);
 }
 
 #endif // FILTERS_ENABLED
@@ -25,10 +25,14 @@
 #define HEIGHT_H_INCLUDED_
 
 #include <cstdint>         // for int8_t in heightgrid.h
+#include <memory>          // for unique_ptr
 
+#include <QCache>          // for QCache
+#include <QFile>           // for QFile
 #include <QVector>         // for QVector
+#include <QtGlobal>        // for qsizetype, uchar
 
-#include "defs.h"          // for arglist_t, ARG_NOMINMAX, ARGTYPE_BEGIN_REQ, ARGTYPE_BOOL, ARGTYPE_END_REQ, ARGTYPE_FLOAT, Waypoint
+#include "defs.h"          // for arglist_t, ARG_NOMINMAX, ARGTYPE_BEGIN_REQ, ARGTYPE_BOOL, ARGTYPE_END_REQ, ARGTYPE_FILE, ARGTYPE_FLOAT, ARGTYPE_INT, Waypoint, WaypointList
 #include "filter.h"        // for Filter
 
 #if FILTERS_ENABLED
@@ -42,11 +46,29 @@ public:
   }
   void init() override;
   void process() override;
+  bool can_process_points() const override
+  {
+    return true;
+  }
+  void process_point(Waypoint* wpt) override;
+  void deinit() override;
 
 private:
+  /* One SRTM tile of one by one degree, mapped into memory. */
+  struct DemTile {
+    std::unique_ptr<QFile> file;
+    const uchar* data{nullptr};	/* big endian samples, northern row first; null if there is no tile */
+    int samples{0};	/* per row and per column */
+  };
+
+  static constexpr int kDemVoid = -32768;
+
   char* addopt        = nullptr;
   char* wgs84tomslopt = nullptr;
+  char* demopt        = nullptr;
+  char* demcacheopt   = nullptr;
   double addf{};
+  QCache<int, DemTile> dem_tiles;
   // include static constexpr data member definitions with intializers for grid as private members.
   #include "heightgrid.h"
 
@@ -57,13 +79,26 @@ private:
     },
     {
       "wgs84tomsl", &wgs84tomslopt, "Converts WGS84 ellipsoidal height to orthometric height (MSL)",
-      nullptr, ARGTYPE_END_REQ | ARGTYPE_BOOL, ARG_NOMINMAX, nullptr
+      nullptr, ARGTYPE_BOOL, ARG_NOMINMAX, nullptr
+    },
+    {
+      "dem", &demopt, "Directory of SRTM .hgt tiles to take terrain altitudes from",
+      nullptr, ARGTYPE_END_REQ | ARGTYPE_FILE, ARG_NOMINMAX, nullptr
+    },
+    {
+      "demcache", &demcacheopt, "Megabytes of DEM tiles to keep mapped",
+      "256", ARGTYPE_INT, "1", nullptr, nullptr
     },
   };
 
   static double bilinear(double x1, double y1, double x2, double y2, double x, double y, double z11, double z12, double z21, double z22);
   static double wgs84_separation(double lat, double lon);
+  static void wgs84_separations(const double* lat, const double* lon, double* sep, qsizetype n);
+  static int dem_key(double lat, double lon);
+  const DemTile* dem_tile(int key);
+  void dem_height(Waypoint* wpt);
   void correct_height(const Waypoint* wpt);
+  void correct_heights(const WaypointList& list, const QVector<double>& lat, const QVector<double>& lon);
 
 };
 
@@ -125,13 +125,13 @@ HtmlFormat::html_disp(const Waypoint* wpt) const
 
   *file_out << "      <tr>\n";
   *file_out << "        <td colspan=\"2\">\n";
-  if (!wpt->gc_data->desc_short.utf_string.isEmpty()) {
+  if (!wpt->gc_data->desc_short.isEmpty()) {
     *file_out << "          <div><p class=\"gpsbabeldescshort\">"
-              << strip_nastyhtml(wpt->gc_data->desc_short.utf_string) << "</div>\n";
+              << strip_nastyhtml(wpt->gc_data->desc_short.get_text()) << "</div>\n";
   }
-  if (!wpt->gc_data->desc_long.utf_string.isEmpty()) {
+  if (!wpt->gc_data->desc_long.isEmpty()) {
     *file_out << "          <div><p class=\"gpsbabeldesclong\">"
-              << strip_nastyhtml(wpt->gc_data->desc_long.utf_string) << "</div>\n";
+              << strip_nastyhtml(wpt->gc_data->desc_long.get_text()) << "</div>\n";
   }
   if (!wpt->gc_data->hint.isEmpty()) {
     QString hint;
@@ -147,9 +147,9 @@ HtmlFormat::html_disp(const Waypoint* wpt) const
   }
 
   if (includelogs) {
-    const auto* fs_gpx = reinterpret_cast<fs_xml*>(wpt->fs.FsChainFind(kFsGpx));
-    if (fs_gpx && fs_gpx->tag) {
-      XmlTag* root = fs_gpx->tag;
+    const auto* fs_gpx = reinterpret_cast<const fs_xml*>(wpt->fs.FsChainFind(kFsGpx));
+    if (fs_gpx && fs_gpx->tree()) {
+      XmlTag* root = fs_gpx->tree();
       XmlTag* curlog = root->xml_findfirst(u"groundspeak:log");
       while (curlog) {
         *file_out << "          <p class=\"gpsbabellog\">\n";
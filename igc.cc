@@ -26,19 +26,25 @@
 #include "igc.h"
 
 #include <cassert>              // for assert
-#include <cmath>                // for fabs, lround
+#include <algorithm>            // for max, min
+#include <cmath>                // for fabs, lround, ceil, floor, sqrt
+#include <cstddef>              // for size_t
 #include <cstdio>               // for sscanf, printf, snprintf, size_t
 #include <cstdlib>              // for labs, ldiv, ldiv_t, abs
 #include <cstring>              // for strcmp, strlen, strtok, strcat, strchr, strcpy, strncat
 #include <iterator>             // for reverse_iterator, operator==, prev, next
+#include <numeric>              // for accumulate, inner_product
 #include <optional>             // for optional
 #include <tuple>                // for std::make_tuple
+#include <utility>              // for pair
+#include <vector>               // for vector
 
 #include <QByteArray>           // for QByteArray
 #include <QChar>                // for QChar
 #include <QLatin1Char>          // for QLatin1Char
 #include <QDate>                // for QDate
 #include <QDateTime>            // for QDateTime
+#include <QFileInfo>            // for QFileInfo
 #include <QList>                // for QList<>::const_iterator
 #include <QString>              // for QString, operator+, QStringLiteral
 #include <QStringList>          // for QStringList
@@ -50,6 +56,7 @@
 #include "gbfile.h"             // for gbfprintf, gbfclose, gbfopen, gbfputs, gbfgetstr, gbfile
 #include "grtcirc.h"            // for RAD, gcdist, radtometers
 #include "src/core/datetime.h"  // for DateTime
+#include "src/core/timeindex.h" // for TimeIndex
 #include "formspec.h"           // for FormatSpecificData, kFsIGC
 
 
@@ -110,6 +117,8 @@ void IgcFormat::rd_init(const QString& fname)
   char* ibuf;
 
   file_in = gbfopen(fname, "r", MYNAME);
+  // A fix (B) record with no extensions takes 35 characters and a CR LF.
+  fix_hint = QFileInfo(fname).size() / 37;
   // File must begin with a manufacturer/ID record
   if (get_record(&ibuf) != rec_manuf_id || sscanf(ibuf, "A%3[A-Z]", manufacturer) != 1) {
     fatal(MYNAME ": %s is not an IGC file\n", qPrintable(fname));
@@ -236,25 +245,65 @@ void IgcFormat::TaskRecordReader::igc_task_rec(const char* rec)
   route_add_wpt(rte_head, wpt);
 }
 
+/*
+ * Read len decimal digits at p, or return -1 if they aren't all digits.
+ */
+int IgcFormat::igc_digits(const char* p, int len)
+{
+  int value = 0;
+  for (int i = 0; i < len; ++i) {
+    if ((p[i] < '0') || (p[i] > '9')) {
+      return -1;
+    }
+    value = value * 10 + (p[i] - '0');
+  }
+  return value;
+}
+
+/*
+ * Take apart the fixed part of a fix (B) record,
+ * BHHMMSSDDMMmmmNDDDMMmmmEVPPPPPGGGGG.  Records that have it all in
+ * digits where digits belong are read by position, anything else,
+ * e.g. negative altitudes, goes through sscanf.
+ */
+bool IgcFormat::igc_decode_fix(const char* rec, igc_fix_t& fix)
+{
+  // Each test stops at the terminator, so a short record never reads past it.
+  if (((fix.hours = igc_digits(rec + 1, 2)) >= 0) &&
+      ((fix.mins = igc_digits(rec + 3, 2)) >= 0) &&
+      ((fix.secs = igc_digits(rec + 5, 2)) >= 0) &&
+      (igc_digits(rec + 7, 7) >= 0) &&
+      ((rec[14] == 'N') || (rec[14] == 'S')) &&
+      (igc_digits(rec + 15, 8) >= 0) &&
+      ((rec[23] == 'E') || (rec[23] == 'W')) &&
+      (rec[24] != '\0') &&
+      ((fix.pres_alt = igc_digits(rec + 25, 5)) >= 0) &&
+      ((fix.gnss_alt = igc_digits(rec + 30, 5)) >= 0)) {
+    fix.lat_deg = igc_digits(rec + 7, 2);
+    fix.lat_min = igc_digits(rec + 9, 2);
+    fix.lat_frac = igc_digits(rec + 11, 3);
+    fix.lat_hemi[0] = rec[14];
+    fix.lon_deg = igc_digits(rec + 15, 3);
+    fix.lon_min = igc_digits(rec + 18, 2);
+    fix.lon_frac = igc_digits(rec + 20, 3);
+    fix.lon_hemi[0] = rec[23];
+    fix.validity = rec[24];
+    return true;
+  }
+
+  return sscanf(rec,
+                "B%2d%2d%2d%2u%2u%3u%1[NS]%3u%2u%3u%1[WE]%c%5d%5d",
+                &fix.hours, &fix.mins, &fix.secs, &fix.lat_deg, &fix.lat_min, &fix.lat_frac,
+                fix.lat_hemi, &fix.lon_deg, &fix.lon_min, &fix.lon_frac, fix.lon_hemi,
+                &fix.validity, &fix.pres_alt, &fix.gnss_alt) == 14;
+}
+
 void IgcFormat::read()
 {
   char* ibuf;
-  int hours;
-  int mins;
-  int secs;
-  unsigned int lat_deg;
-  unsigned int lat_min;
-  unsigned int lat_frac;
-  unsigned int lon_deg;
-  unsigned int lon_min;
-  unsigned int lon_frac;
-  char lat_hemi[2];
-  char lon_hemi[2];
-  char validity;
+  igc_fix_t fix;
   route_head* pres_head = nullptr;
   route_head* gnss_head = nullptr;
-  int pres_alt;
-  int gnss_alt;
   char pres_valid = 0;
   char gnss_valid = 0;
   Waypoint* pres_wpt = nullptr;
@@ -336,6 +385,7 @@ void IgcFormat::read()
         pres_head->rte_name = kPresTrkName;
         pres_head->rte_desc = trk_desc;
         track_add_head(pres_head);
+        track_reserve_wpts(pres_head, fix_hint);
       }
       // Create a second track for GNSS altitude waypoints
       if (!gnss_head) {
@@ -343,24 +393,21 @@ void IgcFormat::read()
         gnss_head->rte_name = kGNSSTrkName;
         gnss_head->rte_desc = trk_desc;
         track_add_head(gnss_head);
+        track_reserve_wpts(gnss_head, fix_hint);
       }
       // Create a waypoint from the fix record data
-      if (sscanf(ibuf,
-                 "B%2d%2d%2d%2u%2u%3u%1[NS]%3u%2u%3u%1[WE]%c%5d%5d",
-                 &hours, &mins, &secs, &lat_deg, &lat_min, &lat_frac,
-                 lat_hemi, &lon_deg, &lon_min, &lon_frac, lon_hemi,
-                 &validity, &pres_alt, &gnss_alt) != 14) {
+      if (!igc_decode_fix(ibuf, fix)) {
         fatal(MYNAME ": fix (B) record parse error\n%s\n", ibuf);
       }
       pres_wpt = new Waypoint;
 
-      pres_wpt->latitude = ('N' == lat_hemi[0] ? 1 : -1) *
-                           (lat_deg + (lat_min * 1000 + lat_frac) / 1000.0 / 60);
+      pres_wpt->latitude = ('N' == fix.lat_hemi[0] ? 1 : -1) *
+                           (fix.lat_deg + (fix.lat_min * 1000 + fix.lat_frac) / 1000.0 / 60);
 
-      pres_wpt->longitude = ('E' == lon_hemi[0] ? 1 : -1) *
-                            (lon_deg + (lon_min * 1000 + lon_frac) / 1000.0 / 60);
+      pres_wpt->longitude = ('E' == fix.lon_hemi[0] ? 1 : -1) *
+                            (fix.lon_deg + (fix.lon_min * 1000 + fix.lon_frac) / 1000.0 / 60);
 
-      tod = QTime(hours, mins, secs);
+      tod = QTime(fix.hours, fix.mins, fix.secs);
       if (!tod.isValid()) {
         fatal(MYNAME ": bad time\n%s\n", ibuf);
       }
@@ -384,8 +431,16 @@ void IgcFormat::read()
         if (global_opts.debug_level >= 6) {
           printf(MYNAME ": Adding extension data:");
         }
+        // The record is ASCII, as it should be, when it has as many
+        // characters as bytes, and then its digits are read in place.
+        const bool ascii = ibuf_q.size() == qsizetype(strlen(ibuf));
         for (const auto& [name, ext, start, len, factor] : ext_types_list) {
-          double ext_data = ibuf_q.mid(start,len).toInt() / factor;
+          int value = ((start >= 0) && (start + len <= ibuf_q.size()) && ascii) ?
+                      igc_digits(ibuf + start, len) : -1;
+          if (value < 0) {
+            value = ibuf_q.mid(start,len).toInt();
+          }
+          double ext_data = value / factor;
 
           fsdata->set_value(ext, ext_data, pres_wpt);
           if (global_opts.debug_level >= 6) {
@@ -401,9 +456,9 @@ void IgcFormat::read()
       pres_wpt->SetCreationTime(QDateTime(date, tod, Qt::UTC));
 
       // Add the waypoint to the pressure altitude track
-      if (pres_alt) {
+      if (fix.pres_alt) {
         pres_valid = 1;
-        pres_wpt->altitude = pres_alt;
+        pres_wpt->altitude = fix.pres_alt;
       } else {
         pres_wpt->altitude = unknown_alt;
       }
@@ -412,9 +467,9 @@ void IgcFormat::read()
       // track
       gnss_wpt = new Waypoint(*pres_wpt);
 
-      if (gnss_alt) {
+      if (fix.gnss_alt) {
         gnss_valid = 1;
-        gnss_wpt->altitude = gnss_alt;
+        gnss_wpt->altitude = fix.gnss_alt;
       } else {
         gnss_wpt->altitude = unknown_alt;
       }
@@ -823,14 +878,31 @@ void IgcFormat::wr_fix_record(const Waypoint* wpt, int pres_alt, int gnss_alt)
 }
 
 /**
- * Attempt to align the pressure and GNSS tracks in time.
- * This is useful when trying to merge a track (lat/lon/time) recorded by a
- * GPS with a barograph (alt/time) recorded by a separate instrument with
- * independent clocks which are not closely synchronised.
+ * Check whether the two tracks were sampled at exactly the same times,
+ * as when both come from one logger.
+ */
+bool IgcFormat::share_timestamps(const route_head* pres_track, const route_head* gnss_track)
+{
+  if (pres_track->rte_waypt_ct() != gnss_track->rte_waypt_ct()) {
+    return false;
+  }
+  auto pres_it = pres_track->waypoint_list.cbegin();
+  for (const Waypoint* wpt : gnss_track->waypoint_list) {
+    if ((*pres_it)->GetCreationTime() != wpt->GetCreationTime()) {
+      return false;
+    }
+    ++pres_it;
+  }
+  return true;
+}
+
+/**
+ * Estimate the clock difference between the two tracks from their
+ * landing times.
  * @return The number of seconds to add to the GNSS track in order to align
- *         it with the pressure track.
+ *         it with the pressure track, or 0 if no landing was found.
  */
-int IgcFormat::correlate_tracks(const route_head* pres_track, const route_head* gnss_track)
+int IgcFormat::landing_time_adj(const route_head* pres_track, const route_head* gnss_track)
 {
   double alt_diff;
   double speed;
@@ -880,8 +952,155 @@ int IgcFormat::correlate_tracks(const route_head* pres_track, const route_head*
     printf(MYNAME ": gnss landing time %s\n", CSTR(gnss_time.toPrettyString()));
   }
   // Time adjustment is difference between the two estimated landing times
-  int time_diff = gnss_time.secsTo(pres_time);
-  if (15 * 60 < abs(time_diff)) {
+  return gnss_time.secsTo(pres_time);
+}
+
+/**
+ * Sample the known altitudes of a track once a second.
+ * @param  track  The track containing altitude data.
+ * @param  start  Set to the time of the first sample, in seconds since the epoch.
+ * @return  The altitudes, empty if the track has too little altitude data.
+ */
+std::vector<double> IgcFormat::resample_alt(const route_head* track, qint64& start)
+{
+  QList<std::pair<double, double>> points;  // time in seconds, altitude
+  for (const Waypoint* wpt : track->waypoint_list) {
+    if ((wpt->altitude != unknown_alt) && wpt->GetCreationTime().isValid()) {
+      double t = 0.001 * wpt->GetCreationTime().toMSecsSinceEpoch();
+      if (points.isEmpty() || (t > points.last().first)) {
+        points.append({t, wpt->altitude});
+      }
+    }
+  }
+
+  std::vector<double> alts;
+  if (points.size() < 2) {
+    return alts;
+  }
+  start = static_cast<qint64>(std::ceil(points.first().first));
+  auto end = static_cast<qint64>(std::floor(points.last().first));
+  if ((end < start) || (end - start > kMaxCorrelationSpan)) {
+    return alts;
+  }
+
+  alts.reserve(end - start + 1);
+  qsizetype i = 0;
+  for (qint64 t = start; t <= end; ++t) {
+    while (points.at(i + 1).first < t) {
+      ++i;
+    }
+    const auto& [t0, alt0] = points.at(i);
+    const auto& [t1, alt1] = points.at(i + 1);
+    alts.push_back(alt0 + (alt1 - alt0) * ((t - t0) / (t1 - t0)));
+  }
+  return alts;
+}
+
+/**
+ * Find the time adjustment near seed at which the altitude profiles of
+ * the two tracks agree best.
+ * Both tracks are resampled once a second and the normalized
+ * cross-correlation is evaluated for every adjustment within
+ * kMaxTimeAdj of seed, using prefix sums for the per-overlap means and
+ * variances so only the dot product is computed for each adjustment.
+ * @return The adjustment, or nothing if the tracks lack altitude
+ *         variation or no adjustment correlates well enough.
+ */
+std::optional<int> IgcFormat::cross_correlate(const route_head* pres_track, const route_head* gnss_track, int seed)
+{
+  qint64 pres_start;
+  qint64 gnss_start;
+  std::vector<double> pres = resample_alt(pres_track, pres_start);
+  std::vector<double> gnss = resample_alt(gnss_track, gnss_start);
+  const auto pres_ct = static_cast<qint64>(pres.size());
+  const auto gnss_ct = static_cast<qint64>(gnss.size());
+  if ((pres_ct < kMinCorrelationOverlap) || (gnss_ct < kMinCorrelationOverlap)) {
+    return std::nullopt;
+  }
+
+  // Remove the means to keep the sums below well conditioned.
+  auto center = [](std::vector<double>& alts)->void {
+    double mean = std::accumulate(alts.cbegin(), alts.cend(), 0.0) / alts.size();
+    for (double& alt : alts) {
+      alt -= mean;
+    }
+  };
+  center(pres);
+  center(gnss);
+
+  auto prefix_sums = [](const std::vector<double>& alts, std::vector<double>& sum, std::vector<double>& sum_sq)->void {
+    sum.assign(alts.size() + 1, 0.0);
+    sum_sq.assign(alts.size() + 1, 0.0);
+    for (std::size_t i = 0; i < alts.size(); ++i) {
+      sum[i + 1] = sum[i] + alts[i];
+      sum_sq[i + 1] = sum_sq[i] + alts[i] * alts[i];
+    }
+  };
+  std::vector<double> pres_sum;
+  std::vector<double> pres_sum_sq;
+  std::vector<double> gnss_sum;
+  std::vector<double> gnss_sum_sq;
+  prefix_sums(pres, pres_sum, pres_sum_sq);
+  prefix_sums(gnss, gnss_sum, gnss_sum_sq);
+
+  std::optional<int> best_adj;
+  double best_corr = kMinCorrelation;
+  for (int adj = seed - kMaxTimeAdj; adj <= seed + kMaxTimeAdj; ++adj) {
+    // gnss[i] lines up with pres[i + offset].
+    qint64 offset = gnss_start + adj - pres_start;
+    qint64 first = std::max<qint64>(0, -offset);
+    qint64 last = std::min(gnss_ct, pres_ct - offset);
+    qint64 n = last - first;
+    if (n < kMinCorrelationOverlap) {
+      continue;
+    }
+    double sg = gnss_sum[last] - gnss_sum[first];
+    double sgg = gnss_sum_sq[last] - gnss_sum_sq[first];
+    double sp = pres_sum[last + offset] - pres_sum[first + offset];
+    double spp = pres_sum_sq[last + offset] - pres_sum_sq[first + offset];
+    double var = (n * sgg - sg * sg) * (n * spp - sp * sp);
+    if (var <= 0.0) {
+      continue;
+    }
+    double dot = std::inner_product(gnss.cbegin() + first, gnss.cbegin() + last,
+                                    pres.cbegin() + first + offset, 0.0);
+    double corr = (n * dot - sg * sp) / std::sqrt(var);
+    if (global_opts.debug_level >= 3) {
+      printf(MYNAME ": adjustment %ds correlation %.4f\n", adj, corr);
+    }
+    if (corr > best_corr) {
+      best_corr = corr;
+      best_adj = adj;
+    }
+  }
+  if (best_adj && (global_opts.debug_level >= 1)) {
+    printf(MYNAME ": best correlation %.4f at %ds\n", best_corr, *best_adj);
+  }
+  return best_adj;
+}
+
+/**
+ * Attempt to align the pressure and GNSS tracks in time.
+ * This is useful when trying to merge a track (lat/lon/time) recorded by a
+ * GPS with a barograph (alt/time) recorded by a separate instrument with
+ * independent clocks which are not closely synchronised.
+ * The landing times give a first estimate, which is refined by
+ * correlating the altitude profiles when the GNSS track has altitudes.
+ * @return The number of seconds to add to the GNSS track in order to align
+ *         it with the pressure track.
+ */
+int IgcFormat::correlate_tracks(const route_head* pres_track, const route_head* gnss_track)
+{
+  if (share_timestamps(pres_track, gnss_track)) {
+    // Both tracks came off the same clock.
+    return 0;
+  }
+
+  int time_diff = landing_time_adj(pres_track, gnss_track);
+  if (std::optional<int> corr_diff = cross_correlate(pres_track, gnss_track, time_diff)) {
+    time_diff = *corr_diff;
+  }
+  if (kMaxTimeAdj < abs(time_diff)) {
     warning(MYNAME ": excessive time adjustment %ds\n", time_diff);
   }
   return time_diff;
@@ -892,8 +1111,54 @@ int IgcFormat::correlate_tracks(const route_head* pres_track, const route_head*
  * @param  track  The track containing altitude data.
  * @param  time   The time that we are interested in.
  * @return  The altitude interpolated from the track.
+ *
+ * Like the scan the search never moves back, so a time earlier than the
+ * one before it is looked up from where the last search stopped.
  */
 double IgcFormat::Interpolater::interpolate_alt(const route_head* track, const gpsbabel::DateTime& time)
+{
+  const gpsbabel::TimeIndex& index = track->time_index();
+  if (!index.ordered()) {
+    return scan_alt(track, time);
+  }
+
+  // Every point has a time and they never decrease, so the point the scan
+  // would stop at is the first one at or after the requested time.
+  if (time.isValid()) {
+    curr_pos = std::max(curr_pos, index.lower_bound(time.toMSecsSinceEpoch()));
+  }
+  if (curr_pos == index.size()) {
+    // Requested time later than all track points, we can't interpolate
+    return unknown_alt;
+  }
+
+  const QVector<double>& alt = track->columns().altitude;
+  const bool exact = time.isValid() && (index.time(curr_pos) == time.toMSecsSinceEpoch());
+  if (curr_pos == 0) {
+    // Use the first point only on an exact match, otherwise the requested
+    // time is prior to any track points and we can't interpolate.
+    return exact ? alt.at(0) : unknown_alt;
+  }
+  if (exact) {
+    // Exact match, as when both tracks share timestamps
+    return alt.at(curr_pos);
+  }
+  // Interpolate
+  const qint64 prev_time = index.time(curr_pos - 1);
+  int time_diff = (index.time(curr_pos) - prev_time) / 1000;
+  if (time_diff == 0) {
+    // Avoid divide by zero
+    return alt.at(curr_pos);
+  }
+  double alt_diff = alt.at(curr_pos) - alt.at(curr_pos - 1);
+  qint64 secs = time.isValid() ? (time.toMSecsSinceEpoch() - prev_time) / 1000 : 0;
+  return alt.at(curr_pos - 1) + (alt_diff / time_diff) * secs;
+}
+
+/*
+ * The same walking a track whose times are missing or out of order.
+ */
+double IgcFormat::Interpolater::scan_alt(const route_head* track, const gpsbabel::DateTime& time)
 {
   int time_diff;
 
@@ -922,6 +1187,10 @@ double IgcFormat::Interpolater::interpolate_alt(const route_head* track, const g
       return unknown_alt;
     }
   }
+  if ((**curr_wpt)->GetCreationTime() == time) {
+    // Exact match, as when both tracks share timestamps
+    return (**curr_wpt)->altitude;
+  }
   // Interpolate
   if (0 == (time_diff = (**prev_wpt)->GetCreationTime().secsTo((**curr_wpt)->GetCreationTime()))) {
     // Avoid divide by zero
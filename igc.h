@@ -29,12 +29,14 @@
 #define IGC_H_INCLUDED_
 
 #include <optional>              // for optional
+#include <vector>                // for vector
 #include <QByteArray>            // for QByteArray
 #include <QDateTime>             // for QDateTime
 #include <QList>                 // for QList<>::const_iterator
 #include <QString>               // for QString, operator+, QStringLiteral
 #include <QVector>               // for QVector
 #include <QHash>                 // for QHash
+#include <QtGlobal>              // for qint64, qsizetype
 
 #include "defs.h"
 #include "format.h"              // for Format
@@ -138,6 +140,24 @@ private:
     rec_bad = 1,		// Bad record
   };
 
+  /* The fixed part of a fix (B) record */
+  struct igc_fix_t {
+    int hours{};
+    int mins{};
+    int secs{};
+    unsigned int lat_deg{};
+    unsigned int lat_min{};
+    unsigned int lat_frac{};
+    unsigned int lon_deg{};
+    unsigned int lon_min{};
+    unsigned int lon_frac{};
+    char lat_hemi[2]{};
+    char lon_hemi[2]{};
+    char validity{};
+    int pres_alt{};
+    int gnss_alt{};
+  };
+
   char* opt_enl{nullptr};
   char* opt_tas{nullptr};
   char* opt_vat{nullptr};
@@ -254,6 +274,9 @@ private:
     double interpolate_alt(const route_head* track, const gpsbabel::DateTime& time);
 
   private:
+    double scan_alt(const route_head* track, const gpsbabel::DateTime& time);
+
+    qsizetype curr_pos{0};
     std::optional<WaypointList::const_iterator> prev_wpt;
     std::optional<WaypointList::const_iterator> curr_wpt;
   };
@@ -264,11 +287,17 @@ private:
   static constexpr int kMaxDescLen = 1024;
   static constexpr char kPresTrkName[] = "PRESALTTRK";
   static constexpr char kGNSSTrkName[] = "GNSSALTTRK";
+  static constexpr int kMaxTimeAdj = 15 * 60;	// Largest plausible clock difference, seconds
+  static constexpr int kMinCorrelationOverlap = 120;	// seconds
+  static constexpr double kMinCorrelation = 0.9;
+  static constexpr qint64 kMaxCorrelationSpan = 2 * 24 * 60 * 60;	// seconds
 
   /* Member Functions */
 
   static bool coords_match(double lat1, double lon1, double lat2, double lon2);
   igc_rec_type_t get_record(char** rec) const;
+  static int igc_digits(const char* p, int len);
+  static bool igc_decode_fix(const char* rec, igc_fix_t& fix);
   void detect_pres_track(const route_head* rh);
   void detect_gnss_track(const route_head* rh);
   void detect_other_track(const route_head* rh, int& max_waypt_ct);
@@ -283,6 +312,10 @@ private:
   void wr_task_tlr(const route_head* rte);
   void wr_tasks();
   void wr_fix_record(const Waypoint* wpt, int pres_alt, int gnss_alt);
+  static bool share_timestamps(const route_head* pres_track, const route_head* gnss_track);
+  static int landing_time_adj(const route_head* pres_track, const route_head* gnss_track);
+  static std::vector<double> resample_alt(const route_head* track, qint64& start);
+  static std::optional<int> cross_correlate(const route_head* pres_track, const route_head* gnss_track, int seed);
   static int correlate_tracks(const route_head* pres_track, const route_head* gnss_track);
   void wr_track();
 
@@ -290,6 +323,7 @@ private:
 
   gbfile* file_in{};
   gbfile* file_out{};
+  qsizetype fix_hint{0};  // fix records the file has room for
   char manufacturer[4] {};
   const route_head* head{};
   char* timeadj = nullptr;
@@ -358,6 +392,8 @@ struct igc_fsdata : public FormatSpecificData {
     return new igc_fsdata(*this);
   }
 
+  std::size_t memory_usage() const override {return sizeof(*this);}
+
   std::optional<double> enl; // Engine Noise Level
   std::optional<double> tas; // True Airspeed
   std::optional<double> vat; // Compensated variometer (total energy)
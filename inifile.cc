@@ -209,6 +209,12 @@ inifile_done(inifile_t* inifile)
   delete inifile;
 }
 
+QString
+inifile_source(const inifile_t* inifile)
+{
+  return inifile->source;
+}
+
 bool
 inifile_has_section(const inifile_t* inifile, const QString& section)
 {
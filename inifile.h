@@ -35,6 +35,12 @@ struct inifile_t; // forward declare, opaque to users.
 inifile_t* inifile_init(const QString& filename, const char* myname);
 void inifile_done(inifile_t* inifile);
 
+/*
+	inifile_source:
+	  the absolute path of the file inifile was read from
+ */
+QString inifile_source(const inifile_t* inifile);
+
 bool inifile_has_section(const inifile_t* inifile, const QString& section);
 
 /*
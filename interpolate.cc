@@ -21,18 +21,23 @@
 
 #include "interpolate.h"
 
+#include <algorithm>            // for max
 #include <climits>              // for INT_MAX
 #include <cmath>                // for ceil, isfinite
 #include <cstdlib>              // for abs, strtod
 #include <optional>             // for optional
+#include <utility>              // for as_const
+#include <vector>               // for vector
 
+#include <QList>                // for QList
 #include <QString>              // for QString
-#include <QtGlobal>             // for qint64, qRound64
+#include <QtGlobal>             // for qint64, qRound64, qsizetype
 
 #include "defs.h"
 #include "grtcirc.h"            // for linepart, RAD, gcdist, radtomiles
 #include "src/core/datetime.h"  // for DateTime
 #include "src/core/logging.h"   // for Fatal
+#include "src/core/scheduler.h"  // for TaskGroup
 
 
 #if FILTERS_ENABLED
@@ -44,52 +49,80 @@ void InterpolateFilter::process()
     fatal(FatalMsg() << MYNAME ": Found no routes or tracks to operate on.");
   }
 
-  auto process_rte_lambda = [this](const route_head* rte)->void {
-    process_rte(const_cast<route_head*>(rte));
+  QList<route_head*> rtes;
+  auto collect_lambda = [&rtes](const route_head* rte)->void {
+    rtes.append(const_cast<route_head*>(rte));
   };
   if (opt_route != nullptr) {
-    route_disp_all(process_rte_lambda, nullptr, nullptr);
+    route_disp_all(collect_lambda, nullptr, nullptr);
   } else {
-    track_disp_all(process_rte_lambda, nullptr, nullptr);
+    track_disp_all(collect_lambda, nullptr, nullptr);
   }
-}
 
-void InterpolateFilter::process_rte(route_head* rte)
-{
-  // Steal all the wpts
-  WaypointList wptlist;
-  if (opt_route != nullptr) {
-    route_swap_wpts(rte, wptlist);
+  // Steal all the wpts, and find out how many points go between them.
+  std::vector<Job> jobs(rtes.size());
+  for (qsizetype i = 0; i < rtes.size(); ++i) {
+    Job& job = jobs[i];
+    job.rte = rtes.at(i);
+    if (opt_route != nullptr) {
+      route_swap_wpts(job.rte, job.wptlist);
+    } else {
+      track_swap_wpts(job.rte, job.wptlist);
+    }
+    count_inserts(job);
+  }
+
+  // The interpolated points only depend on their own route or track.
+  const int threads = (opt_threads != nullptr) ? xstrtoi(opt_threads, nullptr, 10) : 1;
+  if ((threads > 1) && (jobs.size() > 1)) {
+    gpsbabel::TaskGroup group;
+    for (Job& job : jobs) {
+      Job* j = &job;
+      group.run([this, j]() {
+        interpolate(*j);
+      });
+    }
+    group.wait();
   } else {
-    track_swap_wpts(rte, wptlist);
+    for (Job& job : jobs) {
+      interpolate(job);
+    }
   }
 
   // And add them back, with interpolated points interspersed.
+  for (Job& job : jobs) {
+    job.rte->waypoint_list.reserve(job.points.size());
+    for (Waypoint* wpt : std::as_const(job.points)) {
+      if (opt_route != nullptr) {
+        route_add_wpt(job.rte, wpt);
+      } else {
+        track_add_wpt(job.rte, wpt);
+      }
+    }
+  }
+}
+
+void InterpolateFilter::count_inserts(Job& job) const
+{
+  job.inserts.reserve(job.wptlist.count());
+  job.total = job.wptlist.count();
+
   PositionDeg pos1;
-  double altitude1 = unknown_alt;
   gpsbabel::DateTime time1;
   bool first = true;
-  foreach (Waypoint* wpt, wptlist) {
+  for (const Waypoint* wpt : std::as_const(job.wptlist)) {
+    int nmax = 0;
     if (first) {
       first = false;
     } else {
-      std::optional<qint64> timespan;
-      if (wpt->creation_time.isValid() && time1.isValid()) {
-        timespan = time1.msecsTo(wpt->creation_time);
-      }
-      std::optional<double> altspan;
-      if (altitude1 != unknown_alt && wpt->altitude != unknown_alt) {
-        altspan = wpt->altitude - altitude1;
-      }
-
       // How many points need to be inserted?
       double npts = 0;
       if (opt_time != nullptr) {
-        if (!timespan.has_value()) {
+        if (!wpt->creation_time.isValid() || !time1.isValid()) {
           fatal(FatalMsg() << MYNAME ": points must have valid times to interpolate by time!");
         }
         // interpolate even if time is running backwards.
-        npts = std::abs(*timespan) / max_time_step;
+        npts = std::abs(time1.msecsTo(wpt->creation_time)) / max_time_step;
       } else if (opt_dist != nullptr) {
         double distspan = radtomiles(gcdist(pos1, wpt->position()));
         npts = distspan / max_dist_step;
@@ -97,16 +130,44 @@ void InterpolateFilter::process_rte(route_head* rte)
       if (!std::isfinite(npts) || (npts >= INT_MAX)) {
         fatal(FatalMsg() << MYNAME ": interpolation interval too small!");
       }
+      nmax = std::max(static_cast<int>(ceil(npts)) - 1, 0); // # of points to insert
+    }
+    job.inserts.append(nmax);
+    job.total += nmax;
+
+    pos1 = wpt->position();
+    time1 = wpt->creation_time.toUTC();  // use utc to avoid tz conversions.
+  }
+}
+
+void InterpolateFilter::interpolate(Job& job) const
+{
+  job.points.reserve(job.total);
+
+  PositionDeg pos1;
+  double altitude1 = unknown_alt;
+  gpsbabel::DateTime time1;
+  qsizetype i = 0;
+  for (Waypoint* wpt : std::as_const(job.wptlist)) {
+    const int nmax = job.inserts.at(i++);
+    if (nmax > 0) {
+      std::optional<qint64> timespan;
+      if (wpt->creation_time.isValid() && time1.isValid()) {
+        timespan = time1.msecsTo(wpt->creation_time);
+      }
+      std::optional<double> altspan;
+      if (altitude1 != unknown_alt && wpt->altitude != unknown_alt) {
+        altspan = wpt->altitude - altitude1;
+      }
 
       // Insert the required points
-      int nmax = static_cast<int>(ceil(npts)) - 1; // # of points to insert
       for (int n = 0; n < nmax; ++n) {
         double frac = static_cast<double>(n + 1) /
                       static_cast<double>(nmax + 1);
         // We create the inserted point from the Waypoint at the end of the
         // span.  Another choice would be the Waypoint at the beginning of
         // the span.  We clear some fields but use a copy of the rest or the
-        // interpolated value.
+        // interpolated value.  The copies share the end point's cold data.
         auto* wpt_new = new Waypoint(*wpt);
         wpt_new->shortname = QString();
         wpt_new->description = QString();
@@ -121,18 +182,10 @@ void InterpolateFilter::process_rte(route_head* rte)
         } else {
           wpt_new->altitude = unknown_alt;
         }
-        if (opt_route != nullptr) {
-          route_add_wpt(rte, wpt_new);
-        } else {
-          track_add_wpt(rte, wpt_new);
-        }
+        job.points.append(wpt_new);
       }
     }
-    if (opt_route != nullptr) {
-      route_add_wpt(rte, wpt);
-    } else {
-      track_add_wpt(rte, wpt);
-    }
+    job.points.append(wpt);
 
     pos1 = wpt->position();
     altitude1 = wpt->altitude;
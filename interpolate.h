@@ -22,10 +22,12 @@
 #ifndef INTERPOLATE_H_INCLUDED_
 #define INTERPOLATE_H_INCLUDED_
 
+#include <QList>                // for QList
 #include <QString>              // for QString
 #include <QVector>              // for QVector
+#include <QtGlobal>             // for qsizetype
 
-#include "defs.h"               // for ARG_NOMINMAX, arglist_t, ARGTYPE_BEGIN_EXCL, ARG...
+#include "defs.h"               // for ARG_NOMINMAX, arglist_t, ARGTYPE_BEGIN_EXCL, ARG..., route_head, Waypoint, WaypointList
 #include "filter.h"             // for Filter
 
 #if FILTERS_ENABLED
@@ -41,9 +43,21 @@ public:
   void process() override;
 
 private:
+  /* Types */
+
+  /* A route or track with its points taken out, and their replacement. */
+  struct Job {
+    route_head* rte{nullptr};
+    WaypointList wptlist;
+    QList<int> inserts;	/* # of points to insert before each point */
+    qsizetype total{0};
+    QList<Waypoint*> points;
+  };
+
   /* Member Functions */
 
-  void process_rte(route_head* rte);
+  void count_inserts(Job& job) const;
+  void interpolate(Job& job) const;
 
   /* Data Members */
 
@@ -52,6 +66,7 @@ private:
   char* opt_dist{nullptr};
   double max_dist_step{0};
   char* opt_route{nullptr};
+  char* opt_threads{nullptr};
 
   QVector<arglist_t> args = {
     {
@@ -68,6 +83,10 @@ private:
       "route", &opt_route, "Interpolate routes instead", nullptr,
       ARGTYPE_BOOL, ARG_NOMINMAX, nullptr
     },
+    {
+      "threads", &opt_threads, "Interpolate routes or tracks on this many threads",
+      nullptr, ARGTYPE_INT, "1", nullptr, nullptr
+    },
   };
 
 };
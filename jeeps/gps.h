@@ -233,6 +233,8 @@ typedef struct GPS_SCourse_Limits {
 
 
 using pcb_fn = int (*)(int, GPS_SWay**);
+/* Receives each track entry as it is read; trk is only valid during the call. */
+using trk_sink_fn = void (*)(const GPS_OTrack* trk, void* sink_data);
 
 #include "jeeps/gpsdevice.h"
 #include "jeeps/gpssend.h"
@@ -24,11 +24,14 @@
 ** Boston, MA  02110-1301, USA.
 ********************************************************************/
 #include "jeeps/gps.h"
+#include <algorithm>
 #include <cctype>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <utility>
+#include <vector>
 
 #include <QDateTime>
 
@@ -3784,6 +3787,17 @@ drain_run_cmd(gpsdevh* fd)
   return 0;
 }
 
+/* Keep a copy of each entry for GPS_A301_Get. */
+static void A301_Collect(const GPS_OTrack* trk, void* sink_data)
+{
+  auto* list = static_cast<std::vector<GPS_PTrack>*>(sink_data);
+  GPS_PTrack copy = GPS_Track_New();
+  if (copy) {
+    *copy = *trk;
+  }
+  list->push_back(copy);
+}
+
 /* @func GPS_A301_Get ******************************************************
 **
 ** Get track data from GPS (A301/A302)
@@ -3795,6 +3809,49 @@ drain_run_cmd(gpsdevh* fd)
 ** @return [int32] number of track entries
 ************************************************************************/
 int32_t GPS_A301_Get(const char* port, GPS_PTrack** trk, pcb_fn cb, int protoid)
+{
+  std::vector<GPS_PTrack> list;
+  int32_t n = GPS_A301_Get_Sink(port, A301_Collect, &list, cb, protoid);
+
+  bool failed = n < 0;
+  for (GPS_PTrack entry : list) {
+    failed = failed || !entry;
+  }
+  if (failed) {
+    for (GPS_PTrack entry : list) {
+      GPS_Track_Del(&entry);
+    }
+    return (n < 0) ? n : MEMORY_ERROR;
+  }
+
+  if (n) {
+    if (!((*trk)=(GPS_PTrack*)malloc(n*sizeof(GPS_PTrack)))) {
+      GPS_Error("A301_Get: Insufficient memory");
+      for (GPS_PTrack entry : list) {
+        GPS_Track_Del(&entry);
+      }
+      return MEMORY_ERROR;
+    }
+    std::copy(list.begin(), list.end(), *trk);
+  }
+
+  return n;
+}
+
+/* @func GPS_A301_Get_Sink *************************************************
+**
+** Get track data from GPS (A301/A302) without building a track array.
+** Each entry is handed to sink as soon as its packet has been decoded.
+**
+** @param [r] port [const char *] serial port
+** @param [r] sink [trk_sink_fn] receives each entry
+** @param [r] sink_data [void *] passed on to sink
+** @param [r] protoid [int] protocol ID (301 or 302)
+**
+** @return [int32] number of track entries
+************************************************************************/
+int32_t GPS_A301_Get_Sink(const char* port, trk_sink_fn sink, void* sink_data,
+                          pcb_fn cb, int protoid)
 {
   static UC data[2];
   gpsdevh* fd;
@@ -3804,6 +3861,10 @@ int32_t GPS_A301_Get(const char* port, GPS_PTrack** trk, pcb_fn cb, int protoid)
   int32_t i;
   US Pid_Trk_Data, Pid_Trk_Hdr, Cmnd_Transfer_Trk;
   int32_t trk_type, trk_hdr_type;
+  /* The current entry and the one before it, which segment detection needs. */
+  GPS_OTrack entries[2];
+  GPS_PTrack prev = &entries[0];
+  GPS_PTrack cur = &entries[1];
 
   if (gps_trk_transfer == -1) {
     return GPS_UNSUPPORTED;
@@ -3863,17 +3924,10 @@ int32_t GPS_A301_Get(const char* port, GPS_PTrack** trk, pcb_fn cb, int protoid)
 
   n = GPS_Util_Get_Short(rec.data);
 
-  if (n)
-    if (!((*trk)=(GPS_PTrack*)malloc(n*sizeof(GPS_PTrack)))) {
-      GPS_Error("A301_Get: Insufficient memory");
-      return MEMORY_ERROR;
-    }
-  for (i=0; i<n; ++i)
-    if (!((*trk)[i]=GPS_Track_New())) {
-      return MEMORY_ERROR;
-    }
-
   for (i=0; i<n; ++i) {
+    std::swap(prev, cur);
+    memset(cur, 0, sizeof(*cur));
+
     if (!GPS_Packet_Read(fd, &rec)) {
       return gps_errno;
     }
@@ -3884,16 +3938,17 @@ int32_t GPS_A301_Get(const char* port, GPS_PTrack** trk, pcb_fn cb, int protoid)
       switch (trk_hdr_type) {
       case pD310:
       case pD312:
-        GPS_D310_Get(&((*trk)[i]),rec.data);
+        GPS_D310_Get(&cur,rec.data);
         break;
       case pD311:
-        GPS_D311_Get(&((*trk)[i]),rec.data);
+        GPS_D311_Get(&cur,rec.data);
         break;
       default:
         GPS_Error("A301_Get: Unknown track protocol");
         return PROTOCOL_ERROR;
       }
-      (*trk)[i]->ishdr = 1;
+      cur->ishdr = 1;
+      sink(cur, sink_data);
       continue;
     }
 
@@ -3902,31 +3957,31 @@ int32_t GPS_A301_Get(const char* port, GPS_PTrack** trk, pcb_fn cb, int protoid)
       return FRAMING_ERROR;
     }
 
-    (*trk)[i]->ishdr = 0;
+    cur->ishdr = 0;
 
     switch (trk_type) {
     case pD300:
-      GPS_D300b_Get(&((*trk)[i]),rec.data);
+      GPS_D300b_Get(&cur,rec.data);
       break;
     case pD301:
-      GPS_D301b_Get(&((*trk)[i]),rec.data);
+      GPS_D301b_Get(&cur,rec.data);
       break;
     case pD302:
-      GPS_D302b_Get(&((*trk)[i]),rec.data);
+      GPS_D302b_Get(&cur,rec.data);
       break;
     case pD303:
     case pD304:
-      GPS_D303b_Get(&((*trk)[i]),rec.data);
+      GPS_D303b_Get(&cur,rec.data);
       /* Fitness devices don't send track segment markers, so we have
        * to create them ourselves. We do so at the beginning of the
        * track or if the device signals a pause by sending two
        * invalid points in a row.
        */
       if (i>0) {
-        if ((*trk)[i-1]->ishdr ||
-            (Is_Trackpoint_Invalid((*trk)[i-1]) &&
-             Is_Trackpoint_Invalid((*trk)[i]))) {
-          (*trk)[i]->tnew = 1;
+        if (prev->ishdr ||
+            (Is_Trackpoint_Invalid(prev) &&
+             Is_Trackpoint_Invalid(cur))) {
+          cur->tnew = 1;
         }
       }
       break;
@@ -3934,6 +3989,8 @@ int32_t GPS_A301_Get(const char* port, GPS_PTrack** trk, pcb_fn cb, int protoid)
       GPS_Error("A301_GET: Unknown track protocol");
       return PROTOCOL_ERROR;
     }
+    sink(cur, sink_data);
+
     /* Cheat and don't _really_ pass the trkpt back */
     if (cb) {
       cb(n, nullptr);
@@ -17,6 +17,8 @@ int32_t GPS_A201_Send(const char* port, GPS_PWay* way, int32_t n);
 
 int32_t GPS_A300_Get(const char* port, GPS_PTrack** trk, pcb_fn cb);
 int32_t GPS_A301_Get(const char* port, GPS_PTrack** trk, pcb_fn cb, int protoid);
+int32_t GPS_A301_Get_Sink(const char* port, trk_sink_fn sink, void* sink_data,
+                          pcb_fn cb, int protoid);
 int32_t GPS_A300_Send(const char* port, GPS_PTrack* trk, int32_t n);
 int32_t GPS_A301_Send(const char* port, GPS_PTrack* trk, int32_t n, int protoid,
                       gpsdevh* fd);
@@ -240,6 +240,53 @@ int32_t GPS_Command_Get_Track(const char* port, GPS_PTrack** trk, pcb_fn cb)
 
 
 
+/* @func GPS_Command_Get_Track_Sink **********************************
+**
+** Get track log from GPS, handing each entry to sink as it arrives
+**
+** @param [r] port [const char *] serial port
+** @param [r] sink [trk_sink_fn] receives each entry
+** @param [r] sink_data [void *] passed on to sink
+**
+** @return [int32] number of track entries
+************************************************************************/
+
+int32_t GPS_Command_Get_Track_Sink(const char* port, trk_sink_fn sink, void* sink_data,
+                                   pcb_fn cb)
+{
+  int32_t ret = 0;
+  GPS_PTrack* trk = nullptr;
+
+  if (gps_trk_transfer == -1) {
+    return GPS_UNSUPPORTED;
+  }
+
+  switch (gps_trk_transfer) {
+  case pA300:
+    /* A300 units only hold a short log, so just walk the array. */
+    ret = GPS_A300_Get(port,&trk,cb);
+    for (int32_t i = 0; i < ret; ++i) {
+      sink(trk[i], sink_data);
+      GPS_Track_Del(&trk[i]);
+    }
+    if (ret > 0) {
+      free(trk);
+    }
+    break;
+  case pA301:
+  case pA302:
+    ret = GPS_A301_Get_Sink(port,sink,sink_data,cb,301);
+    break;
+  default:
+    GPS_Error("Get_Track: Unknown track protocol %d\n", gps_trk_transfer);
+    return PROTOCOL_ERROR;
+  }
+
+  return ret;
+}
+
+
+
 /* @func GPS_Command_Send_Track ******************************************
 **
 ** Send track log to GPS
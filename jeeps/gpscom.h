@@ -21,6 +21,8 @@ int32_t GPS_Command_Get_Almanac(const char* port, GPS_PAlmanac** alm);
 int32_t GPS_Command_Send_Almanac(const char* port, GPS_PAlmanac* alm, int32_t n);
 
 int32_t GPS_Command_Get_Track(const char* port, GPS_PTrack** trk, int (*cb)(int, GPS_SWay**));
+int32_t GPS_Command_Get_Track_Sink(const char* port, trk_sink_fn sink, void* sink_data,
+                                   int (*cb)(int, GPS_SWay**));
 int32_t GPS_Command_Send_Track(const char* port, GPS_PTrack* trk, int32_t n, int eraset);
 
 int32_t GPS_Command_Get_Waypoint(const char* port, GPS_PWay** way, int (*cb)(int, GPS_SWay**));
@@ -21,6 +21,7 @@
 
 
 #include <cassert>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -52,10 +53,35 @@
 #define TMOUT_I 5000 /*  Milliseconds to timeout intr pipe access. */
 #define TMOUT_B 5000 /*  Milliseconds to timeout bulk pipe access. */
 
+/*
+ * Number of reads kept in flight on each in pipe.  Large transfers like
+ * track logs stream from the unit without any handshake, so with several
+ * reads queued the next packet is already on its way while the protocol
+ * layer handles the last one.
+ */
+#define READS_IN_FLIGHT 4
+
 typedef struct {
   unsigned product_id;
 } libusb_unit_data;
 
+/*
+ * Reads on one in pipe.  Transfers on an endpoint complete in the order
+ * they were submitted, so packets are handed out oldest first and each
+ * transfer is resubmitted as soon as its packet has been copied out.
+ * The transfers are submitted without a timeout, a caller waiting for
+ * a packet gives up after its own timeout instead and the transfer stays
+ * queued, so no data is lost.
+ */
+typedef struct {
+  libusb_transfer* xfer[READS_IN_FLIGHT];
+  unsigned char buf[READS_IN_FLIGHT][sizeof(garmin_usb_packet)];
+  int completed[READS_IN_FLIGHT];
+  int submit_error[READS_IN_FLIGHT];
+  int head;		/* oldest transfer */
+  bool started;
+} libusb_read_queue;
+
 /*
  * TODO: this should all be moved into libusbdata in gpslibusb.h,
  * allocated once here in gusb_start, and deallocated at the end.
@@ -66,6 +92,8 @@ static unsigned char gusb_bulk_in_ep;
 
 static bool libusb_successfully_initialized{false};
 static libusb_device_handle* udev{nullptr};
+static libusb_read_queue gusb_intr_reads;
+static libusb_read_queue gusb_bulk_reads;
 static int garmin_usb_scan(libusb_unit_data* lud, int req_unit_number);
 
 static int gusb_libusb_get(garmin_usb_packet* ibuf, size_t sz);
@@ -100,38 +128,148 @@ gusb_libusb_send(const garmin_usb_packet* opkt, size_t sz)
   return transferred;
 }
 
-static int
-gusb_libusb_get(garmin_usb_packet* ibuf, size_t sz)
+static void LIBUSB_CALL
+gusb_read_done(libusb_transfer* transfer)
 {
-  unsigned char* buf = &ibuf->dbuf[0];
-  int transferred;
+  *static_cast<int*>(transfer->user_data) = 1;
+}
 
-  int ret = libusb_interrupt_transfer(udev, gusb_intr_in_ep, buf, sz,
-                                      &transferred, TMOUT_I);
-// UGGH: expected return is error code < 0 or # of bytes transferred.
-// assume libusb return values are all <= 0, transferred >= 0.
-  if (ret != LIBUSB_SUCCESS) {
-    assert(ret < 0);
-    return ret;
+static void
+gusb_start_reads(libusb_read_queue* q, unsigned char ep, unsigned char type)
+{
+  for (int i = 0; i < READS_IN_FLIGHT; i++) {
+    q->xfer[i] = libusb_alloc_transfer(0);
+    if (q->xfer[i] == nullptr) {
+      fatal("libusb_alloc_transfer failed.\n");
+    }
+    if (type == LIBUSB_TRANSFER_TYPE_INTERRUPT) {
+      libusb_fill_interrupt_transfer(q->xfer[i], udev, ep, q->buf[i], sizeof(q->buf[i]),
+                                     gusb_read_done, &q->completed[i], 0);
+    } else {
+      libusb_fill_bulk_transfer(q->xfer[i], udev, ep, q->buf[i], sizeof(q->buf[i]),
+                                gusb_read_done, &q->completed[i], 0);
+    }
+    q->completed[i] = 0;
+    q->submit_error[i] = libusb_submit_transfer(q->xfer[i]);
+    if (q->submit_error[i] != LIBUSB_SUCCESS) {
+      q->completed[i] = 1;
+    }
   }
-  return transferred;
+  q->head = 0;
+  q->started = true;
 }
 
+static void
+gusb_stop_reads(libusb_read_queue* q)
+{
+  if (!q->started) {
+    return;
+  }
+  for (int i = 0; i < READS_IN_FLIGHT; i++) {
+    if (!q->completed[i]) {
+      libusb_cancel_transfer(q->xfer[i]);
+    }
+  }
+  for (int i = 0; i < READS_IN_FLIGHT; i++) {
+    while (!q->completed[i]) {
+      if (libusb_handle_events_completed(nullptr, &q->completed[i]) != LIBUSB_SUCCESS) {
+        break;
+      }
+    }
+    /* A transfer that could not be reaped is leaked rather than freed in flight. */
+    if (q->completed[i]) {
+      libusb_free_transfer(q->xfer[i]);
+    }
+    q->xfer[i] = nullptr;
+  }
+  q->started = false;
+}
+
+/*
+ * Wait up to tmout milliseconds for the oldest queued read, copy its
+ * packet to ibuf and queue the transfer again.
+ */
 static int
-gusb_libusb_get_bulk(garmin_usb_packet* ibuf, size_t sz)
+gusb_queued_read(libusb_read_queue* q, unsigned char ep, unsigned char type,
+                 garmin_usb_packet* ibuf, size_t sz, unsigned int tmout)
 {
-  unsigned char* buf = &ibuf->dbuf[0];
-  int transferred;
+  if (!q->started) {
+    gusb_start_reads(q, ep, type);
+  }
+
+  int slot = q->head;
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(tmout);
+  while (!q->completed[slot]) {
+    auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(
+                       deadline - std::chrono::steady_clock::now()).count();
+    if (remaining <= 0) {
+      return LIBUSB_ERROR_TIMEOUT;
+    }
+    struct timeval tv;
+    tv.tv_sec = remaining / 1000000;
+    tv.tv_usec = remaining % 1000000;
+    int ret = libusb_handle_events_timeout_completed(nullptr, &tv, &q->completed[slot]);
+    if (ret != LIBUSB_SUCCESS && ret != LIBUSB_ERROR_INTERRUPTED) {
+      return ret;
+    }
+  }
+
+  libusb_transfer* transfer = q->xfer[slot];
+  int rv;
+  if (q->submit_error[slot] != LIBUSB_SUCCESS) {
+    rv = q->submit_error[slot];
+  } else {
+    switch (transfer->status) {
+    case LIBUSB_TRANSFER_COMPLETED:
+      rv = transfer->actual_length;
+      if ((size_t) rv > sz) {
+        rv = LIBUSB_ERROR_OVERFLOW;
+      } else {
+        memcpy(&ibuf->dbuf[0], transfer->buffer, rv);
+      }
+      break;
+    case LIBUSB_TRANSFER_TIMED_OUT:
+      rv = LIBUSB_ERROR_TIMEOUT;
+      break;
+    case LIBUSB_TRANSFER_STALL:
+      rv = LIBUSB_ERROR_PIPE;
+      break;
+    case LIBUSB_TRANSFER_NO_DEVICE:
+      rv = LIBUSB_ERROR_NO_DEVICE;
+      break;
+    case LIBUSB_TRANSFER_OVERFLOW:
+      rv = LIBUSB_ERROR_OVERFLOW;
+      break;
+    default:
+      rv = LIBUSB_ERROR_IO;
+      break;
+    }
+  }
+
+  q->completed[slot] = 0;
+  q->submit_error[slot] = libusb_submit_transfer(transfer);
+  if (q->submit_error[slot] != LIBUSB_SUCCESS) {
+    q->completed[slot] = 1;
+  }
+  q->head = (slot + 1) % READS_IN_FLIGHT;
+
+  return rv;
+}
 
-  int ret = libusb_bulk_transfer(udev, gusb_bulk_in_ep, buf, sz,
-                                 &transferred, TMOUT_B);
 // UGGH: expected return is error code < 0 or # of bytes transferred.
 // assume libusb return values are all <= 0, transferred >= 0.
-  if (ret != LIBUSB_SUCCESS) {
-    assert(ret < 0);
-    return ret;
-  }
-  return transferred;
+static int
+gusb_libusb_get(garmin_usb_packet* ibuf, size_t sz)
+{
+  return gusb_queued_read(&gusb_intr_reads, gusb_intr_in_ep,
+                          LIBUSB_TRANSFER_TYPE_INTERRUPT, ibuf, sz, TMOUT_I);
+}
+
+static int
+gusb_libusb_get_bulk(garmin_usb_packet* ibuf, size_t sz)
+{
+  return gusb_queued_read(&gusb_bulk_reads, gusb_bulk_in_ep,
+                          LIBUSB_TRANSFER_TYPE_BULK, ibuf, sz, TMOUT_B);
 }
 
 
@@ -139,6 +277,8 @@ static int
 gusb_teardown(gpsdevh* dh, bool exit_lib)
 {
   if (udev != nullptr) {
+    gusb_stop_reads(&gusb_intr_reads);
+    gusb_stop_reads(&gusb_bulk_reads);
     int ret = libusb_release_interface(udev, 0);
     if (ret != LIBUSB_SUCCESS) {
       warning("libusb_release_interface failed: %s\n",
@@ -30,12 +30,15 @@
 #include <cstring>           // for strcmp, strcpy
 #include <ctime>             // for time_t
 
+#include <QByteArray>        // for QByteArray
+#include <QHash>             // for QHash
 #include <QString>           // for QString
 
 #include "defs.h"            // for case_ignore_strcmp, fatal, CSTR
 #include "jeeps/gpsdatum.h"  // for GPS_ODatum, GPS_OEllipse, GPS_Datums, GPS_Ellipses, UKNG, GPS_SDatum_Alias, GPS_SDatum, GPS_DatumAliases, GPS_PDatum, GPS_PDatum_Alias
 
 static constexpr bool use_exact_helmert_inverse = false;
+static constexpr double GPS_UTM_F0 = 0.9996;  /* UTM central meridian scale */
 
 static int32_t GPS_Math_LatLon_To_UTM_Param(double lat, double lon, int32_t* zone,
                                             char* zc, double* Mc, double* E0,
@@ -543,8 +546,72 @@ void GPS_Math_LatLon_To_EN(double* E, double* N, double phi,
                            double phi0, double lambda0,
                            double F0, double a, double b)
 {
-  double esq;
+  GPS_Math_Transverse_Mercator_Setup(F0,a,b).to_EN(E,N,phi,lambda,N0,E0,
+      phi0,lambda0);
+
+  return;
+}
+
+
+
+/* @func GPS_Math_Transverse_Mercator_Setup ****************************
+**
+** Work out the constants of a transverse Mercator projection that only
+** depend on the ellipse and the scale factor
+**
+** @param [r] F0 [double] scale factor on central meridian
+** @param [r] a [double] semi-major axis (metres)
+** @param [r] b [double] semi-minor axis (metres)
+**
+** @return [GPS_Transverse_Mercator] projection
+************************************************************************/
+GPS_Transverse_Mercator GPS_Math_Transverse_Mercator_Setup(double F0,
+    double a, double b)
+{
+  GPS_Transverse_Mercator tm;
   double n;
+  double fdf;
+  double fde;
+
+  tm.esq = ((a*a)-(b*b)) / (a*a);
+  n      = (a-b) / (a+b);
+
+  tm.aF0    = a * F0;
+  tm.aF0esq = a * F0 * (1.0 - tm.esq);
+  tm.bF0    = b * F0;
+
+  fdf   = 5.0 / 4.0;
+  tm.m1 = 1.0 + n + (fdf * n * n) + (fdf * n * n * n);
+  tm.m2 = 3.0*n + 3.0*n*n + (21./8.)*n*n*n;
+
+  fde   = (15.0 / 8.0);
+  tm.m3 = (fde*n*n) + (fde*n*n*n);
+  tm.m4 = (35.0/24.0) * n * n * n;
+
+  return tm;
+}
+
+
+
+/* @func GPS_Transverse_Mercator::to_EN ********************************
+**
+** Convert latitude and longitude to eastings and northings
+**
+** @param [w] E [double *] easting (metres)
+** @param [w] N [double *] northing (metres)
+** @param [r] phi [double] latitude (deg)
+** @param [r] lambda [double] longitude (deg)
+** @param [r] N0 [double] true northing origin (metres)
+** @param [r] E0 [double] true easting  origin (metres)
+** @param [r] phi0 [double] true latitude origin (deg)
+** @param [r] lambda0 [double] true longitude origin (deg)
+**
+** @return [void]
+************************************************************************/
+void GPS_Transverse_Mercator::to_EN(double* E, double* N, double phi,
+                                    double lambda, double N0, double E0,
+                                    double phi0, double lambda0) const
+{
   double etasq;
   double nu;
   double rho;
@@ -559,40 +626,33 @@ void GPS_Math_LatLon_To_EN(double* E, double* N, double phi,
 
   double tmp;
   double tmp2;
-  double fdf;
-  double fde;
 
   phi0    = GPS_Math_Deg_To_Rad(phi0);
   lambda0 = GPS_Math_Deg_To_Rad(lambda0);
   phi     = GPS_Math_Deg_To_Rad(phi);
   lambda  = GPS_Math_Deg_To_Rad(lambda);
 
-  esq = ((a*a)-(b*b)) / (a*a);
-  n   = (a-b) / (a+b);
-
   tmp  = 1.0 - (esq * sin(phi) * sin(phi));
-  nu   = a * F0 * pow(tmp,-0.5);
-  rho  = a * F0 * (1.0 - esq) * pow(tmp,-1.5);
+  nu   = aF0 * pow(tmp,-0.5);
+  rho  = aF0esq * pow(tmp,-1.5);
   etasq = (nu / rho) - 1.0;
 
-  fdf   = 5.0 / 4.0;
-  tmp   = 1.0 + n + (fdf * n * n) + (fdf * n * n * n);
+  tmp   = m1;
   tmp  *= (phi - phi0);
-  tmp2  = 3.0*n + 3.0*n*n + (21./8.)*n*n*n;
+  tmp2  = m2;
   tmp2 *= (sin(phi-phi0) * cos(phi+phi0));
   tmp  -= tmp2;
 
-  fde   = (15.0 / 8.0);
-  tmp2  = ((fde*n*n) + (fde*n*n*n)) * sin(2.0 * (phi-phi0));
+  tmp2  = m3 * sin(2.0 * (phi-phi0));
   tmp2 *= cos(2.0 * (phi+phi0));
   tmp  += tmp2;
 
-  tmp2  = (35.0/24.0) * n * n * n;
+  tmp2  = m4;
   tmp2 *= sin(3.0 * (phi-phi0));
   tmp2 *= cos(3.0 * (phi+phi0));
   tmp  -= tmp2;
 
-  M     = b * F0 * tmp;
+  M     = bF0 * tmp;
   I     = M + N0;
   II    = (nu / 2.0) * sin(phi) * cos(phi);
   III   = (nu / 24.0) * sin(phi) * cos(phi) * cos(phi) * cos(phi);
@@ -647,7 +707,10 @@ void GPS_Math_Airy1830M_LatLonToINGEN(double phi, double lambda, double* E,
   constexpr double a       = Airy1830Modified_Ellipse.a;
   constexpr double b       = Airy1830Modified_Ellipse.b();
 
-  GPS_Math_LatLon_To_EN(E,N,phi,lambda,N0,E0,phi0,lambda0,F0,a,b);
+  static const GPS_Transverse_Mercator tm =
+    GPS_Math_Transverse_Mercator_Setup(F0,a,b);
+
+  tm.to_EN(E,N,phi,lambda,N0,E0,phi0,lambda0);
 
   return;
 }
@@ -678,7 +741,10 @@ void GPS_Math_Airy1830LatLonToNGEN(double phi, double lambda, double* E,
   constexpr double a       = Airy1830_Ellipse.a;
   constexpr double b       = Airy1830_Ellipse.b();
 
-  GPS_Math_LatLon_To_EN(E,N,phi,lambda,N0,E0,phi0,lambda0,F0,a,b);
+  static const GPS_Transverse_Mercator tm =
+    GPS_Math_Transverse_Mercator_Setup(F0,a,b);
+
+  tm.to_EN(E,N,phi,lambda,N0,E0,phi0,lambda0);
 
   return;
 }
@@ -717,7 +783,9 @@ int32_t GPS_Math_WGS84_To_Swiss_EN(double lat, double lon, double* E,
   constexpr double a = Bessel1841_Ellipse.a;
   constexpr double b = Bessel1841_Ellipse.b();
 
-  GPS_Math_WGS84_To_Known_Datum_M(lat, lon, 0, &phi, &lambda, &alt, 123);
+  static const GPS_Molodensky to_ch1903 = GPS_Math_WGS84_To_Known_Datum_Setup(123);
+
+  to_ch1903.convert(lat, lon, 0, &phi, &lambda, &alt);
   GPS_Math_Swiss_LatLon_To_EN(phi, lambda, E, N, phi0, lambda0, E0, N0, a, b);
 
   return 1;
@@ -747,8 +815,10 @@ void GPS_Math_Swiss_EN_To_WGS84(double E, double N, double* lat, double* lon)
   constexpr double a = Bessel1841_Ellipse.a;
   constexpr double b = Bessel1841_Ellipse.b();
 
+  static const GPS_Molodensky to_wgs84 = GPS_Math_Known_Datum_To_WGS84_Setup(123);
+
   GPS_Math_Swiss_EN_To_LatLon(E, N, &phi, &lambda, phi0, lambda0, E0, N0, a, b);
-  GPS_Math_Known_Datum_To_WGS84_M(phi, lambda, 0, lat, lon, &alt, 123);
+  to_wgs84.convert(phi, lambda, 0, lat, lon, &alt);
 }
 
 
@@ -1081,6 +1151,22 @@ void GPS_Math_Cassini_EN_To_LatLon(double E, double N, double* phi,
 
 
 
+/* @funcstatic GPS_Math_Palestine_Datum_Index ************************
+**
+** Datum number of Palestine 1923, looked up on the first call
+**
+** @return [int32] datum number from GPS_Datums structure
+************************************************************************/
+static int32_t GPS_Math_Palestine_Datum_Index()
+{
+  static const int32_t datum = GPS_Lookup_Datum_Index("Palestine 1923");
+  if (datum < 0) {
+    fatal("Unable to find Palestine 1923 in internal tables");
+  }
+  return datum;
+}
+
+
 /* @func int32 GPS_Math_WGS84_To_ICS_EN ******************************
 **
 ** Convert WGS84 latitude and longitude to
@@ -1104,16 +1190,14 @@ int32_t GPS_Math_WGS84_To_ICS_EN(double lat, double lon, double* E,
   constexpr double N0      = 1126867.909;
   double phi, lambda, alt, a, b;
 
-  int32_t datum = GPS_Lookup_Datum_Index("Palestine 1923");
-  if (datum < 0) {
-    fatal("Unable to find Palestine 1923 in internal tables");
-  }
+  int32_t datum = GPS_Math_Palestine_Datum_Index();
+  static const GPS_Molodensky to_datum = GPS_Math_WGS84_To_Known_Datum_Setup(datum);
   int32_t ellipse = GPS_Datums[datum].ellipse;
 
   a = GPS_Ellipses[ellipse].a;
   b = GPS_Ellipses[ellipse].b();
 
-  GPS_Math_WGS84_To_Known_Datum_M(lat, lon, 0, &phi, &lambda, &alt, datum);
+  to_datum.convert(lat, lon, 0, &phi, &lambda, &alt);
   GPS_Math_Cassini_LatLon_To_EN(phi, lambda, E, N,
                                 phi0, lambda0, E0, N0, a, b);
 
@@ -1140,10 +1224,8 @@ void GPS_Math_ICS_EN_To_WGS84(double E, double N, double* lat, double* lon)
   constexpr double E0      = 170251.555;
   constexpr double N0      = 1126867.909;
   double phi, lambda, alt, a, b;
-  int32_t datum = GPS_Lookup_Datum_Index("Palestine 1923");
-  if (datum < 0) {
-    fatal("Unable to find Palestine 1923 in internal tables");
-  }
+  int32_t datum = GPS_Math_Palestine_Datum_Index();
+  static const GPS_Molodensky to_wgs84 = GPS_Math_Known_Datum_To_WGS84_Setup(datum);
   int32_t ellipse = GPS_Datums[datum].ellipse;
 
   a = GPS_Ellipses[ellipse].a;
@@ -1151,7 +1233,7 @@ void GPS_Math_ICS_EN_To_WGS84(double E, double N, double* lat, double* lon)
 
   GPS_Math_Cassini_EN_To_LatLon(E, N, &phi, &lambda, phi0, lambda0,
                                 E0, N0, a, b);
-  GPS_Math_Known_Datum_To_WGS84_M(phi, lambda, 0, lat, lon, &alt, datum);
+  to_wgs84.convert(phi, lambda, 0, lat, lon, &alt);
 }
 
 
@@ -1457,12 +1539,70 @@ void GPS_Math_Molodensky(double Sphi, double Slam, double SH, double Sa,
                          double* DH, double Da, double Dif, double dx,
                          double dy, double dz)
 {
-  double Sf;
+  GPS_Math_Molodensky_Setup(Sa,Sif,Da,Dif,dx,dy,dz).convert(Sphi,Slam,SH,
+      Dphi,Dlam,DH);
+
+  return;
+}
+
+
+
+/* @func GPS_Math_Molodensky_Setup *************************************
+**
+** Work out the constants of a Molodensky transformation
+**
+** @param [r] Sa   [double] source semi-major axis (metres)
+** @param [r] Sif  [double] source inverse flattening
+** @param [r] Da   [double] dest semi-major axis (metres)
+** @param [r] Dif  [double] dest inverse flattening
+** @param [r] dx  [double]   dx
+** @param [r] dy  [double]   dy
+** @param [r] dz  [double]   dz
+**
+** @return [GPS_Molodensky] transformation
+************************************************************************/
+GPS_Molodensky GPS_Math_Molodensky_Setup(double Sa, double Sif, double Da,
+    double Dif, double dx, double dy,
+    double dz)
+{
+  GPS_Molodensky m;
   double Df;
-  double esq;
-  double bda;
-  double da;
-  double df;
+
+  m.Sf = 1.0 / Sif;
+  Df = 1.0 / Dif;
+
+  m.esq = 2.0*m.Sf - pow(m.Sf,2.0);
+  m.bda = 1.0 - m.Sf;
+
+  m.Sa = Sa;
+  m.da = Da - Sa;
+  m.df = Df - m.Sf;
+
+  m.dx = dx;
+  m.dy = dy;
+  m.dz = dz;
+
+  return m;
+}
+
+
+
+/* @func GPS_Molodensky::convert ***************************************
+**
+** Transform a point with a Molodensky transformation
+**
+** @param [r] Sphi [double] source latitude (deg)
+** @param [r] Slam [double] source longitude (deg)
+** @param [r] SH   [double] source height  (metres)
+** @param [w] Dphi [double *] dest latitude (deg)
+** @param [w] Dlam [double *] dest longitude (deg)
+** @param [w] DH   [double *] dest height  (metres)
+**
+** @return [void]
+************************************************************************/
+void GPS_Molodensky::convert(double Sphi, double Slam, double SH,
+                             double* Dphi, double* Dlam, double* DH) const
+{
   double N;
   double M;
   double tmp;
@@ -1475,17 +1615,9 @@ void GPS_Math_Molodensky(double Sphi, double Slam, double SH, double Sa,
   double lams;
   double lamc;
 
-  Sf = 1.0 / Sif;
-  Df = 1.0 / Dif;
-
-  esq = 2.0*Sf - pow(Sf,2.0);
-  bda = 1.0 - Sf;
   Sphi = GPS_Math_Deg_To_Rad(Sphi);
   Slam = GPS_Math_Deg_To_Rad(Slam);
 
-  da = Da - Sa;
-  df = Df - Sf;
-
   phis = sin(Sphi);
   phic = cos(Sphi);
   lams = sin(Slam);
@@ -1517,6 +1649,41 @@ void GPS_Math_Molodensky(double Sphi, double Slam, double SH, double Sa,
 }
 
 
+
+/* @func GPS_Molodensky::convert ***************************************
+**
+** Transform an array of points with a Molodensky transformation.
+** The destination arrays may be the source arrays.  If SH is null
+** every height is taken as zero, and if DH is null the dest heights
+** are dropped.
+**
+** @param [r] Sphi [const double *] source latitudes (deg)
+** @param [r] Slam [const double *] source longitudes (deg)
+** @param [r] SH   [const double *] source heights  (metres)
+** @param [w] Dphi [double *] dest latitudes (deg)
+** @param [w] Dlam [double *] dest longitudes (deg)
+** @param [w] DH   [double *] dest heights  (metres)
+** @param [r] count [int32] number of points
+**
+** @return [void]
+************************************************************************/
+void GPS_Molodensky::convert(const double* Sphi, const double* Slam,
+                             const double* SH, double* Dphi, double* Dlam,
+                             double* DH, int32_t count) const
+{
+  for (int32_t i = 0; i < count; ++i) {
+    double height;
+    convert(Sphi[i], Slam[i], (SH != nullptr) ? SH[i] : 0.0,
+            &Dphi[i], &Dlam[i], &height);
+    if (DH != nullptr) {
+      DH[i] = height;
+    }
+  }
+
+  return;
+}
+
+
 /* @func GPS_Math_Helmert *******************************************
 **
 ** Transform one datum to another
@@ -1625,6 +1792,23 @@ void GPS_Math_Inverse_Helmert(double Sx, double Sy, double Sz,
 void GPS_Math_Known_Datum_To_WGS84_M(double Sphi, double Slam, double SH,
                                      double* Dphi, double* Dlam, double* DH,
                                      int32_t n)
+{
+  GPS_Math_Known_Datum_To_WGS84_Setup(n).convert(Sphi,Slam,SH,Dphi,Dlam,DH);
+
+  return;
+}
+
+
+
+/* @func GPS_Math_Known_Datum_To_WGS84_Setup ******************************
+**
+** Molodensky transformation from datum to WGS84
+**
+** @param [r] n    [int32] datum number from GPS_Datums structure
+**
+** @return [GPS_Molodensky] transformation
+************************************************************************/
+GPS_Molodensky GPS_Math_Known_Datum_To_WGS84_Setup(int32_t n)
 {
   double Sa;
   double Sif;
@@ -1643,9 +1827,7 @@ void GPS_Math_Known_Datum_To_WGS84_M(double Sphi, double Slam, double SH,
   y    = GPS_Datums[n].dy;
   z    = GPS_Datums[n].dz;
 
-  GPS_Math_Molodensky(Sphi,Slam,SH,Sa,Sif,Dphi,Dlam,DH,Da,Dif,x,y,z);
-
-  return;
+  return GPS_Math_Molodensky_Setup(Sa,Sif,Da,Dif,x,y,z);
 }
 
 
@@ -1667,6 +1849,23 @@ void GPS_Math_Known_Datum_To_WGS84_M(double Sphi, double Slam, double SH,
 void GPS_Math_WGS84_To_Known_Datum_M(double Sphi, double Slam, double SH,
                                      double* Dphi, double* Dlam, double* DH,
                                      int32_t n)
+{
+  GPS_Math_WGS84_To_Known_Datum_Setup(n).convert(Sphi,Slam,SH,Dphi,Dlam,DH);
+
+  return;
+}
+
+
+
+/* @func GPS_Math_WGS84_To_Known_Datum_Setup ******************************
+**
+** Molodensky transformation from WGS84 to other datum
+**
+** @param [r] n    [int32] datum number from GPS_Datums structure
+**
+** @return [GPS_Molodensky] transformation
+************************************************************************/
+GPS_Molodensky GPS_Math_WGS84_To_Known_Datum_Setup(int32_t n)
 {
   double Da;
   double Dif;
@@ -1685,9 +1884,7 @@ void GPS_Math_WGS84_To_Known_Datum_M(double Sphi, double Slam, double SH,
   y    = -GPS_Datums[n].dy;
   z    = -GPS_Datums[n].dz;
 
-  GPS_Math_Molodensky(Sphi,Slam,SH,Sa,Sif,Dphi,Dlam,DH,Da,Dif,x,y,z);
-
-  return;
+  return GPS_Math_Molodensky_Setup(Sa,Sif,Da,Dif,x,y,z);
 }
 
 
@@ -1816,6 +2013,25 @@ void GPS_Math_WGS84_To_Known_Datum_C(double Sphi, double Slam, double SH,
 void GPS_Math_Known_Datum_To_Known_Datum_M(double Sphi, double Slam, double SH,
     double* Dphi, double* Dlam,
     double* DH, int32_t n1, int32_t n2)
+{
+  GPS_Math_Known_Datum_To_Known_Datum_Setup(n1,n2).convert(Sphi,Slam,SH,
+      Dphi,Dlam,DH);
+
+  return;
+}
+
+
+
+/* @func GPS_Math_Known_Datum_To_Known_Datum_Setup *********************
+**
+** Molodensky transformation from known datum to other datum
+**
+** @param [r] n1   [int32] source datum number from GPS_Datums structure
+** @param [r] n2   [int32] dest   datum number from GPS_Datums structure
+**
+** @return [GPS_Molodensky] transformation
+************************************************************************/
+GPS_Molodensky GPS_Math_Known_Datum_To_Known_Datum_Setup(int32_t n1, int32_t n2)
 {
   double Sa;
   double Sif;
@@ -1853,9 +2069,7 @@ void GPS_Math_Known_Datum_To_Known_Datum_M(double Sphi, double Slam, double SH,
   y = -(y2-y1);
   z = -(z2-z1);
 
-  GPS_Math_Molodensky(Sphi,Slam,SH,Sa,Sif,Dphi,Dlam,DH,Da,Dif,x,y,z);
-
-  return;
+  return GPS_Math_Molodensky_Setup(Sa,Sif,Da,Dif,x,y,z);
 }
 
 
@@ -2305,7 +2519,7 @@ static int32_t GPS_Math_LatLon_To_UTM_Param(double lat, double lon, int32_t* zon
   }
 
   *E0 = 500000.0;
-  *F0 = 0.9996;
+  *F0 = GPS_UTM_F0;
 
   return 1;
 }
@@ -2344,7 +2558,10 @@ int32_t GPS_Math_NAD83_To_UTM_EN(double lat, double lon, double* E,
   constexpr double a = GRS80_Ellipse.a;
   constexpr double b = GRS80_Ellipse.b();
 
-  GPS_Math_LatLon_To_EN(E,N,lat,lon,N0,E0,phi0,lambda0,F0,a,b);
+  static const GPS_Transverse_Mercator tm =
+    GPS_Math_Transverse_Mercator_Setup(GPS_UTM_F0,a,b);
+
+  tm.to_EN(E,N,lat,lon,N0,E0,phi0,lambda0);
 
   return 1;
 }
@@ -2371,7 +2588,9 @@ int32_t GPS_Math_WGS84_To_UTM_EN(double lat, double lon, double* E,
   double lambda;
   double H;
 
-  GPS_Math_WGS84_To_Known_Datum_M(lat,lon,0,&phi,&lambda,&H,77);
+  static const GPS_Molodensky to_nad83 = GPS_Math_WGS84_To_Known_Datum_Setup(77);
+
+  to_nad83.convert(lat,lon,0,&phi,&lambda,&H);
   if (!GPS_Math_NAD83_To_UTM_EN(phi,lambda,E,N,zone,zc)) {
     return 0;
   }
@@ -2415,7 +2634,7 @@ static int32_t GPS_Math_UTM_Param_To_Mc(int32_t zone, char zc, double* Mc,
   }
 
   *E0 = 500000.0;
-  *F0 = 0.9996;
+  *F0 = GPS_UTM_F0;
 
   return 1;
 }
@@ -2489,15 +2708,59 @@ int32_t GPS_Math_UTM_EN_To_WGS84(double* lat, double* lon, double E,
 ************************************************************************/
 int32_t GPS_Math_Known_Datum_To_UTM_EN(double lat, double lon, double* E,
                                        double* N, int32_t* zone, char* zc, const int n)
+{
+  return GPS_Math_Known_Datum_To_UTM_Setup(n).convert(lat,lon,E,N,zone,zc);
+}
+
+
+
+/* @func GPS_Math_Known_Datum_To_UTM_Setup ******************************
+**
+** UTM projection for a known datum
+**
+** @param [r] n    [int32] datum number from GPS_Datums structure
+**
+** @return [GPS_UTM] projection
+************************************************************************/
+GPS_UTM GPS_Math_Known_Datum_To_UTM_Setup(const int n)
+{
+  GPS_UTM utm;
+  double a;
+  double b;
+  int32_t idx;
+
+  idx  = GPS_Datums[n].ellipse;
+  a = GPS_Ellipses[idx].a;
+  b = GPS_Ellipses[idx].b();
+
+  utm.tm = GPS_Math_Transverse_Mercator_Setup(GPS_UTM_F0,a,b);
+
+  return utm;
+}
+
+
+
+/* @func GPS_UTM::convert **********************************************
+**
+** Transform lat/lon to UTM zone, easting and northing
+**
+** @param [r] lat  [double] latitude (deg)
+** @param [r] lon  [double] longitude (deg)
+** @param [w] E    [double *] easting (metres)
+** @param [w] N    [double *] northing (metres)
+** @param [w] zone [int32 *]  zone number
+** @param [w] zc   [char *] zone character
+**
+** @return [int32] success
+************************************************************************/
+int32_t GPS_UTM::convert(double lat, double lon, double* E, double* N,
+                         int32_t* zone, char* zc) const
 {
   double phi0;
   double lambda0;
   double N0;
   double E0;
   double F0;
-  double a;
-  double b;
-  int32_t idx;
 
   if (!GPS_Math_LatLon_To_UTM_Param(lat,lon,zone,zc,&lambda0,&E0,
                                     &N0,&F0)) {
@@ -2506,15 +2769,45 @@ int32_t GPS_Math_Known_Datum_To_UTM_EN(double lat, double lon, double* E,
 
   phi0 = 0.0;
 
-  idx  = GPS_Datums[n].ellipse;
-  a = GPS_Ellipses[idx].a;
-  b = GPS_Ellipses[idx].b();
-
-  GPS_Math_LatLon_To_EN(E,N,lat,lon,N0,E0,phi0,lambda0,F0,a,b);
+  tm.to_EN(E,N,lat,lon,N0,E0,phi0,lambda0);
 
   return 1;
 }
 
+
+
+/* @func GPS_UTM::convert **********************************************
+**
+** Transform arrays of lat/lon to UTM zones, eastings and northings.
+** A point outside UTM gets zone 0 and leaves its other outputs alone.
+**
+** @param [r] lat  [const double *] latitudes (deg)
+** @param [r] lon  [const double *] longitudes (deg)
+** @param [w] E    [double *] eastings (metres)
+** @param [w] N    [double *] northings (metres)
+** @param [w] zone [int32 *]  zone numbers
+** @param [w] zc   [char *] zone characters
+** @param [r] count [int32] number of points
+**
+** @return [int32] number of points converted
+************************************************************************/
+int32_t GPS_UTM::convert(const double* lat, const double* lon, double* E,
+                         double* N, int32_t* zone, char* zc,
+                         int32_t count) const
+{
+  int32_t converted = 0;
+
+  for (int32_t i = 0; i < count; ++i) {
+    if (convert(lat[i],lon[i],&E[i],&N[i],&zone[i],&zc[i])) {
+      ++converted;
+    } else {
+      zone[i] = 0;
+    }
+  }
+
+  return converted;
+}
+
 /* @func GPS_Math_UTM_EN_To_Known_Datum *********************************
 **
 ** Transform UTM zone, easting and northing to known datum lat/lon
@@ -2772,7 +3065,15 @@ void GPS_Math_UTM_EN_to_LatLon(int ReferenceEllipsoid,
 
 /********************************************************************/
 
-int32_t GPS_Lookup_Datum_Index(const char* n)
+/* @funcstatic GPS_Lookup_Datum_Index_Scan ***************************
+**
+** Look up a datum by name or alias, ignoring case, the slow way
+**
+** @param [r] n [const char *] datum name
+**
+** @return [int32] datum number from GPS_Datums structure or -1
+************************************************************************/
+static int32_t GPS_Lookup_Datum_Index_Scan(const char* n)
 {
   const GPS_Datum* dp;
   const GPS_Datum_Alias* al;
@@ -2792,6 +3093,44 @@ int32_t GPS_Lookup_Datum_Index(const char* n)
   return -1;
 }
 
+/*
+ * The datum names and aliases, in lower case, with the datum each one
+ * finds.  An alias wins over a datum name, and the first of two equal
+ * names wins, as in the scan.  All of them are ASCII.
+ */
+static const QHash<QByteArray, int32_t>& GPS_Datum_Index_Table()
+{
+  static const QHash<QByteArray, int32_t> table = [] {
+    QHash<QByteArray, int32_t> t;
+    for (const GPS_Datum_Alias* al = GPS_DatumAliases; al->alias; al++) {
+      QByteArray key = QByteArray(al->alias).toLower();
+      if (!t.contains(key)) {
+        t.insert(key, al->datum);
+      }
+    }
+    for (const GPS_Datum* dp = GPS_Datums; dp->name; dp++) {
+      QByteArray key = QByteArray(dp->name).toLower();
+      if (!t.contains(key)) {
+        t.insert(key, dp - GPS_Datums);
+      }
+    }
+    return t;
+  }();
+  return table;
+}
+
+int32_t GPS_Lookup_Datum_Index(const char* n)
+{
+  for (const char* p = n; *p; p++) {
+    if (static_cast<unsigned char>(*p) >= 0x80) {
+      // Unicode case folding takes a few of these to ASCII letters.
+      return GPS_Lookup_Datum_Index_Scan(n);
+    }
+  }
+
+  return GPS_Datum_Index_Table().value(QByteArray(n).toLower(), -1);
+}
+
 int32_t GPS_Lookup_Datum_Index(const QString& n)
 {
   return GPS_Lookup_Datum_Index(CSTR(n));
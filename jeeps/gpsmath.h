@@ -54,6 +54,28 @@ void GPS_Math_LatLon_To_EN(double* E, double* N, double phi,
                            double phi0, double lambda0,
                            double F0, double a, double b);
 
+/*
+ * A transverse Mercator projection with the constants that only depend
+ * on the ellipse and the scale factor worked out once.  to_EN gives
+ * exactly the result of GPS_Math_LatLon_To_EN with the same parameters.
+ */
+struct GPS_Transverse_Mercator {
+  double esq{};
+  double aF0{};
+  double aF0esq{};
+  double bF0{};
+  double m1{};
+  double m2{};
+  double m3{};
+  double m4{};
+
+  void to_EN(double* E, double* N, double phi, double lambda, double N0,
+             double E0, double phi0, double lambda0) const;
+};
+
+GPS_Transverse_Mercator GPS_Math_Transverse_Mercator_Setup(double F0,
+    double a, double b);
+
 void GPS_Math_NGENToAiry1830LatLon(double E, double N, double* phi,
                                    double* lambda);
 void GPS_Math_INGENToAiry1830MLatLon(double E, double N, double* phi,
@@ -73,6 +95,36 @@ void GPS_Math_Molodensky(double Sphi, double Slam, double SH, double Sa,
                          double Sif, double* Dphi, double* Dlam,
                          double* DH, double Da, double Dif, double dx,
                          double dy, double dz);
+
+/*
+ * A Molodensky transformation between two datums with the constants that
+ * only depend on the datums worked out once.  Converting a point gives
+ * exactly the result of GPS_Math_Molodensky with the same parameters.
+ */
+struct GPS_Molodensky {
+  double Sa{};
+  double Sf{};
+  double esq{};
+  double bda{};
+  double da{};
+  double df{};
+  double dx{};
+  double dy{};
+  double dz{};
+
+  void convert(double Sphi, double Slam, double SH,
+               double* Dphi, double* Dlam, double* DH) const;
+  void convert(const double* Sphi, const double* Slam, const double* SH,
+               double* Dphi, double* Dlam, double* DH, int32_t count) const;
+};
+
+GPS_Molodensky GPS_Math_Molodensky_Setup(double Sa, double Sif, double Da,
+    double Dif, double dx, double dy,
+    double dz);
+GPS_Molodensky GPS_Math_Known_Datum_To_WGS84_Setup(int32_t n);
+GPS_Molodensky GPS_Math_WGS84_To_Known_Datum_Setup(int32_t n);
+GPS_Molodensky GPS_Math_Known_Datum_To_Known_Datum_Setup(int32_t n1, int32_t n2);
+
 void GPS_Math_Helmert(double Sx, double Sy, double Sz,
                       double* Dx, double* Dy, double* Dz,
                       double tX, double tY, double tZ,
@@ -129,6 +181,22 @@ int32_t GPS_Math_UTM_EN_To_NAD83(double* lat, double* lon, double E,
 
 int32_t GPS_Math_Known_Datum_To_UTM_EN(double lat, double lon, double* E,
                                        double* N, int32_t* zone, char* zc, int n);
+
+/*
+ * UTM on the ellipse of one datum, for converting many points.  The zone
+ * is still found for each point, and the results are exactly those of
+ * GPS_Math_Known_Datum_To_UTM_EN.
+ */
+struct GPS_UTM {
+  GPS_Transverse_Mercator tm;
+
+  int32_t convert(double lat, double lon, double* E, double* N,
+                  int32_t* zone, char* zc) const;
+  int32_t convert(const double* lat, const double* lon, double* E,
+                  double* N, int32_t* zone, char* zc, int32_t count) const;
+};
+
+GPS_UTM GPS_Math_Known_Datum_To_UTM_Setup(int n);
 int32_t GPS_Math_UTM_EN_To_Known_Datum(double* lat, double* lon, double E,
                                        double N, int32_t zone, char zc, int n);
 
@@ -22,24 +22,29 @@
 
 #include "kml.h"
 
+#include <algorithm>                   // for min
 #include <cctype>                      // for tolower, toupper
 #include <cmath>                       // for fabs
-#include <cstdio>                      // for sscanf, printf
+#include <cstdio>                      // for printf
 #include <cstdlib>                     // for strtod
 #include <cstring>                     // for strcmp
 #include <optional>                    // for optional
 #include <tuple>                       // for tuple, make_tuple
+#include <utility>                     // for as_const
 
 #include <QByteArray>                  // for QByteArray
 #include <QChar>                       // for QChar
 #include <QDate>                       // for QDate
 #include <QDateTime>                   // for QDateTime
 #include <QFile>                       // for QFile
+#include <QFileInfo>                   // for QFileInfo
 #include <QHash>                       // for QHash
 #include <QIODevice>                   // for operator|, QIODevice, QIODevice::Text, QIODevice::WriteOnly
+#include <QLatin1Char>                 // for QLatin1Char
 #include <QList>                       // for QList
 #include <QString>                     // for QString, QStringLiteral, operator+, operator!=
 #include <QStringList>                 // for QStringList
+#include <QStringView>                 // for QStringView
 #include <QStringLiteral>              // for qMakeStringPrivate, QStringLit...
 #include <QVector>                     // for QVector
 #include <QXmlStreamAttributes>        // for QXmlStreamAttributes
@@ -50,12 +55,17 @@
 #include "igc.h"                       // For igc_fsdata
 #include "formspec.h"                  // for FsChainFind, kFsGpxm kFsIGC
 #include "geocache.h"                  // for Geocache, Geocache::type_t
-#include "grtcirc.h"                   // for RAD, gcdist, radtometers
+#include "grtcirc.h"                   // for RAD, gcdist, gcdist_meters_within, radtometers
 #include "src/core/datetime.h"         // for DateTime
 #include "src/core/file.h"             // for File
 #include "src/core/logging.h"          // for Warning, Fatal
+#include "src/core/memoryfile.h"       // for MemoryFiles
+#include "src/core/numeric.h"          // for scan_doubles, to_double
 #include "src/core/xmlstreamwriter.h"  // for XmlStreamWriter
 #include "src/core/xmltag.h"           // for xml_findfirst, xml_tag, fs_xml, xml_attribute, xml_findnext
+#ifdef MINIZIP_ENABLED
+#include "src/core/ziparchive.h"       // for ZipEntryReader, ZipEntryWriter
+#endif
 #include "units.h"                     // for UnitsFormatter, UnitsFormatter...
 #include "xmlgeneric.h"                // for cb_cdata, cb_end, cb_start, xg_callback, xg_cb_type, xml_deinit, xml_ignore_tags, xml_init, xml_read, xg_tag_mapping
 
@@ -199,20 +209,20 @@ void KmlFormat::wpt_ts_end(const QString& args, const QXmlStreamAttributes* /*at
 
 void KmlFormat::wpt_coord(const QString& args, const QXmlStreamAttributes* /*attrs*/)
 {
-  double lat;
-  double lon;
-  double alt;
   if (! wpt_tmp) {
     return;
   }
   // Alt is actually optional.
-  int n = sscanf(CSTRc(args), "%lf,%lf,%lf", &lon, &lat, &alt);
+  QStringView coords(args);
+  double values[3];
+  int n;
+  kml_scan_tuple(&coords, values, &n);
   if (n >= 2) {
-    wpt_tmp->latitude = lat;
-    wpt_tmp->longitude = lon;
+    wpt_tmp->latitude = values[1];
+    wpt_tmp->longitude = values[0];
   }
   if (n == 3) {
-    wpt_tmp->altitude = alt;
+    wpt_tmp->altitude = values[2];
   }
   wpt_tmp_queued = true;
 }
@@ -220,7 +230,7 @@ void KmlFormat::wpt_coord(const QString& args, const QXmlStreamAttributes* /*att
 void KmlFormat::wpt_icon(const QString& args, const QXmlStreamAttributes* /*attrs*/)
 {
   if (wpt_tmp)  {
-    wpt_tmp->icon_descr = args;
+    wpt_tmp->icon_descr = icon_pool.intern(args);
   }
 }
 
@@ -232,18 +242,25 @@ void KmlFormat::trk_coord(const QString& args, const QXmlStreamAttributes* /*att
   }
   track_add_head(trk_head);
 
-  const auto vecs = args.simplified().split(' ');
-  for (const auto& vec : vecs) {
-    const QStringList coords = vec.split(',');
-    auto csize = coords.size();
+  QStringView coords(args);
+  trk_head->waypoint_list.reserve(kml_count_tuples(coords));
+  while (true) {
+    QStringView vec = coords.trimmed();
+    double values[3];
+    int numbers;
+    int csize = kml_scan_tuple(&coords, values, &numbers);
+    if (csize == 0) {
+      break;
+    }
+    vec.truncate(coords.data() - vec.data());
     auto* trkpt = new Waypoint;
 
     if (csize == 3) {
-      trkpt->altitude = coords[2].toDouble();
+      trkpt->altitude = values[2];
     }
     if (csize == 2 || csize == 3) {
-      trkpt->latitude = coords[1].toDouble();
-      trkpt->longitude = coords[0].toDouble();
+      trkpt->latitude = values[1];
+      trkpt->longitude = values[0];
     } else {
       Warning() << MYNAME << ": malformed coordinates " << vec;
     }
@@ -296,34 +313,11 @@ void KmlFormat::gx_trk_e(const QString& /*args*/, const QXmlStreamAttributes* /*
 {
   // Check that for every temporal value (kml:when) in a kml:Track there is a position (kml:coord) value.
   // Check that for every temporal value (kml:when) in a gx:Track there is a position (gx:coord) value.
+  // The pairs have been taken as they arrived, so anything left over is unmatched.
   if (gx_trk_times->size() != gx_trk_coords->size()) {
     fatal(MYNAME ": There were more coord elements than the number of when elements.\n");
   }
 
-  // In KML 2.3 kml:Track elements kml:coord and kml:when elements are not required to be in any order.
-  // In gx:Track elements all kml:when elements are required to precede all gx:coord elements.
-  // For both we allow any order.  Many writers using gx:Track elements don't adhere to the schema.
-  while (!gx_trk_times->isEmpty()) {
-    auto* trkpt = new Waypoint;
-    trkpt->SetCreationTime(gx_trk_times->takeFirst());
-    auto [n, lat, lon, alt] = gx_trk_coords->takeFirst();
-    // An empty kml:coord element is permitted to indicate missing position data;
-    // the estimated position may be determined using some interpolation method.
-    // However if we get one we will throw away the time as we don't have a location.
-    // It is not clear that coord elements without altitude are allowed, but our
-    // writer produces them.
-    if (n >= 2) {
-      trkpt->latitude = lat;
-      trkpt->longitude = lon;
-      if (n >= 3) {
-        trkpt->altitude = alt;
-      }
-      track_add_wpt(gx_trk_head, trkpt);
-    } else {
-      delete trkpt;
-    }
-  }
-
   if (!gx_trk_head->rte_waypt_ct()) {
     track_del_head(gx_trk_head);
   }
@@ -333,12 +327,44 @@ void KmlFormat::gx_trk_e(const QString& /*args*/, const QXmlStreamAttributes* /*
   gx_trk_coords = nullptr;
 }
 
+/*
+ * In KML 2.3 kml:Track elements kml:coord and kml:when elements are not required to be in any order.
+ * In gx:Track elements all kml:when elements are required to precede all gx:coord elements.
+ * For both we allow any order.  Many writers using gx:Track elements don't adhere to the schema.
+ * A point is added as soon as both of its halves have been read, the i-th when going with
+ * the i-th coord, so only the halves still waiting for their partner are kept.
+ */
+void KmlFormat::gx_trk_add(const gpsbabel::DateTime& time, const std::tuple<int, double, double, double>& coord)
+{
+  auto [n, lat, lon, alt] = coord;
+  // An empty kml:coord element is permitted to indicate missing position data;
+  // the estimated position may be determined using some interpolation method.
+  // However if we get one we will throw away the time as we don't have a location.
+  // It is not clear that coord elements without altitude are allowed, but our
+  // writer produces them.
+  if (n >= 2) {
+    auto* trkpt = new Waypoint;
+    trkpt->SetCreationTime(time);
+    trkpt->latitude = lat;
+    trkpt->longitude = lon;
+    if (n >= 3) {
+      trkpt->altitude = alt;
+    }
+    track_add_wpt(gx_trk_head, trkpt);
+  }
+}
+
 void KmlFormat::gx_trk_when(const QString& args, const QXmlStreamAttributes* /*attrs*/)
 {
   if (! gx_trk_times) {
     fatal(MYNAME ": gx_trk_when: invalid kml file\n");
   }
-  gx_trk_times->append(xml_parse_time(args));
+  gpsbabel::DateTime time = xml_parse_time(args);
+  if (!gx_trk_coords->isEmpty()) {
+    gx_trk_add(time, gx_trk_coords->takeFirst());
+  } else {
+    gx_trk_times->append(time);
+  }
 }
 
 void KmlFormat::gx_trk_coord(const QString& args, const QXmlStreamAttributes* /*attrs*/)
@@ -347,31 +373,156 @@ void KmlFormat::gx_trk_coord(const QString& args, const QXmlStreamAttributes* /*
     fatal(MYNAME ": gx_trk_coord: invalid kml file\n");
   }
 
-  double lat;
-  double lon;
-  double alt;
-  int n = sscanf(CSTR(args), "%lf %lf %lf", &lon, &lat, &alt);
+  double values[3] = {};
+  int n = gpsbabel::scan_doubles(args, values, 3);
+  if (n == 0 && QStringView(args).trimmed().isEmpty()) {
+    n = EOF;
+  }
   if (EOF != n && 2 != n && 3 != n) {
     fatal(MYNAME ": coord field decode failure on \"%s\".\n", qPrintable(args));
   }
-  gx_trk_coords->append(std::make_tuple(n, lat, lon, alt));
+  auto coord = std::make_tuple(n, values[1], values[0], values[2]);
+  if (!gx_trk_times->isEmpty()) {
+    gx_trk_add(gx_trk_times->takeFirst(), coord);
+  } else {
+    gx_trk_coords->append(coord);
+  }
+}
+
+/*
+ * Reads the next "lon,lat[,alt]" tuple of a coordinates list from *s,
+ * leaving *s just after it, and returns how many fields it had, 0 at the
+ * end of the list.  The first three fields are stored in values, a field
+ * that isn't a number as 0.  numbers counts the leading fields that were
+ * numbers, so it matches what sscanf("%lf,%lf,%lf") would return.
+ * Tuples are separated by white space, which is also tolerated after a
+ * comma.
+ */
+int KmlFormat::kml_scan_tuple(QStringView* s, double* values, int* numbers)
+{
+  QStringView p = s->trimmed();
+  int fields = 0;
+  *numbers = 0;
+  if (p.isEmpty()) {
+    *s = p;
+    return 0;
+  }
+  while (true) {
+    qsizetype len = 0;
+    while ((len < p.size()) && (p.at(len) != ',') && !p.at(len).isSpace()) {
+      ++len;
+    }
+    bool ok;
+    double value = gpsbabel::to_double(p.first(len), &ok);
+    if (fields < 3) {
+      values[fields] = value;
+    }
+    if (ok && (*numbers == fields)) {
+      ++*numbers;
+    }
+    ++fields;
+    p = p.sliced(len);
+    if (p.isEmpty() || (p.front() != ',')) {
+      break;
+    }
+    p = p.sliced(1);
+    while (!p.isEmpty() && p.front().isSpace()) {
+      p = p.sliced(1);
+    }
+  }
+  *numbers = std::min(*numbers, 3);
+  *s = p;
+  return fields;
+}
+
+/* The number of tuples kml_scan_tuple will find in s. */
+int KmlFormat::kml_count_tuples(QStringView s)
+{
+  int count = 0;
+  bool in_tuple = false;
+  bool after_comma = false;
+  for (QChar c : s) {
+    if (c.isSpace()) {
+      in_tuple = in_tuple && after_comma;
+    } else {
+      if (!in_tuple) {
+        ++count;
+        in_tuple = true;
+      }
+      after_comma = (c == ',');
+    }
+  }
+  return count;
+}
+
+/*
+ * A KMZ file is a zip archive.  The document is its doc.kml member or,
+ * failing that, the first .kml member.  Output is told by the extension,
+ * input also by the zip signature.
+ */
+bool KmlFormat::kml_is_kmz(const QString& fname, bool reading)
+{
+  if ((fname == '-') || gpsbabel::MemoryFiles::contains(fname)) {
+    return false;
+  }
+  if (fname.endsWith(u".kmz", Qt::CaseInsensitive)) {
+    return true;
+  }
+  if (!reading) {
+    return false;
+  }
+  QFile file(fname);
+  return file.open(QIODevice::ReadOnly) && (file.read(4) == QByteArrayLiteral("PK\x03\x04"));
 }
 
 void KmlFormat::rd_init(const QString& fname)
 {
   xml_reader = new XmlGenericReader;
   xml_reader->xml_init(fname, this, kml_map, nullptr, kml_tags_to_ignore, kml_tags_to_skip);
+
+  if (kml_is_kmz(fname, true)) {
+#ifdef MINIZIP_ENABLED
+    auto* zip = new ZipEntryReader(fname);
+    kmz_reader = zip;
+    if (!zip->isValid()) {
+      fatal(MYNAME ": '%s' is not a valid KMZ archive.\n", qPrintable(fname));
+    }
+    QString doc;
+    const QStringList entries = zip->entries();
+    for (const auto& entry : entries) {
+      if (entry.compare(u"doc.kml", Qt::CaseInsensitive) == 0) {
+        doc = entry;
+        break;
+      }
+      if (doc.isEmpty() && entry.endsWith(u".kml", Qt::CaseInsensitive)) {
+        doc = entry;
+      }
+    }
+    if (doc.isEmpty() || !zip->openEntry(doc)) {
+      fatal(MYNAME ": No KML document found in '%s'.\n", qPrintable(fname));
+    }
+#else
+    fatal(MYNAME ": KMZ support was not included in this build.\n");
+#endif
+  }
 }
 
 void KmlFormat::read()
 {
-  xml_reader->xml_read();
+  if (kmz_reader) {
+    xml_reader->xml_read(kmz_reader);
+  } else {
+    xml_reader->xml_read();
+  }
 }
 
 void KmlFormat::rd_deinit()
 {
+  delete kmz_reader;
+  kmz_reader = nullptr;
   delete xml_reader;
   xml_reader = nullptr;
+  icon_pool.clear();
 }
 
 void KmlFormat::wr_init(const QString& fname)
@@ -406,8 +557,19 @@ void KmlFormat::wr_init(const QString& fname)
   /*
    * Reduce race conditions with network read link.
    */
-  oqfile = new gpsbabel::File(fname);
-  oqfile->open(QIODevice::WriteOnly | QIODevice::Text);
+  if (kml_is_kmz(fname, false)) {
+#ifdef MINIZIP_ENABLED
+    oqfile = new ZipEntryWriter(fname, QStringLiteral("doc.kml"));
+    if (!oqfile->open(QIODevice::WriteOnly)) {
+      fatal(MYNAME ": Cannot create KMZ archive '%s'.\n", qPrintable(fname));
+    }
+#else
+    fatal(MYNAME ": KMZ support was not included in this build.\n");
+#endif
+  } else {
+    oqfile = new gpsbabel::File(fname);
+    oqfile->open(QIODevice::WriteOnly | QIODevice::Text);
+  }
 
   writer = new gpsbabel::XmlStreamWriter(oqfile);
   writer->setAutoFormattingIndent(2);
@@ -423,6 +585,15 @@ void KmlFormat::wr_position_init(const QString& fname)
   posnfilenametmp = QStringLiteral("%1-").arg(fname);
   realtime_positioning = true;
   max_position_points = xstrtoi(opt_max_position_points, nullptr, 10);
+  position_chunk = xstrtoi(opt_position_chunk, nullptr, 10);
+  if (position_chunk == 1) {
+    fatal(MYNAME ": position_chunk must be 0 or at least 2.\n");
+  }
+  posn_master = fname;
+  posn_base = fname;
+  if (posn_base.endsWith(QLatin1String(".kml"), Qt::CaseInsensitive)) {
+    posn_base.chop(4);
+  }
 }
 
 void KmlFormat::wr_deinit()
@@ -453,6 +624,10 @@ void KmlFormat::wr_position_deinit()
 //	kml_wr_deinit();
   posnfilename.clear();
   posnfilenametmp.clear();
+  posn_master.clear();
+  posn_base.clear();
+  posn_chunks.clear();
+  posn_chunk_count = 0;
 
   kml_track_traits.reset();
   kml_track_traits_hash.clear();
@@ -1236,13 +1411,13 @@ QString KmlFormat::kml_geocache_get_logs(const Waypoint* wpt)
 {
   QString r;
 
-  const auto* fs_gpx = reinterpret_cast<fs_xml*>(wpt->fs.FsChainFind(kFsGpx));
+  const auto* fs_gpx = reinterpret_cast<const fs_xml*>(wpt->fs.FsChainFind(kFsGpx));
 
-  if (!fs_gpx) {
+  if (!fs_gpx || !fs_gpx->tree()) {
     return r;
   }
 
-  XmlTag* root = fs_gpx->tag;
+  XmlTag* root = fs_gpx->tree();
   XmlTag* curlog = root->xml_findfirst(u"groundspeak:log");
   while (curlog) {
     // Unless we have a broken GPX input, these logparts
@@ -1377,8 +1552,8 @@ void KmlFormat::kml_geocache_pr(const Waypoint* waypointp) const
 
   kml_write_data_element("gc_type", waypointp->gc_data->get_type());
   kml_write_data_element("gc_icon", is);
-  kml_write_cdata_element("gc_short_desc", waypointp->gc_data->desc_short.utf_string);
-  kml_write_cdata_element("gc_long_desc", waypointp->gc_data->desc_long.utf_string);
+  kml_write_cdata_element("gc_short_desc", waypointp->gc_data->desc_short.get_text());
+  kml_write_cdata_element("gc_long_desc", waypointp->gc_data->desc_long.get_text());
   QString logs = kml_geocache_get_logs(waypointp);
   kml_write_cdata_element("gc_logs", logs);
 
@@ -1491,75 +1666,52 @@ void KmlFormat::kml_track_tlr(const route_head* header)
 /*
  * New for 2010, Earth adds "MultiTrack" as an extension.
  * Unlike every other format, we do the bulk of the work in the header
- * callback as we have to make multiple passes over the track queues.
+ * callback as the track is written as a series of parallel arrays.
  */
 
-void KmlFormat::kml_mt_simple_array(const route_head* header,
-                                    const QString& name,
-                                    wp_field member) const
-{
-  writer->writeStartElement(QStringLiteral("gx:SimpleArrayData"));
-  writer->writeAttribute(QStringLiteral("name"), name);
-  if (global_opts.debug_level >= 3) {
-    printf(MYNAME ": New KML SimpleArray: %s\n", qPrintable(name));
-  }
-  foreach (const Waypoint* wpt, header->waypoint_list) {
-    const auto* fs_igc = reinterpret_cast<igc_fsdata*>(wpt->fs.FsChainFind(kFsIGC));
-    switch (member) {
-    case wp_field::power:
-      writer->writeTextElement(QStringLiteral("gx:value"), wpt->power?
-                               QString::number(wpt->power, 'f', 1) : QString());
-      break;
-    case wp_field::cadence:
-      writer->writeTextElement(QStringLiteral("gx:value"), wpt->cadence?
-                               QString::number(wpt->cadence) : QString());
-      break;
-    case wp_field::depth:
-      writer->writeTextElement(QStringLiteral("gx:value"), wpt->depth_has_value()?
-                               QString::number(wpt->depth_value(), 'f', 1) : QString());
-      break;
-    case wp_field::heartrate:
-      writer->writeTextElement(QStringLiteral("gx:value"), wpt->heartrate?
-                               QString::number(wpt->heartrate) : QString());
-      break;
-    case wp_field::temperature:
-      writer->writeTextElement(QStringLiteral("gx:value"), wpt->temperature_has_value()?
-                               QString::number(wpt->temperature_value(), 'f', 1) : QString());
-      break;
-    case wp_field::sat:
-      writer->writeTextElement(QStringLiteral("gx:value"), wpt->sat >= 0?
-                               QString::number(wpt->sat) : QString());
-      break;
-    case wp_field::igc_enl:
-    case wp_field::igc_tas:
-    case wp_field::igc_vat:
-    case wp_field::igc_oat:
-    case wp_field::igc_trt:
-    case wp_field::igc_gsp:
-    case wp_field::igc_fxa:
-    case wp_field::igc_gfo:
-    case wp_field::igc_siu:
-    case wp_field::igc_acz:
-      if (fs_igc && fs_igc->get_value(member).has_value()) {
-        double value = fs_igc->get_value(member).value();
-        if (global_opts.debug_level >= 6) {
-          printf(MYNAME ": Writing KML SimpleArray data: %s of %f\n", qPrintable(name), value);
-        }
-        writer->writeTextElement(QStringLiteral("gx:value"), QString::number(value));
-        // No igc_fsdata present, but we still need to write out the SimpleArray.
-        // This can happen when merging tracks with different sets of IGC extensions.
-      } else {
-        if (global_opts.debug_level >= 7) {
-          printf(MYNAME ": Writing empty KML SimpleArray data for %s\n", qPrintable(name));
-        }
-        writer->writeTextElement(QStringLiteral("gx:value"), QString());
+QString KmlFormat::kml_mt_value(const Waypoint* wpt, const QString& name, wp_field member)
+{
+  const auto* fs_igc = reinterpret_cast<const igc_fsdata*>(wpt->fs.FsChainFind(kFsIGC));
+  switch (member) {
+  case wp_field::power:
+    return wpt->power? QString::number(wpt->power, 'f', 1) : QString();
+  case wp_field::cadence:
+    return wpt->cadence? QString::number(wpt->cadence) : QString();
+  case wp_field::depth:
+    return wpt->depth_has_value()? QString::number(wpt->depth_value(), 'f', 1) : QString();
+  case wp_field::heartrate:
+    return wpt->heartrate? QString::number(wpt->heartrate) : QString();
+  case wp_field::temperature:
+    return wpt->temperature_has_value()? QString::number(wpt->temperature_value(), 'f', 1) : QString();
+  case wp_field::sat:
+    return wpt->sat >= 0? QString::number(wpt->sat) : QString();
+  case wp_field::igc_enl:
+  case wp_field::igc_tas:
+  case wp_field::igc_vat:
+  case wp_field::igc_oat:
+  case wp_field::igc_trt:
+  case wp_field::igc_gsp:
+  case wp_field::igc_fxa:
+  case wp_field::igc_gfo:
+  case wp_field::igc_siu:
+  case wp_field::igc_acz:
+    if (fs_igc && fs_igc->get_value(member).has_value()) {
+      double value = fs_igc->get_value(member).value();
+      if (global_opts.debug_level >= 6) {
+        printf(MYNAME ": Writing KML SimpleArray data: %s of %f\n", qPrintable(name), value);
       }
-      break;
-    default:
-      fatal("Bad member type");
+      return QString::number(value);
+      // No igc_fsdata present, but we still need to write out the SimpleArray.
+      // This can happen when merging tracks with different sets of IGC extensions.
+    } else {
+      if (global_opts.debug_level >= 7) {
+        printf(MYNAME ": Writing empty KML SimpleArray data for %s\n", qPrintable(name));
+      }
+      return QString();
     }
+  default:
+    fatal("Bad member type");
   }
-  writer->writeEndElement(); // Close SimpleArrayData tag
 }
 
 // True if at least two points in the track have timestamps.
@@ -1593,7 +1745,7 @@ void KmlFormat::kml_accumulate_track_traits(const route_head* rte)
   track_trait_t track_traits;
 
   foreach (const Waypoint* tpt, rte->waypoint_list) {
-    const auto* fs_igc = reinterpret_cast<igc_fsdata*>(tpt->fs.FsChainFind(kFsIGC));
+    const auto* fs_igc = reinterpret_cast<const igc_fsdata*>(tpt->fs.FsChainFind(kFsIGC));
 
     // Capture interesting traits to see if we need to do an ExtendedData
     // section later.
@@ -1680,45 +1832,67 @@ void KmlFormat::kml_mt_hdr(const route_head* header)
   writer->writeStartElement(QStringLiteral("gx:Track"));
   kml_output_positioning(false);
 
-  foreach (const Waypoint* tpt, header->waypoint_list) {
+  // Walk the track once.  The when elements come first, so they are
+  // written on the way, while the other arrays are kept until their turn
+  // as one text each, with a line per point.
+  QList<const mt_field_t*> fields;
+  auto track_traits = kml_track_traits_hash.value(header);
+  for (const auto& flddef : mt_fields_def) {
+    if (track_traits[static_cast<int>(flddef.id)]) {
+      fields.append(&flddef);
+    }
+  }
+  QString coords;
+  QList<QString> values(fields.size());
 
+  // TODO: How to handle clamped, floating, extruded, etc.?
+  foreach (const Waypoint* tpt, header->waypoint_list) {
     if (tpt->GetCreationTime().isValid()) {
       QString time_string = tpt->CreationTimeXML();
-      writer->writeOptionalTextElement(QStringLiteral("when"), time_string);
+      writer->writeOptionalTextElement(QStringLiteral("when"), time_string.isNull() ? QStringLiteral("") : time_string);
     } else {
       writer->writeStartElement(QStringLiteral("when"));
       writer->writeEndElement(); // Close when tag
     }
-  }
-
-  // TODO: How to handle clamped, floating, extruded, etc.?
-  foreach (const Waypoint* tpt, header->waypoint_list) {
 
+    coords += QString::number(tpt->longitude, 'f', precision);
+    coords += QLatin1Char(' ');
+    coords += QString::number(tpt->latitude, 'f', precision);
     if (kml_altitude_known(tpt)) {
-      writer->writeTextElement(QStringLiteral("gx:coord"),
-                               QString::number(tpt->longitude, 'f', precision) + QString(" ") +
-                               QString::number(tpt->latitude, 'f', precision) + QString(" ") +
-                               QString::number(tpt->altitude, 'f', 2)
-                              );
-    } else {
-      writer->writeTextElement(QStringLiteral("gx:coord"),
-                               QString::number(tpt->longitude, 'f', precision) + QString(" ") +
-                               QString::number(tpt->latitude, 'f', precision)
-                              );
+      coords += QLatin1Char(' ');
+      coords += QString::number(tpt->altitude, 'f', 2);
+    }
+    coords += QLatin1Char('\n');
+
+    for (qsizetype i = 0; i < fields.size(); ++i) {
+      values[i] += kml_mt_value(tpt, fields.at(i)->name, fields.at(i)->id);
+      values[i] += QLatin1Char('\n');
     }
   }
 
+  auto write_lines = [this](const QString& name, QStringView text)->void {
+    while (!text.isEmpty()) {
+      const qsizetype eol = text.indexOf(QLatin1Char('\n'));
+      writer->writeTextElement(name, text.first(eol).toString());
+      text = text.sliced(eol + 1);
+    }
+  };
+  write_lines(QStringLiteral("gx:coord"), coords);
+  coords.clear();
 
-  auto track_traits = kml_track_traits_hash.value(header);
-  if (track_traits.any()) {
+  if (!fields.isEmpty()) {
     writer->writeStartElement(QStringLiteral("ExtendedData"));
     writer->writeStartElement(QStringLiteral("SchemaData"));
     writer->writeAttribute(QStringLiteral("schemaUrl"), QStringLiteral("#schema"));
 
-    for (const auto& flddef : mt_fields_def) {
-      if (track_traits[static_cast<int>(flddef.id)]) {
-        kml_mt_simple_array(header, flddef.name, flddef.id);
+    for (qsizetype i = 0; i < fields.size(); ++i) {
+      writer->writeStartElement(QStringLiteral("gx:SimpleArrayData"));
+      writer->writeAttribute(QStringLiteral("name"), fields.at(i)->name);
+      if (global_opts.debug_level >= 3) {
+        printf(MYNAME ": New KML SimpleArray: %s\n", qPrintable(fields.at(i)->name));
       }
+      write_lines(QStringLiteral("gx:value"), values.at(i));
+      writer->writeEndElement(); // Close SimpleArrayData tag
     }
 
     writer->writeEndElement(); // Close SchemaData tag
@@ -1765,11 +1939,21 @@ void KmlFormat::kml_write_AbstractView()
   if (waypt_count()) {
     waypt_disp_all(kml_add_to_bounds_lambda);
   }
+  // Routes and tracks keep their extent, so merging those gives the
+  // same result as adding their points in turn.
+  auto kml_add_route_to_bounds_lambda = [this](const route_head* rte)->void {
+    const route_extent& extent = rte->extent();
+    waypt_merge_bounds(&kml_bounds, extent.bbox);
+    if (extent.earliest != nullptr) {
+      kml_recompute_time_bounds(extent.earliest);
+      kml_recompute_time_bounds(extent.latest);
+    }
+  };
   if (track_waypt_count())  {
-    track_disp_all(nullptr, nullptr, kml_add_to_bounds_lambda);
+    track_disp_all(kml_add_route_to_bounds_lambda, nullptr, nullptr);
   }
   if (route_waypt_count()) {
-    route_disp_all(nullptr, nullptr, kml_add_to_bounds_lambda);
+    route_disp_all(kml_add_route_to_bounds_lambda, nullptr, nullptr);
   }
 
   writer->writeStartElement(QStringLiteral("LookAt"));
@@ -2024,11 +2208,130 @@ QString KmlFormat::kml_get_posn_icon(int freshness)
   return ICON_NOSAT;
 }
 
+/*
+ * Start writing fname of the realtime files.  wr_deinit() replaces fname
+ * with the finished file in one step.
+ */
+void KmlFormat::kml_open_posn_file(const QString& fname)
+{
+  posnfilename = fname;
+  posnfilenametmp = QStringLiteral("%1-").arg(fname);
+  wr_init(posnfilenametmp);
+}
+
+/*
+ * A document of network links to the files hrefs, relative to the
+ * document, of which the last refreshing ones are reloaded as they
+ * change.
+ */
+void KmlFormat::kml_write_links(const QString& name, const QStringList& hrefs,
+                                const QStringList& names, int refreshing)
+{
+  writer->writeStartDocument();
+  writer->setAutoFormatting(true);
+  writer->writeStartElement(QStringLiteral("kml"));
+  writer->writeAttribute(QStringLiteral("xmlns"), QStringLiteral("http://www.opengis.net/kml/2.2"));
+  writer->writeStartElement(QStringLiteral("Document"));
+  writer->writeTextElement(QStringLiteral("name"), name);
+
+  for (int i = 0; i < hrefs.size(); ++i) {
+    writer->writeStartElement(QStringLiteral("NetworkLink"));
+    writer->writeTextElement(QStringLiteral("name"), names.at(i));
+    writer->writeStartElement(QStringLiteral("Link"));
+    writer->writeTextElement(QStringLiteral("href"), QFileInfo(hrefs.at(i)).fileName());
+    if (i >= hrefs.size() - refreshing) {
+      writer->writeTextElement(QStringLiteral("refreshMode"), QStringLiteral("onInterval"));
+      writer->writeTextElement(QStringLiteral("refreshInterval"), QString::number(posn_refresh_seconds));
+    }
+    writer->writeEndElement(); // Close Link tag
+    writer->writeEndElement(); // Close NetworkLink tag
+  }
+
+  writer->writeEndElement(); // Close Document tag
+  writer->writeEndElement(); // Close kml tag
+}
+
+QString KmlFormat::kml_posn_chunk_name(int number) const
+{
+  return QStringLiteral("%1-%2.kml").arg(posn_base).arg(number, 4, 10, QChar('0'));
+}
+
+/*
+ * With position_chunk, wr_position writes the position and the newest
+ * part of the track to small files of their own, so a fix costs the
+ * same however long the track has grown.  The file given with -F links
+ * to the position and to an index of the parts, which only changes when
+ * a part is full and the next one, starting where it ended, begins.
+ */
+void KmlFormat::kml_write_posn_chunks(Waypoint* wpt)
+{
+  const QString position_name = posn_base + QStringLiteral("-position.kml");
+  const QString index_name = posn_base + QStringLiteral("-track.kml");
+
+  bool index_changed = false;
+  if (posn_chunks.isEmpty()) {
+    kml_open_posn_file(posn_master);
+    kml_write_links(QStringLiteral("GPS position"), {position_name, index_name},
+                    {QStringLiteral("Position"), QStringLiteral("Track")}, 2);
+    wr_deinit();
+    posn_chunks.append(kml_posn_chunk_name(++posn_chunk_count));
+    index_changed = true;
+  }
+
+  // The position, without the track.
+  RouteList no_tracks;
+  track_swap(no_tracks);
+  waypt_add(wpt);
+  kml_open_posn_file(position_name);
+  write();
+  wr_deinit();
+  waypt_del(wpt);
+  track_swap(no_tracks);
+
+  // The newest part of the track.
+  kml_open_posn_file(posn_chunks.last());
+  write();
+  wr_deinit();
+
+  if (posn_trk_head->rte_waypt_ct() >= position_chunk) {
+    while (posn_trk_head->rte_waypt_ct() > 1) {
+      Waypoint* tonuke = posn_trk_head->waypoint_list.front();
+      track_del_wpt(posn_trk_head, tonuke);
+    }
+    posn_chunks.append(kml_posn_chunk_name(++posn_chunk_count));
+    // Drop the oldest part once the newer ones hold the points to retain.
+    while (max_position_points &&
+           (posn_chunks.size() - 2) * (position_chunk - 1) >= max_position_points) {
+      QFile::remove(posn_chunks.takeFirst());
+    }
+    index_changed = true;
+  }
+
+  // A trail shorter than a part is trimmed as in a single file.
+  while (max_position_points && (max_position_points < position_chunk) &&
+         (posn_trk_head->rte_waypt_ct() >= max_position_points)) {
+    Waypoint* tonuke = posn_trk_head->waypoint_list.front();
+    track_del_wpt(posn_trk_head, tonuke);
+  }
+
+  if (index_changed) {
+    QStringList names;
+    for (const auto& chunk : std::as_const(posn_chunks)) {
+      names.append(QFileInfo(chunk).completeBaseName());
+    }
+    kml_open_posn_file(index_name);
+    kml_write_links(QStringLiteral("Track"), posn_chunks, names, 1);
+    wr_deinit();
+  }
+}
+
 void KmlFormat::wr_position(Waypoint* wpt)
 {
   static gpsbabel::DateTime last_valid_fix;
 
-  wr_init(posnfilenametmp);
+  if (position_chunk == 0) {
+    wr_init(posnfilenametmp);
+  }
 
   if (!posn_trk_head) {
     posn_trk_head = new route_head;
@@ -2070,7 +2373,7 @@ void KmlFormat::wr_position(Waypoint* wpt)
   } else {
     Waypoint* newest_posn= posn_trk_head->waypoint_list.back();
 
-    if (radtometers(gcdist(wpt->position(), newest_posn->position())) > 50) {
+    if (!gcdist_meters_within(wpt->position(), newest_posn->position(), 50)) {
       track_add_wpt(posn_trk_head, new Waypoint(*wpt));
     } else {
       /* If we haven't move more than our threshold, pretend
@@ -2082,6 +2385,11 @@ void KmlFormat::wr_position(Waypoint* wpt)
     }
   }
 
+  if (position_chunk > 0) {
+    kml_write_posn_chunks(wpt);
+    return;
+  }
+
   waypt_add(wpt);
   write();
   waypt_del(wpt);
@@ -26,8 +26,11 @@
 #include <tuple>                        // for tuple, make_tuple, tie
 
 #include <QHash>                        // for QHash
+#include <QIODevice>                    // for QIODevice
 #include <QList>                        // for QList
 #include <QString>                      // for QString, QStringLiteral, operator+, operator!=
+#include <QStringList>                  // for QStringList
+#include <QStringView>                  // for QStringView
 #include <QVector>                      // for QVector
 #include <QXmlStreamAttributes>         // for QXmlStreamAttributes
 
@@ -35,6 +38,7 @@
 #include "format.h"
 #include "src/core/datetime.h"          // for DateTime
 #include "src/core/file.h"              // for File
+#include "src/core/stringpool.h"        // for StringPool
 #include "src/core/xmlstreamwriter.h"   // for XmlStreamWriter
 #include "units.h"                      // for UnitsFormatter
 #include "xmlgeneric.h"                 // for cb_cdata, cb_end, cb_start, xg_callback, xg_cb_type, xml_deinit, xml_ignore_tags, xml_init, xml_read, xg_tag_mapping
@@ -114,6 +118,7 @@ private:
   /* Constants */
   static constexpr const char* default_precision = "6";
   static constexpr int kml_color_limit = 204;	/* allowed range [0,255] */
+  static constexpr int posn_refresh_seconds = 2;
 
   static constexpr const char* kml_tags_to_ignore[] = {
     "kml",
@@ -152,6 +157,7 @@ private:
   void gx_trk_e(const QString& args, const QXmlStreamAttributes* attrs);
   void gx_trk_when(const QString& args, const QXmlStreamAttributes* attrs);
   void gx_trk_coord(const QString& args, const QXmlStreamAttributes* attrs);
+  void gx_trk_add(const gpsbabel::DateTime& time, const std::tuple<int, double, double, double>& coord);
   void kml_output_linestyle(char* color, int width) const;
   void kml_write_bitmap_style_(const QString& style, const QString& bitmap, bool highlighted, bool force_heading) const;
   void kml_write_bitmap_style(kml_point_type pt_type, const QString& bitmap, const QString& customstyle) const;
@@ -185,7 +191,7 @@ private:
   void kml_track_hdr(const route_head* header) const;
   void kml_track_disp(const Waypoint* waypointp) const;
   void kml_track_tlr(const route_head* header);
-  void kml_mt_simple_array(const route_head* header, const QString& name, wp_field member) const;
+  static QString kml_mt_value(const Waypoint* wpt, const QString& name, wp_field member);
   static bool track_has_time(const route_head* header);
   void write_as_linestring(const route_head* header);
   void kml_accumulate_track_traits(const route_head* rte);
@@ -195,8 +201,15 @@ private:
   void kml_route_disp(const Waypoint* waypointp) const;
   void kml_route_tlr(const route_head* header);
   void kml_write_AbstractView();
+  void kml_open_posn_file(const QString& fname);
+  void kml_write_links(const QString& name, const QStringList& hrefs, const QStringList& names, int refreshing);
+  QString kml_posn_chunk_name(int number) const;
+  void kml_write_posn_chunks(Waypoint* wpt);
   void kml_mt_array_schema(const QString& field_name, const QString& display_name, const QString& type) const;
   static QString kml_get_posn_icon(int freshness);
+  static bool kml_is_kmz(const QString& fname, bool reading);
+  static int kml_scan_tuple(QStringView* s, double* values, int* numbers);
+  static int kml_count_tuples(QStringView s);
 
   /* Data Members */
 
@@ -218,6 +231,7 @@ private:
   char* opt_units{nullptr};
   char* opt_labels{nullptr};
   char* opt_max_position_points{nullptr};
+  char* opt_position_chunk{nullptr};
   char* opt_rotate_colors{nullptr};
   char* opt_precision{nullptr};
 
@@ -229,21 +243,30 @@ private:
   bool trackdata{};
   bool trackdirection{};
   int max_position_points{};
+  int position_chunk{};
   bool rotate_colors{};
   int line_width{};
   int precision{};
 
   Waypoint* wpt_tmp{nullptr};
   bool wpt_tmp_queued{false};
+  gpsbabel::StringPool icon_pool;
   QString posnfilename;
   QString posnfilenametmp;
+  // With position_chunk: the file given with -F, the prefix of the other
+  // realtime files and the track parts still linked, oldest first.
+  QString posn_master;
+  QString posn_base;
+  QStringList posn_chunks;
+  int posn_chunk_count{0};
 
   route_head* gx_trk_head{nullptr};
+  // The whens and coords of the current track still waiting for their partner.
   QList<gpsbabel::DateTime>* gx_trk_times{nullptr};
   QList<std::tuple<int, double, double, double>>* gx_trk_coords{nullptr};
 
   UnitsFormatter* unitsformatter{nullptr};
-  gpsbabel::File* oqfile{nullptr};
+  QIODevice* oqfile{nullptr};
   gpsbabel::XmlStreamWriter* writer{nullptr};
 
   bool realtime_positioning{};
@@ -313,6 +336,11 @@ private:
       "Retain at most this number of position points  (0 = unlimited)",
       "0", ARGTYPE_INT, ARG_NOMINMAX, nullptr
     },
+    {
+      "position_chunk", &opt_position_chunk,
+      "Points per realtime track file (0 = single file)",
+      "0", ARGTYPE_INT, "0", nullptr, nullptr
+    },
     {
       "rotate_colors", &opt_rotate_colors,
       "Rotate colors for tracks and routes (default automatic)",
@@ -355,6 +383,7 @@ private:
     {&KmlFormat::gx_trk_coord, xg_cb_type::cb_cdata, "/Placemark/(.+/)?Track/coord"}, // KML 2.3
   };
   XmlGenericReader* xml_reader{nullptr};
+  QIODevice* kmz_reader{nullptr};
 
   // The TimeSpan/begin and TimeSpan/end DateTimes:
   gpsbabel::DateTime wpt_timespan_begin, wpt_timespan_end;
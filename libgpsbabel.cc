@@ -0,0 +1,281 @@
+/*
+    In-process conversion interface.
+
+    Copyright (C) 2026 Robert Lipe, robertlipe+source@gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include "libgpsbabel.h"
+
+#include <functional>                 // for function
+#include <memory>                     // for make_shared
+
+#include <QByteArray>                 // for QByteArray
+#include <QMutex>                     // for QMutex
+#include <QMutexLocker>               // for QMutexLocker
+#include <QString>                    // for QString
+#include <QStringList>                // for QStringList
+#include <QVector>                    // for QVector
+
+#include "defs.h"                     // for global_opts, fatal, fatal_set_throws, waypt_flush_all, route_flush_all_routes, route_flush_all_tracks, waypt_use_list, route_use_lists, WaypointList, RouteList
+#include "filter.h"                   // for Filter
+#include "filter_vecs.h"              // for FilterVecs
+#include "format.h"                   // for Format
+#include "session.h"                  // for session_init, start_session, use_session, ThreadScope
+#include "src/core/logging.h"         // for FatalError
+#include "src/core/memoryfile.h"      // for MemoryFiles
+#include "src/core/usasciicodec.h"    // for UsAsciiCodec
+#include "vecs.h"                     // for Vecs
+
+
+#define MYNAME "libgpsbabel"
+
+namespace gpsbabel
+{
+
+static QMutex convert_mutex;
+static bool initialized = false;
+static int serial = 0;
+
+/* The part of main() that has to happen once per process. */
+static void
+initialize()
+{
+  (void) new gpsbabel::UsAsciiCodec(); /* make sure a US-ASCII codec is available */
+
+  global_opts.objective = wptdata;
+  global_opts.masked_objective = NOTHINGMASK;
+  global_opts.inifile = nullptr;
+
+  Vecs::Instance().init_vecs();
+  FilterVecs::Instance().init_filter_vecs();
+  session_init();
+  initialized = true;
+}
+
+static void
+read(Vecs::fmtinfo_t& ivecs, const QString& fname)
+{
+  start_session(ivecs.fmtname, fname);
+  if (ivecs.isDynamic()) {
+    ivecs.fmt = ivecs.factory(fname);
+    Vecs::init_vec(ivecs.fmt);
+  }
+  Vecs::prepare_format(ivecs);
+  ivecs->rd_init(fname);
+  ivecs->read();
+  ivecs->rd_deinit();
+  if (ivecs.isDynamic()) {
+    Vecs::exit_vec(ivecs.fmt);
+    delete ivecs.fmt;
+    ivecs.fmt = nullptr;
+  }
+}
+
+static void
+run_filter(FilterVecs::fltinfo_t& filter)
+{
+  if (filter.isDynamic()) {
+    filter.flt = filter.factory();
+    FilterVecs::init_filter_vec(filter.flt);
+  }
+  FilterVecs::prepare_filter(filter);
+  filter->init();
+  filter->process();
+  filter->deinit();
+  FilterVecs::free_filter_vec(filter.flt);
+  if (filter.isDynamic()) {
+    FilterVecs::exit_filter_vec(filter.flt);
+    delete filter.flt;
+    filter.flt = nullptr;
+  }
+  // Filters may change points without going through RouteList.
+  route_invalidate_caches();
+}
+
+static void
+write(Vecs::fmtinfo_t& ovecs, const QString& ofname)
+{
+  if (ovecs.isDynamic()) {
+    ovecs.fmt = ovecs.factory(ofname);
+    Vecs::init_vec(ovecs.fmt);
+  }
+  Vecs::prepare_format(ovecs);
+  ovecs->wr_init(ofname);
+  ovecs->write();
+  ovecs->wr_deinit();
+  if (ovecs.isDynamic()) {
+    Vecs::exit_vec(ovecs.fmt);
+    delete ovecs.fmt;
+    ovecs.fmt = nullptr;
+  }
+}
+
+/* Forget everything the last conversion read. */
+static void
+reset()
+{
+  waypt_flush_all();
+  route_flush_all_routes();
+  route_flush_all_tracks();
+  session_exit();
+  session_init();
+}
+
+struct Plan::Impl {
+  Vecs::fmtinfo_t ivecs;
+  QVector<FilterVecs::fltinfo_t> filters;
+  Vecs::fmtinfo_t ovecs;
+};
+
+Plan::Plan(const QString& input_format, const QStringList& filters,
+           const QString& output_format)
+{
+  QMutexLocker locker(&convert_mutex);
+
+  if (!initialized) {
+    initialize();
+  }
+  fatal_set_throws(true);
+
+  try {
+    auto impl = std::make_shared<Impl>();
+    impl->ivecs = Vecs::Instance().find_vec(input_format);
+    if (!impl->ivecs) {
+      fatal(MYNAME ": Input type '%s' not recognized\n", qPrintable(input_format));
+    }
+    Vecs::compile_format(impl->ivecs);
+
+    for (const auto& spec : filters) {
+      FilterVecs::fltinfo_t filter = FilterVecs::Instance().find_filter_vec(spec);
+      if (!filter) {
+        fatal(MYNAME ": Unknown filter '%s'\n", qPrintable(spec));
+      }
+      FilterVecs::compile_filter(filter);
+      impl->filters.append(filter);
+    }
+
+    if (!output_format.isEmpty()) {
+      impl->ovecs = Vecs::Instance().find_vec(output_format);
+      if (!impl->ovecs) {
+        fatal(MYNAME ": Output type '%s' not recognized\n", qPrintable(output_format));
+      }
+      Vecs::compile_format(impl->ovecs);
+    }
+    d_ptr_ = impl;
+  } catch (const FatalError&) {
+    fatal_set_throws(false);
+    throw;
+  }
+
+  fatal_set_throws(false);
+}
+
+/*
+ * Read fnames, run the filters and call done with the data, then forget
+ * the data again.  The caller holds convert_mutex.  The lists are the
+ * run's own, as the global ones belong to the thread that made them.
+ */
+static void
+run(const QStringList& fnames, Vecs::fmtinfo_t ivecs,
+    QVector<FilterVecs::fltinfo_t> filters, const std::function<void()>& done)
+{
+  const ThreadScope scope;
+  WaypointList waypoints;
+  RouteList routes;
+  RouteList tracks;
+  waypt_use_list(&waypoints);
+  route_use_lists(&routes, &tracks);
+  use_session(nullptr);
+
+  global_opts.objective = wptdata;
+  global_opts.masked_objective = WPTDATAMASK | TRKDATAMASK | RTEDATAMASK;
+  gpsbabel_time = current_time().toTime_t();
+  fatal_set_throws(true);
+
+  try {
+    for (const auto& fname : fnames) {
+      read(ivecs, fname);
+    }
+    for (auto& filter : filters) {
+      run_filter(filter);
+    }
+    done();
+  } catch (const FatalError&) {
+    // Formats and filters that failed half way are not cleaned up.
+    reset();
+    fatal_set_throws(false);
+    throw;
+  }
+
+  reset();
+  fatal_set_throws(false);
+}
+
+QByteArray
+Plan::convert(const QByteArray& input) const
+{
+  QMutexLocker locker(&convert_mutex);
+
+  if (!d_ptr_->ovecs) {
+    throw FatalError(MYNAME ": This plan has no output format");
+  }
+
+  ++serial;
+  const QString fname = QStringLiteral("memory:%1-input").arg(serial);
+  const QString ofname = QStringLiteral("memory:%1-output").arg(serial);
+  MemoryFiles::insert(fname, input);
+  MemoryFiles::insert(ofname, QByteArray());
+
+  try {
+    run({fname}, d_ptr_->ivecs, d_ptr_->filters, [this, &ofname]() {
+      Vecs::fmtinfo_t ovecs = d_ptr_->ovecs;
+      write(ovecs, ofname);
+    });
+  } catch (const FatalError&) {
+    MemoryFiles::take(fname);
+    MemoryFiles::take(ofname);
+    throw;
+  }
+
+  MemoryFiles::take(fname);
+  return MemoryFiles::take(ofname);
+}
+
+void
+Plan::visit(const QStringList& fnames, const std::function<void()>& visitor) const
+{
+  QMutexLocker locker(&convert_mutex);
+
+  run(fnames, d_ptr_->ivecs, d_ptr_->filters, visitor);
+}
+
+QByteArray
+convert(const QByteArray& input, const QString& input_format,
+        const QStringList& filters, const QString& output_format)
+{
+  return Plan(input_format, filters, output_format).convert(input);
+}
+
+void
+visit(const QStringList& fnames, const QString& input_format,
+      const QStringList& filters, const std::function<void()>& visitor)
+{
+  Plan(input_format, filters).visit(fnames, visitor);
+}
+
+} // namespace gpsbabel
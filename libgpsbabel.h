@@ -0,0 +1,109 @@
+/*
+    In-process conversion interface.
+
+    Copyright (C) 2026 Robert Lipe, robertlipe+source@gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+#ifndef LIBGPSBABEL_H_INCLUDED_
+#define LIBGPSBABEL_H_INCLUDED_
+
+#include <functional>            // for function
+#include <memory>                // for shared_ptr
+
+#include <QByteArray>          // for QByteArray
+#include <QString>             // for QString
+#include <QStringList>         // for QStringList
+
+#include "src/core/logging.h"  // for FatalError
+
+namespace gpsbabel
+{
+
+/*
+ * Convert input, which is in input_format, to output_format, running
+ * the given filters in between.  This does what
+ *
+ *   gpsbabel -w -r -t -i input_format -f IN -x filter... -o output_format -F OUT
+ *
+ * does, except that IN and OUT live in memory and no process is started.
+ * Formats and filters are given with their options just like on the
+ * command line, e.g. "gpx,snlen=10" or "simplify,count=100".
+ *
+ * Formats that open their files through gpsbabel::File or gbfile, which
+ * includes most of the file formats, convert without touching the file
+ * system.  Formats that need other files, e.g. devices, still open them.
+ *
+ * Errors that would end the gpsbabel program throw a FatalError.  Calls
+ * from several threads are run one after another.
+ */
+QByteArray convert(const QByteArray& input, const QString& input_format,
+                   const QStringList& filters, const QString& output_format);
+
+/*
+ * Read the files fnames, which are in input_format, and run the filters
+ * like
+ *
+ *   gpsbabel -w -r -t -i input_format -f FNAME... -x filter...
+ *
+ * does, then call visitor.  visitor sees the data through the waypoint,
+ * route and track functions of defs.h, e.g. waypt_disp_all(), and must
+ * not keep pointers to any of it: it is deleted when visitor returns.
+ *
+ * Errors throw a FatalError as they do for convert(), and visitor may
+ * throw one too by calling fatal().
+ */
+void visit(const QStringList& fnames, const QString& input_format,
+           const QStringList& filters, const std::function<void()>& visitor);
+
+/*
+ * A conversion set up once and run many times, for callers that convert
+ * many inputs the same way.  The formats and filters are looked up and
+ * their options are checked, read from the inifile and converted when
+ * the plan is made; so is the style of an xcsv format.  A bad format,
+ * filter or option throws a FatalError from the constructor.
+ *
+ * convert() and visit() do what the functions of the same name do with
+ * the arguments the plan was made with.  Plans are cheap to copy and may
+ * be run from several threads, one run after another.
+ */
+class Plan
+{
+public:
+  /* Special Member Functions */
+
+  // An empty output_format makes a plan that can only visit().
+  Plan(const QString& input_format, const QStringList& filters,
+       const QString& output_format = QString());
+
+  /* Member Functions */
+
+  QByteArray convert(const QByteArray& input) const;
+  void visit(const QStringList& fnames, const std::function<void()>& visitor) const;
+
+private:
+  /* Types */
+
+  struct Impl;                   // Not defined here
+
+  /* Data Members */
+
+  std::shared_ptr<const Impl> d_ptr_;
+};
+
+} // namespace gpsbabel
+
+#endif // LIBGPSBABEL_H_INCLUDED_
@@ -87,6 +87,7 @@
 
 #include "lowranceusr.h"
 
+#include <algorithm>            // for max
 #include <cinttypes>            // for PRId64
 #include <cmath>                // for round, atan, exp, log, tan
 #include <cstdio>               // for printf, sprintf, SEEK_CUR
@@ -95,11 +96,14 @@
 #include <cstring>              // for strcmp, strlen
 #include <numbers>              // for pi
 #include <utility>              // for as_const
+#include <vector>               // for vector
 
 #include <QByteArray>           // for QByteArray
 #include <QDate>                // for QDate
 #include <QDateTime>            // for QDateTime
+#include <QHash>                // for QHash
 #include <QList>                // for QList
+#include <QPair>                // for QPair, qMakePair
 #include <QScopedPointer>       // for QScopedPointer
 #include <QString>              // for QString, operator+, operator==, operator!=
 #include <QTextCodec>           // for QTextCodec, QTextCodec::IgnoreHeader
@@ -115,10 +119,6 @@
 #include "src/core/datetime.h"  // for DateTime
 #include "src/core/logging.h"   // for Warning
 
-
-/* from waypt.c, we need to iterate over waypoints when extracting routes */
-extern WaypointList* global_waypoint_list;
-
 #define MYNAME "Lowrance USR"
 
 /* below couple of functions mostly borrowed from raymarine.c */
@@ -155,9 +155,8 @@ LowranceusrFormat::register_waypt(const Waypoint* wpt) const
 const Waypoint*
 LowranceusrFormat::lowranceusr4_find_waypt(uint uid_unit, int uid_seq_low, int uid_seq_high)
 {
-  // Iterate with waypt_disp_all?
-  for (const Waypoint* waypointp : std::as_const(*global_waypoint_list)) {
-    const auto* fs = reinterpret_cast<lowranceusr4_fsdata*>(waypointp->fs.FsChainFind(kFsLowranceusr4));
+  for (const Waypoint* waypointp : waypt_range()) {
+    const auto* fs = reinterpret_cast<const lowranceusr4_fsdata*>(waypointp->fs.FsChainFind(kFsLowranceusr4));
 
     if (fs && fs->uid_unit == uid_unit &&
         fs->uid_seq_low == uid_seq_low &&
@@ -176,9 +175,8 @@ LowranceusrFormat::lowranceusr4_find_waypt(uint uid_unit, int uid_seq_low, int u
 const Waypoint*
 LowranceusrFormat::lowranceusr4_find_global_waypt(uint id1, uint id2, uint id3, uint id4)
 {
-  // Iterate with waypt_disp_all?
-  for (const Waypoint* waypointp : std::as_const(*global_waypoint_list)) {
-    const auto* fs = reinterpret_cast<lowranceusr4_fsdata*>(waypointp->fs.FsChainFind(kFsLowranceusr4));
+  for (const Waypoint* waypointp : waypt_range()) {
+    const auto* fs = reinterpret_cast<const lowranceusr4_fsdata*>(waypointp->fs.FsChainFind(kFsLowranceusr4));
 
     if (fs && fs->UUID1 == id1 &&
         fs->UUID2 == id2 &&
@@ -269,7 +267,8 @@ LowranceusrFormat::lowranceusr_find_desc_from_icon_number(const int icon)
 int
 LowranceusrFormat::lowranceusr_find_icon_number_from_desc(const QString& desc)
 {
-  return lowranceusr_common_find_icon_number_from_desc(desc, lowranceusr_icon_value_table, DEF_ICON);
+  static const QHash<QString, int> index = lowranceusr_common_icon_index(lowranceusr_icon_value_table);
+  return lowranceusr_common_find_icon_number_from_desc(desc, lowranceusr_icon_value_table, index, DEF_ICON);
 }
 
 QString
@@ -281,7 +280,8 @@ LowranceusrFormat::lowranceusr4_find_desc_from_icon_number(const int icon)
 int
 LowranceusrFormat::lowranceusr4_find_icon_number_from_desc(const QString& desc)
 {
-  return lowranceusr_common_find_icon_number_from_desc(desc, lowranceusr4_icon_value_table, DEF_USR4_ICON);
+  static const QHash<QString, int> index = lowranceusr_common_icon_index(lowranceusr4_icon_value_table);
+  return lowranceusr_common_find_icon_number_from_desc(desc, lowranceusr4_icon_value_table, index, DEF_USR4_ICON);
 }
 
 const char*
@@ -312,6 +312,26 @@ LowranceusrFormat::lowranceusr4_find_index_from_icon_desc_and_color_desc(const Q
     return DEF_USR4_COLOR;
   }
 
+  /*
+   * Keyed by case folded icon and color.  Of several equal pairs the
+   * first icon entry and then the first color wins, as in the scan below.
+   */
+  static const QHash<QPair<QString, QString>, int> index = []() {
+    QHash<QPair<QString, QString>, int> idx;
+    for (const lowranceusr4_icon_mapping_t* i = lowranceusr4_icon_value_table; i->icon; i++) {
+      for (int c=0; c<7; c++) {
+        QPair<QString, QString> key(QString(i->icon).toCaseFolded(), QString(i->color[c]).toCaseFolded());
+        if (!idx.contains(key)) {
+          idx.insert(key, c);
+        }
+      }
+    }
+    return idx;
+  }();
+  if (lowranceusr_is_ascii(icon) && lowranceusr_is_ascii(color)) {
+    return index.value(qMakePair(icon.toCaseFolded(), color.toCaseFolded()), DEF_USR4_COLOR);
+  }
+
   for (const lowranceusr4_icon_mapping_t* i = lowranceusr4_icon_value_table; i->icon; i++) {
     if (icon.compare(i->icon,Qt::CaseInsensitive) == 0) {
       // Found ICON, now look for color
@@ -393,6 +413,26 @@ LowranceusrFormat::lat_deg_to_mm(double x)
   return round(SEMIMINOR * log(tan((x * DEGREESTORADIANS + std::numbers::pi / 2.0) / 2.0)));
 }
 
+/**
+ * Convert a section of USR 2/3 trail points, each a mercator meter latitude
+ * and longitude followed by a continuation flag, to degrees.  The points are
+ * unpacked first so the conversions run as plain loops over arrays.
+ */
+void
+LowranceusrFormat::lowranceusr_decode_trail_section(const char* section, int count, double* lat, double* lon)
+{
+  for (int i = 0; i < count; ++i) {
+    lat[i] = le_read32(section + i * kTrailPointSize);
+    lon[i] = le_read32(section + i * kTrailPointSize + 4);
+  }
+  for (int i = 0; i < count; ++i) {
+    lat[i] = lat_mm_to_deg(lat[i]);
+  }
+  for (int i = 0; i < count; ++i) {
+    lon[i] = lon_mm_to_deg(lon[i]);
+  }
+}
+
 void
 LowranceusrFormat::lowranceusr_parse_waypt(Waypoint* wpt_tmp, int object_num_present) const
 {
@@ -976,6 +1016,9 @@ LowranceusrFormat::lowranceusr_parse_trail(int* trail_num)
   }
 
   if (num_trail_points) {
+    if (!opt_seg_break) {
+      track_reserve_wpts(trk_head, num_trail_points);
+    }
 
     while (num_trail_points && !gbfeof(file_in)) {
       /* num section points */
@@ -985,12 +1028,19 @@ LowranceusrFormat::lowranceusr_parse_trail(int* trail_num)
         printf(MYNAME " parse_trails: Num Section Points = %d\n", num_section_points);
       }
 
-      for (int j = 0; j < num_section_points && !gbfeof(file_in); j++, num_trail_points--) {
+      /* read the whole section in one go, a short read means we hit EOF */
+      QByteArray section(std::max<int>(num_section_points, 0) * kTrailPointSize, '\0');
+      int section_count = static_cast<int>(gbfread(section.data(), 1, section.size(), file_in) / kTrailPointSize);
+      std::vector<double> lats(section_count);
+      std::vector<double> lons(section_count);
+      lowranceusr_decode_trail_section(section.constData(), section_count, lats.data(), lons.data());
+
+      for (int j = 0; j < section_count; j++, num_trail_points--) {
         auto* wpt_tmp = new Waypoint;
-        wpt_tmp->latitude = lat_mm_to_deg(gbfgetint32(file_in));
-        wpt_tmp->longitude = lon_mm_to_deg(gbfgetint32(file_in));
+        wpt_tmp->latitude = lats[j];
+        wpt_tmp->longitude = lons[j];
 
-        char continuous_flag = gbfgetc(file_in);
+        char continuous_flag = section.at(j * kTrailPointSize + 8);
         if (!continuous_flag) {
           if (opt_seg_break) {
             /* option to break trails into segments was specified */
@@ -1120,19 +1170,24 @@ LowranceusrFormat::lowranceusr4_parse_trail(int* trail_num) const
       printf(MYNAME " parse_trails: -------------- -------------- -- -------- -- -------- -- --------\n");
     }
   }
+  track_reserve_wpts(trk_head, num_trail_pts);
   for (int j = 0; j < num_trail_pts; ++j) {
+    /* The fixed part of the trailpoint, including the count of what follows */
+    char rec[kTrail4PointSize];
+    if (gbfread(rec, 1, kTrail4PointSize, file_in) != gbsize_t(kTrail4PointSize)) {
+      break;
+    }
+
     auto* wpt_tmp = new Waypoint;
 
-    /* Some unknown bytes */
-    gbfgetint16(file_in);
-    gbfgetc(file_in);
+    /* Some unknown bytes at 0..2 */
 
     /* POSIX timestamp (a.k.a. UNIX Epoch) - seconds since Jan 1, 1970 */
-    wpt_tmp->SetCreationTime(gbfgetint32(file_in));
+    wpt_tmp->SetCreationTime(le_read32(rec + 3));
 
     /* Long/Lat */
-    wpt_tmp->longitude = gbfgetdbl(file_in) / DEGREESTORADIANS; /* rad to deg */
-    wpt_tmp->latitude = gbfgetdbl(file_in) / DEGREESTORADIANS;
+    wpt_tmp->longitude = le_read_double(rec + 7) / DEGREESTORADIANS; /* rad to deg */
+    wpt_tmp->latitude = le_read_double(rec + 15) / DEGREESTORADIANS;
 
     if (global_opts.debug_level >= 2) {
       if (global_opts.debug_level == 99) {
@@ -1147,12 +1202,14 @@ LowranceusrFormat::lowranceusr4_parse_trail(int* trail_num) const
     track_add_wpt(trk_head, wpt_tmp);
 
     /* Mysterious per-trailpoint data, toss it for now */
-    int M = gbfgetint32(file_in);
-    for (int k = 0; k < M; ++k) {
-      int flag = gbfgetc(file_in);
-      float value = gbfgetflt(file_in);
+    int M = le_read32(rec + 23);
+    if (M > 0) {
+      QByteArray extra(M * 5, '\0');
+      gbfread(extra.data(), 1, extra.size(), file_in);
       if (global_opts.debug_level == 99) {
-        printf(" %02x %f", flag, value);
+        for (int k = 0; k < M; ++k) {
+          printf(" %02x %f", static_cast<unsigned char>(extra.at(k * 5)), le_read_float(extra.constData() + k * 5 + 1));
+        }
       }
     }
 
@@ -1386,7 +1443,7 @@ LowranceusrFormat::lowranceusr_waypt_disp(const Waypoint* wpt) const
 void
 LowranceusrFormat::lowranceusr4_waypt_disp(const Waypoint* wpt)
 {
-  const auto* fs = reinterpret_cast<lowranceusr4_fsdata*>(wpt->fs.FsChainFind(kFsLowranceusr4));
+  const auto* fs = reinterpret_cast<const lowranceusr4_fsdata*>(wpt->fs.FsChainFind(kFsLowranceusr4));
 
   /* UID unit number */
   if (opt_serialnum_i > 0) {
@@ -1634,7 +1691,7 @@ LowranceusrFormat::lowranceusr4_route_hdr(const route_head* rte)
            route_uid, qPrintable(rte->rte_name), rte->rte_waypt_ct());
   }
 
-  const auto* fs = reinterpret_cast<lowranceusr4_fsdata*>(rte->fs.FsChainFind(kFsLowranceusr4));
+  const auto* fs = reinterpret_cast<const lowranceusr4_fsdata*>(rte->fs.FsChainFind(kFsLowranceusr4));
 
   /* UID unit number */
   if (opt_serialnum_i > 0) {
@@ -1665,7 +1722,7 @@ LowranceusrFormat::lowranceusr4_route_leg_disp(const Waypoint* wpt) const
   for (int i = 0; i < waypt_table->size(); i++) {
     const Waypoint* cmp = waypt_table->at(i);
     if (cmp->shortname == wpt->shortname) {
-      const auto* fs = reinterpret_cast<lowranceusr4_fsdata*>(cmp->fs.FsChainFind(kFsLowranceusr4));
+      const auto* fs = reinterpret_cast<const lowranceusr4_fsdata*>(cmp->fs.FsChainFind(kFsLowranceusr4));
 
       if (opt_serialnum_i > 0) {
         gbfputint32(opt_serialnum_i, file_out);  // use option serial number if specified
@@ -91,6 +91,7 @@
 #include <cstdint>              // for int64_t
 #include <numbers>              // for pi
 
+#include <QHash>                // for QHash
 #include <QList>                // for QList
 #include <QString>              // for QString
 #include <QTextCodec>           // for QTextCodec
@@ -155,6 +156,8 @@ private:
       return new lowranceusr4_fsdata(*this);
     }
 
+    std::size_t memory_usage() const override {return sizeof(*this);}
+
     uint uid_unit{0};
     uint uid_unit2{0};
     int uid_seq_low{0};
@@ -381,6 +384,8 @@ private:
   static constexpr double SEMIMINOR = 6356752.3142;
   static constexpr double DEGREESTORADIANS = std::numbers::pi/180.0;
   static constexpr int MAX_TRAIL_POINTS = 9999;
+  static constexpr int kTrailPointSize = 9;	/* USR 2/3: lat, lon, continuous flag */
+  static constexpr int kTrail4PointSize = 27;	/* USR 4+: fixed part of a trailpoint */
   static constexpr double UNKNOWN_USR_ALTITUDE = METERS_TO_FEET(-10000); /* -10000ft is how the unit stores unknown */
   static constexpr int64_t base_time_secs = 946706400; /* Jan 1, 2000 00:00:00 */
 
@@ -404,6 +409,7 @@ private:
   static double lat_mm_to_deg(double x);
   static long int lon_deg_to_mm(double x);
   static long int lat_deg_to_mm(double x);
+  static void lowranceusr_decode_trail_section(const char* section, int count, double* lat, double* lon);
   void lowranceusr_parse_waypt(Waypoint* wpt_tmp, int object_num_present) const;
   void lowranceusr4_parse_waypt(Waypoint* wpt_tmp) const;
   void lowranceusr_parse_waypts() const;
@@ -479,8 +485,40 @@ private:
     return QStringLiteral("icon-%1").arg(icon);
   }
 
+  static bool lowranceusr_is_ascii(const QString& str)
+  {
+    for (const QChar c : str) {
+      if (c.unicode() >= 0x80) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /*
+   * The icon numbers of a table keyed by case folded description.  Of
+   * several equal descriptions the first wins, as it did in a scan.
+   */
   template <typename T>
-  static int lowranceusr_common_find_icon_number_from_desc(const QString& desc, const T icon_value_table[], const int def_icon)
+  static QHash<QString, int> lowranceusr_common_icon_index(const T icon_value_table[])
+  {
+    QHash<QString, int> index;
+    for (const T* i = icon_value_table; i->icon; ++i) {
+      QString key = QString(i->icon).toCaseFolded();
+      if (!index.contains(key)) {
+        index.insert(key, i->value);
+      }
+    }
+    return index;
+  }
+
+  /*
+   * The tables are ASCII.  Other descriptions could still compare equal
+   * to an entry through case folding, so they get the scan.
+   */
+  template <typename T>
+  static int lowranceusr_common_find_icon_number_from_desc(const QString& desc, const T icon_value_table[],
+      const QHash<QString, int>& index, const int def_icon)
   {
     if (desc.isNull()) {
       return def_icon;
@@ -497,6 +535,10 @@ private:
       return n;
     }
 
+    if (lowranceusr_is_ascii(desc)) {
+      return index.value(desc.toCaseFolded(), def_icon);
+    }
+
     for (const T* i = icon_value_table; i->icon; ++i) {
       if (desc.compare(i->icon,Qt::CaseInsensitive) == 0) {
         return i->value;
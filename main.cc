@@ -17,17 +17,39 @@
 
  */
 
+#include <algorithm>                  // for max, min
+#include <atomic>                     // for atomic
 #include <cassert>                    // for assert
+#include <chrono>                     // for steady_clock, duration, duration_cast, microseconds
+#include <cmath>                      // for ceil
 #include <clocale>                    // for setlocale, LC_NUMERIC, LC_TIME
+#include <condition_variable>         // for condition_variable
 #include <csignal>                    // for signal, SIGINT, SIG_ERR
+#include <cstddef>                    // for size_t
 #include <cstdio>                     // for printf, fflush, fgetc, fprintf, stderr, stdin, stdout
 #include <cstring>                    // for strcmp
-
+#include <deque>                      // for deque
+#include <initializer_list>           // for initializer_list
+#include <memory>                     // for unique_ptr, make_unique
+#include <mutex>                      // for mutex, lock_guard, unique_lock
+#include <thread>                     // for thread
+#include <utility>                    // for move
+#include <vector>                     // for vector
+
+#include <QByteArray>                 // for QByteArray
 #include <QCoreApplication>           // for QCoreApplication
+#include <QCryptographicHash>         // for QCryptographicHash, QCryptographicHash::Sha256
+#include <QDateTime>                  // for QDateTime
+#include <QDir>                       // for QDir, QDir::Files
 #include <QElapsedTimer>              // for QElapsedTimer
 #include <QFile>                      // for QFile
+#include <QFileInfo>                  // for QFileInfo
 #include <QIODevice>                  // for QIODevice::ReadOnly
+#include <QJsonArray>                 // for QJsonArray
+#include <QJsonObject>                // for QJsonObject
+#include <QList>                      // for QList
 #include <QLocale>                    // for QLocale
+#include <QMap>                       // for QMap
 #include <QMessageLogContext>         // for QMessageLogContext
 #include <QStack>                     // for QStack
 #include <QString>                    // for QString
@@ -35,8 +57,15 @@
 #include <QSysInfo>                   // for QSysInfo
 #include <QTextCodec>                 // for QTextCodec
 #include <QTextStream>                // for QTextStream
+#include <QTimeZone>                  // for QTimeZone
 #include <QtConfig>                   // for QT_VERSION_STR
-#include <QtGlobal>                   // for qPrintable, qVersion, QT_VERSION, QT_VERSION_CHECK
+#include <QtGlobal>                   // for qPrintable, qVersion, QT_VERSION, QT_VERSION_CHECK, qEnvironmentVariable, qEnvironmentVariableIsSet
+
+#if !__WIN32__
+#include <fcntl.h>                    // for open, O_RDONLY
+#include <sys/wait.h>                 // for waitpid, WEXITSTATUS, WIFEXITED, WTERMSIG
+#include <unistd.h>                   // for fork, dup2, close, pid_t, STDIN_FILENO
+#endif
 
 #ifdef AFL_INPUT_FUZZING
 #include "argv-fuzz-inl.h"
@@ -48,13 +77,26 @@
 #include "filter_vecs.h"              // for FilterVecs
 #include "format.h"                   // for Format
 #include "gbversion.h"                // for VERSION_SHA
-#include "inifile.h"                  // for inifile_done, inifile_init
+#include "inifile.h"                  // for inifile_done, inifile_init, inifile_source
 #include "jeeps/gpsmath.h"            // for GPS_Lookup_Datum_Index
 #include "mkshort.h"                  // for MakeShort
-#include "session.h"                  // for start_session, session_exit, session_init
+#include "session.h"                  // for start_session, session_exit, session_init, use_session, session_t, ThreadScope
+#include "shard.h"                    // for Sharder
+#include "src/core/budget.h"          // for Budget
+#include "src/core/counters.h"        // for Counters
 #include "src/core/datetime.h"        // for DateTime
 #include "src/core/file.h"            // for File
+#include "src/core/logging.h"         // for FatalError, Warning
+#include "src/core/objectpool.h"      // for ObjectPool
+#include "src/core/paralleldeflate.h" // for ParallelDeflate
+#include "src/core/profiler.h"        // for Profiler
+#include "src/core/progress.h"        // for Progress
+#include "src/core/readahead.h"       // for ReadAhead
+#include "src/core/resultcache.h"     // for ResultCache
+#include "src/core/scheduler.h"       // for Scheduler, TaskGroup
+#include "src/core/trace.h"           // for Trace, TraceSpan
 #include "src/core/usasciicodec.h"    // for UsAsciiCodec
+#include "src/core/xmlpullreader.h"   // for XmlPullReader
 #include "vecs.h"                     // for Vecs
 
 static constexpr bool DEBUG_LOCALE = false;
@@ -65,6 +107,238 @@ static constexpr bool DEBUG_LOCALE = false;
 
 static QElapsedTimer timer;
 
+/*
+ * With -P every reader, filter and writer is recorded here, and the
+ * report is written when the run is over.
+ */
+static std::unique_ptr<gpsbabel::Profiler> profiler;
+static QString profile_fname;
+
+/*
+ * With -Y, or GPSBABEL_TRACE in the environment, the stages and their
+ * phases are traced, see gpsbabel::Trace, and the trace is written when
+ * the run is over.
+ */
+static QString trace_fname;
+static QString trace_stage;
+static QString trace_stage_detail;
+static qint64 trace_stage_begin_us{-1};
+
+/*
+ * With -M the run stops once the data held after a stage takes more
+ * than this many bytes.
+ */
+static qint64 max_memory_bytes{0};
+
+/*
+ * With --track-store packed the tracks read are packed after each
+ * reader, see route_head::pack_points(), and unpacked again before the
+ * next filter or writer.
+ */
+static bool pack_tracks{false};
+
+/*
+ * With -K waypoints and routes are pooled for the whole run, and the
+ * pools' chunks are mapped from a file, see ObjectPool.
+ */
+static std::unique_ptr<AllocationArena> spill_arena;
+
+/*
+ * The memory taken by the data of a session, see Waypoint::memory_usage()
+ * and route_head::memory_usage().  Routes and tracks include their points.
+ */
+struct session_footprint {
+  qint64 waypoints{0};
+  qint64 waypoint_bytes{0};
+  qint64 routes{0};
+  qint64 route_bytes{0};
+  qint64 tracks{0};
+  qint64 track_bytes{0};
+};
+
+static QMap<const session_t*, session_footprint>
+data_footprint()
+{
+  QMap<const session_t*, session_footprint> sessions;
+  waypt_disp_all([&sessions](const Waypoint* wpt)->void {
+    session_footprint& fp = sessions[wpt->session];
+    ++fp.waypoints;
+    fp.waypoint_bytes += wpt->memory_usage() + sizeof(Waypoint*);
+  });
+  auto route_bytes = [](const route_head* rte)->qint64 {
+    std::size_t bytes = rte->memory_usage() + sizeof(route_head*);
+    for (const Waypoint* wpt : rte->waypoint_list) {
+      bytes += wpt->memory_usage();
+    }
+    return bytes;
+  };
+  route_disp_all([&sessions, &route_bytes](const route_head* rte)->void {
+    session_footprint& fp = sessions[rte->session];
+    ++fp.routes;
+    fp.route_bytes += route_bytes(rte);
+  }, nullptr, nullptr);
+  track_disp_all([&sessions, &route_bytes](const route_head* rte)->void {
+    session_footprint& fp = sessions[rte->session];
+    ++fp.tracks;
+    fp.track_bytes += route_bytes(rte);
+  }, nullptr, nullptr);
+  return sessions;
+}
+
+static QJsonArray
+footprint_json(const QMap<const session_t*, session_footprint>& sessions)
+{
+  QJsonArray array;
+  for (auto it = sessions.cbegin(); it != sessions.cend(); ++it) {
+    QJsonObject obj;
+    if (it.key() != nullptr) {
+      obj.insert(QStringLiteral("format"), it.key()->name);
+      obj.insert(QStringLiteral("file"), it.key()->filename);
+    }
+    const session_footprint& fp = it.value();
+    obj.insert(QStringLiteral("waypoints"), fp.waypoints);
+    obj.insert(QStringLiteral("waypoint_bytes"), fp.waypoint_bytes);
+    obj.insert(QStringLiteral("routes"), fp.routes);
+    obj.insert(QStringLiteral("route_bytes"), fp.route_bytes);
+    obj.insert(QStringLiteral("tracks"), fp.tracks);
+    obj.insert(QStringLiteral("track_bytes"), fp.track_bytes);
+    obj.insert(QStringLiteral("bytes"), fp.waypoint_bytes + fp.route_bytes + fp.track_bytes);
+    array.append(obj);
+  }
+  return array;
+}
+
+static void
+profile_begin(const QString& stage, const QString& name, const QString& file = QString())
+{
+  if (gpsbabel::Trace::enabled()) {
+    trace_stage = QStringLiteral("run_%1").arg(stage);
+    trace_stage_detail = file.isEmpty() ? name : QStringLiteral("%1 %2").arg(name, file);
+    trace_stage_begin_us = gpsbabel::Trace::now_us();
+  }
+  if (profiler) {
+    profiler->begin(stage, name, file,
+                    waypt_count() + route_waypt_count() + track_waypt_count(),
+                    Waypoint::pool().allocation_count() + route_head::pool().allocation_count());
+  }
+}
+
+static void
+profile_end()
+{
+  if (trace_stage_begin_us >= 0) {
+    gpsbabel::Trace::record("stage", trace_stage, trace_stage_detail,
+                            trace_stage_begin_us, gpsbabel::Trace::now_us());
+    trace_stage_begin_us = -1;
+  }
+  if (!profiler && (max_memory_bytes == 0)) {
+    return;
+  }
+
+  const QMap<const session_t*, session_footprint> footprint = data_footprint();
+  qint64 bytes = 0;
+  for (const session_footprint& fp : footprint) {
+    bytes += fp.waypoint_bytes + fp.route_bytes + fp.track_bytes;
+  }
+  if (profiler) {
+    profiler->end(waypt_count() + route_waypt_count() + track_waypt_count(),
+                  Waypoint::pool().allocation_count() + route_head::pool().allocation_count(),
+                  bytes);
+    profiler->set_sessions(footprint_json(footprint));
+  }
+  if ((max_memory_bytes > 0) && (bytes > max_memory_bytes)) {
+    fatal(MYNAME ": The data takes %lld MB, more than the %lld MB allowed by -M.  "
+          "Converting with -Z holds fewer points in memory.\n",
+          static_cast<long long>(bytes >> 20), static_cast<long long>(max_memory_bytes >> 20));
+  }
+}
+
+static void
+profile_write()
+{
+  if (profiler && !profiler->write(profile_fname)) {
+    fatal(MYNAME ": Cannot write profile to \"%s\".\n", qPrintable(profile_fname));
+  }
+  if (gpsbabel::Trace::enabled() && !gpsbabel::Trace::write(trace_fname)) {
+    fatal(MYNAME ": Cannot write trace to \"%s\".\n", qPrintable(trace_fname));
+  }
+  gpsbabel::Counters::dump();
+}
+
+/* The distances computed so far, counted with -C. */
+static qint64
+distance_count()
+{
+  return gpsbabel::Counters::value("distance.gcdist") +
+         gpsbabel::Counters::value("distance.linedist");
+}
+
+/*
+ * The phases of a reader, writer or filter, each traced on its own.
+ */
+static void
+read_phases(Format* fmt, const QString& fmtname, const QString& fname)
+{
+  {
+    gpsbabel::TraceSpan span("reader", QStringLiteral("rd_init"), fmtname);
+    fmt->rd_init(fname);
+  }
+  {
+    gpsbabel::TraceSpan span("reader", QStringLiteral("read"), fmtname);
+    fmt->read();
+  }
+  {
+    gpsbabel::TraceSpan span("reader", QStringLiteral("rd_deinit"), fmtname);
+    fmt->rd_deinit();
+  }
+}
+
+static void
+write_phases(Format* fmt, const QString& fmtname, const QString& ofname)
+{
+  auto write = [fmt, &fmtname](const QString& fname) {
+    {
+      gpsbabel::TraceSpan span("writer", QStringLiteral("wr_init"), fmtname);
+      fmt->wr_init(fname);
+    }
+    {
+      gpsbabel::TraceSpan span("writer", QStringLiteral("write"), fmtname);
+      fmt->write();
+    }
+    {
+      gpsbabel::TraceSpan span("writer", QStringLiteral("wr_deinit"), fmtname);
+      fmt->wr_deinit();
+    }
+  };
+  if (Sharder::enabled()) {
+    Sharder::write(ofname, write);
+  } else {
+    write(ofname);
+  }
+}
+
+static void
+filter_phases(Filter* flt, const QString& fltname)
+{
+  {
+    gpsbabel::TraceSpan span("filter", QStringLiteral("init"), fltname);
+    flt->init();
+  }
+  {
+    gpsbabel::TraceSpan span("filter", QStringLiteral("process"), fltname);
+    const qint64 distances = distance_count();
+    flt->process();
+    if (gpsbabel::Counters::enabled()) {
+      gpsbabel::Counters::add(QStringLiteral("filter.%1.distances").arg(fltname),
+                              distance_count() - distances);
+    }
+  }
+  {
+    gpsbabel::TraceSpan span("filter", QStringLiteral("deinit"), fltname);
+    flt->deinit();
+  }
+}
+
 class QargStackElement
 {
 public:
@@ -142,6 +416,29 @@ usage(const char* pname, bool verbose)
     "    -r               Process route information\n"
     "    -t               Process track information\n"
     "    -T               Process realtime tracking information\n"
+    "    -q points[,drop] Queue realtime points for each output's thread\n"
+    "    -u rate          Write at most rate realtime points per second\n"
+    "    -Z               Stream points from input to output as they are read\n"
+    "    -P file          Write a JSON profile of every stage to file\n"
+    "    -Y file          Write a Chrome trace of the run to file\n"
+    "    -C               Print counts of the work done at exit\n"
+    "    -M megabytes     Stop if the data held takes more memory than this\n"
+    "    -K dir           Page waypoints out to a file in dir, not to swap\n"
+    "    -k dir[,mb]      Keep outputs in dir and reuse them for equal runs\n"
+    "    -J               Run conversion jobs read from stdin, one per line\n"
+    "    -j threads       Convert input/output file pairs read from stdin\n"
+    "    -z threads[,lvl] Compress .gz output on this many threads\n"
+    "    --map i/n        Read only part i of n of the input files, in order\n"
+    "    --memory-limit m Stop if the process takes more than m megabytes\n"
+    "    --shard key      Write every day, hour, tile=zoom, session or\n"
+    "                     track to a file of its own\n"
+    "    --threads n      Share parallel work among at most n threads\n"
+    "    --time-limit s   Stop if the conversion takes longer than s seconds\n"
+    "    --track-store s  Hold track points as points, the default, or\n"
+    "                     packed into a few bytes each between stages\n"
+    "    --xml-parser p   Parse XML with qt, the default, or the faster\n"
+    "                     but lenient fast parser for trusted files\n"
+    "    -R blocks        Read input this many blocks ahead on another thread\n"
     "    -w               Process waypoint information [default]\n"
     "    -b               Process command file (batch mode)\n"
     "    -x filtername    Invoke filter (placed between inputs and output)\n"
@@ -246,15 +543,14 @@ run_reader(Vecs::fmtinfo_t& ivecs, const QString& fname)
   if (global_opts.debug_level > 0)  {
     timer.start();
   }
+  profile_begin(QStringLiteral("reader"), ivecs.fmtname, fname);
   start_session(ivecs.fmtname, fname);
   if (ivecs.isDynamic()) {
     ivecs.fmt = ivecs.factory(fname);
     Vecs::init_vec(ivecs.fmt);
     Vecs::prepare_format(ivecs);
 
-    ivecs->rd_init(fname);
-    ivecs->read();
-    ivecs->rd_deinit();
+    read_phases(ivecs.fmt, ivecs.fmtname, fname);
 
     Vecs::exit_vec(ivecs.fmt);
     delete ivecs.fmt;
@@ -263,50 +559,1418 @@ run_reader(Vecs::fmtinfo_t& ivecs, const QString& fname)
     /* reinitialize xcsv in case two formats that use xcsv were given */
     Vecs::prepare_format(ivecs);
 
-    ivecs->rd_init(fname);
-    ivecs->read();
-    ivecs->rd_deinit();
+    read_phases(ivecs.fmt, ivecs.fmtname, fname);
+  }
+  if (pack_tracks) {
+    track_pack_all();
+  }
+  profile_end();
+  if (global_opts.debug_level > 0)  {
+    Warning().noquote() << QStringLiteral("%1: reader %2 took %3 seconds.")
+                        .arg(MYNAME, ivecs.fmtname, QString::number(timer.elapsed()/1000.0, 'f', 3));
+  }
+}
+
+/*
+ * Consecutive inputs whose formats can be read concurrently, see
+ * Format::rd_can_run_concurrently(), are collected here and read on a
+ * thread pool as soon as anything but another input comes along.
+ * Each is read into lists of its own, which are then appended to the
+ * global lists in command line order, so the result is the same as
+ * reading the inputs one after another.
+ */
+class ConcurrentReaders
+{
+public:
+  bool add(const Vecs::fmtinfo_t& ivecs, const QString& fname);
+  void run();
+
+private:
+  /* Types */
+
+  struct PendingRead {
+    Vecs::fmtinfo_t ivecs;
+    QString fname;
+    const session_t* session{nullptr};
+    WaypointList waypoints;
+    RouteList routes;
+    RouteList tracks;
+  };
+
+  /* Member Functions */
+
+  static void read(PendingRead& pending);
+  static void read_staged(PendingRead& pending);
+  static bool has_synthetic_names(const RouteList& routes);
+
+  /* Data Members */
+
+  std::vector<std::unique_ptr<PendingRead>> pending_reads;
+};
+
+bool
+ConcurrentReaders::add(const Vecs::fmtinfo_t& ivecs, const QString& fname)
+{
+  // Only files we can be sure to be able to read again if need be.
+  if (!ivecs.isDynamic() || (fname == "-") || !QFileInfo(fname).isFile()) {
+    return false;
+  }
+
+  auto pending = std::make_unique<PendingRead>();
+  pending->ivecs = ivecs;
+  pending->fname = fname;
+  pending->ivecs.fmt = ivecs.factory(fname);
+  Vecs::init_vec(pending->ivecs.fmt);
+  if (!pending->ivecs->rd_can_run_concurrently()) {
+    Vecs::exit_vec(pending->ivecs.fmt);
+    delete pending->ivecs.fmt;
+    return false;
+  }
+  Vecs::prepare_format(pending->ivecs);
+  pending->session = start_session(ivecs.fmtname, fname);
+  pending_reads.push_back(std::move(pending));
+  return true;
+}
+
+void
+ConcurrentReaders::read(PendingRead& pending)
+{
+  use_session(pending.session);
+  read_phases(pending.ivecs.fmt, pending.ivecs.fmtname, pending.fname);
+  use_session(nullptr);
+}
+
+void
+ConcurrentReaders::read_staged(PendingRead& pending)
+{
+  const ThreadScope scope;
+  waypt_use_list(&pending.waypoints);
+  route_use_lists(&pending.routes, &pending.tracks);
+  read(pending);
+}
+
+bool
+ConcurrentReaders::has_synthetic_names(const RouteList& routes)
+{
+  for (const route_head* rte : routes) {
+    for (const Waypoint* wpt : rte->waypoint_list) {
+      if (wpt->wpt_flags.shortname_is_synthetic) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void
+ConcurrentReaders::run()
+{
+  if (pending_reads.empty()) {
+    return;
+  }
+  if (global_opts.debug_level > 0)  {
+    timer.start();
+  }
+  // Concurrent reads overlap, so they are recorded as one stage.
+  QStringList names;
+  QStringList files;
+  for (const auto& pending : pending_reads) {
+    names.append(pending->ivecs.fmtname);
+    files.append(pending->fname);
+  }
+  profile_begin(QStringLiteral("reader"), names.join(','), files.join(','));
+
+  if (pending_reads.size() == 1) {
+    read(*pending_reads.front());
+  } else {
+    gpsbabel::TaskGroup group;
+    for (const auto& pending : pending_reads) {
+      PendingRead* p = pending.get();
+      group.run([p]() {
+        read_staged(*p);
+      });
+    }
+    group.wait();
+
+    for (const auto& pending : pending_reads) {
+      // Synthesized route point names are numbered across all routes,
+      // so routes read after others had such points need to be reread.
+      if ((route_waypt_count() > 0) && has_synthetic_names(pending->routes)) {
+        pending->waypoints.flush();
+        pending->routes.flush();
+        pending->tracks.flush();
+        Vecs::exit_vec(pending->ivecs.fmt);
+        delete pending->ivecs.fmt;
+        pending->ivecs.fmt = pending->ivecs.factory(pending->fname);
+        Vecs::init_vec(pending->ivecs.fmt);
+        Vecs::prepare_format(pending->ivecs);
+        read(*pending);
+      } else {
+        waypt_splice(&pending->waypoints);
+        route_splice(&pending->routes);
+        track_splice(&pending->tracks);
+      }
+    }
+  }
+
+  for (const auto& pending : pending_reads) {
+    Vecs::exit_vec(pending->ivecs.fmt);
+    delete pending->ivecs.fmt;
+  }
+  if (pack_tracks) {
+    track_pack_all();
+  }
+  profile_end();
+  if (global_opts.debug_level > 0)  {
+    Warning().noquote() << QStringLiteral("%1: %2 readers took %3 seconds.")
+                        .arg(MYNAME, QString::number(pending_reads.size()),
+                             QString::number(timer.elapsed()/1000.0, 'f', 3));
+  }
+  pending_reads.clear();
+}
+
+/*
+ * Consecutive outputs whose formats can be written concurrently, see
+ * Format::wr_can_run_concurrently(), are collected here and written on a
+ * thread pool as soon as anything but another output comes along.
+ * Such writers do not modify the data, so the outputs are the same as
+ * if they had been written one after another.
+ */
+class ConcurrentWriters
+{
+public:
+  bool add(const Vecs::fmtinfo_t& ovecs, const QString& ofname);
+  void run();
+
+private:
+  /* Types */
+
+  struct PendingWrite {
+    Vecs::fmtinfo_t ovecs;
+    QString ofname;
+  };
+
+  /* Member Functions */
+
+  static void write(const PendingWrite& pending);
+
+  /* Data Members */
+
+  std::vector<PendingWrite> pending_writes;
+};
+
+bool
+ConcurrentWriters::add(const Vecs::fmtinfo_t& ovecs, const QString& ofname)
+{
+  if (ofname == "-") {
+    return false;
+  }
+  const QString path = QFileInfo(ofname).absoluteFilePath();
+  for (const auto& pending : pending_writes) {
+    // A format instance can only write one file at a time.
+    if ((!ovecs.isDynamic() && (pending.ovecs.fmt == ovecs.fmt)) ||
+        (QFileInfo(pending.ofname).absoluteFilePath() == path)) {
+      return false;
+    }
+  }
+
+  PendingWrite pending{ovecs, ofname};
+  if (ovecs.isDynamic()) {
+    pending.ovecs.fmt = ovecs.factory(ofname);
+    Vecs::init_vec(pending.ovecs.fmt);
+  }
+  if (!pending.ovecs->wr_can_run_concurrently()) {
+    if (ovecs.isDynamic()) {
+      Vecs::exit_vec(pending.ovecs.fmt);
+      delete pending.ovecs.fmt;
+    }
+    return false;
+  }
+  pending_writes.push_back(pending);
+  return true;
+}
+
+void
+ConcurrentWriters::write(const PendingWrite& pending)
+{
+  write_phases(pending.ovecs.fmt, pending.ovecs.fmtname, pending.ofname);
+}
+
+void
+ConcurrentWriters::run()
+{
+  extern thread_local RouteList* global_route_list;
+  extern thread_local RouteList* global_track_list;
+
+  if (pending_writes.empty()) {
+    return;
+  }
+  if (global_opts.debug_level > 0)  {
+    timer.start();
+  }
+  // Concurrent writes overlap, so they are recorded as one stage.
+  QStringList names;
+  QStringList files;
+  for (const auto& pending : pending_writes) {
+    names.append(pending.ovecs.fmtname);
+    files.append(pending.ofname);
+  }
+  profile_begin(QStringLiteral("writer"), names.join(','), files.join(','));
+  track_unpack_all();
+
+  // Options are assigned to the format instances, which all differ.
+  for (const auto& pending : pending_writes) {
+    Vecs::prepare_format(pending.ovecs);
+  }
+
+  if (pending_writes.size() == 1) {
+    write(pending_writes.front());
+  } else {
+    // The routes' lazy caches must not be built on several threads at
+    // once, so the extent the writers use is built before they start.
+    auto build_extent = [](const route_head* rte)->void {
+      rte->extent();
+    };
+    route_disp_all(build_extent, nullptr, nullptr);
+    track_disp_all(build_extent, nullptr, nullptr);
+
+    WaypointList* waypoints = global_waypoint_list;
+    RouteList* routes = global_route_list;
+    RouteList* tracks = global_track_list;
+    gpsbabel::TaskGroup group;
+    for (const auto& pending : pending_writes) {
+      const PendingWrite* p = &pending;
+      group.run([p, waypoints, routes, tracks]() {
+        const ThreadScope scope;
+        waypt_use_list(waypoints);
+        route_use_lists(routes, tracks);
+        write(*p);
+      });
+    }
+    group.wait();
+  }
+
+  for (const auto& pending : pending_writes) {
+    if (pending.ovecs.isDynamic()) {
+      Vecs::exit_vec(pending.ovecs.fmt);
+      delete pending.ovecs.fmt;
+    }
+  }
+  profile_end();
+  if (global_opts.debug_level > 0)  {
+    Warning().noquote() << QStringLiteral("%1: %2 writers took %3 seconds.")
+                        .arg(MYNAME, QString::number(pending_writes.size()),
+                             QString::number(timer.elapsed()/1000.0, 'f', 3));
+  }
+  pending_writes.clear();
+}
+
+static void
+run_writer(Vecs::fmtinfo_t& ovecs, const QString& ofname)
+{
+  if (global_opts.debug_level > 0)  {
+    timer.start();
+  }
+  profile_begin(QStringLiteral("writer"), ovecs.fmtname, ofname);
+  track_unpack_all();
+  if (ovecs.isDynamic()) {
+    ovecs.fmt = ovecs.factory(ofname);
+    Vecs::init_vec(ovecs.fmt);
+    Vecs::prepare_format(ovecs);
+
+    write_phases(ovecs.fmt, ovecs.fmtname, ofname);
+
+    Vecs::exit_vec(ovecs.fmt);
+    delete ovecs.fmt;
+    ovecs.fmt = nullptr;
+  } else {
+    /* reinitialize xcsv in case two formats that use xcsv were given */
+    Vecs::prepare_format(ovecs);
+
+    write_phases(ovecs.fmt, ovecs.fmtname, ofname);
+  }
+  profile_end();
+  if (global_opts.debug_level > 0)  {
+    Warning().noquote() << QStringLiteral("%1: writer %2 took %3 seconds.")
+                        .arg(MYNAME, ovecs.fmtname, QString::number(timer.elapsed()/1000.0, 'f', 3));
+  }
+}
+
+static void
+run_filter(FilterVecs::fltinfo_t& filter)
+{
+  if (global_opts.debug_level > 0)  {
+    timer.start();
+  }
+  profile_begin(QStringLiteral("filter"), filter.fltname);
+  track_unpack_all();
+  if (filter.isDynamic()) {
+    filter.flt = filter.factory();
+    FilterVecs::init_filter_vec(filter.flt);
+    FilterVecs::prepare_filter(filter);
+
+    filter_phases(filter.flt, filter.fltname);
+    FilterVecs::free_filter_vec(filter.flt);
+
+    FilterVecs::exit_filter_vec(filter.flt);
+    delete filter.flt;
+    filter.flt = nullptr;
+  } else {
+    FilterVecs::prepare_filter(filter);
+    filter_phases(filter.flt, filter.fltname);
+    FilterVecs::free_filter_vec(filter.flt);
+  }
+  // Filters may change points without going through RouteList.
+  route_invalidate_caches();
+  profile_end();
+  if (global_opts.debug_level > 0)  {
+    Warning().noquote() << QStringLiteral("%1: filter %2 took %3 seconds.")
+                        .arg(MYNAME, filter.fltname, QString::number(timer.elapsed()/1000.0, 'f', 3));
+  }
+}
+
+/*
+ * Consecutive filters that work on one point at a time, see
+ * Filter::can_process_points(), are collected here and applied in a
+ * single pass over the waypoints, route points and track points as soon
+ * as anything but another filter comes along.  Each point goes through
+ * the filters in command line order, so the result is the same as
+ * running the filters one after another.
+ */
+class PointFilters
+{
+public:
+  bool add(const FilterVecs::fltinfo_t& filter);
+  void run();
+
+private:
+  std::vector<FilterVecs::fltinfo_t> pending_filters;
+};
+
+bool
+PointFilters::add(const FilterVecs::fltinfo_t& filter)
+{
+  for (const auto& pending : pending_filters) {
+    // A filter instance can only hold one set of options.
+    if (!filter.isDynamic() && (pending.flt == filter.flt)) {
+      return false;
+    }
+  }
+
+  FilterVecs::fltinfo_t pending = filter;
+  if (filter.isDynamic()) {
+    pending.flt = filter.factory();
+    FilterVecs::init_filter_vec(pending.flt);
+  }
+  if (!pending->can_process_points()) {
+    if (filter.isDynamic()) {
+      FilterVecs::exit_filter_vec(pending.flt);
+      delete pending.flt;
+    }
+    return false;
+  }
+  pending_filters.push_back(pending);
+  return true;
+}
+
+void
+PointFilters::run()
+{
+  if (pending_filters.empty()) {
+    return;
+  }
+  if (global_opts.debug_level > 0)  {
+    timer.start();
+  }
+  QStringList names;
+  for (const auto& pending : pending_filters) {
+    names.append(pending.fltname);
+  }
+  profile_begin(QStringLiteral("filter"), names.join(','));
+  track_unpack_all();
+
+  for (const auto& pending : pending_filters) {
+    FilterVecs::prepare_filter(pending);
+    pending->init();
+  }
+  auto process_point_lambda = [this](const Waypoint* wpt)->void {
+    auto* w = const_cast<Waypoint*>(wpt);
+    for (const auto& pending : pending_filters) {
+      pending->process_point(w);
+    }
+  };
+  waypt_disp_all(process_point_lambda);
+  route_disp_all(nullptr, nullptr, process_point_lambda);
+  track_disp_all(nullptr, nullptr, process_point_lambda);
+  for (const auto& pending : pending_filters) {
+    pending->deinit();
+    FilterVecs::free_filter_vec(pending.flt);
+    if (pending.isDynamic()) {
+      FilterVecs::exit_filter_vec(pending.flt);
+      delete pending.flt;
+    }
+  }
+
+  // Filters may change points without going through RouteList.
+  route_invalidate_caches();
+  profile_end();
+  if (global_opts.debug_level > 0)  {
+    Warning().noquote() << QStringLiteral("%1: %2 filters took %3 seconds in one pass.")
+                        .arg(MYNAME, QString::number(pending_filters.size()),
+                             QString::number(timer.elapsed()/1000.0, 'f', 3));
+  }
+  pending_filters.clear();
+}
+
+/*
+ * Hand every waypoint and track point straight on to the writer, or to
+ * the screen if there is no writer.
+ */
+class StreamSink : public PointSink
+{
+public:
+  StreamSink(Vecs::fmtinfo_t& ovecs, FallbackOutput& fbOutput) :
+    ovecs_(ovecs),
+    fbOutput_(fbOutput)
+  {}
+
+  void consume(Waypoint* wpt) override
+  {
+    if (ovecs_) {
+      ovecs_->wr_position(wpt);
+    } else {
+      fbOutput_.waypt_disp(wpt);
+    }
+    delete wpt;
+  }
+
+private:
+  Vecs::fmtinfo_t& ovecs_;
+  FallbackOutput& fbOutput_;
+};
+
+static void
+run_stream(Vecs::fmtinfo_t& ivecs, const QString& fname,
+           Vecs::fmtinfo_t& ovecs, const QString& ofname,
+           FallbackOutput& fbOutput)
+{
+  if (global_opts.debug_level > 0)  {
+    timer.start();
+  }
+  profile_begin(QStringLiteral("stream"), ivecs.fmtname, fname);
+  if (ivecs.isDynamic()) {
+    ivecs.fmt = ivecs.factory(fname);
+    Vecs::init_vec(ivecs.fmt);
+  }
+  if (ovecs && ovecs.isDynamic()) {
+    ovecs.fmt = ovecs.factory(ofname);
+    Vecs::init_vec(ovecs.fmt);
+  }
+
+  if (!ivecs->rd_can_stream()) {
+    fatal("Input type '%s' does not support streaming (-Z).\n", qPrintable(ivecs.fmtname));
+  }
+  if (ovecs && !ovecs->wr_can_stream()) {
+    fatal("Output type '%s' does not support streaming (-Z).\n", qPrintable(ovecs.fmtname));
+  }
+
+  if (ovecs) {
+    Vecs::prepare_format(ovecs);
+    ovecs->wr_position_init(ofname);
+  }
+
+  start_session(ivecs.fmtname, fname);
+  StreamSink sink(ovecs, fbOutput);
+  waypt_set_sink(&sink);
+  Vecs::prepare_format(ivecs);
+  read_phases(ivecs.fmt, ivecs.fmtname, fname);
+  waypt_set_sink(nullptr);
+
+  if (ovecs) {
+    Vecs::prepare_format(ovecs);
+    ovecs->wr_position_deinit();
+  }
+
+  if (ovecs && ovecs.isDynamic()) {
+    Vecs::exit_vec(ovecs.fmt);
+    delete ovecs.fmt;
+    ovecs.fmt = nullptr;
+  }
+  if (ivecs.isDynamic()) {
+    Vecs::exit_vec(ivecs.fmt);
+    delete ivecs.fmt;
+    ivecs.fmt = nullptr;
+  }
+  profile_end();
+  if (global_opts.debug_level > 0)  {
+    Warning().noquote() << QStringLiteral("%1: streaming %2 to %3 took %4 seconds.")
+                        .arg(MYNAME, ivecs.fmtname, ovecs ? ovecs.fmtname : QStringLiteral("screen"),
+                             QString::number(timer.elapsed()/1000.0, 'f', 3));
+  }
+}
+
+/*
+ * The time from receiving realtime positions to having written them, in
+ * buckets that are exact up to 16us and then split every power of two
+ * in 8, so percentiles are within 12.5% however long tracking runs.
+ */
+class LatencyHistogram
+{
+public:
+  void add(std::chrono::steady_clock::duration latency);
+  QString report() const;
+
+private:
+  static constexpr int kExact = 16;
+  static constexpr int kSplit = 8;
+
+  static int bucket(qint64 us);
+  static qint64 bucket_limit(int index);
+  qint64 percentile(double fraction) const;
+
+  std::vector<long long> buckets_;
+  long long count_{0};
+  qint64 max_{0};
+};
+
+int
+LatencyHistogram::bucket(qint64 us)
+{
+  if (us < kExact) {
+    return static_cast<int>(us);
+  }
+  int log2 = 0;
+  while ((us >> (log2 + 1)) != 0) {
+    ++log2;
+  }
+  // log2 is at least 4 here, and the 3 bits below the top one pick the split.
+  return kExact + (log2 - 4) * kSplit + static_cast<int>((us >> (log2 - 3)) & (kSplit - 1));
+}
+
+qint64
+LatencyHistogram::bucket_limit(int index)
+{
+  if (index < kExact) {
+    return index;
+  }
+  const int log2 = 4 + (index - kExact) / kSplit;
+  const qint64 split = (index - kExact) % kSplit;
+  return ((kSplit + split + 1) << (log2 - 3)) - 1;
+}
+
+void
+LatencyHistogram::add(std::chrono::steady_clock::duration latency)
+{
+  const qint64 us = std::max<qint64>(0, std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+  const int index = bucket(us);
+  if (index >= static_cast<int>(buckets_.size())) {
+    buckets_.resize(index + 1);
+  }
+  ++buckets_[index];
+  ++count_;
+  max_ = std::max(max_, us);
+}
+
+qint64
+LatencyHistogram::percentile(double fraction) const
+{
+  const long long rank = static_cast<long long>(std::ceil(fraction * count_));
+  long long seen = 0;
+  for (int i = 0; i < static_cast<int>(buckets_.size()); ++i) {
+    seen += buckets_.at(i);
+    if (seen >= rank) {
+      return std::min(bucket_limit(i), max_);
+    }
+  }
+  return max_;
+}
+
+QString
+LatencyHistogram::report() const
+{
+  if (count_ == 0) {
+    return QStringLiteral("nothing written");
+  }
+  auto ms = [](qint64 us)->QString {
+    return QString::number(us / 1000.0, 'f', 3);
+  };
+  return QStringLiteral("%1 written, latency p50 %2 ms, p90 %3 ms, p99 %4 ms, max %5 ms")
+         .arg(QString::number(count_), ms(percentile(0.5)), ms(percentile(0.9)),
+              ms(percentile(0.99)), ms(max_));
+}
+
+/*
+ * A realtime tracking (-T) output written on a thread of its own, so
+ * that a slow output holds up neither the input nor the other outputs.
+ * The positions wait for the writer in a queue of a bounded size.  When
+ * it is full the reader either waits for room or, with drop, the oldest
+ * position still waiting is dropped.
+ *
+ * With a rate, see -u, the writer writes at most that many positions a
+ * second.  Positions that arrive in between are coalesced, only the
+ * newest of them is written once the interval is over.
+ *
+ * The writer has its own lists and uses the session of the input.  A
+ * fatal error stops this output only; the reader notices at its next
+ * position.
+ *
+ * The copies come from the reader's Waypoint pool, which is not thread
+ * safe, so the writer never frees them.  Once written, dropped or
+ * coalesced they go back to the reader, which frees them at its next
+ * position or in finish().
+ */
+class RealtimeWriter
+{
+public:
+  /* The queue size without -q. */
+  static constexpr int default_queue_size = 64;
+
+  RealtimeWriter(const Vecs::fmtinfo_t& ovecs, const QString& ofname,
+                 int queue_size, bool drop, double rate);
+  ~RealtimeWriter();
+  RealtimeWriter(const RealtimeWriter&) = delete;
+  RealtimeWriter& operator=(const RealtimeWriter&) = delete;
+
+  void start(const session_t* session);
+  /* Queues a copy of wpt, returns false once the writer has failed. */
+  bool push(const Waypoint* wpt, std::chrono::steady_clock::time_point received);
+  /* Writes what is still queued and closes the output. */
+  bool finish();
+
+  const QString& fmtname() const {return ovecs_.fmtname;}
+  const QString& ofname() const {return ofname_;}
+
+private:
+  /* Types */
+
+  struct Pending {
+    std::unique_ptr<Waypoint> wpt;
+    std::chrono::steady_clock::time_point received;
+  };
+
+  /* Member Functions */
+
+  void run(const session_t* session);
+  void retire(std::unique_ptr<Waypoint> wpt);
+
+  /* Data Members */
+
+  Vecs::fmtinfo_t ovecs_;
+  QString ofname_;
+  std::size_t queue_size_;
+  bool drop_;
+  std::chrono::steady_clock::duration interval_{0};
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  std::deque<Pending> queue_;
+  std::vector<std::unique_ptr<Waypoint>> spent_;  // for the reader to free
+  long long dropped_{0};
+  long long coalesced_{0};
+  LatencyHistogram latency_;
+  bool finishing_{false};
+  bool failed_{false};
+};
+
+RealtimeWriter::RealtimeWriter(const Vecs::fmtinfo_t& ovecs, const QString& ofname,
+                               int queue_size, bool drop, double rate) :
+  ovecs_(ovecs),
+  ofname_(ofname),
+  queue_size_(queue_size),
+  drop_(drop)
+{
+  if (rate > 0) {
+    interval_ = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                  std::chrono::duration<double>(1.0 / rate));
+  }
+  if (ovecs_.isDynamic()) {
+    ovecs_.fmt = ovecs_.factory(ofname_);
+    Vecs::init_vec(ovecs_.fmt);
+  }
+}
+
+RealtimeWriter::~RealtimeWriter()
+{
+  finish();
+  // The instance of a failed output is not cleaned up.
+  if (ovecs_.isDynamic() && !failed_) {
+    Vecs::exit_vec(ovecs_.fmt);
+    delete ovecs_.fmt;
+  }
+}
+
+void
+RealtimeWriter::start(const session_t* session)
+{
+  Vecs::prepare_format(ovecs_);
+  thread_ = std::thread(&RealtimeWriter::run, this, session);
+}
+
+bool
+RealtimeWriter::push(const Waypoint* wpt, std::chrono::steady_clock::time_point received)
+{
+  std::vector<std::unique_ptr<Waypoint>> spent;
+  std::unique_lock<std::mutex> lock(mutex_);
+  spent.swap(spent_);
+  // Only the newest position waiting is written when coalescing.
+  const bool coalescing = (interval_.count() > 0);
+  if (!drop_ && !coalescing) {
+    changed_.wait(lock, [this]() {
+      return failed_ || (queue_.size() < queue_size_);
+    });
+  }
+  if (failed_) {
+    return false;
+  }
+  if (queue_.size() >= queue_size_) {
+    queue_.pop_front();
+    ++(coalescing? coalesced_ : dropped_);
+  }
+  queue_.push_back({std::make_unique<Waypoint>(*wpt), received});
+  changed_.notify_all();
+  return true;
+}
+
+bool
+RealtimeWriter::finish()
+{
+  if (thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      finishing_ = true;
+    }
+    changed_.notify_all();
+    thread_.join();
+    spent_.clear();
+    if (dropped_ > 0) {
+      warning(MYNAME ": %lld positions were dropped from output \"%s\".\n",
+              dropped_, qPrintable(ofname_));
+    }
+    if (global_opts.debug_level > 0)  {
+      Warning().noquote() << QStringLiteral("%1: realtime output %2 \"%3\": %4 coalesced, %5.")
+                          .arg(MYNAME, ovecs_.fmtname, ofname_, QString::number(coalesced_),
+                               latency_.report());
+    }
+  }
+  return !failed_;
+}
+
+void
+RealtimeWriter::run(const session_t* session)
+{
+  WaypointList waypoints;
+  RouteList routes;
+  RouteList tracks;
+  gpsbabel::ObjectPool::set_thread_bypass(true);
+  waypt_use_list(&waypoints);
+  route_use_lists(&routes, &tracks);
+  use_session(session);
+  fatal_set_throws(true);
+  Pending pending;
+  try {
+    ovecs_->wr_position_init(ofname_);
+    std::chrono::steady_clock::time_point next_write;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [this]() {
+          return finishing_ || !queue_.empty();
+        });
+        if (queue_.empty()) {
+          break;
+        }
+        if (interval_.count() > 0) {
+          // The last position is written without waiting.
+          changed_.wait_until(lock, next_write, [this]() {
+            return finishing_;
+          });
+          coalesced_ += static_cast<long long>(queue_.size()) - 1;
+          pending = std::move(queue_.back());
+          queue_.pop_back();
+          for (auto& skipped : queue_) {
+            spent_.push_back(std::move(skipped.wpt));
+          }
+          queue_.clear();
+        } else {
+          pending = std::move(queue_.front());
+          queue_.pop_front();
+        }
+      }
+      changed_.notify_all();
+      const auto started = std::chrono::steady_clock::now();
+      ovecs_->wr_position(pending.wpt.get());
+      latency_.add(std::chrono::steady_clock::now() - pending.received);
+      next_write = started + interval_;
+      retire(std::move(pending.wpt));
+    }
+    ovecs_->wr_position_deinit();
+  } catch (const FatalError&) {
+    // fatal() has reported the error already.
+    std::lock_guard<std::mutex> lock(mutex_);
+    failed_ = true;
+    spent_.push_back(std::move(pending.wpt));
+    for (auto& skipped : queue_) {
+      spent_.push_back(std::move(skipped.wpt));
+    }
+    queue_.clear();
+    changed_.notify_all();
+  }
+  fatal_set_throws(false);
+  use_session(nullptr);
+  waypoints.flush();
+  routes.flush();
+  tracks.flush();
+  route_use_lists(nullptr, nullptr);
+  waypt_use_list(nullptr);
+  gpsbabel::ObjectPool::set_thread_bypass(false);
+}
+
+void
+RealtimeWriter::retire(std::unique_ptr<Waypoint> wpt)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  spent_.push_back(std::move(wpt));
+}
+
+/*
+ * Batch mode.  Each line read from stdin names an input and an output
+ * file, and every input is converted to its output on its own, using
+ * the input type, filters and output type given on the command line.
+ * The jobs run on a pool of threads.  Every job has its own format and
+ * filter instances, its own lists and its own session, so this is only
+ * open to formats and filters that are created per use and that can
+ * run concurrently.  A fatal error only fails its own job.
+ */
+class BatchJobs
+{
+public:
+  BatchJobs(const Vecs::fmtinfo_t& ivecs, const QStringList& filters,
+            const Vecs::fmtinfo_t& ovecs) :
+    ivecs_(ivecs),
+    filters_(filters),
+    ovecs_(ovecs)
+  {}
+
+  int run(int threads);
+
+private:
+  /* Types */
+
+  struct Job {
+    QString fname;
+    QString ofname;
+    const session_t* session{nullptr};
+    QString error;
+  };
+
+  /* Member Functions */
+
+  void check() const;
+  void convert(Job& job) const;
+
+  /* Data Members */
+
+  Vecs::fmtinfo_t ivecs_;
+  QStringList filters_;
+  Vecs::fmtinfo_t ovecs_;
+};
+
+void
+BatchJobs::check() const
+{
+  if (!ivecs_ || !ovecs_) {
+    fatal("Batch mode (-j) requires an input type (-i) and an output type (-o).\n");
+  }
+  for (const Vecs::fmtinfo_t* vecs : {&ivecs_, &ovecs_}) {
+    bool ok = vecs->isDynamic();
+    if (ok) {
+      Format* fmt = vecs->factory(QString());
+      ok = (vecs == &ivecs_)? fmt->rd_can_run_concurrently() : fmt->wr_can_run_concurrently();
+      delete fmt;
+    }
+    if (!ok) {
+      fatal("Type '%s' can not be used in batch mode (-j).\n", qPrintable(vecs->fmtname));
+    }
+  }
+  for (const auto& spec : filters_) {
+    FilterVecs::fltinfo_t filter = FilterVecs::Instance().find_filter_vec(spec);
+    if (!filter) {
+      fatal("Unknown filter '%s'\n", qPrintable(spec));
+    }
+    if (!filter.isDynamic()) {
+      fatal("Filter '%s' can not be used in batch mode (-j).\n", qPrintable(filter.fltname));
+    }
+  }
+}
+
+void
+BatchJobs::convert(Job& job) const
+{
+  Vecs::fmtinfo_t ivecs = ivecs_;
+  ivecs.fmt = ivecs.factory(job.fname);
+  Vecs::init_vec(ivecs.fmt);
+  Vecs::prepare_format(ivecs);
+  ivecs->rd_init(job.fname);
+  ivecs->read();
+  ivecs->rd_deinit();
+  Vecs::exit_vec(ivecs.fmt);
+  delete ivecs.fmt;
+
+  for (const auto& spec : filters_) {
+    FilterVecs::fltinfo_t filter = FilterVecs::Instance().find_filter_vec(spec);
+    filter.flt = filter.factory();
+    FilterVecs::init_filter_vec(filter.flt);
+    FilterVecs::prepare_filter(filter);
+    filter->init();
+    filter->process();
+    filter->deinit();
+    FilterVecs::free_filter_vec(filter.flt);
+    FilterVecs::exit_filter_vec(filter.flt);
+    delete filter.flt;
+    route_invalidate_caches();
+  }
+
+  Vecs::fmtinfo_t ovecs = ovecs_;
+  ovecs.fmt = ovecs.factory(job.ofname);
+  Vecs::init_vec(ovecs.fmt);
+  Vecs::prepare_format(ovecs);
+  ovecs->wr_init(job.ofname);
+  ovecs->write();
+  ovecs->wr_deinit();
+  Vecs::exit_vec(ovecs.fmt);
+  delete ovecs.fmt;
+}
+
+int
+BatchJobs::run(int threads)
+{
+  check();
+
+  // Sessions can only be started on this thread.
+  std::vector<Job> jobs;
+  QTextStream in(stdin);
+  QString line;
+  while (!(line = in.readLine()).isNull()) {
+    line = line.trimmed();
+    if (line.isEmpty() || (line.at(0).toLatin1() == '#')) {
+      continue;
+    }
+    const QStringList names = csv_linesplit(line, " ", "\"", 0);
+    if (names.size() != 2) {
+      fatal("Batch mode (-j) expects an input and an output file per line, not \"%s\".\n", qPrintable(line));
+    }
+    Job job;
+    job.fname = names.at(0);
+    job.ofname = names.at(1);
+    job.session = start_session(ivecs_.fmtname, job.fname);
+    jobs.push_back(job);
+  }
+
+  if (global_opts.debug_level > 0)  {
+    timer.start();
+  }
+  // Each of the tasks converts whichever job is next until none are
+  // left, so at most threads jobs are converted at once.
+  std::atomic<std::size_t> next{0};
+  gpsbabel::TaskGroup group;
+  for (int i = 0; i < threads; ++i) {
+    group.run([this, &jobs, &next]() {
+      const ThreadScope scope;
+      fatal_set_throws(true);
+      for (std::size_t n = next++; n < jobs.size(); n = next++) {
+        Job* j = &jobs[n];
+        WaypointList waypoints;
+        RouteList routes;
+        RouteList tracks;
+        waypt_use_list(&waypoints);
+        route_use_lists(&routes, &tracks);
+        use_session(j->session);
+        try {
+          convert(*j);
+        } catch (const FatalError& e) {
+          // The instances of a failed job are not cleaned up.
+          j->error = QString::fromStdString(e.what());
+        }
+        waypoints.flush();
+        routes.flush();
+        tracks.flush();
+      }
+    });
+  }
+  group.wait();
+
+  int failed = 0;
+  for (const auto& job : jobs) {
+    if (!job.error.isNull()) {
+      warning(MYNAME ": Converting \"%s\" to \"%s\" failed: %s\n",
+              qPrintable(job.fname), qPrintable(job.ofname), qPrintable(job.error));
+      ++failed;
+    }
+  }
+  if (global_opts.debug_level > 0)  {
+    Warning().noquote() << QStringLiteral("%1: %2 jobs took %3 seconds on %4 threads.")
+                        .arg(MYNAME, QString::number(jobs.size()),
+                             QString::number(timer.elapsed()/1000.0, 'f', 3),
+                             QString::number(threads));
+  }
+  return (failed == 0)? 0 : 1;
+}
+
+static int serve(const char* prog_name, const QString& arg0);
+
+/*
+ * With -k the outputs of a conversion are kept in a cache directory,
+ * and a later conversion of the same inputs with the same options writes
+ * them from there without reading anything, see ResultCache.  A -k given
+ * with -J is used for all the jobs.
+ */
+static std::unique_ptr<gpsbabel::ResultCache> result_cache;
+static constexpr qint64 kResultCacheMegabytes = 256;
+
+/* --map, --memory-limit, --shard, --threads, --time-limit, --track-store
+ * and --xml-parser are the only long options, anything else with -- ends
+ * the options. */
+static bool
+is_long_option(const QString& arg)
+{
+  for (const QLatin1String name : {QLatin1String("--map"), QLatin1String("--memory-limit"), QLatin1String("--shard"),
+                                   QLatin1String("--threads"), QLatin1String("--time-limit"),
+                                   QLatin1String("--track-store"), QLatin1String("--xml-parser")
+                                  }) {
+    if (arg.startsWith(name) && ((arg.size() == name.size()) || (arg.at(name.size()) == '='))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// The short options that take an argument, attached or as the next one.
+static const QString kOptionsWithArgument = QStringLiteral("bDfFijkKMoPpqRuxYz");
+
+struct CachedRun {
+  QByteArray key;
+  QStringList outputs;
+};
+
+/*
+ * The values of the options of type file in options, e.g. an xcsv style
+ * or a geofence file, of a format or filter with the arguments args.
+ */
+static QStringList
+option_files(const QStringList& options, const QVector<arglist_t>* args)
+{
+  QStringList files;
+  if (args == nullptr) {
+    return files;
+  }
+  for (const auto& arg : *args) {
+    if ((arg.argtype & ARGTYPE_TYPEMASK) == ARGTYPE_FILE) {
+      const QString value = Vecs::get_option(options, arg.argstring);
+      if (!value.isEmpty()) {
+        files << value;
+      }
+    }
+  }
+  return files;
+}
+
+/*
+ * The files the options of the format or filter spec, the value of -i,
+ * -o or -x, name.
+ */
+static QStringList
+option_files(char c, const QString& spec)
+{
+  if (c == 'x') {
+    const FilterVecs::fltinfo_t filter = FilterVecs::Instance().find_filter_vec(spec);
+    if (!filter) {
+      return {};
+    }
+    if (filter.isDynamic()) {
+      Filter* flt = filter.factory();
+      const QStringList files = option_files(filter.options, flt->get_args());
+      delete flt;
+      return files;
+    }
+    return option_files(filter.options, filter.flt->get_args());
+  }
+
+  const Vecs::fmtinfo_t vecs = Vecs::Instance().find_vec(spec);
+  if (!vecs) {
+    return {};
+  }
+  if (vecs.isDynamic()) {
+    Format* fmt = vecs.factory(QString());
+    const QStringList files = option_files(vecs.options, fmt->get_args());
+    delete fmt;
+    return files;
+  }
+  return option_files(vecs.options, vecs.fmt->get_args());
+}
+
+/*
+ * Sets up the cache if qargs has -k, and returns whether the conversion
+ * qargs asks for can be cached: one that reads only regular files and
+ * writes only regular files, without -T, -Z, -b or anything else that
+ * depends on more than qargs or writes more than its outputs.
+ *
+ * The key is a hash of the version, the time zone, the preferences file
+ * and every option in order, with the contents of the inputs and of the
+ * files that format and filter options name instead of their names, and
+ * nothing of the outputs but their place.  A run whose options name a
+ * directory, like the height filter's, is not cached.  Debugging and
+ * status options are left out.
+ */
+static bool
+plan_cached_run(const QStringList& qargs, CachedRun& plan)
+{
+  // A file's contents are keyed instead of its name.
+  static const QString kFileMark = QStringLiteral("\x01");
+
+  QStringList keyed{gpsbabel_version, kVersionSHA,
+                    QString::fromLatin1(QTimeZone::systemTimeZoneId()),
+                    gpsbabel_testmode() ? QStringLiteral("test") : QString()};
+  if (global_opts.inifile) {
+    keyed << kFileMark + inifile_source(global_opts.inifile);
+  }
+  bool cacheable = true;
+  int argn = 1;
+  for (; argn < qargs.size(); ++argn) {
+    const QString& arg = qargs.at(argn);
+    if (is_long_option(arg)) {
+      const QString name = arg.section('=', 0, 0);
+      QString value = arg.section('=', 1);
+      if (!arg.contains('=') && (argn + 1 < qargs.size())) {
+        value = qargs.at(++argn);
+      }
+      // The outputs don't depend on the number of threads, on how tracks
+      // are held or on the limits of a run that finished, but the XML
+      // parsers differ on malformed files.
+      if ((name != QLatin1String("--threads")) && (name != QLatin1String("--track-store")) &&
+          (name != QLatin1String("--time-limit")) && (name != QLatin1String("--memory-limit"))) {
+        keyed << name << value;
+      }
+      // The shards aren't known until they are written.
+      if (name == QLatin1String("--shard")) {
+        cacheable = false;
+      }
+      continue;
+    }
+    if ((arg.size() < 2) || (arg.at(0) != '-') || (arg.at(1) == '-')) {
+      break;
+    }
+    const char c = arg.at(1).toLatin1();
+    QString value;
+    if (kOptionsWithArgument.contains(QLatin1Char(c))) {
+      value = (arg.size() > 2) ? arg.mid(2) : (argn + 1 < qargs.size()) ? qargs.at(++argn) : QString();
+    }
+    switch (c) {
+    case 'k': {
+      const QStringList parts = value.split(',');
+      bool ok = !parts.at(0).isEmpty() && (parts.size() <= 2);
+      qint64 megabytes = kResultCacheMegabytes;
+      if (ok && (parts.size() > 1)) {
+        megabytes = parts.at(1).toLongLong(&ok);
+      }
+      if (!ok || (megabytes <= 0)) {
+        fatal("the -k option requires a cache directory, i.e. -k dir[,megabytes]\n");
+      }
+      result_cache = std::make_unique<gpsbabel::ResultCache>(parts.at(0), megabytes << 20);
+      break;
+    }
+    case 'f':
+      keyed << arg.left(2) << kFileMark + value;
+      break;
+    case 'F':
+      keyed << arg.left(2);
+      plan.outputs << value;
+      break;
+    case 'p':
+      keyed << arg.left(2) << (value.isEmpty() ? value : kFileMark + value);
+      break;
+    case 'v':
+      if ((arg.size() > 2) && (arg.at(2).toLatin1() == 'p')) {
+        ++argn;
+      }
+      break;
+    case 'D':
+      break;
+    case 'i':
+    case 'o':
+    case 'x':
+      keyed << arg << value;
+      for (const QString& fname : option_files(c, value)) {
+        keyed << kFileMark + fname;
+      }
+      break;
+    case '@':
+    case '^':
+    case '%':
+    case '?':
+    case 'b':
+    case 'h':
+    case 'J':
+    case 'j':
+    case 'P':
+    case 'T':
+    case 'V':
+    case 'Y':
+    case 'Z':
+      cacheable = false;
+      break;
+    default:
+      keyed << arg << value;
+      break;
+    }
+  }
+  if (qargs.size() - argn > 2) {
+    cacheable = false;
+  }
+  if (argn < qargs.size()) {
+    keyed << kFileMark + qargs.at(argn);
+  }
+  if (argn + 1 < qargs.size()) {
+    keyed << QStringLiteral("-F");
+    plan.outputs << qargs.at(argn + 1);
+  }
+
+  if (!result_cache || !cacheable || plan.outputs.isEmpty()) {
+    return false;
   }
-  if (global_opts.debug_level > 0)  {
-    Warning().noquote() << QStringLiteral("%1: reader %2 took %3 seconds.")
-                        .arg(MYNAME, ivecs.fmtname, QString::number(timer.elapsed()/1000.0, 'f', 3));
+  for (const QString& output : std::as_const(plan.outputs)) {
+    const QFileInfo info(output);
+    if ((output == "-") || (info.exists() && !info.isFile())) {
+      return false;
+    }
+  }
+  QCryptographicHash key(QCryptographicHash::Sha256);
+  for (const QString& item : std::as_const(keyed)) {
+    if (item.startsWith(kFileMark)) {
+      const QString fname = item.mid(kFileMark.size());
+      if (!QFileInfo(fname).isFile()) {
+        return false;
+      }
+      const QByteArray digest = gpsbabel::ResultCache::file_digest(fname);
+      if (digest.isEmpty()) {
+        return false;
+      }
+      key.addData(digest.toHex());
+    } else {
+      key.addData(item.toUtf8());
+    }
+    key.addData(QByteArray(1, '\0'));
   }
+  plan.key = key.result();
+  return true;
 }
 
-static void
-run_writer(Vecs::fmtinfo_t& ovecs, const QString& ofname)
+/*
+ * The wpt_field data the writers and filters qargs asks for use, so the
+ * readers can skip the rest.  Anything but a plain run of -i, -f, -x and
+ * -o, like -b, -J or a file name without -F, wants all of it.
+ */
+static unsigned int
+wanted_fields(const QStringList& qargs)
 {
-  if (global_opts.debug_level > 0)  {
-    timer.start();
+  unsigned int fields = wpt_field_none;
+  bool has_output = false;
+  int argn = 1;
+  for (; argn < qargs.size(); ++argn) {
+    const QString& arg = qargs.at(argn);
+    if (is_long_option(arg)) {
+      if (!arg.contains('=')) {
+        ++argn;
+      }
+      continue;
+    }
+    if ((arg.size() < 2) || (arg.at(0) != '-') || (arg.at(1) == '-')) {
+      break;
+    }
+    const char c = arg.at(1).toLatin1();
+    QString value;
+    if (kOptionsWithArgument.contains(QLatin1Char(c))) {
+      value = (arg.size() > 2) ? arg.mid(2) : (argn + 1 < qargs.size()) ? qargs.at(++argn) : QString();
+    }
+    switch (c) {
+    case 'o': {
+      const Vecs::fmtinfo_t ovecs = Vecs::Instance().find_vec(value);
+      if (!ovecs) {
+        return wpt_field_all;
+      }
+      if (ovecs.isDynamic()) {
+        Format* fmt = ovecs.factory(QString());
+        fields |= fmt->wr_fields();
+        delete fmt;
+      } else {
+        fields |= ovecs.fmt->wr_fields();
+      }
+      has_output = true;
+      break;
+    }
+    case 'x': {
+      const FilterVecs::fltinfo_t filter = FilterVecs::Instance().find_filter_vec(value);
+      if (!filter) {
+        return wpt_field_all;
+      }
+      if (filter.isDynamic()) {
+        Filter* flt = filter.factory();
+        fields |= flt->fields();
+        delete flt;
+      } else {
+        fields |= filter.flt->fields();
+      }
+      break;
+    }
+    case 'v':
+      if ((arg.size() > 2) && (arg.at(2).toLatin1() == 'p')) {
+        ++argn;
+      }
+      break;
+    case 'b':
+    case 'J':
+      return wpt_field_all;
+    default:
+      break;
+    }
   }
-  if (ovecs.isDynamic()) {
-    ovecs.fmt = ovecs.factory(ofname);
-    Vecs::init_vec(ovecs.fmt);
-    Vecs::prepare_format(ovecs);
-
-    ovecs->wr_init(ofname);
-    ovecs->write();
-    ovecs->wr_deinit();
-
-    Vecs::exit_vec(ovecs.fmt);
-    delete ovecs.fmt;
-    ovecs.fmt = nullptr;
-  } else {
-    /* reinitialize xcsv in case two formats that use xcsv were given */
-    Vecs::prepare_format(ovecs);
-
-    ovecs->wr_init(ofname);
-    ovecs->write();
-    ovecs->wr_deinit();
+  if (!has_output || (argn < qargs.size())) {
+    return wpt_field_all;
   }
-  if (global_opts.debug_level > 0)  {
-    Warning().noquote() << QStringLiteral("%1: writer %2 took %3 seconds.")
-                        .arg(MYNAME, ovecs.fmtname, QString::number(timer.elapsed()/1000.0, 'f', 3));
+  return fields;
+}
+
+/*
+ * The number of -f options in qargs, for --map to cut them into parts.
+ */
+static int
+count_inputs(const QStringList& qargs)
+{
+  int count = 0;
+  for (int argn = 1; argn < qargs.size(); ++argn) {
+    const QString& arg = qargs.at(argn);
+    if (is_long_option(arg)) {
+      if (!arg.contains('=')) {
+        ++argn;
+      }
+      continue;
+    }
+    if ((arg.size() < 2) || (arg.at(0) != '-') || (arg.at(1) == '-')) {
+      break;
+    }
+    const char c = arg.at(1).toLatin1();
+    if (kOptionsWithArgument.contains(QLatin1Char(c)) && (arg.size() == 2)) {
+      ++argn;
+    }
+    if (c == 'f') {
+      ++count;
+    }
   }
+  return count;
 }
 
 static int
-run(const char* prog_name)
+run(const char* prog_name, QStringList qargs)
 {
   int argn;
   Vecs::fmtinfo_t ivecs;
@@ -316,18 +1980,36 @@ run(const char* prog_name)
   QString ofname;
   int opt_version = 0;
   bool did_something = false;
+  bool streaming = false;
+  int batch_threads = 0;
+  QStringList batch_filters;
+  struct RealtimeOutput {
+    Vecs::fmtinfo_t ovecs;
+    QString ofname;
+  };
+  QStringList realtime_inputs;
+  std::vector<RealtimeOutput> realtime_outputs;
+  int realtime_queue = 0;
+  bool realtime_drop = false;
+  double realtime_rate = 0;
+  int map_part = 0;    /* with --map, the part to read */
+  int map_parts = 0;   /* and of how many */
+  int map_first = 0;   /* the -f options of the part */
+  int map_end = 0;
+  int input_index = 0; /* of the next -f */
+  ConcurrentReaders readers;
+  ConcurrentWriters writers;
+  PointFilters point_filters;
   QStack<QargStackElement> qargs_stack;
   FallbackOutput fbOutput;
 
-
-  // Use QCoreApplication::arguments() to process the command line.
-  QStringList qargs = QCoreApplication::arguments();
-
   if (qargs.size() < 2) {
     usage(prog_name, false);
     return 0;
   }
 
+  global_opts.wanted_fields = wanted_fields(qargs);
+
   /*
    * Open-code getopts since POSIX-impaired OSes don't have one.
    */
@@ -340,11 +2022,15 @@ run(const char* prog_name)
     if (qargs.at(argn).size() > 0 && qargs.at(argn).at(0).toLatin1() != '-') {
       break;
     }
-    if (qargs.at(argn).size() > 1 && qargs.at(argn).at(1).toLatin1() == '-') {
+    if (qargs.at(argn).size() > 1 && qargs.at(argn).at(1).toLatin1() == '-' &&
+        !is_long_option(qargs.at(argn))) {
       break;
     }
 
     if (qargs.at(argn).size() > 1 && qargs.at(argn).at(1).toLatin1() == 'V') {
+      readers.run();
+      point_filters.run();
+      writers.run();
       printf("\nGPSBabel Version %s\n\n", gpsbabel_version);
       if (qargs.at(argn).size() > 2 && qargs.at(argn).at(2).toLatin1() == 'V') {
         print_extended_info();
@@ -353,6 +2039,9 @@ run(const char* prog_name)
     }
 
     if (qargs.at(argn).size() > 1 && (qargs.at(argn).at(1).toLatin1() == '?' || qargs.at(argn).at(1).toLatin1() == 'h')) {
+      readers.run();
+      point_filters.run();
+      writers.run();
       if (argn < qargs.size()-1) {
         spec_usage(qargs.at(argn+1));
       } else {
@@ -367,6 +2056,19 @@ run(const char* prog_name)
       opt_version = qargs.at(argn).at(2).digitValue();
     }
 
+    // Anything but further inputs may depend on the inputs read so far,
+    // anything but further filters on the filters run so far,
+    // and anything but further outputs may change what is written.
+    if ((c != 'i') && (c != 'f')) {
+      readers.run();
+    }
+    if (c != 'x') {
+      point_filters.run();
+    }
+    if ((c != 'o') && (c != 'F')) {
+      writers.run();
+    }
+
     switch (c) {
     case 'i':
       argument = FETCH_OPTARG;
@@ -391,10 +2093,23 @@ run(const char* prog_name)
       if (fname.isEmpty()) {
         fatal("No file or device name specified.\n");
       }
+      if (batch_threads > 0) {
+        fatal("In batch mode (-j) the files are read from stdin.\n");
+      }
       if (!ivecs) {
         fatal("No valid input type specified\n");
       }
+      // The inputs of the other parts are read by other runs.
+      if ((map_parts > 0) && ((input_index < map_first) || (input_index >= map_end))) {
+        ++input_index;
+        did_something = true;
+        break;
+      }
+      ++input_index;
       if (global_opts.masked_objective & POSNDATAMASK) {
+        realtime_inputs << fname;
+      }
+      if ((global_opts.masked_objective & POSNDATAMASK) || streaming) {
         did_something = true;
         break;
       }
@@ -403,7 +2118,10 @@ run(const char* prog_name)
         global_opts.masked_objective |= WPTDATAMASK;
       }
 
-      run_reader(ivecs, fname);
+      if (!readers.add(ivecs, fname)) {
+        readers.run();
+        run_reader(ivecs, fname);
+      }
 
       did_something = true;
       break;
@@ -413,14 +2131,22 @@ run(const char* prog_name)
       if (ofname.isEmpty()) {
         fatal("No output file or device name specified.\n");
       }
-      if (ovecs && (!(global_opts.masked_objective & POSNDATAMASK))) {
+      if (batch_threads > 0) {
+        fatal("In batch mode (-j) the files are read from stdin.\n");
+      }
+      if (ovecs && (!(global_opts.masked_objective & POSNDATAMASK)) && !streaming) {
         /* simulates the default behaviour of waypoints */
         if (doing_nothing) {
           global_opts.masked_objective |= WPTDATAMASK;
         }
 
-        run_writer(ovecs, ofname);
+        if (!writers.add(ovecs, ofname)) {
+          writers.run();
+          run_writer(ovecs, ofname);
+        }
 
+      } else if (ovecs && (global_opts.masked_objective & POSNDATAMASK)) {
+        realtime_outputs.push_back({ovecs, ofname});
       }
       break;
     case 's':
@@ -442,6 +2168,193 @@ run(const char* prog_name)
       global_opts.objective = posndata;
       global_opts.masked_objective |= POSNDATAMASK;
       break;
+    case 'q':
+      argument = FETCH_OPTARG;
+      {
+        const QStringList parts = argument.split(',');
+        bool ok;
+        realtime_queue = parts.at(0).toInt(&ok);
+        if (!ok || (realtime_queue < 1) || (parts.size() > 2)) {
+          fatal("the -q option requires a positive number of points, i.e. -q points[,drop]\n");
+        }
+        realtime_drop = false;
+        if (parts.size() > 1) {
+          if (parts.at(1) == "drop") {
+            realtime_drop = true;
+          } else if (parts.at(1) != "block") {
+            fatal("the -q policy must be drop or block\n");
+          }
+        }
+      }
+      break;
+    case 'u':
+      argument = FETCH_OPTARG;
+      {
+        bool ok;
+        realtime_rate = argument.toDouble(&ok);
+        if (!ok || !(realtime_rate > 0)) {
+          fatal("the -u option requires a positive number of updates per second, i.e. -u rate\n");
+        }
+      }
+      break;
+    case 'Z':
+      streaming = true;
+      break;
+    case 'J':
+      return serve(prog_name, qargs.at(0));
+    case 'k':
+      // The cache is set up by plan_cached_run().
+      argument = FETCH_OPTARG;
+      break;
+    case 'j':
+      argument = FETCH_OPTARG;
+      {
+        bool ok;
+        batch_threads = argument.toInt(&ok);
+        if (!ok || (batch_threads < 1)) {
+          fatal("the -j option requires a positive number of threads, i.e. -j threads\n");
+        }
+      }
+      break;
+    case '-': {
+      // --threads n or --threads=n, and the same for the others
+      const QString name = qargs.at(argn).section('=', 0, 0);
+      argument = qargs.at(argn).contains('=') ? qargs.at(argn).section('=', 1) :
+                 (qargs.size() > (argn + 1)) ? qargs.at(++argn) : QString();
+      if (name == QLatin1String("--threads")) {
+        bool ok;
+        const int threads = argument.toInt(&ok);
+        if (!ok || (threads < 1)) {
+          fatal("the --threads option requires a positive number of threads, i.e. --threads n\n");
+        }
+        gpsbabel::Scheduler::set_threads(threads);
+      } else if (name == QLatin1String("--map")) {
+        bool ok = argument.count('/') == 1;
+        bool ok_parts = ok;
+        if (ok) {
+          map_part = argument.section('/', 0, 0).toInt(&ok);
+          map_parts = argument.section('/', 1).toInt(&ok_parts);
+        }
+        if (!ok || !ok_parts || (map_parts < 1) || (map_part < 1) || (map_part > map_parts)) {
+          fatal("the --map option requires a part of a number of parts, i.e. --map 1/4\n");
+        }
+        if (input_index > 0) {
+          fatal("the --map option must come before the inputs\n");
+        }
+        // Parts of equal size in the order of the inputs, so that reading
+        // the parts one after another reads the inputs in their order.
+        const qint64 inputs = count_inputs(qargs);
+        map_first = static_cast<int>(inputs * (map_part - 1) / map_parts);
+        map_end = static_cast<int>(inputs * map_part / map_parts);
+      } else if (name == QLatin1String("--shard")) {
+        if (!Sharder::set_key(argument)) {
+          fatal("the --shard option requires day, hour, tile=zoom, session or track, i.e. --shard day\n");
+        }
+      } else if (name == QLatin1String("--time-limit")) {
+        bool ok;
+        const qint64 seconds = argument.toLongLong(&ok);
+        if (!ok || (seconds < 1)) {
+          fatal("the --time-limit option requires a positive number of seconds, i.e. --time-limit seconds\n");
+        }
+        gpsbabel::Budget::set_time_limit(seconds);
+      } else if (name == QLatin1String("--memory-limit")) {
+        bool ok;
+        const qint64 megabytes = argument.toLongLong(&ok);
+        if (!ok || (megabytes < 1)) {
+          fatal("the --memory-limit option requires a positive number of megabytes, i.e. --memory-limit megabytes\n");
+        }
+        gpsbabel::Budget::set_memory_limit(megabytes << 20);
+      } else if (name == QLatin1String("--track-store")) {
+        if (argument == QLatin1String("points")) {
+          pack_tracks = false;
+        } else if (argument == QLatin1String("packed")) {
+          pack_tracks = true;
+        } else {
+          fatal("the --track-store option requires points or packed, i.e. --track-store packed\n");
+        }
+      } else {
+        gpsbabel::XmlPullReader::Backend backend;
+        if (!gpsbabel::XmlPullReader::parse_backend(argument, &backend)) {
+          fatal("the --xml-parser option requires qt or fast, i.e. --xml-parser fast\n");
+        }
+        gpsbabel::XmlPullReader::set_default_backend(backend);
+      }
+      break;
+    }
+    case 'z':
+      argument = FETCH_OPTARG;
+      {
+        const QStringList parts = argument.split(',');
+        bool ok;
+        int threads = parts.at(0).toInt(&ok);
+        if (!ok || (threads < 1)) {
+          fatal("the -z option requires a positive number of threads, i.e. -z threads[,level]\n");
+        }
+        int level = gpsbabel::ParallelDeflate::default_level();
+        if (parts.size() > 1) {
+          level = parts.at(1).toInt(&ok);
+          if (!ok || (level < 0) || (level > 9)) {
+            fatal("the -z compression level must be from 0 to 9\n");
+          }
+        }
+        gpsbabel::ParallelDeflate::set_defaults(threads, level);
+      }
+      break;
+    case 'R':
+      argument = FETCH_OPTARG;
+      {
+        bool ok;
+        int depth = argument.toInt(&ok);
+        if (!ok || (depth < 0)) {
+          fatal("the -R option requires a number of blocks, i.e. -R blocks\n");
+        }
+        gpsbabel::ReadAhead::set_depth(depth);
+      }
+      break;
+    case 'P':
+      argument = FETCH_OPTARG;
+      if (argument.isEmpty()) {
+        fatal("No profile file name specified.\n");
+      }
+      profile_fname = argument;
+      if (!profiler) {
+        profiler = std::make_unique<gpsbabel::Profiler>();
+      }
+      break;
+    case 'C':
+      gpsbabel::Counters::enable();
+      break;
+    case 'K':
+      argument = FETCH_OPTARG;
+      if (argument.isEmpty()) {
+        fatal("No spill directory specified.\n");
+      }
+      if (!gpsbabel::ObjectPool::set_spill_directory(QFile::encodeName(argument).toStdString())) {
+        fatal(MYNAME ": Cannot make a spill file in \"%s\".\n", qPrintable(argument));
+      }
+      if (!spill_arena) {
+        spill_arena = std::make_unique<AllocationArena>();
+      }
+      break;
+    case 'M':
+      argument = FETCH_OPTARG;
+      {
+        bool ok;
+        qint64 megabytes = argument.toLongLong(&ok);
+        if (!ok || (megabytes <= 0)) {
+          fatal("the -M option requires a positive number of megabytes, i.e. -M megabytes\n");
+        }
+        max_memory_bytes = megabytes << 20;
+      }
+      break;
+    case 'Y':
+      argument = FETCH_OPTARG;
+      if (argument.isEmpty()) {
+        fatal("No trace file name specified.\n");
+      }
+      trace_fname = argument;
+      gpsbabel::Trace::start();
+      break;
     case 'S':
       switch (qargs.at(argn).size() > 2 ? qargs.at(argn).at(2).toLatin1() : '\0') {
       case 'i':
@@ -458,35 +2371,19 @@ run(const char* prog_name)
       break;
     case 'x':
       argument = FETCH_OPTARG;
+      if (streaming) {
+        fatal("Filters can not be used with streaming (-Z).\n");
+      }
+      if (batch_threads > 0) {
+        batch_filters.append(argument);
+        break;
+      }
       filter = FilterVecs::Instance().find_filter_vec(argument);
 
       if (filter) {
-        if (global_opts.debug_level > 0)  {
-          timer.start();
-        }
-        if (filter.isDynamic()) {
-          filter.flt = filter.factory();
-          FilterVecs::init_filter_vec(filter.flt);
-          FilterVecs::prepare_filter(filter);
-
-          filter->init();
-          filter->process();
-          filter->deinit();
-          FilterVecs::free_filter_vec(filter.flt);
-
-          FilterVecs::exit_filter_vec(filter.flt);
-          delete filter.flt;
-          filter.flt = nullptr;
-        } else {
-          FilterVecs::prepare_filter(filter);
-          filter->init();
-          filter->process();
-          filter->deinit();
-          FilterVecs::free_filter_vec(filter.flt);
-        }
-        if (global_opts.debug_level > 0)  {
-          Warning().noquote() << QStringLiteral("%1: filter %2 took %3 seconds.")
-                              .arg(MYNAME, filter.fltname, QString::number(timer.elapsed()/1000.0, 'f', 3));
+        if (!point_filters.add(filter)) {
+          point_filters.run();
+          run_filter(filter);
         }
       }  else {
         fatal("Unknown filter '%s'\n",qPrintable(argument));
@@ -501,6 +2398,9 @@ run(const char* prog_name)
           fatal("the -D option requires an integer value to specify the debug level, i.e. -D level\n");
         }
       }
+      if (global_opts.debug_level >= 2) {
+        gpsbabel::Counters::enable();
+      }
       /*
        * When debugging, announce version.
        */
@@ -549,6 +2449,19 @@ run(const char* prog_name)
       case 'S':
         global_opts.verbose_status = 2;
         break;
+      case 'p':
+        /* -vp fd: machine readable progress on an open descriptor. */
+        if (qargs.size() <= (argn + 1)) {
+          fatal("No file descriptor specified for -vp.\n");
+        } else {
+          bool ok;
+          int fd = qargs.at(++argn).toInt(&ok);
+          if (!ok || (fd < 0)) {
+            fatal("Invalid file descriptor for -vp.\n");
+          }
+          gpsbabel::Progress::set_fd(fd);
+        }
+        break;
       }
       break;
 
@@ -600,6 +2513,9 @@ run(const char* prog_name)
     }
     argn++;
   }
+  readers.run();
+  point_filters.run();
+  writers.run();
 
   /*
    * Allow input and output files to be specified positionally
@@ -608,8 +2524,14 @@ run(const char* prog_name)
   for (int i = 0; i < argn; i++) {
     qargs.removeFirst();
   }
-  if (qargs.size() > 2) {
+  if ((qargs.size() > 2) || ((batch_threads > 0) && !qargs.isEmpty())) {
     fatal("Extra arguments on command line\n");
+  } else if ((!qargs.isEmpty()) && streaming) {
+    did_something = true;
+    fname = qargs.at(0);
+    if (qargs.size() == 2) {
+      ofname = qargs.at(1);
+    }
   } else if ((!qargs.isEmpty()) && ivecs) {
     did_something = true;
     /* simulates the default behaviour of waypoints */
@@ -628,6 +2550,48 @@ run(const char* prog_name)
     usage(prog_name, true);
     return 0;
   }
+
+  if (batch_threads > 0) {
+    if (streaming || (global_opts.masked_objective & POSNDATAMASK)) {
+      fatal("Batch mode (-j) can not be combined with -Z or -T.\n");
+    }
+    /* simulates the default behaviour of waypoints */
+    if (doing_nothing) {
+      global_opts.masked_objective |= WPTDATAMASK;
+    }
+    return BatchJobs(ivecs, batch_filters, ovecs).run(batch_threads);
+  }
+
+  /*
+   * In streaming mode the points of the last input are written to the
+   * last output as they are read, so neither one is run above.
+   */
+  if (streaming) {
+    if (global_opts.masked_objective & POSNDATAMASK) {
+      fatal("Streaming (-Z) and realtime tracking (-T) are exclusive.\n");
+    }
+    if (!ivecs) {
+      fatal("Streaming (-Z) requires an input type (-i).\n");
+    }
+    if (fname.isEmpty()) {
+      fatal("An input file (-f) must be specified.\n");
+    }
+    if (ovecs && ofname.isEmpty()) {
+      fatal("An output file (-F) must be specified.\n");
+    }
+    /*
+     * Streamed points of a kind that wasn't asked for are dropped, so
+     * without -w or -t both waypoints and track points are streamed.
+     */
+    if (doing_nothing) {
+      global_opts.masked_objective |= WPTDATAMASK | TRKDATAMASK;
+    }
+
+    run_stream(ivecs, fname, ovecs, ofname, fbOutput);
+
+    return 0;
+  }
+
   if (!ovecs) {
     auto waypt_disp_lambda = [&fbOutput](const Waypoint* wpt)->void {
       fbOutput.waypt_disp(wpt);
@@ -640,7 +2604,9 @@ run(const char* prog_name)
    * If we're doing realtime position tracking, we enforce that
    * we're not doing anything else and we just bounce between
    * the special "read position" and "write position" vectors
-   * in our most recent vecs.
+   * in our most recent vecs.  With several outputs, or with -q or
+   * -u, every output is written on a thread of its own.  Several
+   * inputs are all read by the one input format, if it can.
    */
   if (global_opts.masked_objective & POSNDATAMASK) {
 
@@ -652,18 +2618,53 @@ run(const char* prog_name)
       fatal("An input file (-f) must be specified.\n");
     }
 
+    if (realtime_outputs.empty() && ovecs) {
+      realtime_outputs.push_back({ovecs, ofname});
+    }
+    const bool threaded = (realtime_outputs.size() > 1) ||
+                          (((realtime_queue > 0) || (realtime_rate > 0)) && !realtime_outputs.empty());
+    if (threaded) {
+      // A format instance can only be used by one thread.
+      for (auto it = realtime_outputs.cbegin(); it != realtime_outputs.cend(); ++it) {
+        if (it->ovecs.isDynamic()) {
+          continue;
+        }
+        bool shared = (!ivecs.isDynamic() && (it->ovecs.fmt == ivecs.fmt));
+        for (auto prev = realtime_outputs.cbegin(); prev != it; ++prev) {
+          shared = shared || (prev->ovecs.fmt == it->ovecs.fmt);
+        }
+        if (shared) {
+          fatal("Type '%s' can only be used once in realtime tracking (-T) with several outputs or -q.\n",
+                qPrintable(it->ovecs.fmtname));
+        }
+      }
+      if (realtime_queue == 0) {
+        realtime_queue = RealtimeWriter::default_queue_size;
+      }
+    }
+
     if (ivecs.isDynamic()) {
       ivecs.fmt = ivecs.factory(fname);
       Vecs::init_vec(ivecs.fmt);
     }
-    if (ovecs && ovecs.isDynamic()) {
+    std::vector<std::unique_ptr<RealtimeWriter>> realtime_writers;
+    if (threaded) {
+      for (const auto& output : realtime_outputs) {
+        realtime_writers.push_back(std::make_unique<RealtimeWriter>(output.ovecs, output.ofname,
+                                   realtime_queue, realtime_drop, realtime_rate));
+      }
+    } else if (ovecs && ovecs.isDynamic()) {
       ovecs.fmt = ovecs.factory(ofname);
       Vecs::init_vec(ovecs.fmt);
     }
 
-    start_session(ivecs.fmtname, fname);
+    const session_t* session = start_session(ivecs.fmtname, fname);
     Vecs::prepare_format(ivecs);
-    ivecs->rd_position_init(fname);
+    if (realtime_inputs.size() > 1) {
+      ivecs->rd_position_init_many(realtime_inputs);
+    } else {
+      ivecs->rd_position_init(fname);
+    }
 
     if (global_opts.masked_objective & ~POSNDATAMASK) {
       fatal("Realtime tracking (-T) is exclusive of other modes.\n");
@@ -673,24 +2674,43 @@ run(const char* prog_name)
       fatal("Couldn't install the exit signal handler.\n");
     }
 
-    if (ovecs) {
+    if (threaded) {
+      // The writers free points on their threads, so the pool must not
+      // change under them.
+      gpsbabel::ObjectPool::set_thread_bypass(true);
+      for (const auto& writer : realtime_writers) {
+        writer->start(session);
+      }
+    } else if (ovecs) {
       Vecs::prepare_format(ovecs);
       ovecs->wr_position_init(ofname);
     }
 
+    const RealtimeWriter* failed = nullptr;
+    LatencyHistogram latency;
     tracking_status.request_terminate = 0;
-    while (!tracking_status.request_terminate) {
+    while (!tracking_status.request_terminate && !failed) {
+      tracking_status.received = {};
       Waypoint* wpt = ivecs->rd_position(&tracking_status);
+      const auto received = (tracking_status.received != std::chrono::steady_clock::time_point{}) ?
+                            tracking_status.received : std::chrono::steady_clock::now();
 
       if (tracking_status.request_terminate) {
         delete wpt;
         break;
       }
       if (wpt) {
-        if (ovecs) {
+        if (threaded) {
+          for (const auto& writer : realtime_writers) {
+            if (!writer->push(wpt, received)) {
+              failed = writer.get();
+            }
+          }
+        } else if (ovecs) {
 //          ovecs->wr_position_init(ofname);
           ovecs->wr_position(wpt);
 //          ovecs->wr_position_deinit();
+          latency.add(std::chrono::steady_clock::now() - received);
         } else {
           /* Just print to screen */
           fbOutput.waypt_disp(wpt);
@@ -700,12 +2720,28 @@ run(const char* prog_name)
     }
     Vecs::prepare_format(ivecs);
     ivecs->rd_position_deinit();
-    if (ovecs) {
+    if (threaded) {
+      for (const auto& writer : realtime_writers) {
+        if (!writer->finish() && !failed) {
+          failed = writer.get();
+        }
+      }
+      if (failed) {
+        fatal(MYNAME ": Realtime output to '%s' \"%s\" failed.\n",
+              qPrintable(failed->fmtname()), qPrintable(failed->ofname()));
+      }
+      realtime_writers.clear();
+      gpsbabel::ObjectPool::set_thread_bypass(false);
+    } else if (ovecs) {
       Vecs::prepare_format(ovecs);
       ovecs->wr_position_deinit();
+      if (global_opts.debug_level > 0)  {
+        Warning().noquote() << QStringLiteral("%1: realtime output %2 \"%3\": %4.")
+                            .arg(MYNAME, ovecs.fmtname, ofname, latency.report());
+      }
     }
 
-    if (ovecs && ovecs.isDynamic()) {
+    if (!threaded && ovecs && ovecs.isDynamic()) {
       Vecs::exit_vec(ovecs.fmt);
       delete ovecs.fmt;
       ovecs.fmt = nullptr;
@@ -726,6 +2762,122 @@ run(const char* prog_name)
   return 0;
 }
 
+/*
+ * run() through the cache of -k.  Outputs are only kept if the run wrote
+ * all of them and no other files named like them, as ozi does.
+ */
+static int
+run_cached(const char* prog_name, const QStringList& qargs)
+{
+  CachedRun plan;
+  if (!plan_cached_run(qargs, plan)) {
+    return run(prog_name, qargs);
+  }
+  if (result_cache->fetch(plan.key, plan.outputs)) {
+    return 0;
+  }
+
+  // The files named like the outputs, as they were before the run.
+  auto siblings = [&plan]() {
+    QMap<QString, QDateTime> files;
+    for (const QString& output : std::as_const(plan.outputs)) {
+      const QFileInfo info(output);
+      const QFileInfoList entries = info.dir().entryInfoList({info.completeBaseName() + ".*"},
+                                    QDir::Files);
+      for (const QFileInfo& entry : entries) {
+        files.insert(entry.absoluteFilePath(), entry.lastModified());
+      }
+    }
+    return files;
+  };
+  const QMap<QString, QDateTime> before = siblings();
+  int rc = run(prog_name, qargs);
+  if (rc != 0) {
+    return rc;
+  }
+  QStringList written;
+  for (const QString& output : std::as_const(plan.outputs)) {
+    const QString path = QFileInfo(output).absoluteFilePath();
+    if (!QFileInfo(path).isFile() || (before.value(path) == QFileInfo(path).lastModified())) {
+      return rc;
+    }
+    written << path;
+  }
+  const QMap<QString, QDateTime> after = siblings();
+  for (auto it = after.cbegin(); it != after.cend(); ++it) {
+    if (!written.contains(it.key()) && (before.value(it.key()) != it.value())) {
+      return rc;
+    }
+  }
+  result_cache->store(plan.key, plan.outputs);
+  return rc;
+}
+
+/*
+ * Server mode.  Every line read from stdin is the argument list of one
+ * conversion, split like the contents of a batch file, and after each
+ * conversion its exit status is written to stdout on a line of its own.
+ * All the expensive setup is done once; each job then runs in a forked
+ * copy of this process, so no state, e.g. options, data or the state the
+ * formats keep, can leak from one job into the next, and a fatal error
+ * only ends its own job.
+ */
+static int
+serve(const char* prog_name, const QString& arg0)
+{
+#if __WIN32__
+  (void) prog_name;
+  (void) arg0;
+  fatal(MYNAME ": Server mode (-J) is not supported on this platform.\n");
+#else
+  QTextStream in(stdin);
+  QString line;
+  while (!(line = in.readLine()).isNull()) {
+    line = line.trimmed();
+    if (line.isEmpty() || (line.at(0).toLatin1() == '#')) {
+      continue;
+    }
+    QStringList jargs(arg0);
+    jargs.append(csv_linesplit(line, " ", "\"", 0));
+
+    // Don't let the job inherit output that is still buffered.
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0) {
+      fatal(MYNAME ": Cannot start a job.\n");
+    }
+    if (pid == 0) {
+      // The rest of stdin is the job list, not input for the job.
+      int null_fd = open("/dev/null", O_RDONLY);
+      if (null_fd >= 0) {
+        dup2(null_fd, STDIN_FILENO);
+        close(null_fd);
+      }
+      gpsbabel::Budget::set_hard_stop(true);
+      int rc = run_cached(prog_name, jargs);
+      gpsbabel::Progress::finish();
+      profile_write();
+      fflush(nullptr);
+      exit(rc);
+    }
+
+    int status = 0;
+    int rc;
+    if (waitpid(pid, &status, 0) < 0) {
+      rc = 1;
+    } else if (WIFEXITED(status)) {
+      rc = WEXITSTATUS(status);
+    } else {
+      rc = 128 + WTERMSIG(status);
+    }
+    printf("%d\n", rc);
+    fflush(stdout);
+  }
+  return 0;
+#endif
+}
+
 int
 main(int argc, char* argv[])
 {
@@ -812,10 +2964,20 @@ main(int argc, char* argv[])
   waypt_init();
   route_init();
 
-  rc = run(prog_name);
+  if (qEnvironmentVariableIsSet("GPSBABEL_TRACE")) {
+    trace_fname = qEnvironmentVariable("GPSBABEL_TRACE");
+    gpsbabel::Trace::start();
+  }
+
+  // Use QCoreApplication::arguments() to process the command line.
+  rc = run_cached(prog_name, QCoreApplication::arguments());
+
+  gpsbabel::Progress::finish();
+  profile_write();
 
   route_deinit();
   waypt_deinit();
+  spill_arena.reset();
   session_exit();
   FilterVecs::Instance().exit_filter_vecs();
   Vecs::Instance().exit_vecs();
@@ -23,7 +23,7 @@
 
 #include <cassert>     // for assert
 #include <cctype>      // for isspace, isdigit
-#include <utility>     // for as_const
+#include <utility>     // for move
 
 #include <QByteArray>  // for QByteArray
 #include <QChar>       // for QChar, QChar::ReplacementCharacter
@@ -81,25 +81,43 @@ void MakeShort::mkshort_add_to_list(QByteArray& name, bool is_utf8)
  * This is the stuff that makes me ashamed to be a C programmer...
  */
 
-bool MakeShort::delete_last_vowel(int start, QByteArray& iostring)
+/*
+ * Delete vowels from the end until iostring is no longer than max_len,
+ * keeping the first start characters.  A vowel right after a space
+ * begins a word and is kept.  Deleting a vowel never changes whether
+ * a vowel before it may go, so one pass from the end deletes the same
+ * ones as searching again from the end after every deletion.
+ */
+void MakeShort::delete_vowels(int start, int max_len, QByteArray& iostring)
 {
-  /*
-   * Basically implement strrchr.
-   */
   assert(start >= 1);
-  bool replaced = false;
-  for (int l = iostring.size(); l > start; --l) {
-    if (vowels.contains(iostring.at(l - 1))) {
-      /* If vowel is the first letter of a word, keep it.*/
-      if (iostring.at(l - 2) == ' ') {
-        continue;
+  qsizetype excess = iostring.size() - max_len;
+  auto deletable = [start](const QByteArray& s, qsizetype i, char prev) {
+    return (i >= start) && vowels.contains(s.at(i)) && (prev != ' ');
+  };
+
+  qsizetype first = iostring.size();
+  for (qsizetype i = iostring.size() - 1; (excess > 0) && (i >= start); --i) {
+    if (deletable(iostring, i, iostring.at(i - 1))) {
+      first = i;
+      --excess;
+    }
+  }
+
+  // Every deletable vowel from first on goes.
+  if (first < iostring.size()) {
+    char* data = iostring.data();
+    qsizetype out = first;
+    char prev = data[first - 1];
+    for (qsizetype i = first; i < iostring.size(); ++i) {
+      const char ch = data[i];
+      if (!deletable(iostring, i, prev)) {
+        data[out++] = ch;
       }
-      iostring.remove(l - 1, 1);
-      replaced = true;
-      break;
+      prev = ch;
     }
+    iostring.truncate(out);
   }
-  return replaced;
 }
 
 /*
@@ -214,7 +232,15 @@ QByteArray MakeShort::mkshort(const QByteArray& istring, bool is_utf8)
 {
   QByteArray ostring;
 
-  if (is_utf8) {
+  bool ascii = true;
+  for (const char ch : istring) {
+    if (static_cast<unsigned char>(ch) >= 0x80) {
+      ascii = false;
+      break;
+    }
+  }
+
+  if (is_utf8 && !ascii) {
     /* clean UTF-8 string */
     QString result = QString::fromUtf8(istring);
     // QString::fromUtf8() doesn't quite promise to use QChar::ReplacementCharacter,
@@ -245,24 +271,25 @@ QByteArray MakeShort::mkshort(const QByteArray& istring, bool is_utf8)
     ostring.remove(0, 4);
   }
 
+  /*
+   * The passes below rework ostring in place; the rvalue overloads of
+   * trimmed(), simplified() and toUpper() reuse its buffer.
+   */
+
   /* In all cases eliminate leading and trailing whitespace */
-  ostring = ostring.trimmed();
+  ostring = std::move(ostring).trimmed();
 
   if (!whitespaceok_) {
     /*
      * Eliminate Whitespace
      */
-    QByteArray tstring;
-    ostring.swap(tstring);
-    for (const auto ch : std::as_const(tstring)) {
-      if (!isspace(ch)) {
-        ostring.append(ch);
-      }
-    }
+    ostring.removeIf([](char ch) {
+      return isspace(ch);
+    });
   }
 
   if (mustupper_) {
-    ostring = ostring.toUpper();
+    ostring = std::move(ostring).toUpper();
   }
 
   /* Before we do any of the vowel or character removal, look for
@@ -274,19 +301,10 @@ QByteArray MakeShort::mkshort(const QByteArray& istring, bool is_utf8)
   /*
    * Eliminate chars on the blacklist.
    */
-  {
-    QByteArray tstring;
-    ostring.swap(tstring);
-    for (const auto ch : std::as_const(tstring)) {
-      if (badchars_.contains(ch)) {
-        continue;
-      }
-      if (!goodchars_.isEmpty() && (!goodchars_.contains(ch))) {
-        continue;
-      }
-      ostring.append(ch);
-    }
-  }
+  ostring.removeIf([this](char ch) {
+    return badchars_.contains(ch) ||
+           (!goodchars_.isEmpty() && (!goodchars_.contains(ch)));
+  });
 
   /*
    * Eliminate whitespace.
@@ -295,7 +313,7 @@ QByteArray MakeShort::mkshort(const QByteArray& istring, bool is_utf8)
    * operations that removed character(s) before and/or after whitespace.
    * Conditionally simplify embedded whitespace.
    */
-  ostring = repeating_whitespaceok_? ostring.trimmed() : ostring.simplified();
+  ostring = repeating_whitespaceok_? std::move(ostring).trimmed() : std::move(ostring).simplified();
 
   /*
    * Toss vowels to approach target length, but don't toss them
@@ -314,10 +332,8 @@ QByteArray MakeShort::mkshort(const QByteArray& istring, bool is_utf8)
    *
    * It also helps units with speech synthesis.
    */
-  bool replaced = target_len_ < 15;
-
-  while (replaced && (ostring.size() > target_len_)) {
-    replaced = delete_last_vowel(2, ostring);
+  if (target_len_ < 15) {
+    delete_vowels(2, target_len_, ostring);
   }
 
   /*
@@ -26,7 +26,6 @@
 #include <QHash>       // for QHash, QHash<>::iterator, qHash, QHash<>::size_type
 #include <QString>     // for QString
 #include <QVector>     // for QVector
-#include <Qt>          // for CaseInsensitive
 
 #include "defs.h"
 
@@ -58,20 +57,22 @@ private:
   class ShortNameKey
   {
   public:
-    ShortNameKey(const QByteArray& name) : shortname(name) {} /* converting constructor */
+    /* converting constructor */
+    ShortNameKey(const QByteArray& name) : folded(name.toUpper()), hash(qHash(folded)) {}
 
     friend size_t qHash(const ShortNameKey& key, size_t seed = 0) noexcept
     {
       // We hash all strings as upper case.
-      return qHash(key.shortname.toUpper(), seed);
+      return qHash(key.hash, seed);
     }
     bool operator==(const ShortNameKey& other) const
     {
-      return shortname.compare(other.shortname, Qt::CaseInsensitive) == 0;
+      return (hash == other.hash) && (folded == other.folded);
     }
 
   private:
-    QByteArray shortname;
+    QByteArray folded;  // the name in upper case
+    size_t hash;        // of folded, with no seed
   };
 
   struct replacement_t {
@@ -89,7 +90,7 @@ private:
   /* Member Functions */
 
   void mkshort_add_to_list(QByteArray& name, bool is_utf8);
-  static bool delete_last_vowel(int start, QByteArray& iostring);
+  static void delete_vowels(int start, int max_len, QByteArray& iostring);
   static void replace_constants(QByteArray& s);
 
   /* Data Members */
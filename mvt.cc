@@ -0,0 +1,750 @@
+/*
+    Mapbox Vector Tiles output, a directory of z/x/y.pbf tiles.
+
+    Copyright (C) 2026 Robert Lipe, robertlipe+source@gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+/*
+ * See https://github.com/mapbox/vector-tile-spec, version 2.1, and its
+ * vector_tile.proto for the layout written here, and
+ * https://github.com/mapbox/mbtiles-spec for the metadata.
+ */
+
+#include "mvt.h"
+
+#include <algorithm>           // for clamp, max, min
+#include <atomic>              // for atomic
+#include <cmath>               // for asinh, atan, ceil, cos, floor, isfinite, log2, lround, sinh, tan
+#include <numbers>             // for pi
+#include <utility>             // for as_const
+
+#include <QByteArray>          // for QByteArray
+#include <QDir>                // for QDir
+#include <QFile>               // for QFile
+#include <QHash>               // for QHash
+#include <QIODevice>           // for QIODevice, QIODevice::WriteOnly
+#include <QJsonArray>          // for QJsonArray
+#include <QJsonDocument>       // for QJsonDocument, QJsonDocument::Compact, QJsonDocument::Indented
+#include <QJsonObject>         // for QJsonObject
+#include <QPair>               // for QPair
+#include <QString>             // for QString
+#include <QVector>             // for QVector
+#include <QtGlobal>            // for quint8, quint32, quint64, qint64, qsizetype
+
+#include "defs.h"              // for Waypoint, route_head, fatal, waypt_range, route_range, track_range, xstrtoi
+#include "grtcirc.h"           // for radtomiles
+#include "smplrout.h"          // for SimplifyRouteFilter
+#include "src/core/scheduler.h"  // for parallel_for
+
+
+namespace
+{
+
+constexpr double kMaxLatitude = 85.0511287798;
+
+/* Pixels along the side of a tile, which the cluster radius is in. */
+constexpr double kTilePixels = 256;
+
+/* A point that the simplification never keeps. */
+constexpr quint8 kNeverKept = 255;
+
+/* Geometry types and commands of vector_tile.proto */
+constexpr quint32 kPointType = 1;
+constexpr quint32 kLineStringType = 2;
+constexpr quint32 kMoveTo = 1;
+constexpr quint32 kLineTo = 2;
+
+constexpr const char* kLayerNames[] = {"waypoints", "routes", "tracks"};
+
+/*
+ * The little of the protocol buffer encoding that vector tiles need:
+ * varints and length delimited fields.
+ */
+void put_varint(QByteArray& buf, quint64 value)
+{
+  while (value >= 0x80) {
+    buf.append(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  buf.append(static_cast<char>(value));
+}
+
+void put_uint(QByteArray& buf, int field, quint64 value)
+{
+  put_varint(buf, (field << 3) | 0);
+  put_varint(buf, value);
+}
+
+void put_bytes(QByteArray& buf, int field, const QByteArray& data)
+{
+  put_varint(buf, (field << 3) | 2);
+  put_varint(buf, data.size());
+  buf.append(data);
+}
+
+void put_packed(QByteArray& buf, int field, const QVector<quint32>& values)
+{
+  QByteArray packed;
+  for (const quint32 value : values) {
+    put_varint(packed, value);
+  }
+  put_bytes(buf, field, packed);
+}
+
+quint32 zigzag(qint32 n)
+{
+  return (static_cast<quint32>(n) << 1) ^ static_cast<quint32>(n >> 31);
+}
+
+quint32 command(quint32 id, quint32 count)
+{
+  return (id & 0x7) | (count << 3);
+}
+
+/*
+ * A layer of a tile.  Keys and values are shared by its features, and
+ * values are told apart by their encoding, so equal strings and equal
+ * numbers are only written once.
+ */
+class LayerBuilder
+{
+public:
+  LayerBuilder(const char* name, int extent) : name_(name), extent_(extent) {}
+
+  bool isEmpty() const
+  {
+    return features_.isEmpty();
+  }
+
+  void tag(QVector<quint32>& tags, const QString& key, const QString& value)
+  {
+    QByteArray encoded;
+    put_bytes(encoded, 1, value.toUtf8());
+    add_tag(tags, key, encoded);
+  }
+
+  void tag(QVector<quint32>& tags, const QString& key, quint64 value)
+  {
+    QByteArray encoded;
+    put_uint(encoded, 5, value);
+    add_tag(tags, key, encoded);
+  }
+
+  void tag(QVector<quint32>& tags, const QString& key, bool value)
+  {
+    QByteArray encoded;
+    put_uint(encoded, 7, value ? 1 : 0);
+    add_tag(tags, key, encoded);
+  }
+
+  void add_feature(quint64 id, const QVector<quint32>& tags, quint32 type, const QVector<quint32>& geometry)
+  {
+    QByteArray feature;
+    if (id != 0) {
+      put_uint(feature, 1, id);
+    }
+    if (!tags.isEmpty()) {
+      put_packed(feature, 2, tags);
+    }
+    put_uint(feature, 3, type);
+    put_packed(feature, 4, geometry);
+    features_.append(feature);
+  }
+
+  QByteArray encode() const
+  {
+    QByteArray layer;
+    put_uint(layer, 15, 2);  // version
+    put_bytes(layer, 1, name_);
+    for (const QByteArray& feature : features_) {
+      put_bytes(layer, 2, feature);
+    }
+    for (const QString& key : keys_) {
+      put_bytes(layer, 3, key.toUtf8());
+    }
+    for (const QByteArray& value : values_) {
+      put_bytes(layer, 4, value);
+    }
+    put_uint(layer, 5, extent_);
+    return layer;
+  }
+
+private:
+  void add_tag(QVector<quint32>& tags, const QString& key, const QByteArray& value)
+  {
+    auto k = key_index_.constFind(key);
+    if (k == key_index_.constEnd()) {
+      k = key_index_.insert(key, keys_.size());
+      keys_.append(key);
+    }
+    auto v = value_index_.constFind(value);
+    if (v == value_index_.constEnd()) {
+      v = value_index_.insert(value, values_.size());
+      values_.append(value);
+    }
+    tags.append(k.value());
+    tags.append(v.value());
+  }
+
+  QByteArray name_;
+  int extent_;
+  QVector<QByteArray> features_;
+  QVector<QString> keys_;
+  QHash<QString, quint32> key_index_;
+  QVector<QByteArray> values_;
+  QHash<QByteArray, quint32> value_index_;
+};
+
+/* Geometry commands, the cursor running on from one part to the next. */
+class GeometryBuilder
+{
+public:
+  const QVector<quint32>& commands() const
+  {
+    return commands_;
+  }
+
+  void point(qint32 x, qint32 y)
+  {
+    commands_.append(command(kMoveTo, 1));
+    move(x, y);
+  }
+
+  void line(const QVector<QPair<qint32, qint32>>& points)
+  {
+    commands_.append(command(kMoveTo, 1));
+    move(points.first().first, points.first().second);
+    commands_.append(command(kLineTo, points.size() - 1));
+    for (qsizetype i = 1; i < points.size(); ++i) {
+      move(points.at(i).first, points.at(i).second);
+    }
+  }
+
+private:
+  void move(qint32 x, qint32 y)
+  {
+    commands_.append(zigzag(x - x_));
+    commands_.append(zigzag(y - y_));
+    x_ = x;
+    y_ = y;
+  }
+
+  QVector<quint32> commands_;
+  qint32 x_{0};
+  qint32 y_{0};
+};
+
+/*
+ * Liang-Barsky: the part [t0, t1] of the edge from (ax, ay) to (bx, by)
+ * that lies within the square from lo to hi.
+ */
+bool clip_edge(double ax, double ay, double bx, double by, double lo, double hi,
+               double* t0, double* t1)
+{
+  const double dx = bx - ax;
+  const double dy = by - ay;
+  const double p[4] = {-dx, dx, -dy, dy};
+  const double q[4] = {ax - lo, hi - ax, ay - lo, hi - ay};
+  *t0 = 0;
+  *t1 = 1;
+  for (int i = 0; i < 4; ++i) {
+    if (p[i] == 0) {
+      if (q[i] < 0) {
+        return false;
+      }
+    } else {
+      const double t = q[i] / p[i];
+      if (p[i] < 0) {
+        *t0 = std::max(*t0, t);
+      } else {
+        *t1 = std::min(*t1, t);
+      }
+    }
+  }
+  return *t0 <= *t1;
+}
+
+int tile_of(double world, int n)
+{
+  return std::clamp(static_cast<int>(std::floor(world * n)), 0, n - 1);
+}
+
+} // namespace
+
+MvtFormat::Point
+MvtFormat::project(const Waypoint* wpt)
+{
+  const double lat = std::clamp(wpt->latitude, -kMaxLatitude, kMaxLatitude) * std::numbers::pi / 180.0;
+  return {
+    (wpt->longitude + 180.0) / 360.0,
+    (1.0 - std::asinh(std::tan(lat)) / std::numbers::pi) / 2.0
+  };
+}
+
+void
+MvtFormat::wr_init(const QString& fname)
+{
+  dirname_ = fname;
+  waypoints_.clear();
+  waypoint_world_.clear();
+  lines_.clear();
+}
+
+/*
+ * Each segment is simplified on its own, so that its ends stay.  A point
+ * is kept at every zoom at which the error it stands for is at least one
+ * tile unit, measured at its latitude.
+ */
+void
+MvtFormat::add_line(const route_head* rte, Layer layer, quint64 id)
+{
+  Line line{rte, layer, id, {}};
+  const double unit_miles = radtomiles(2 * std::numbers::pi) / extent_;
+  QVector<const Waypoint*> points;
+  auto flush = [&line, &points, unit_miles]()->void {
+    if (points.size() >= 2) {
+      const QVector<double> thresholds = SimplifyRouteFilter::crosstrack_thresholds(points);
+      Segment segment;
+      segment.world.reserve(points.size());
+      segment.minzoom.reserve(points.size());
+      for (qsizetype i = 0; i < points.size(); ++i) {
+        const Waypoint* wpt = points.at(i);
+        segment.world.append(project(wpt));
+        const double lat = std::clamp(wpt->latitude, -kMaxLatitude, kMaxLatitude) * std::numbers::pi / 180.0;
+        const double threshold = thresholds.at(i);
+        quint8 minzoom = 0;
+        if (threshold < SimplifyRouteFilter::kHugeValue) {
+          const double zoom = (threshold > 0) ? std::ceil(std::log2(unit_miles * std::cos(lat) / threshold)) : kNeverKept;
+          minzoom = static_cast<quint8>(std::clamp<double>(zoom, 0, kNeverKept));
+        }
+        segment.minzoom.append(minzoom);
+      }
+      line.segments.append(segment);
+    }
+    points.clear();
+  };
+
+  for (const Waypoint* wpt : rte->waypoint_list) {
+    if (!std::isfinite(wpt->latitude) || !std::isfinite(wpt->longitude)) {
+      continue;
+    }
+    if ((layer == kTracks) && wpt->wpt_flags.new_trkseg) {
+      flush();
+    }
+    points.append(wpt);
+  }
+  flush();
+  if (!line.segments.isEmpty()) {
+    lines_.append(line);
+  }
+}
+
+/*
+ * Grid clustering: below maxzoom the waypoints in a square of the
+ * cluster radius become one marker at their mean position.  Markers
+ * are in the order of their first waypoint.
+ */
+QVector<MvtFormat::Marker>
+MvtFormat::cluster(int zoom, int radius) const
+{
+  QVector<Marker> markers;
+  markers.reserve(waypoints_.size());
+  if (radius == 0) {
+    for (qsizetype i = 0; i < waypoints_.size(); ++i) {
+      markers.append({waypoint_world_.at(i), waypoints_.at(i), static_cast<quint64>(i + 1), 1});
+    }
+    return markers;
+  }
+
+  const double cell = radius / (kTilePixels * static_cast<double>(qint64(1) << zoom));
+  QHash<QPair<qint64, qint64>, qsizetype> cells;
+  for (qsizetype i = 0; i < waypoints_.size(); ++i) {
+    const Point& world = waypoint_world_.at(i);
+    const QPair<qint64, qint64> key(static_cast<qint64>(std::floor(world.x / cell)),
+                                    static_cast<qint64>(std::floor(world.y / cell)));
+    auto it = cells.constFind(key);
+    if (it == cells.constEnd()) {
+      cells.insert(key, markers.size());
+      markers.append({world, waypoints_.at(i), static_cast<quint64>(i + 1), 1});
+    } else {
+      Marker& marker = markers[it.value()];
+      marker.world.x += world.x;
+      marker.world.y += world.y;
+      marker.wpt = nullptr;
+      marker.id = 0;
+      ++marker.count;
+    }
+  }
+  for (Marker& marker : markers) {
+    marker.world.x /= marker.count;
+    marker.world.y /= marker.count;
+  }
+  return markers;
+}
+
+/*
+ * The tiles that a marker or a line reaches, with their buffers.  A line
+ * is followed one column of tiles at a time, so that a long diagonal
+ * edge only reaches the tiles it crosses.
+ */
+QVector<MvtFormat::Tile>
+MvtFormat::layout(int zoom, const QVector<Marker>& markers) const
+{
+  const int n = 1 << zoom;
+  const double margin = static_cast<double>(buffer_) / extent_ / n;
+  QVector<Tile> tiles;
+  QHash<QPair<int, int>, qsizetype> index;
+  auto tile = [&tiles, &index](int x, int y)->Tile& {
+    auto it = index.constFind({x, y});
+    if (it == index.constEnd()) {
+      it = index.insert({x, y}, tiles.size());
+      tiles.append({x, y, {}, {}});
+    }
+    return tiles[it.value()];
+  };
+
+  for (qsizetype i = 0; i < markers.size(); ++i) {
+    const Point& world = markers.at(i).world;
+    for (int x = tile_of(world.x - margin, n); x <= tile_of(world.x + margin, n); ++x) {
+      for (int y = tile_of(world.y - margin, n); y <= tile_of(world.y + margin, n); ++y) {
+        tile(x, y).markers.append(i);
+      }
+    }
+  }
+
+  for (qsizetype i = 0; i < lines_.size(); ++i) {
+    for (const Segment& segment : lines_.at(i).segments) {
+      const Point* prev = nullptr;
+      for (qsizetype j = 0; j < segment.world.size(); ++j) {
+        if (segment.minzoom.at(j) > zoom) {
+          continue;
+        }
+        const Point* curr = &segment.world.at(j);
+        if (prev != nullptr) {
+          const double min_x = std::min(prev->x, curr->x) - margin;
+          const double max_x = std::max(prev->x, curr->x) + margin;
+          for (int x = tile_of(min_x, n); x <= tile_of(max_x, n); ++x) {
+            // The part of the edge within this column and its buffer.
+            double t0 = 0;
+            double t1 = 1;
+            const double lo = static_cast<double>(x) / n - margin;
+            const double hi = static_cast<double>(x + 1) / n + margin;
+            const double dx = curr->x - prev->x;
+            if (dx != 0) {
+              const double ta = (lo - prev->x) / dx;
+              const double tb = (hi - prev->x) / dx;
+              t0 = std::max(0.0, std::min(ta, tb));
+              t1 = std::min(1.0, std::max(ta, tb));
+            }
+            if (t0 > t1) {
+              continue;
+            }
+            const double y0 = prev->y + t0 * (curr->y - prev->y);
+            const double y1 = prev->y + t1 * (curr->y - prev->y);
+            for (int y = tile_of(std::min(y0, y1) - margin, n); y <= tile_of(std::max(y0, y1) + margin, n); ++y) {
+              Tile& t = tile(x, y);
+              if (t.lines.isEmpty() || (t.lines.last() != i)) {
+                t.lines.append(i);
+              }
+            }
+          }
+        }
+        prev = curr;
+      }
+    }
+  }
+  return tiles;
+}
+
+QByteArray
+MvtFormat::encode_tile(int zoom, const Tile& tile, const QVector<Marker>& markers) const
+{
+  const double scale = static_cast<double>(qint64(1) << zoom) * extent_;
+  const double origin_x = static_cast<double>(tile.x) * extent_;
+  const double origin_y = static_cast<double>(tile.y) * extent_;
+  const double lo = -buffer_;
+  const double hi = extent_ + buffer_;
+
+  QVector<LayerBuilder> layers;
+  for (const char* name : kLayerNames) {
+    layers.append(LayerBuilder(name, extent_));
+  }
+
+  for (const qsizetype i : tile.markers) {
+    const Marker& marker = markers.at(i);
+    const double x = marker.world.x * scale - origin_x;
+    const double y = marker.world.y * scale - origin_y;
+    if ((x < lo) || (x > hi) || (y < lo) || (y > hi)) {
+      continue;
+    }
+    LayerBuilder& layer = layers[kWaypoints];
+    QVector<quint32> tags;
+    if (marker.wpt != nullptr) {
+      if (!marker.wpt->shortname.isEmpty()) {
+        layer.tag(tags, QStringLiteral("name"), marker.wpt->shortname);
+      }
+      if (!marker.wpt->description.isEmpty()) {
+        layer.tag(tags, QStringLiteral("description"), marker.wpt->description);
+      }
+      if (marker.wpt->creation_time.isValid()) {
+        layer.tag(tags, QStringLiteral("time"), marker.wpt->creation_time.toPrettyString());
+      }
+    } else {
+      layer.tag(tags, QStringLiteral("cluster"), true);
+      layer.tag(tags, QStringLiteral("point_count"), static_cast<quint64>(marker.count));
+    }
+    GeometryBuilder geometry;
+    geometry.point(std::lround(x), std::lround(y));
+    layer.add_feature(marker.id, tags, kPointType, geometry.commands());
+  }
+
+  for (const qsizetype i : tile.lines) {
+    const Line& line = lines_.at(i);
+    GeometryBuilder geometry;
+    bool drawn = false;
+    QVector<QPair<qint32, qint32>> part;
+    auto finish = [&geometry, &drawn, &part]()->void {
+      if (part.size() >= 2) {
+        geometry.line(part);
+        drawn = true;
+      }
+      part.clear();
+    };
+    auto append = [&part](double x, double y)->void {
+      const QPair<qint32, qint32> p(std::lround(x), std::lround(y));
+      if (part.isEmpty() || (part.last() != p)) {
+        part.append(p);
+      }
+    };
+
+    for (const Segment& segment : line.segments) {
+      bool have_prev = false;
+      double px = 0;
+      double py = 0;
+      for (qsizetype j = 0; j < segment.world.size(); ++j) {
+        if (segment.minzoom.at(j) > zoom) {
+          continue;
+        }
+        const double x = segment.world.at(j).x * scale - origin_x;
+        const double y = segment.world.at(j).y * scale - origin_y;
+        if (have_prev) {
+          double t0;
+          double t1;
+          if (!clip_edge(px, py, x, y, lo, hi, &t0, &t1)) {
+            finish();
+          } else {
+            if (t0 > 0) {
+              // The edge comes in from outside.
+              finish();
+            }
+            append(px + t0 * (x - px), py + t0 * (y - py));
+            append(px + t1 * (x - px), py + t1 * (y - py));
+            if (t1 < 1) {
+              finish();
+            }
+          }
+        }
+        px = x;
+        py = y;
+        have_prev = true;
+      }
+      finish();
+    }
+    if (drawn) {
+      QVector<quint32> tags;
+      LayerBuilder& layer = layers[line.layer];
+      if (!line.rte->rte_name.isEmpty()) {
+        layer.tag(tags, QStringLiteral("name"), line.rte->rte_name);
+      }
+      if (!line.rte->rte_desc.isEmpty()) {
+        layer.tag(tags, QStringLiteral("description"), line.rte->rte_desc);
+      }
+      layer.add_feature(line.id, tags, kLineStringType, geometry.commands());
+    }
+  }
+
+  QByteArray data;
+  for (const LayerBuilder& layer : std::as_const(layers)) {
+    if (!layer.isEmpty()) {
+      put_bytes(data, 3, layer.encode());
+    }
+  }
+  return data;
+}
+
+/*
+ * The entries of the metadata table of MBTiles, the json entry listing
+ * the layers and their fields.
+ */
+void
+MvtFormat::write_metadata(int minzoom, int maxzoom) const
+{
+  bool empty = true;
+  double west = 180;
+  double south = kMaxLatitude;
+  double east = -180;
+  double north = -kMaxLatitude;
+  auto expand = [&](const Point& world)->void {
+    const double lon = world.x * 360.0 - 180.0;
+    const double lat = std::atan(std::sinh(std::numbers::pi * (1.0 - 2.0 * world.y))) * 180.0 / std::numbers::pi;
+    west = std::min(west, lon);
+    east = std::max(east, lon);
+    south = std::min(south, lat);
+    north = std::max(north, lat);
+    empty = false;
+  };
+  bool has_layer[kLayerCount] = {!waypoints_.isEmpty(), false, false};
+  for (const Point& world : waypoint_world_) {
+    expand(world);
+  }
+  for (const Line& line : lines_) {
+    has_layer[line.layer] = true;
+    for (const Segment& segment : line.segments) {
+      for (const Point& world : segment.world) {
+        expand(world);
+      }
+    }
+  }
+  if (empty) {
+    west = -180;
+    south = -kMaxLatitude;
+    east = 180;
+    north = kMaxLatitude;
+  }
+
+  QJsonArray vector_layers;
+  for (int layer = 0; layer < kLayerCount; ++layer) {
+    if (!has_layer[layer]) {
+      continue;
+    }
+    QJsonObject fields{
+      {QStringLiteral("name"), QStringLiteral("String")},
+      {QStringLiteral("description"), QStringLiteral("String")}
+    };
+    if (layer == kWaypoints) {
+      fields.insert(QStringLiteral("time"), QStringLiteral("String"));
+      if ((cluster_ != 0) && (minzoom < maxzoom)) {
+        fields.insert(QStringLiteral("cluster"), QStringLiteral("Boolean"));
+        fields.insert(QStringLiteral("point_count"), QStringLiteral("Number"));
+      }
+    }
+    vector_layers.append(QJsonObject{
+      {QStringLiteral("id"), QString::fromLatin1(kLayerNames[layer])},
+      {QStringLiteral("fields"), fields},
+      {QStringLiteral("minzoom"), minzoom},
+      {QStringLiteral("maxzoom"), maxzoom}
+    });
+  }
+  const QByteArray json = QJsonDocument(QJsonObject{{QStringLiteral("vector_layers"), vector_layers}}).toJson(QJsonDocument::Compact);
+
+  auto number = [](double value)->QString {
+    return QString::number(value, 'f', 6);
+  };
+  const QJsonObject metadata{
+    {QStringLiteral("name"), QDir(dirname_).dirName()},
+    {QStringLiteral("format"), QStringLiteral("pbf")},
+    {QStringLiteral("type"), QStringLiteral("overlay")},
+    {QStringLiteral("minzoom"), QString::number(minzoom)},
+    {QStringLiteral("maxzoom"), QString::number(maxzoom)},
+    {QStringLiteral("bounds"), QStringLiteral("%1,%2,%3,%4").arg(number(west), number(south), number(east), number(north))},
+    {QStringLiteral("center"), QStringLiteral("%1,%2,%3").arg(number((west + east) / 2), number((south + north) / 2)).arg(minzoom)},
+    {QStringLiteral("json"), QString::fromUtf8(json)}
+  };
+
+  QFile file(QDir(dirname_).filePath(QStringLiteral("metadata.json")));
+  if (!file.open(QIODevice::WriteOnly) || (file.write(QJsonDocument(metadata).toJson(QJsonDocument::Indented)) < 0)) {
+    fatal("%s: Cannot write \"%s\".\n", MYNAME, qPrintable(file.fileName()));
+  }
+  file.close();
+}
+
+void
+MvtFormat::write()
+{
+  const int minzoom = xstrtoi(opt_minzoom, nullptr, 10);
+  const int maxzoom = xstrtoi(opt_maxzoom, nullptr, 10);
+  if (minzoom > maxzoom) {
+    fatal("%s: minzoom must not be above maxzoom.\n", MYNAME);
+  }
+  extent_ = xstrtoi(opt_extent, nullptr, 10);
+  buffer_ = xstrtoi(opt_buffer, nullptr, 10);
+  cluster_ = xstrtoi(opt_cluster, nullptr, 10);
+  const int threads = (opt_threads != nullptr) ? xstrtoi(opt_threads, nullptr, 10) : 1;
+
+  if (!QDir().mkpath(dirname_)) {
+    fatal("%s: Cannot create the directory \"%s\".\n", MYNAME, qPrintable(dirname_));
+  }
+
+  for (const Waypoint* wpt : waypt_range()) {
+    if (std::isfinite(wpt->latitude) && std::isfinite(wpt->longitude)) {
+      waypoints_.append(wpt);
+      waypoint_world_.append(project(wpt));
+    }
+  }
+  quint64 id = 0;
+  for (const route_head* rte : route_range()) {
+    add_line(rte, kRoutes, ++id);
+  }
+  id = 0;
+  for (const route_head* rte : track_range()) {
+    add_line(rte, kTracks, ++id);
+  }
+
+  for (int zoom = minzoom; zoom <= maxzoom; ++zoom) {
+    // Every waypoint is shown on its own at maxzoom.
+    const QVector<Marker> markers = cluster(zoom, (zoom < maxzoom) ? cluster_ : 0);
+    const QVector<Tile> tiles = layout(zoom, markers);
+
+    std::atomic<qsizetype> failed{-1};
+    auto work = [this, zoom, &tiles, &markers, &failed](qsizetype begin, qsizetype end)->void {
+      for (qsizetype i = begin; i < end; ++i) {
+        const Tile& tile = tiles.at(i);
+        const QByteArray data = encode_tile(zoom, tile, markers);
+        if (data.isEmpty()) {
+          continue;
+        }
+        const QString dir = QStringLiteral("%1/%2/%3").arg(dirname_).arg(zoom).arg(tile.x);
+        QFile file(QStringLiteral("%1/%2.pbf").arg(dir).arg(tile.y));
+        if (!QDir().mkpath(dir) || !file.open(QIODevice::WriteOnly) || (file.write(data) != data.size())) {
+          failed = i;
+        }
+      }
+    };
+    const qsizetype count = tiles.size();
+    if ((threads > 1) && (count >= kParallelMin)) {
+      gpsbabel::parallel_for(count, (count + threads - 1) / threads, work);
+    } else {
+      work(0, count);
+    }
+    if (failed >= 0) {
+      const Tile& tile = tiles.at(failed);
+      fatal("%s: Cannot write the tile %d/%d/%d to \"%s\".\n", MYNAME, zoom, tile.x, tile.y, qPrintable(dirname_));
+    }
+  }
+
+  write_metadata(minzoom, maxzoom);
+}
+
+void
+MvtFormat::wr_deinit()
+{
+  waypoints_.clear();
+  waypoint_world_.clear();
+  lines_.clear();
+  dirname_.clear();
+}
@@ -0,0 +1,175 @@
+/*
+    Mapbox Vector Tiles output, a directory of z/x/y.pbf tiles.
+
+    Copyright (C) 2026 Robert Lipe, robertlipe+source@gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+#ifndef MVT_H_INCLUDED_
+#define MVT_H_INCLUDED_
+
+#include <QByteArray>          // for QByteArray
+#include <QString>             // for QString
+#include <QVector>             // for QVector
+#include <QtGlobal>            // for quint8, qint64, qsizetype
+
+#include "defs.h"              // for arglist_t, ff_cap, ff_cap_write, ff_type, ff_type_file, ARGTYPE_INT, Waypoint, route_head
+#include "format.h"            // for Format
+
+/*
+ * The name given with -F is a directory, which gets a tile z/x/y.pbf,
+ * in the XYZ scheme, for every tile from minzoom to maxzoom that has
+ * data, and a metadata.json with the entries of an MBTiles metadata
+ * table.  Tools like mb-util pack such a directory into an MBTiles file.
+ *
+ * Waypoints go to a layer "waypoints", routes to "routes" and tracks to
+ * "tracks".  Below maxzoom the waypoints that fall within the cluster
+ * radius of each other are drawn as one point with a point_count.  Lines
+ * are simplified for each zoom like "-x simplify,crosstrack,error=" with
+ * the size of a tile unit as the error, and clipped to the tile and its
+ * buffer.  The tiles of a zoom level are encoded on the threads given.
+ */
+class MvtFormat : public Format
+{
+public:
+  /* Member Functions */
+
+  QVector<arglist_t>* get_args() override
+  {
+    return &mvt_args;
+  }
+
+  ff_type get_type() const override
+  {
+    return ff_type_file;
+  }
+
+  QVector<ff_cap> get_cap() const override
+  {
+    return {
+      ff_cap_write,  // waypoints
+      ff_cap_write,  // tracks
+      ff_cap_write   // routes
+    };
+  }
+
+  void wr_init(const QString& fname) override;
+  void write() override;
+  void wr_deinit() override;
+
+private:
+  /* Types */
+
+  enum Layer {
+    kWaypoints,
+    kRoutes,
+    kTracks,
+    kLayerCount
+  };
+
+  /* A point in Web Mercator, the world being the unit square. */
+  struct Point {
+    double x;
+    double y;
+  };
+
+  /* A waypoint, or below maxzoom maybe a cluster of them. */
+  struct Marker {
+    Point world;
+    const Waypoint* wpt{nullptr};  // if it stands for one waypoint
+    quint64 id{0};
+    qsizetype count{1};
+  };
+
+  /* A segment of a route or track. */
+  struct Segment {
+    QVector<Point> world;
+    QVector<quint8> minzoom;       // the lowest zoom at which a point is kept
+  };
+
+  struct Line {
+    const route_head* rte;
+    Layer layer;
+    quint64 id;
+    QVector<Segment> segments;
+  };
+
+  /* What a tile holds: indices of markers and of lines. */
+  struct Tile {
+    int x;
+    int y;
+    QVector<qsizetype> markers;
+    QVector<qsizetype> lines;
+  };
+
+  /* Member Functions */
+
+  static Point project(const Waypoint* wpt);
+  void add_line(const route_head* rte, Layer layer, quint64 id);
+  QVector<Marker> cluster(int zoom, int radius) const;
+  QVector<Tile> layout(int zoom, const QVector<Marker>& markers) const;
+  QByteArray encode_tile(int zoom, const Tile& tile, const QVector<Marker>& markers) const;
+  void write_metadata(int minzoom, int maxzoom) const;
+
+  /* Data Members */
+
+  static constexpr char MYNAME[] = "mvt";
+  static constexpr qsizetype kParallelMin = 16;
+
+  char* opt_minzoom{nullptr};
+  char* opt_maxzoom{nullptr};
+  char* opt_extent{nullptr};
+  char* opt_buffer{nullptr};
+  char* opt_cluster{nullptr};
+  char* opt_threads{nullptr};
+
+  QVector<arglist_t> mvt_args = {
+    {
+      "minzoom", &opt_minzoom, "Lowest zoom level",
+      "0", ARGTYPE_INT, "0", "24", nullptr
+    },
+    {
+      "maxzoom", &opt_maxzoom, "Highest zoom level",
+      "14", ARGTYPE_INT, "0", "24", nullptr
+    },
+    {
+      "extent", &opt_extent, "Tile units along the side of a tile",
+      "4096", ARGTYPE_INT, "256", "65536", nullptr
+    },
+    {
+      "buffer", &opt_buffer, "Tile units around a tile that are drawn as well",
+      "64", ARGTYPE_INT, "0", "4096", nullptr
+    },
+    {
+      "cluster", &opt_cluster, "Cluster waypoints this many pixels apart, 0 for none",
+      "40", ARGTYPE_INT, "0", "256", nullptr
+    },
+    {
+      "threads", &opt_threads, "Encode tiles on this many threads",
+      nullptr, ARGTYPE_INT, "1", nullptr, nullptr
+    },
+  };
+
+  QString dirname_;
+  QVector<const Waypoint*> waypoints_;
+  QVector<Point> waypoint_world_;
+  QVector<Line> lines_;
+  int extent_{4096};
+  int buffer_{64};
+  int cluster_{40};
+};
+
+#endif // MVT_H_INCLUDED_
@@ -20,17 +20,27 @@
 
  */
 
-#include <cctype>                  // for isprint
-#include <cmath>                   // for fabs
-#include <cstdio>                  // for snprintf, sscanf, fprintf, fputc, stderr
+#include <algorithm>               // for min
+#include <cctype>                  // for isprint, isdigit
+#include <chrono>                  // for steady_clock
+#include <cmath>                   // for fabs, lround
+#include <cstdint>                 // for uint64_t, int32_t
+#include <cstdio>                  // for sscanf, fprintf, fputc, stderr, SEEK_SET
 #include <cstdlib>                 // for strtod
-#include <cstring>                 // for strncmp, strchr, strlen, strstr, memset, strrchr
+#include <cstring>                 // for strncmp, strchr, strlen, strstr, memset, strrchr, memcpy
 #include <iterator>                // for operator!=, reverse_iterator
+#include <memory>                  // for unique_ptr, make_unique
+#include <utility>                 // for as_const, exchange, swap
 
 #include <QByteArray>              // for QByteArray
+#include <QByteArrayView>          // for QByteArrayView
 #include <QChar>                   // for QChar, operator==, operator!=
+#include <QDate>                   // for QDate
 #include <QDateTime>               // for QDateTime
 #include <QDebug>                  // for QDebug
+#include <QElapsedTimer>           // for QElapsedTimer
+#include <QFileInfo>               // for QFileInfo
+#include <QJsonObject>             // for QJsonObject
 #include <QList>                   // for QList
 #include <QString>                 // for QString
 #include <QStringList>             // for QStringList
@@ -38,14 +48,17 @@
 #include <QThread>                 // for QThread
 #include <QTime>                   // for QTime
 #include <Qt>                      // for UTC
+#include <QVector>                 // for QVector
 #include <QtGlobal>                // for qPrintable, foreach
 
 #include "defs.h"
 #include "nmea.h"
-#include "gbfile.h"                // for gbfprintf, gbfflush, gbfclose, gbfopen, gbfgetstr, gbfile
-#include "gbser.h"                 // for gbser_set_speed, gbser_flush, gbser_read_line, gbser_deinit, gbser_init, gbser_write
-#include "jeeps/gpsmath.h"         // for GPS_Lookup_Datum_Index, GPS_Math_Known_Datum_To_WGS84_M
+#include "gbfile.h"                // for gbfwrite, gbfflush, gbfclose, gbfopen, gbfgetstr, gbfile
+#include "gbser.h"                 // for gbser_set_speed, gbser_flush, gbser_read_line, gbser_deinit, gbser_init, gbser_write, gbser_poll, gbser_read, gbser_TIMEOUT
+#include "jeeps/gpsmath.h"         // for GPS_Lookup_Datum_Index, GPS_Math_Known_Datum_To_WGS84_Setup
 #include "mkshort.h"               // for MakeShort
+#include "src/core/charscan.h"     // for find_first_of
+#include "src/core/checkpoint.h"   // for Checkpoint
 #include "src/core/datetime.h"     // for DateTime
 #include "src/core/logging.h"      // for Warning
 
@@ -165,12 +178,98 @@ sentence is truncated - and missing part of the line, including the checksum.
 int
 NmeaFormat::nmea_cksum(const char* const buf)
 {
-  int x = 0 ;
+  return nmea_cksum(buf, strlen(buf));
+}
+
+/*
+ * XOR eight bytes at a time and fold the lanes together at the end,
+ * which the compiler is free to widen further.
+ */
+int
+NmeaFormat::nmea_cksum(const char* const buf, qsizetype len)
+{
+  uint64_t lanes = 0;
+  qsizetype i = 0;
+  for (; (i + 8) <= len; i += 8) {
+    uint64_t word;
+    memcpy(&word, buf + i, sizeof(word));
+    lanes ^= word;
+  }
+  lanes ^= lanes >> 32;
+  lanes ^= lanes >> 16;
+  lanes ^= lanes >> 8;
+  auto x = static_cast<unsigned char>(lanes);
+  for (; i < len; ++i) {
+    x ^= static_cast<unsigned char>(buf[i]);
+  }
+  return static_cast<signed char>(x);
+}
 
-  for (const char* p = buf; *p; p++) {
-    x ^= *p;
+/*
+ * Split a sentence at its commas without copying any field.
+ */
+NmeaFormat::NmeaFields
+NmeaFormat::nmea_split(QByteArrayView sentence)
+{
+  NmeaFields fields;
+  const char* data = sentence.data();
+  const qsizetype size = sentence.size();
+  qsizetype start = 0;
+  for (;;) {
+    const qsizetype end = gpsbabel::find_first_of(sentence, start, ',', ',');
+    if (end == size) {
+      fields.append(QByteArrayView(data + start, size - start));
+      return fields;
+    }
+    fields.append(QByteArrayView(data + start, end - start));
+    start = end + 1;
   }
-  return x;
+}
+
+/* Convert a field just like QString::toDouble would, without copying it. */
+double
+NmeaFormat::nmea_double(QByteArrayView field)
+{
+  return QByteArray::fromRawData(field.data(), field.size()).toDouble();
+}
+
+float
+NmeaFormat::nmea_float(QByteArrayView field)
+{
+  return QByteArray::fromRawData(field.data(), field.size()).toFloat();
+}
+
+int
+NmeaFormat::nmea_int(QByteArrayView field)
+{
+  return QByteArray::fromRawData(field.data(), field.size()).toInt();
+}
+
+/*
+ * Put a "0" into every empty field between two commas, in one pass.
+ */
+void
+NmeaFormat::nmea_fill_empty_fields(QByteArray& sentence)
+{
+  if (!sentence.contains(",,")) {
+    return;
+  }
+  QByteArray filled;
+  filled.reserve(sentence.size() * 2);
+  qsizetype start = 0;
+  for (;;) {
+    const qsizetype comma = gpsbabel::find_first_of(sentence, start, ',', ',');
+    if (comma == sentence.size()) {
+      filled.append(QByteArrayView(sentence).sliced(start));
+      break;
+    }
+    filled.append(QByteArrayView(sentence).sliced(start, comma + 1 - start));
+    if ((comma + 1 < sentence.size()) && (sentence.at(comma + 1) == ',')) {
+      filled.append('0');
+    }
+    start = comma + 1;
+  }
+  sentence = filled;
 }
 
 Waypoint*
@@ -195,9 +294,9 @@ NmeaFormat::nmea_add_wpt(Waypoint* wpt, route_head* trk) const
     double lat;
     double lon;
     double alt;
-    GPS_Math_Known_Datum_To_WGS84_M(
+    datum_transform.convert(
       wpt->latitude, wpt->longitude, 0,
-      &lat, &lon, &alt, datum);
+      &lat, &lon, &alt);
     wpt->latitude = lat;
     wpt->longitude = lon;
   }
@@ -254,7 +353,10 @@ NmeaFormat::rd_init(const QString& fname)
   }
 
   read_mode = rm_file;
+  rd_fname = fname;
   file_in = gbfopen(fname, "rb", MYNAME);
+  // Even a short sentence with a position takes some 70 characters.
+  trkpt_hint = QFileInfo(fname).size() / 70;
 }
 
 void
@@ -315,6 +417,7 @@ NmeaFormat::wr_init(const QString& fname)
 void
 NmeaFormat::wr_deinit()
 {
+  nmea_flush();
   gbfclose(file_out);
   delete mkshort_handle;
   mkshort_handle = nullptr;
@@ -373,23 +476,71 @@ QTime NmeaFormat::nmea_parse_hms(const QString& str)
   return retval;
 }
 
+/*
+ * Decode the usual hhmmss[.s...] directly, leaving anything unusual to
+ * the QString version so both give the same result.
+ */
+QTime NmeaFormat::nmea_parse_hms(QByteArrayView str)
+{
+  const char* p = str.data();
+  const qsizetype size = str.size();
+  bool plain = (size >= 6) && ((size == 6) || (p[6] == '.')) && (size < 32);
+  for (qsizetype i = 0; plain && (i < size); ++i) {
+    plain = (i == 6) || isdigit(static_cast<unsigned char>(p[i]));
+  }
+  if (!plain) {
+    return nmea_parse_hms(QString::fromUtf8(str));
+  }
+
+  QTime retval((p[0] - '0') * 10 + (p[1] - '0'),
+               (p[2] - '0') * 10 + (p[3] - '0'),
+               (p[4] - '0') * 10 + (p[5] - '0'));
+  if (retval.isValid() && (size > 7)) {
+    char frac[34] = "0";
+    memcpy(frac + 1, p + 6, size - 6);
+    retval = retval.addMSecs(lround(1000.0 * strtod(frac, nullptr)));
+  }
+  return retval;
+}
+
+/*
+ * The ddmmyy date of RMC, in this century.
+ */
+QDate NmeaFormat::nmea_parse_dmy(QByteArrayView str)
+{
+  const char* p = str.data();
+  bool plain = (str.size() == 6);
+  for (qsizetype i = 0; plain && (i < 6); ++i) {
+    plain = isdigit(static_cast<unsigned char>(p[i]));
+  }
+  if (!plain) {
+    QString datestr = QString::fromUtf8(str);
+    datestr.insert(4, "20");
+    return QDate::fromString(datestr, u"ddMMyyyy");
+  }
+  return QDate(2000 + (p[4] - '0') * 10 + (p[5] - '0'),
+               (p[2] - '0') * 10 + (p[3] - '0'),
+               (p[0] - '0') * 10 + (p[1] - '0'));
+}
+
 void
-NmeaFormat::gpgll_parse(const QString& ibuf)
+NmeaFormat::gpgll_parse(const QByteArray& ibuf)
 {
   if (trk_head == nullptr) {
     trk_head = new route_head;
     track_add_head(trk_head);
+    track_reserve_wpts(trk_head, std::exchange(trkpt_hint, 0));
   }
 
-  const QStringList fields = ibuf.split(',');
+  const NmeaFields fields = nmea_split(ibuf);
 
   double latdeg = 0;
-  if (fields.size() > 1) latdeg = fields[1].toDouble();
-  QChar latdir = 'N';
+  if (fields.size() > 1) latdeg = nmea_double(fields[1]);
+  char latdir = 'N';
   if ((fields.size() > 2) && (fields[2].size() > 0)) latdir = fields[2][0];
   double lngdeg = 0;
-  if (fields.size() > 3) lngdeg = fields[3].toDouble();
-  QChar lngdir = 'E';
+  if (fields.size() > 3) lngdeg = nmea_double(fields[3]);
+  char lngdir = 'E';
   if ((fields.size() > 4) && (fields[4].size() > 0)) lngdir = fields[4][0];
   QTime hms;
   if (fields.size() > 5) hms = nmea_parse_hms(fields[5]);
@@ -421,37 +572,38 @@ NmeaFormat::gpgll_parse(const QString& ibuf)
 }
 
 void
-NmeaFormat::gpgga_parse(const QString& ibuf)
+NmeaFormat::gpgga_parse(const QByteArray& ibuf)
 {
   if (trk_head == nullptr) {
     trk_head = new route_head;
     track_add_head(trk_head);
+    track_reserve_wpts(trk_head, std::exchange(trkpt_hint, 0));
   }
 
-  const QStringList fields = ibuf.split(',');
+  const NmeaFields fields = nmea_split(ibuf);
   QTime hms;
   if (fields.size() > 1) hms = nmea_parse_hms(fields[1]);
   double latdeg = 0;
-  if (fields.size() > 2) latdeg = fields[2].toDouble();
-  QChar latdir = 'N';
+  if (fields.size() > 2) latdeg = nmea_double(fields[2]);
+  char latdir = 'N';
   if ((fields.size() > 3) && (fields[3].size() > 0)) latdir = fields[3][0];
   double lngdeg = 0;
-  if (fields.size() > 4) lngdeg = fields[4].toDouble();
-  QChar lngdir = 'E';
+  if (fields.size() > 4) lngdeg = nmea_double(fields[4]);
+  char lngdir = 'E';
   if ((fields.size() > 5) && (fields[5].size() > 0)) lngdir = fields[5][0];
   int fix = fix_unknown;
-  if (fields.size() > 6) fix = fields[6].toInt();
+  if (fields.size() > 6) fix = nmea_int(fields[6]);
   int nsats = 0;
-  if (fields.size() > 7) nsats = fields[7].toInt();
+  if (fields.size() > 7) nsats = nmea_int(fields[7]);
   float hdop = 0;
-  if (fields.size() > 8) hdop = fields[8].toFloat();
+  if (fields.size() > 8) hdop = nmea_float(fields[8]);
   double alt = unknown_alt;
-  if (fields.size() > 9) alt = fields[9].toDouble();
-  QChar altunits ='M';
+  if (fields.size() > 9) alt = nmea_double(fields[9]);
+  char altunits = 'M';
   if ((fields.size() > 10) && (fields[10].size() > 0)) altunits = fields[10][0];
   double geoidheight = unknown_alt;
-  if (fields.size() > 11) geoidheight = fields[11].toDouble();
-  QChar geoidheightunits = 'M';
+  if (fields.size() > 11) geoidheight = nmea_double(fields[11]);
+  char geoidheightunits = 'M';
   if ((fields.size() > 12) && (fields[12].size() > 0)) geoidheightunits = fields[12][0];
 
   /*
@@ -511,35 +663,34 @@ NmeaFormat::gpgga_parse(const QString& ibuf)
 }
 
 void
-NmeaFormat::gprmc_parse(const QString& ibuf)
+NmeaFormat::gprmc_parse(const QByteArray& ibuf)
 {
   if (trk_head == nullptr) {
     trk_head = new route_head;
     track_add_head(trk_head);
+    track_reserve_wpts(trk_head, std::exchange(trkpt_hint, 0));
   }
 
-  const QStringList fields = ibuf.split(',');
+  const NmeaFields fields = nmea_split(ibuf);
   QTime hms;
   if (fields.size() > 1) hms = nmea_parse_hms(fields[1]);
-  QChar fix = 'V'; // V == "Invalid"
+  char fix = 'V'; // V == "Invalid"
   if ((fields.size() > 2) && (fields[2].size() > 0)) fix = fields[2][0];
   double latdeg = 0;
-  if (fields.size() > 3) latdeg = fields[3].toDouble();
-  QChar latdir = 'N';
+  if (fields.size() > 3) latdeg = nmea_double(fields[3]);
+  char latdir = 'N';
   if ((fields.size() > 4) && (fields[4].size() > 0)) latdir = fields[4][0];
   double lngdeg = 0;
-  if (fields.size() > 5) lngdeg = fields[5].toDouble();
-  QChar lngdir = 'E';
+  if (fields.size() > 5) lngdeg = nmea_double(fields[5]);
+  char lngdir = 'E';
   if ((fields.size() > 6) && (fields[6].size() > 0)) lngdir = fields[6][0];
   double speed = 0;
-  if (fields.size() > 7) speed = fields[7].toDouble();
+  if (fields.size() > 7) speed = nmea_double(fields[7]);
   double course = 0;
-  if (fields.size() > 8) course = fields[8].toDouble();
+  if (fields.size() > 8) course = nmea_double(fields[8]);
   QDate dmy;
   if (fields.size() > 9) {
-    QString datestr(fields[9]);
-    datestr.insert(4, "20");
-    dmy = QDate::fromString(datestr, u"ddMMyyyy");
+    dmy = nmea_parse_dmy(fields[9]);
   }
   if (fix != 'A') {
     /* ignore this fix - it is invalid */
@@ -597,20 +748,20 @@ NmeaFormat::gprmc_parse(const QString& ibuf)
 }
 
 void
-NmeaFormat::gpwpl_parse(const QString& ibuf)
+NmeaFormat::gpwpl_parse(const QByteArray& ibuf)
 {
-  const QStringList fields = ibuf.split(',');
+  const NmeaFields fields = nmea_split(ibuf);
 
   double latdeg = 0;
-  if (fields.size() > 1) latdeg = fields[1].toDouble();
-  QChar latdir = 'N';
+  if (fields.size() > 1) latdeg = nmea_double(fields[1]);
+  char latdir = 'N';
   if ((fields.size() > 2) && (fields[2].size() > 0)) latdir = fields[2][0];
   double lngdeg = 0;
-  if (fields.size() > 3) lngdeg = fields[3].toDouble();
-  QChar lngdir = 'E';
+  if (fields.size() > 3) lngdeg = nmea_double(fields[3]);
+  char lngdir = 'E';
   if ((fields.size() > 4) && (fields[4].size() > 0)) lngdir = fields[4][0];
   QString sname;
-  if (fields.size() > 5) sname = fields[5];
+  if (fields.size() > 5) sname = QString::fromUtf8(fields[5]);
 
   if (latdir == 'S') {
     latdeg = -latdeg;
@@ -629,12 +780,12 @@ NmeaFormat::gpwpl_parse(const QString& ibuf)
 }
 
 void
-NmeaFormat::gpzda_parse(const QString& ibuf)
+NmeaFormat::gpzda_parse(const QByteArray& ibuf)
 {
-  const QStringList fields = ibuf.split(',');
+  const NmeaFields fields = nmea_split(ibuf);
   if (fields.size() > 4) {
     QTime time = nmea_parse_hms(fields[1]);
-    QString datestr = QStringLiteral("%1%2%3").arg(fields[2], fields[3], fields[4]);
+    QString datestr = QString::fromUtf8(fields[2]) + QString::fromUtf8(fields[3]) + QString::fromUtf8(fields[4]);
     QDate date = QDate::fromString(datestr, u"ddMMyyyy");
 
     // The prev_datetime data member might be used by
@@ -652,31 +803,31 @@ NmeaFormat::gpzda_parse(const QString& ibuf)
 // The numbering as per http://aprs.gids.nl/nmea/#gsa was the reference as
 // the field numbers conveniently match our index.
 void
-NmeaFormat::gpgsa_parse(const QString& ibuf) const
+NmeaFormat::gpgsa_parse(const QByteArray& ibuf) const
 {
   int  prn[12] = {0};
   memset(prn,0xff,sizeof(prn));
 
-  const QStringList fields = ibuf.split(',');
+  const NmeaFields fields = nmea_split(ibuf);
   int nfields = fields.size();
   // 0 = "GPGSA"
   // 1 = Mode. Ignored
-  QChar fix;
+  char fix = '\0';
   if ((nfields > 2) && (fields[2].size() > 0)) {
     fix = fields[2][0];
   }
 
   // 12 fields, index 3 through 14.
   for (int cnt = 0; cnt <= 11; cnt++) {
-    if (nfields > cnt + 3) prn[cnt] = fields[cnt + 3].toInt();
+    if (nfields > cnt + 3) prn[cnt] = nmea_int(fields[cnt + 3]);
   }
 
   float pdop = 0;
   float hdop = 0;
   float vdop = 0;
-  if (nfields > 15) pdop = fields[15].toFloat();
-  if (nfields > 16) hdop = fields[16].toFloat();
-  if (nfields > 17) vdop = fields[17].toFloat();
+  if (nfields > 15) pdop = nmea_float(fields[15]);
+  if (nfields > 16) hdop = nmea_float(fields[16]);
+  if (nfields > 17) vdop = nmea_float(fields[17]);
 
   if (curr_waypt) {
     if (curr_waypt->fix!=fix_dgps) {
@@ -701,15 +852,15 @@ NmeaFormat::gpgsa_parse(const QString& ibuf) const
 }
 
 void
-NmeaFormat::gpvtg_parse(const QString& ibuf) const
+NmeaFormat::gpvtg_parse(const QByteArray& ibuf) const
 {
-  const QStringList fields = ibuf.split(',');
+  const NmeaFields fields = nmea_split(ibuf);
   double course = 0;
-  if (fields.size() > 1) course = fields[1].toDouble();
+  if (fields.size() > 1) course = nmea_double(fields[1]);
   double speed_n = 0;
-  if (fields.size() > 5) speed_n = fields[5].toDouble();
+  if (fields.size() > 5) speed_n = nmea_double(fields[5]);
   double speed_k = 0;
-  if (fields.size() > 7) speed_k = fields[7].toDouble();
+  if (fields.size() > 7) speed_k = nmea_double(fields[7]);
 
   if (curr_waypt) {
     curr_waypt->set_course(course);
@@ -911,7 +1062,7 @@ NmeaFormat::nmea_parse_one_line(const QByteArray& ibuf)
       bool ok;
       int ckcmp = ckstring.toInt(&ok, 16);
       if (ok) {
-        int ckval = nmea_cksum(tbuf.mid(1, ckidx - 1));
+        int ckval = nmea_cksum(tbuf.constData() + 1, ckidx - 1);
         if (ckval != ckcmp) {
           Warning().nospace() << qSetFieldWidth(2) << qSetPadChar('0') <<  Qt::hex << "Invalid NMEA checksum.  Computed 0x" << ckval << " but found 0x" << ckcmp << ".  Ignoring sentence.";
           return;
@@ -943,9 +1094,7 @@ NmeaFormat::nmea_parse_one_line(const QByteArray& ibuf)
      for that field.  Rather than change all the parse routines, we first
      substitute a default value of zero for any missing field.
   */
-  while (tbuf.contains(",,")) {
-    tbuf.replace(",,", ",0,");
-  }
+  nmea_fill_empty_fields(tbuf);
 
   if (notalkerid_strmatch(tbuf, "WPL")) {
     gpwpl_parse(tbuf);
@@ -1005,7 +1154,34 @@ NmeaFormat::read()
 
   curr_waypt = nullptr;
 
+  /*
+   * With a checkpoint only the sentences added since the last run are
+   * read, with the date and datum that run ended with.  A last line
+   * without a line break may still be being written, so it is left for
+   * the next run.
+   */
+  std::unique_ptr<gpsbabel::Checkpoint> checkpoint;
+  gboff_t resume = 0;
+  if (opt_checkpoint) {
+    checkpoint = std::make_unique<gpsbabel::Checkpoint>(opt_checkpoint, rd_fname, MYNAME);
+    if (checkpoint->offset() > 0) {
+      gbfseek(file_in, checkpoint->offset(), SEEK_SET);
+      resume = checkpoint->offset();
+      const QJsonObject& state = checkpoint->state();
+      line = state.value("line").toInt();
+      prev_datetime = QDateTime::fromString(state.value("time").toString(), Qt::ISODateWithMs);
+      datum = state.value("datum").toInt(kDatumWGS84);
+      datum_transform = GPS_Math_Known_Datum_To_WGS84_Setup(datum);
+    }
+  }
+
   while ((ibuf = gbfgetstr(file_in))) {
+    if (checkpoint) {
+      if (!file_in->line_ended) {
+        break;
+      }
+      resume = gbftell(file_in);
+    }
     line++;
 
     if ((line == 0) && (case_ignore_strncmp(ibuf, "@SonyGPS/ver", 12) == 0)) {
@@ -1030,6 +1206,7 @@ NmeaFormat::read()
         if (datum < 0) {
           fatal(MYNAME "/SonyGPS: Unsupported datum \"%s\" in source data!\n", sdatum);
         }
+        datum_transform = GPS_Math_Known_Datum_To_WGS84_Setup(datum);
       }
       continue;
     }
@@ -1046,11 +1223,26 @@ NmeaFormat::read()
 
   /* try to complete date-less trackpoints */
   nmea_fix_timestamps(trk_head);
+
+  if (checkpoint) {
+    QJsonObject state{{"line", line}, {"datum", datum}};
+    if (prev_datetime.isValid()) {
+      state.insert("time", prev_datetime.toUTC().toString(Qt::ISODateWithMs));
+    }
+    checkpoint->save(resume, state);
+  }
 }
 
 void
 NmeaFormat::rd_position_init(const QString& fname)
 {
+  CHECK_BOOL(opt_low_latency);
+  epoch_seen = ps_none;
+  epoch_expected = ps_none;
+  epoch_time = QTime();
+  last_epoch_time = QTime();
+  held_line.clear();
+
   if ((gbser_handle = gbser_init(qPrintable(fname))) != nullptr) {
     read_mode = rm_serial;
     gbser_set_speed(gbser_handle, 4800);
@@ -1117,13 +1309,333 @@ int NmeaFormat::hunt_sirf()
   return 0;
 }
 
+/*
+ * Tell which position sentence, if any, a line holds, and its time.
+ */
+unsigned
+NmeaFormat::nmea_posn_sentence(const QByteArray& line, QTime* time) const
+{
+  QByteArray tbuf = line.trimmed();
+  if (tbuf.startsWith("---,")) {
+    tbuf.remove(0, 4);
+  }
+
+  unsigned kind;
+  int time_field;
+  if (opt_gpgga && notalkerid_strmatch(tbuf, "GGA")) {
+    kind = ps_gga;
+    time_field = 1;
+  } else if (opt_gprmc && notalkerid_strmatch(tbuf, "RMC")) {
+    kind = ps_rmc;
+    time_field = 1;
+  } else if (notalkerid_strmatch(tbuf, "GLL")) {
+    kind = ps_gll;
+    time_field = 5;
+  } else {
+    return ps_none;
+  }
+
+  const NmeaFields fields = nmea_split(tbuf);
+  *time = (fields.size() > time_field) ? nmea_parse_hms(fields[time_field]) : QTime();
+  return time->isValid() ? kind : ps_none;
+}
+
+/* Hand the pending realtime fix back, remembering what made it complete. */
+Waypoint*
+NmeaFormat::nmea_take_epoch()
+{
+  if (global_opts.debug_level > 1) {
+    printf(MYNAME ": fix for %s after %lld ms\n",
+           qPrintable(epoch_time.toString(u"hh:mm:ss.zzz")),
+           static_cast<long long>(epoch_clock.elapsed()));
+  }
+
+  Waypoint* wpt = curr_waypt;
+  if (wpt != nullptr) {
+    epoch_expected = epoch_seen;
+  }
+  last_epoch_time = epoch_time;
+  epoch_seen = ps_none;
+  curr_waypt = nullptr;
+  return wpt;
+}
+
+/*
+ * Return each fix as soon as the position sentences seen in the last
+ * complete epoch have all arrived for it, or when the next epoch begins,
+ * but never later than kEpochWaitMs after its first sentence arrived, as
+ * measured by a monotonic clock.  Waiting is done in gbser_read_line,
+ * which blocks in select() only for the time that is left.
+ */
+Waypoint*
+NmeaFormat::rd_position_low_latency()
+{
+  char ibuf[1024];
+
+  for (;;) {
+    QByteArray line;
+    if (!held_line.isEmpty()) {
+      line = held_line;
+      held_line.clear();
+    } else {
+      unsigned ms = 2000;
+      if (epoch_seen != ps_none) {
+        qint64 left = kEpochWaitMs - epoch_clock.elapsed();
+        if (left <= 0) {
+          return nmea_take_epoch();
+        }
+        ms = left;
+      }
+      ibuf[0] = 0;
+      int rv = gbser_read_line(gbser_handle, ibuf, sizeof(ibuf), ms, 0x0a, 0x0d);
+      if (global_opts.debug_level > 1) {
+        safe_print(strlen(ibuf), ibuf);
+      }
+      if ((rv == gbser_TIMEOUT) && (epoch_seen != ps_none)) {
+        return nmea_take_epoch();
+      }
+      if (rv < 0) {
+        fatal(MYNAME ": No data received on %s.\n", qPrintable(posn_fname));
+      }
+      line = ibuf;
+    }
+
+    Waypoint* wpt;
+    if (nmea_epoch_line(line, &wpt)) {
+      return wpt;
+    }
+  }
+}
+
+/*
+ * Take one sentence for the pending low latency fix.  Returns true, with
+ * the fix in *wpt, when the fix is to be handed back.  If the sentence
+ * begins the next epoch it is kept in held_line to be taken again.
+ */
+bool
+NmeaFormat::nmea_epoch_line(const QByteArray& line, Waypoint** wpt)
+{
+  QTime time;
+  unsigned kind = nmea_posn_sentence(line, &time);
+  if ((kind != ps_none) && (epoch_seen != ps_none) && (time != epoch_time)) {
+    /* The next epoch has begun, keep its sentence for later. */
+    held_line = line;
+    *wpt = nmea_take_epoch();
+    return true;
+  }
+
+  nmea_parse_one_line(line);
+
+  if (kind == ps_none) {
+    return false;
+  }
+  if ((epoch_seen == ps_none) && (time == last_epoch_time)) {
+    /* Late for a fix already returned, wait for it next time. */
+    epoch_expected |= kind;
+    nmea_release_wpt(curr_waypt);
+    curr_waypt = nullptr;
+    return false;
+  }
+  if (epoch_seen == ps_none) {
+    epoch_time = time;
+    epoch_clock.start();
+  }
+  epoch_seen |= kind;
+  if ((epoch_expected != ps_none) && ((epoch_seen & epoch_expected) == epoch_expected)) {
+    *wpt = nmea_take_epoch();
+    return true;
+  }
+  return false;
+}
+
+/*
+ * Several inputs are opened one after the other by rd_position_init, and
+ * each one's state is then kept in a PosnSource of its own.
+ */
+void
+NmeaFormat::rd_position_init_many(const QStringList& fnames)
+{
+  posn_sources.clear();
+  posn_fixes.clear();
+  for (const QString& fname : fnames) {
+    rd_position_init(fname);
+    PosnSource source;
+    posn_source_swap(source);
+    posn_sources.append(source);
+  }
+}
+
+/* Exchange the reading state of an input with ours. */
+void
+NmeaFormat::posn_source_swap(PosnSource& source)
+{
+  using std::swap;
+  swap(posn_fname, source.posn_fname);
+  swap(gbser_handle, source.gbser_handle);
+  swap(curr_waypt, source.curr_waypt);
+  swap(last_read_time, source.last_read_time);
+  swap(prev_datetime, source.prev_datetime);
+  swap(posn_type, source.posn_type);
+  swap(amod_waypoint, source.amod_waypoint);
+  swap(had_checksum, source.had_checksum);
+  swap(epoch_seen, source.epoch_seen);
+  swap(epoch_expected, source.epoch_expected);
+  swap(epoch_time, source.epoch_time);
+  swap(last_epoch_time, source.last_epoch_time);
+  swap(epoch_clock, source.epoch_clock);
+  swap(held_line, source.held_line);
+}
+
+/* Queue a fix of the input whose state is ours, named for the input. */
+void
+NmeaFormat::posn_source_fix(Waypoint* wpt, std::chrono::steady_clock::time_point received)
+{
+  if (wpt != nullptr) {
+    wpt->shortname = posn_fname;
+    posn_fixes.append({wpt, received});
+  }
+}
+
+/*
+ * Take whatever an input has received and parse its complete sentences,
+ * a fix being complete when it would be for rd_position.  An input that
+ * fails, or is ready without anything to read, has gone away and is
+ * closed.
+ */
+void
+NmeaFormat::posn_source_read(PosnSource& source, std::chrono::steady_clock::time_point received)
+{
+  posn_source_swap(source);
+
+  char ibuf[1024];
+  bool got_data = false;
+  for (;;) {
+    int rv = gbser_read(gbser_handle, ibuf, sizeof(ibuf));
+    if ((rv < 0) || ((rv == 0) && !got_data)) {
+      warning(MYNAME ": No more data received on %s.\n", qPrintable(posn_fname));
+      gbser_deinit(gbser_handle);
+      gbser_handle = nullptr;
+      nmea_release_wpt(curr_waypt);
+      curr_waypt = nullptr;
+      break;
+    }
+    if (rv == 0) {
+      break;
+    }
+    got_data = true;
+    source.partial.append(ibuf, rv);
+  }
+
+  qsizetype start = 0;
+  for (qsizetype eol; (eol = source.partial.indexOf('\n', start)) >= 0; start = eol + 1) {
+    QByteArray line = source.partial.mid(start, eol - start);
+    if (line.endsWith('\r')) {
+      line.chop(1);
+    }
+    if (global_opts.debug_level > 1) {
+      safe_print(line.size(), line.constData());
+    }
+    if (opt_low_latency) {
+      Waypoint* wpt;
+      while (nmea_epoch_line(line, &wpt)) {
+        posn_source_fix(wpt, received);
+        if (held_line.isEmpty()) {
+          break;
+        }
+        line = std::exchange(held_line, QByteArray());
+      }
+    } else {
+      nmea_parse_one_line(line);
+      if ((source.lt != last_read_time) && last_read_time.isValid()) {
+        source.lt = last_read_time;
+        posn_source_fix(std::exchange(curr_waypt, nullptr), received);
+      }
+    }
+  }
+  source.partial.remove(0, start);
+  /* No sentence is this long, it must be noise. */
+  if (source.partial.size() > qsizetype(sizeof(ibuf))) {
+    source.partial.clear();
+  }
+
+  posn_source_swap(source);
+}
+
+/*
+ * The fixes of several inputs, in the order they were completed.  All
+ * the inputs are waited for at once with gbser_poll, so one process can
+ * follow hundreds of receivers.  Unlike a single input an input that is
+ * silent for a while is not an error.  Returns no fix if nothing came
+ * for kManyWaitMs.
+ */
+Waypoint*
+NmeaFormat::rd_position_many(posn_status* status)
+{
+  unsigned ms = kManyWaitMs;
+  if (opt_low_latency) {
+    for (auto& source : posn_sources) {
+      if (source.epoch_seen != ps_none) {
+        qint64 left = kEpochWaitMs - source.epoch_clock.elapsed();
+        if (left <= 0) {
+          posn_source_swap(source);
+          posn_source_fix(nmea_take_epoch(), std::chrono::steady_clock::now());
+          posn_source_swap(source);
+        } else {
+          ms = std::min<unsigned>(ms, left);
+        }
+      }
+    }
+  }
+
+  if (posn_fixes.isEmpty()) {
+    QVector<void*> handles;
+    handles.reserve(posn_sources.size());
+    for (const auto& source : std::as_const(posn_sources)) {
+      handles.append(source.gbser_handle);
+    }
+    QVector<unsigned char> ready(handles.size());
+    if (gbser_poll(handles.constData(), ready.data(), unsigned(handles.size()), ms) < 0) {
+      fatal(MYNAME ": Waiting for data failed.\n");
+    }
+    const auto received = std::chrono::steady_clock::now();
+    for (qsizetype i = 0; i < ready.size(); ++i) {
+      if (ready.at(i)) {
+        posn_source_read(posn_sources[i], received);
+      }
+    }
+    posn_sources.removeIf([](const PosnSource& source)->bool {
+      return source.gbser_handle == nullptr;
+    });
+    if (posn_sources.isEmpty()) {
+      fatal(MYNAME ": No data received on any input.\n");
+    }
+  }
+
+  if (posn_fixes.isEmpty()) {
+    return nullptr;
+  }
+  auto [wpt, received] = posn_fixes.takeFirst();
+  if (status != nullptr) {
+    status->received = received;
+  }
+  return wpt;
+}
+
 Waypoint*
-NmeaFormat::rd_position(posn_status* /*unused*/)
+NmeaFormat::rd_position(posn_status* status)
 {
   char ibuf[1024];
   static QTime lt;
   int am_sirf = 0;
 
+  if (!posn_sources.isEmpty()) {
+    return rd_position_many(status);
+  }
+
+  if (opt_low_latency) {
+    return rd_position_low_latency();
+  }
+
   /*
    * Read a handful of sentences, collecting the best info we
    * can.  If the timestamp changes (indicating the sequence is
@@ -1172,13 +1684,47 @@ NmeaFormat::rd_position(posn_status* /*unused*/)
 void
 NmeaFormat::rd_position_deinit()
 {
+  if (!posn_sources.isEmpty()) {
+    for (auto& source : posn_sources) {
+      posn_source_swap(source);
+      gbser_deinit(gbser_handle);
+      nmea_release_wpt(curr_waypt);
+      posn_source_swap(source);
+    }
+    posn_sources.clear();
+    for (const auto& fix : std::as_const(posn_fixes)) {
+      delete fix.first;
+    }
+    posn_fixes.clear();
+    return;
+  }
   rd_deinit();
 }
 
+/*
+ * Sentences are collected in obuf and handed to gbfwrite a batch at a
+ * time, or one point at a time when they are paced or realtime.
+ */
+void
+NmeaFormat::nmea_flush() const
+{
+  if (!obuf.isEmpty()) {
+    gbfwrite(obuf.data(), 1, obuf.size(), file_out);
+    obuf.clear();
+  }
+}
+
+/* Finish the sentence begun at start with its checksum. */
+void
+NmeaFormat::nmea_end_sentence(qsizetype start) const
+{
+  int cksum = nmea_cksum(obuf.data() + start + 1, obuf.size() - start - 1);
+  obuf.put('*').put_hex(static_cast<unsigned int>(cksum), 2).put('\n');
+}
+
 void
 NmeaFormat::nmea_wayptpr(const Waypoint* wpt) const
 {
-  char obuf[200];
   QString s;
 
   double lat = degrees2ddmm(wpt->latitude);
@@ -1189,15 +1735,17 @@ NmeaFormat::nmea_wayptpr(const Waypoint* wpt) const
     s = mkshort_handle->mkshort(wpt->shortname);
   }
 
-  snprintf(obuf, sizeof(obuf),  "GPWPL,%08.3f,%c,%09.3f,%c,%s",
-           fabs(lat), lat < 0 ? 'S' : 'N',
-           fabs(lon), lon < 0 ? 'W' : 'E', CSTRc(s)
-          );
-  int cksum = nmea_cksum(obuf);
-  gbfprintf(file_out, "$%s*%02X\n", obuf, cksum);
+  qsizetype start = obuf.size();
+  obuf.put("$GPWPL,").put_fixed(fabs(lat), 3, 8).put(',').put(lat < 0 ? 'S' : 'N');
+  obuf.put(',').put_fixed(fabs(lon), 3, 9).put(',').put(lon < 0 ? 'W' : 'E');
+  obuf.put(',').put(s.toLatin1());
+  nmea_end_sentence(start);
   if (sleepms >= 0) {
+    nmea_flush();
     gbfflush(file_out);
     QThread::msleep(sleepms);
+  } else if (obuf.size() >= kBatchSize) {
+    nmea_flush();
   }
 }
 
@@ -1210,11 +1758,10 @@ NmeaFormat::nmea_track_init(const route_head* /*unused*/)
 void
 NmeaFormat::nmea_trackpt_pr(const Waypoint* wpt)
 {
-  char obuf[200];
   char fix='0';
-  int cksum;
 
   if (opt_sleep) {
+    nmea_flush();
     gbfflush(file_out);
     if (!first_trkpt) {
       if (sleepms >= 0) {
@@ -1234,12 +1781,21 @@ NmeaFormat::nmea_trackpt_pr(const Waypoint* wpt)
   double lat = degrees2ddmm(wpt->latitude);
   double lon = degrees2ddmm(wpt->longitude);
 
-  QByteArray dmy("");
-  QByteArray hms("");
-  if (wpt->GetCreationTime().isValid()) {
-    dmy = wpt->GetCreationTime().toUTC().toString(u"ddMMyy").toUtf8();
-    hms = wpt->GetCreationTime().toUTC().toString(u"hhmmss.zzz").toUtf8();
-  }
+  // Both fields stay empty without a time.
+  const bool has_time = wpt->GetCreationTime().isValid();
+  QDate date;
+  QTime time;
+  if (has_time) {
+    const QDateTime utc = wpt->GetCreationTime().toUTC();
+    date = utc.date();
+    time = utc.time();
+  }
+  auto put_hms = [this, has_time, &time]() {
+    if (has_time) {
+      obuf.put_int(time.hour(), 2).put_int(time.minute(), 2).put_int(time.second(), 2);
+      obuf.put('.').put_int(time.msec(), 3);
+    }
+  };
 
   switch (wpt->fix) {
   case fix_dgps:
@@ -1257,45 +1813,48 @@ NmeaFormat::nmea_trackpt_pr(const Waypoint* wpt)
   }
 
   if (opt_gprmc) {
-    snprintf(obuf, sizeof(obuf), "GPRMC,%s,%c,%08.3f,%c,%09.3f,%c,%.2f,%.2f,%s,,",
-             hms.constData(),
-             fix=='0' ? 'V' : 'A',
-             fabs(lat), lat < 0 ? 'S' : 'N',
-             fabs(lon), lon < 0 ? 'W' : 'E',
-             wpt->speed_has_value() ? MPS_TO_KNOTS(wpt->speed_value()):(0),
-             wpt->course_value_or(0),
-             dmy.constData());
-    cksum = nmea_cksum(obuf);
-
     /* GISTeq doesn't care about the checksum, but wants this prefixed, so
      * we can write it with abandon.
      */
     if (opt_gisteq) {
-      gbfprintf(file_out, "---,");
+      obuf.put("---,");
     }
-    gbfprintf(file_out, "$%s*%02X\n", obuf, cksum);
+    qsizetype start = obuf.size();
+    obuf.put("$GPRMC,");
+    put_hms();
+    obuf.put(',').put(fix=='0' ? 'V' : 'A');
+    obuf.put(',').put_fixed(fabs(lat), 3, 8).put(',').put(lat < 0 ? 'S' : 'N');
+    obuf.put(',').put_fixed(fabs(lon), 3, 9).put(',').put(lon < 0 ? 'W' : 'E');
+    obuf.put(',').put_fixed(wpt->speed_has_value() ? MPS_TO_KNOTS(wpt->speed_value()):(0), 2);
+    obuf.put(',').put_fixed(wpt->course_value_or(0), 2);
+    obuf.put(',');
+    if (has_time) {
+      obuf.put_int(date.day(), 2).put_int(date.month(), 2).put_int(date.year() % 100, 2);
+    }
+    obuf.put(",,");
+    nmea_end_sentence(start);
   }
   if (opt_gpgga) {
-    snprintf(obuf, sizeof(obuf), "GPGGA,%s,%08.3f,%c,%09.3f,%c,%c,%02d,%.1f,%.3f,M,%.1f,M,,",
-             hms.constData(),
-             fabs(lat), lat < 0 ? 'S' : 'N',
-             fabs(lon), lon < 0 ? 'W' : 'E',
-             fix,
-             (wpt->sat>0)?(wpt->sat):(0),
-             (wpt->hdop>0)?(wpt->hdop):(0.0),
-             wpt->altitude == unknown_alt ? 0 : wpt->altitude,
-             wpt->geoidheight_value_or(0)); /* TODO: we could look up the geoidheight if needed */
-    cksum = nmea_cksum(obuf);
-    gbfprintf(file_out, "$%s*%02X\n", obuf, cksum);
+    qsizetype start = obuf.size();
+    obuf.put("$GPGGA,");
+    put_hms();
+    obuf.put(',').put_fixed(fabs(lat), 3, 8).put(',').put(lat < 0 ? 'S' : 'N');
+    obuf.put(',').put_fixed(fabs(lon), 3, 9).put(',').put(lon < 0 ? 'W' : 'E');
+    obuf.put(',').put(fix);
+    obuf.put(',').put_int((wpt->sat>0)?(wpt->sat):(0), 2);
+    obuf.put(',').put_fixed((wpt->hdop>0)?(wpt->hdop):(0.0), 1);
+    obuf.put(',').put_fixed(wpt->altitude == unknown_alt ? 0 : wpt->altitude, 3);
+    /* TODO: we could look up the geoidheight if needed */
+    obuf.put(",M,").put_fixed(wpt->geoidheight_value_or(0), 1).put(",M,,");
+    nmea_end_sentence(start);
   }
   if ((opt_gpvtg) && (wpt->course_has_value() || wpt->speed_has_value())) {
-    snprintf(obuf,sizeof(obuf),"GPVTG,%.3f,T,0,M,%.3f,N,%.3f,K",
-             wpt->course_value_or(0),
-             wpt->speed_has_value() ? MPS_TO_KNOTS(wpt->speed_value()):(0),
-             wpt->speed_has_value() ? MPS_TO_KPH(wpt->speed_value()):(0));
-
-    cksum = nmea_cksum(obuf);
-    gbfprintf(file_out, "$%s*%02X\n", obuf, cksum);
+    qsizetype start = obuf.size();
+    obuf.put("$GPVTG,").put_fixed(wpt->course_value_or(0), 3);
+    obuf.put(",T,0,M,").put_fixed(wpt->speed_has_value() ? MPS_TO_KNOTS(wpt->speed_value()):(0), 3);
+    obuf.put(",N,").put_fixed(wpt->speed_has_value() ? MPS_TO_KPH(wpt->speed_value()):(0), 3);
+    obuf.put(",K");
+    nmea_end_sentence(start);
   }
 
   if ((opt_gpgsa) && (wpt->fix!=fix_unknown)) {
@@ -1312,15 +1871,20 @@ NmeaFormat::nmea_trackpt_pr(const Waypoint* wpt)
     default:
       fix=0;
     }
-    snprintf(obuf,sizeof(obuf),"GPGSA,A,%c,,,,,,,,,,,,,%.1f,%.1f,%.1f",
-             fix,
-             (wpt->pdop > 0) ? (wpt->pdop) : (0),
-             (wpt->hdop > 0) ? (wpt->hdop) : (0),
-             (wpt->vdop > 0) ? (wpt->vdop) : (0));
-    cksum = nmea_cksum(obuf);
-    gbfprintf(file_out, "$%s*%02X\n", obuf, cksum);
+    qsizetype start = obuf.size();
+    obuf.put("$GPGSA,A,");
+    /* A fix of 0 has always ended the sentence right here. */
+    if (fix != 0) {
+      obuf.put(fix).put(",,,,,,,,,,,,,");
+      obuf.put_fixed((wpt->pdop > 0) ? (wpt->pdop) : (0), 1);
+      obuf.put(',').put_fixed((wpt->hdop > 0) ? (wpt->hdop) : (0), 1);
+      obuf.put(',').put_fixed((wpt->vdop > 0) ? (wpt->vdop) : (0), 1);
+    }
+    nmea_end_sentence(start);
+  }
+  if (obuf.size() >= kBatchSize) {
+    nmea_flush();
   }
-  gbfflush(file_out);
 }
 
 void
@@ -1349,12 +1913,14 @@ void
 NmeaFormat::wr_position(Waypoint* wpt)
 {
   nmea_trackpt_pr(wpt);
+  nmea_flush();
+  gbfflush(file_out);
 }
 
 void
 NmeaFormat::wr_position_deinit()
 {
-// nmea_wr_deinit();
+  wr_deinit();
 }
 
 /*
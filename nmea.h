@@ -22,18 +22,28 @@
 #ifndef NMEA_H_INCLUDED_
 #define NMEA_H_INCLUDED_
 
+#include <chrono>             // for steady_clock
+#include <utility>            // for pair
+
 #include <QByteArray>         // for QByteArray
+#include <QByteArrayView>     // for QByteArrayView
 #include <QDate>              // for QDate
 #include <QDateTime>          // for QDateTime
+#include <QElapsedTimer>      // for QElapsedTimer
 #include <QList>              // for QList
 #include <QString>            // for QString
+#include <QStringList>        // for QStringList
 #include <QTime>              // for QTime
+#include <QVarLengthArray>    // for QVarLengthArray
 #include <QVector>            // for QVector
+#include <QtGlobal>           // for qsizetype, qint64
 
 #include "defs.h"
 #include "format.h"           // for Format
 #include "gbfile.h"           // for gbfile
+#include "jeeps/gpsmath.h"    // for GPS_Molodensky
 #include "mkshort.h"          // for MakeShort
+#include "src/core/formatbuffer.h" // for FormatBuffer
 
 
 class NmeaFormat : public Format
@@ -60,6 +70,11 @@ public:
     };
   }
 
+  unsigned int wr_fields() const override
+  {
+    return wpt_field_geocache;  // for the names of geocaches
+  }
+
   void rd_init(const QString& fname) override;
   void read() override;
   void rd_deinit() override;
@@ -67,15 +82,29 @@ public:
   void write() override;
   void wr_deinit() override;
   void rd_position_init(const QString& fname) override;
+  void rd_position_init_many(const QStringList& fnames) override;
   Waypoint* rd_position(posn_status* status) override;
   void rd_position_deinit() override;
   void wr_position_init(const QString& fname) override;
   void wr_position(Waypoint* wpt) override;
   void wr_position_deinit() override;
+  bool wr_can_stream() const override
+  {
+    return true;
+  }
 
   static int nmea_cksum(const char* buf);
+  static int nmea_cksum(const char* buf, qsizetype len);
 
 private:
+  /* Constants */
+
+  /* How long a realtime fix waits for the rest of its sentences */
+  static constexpr qint64 kEpochWaitMs = 200;
+
+  /* How long rd_position waits for any of several inputs */
+  static constexpr unsigned kManyWaitMs = 500;
+
   /* Types */
 
   enum preferred_posn_type {
@@ -85,26 +114,69 @@ private:
     gprmc
   };
 
+  /* The position sentences of an epoch, as bits */
+  enum posn_sentence_type {
+    ps_none = 0,
+    ps_gga = 1,
+    ps_rmc = 2,
+    ps_gll = 4
+  };
+
   enum read_mode_type {
     rm_unknown = 0,
     rm_serial,
     rm_file
   };
 
+  /*
+   * The reading state of one of several realtime inputs.  The members
+   * with the names of ours are exchanged with them while the input's
+   * sentences are parsed, see posn_source_swap.
+   */
+  struct PosnSource {
+    QString posn_fname;
+    void* gbser_handle{};
+    QByteArray partial;  /* received bytes of a sentence not complete yet */
+    QTime lt;            /* time of the last fix returned */
+
+    Waypoint* curr_waypt{};
+    QTime last_read_time;
+    QDateTime prev_datetime;
+    preferred_posn_type posn_type{};
+    bool amod_waypoint{};
+    bool had_checksum{};
+    unsigned epoch_seen{};
+    unsigned epoch_expected{};
+    QTime epoch_time;
+    QTime last_epoch_time;
+    QElapsedTimer epoch_clock;
+    QByteArray held_line;
+  };
+
+  /* The fields of a sentence, as views into it */
+  using NmeaFields = QVarLengthArray<QByteArrayView, 24>;
+
   /* Member Functions */
 
+  static NmeaFields nmea_split(QByteArrayView sentence);
+  static double nmea_double(QByteArrayView field);
+  static float nmea_float(QByteArrayView field);
+  static int nmea_int(QByteArrayView field);
+  static void nmea_fill_empty_fields(QByteArray& sentence);
   Waypoint* nmea_new_wpt();
   void nmea_add_wpt(Waypoint* wpt, route_head* trk) const;
   static void nmea_release_wpt(Waypoint* wpt);
   void nmea_set_waypoint_time(Waypoint* wpt, QDateTime* prev, const QDate& date, const QTime& time);
   static QTime nmea_parse_hms(const QString& str);
-  void gpgll_parse(const QString& ibuf);
-  void gpgga_parse(const QString& ibuf);
-  void gprmc_parse(const QString& ibuf);
-  void gpwpl_parse(const QString& ibuf);
-  void gpzda_parse(const QString& ibuf);
-  void gpgsa_parse(const QString& ibuf) const;
-  void gpvtg_parse(const QString& ibuf) const;
+  static QTime nmea_parse_hms(QByteArrayView str);
+  static QDate nmea_parse_dmy(QByteArrayView str);
+  void gpgll_parse(const QByteArray& ibuf);
+  void gpgga_parse(const QByteArray& ibuf);
+  void gprmc_parse(const QByteArray& ibuf);
+  void gpwpl_parse(const QByteArray& ibuf);
+  void gpzda_parse(const QByteArray& ibuf);
+  void gpgsa_parse(const QByteArray& ibuf) const;
+  void gpvtg_parse(const QByteArray& ibuf) const;
   static double pcmpt_deg(int d);
   void pcmpt_parse(const char* ibuf);
   void nmea_fix_timestamps(route_head* track);
@@ -112,6 +184,16 @@ private:
   void nmea_parse_one_line(const QByteArray& ibuf);
   static void safe_print(int cnt, const char* b);
   int hunt_sirf();
+  unsigned nmea_posn_sentence(const QByteArray& line, QTime* time) const;
+  Waypoint* rd_position_low_latency();
+  Waypoint* nmea_take_epoch();
+  bool nmea_epoch_line(const QByteArray& line, Waypoint** wpt);
+  void posn_source_swap(PosnSource& source);
+  void posn_source_read(PosnSource& source, std::chrono::steady_clock::time_point received);
+  void posn_source_fix(Waypoint* wpt, std::chrono::steady_clock::time_point received);
+  Waypoint* rd_position_many(posn_status* status);
+  void nmea_flush() const;
+  void nmea_end_sentence(qsizetype start) const;
   void nmea_wayptpr(const Waypoint* wpt) const;
   void nmea_track_init(const route_head* unused);
   void nmea_trackpt_pr(const Waypoint* wpt);
@@ -122,6 +204,7 @@ private:
 
   gbfile* file_in{}, *file_out{};
   route_head* trk_head{};
+  qsizetype trkpt_hint{0};  // points the first track may get
   MakeShort* mkshort_handle{};
   preferred_posn_type posn_type{};
   read_mode_type read_mode{};
@@ -130,6 +213,7 @@ private:
   Waypoint* last_waypt{};
   void* gbser_handle{};
   QString posn_fname;
+  QString rd_fname;
   QList<Waypoint*> pcmpt_head;
 
   int without_date{};	/* number of created trackpoints without a valid date */
@@ -147,6 +231,8 @@ private:
   char* opt_append{};
   char* opt_gisteq{};
   char* opt_ignorefix{};
+  char* opt_low_latency{};
+  char* opt_checkpoint{};
 
   long sleepms{};
   int getposn{};
@@ -157,10 +243,24 @@ private:
   bool first_trkpt{};
   QTime last_read_time;   /* Last timestamp of GGL, GGA or RMC */
   int datum{};
+  GPS_Molodensky datum_transform;  // from datum to WGS 84
   bool had_checksum{};
 
+  unsigned epoch_seen{};      /* position sentences of the pending realtime fix */
+  unsigned epoch_expected{};  /* position sentences of a complete epoch */
+  QTime epoch_time;           /* time of the pending realtime fix */
+  QTime last_epoch_time;      /* time of the last realtime fix returned */
+  QElapsedTimer epoch_clock;  /* started when the pending fix's first sentence arrived */
+  QByteArray held_line;       /* a sentence of the next epoch, read early */
+
+  QList<PosnSource> posn_sources;  /* the inputs of rd_position_init_many */
+  QList<std::pair<Waypoint*, std::chrono::steady_clock::time_point>> posn_fixes;  /* not returned yet */
+
   int wpt_not_added_yet{};
 
+  mutable gpsbabel::FormatBuffer obuf;	/* sentences being written */
+  static constexpr qsizetype kBatchSize = 64 * 1024;  /* of obuf before it is written */
+
   QVector<arglist_t> nmea_args = {
     {"snlen", &snlenopt, "Max length of waypoint name to write", "6", ARGTYPE_INT, "1", "64", nullptr },
     {"gprmc", &opt_gprmc, "Read/write GPRMC sentences", "1", ARGTYPE_BOOL, ARG_NOMINMAX, nullptr },
@@ -177,6 +277,8 @@ private:
     {"baud", &opt_baud, "Speed in bits per second of serial port (baud=4800)", nullptr, ARGTYPE_INT, ARG_NOMINMAX, nullptr },
     {"gisteq", &opt_gisteq, "Write tracks for Gisteq Phototracker", "0", ARGTYPE_BOOL, ARG_NOMINMAX, nullptr},
     {"ignore_fix", &opt_ignorefix, "Accept position fixes in gpgga marked invalid", "0", ARGTYPE_BOOL, ARG_NOMINMAX, nullptr},
+    {"low_latency", &opt_low_latency, "Return realtime fixes as soon as their sentences are complete", "0", ARGTYPE_BOOL, ARG_NOMINMAX, nullptr},
+    {"checkpoint", &opt_checkpoint, "Only read what was appended since this checkpoint", nullptr, ARGTYPE_OUTFILE, ARG_NOMINMAX, nullptr},
   };
 
 };
@@ -20,6 +20,8 @@
 
 */
 
+#include <cstddef>                     // for size_t
+#include <cstdint>                     // for uint64_t
 #include <cstring>                     // for strlen, strchr, st
 
 #include <QByteArray>                  // for QByteArray
@@ -27,8 +29,9 @@
 #include <QLatin1String>               // for QLatin1String
 #include <QPair>                       // for QPair, operator==
 #include <QString>                     // for QString, operator==, operator+
+#include <QStringView>                 // for QStringView
 #include <QXmlStreamAttributes>        // for QXmlStreamAttributes
-#include <QtGlobal>                    // for qMax, qPrintable
+#include <QtGlobal>                    // for qMax, qPrintable, qint64
 
 #include "defs.h"
 #include "osm.h"
@@ -398,8 +401,8 @@ OsmFormat::osm_feature_symbol(const int ikey, const char* value) const
   QPair<int, QString> key(ikey, value);
 
   QString result;
-  if (values.contains(key)) {
-    result = values.value(key)->icon;
+  if (auto it = values.constFind(key); it != values.cend()) {
+    result = it.value()->icon;
   } else {
     result = QStringLiteral("%1:%2").arg(osm_features[ikey], value);
   }
@@ -412,6 +415,79 @@ OsmFormat::osm_strip_html(const QString& str)
   return strip_html(str);	// util.cc
 }
 
+void
+OsmFormat::NodeIndex::clear()
+{
+  slots.clear();
+  slots.shrink_to_fit();
+  used = 0;
+}
+
+/* Returns false, leaving the map alone, if id is already present. */
+bool
+OsmFormat::NodeIndex::insert(qint64 id, const Waypoint* waypoint)
+{
+  // Keep at least half the slots free so probe sequences stay short.
+  if ((used + 1) * 2 > slots.size()) {
+    grow();
+  }
+  std::size_t mask = slots.size() - 1;
+  for (std::size_t i = hash(id) & mask; ; i = (i + 1) & mask) {
+    Slot& slot = slots[i];
+    if (slot.waypoint == nullptr) {
+      slot = {id, waypoint};
+      ++used;
+      return true;
+    }
+    if (slot.id == id) {
+      return false;
+    }
+  }
+}
+
+const Waypoint*
+OsmFormat::NodeIndex::value(qint64 id) const
+{
+  if (slots.empty()) {
+    return nullptr;
+  }
+  std::size_t mask = slots.size() - 1;
+  for (std::size_t i = hash(id) & mask; ; i = (i + 1) & mask) {
+    const Slot& slot = slots[i];
+    if (slot.waypoint == nullptr) {
+      return nullptr;
+    }
+    if (slot.id == id) {
+      return slot.waypoint;
+    }
+  }
+}
+
+/* Node ids are often consecutive, so mix the bits before masking. */
+std::size_t
+OsmFormat::NodeIndex::hash(qint64 id)
+{
+  auto x = static_cast<std::uint64_t>(id);
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  return static_cast<std::size_t>(x);
+}
+
+void
+OsmFormat::NodeIndex::grow()
+{
+  std::vector<Slot> old;
+  old.swap(slots);
+  slots.assign(old.empty() ? 1024 : old.size() * 2, Slot{0, nullptr});
+  used = 0;
+  for (const Slot& slot : old) {
+    if (slot.waypoint != nullptr) {
+      insert(slot.id, slot.waypoint);
+    }
+  }
+}
+
 void
 OsmFormat::osm_node_end(const QString& /*unused*/, const QXmlStreamAttributes* /*unused*/)
 {
@@ -431,13 +507,24 @@ OsmFormat::osm_node(const QString& /*unused*/, const QXmlStreamAttributes* attrv
   wpt = new Waypoint;
 
   if (attrv->hasAttribute("id")) {
-    QString atstr = attrv->value("id").toString();
-    wpt->description =  "osm-id " + atstr;
-    if (waypoints.contains(atstr)) {
-      warning(MYNAME ": Duplicate osm-id %s!\n", qPrintable(atstr));
+    QStringView atstr = attrv->value("id");
+    wpt->description = QStringLiteral("osm-id ").append(atstr);
+    // Ids are 64 bit integers, anything else is looked up by its text.
+    bool numeric;
+    qint64 id = atstr.toLongLong(&numeric);
+    bool unique;
+    if (numeric) {
+      unique = nodes.insert(id, wpt);
     } else {
-      waypoints.insert(atstr, wpt);
+      unique = !waypoints.contains(atstr.toString());
+      if (unique) {
+        waypoints.insert(atstr.toString(), wpt);
+      }
+    }
+    if (unique) {
       wpt->wpt_flags.fmt_use = 1;
+    } else {
+      warning(MYNAME ": Duplicate osm-id %s!\n", qPrintable(atstr.toString()));
     }
   }
 
@@ -525,14 +612,16 @@ void
 OsmFormat::osm_way_nd(const QString& /*unused*/, const QXmlStreamAttributes* attrv)
 {
   if (attrv->hasAttribute("ref")) {
-    QString atstr = attrv->value("ref").toString();
+    QStringView atstr = attrv->value("ref");
 
-    if (waypoints.contains(atstr)) {
-      const Waypoint* ctmp = waypoints.value(atstr);
+    bool numeric;
+    qint64 id = atstr.toLongLong(&numeric);
+    const Waypoint* ctmp = numeric ? nodes.value(id) : waypoints.value(atstr.toString());
+    if (ctmp != nullptr) {
       auto* tmp = new Waypoint(*ctmp);
       route_add_wpt(rte, tmp);
     } else {
-      warning(MYNAME ": Way reference id \"%s\" wasn't listed under nodes!\n", qPrintable(atstr));
+      warning(MYNAME ": Way reference id \"%s\" wasn't listed under nodes!\n", qPrintable(atstr.toString()));
     }
   }
 }
@@ -613,6 +702,7 @@ OsmFormat::rd_init(const QString& fname)
   rte = nullptr;
 
   waypoints.clear();
+  nodes.clear();
   if (keys.isEmpty()) {
     osm_features_init();
   }
@@ -634,6 +724,7 @@ OsmFormat::rd_deinit()
   xml_reader = nullptr;
 
   waypoints.clear();
+  nodes.clear();
 }
 
 /*******************************************************************************/
@@ -665,8 +756,7 @@ OsmFormat::osm_write_tag(const QString& key, const QString& value) const
 void
 OsmFormat::osm_disp_feature(const Waypoint* waypoint) const
 {
-  if (icons.contains(waypoint->icon_descr)) {
-    const osm_icon_mapping_t* map = icons.value(waypoint->icon_descr);
+  if (const osm_icon_mapping_t* map = icons.value(waypoint->icon_descr, nullptr)) {
     osm_write_tag(osm_features[map->key], map->value);
   }
 }
@@ -683,15 +773,6 @@ OsmFormat::osm_write_opt_tag(const QString& atag)
   }
 }
 
-void
-OsmFormat::osm_release_ids(const Waypoint* waypoint)
-{
-  if (waypoint && waypoint->extra_data) {
-    delete static_cast<int*>(waypoint->extra_data);
-    const_cast<Waypoint*>(waypoint)->extra_data = nullptr;
-  }
-}
-
 QString
 OsmFormat::osm_name_from_wpt(const Waypoint* waypoint)
 {
@@ -707,18 +788,15 @@ OsmFormat::osm_waypt_disp(const Waypoint* waypoint)
 {
   QString name = osm_name_from_wpt(waypoint);
 
-  if (waypoints.contains(name)) {
+  if (node_ids.contains(name)) {
     return;
   }
 
-  waypoints.insert(name, waypoint);
-
-  auto* id = new int;
-  *id = --node_id;
-  const_cast<Waypoint*>(waypoint)->extra_data = id;
+  const int id = --node_id;
+  node_ids.insert(name, id);
 
   fout->writeStartElement(QStringLiteral("node"));
-  fout->writeAttribute(QStringLiteral("id"), QString::number(*id));
+  fout->writeAttribute(QStringLiteral("id"), QString::number(id));
   fout->writeAttribute(QStringLiteral("visible"), QStringLiteral("true"));
   fout->writeAttribute(QStringLiteral("lat"), QString::number(waypoint->latitude, 'f', 7));
   fout->writeAttribute(QStringLiteral("lon"), QString::number(waypoint->longitude, 'f', 7));
@@ -806,11 +884,9 @@ OsmFormat::osm_rtept_disp(const Waypoint* wpt_ref) const
     return;
   }
 
-  if (waypoints.contains(name)) {
-    const Waypoint* waypoint = waypoints.value(name);
-    auto* id = static_cast<int*>(waypoint->extra_data);
+  if (const auto it = node_ids.constFind(name); it != node_ids.cend()) {
     fout->writeEmptyElement(QStringLiteral("nd"));
-    fout->writeAttribute(QStringLiteral("ref"), QString::number(*id));
+    fout->writeAttribute(QStringLiteral("ref"), QString::number(*it));
   }
 }
 
@@ -853,7 +929,7 @@ OsmFormat::wr_init(const QString& fname)
   fout->setAutoFormattingIndent(2);
 
   osm_init_icons();
-  waypoints.clear();
+  node_ids.clear();
   node_id = 0;
 }
 
@@ -902,11 +978,7 @@ OsmFormat::wr_deinit()
   delete ofile;
   ofile = nullptr;
 
-  waypt_disp_all(osm_release_ids);
-  route_disp_all(nullptr, nullptr, osm_release_ids);
-  track_disp_all(nullptr, nullptr, osm_release_ids);
-
-  waypoints.clear();
+  node_ids.clear();
 }
 
 void
@@ -22,12 +22,16 @@
 #ifndef OSM_H_INCLUDED_
 #define OSM_H_INCLUDED_
 
+#include <cstddef>                     // for size_t
+#include <vector>                      // for vector
+
 #include <QHash>                       // for QHash
 #include <QList>                       // for QList
 #include <QPair>                       // for QPair
 #include <QString>                     // for QString
 #include <QVector>                     // for QVector
 #include <QXmlStreamAttributes>        // for QXmlStreamAttributes
+#include <QtGlobal>                    // for qint64
 
 #include "defs.h"
 #include "format.h"                    // for Format
@@ -77,6 +81,32 @@ private:
     const char* icon;
   };
 
+  /*
+   * The nodes read so far by their numeric id, so ways can find them.
+   * Extracts list millions of nodes; keying a QHash by the id text
+   * costs a QString and a hash node for each of them, this costs one
+   * open addressed slot.
+   */
+  class NodeIndex
+  {
+  public:
+    void clear();
+    bool insert(qint64 id, const Waypoint* waypoint);
+    const Waypoint* value(qint64 id) const;
+
+  private:
+    struct Slot {
+      qint64 id;
+      const Waypoint* waypoint;  // nullptr if the slot is free
+    };
+
+    static std::size_t hash(qint64 id);
+    void grow();
+
+    std::vector<Slot> slots;
+    std::size_t used{0};
+  };
+
   /* Constants */
 
   static const char* const osm_features[];
@@ -100,7 +130,6 @@ private:
   void osm_write_tag(const QString& key, const QString& value) const;
   void osm_disp_feature(const Waypoint* waypoint) const;
   void osm_write_opt_tag(const QString& atag);
-  static void osm_release_ids(const Waypoint* waypoint);
   static QString osm_name_from_wpt(const Waypoint* waypoint);
   void osm_waypt_disp(const Waypoint* waypoint);
   void osm_rte_disp_head(const route_head* route);
@@ -120,6 +149,9 @@ private:
   };
 
   QHash<QString, const Waypoint*> waypoints;
+  NodeIndex nodes;
+  // The id of the node written for each name of osm_name_from_wpt().
+  QHash<QString, int> node_ids;
 
   QHash<QString, int> keys;
   QHash<QPair<int, QString>, const osm_icon_mapping_t*> values;
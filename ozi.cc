@@ -58,7 +58,7 @@
 #include "defs.h"
 #include "csv_util.h"             // for csv_stringclean
 #include "formspec.h"             // for FormatSpecificDataList, kFsOzi
-#include "jeeps/gpsmath.h"        // for GPS_Lookup_Datum_Index, GPS_Math_Known_Datum_To_WGS84_M
+#include "jeeps/gpsmath.h"        // for GPS_Lookup_Datum_Index, GPS_Math_Known_Datum_To_WGS84_Setup
 #include "mkshort.h"              // for MakeShort
 #include "src/core/datetime.h"    // for DateTime
 #include "src/core/textstream.h"  // for TextStream
@@ -130,8 +130,8 @@ OziFormat::ozi_convert_datum(Waypoint* wpt) const
     double lat;
     double lon;
     double alt;
-    GPS_Math_Known_Datum_To_WGS84_M(wpt->latitude, wpt->longitude, 0.0,
-                                    &lat, &lon, &alt, datum);
+    datum_transform.convert(wpt->latitude, wpt->longitude, 0.0,
+                            &lat, &lon, &alt);
     wpt->latitude = lat;
     wpt->longitude = lon;
   }
@@ -678,6 +678,7 @@ OziFormat::read()
       if (datum < 0) {
         fatal(MYNAME ": Unsupported datum '%s'.\n", qPrintable(buff));
       }
+      datum_transform = GPS_Math_Known_Datum_To_WGS84_Setup(datum);
     } else if (linecount == 3) {
       if (buff.startsWith( "Altitude is in ", Qt::CaseInsensitive)) {
         QString unit = buff.mid(15);
@@ -786,7 +787,7 @@ OziFormat::ozi_waypt_pr(const Waypoint* wpt, int index)
   int faked_fsdata = 0;
   int icon = 0;
 
-  const auto* fs = reinterpret_cast<ozi_fsdata*>(wpt->fs.FsChainFind(kFsOzi));
+  const auto* fs = reinterpret_cast<const ozi_fsdata*>(wpt->fs.FsChainFind(kFsOzi));
 
   if (!fs) {
     fs = ozi_alloc_fsdata();
@@ -45,6 +45,7 @@
 #include "defs.h"
 #include "format.h"               // for Format
 #include "formspec.h"             // for FormatSpecificData, kFsOzi
+#include "jeeps/gpsmath.h"        // for GPS_Molodensky
 #include "mkshort.h"              // for MakeShort
 #include "src/core/textstream.h"  // for TextStream
 
@@ -85,6 +86,8 @@ private:
       return new ozi_fsdata(*this);
     }
 
+    std::size_t memory_usage() const override {return sizeof(*this);}
+
     int fgcolor{0};
     int bgcolor{65535};
   };
@@ -132,6 +135,7 @@ private:
   char* wptbgcolor = nullptr;
   char* pack_opt = nullptr;
   int datum{};
+  GPS_Molodensky datum_transform;  // from datum to WGS 84
   char* proximityarg = nullptr;
   double proximity{};
   char* altunit_opt{};
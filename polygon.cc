@@ -21,12 +21,18 @@
 
 #include "polygon.h"
 
-#include <cstdio>                 // for sscanf
+#include <algorithm>              // for max, min
+#include <cmath>                  // for floor, isfinite
+#include <utility>                // for as_const
+#include <vector>                 // for vector
 
+#include <QList>                  // for QList
 #include <QString>                // for QString
-#include <QtGlobal>               // for foreach
+#include <QtGlobal>               // for qsizetype, qBound
 
 #include "defs.h"
+#include "src/core/numeric.h"     // for scan_doubles
+#include "src/core/scheduler.h"   // for parallel_for
 #include "src/core/textstream.h"  // for TextStream
 
 
@@ -218,14 +224,93 @@ void PolygonFilter::polytest(double lat1, double lon1,
 
 }
 
+/*
+ * Sort the sides into bands of latitude.  The band of a latitude never
+ * decreases as the latitude grows, so a side registered in the bands of
+ * both ends of its range is found from every latitude within it.
+ */
+void PolygonFilter::build_index(EdgeIndex& index)
+{
+  bool seen = false;
+  for (const Edge& e : std::as_const(index.edges)) {
+    if (!std::isfinite(e.lat1) || !std::isfinite(e.lon1) ||
+        !std::isfinite(e.lat2) || !std::isfinite(e.lon2)) {
+      index.finite = false;
+      return;
+    }
+    const double lo = std::min(e.lat1, e.lat2);
+    const double hi = std::max(e.lat1, e.lat2);
+    index.min_lat = seen ? std::min(index.min_lat, lo) : lo;
+    index.max_lat = seen ? std::max(index.max_lat, hi) : hi;
+    seen = true;
+  }
+
+  const qsizetype nbands = qBound<qsizetype>(1, index.edges.size() / 2, 64 * 1024);
+  index.band_height = (index.max_lat - index.min_lat) / nbands;
+  index.bands.resize((std::isfinite(index.band_height) && (index.band_height > 0)) ? nbands : 1);
+  for (qsizetype i = 0; i < index.edges.size(); ++i) {
+    const Edge& e = index.edges.at(i);
+    const qsizetype lo = band_of(index, std::min(e.lat1, e.lat2));
+    const qsizetype hi = band_of(index, std::max(e.lat1, e.lat2));
+    for (qsizetype b = lo; b <= hi; ++b) {
+      index.bands[b].append(i);
+    }
+  }
+}
+
+qsizetype PolygonFilter::band_of(const EdgeIndex& index, double lat)
+{
+  if (index.bands.size() == 1) {
+    return 0;
+  }
+  const double b = std::floor((lat - index.min_lat) / index.band_height);
+  return qBound<qsizetype>(0, static_cast<qsizetype>(b), index.bands.size() - 1);
+}
+
+/*
+ * Run the odd/even test for one point over the sides in file order.
+ * Sides whose latitude range misses the point leave its state alone,
+ * so only the sides in the point's band are visited.
+ */
+bool PolygonFilter::inside(const EdgeIndex& index, double wlat, double wlon, bool first_waypoint)
+{
+  unsigned short state = OUTSIDE;
+  bool override = false;
+  auto test = [&](const Edge& e)->void {
+    if (e.lat2 == wlat && e.lon2 == wlon) {
+      override = true;
+    }
+    /* As always, only the first waypoint sees the first side of a ring as such. */
+    polytest(e.lat1, e.lon1, e.lat2, e.lon2, wlat, wlon,
+             &state, first_waypoint ? e.first : 0, e.last);
+  };
+
+  if (!index.finite || !std::isfinite(wlat)) {
+    for (const Edge& e : index.edges) {
+      test(e);
+    }
+  } else if ((wlat >= index.min_lat) && (wlat <= index.max_lat)) {
+    for (qsizetype i : index.bands.at(band_of(index, wlat))) {
+      const Edge& e = index.edges.at(i);
+      if ((wlat >= std::min(e.lat1, e.lat2)) && (wlat <= std::max(e.lat1, e.lat2))) {
+        test(e);
+      }
+    }
+  }
+
+  if (override) {
+    state = INSIDE;
+  }
+  return (state & INSIDE) != OUTSIDE;
+}
+
 #define BADVAL 999999
 
 void PolygonFilter::process()
 {
-  extra_data* ed;
+  EdgeIndex index;
   int fileline = 0;
   int first = 1;
-  int last = 0;
   QString line;
 
   gpsbabel::TextStream stream;
@@ -245,8 +330,10 @@ void PolygonFilter::process()
       line.truncate(pound);
     }
 
-    lat2 = lon2 = BADVAL;
-    int argsfound = sscanf(CSTR(line), "%lf %lf", &lat2, &lon2);
+    double vertex[2] = {BADVAL, BADVAL};
+    int argsfound = gpsbabel::scan_doubles(line, vertex, 2);
+    lat2 = vertex[0];
+    lon2 = vertex[1];
 
     if ((argsfound != 2) && (line.trimmed().size() > 0)) {
       warning(MYNAME
@@ -254,30 +341,10 @@ void PolygonFilter::process()
               fileline);
     } else if (lat1 != BADVAL && lon1 != BADVAL &&
                lat2 != BADVAL && lon2 != BADVAL) {
-      foreach (Waypoint* waypointp, *global_waypoint_list) {
-        if (waypointp->extra_data) {
-          ed = (extra_data*) waypointp->extra_data;
-        } else {
-          ed = new extra_data;
-          ed->state = OUTSIDE;
-          ed->override = 0;
-          waypointp->extra_data = ed;
-        }
-        if (lat2 == waypointp->latitude &&
-            lon2 == waypointp->longitude) {
-          ed->override = 1;
-        }
-        if (olat != BADVAL && olon != BADVAL &&
-            olat == lat2 && olon == lon2) {
-          last = 1;
-        }
-        polytest(lat1, lon1, lat2, lon2,
-                 waypointp->latitude,
-                 waypointp->longitude,
-                 &ed->state, first, last);
-        first = 0;
-        last = 0;
-      }
+      const int last = (olat != BADVAL && olon != BADVAL &&
+                        olat == lat2 && olon == lon2) ? 1 : 0;
+      index.edges.append({lat1, lon1, lat2, lon2, first, last});
+      first = 0;
     }
     if (olat != BADVAL && olon != BADVAL &&
         olat == lat2 && olon == lon2) {
@@ -298,17 +365,36 @@ void PolygonFilter::process()
   }
   stream.close();
 
-  foreach (Waypoint* wp, *global_waypoint_list) {
-    if (wp->extra_data) {
-      ed = (extra_data*) wp->extra_data;
-      wp->extra_data = nullptr;
-      if (ed->override) {
-        ed->state = INSIDE;
-      }
-      if (((ed->state & INSIDE) == OUTSIDE) == (exclopt == nullptr)) {
-        wp->wpt_flags.marked_for_deletion = 1;
-      }
-      delete ed;
+  /* Without a single side no point gets a verdict, so none is dropped. */
+  if (index.edges.isEmpty()) {
+    return;
+  }
+  build_index(index);
+
+  QList<Waypoint*> wpts;
+  wpts.reserve(global_waypoint_list->count());
+  for (Waypoint* waypointp : std::as_const(*global_waypoint_list)) {
+    wpts.append(waypointp);
+  }
+  const qsizetype nelems = wpts.size();
+
+  /* Every point is tested on its own, so they may be tested side by side. */
+  std::vector<char> verdicts(nelems);
+  auto classify = [&index, &wpts, &verdicts](qsizetype begin, qsizetype end)->void {
+    for (qsizetype i = begin; i < end; ++i) {
+      verdicts[i] = inside(index, wpts.at(i)->latitude, wpts.at(i)->longitude, i == 0);
+    }
+  };
+  const int threads = (opt_threads != nullptr) ? xstrtoi(opt_threads, nullptr, 10) : 1;
+  if ((threads > 1) && (nelems >= kParallelMin)) {
+    gpsbabel::parallel_for(nelems, (nelems + threads - 1) / threads, classify);
+  } else {
+    classify(0, nelems);
+  }
+
+  for (qsizetype i = 0; i < nelems; ++i) {
+    if ((verdicts[i] == 0) == (exclopt == nullptr)) {
+      wpts.at(i)->wpt_flags.marked_for_deletion = 1;
     }
   }
   del_marked_wpts();
@@ -22,9 +22,11 @@
 #ifndef POLYGON_H_INCLUDED_
 #define POLYGON_H_INCLUDED_
 
+#include <QList>           // for QList
 #include <QVector>         // for QVector
+#include <QtGlobal>        // for qsizetype
 
-#include "defs.h"    // for ARG_NOMINMAX, arglist_t, ARGTYPE_BOOL, ARGTYPE_FILE
+#include "defs.h"    // for ARG_NOMINMAX, arglist_t, ARGTYPE_BOOL, ARGTYPE_FILE, ARGTYPE_INT
 #include "filter.h"  // for Filter
 
 #if FILTERS_ENABLED
@@ -41,22 +43,48 @@ public:
 private:
   /* Types */
 
-  struct extra_data {
-    unsigned short state;
-    unsigned short override;
+  /* One side of the polygon, in the order of the file. */
+  struct Edge {
+    double lat1, lon1;
+    double lat2, lon2;
+    int first;	/* first side of a ring */
+    int last;	/* closes a ring */
   };
 
+  /*
+   * The sides grouped in bands of latitude.  A side can only affect a
+   * test point whose latitude is within its own range, so each band
+   * lists, in file order, the sides whose range reaches into it.
+   */
+  struct EdgeIndex {
+    QList<Edge> edges;
+    bool finite{true};	/* all vertices are finite; otherwise every side is tested */
+    double min_lat{};
+    double max_lat{};
+    double band_height{};
+    QList<QList<qsizetype>> bands;
+  };
+
+  /* Constants */
+
+  /* Fewer waypoints than this aren't worth starting threads for. */
+  static constexpr qsizetype kParallelMin = 16 * 1024;
+
   /* Member Functions */
 
   static void polytest(double lat1, double lon1,
                 double lat2, double lon2,
                 double wlat, double wlon,
                 unsigned short* state, int first, int last);
+  static void build_index(EdgeIndex& index);
+  static qsizetype band_of(const EdgeIndex& index, double lat);
+  static bool inside(const EdgeIndex& index, double wlat, double wlon, bool first_waypoint);
 
   /* Data Members */
 
   char* polyfileopt = nullptr;
   char* exclopt = nullptr;
+  char* opt_threads = nullptr;
 
   QVector<arglist_t> args = {
     {
@@ -67,6 +95,10 @@ private:
       "exclude", &exclopt, "Exclude points inside the polygon",
       nullptr, ARGTYPE_BOOL, ARG_NOMINMAX, nullptr
     },
+    {
+      "threads", &opt_threads, "Test large waypoint lists on this many threads",
+      nullptr, ARGTYPE_INT, "1", nullptr, nullptr
+    },
   };
 
 };
@@ -21,17 +21,82 @@
 
 #include "position.h"
 
-#include <cmath>                // for abs
-#include <cstdlib>              // for strtod, abs
+#include <cmath>                    // for abs
+#include <cstdlib>                  // for strtod, abs
+#include <utility>                  // for as_const
 
-#include <QList>                // for QList
-#include <QtGlobal>             // for qRound64, qint64
+#include <QList>                    // for QList
+#include <QVector>                  // for QVector
+#include <QtGlobal>                 // for qRound64, qint64, qsizetype
 
 #include "defs.h"
-#include "src/core/datetime.h"  // for DateTime
+#include "src/core/budget.h"        // for Budget
+#include "src/core/datetime.h"      // for DateTime
+#include "src/core/spatialindex.h"  // for SpatialIndex
 
 #if FILTERS_ENABLED
 
+/* true if b is within pos_dist (and max_diff_time) of a */
+bool PositionFilter::position_close(const WptRecord& a, const WptRecord& b) const
+{
+  if (!gcdist_meters_within(b.wpt->position(), a.wpt->position(), pos_dist)) {
+    return false;
+  }
+  if (check_time) {
+    qint64 diff_time = std::abs(b.wpt->creation_time.msecsTo(a.wpt->creation_time));
+    if (diff_time >= max_diff_time) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Waypoints have no order to exploit, so rather than comparing every
+ * pair only the candidates a spatial index finds near each point are
+ * checked.  Points are still visited in list order and only later points
+ * are removed, so the result matches the pairwise scan.
+ * Returns false, having changed nothing, if a position can't be indexed.
+ */
+bool PositionFilter::position_gridqueue(QList<WptRecord>& qlist) const
+{
+  const int nelems = qlist.size();
+  QVector<double> latitudes;
+  QVector<double> longitudes;
+  latitudes.reserve(nelems);
+  longitudes.reserve(nelems);
+  for (const WptRecord& rec : std::as_const(qlist)) {
+    latitudes.append(rec.wpt->latitude);
+    longitudes.append(rec.wpt->longitude);
+  }
+  const double radius = pos_dist / radtometers(1.0);
+  const gpsbabel::SpatialIndex index(latitudes, longitudes, radius);
+  if (!index.all_finite()) {
+    return false;
+  }
+
+  for (int i = 0 ; i < nelems ; ++i) {
+    if (qlist.at(i).deleted) {
+      continue;
+    }
+    bool something_deleted = false;
+
+    const QVector<qsizetype> candidates = index.within(latitudes.at(i), longitudes.at(i), radius);
+    for (qsizetype j : candidates) {
+      if ((j > i) && !qlist.at(j).deleted && position_close(qlist.at(i), qlist.at(j))) {
+        qlist[j].deleted = true;
+        qlist.at(j).wpt->wpt_flags.marked_for_deletion = 1;
+        something_deleted = true;
+      }
+    }
+
+    if (something_deleted && (purge_duplicates != nullptr)) {
+      qlist.at(i).wpt->wpt_flags.marked_for_deletion = 1;
+    }
+  }
+  return true;
+}
+
 /* tear through a waypoint queue, processing points by distance */
 void PositionFilter::position_runqueue(const WaypointList& waypt_list, int qtype)
 {
@@ -43,16 +108,19 @@ void PositionFilter::position_runqueue(const WaypointList& waypt_list, int qtype
     }
     int nelems = qlist.size();
 
+    if ((qtype == wptdata) && position_gridqueue(qlist)) {
+      return;
+    }
+
     for (int i = 0 ; i < nelems ; ++i) {
+      gpsbabel::Budget::check();
       if (!qlist.at(i).deleted) {
         bool something_deleted = false;
 
         for (int j = i + 1 ; j < nelems ; ++j) {
           if (!qlist.at(j).deleted) {
-            double dist = radtometers(gcdist(qlist.at(j).wpt->position(),
-                                             qlist.at(i).wpt->position()));
-
-            if (dist <= pos_dist) {
+            if (gcdist_meters_within(qlist.at(j).wpt->position(),
+                                     qlist.at(i).wpt->position(), pos_dist)) {
               if (check_time) {
                 qint64 diff_time = std::abs(qlist.at(j).wpt->creation_time.msecsTo(qlist.at(i).wpt->creation_time));
                 if (diff_time >= max_diff_time) {
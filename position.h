@@ -22,13 +22,14 @@
 #ifndef POSITION_H_INCLUDED_
 #define POSITION_H_INCLUDED_
 
+#include <QList>      // for QList
 #include <QString>    // for QString
 #include <QVector>    // for QVector
 #include <QtGlobal>   // for qint64
 
 #include "defs.h"     // for arglist_t, route_head (ptr only), ARG_NOMINMAX, ARGTYPE_FLOAT, ARGTYPE_REQUIRED, ARGTYPE_BOOL, Waypoint, WaypointList (ptr only)
 #include "filter.h"   // for Filter
-#include "grtcirc.h"  // for RAD, gcdist, radtometers
+#include "grtcirc.h"  // for RAD, gcdist, gcdist_meters_within, radtometers
 
 
 #if FILTERS_ENABLED
@@ -58,6 +59,8 @@ private:
   /* Member Functions */
 
   void position_runqueue(const WaypointList& waypt_list, int qtype);
+  bool position_gridqueue(QList<WptRecord>& qlist) const;
+  bool position_close(const WptRecord& a, const WptRecord& b) const;
 
   /* Data Members */
 
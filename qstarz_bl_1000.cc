@@ -26,12 +26,13 @@
 #include "qstarz_bl_1000.h"
 
 #include <cmath>               // for round
+#include <QByteArray>          // for QByteArray
 #include <QChar>               // for QChar
-#include <QDataStream>         // for QDataStream, QDataStream::SinglePrecision, QDataStream::DoublePrecision, QDataStream::LittleEndian, QDataStream::Ok
 #include <QDebug>              // for QDebug
 #include <QFile>               // for QFile
 #include <QIODevice>           // for QIODevice, QIODevice::ReadOnly
 #include "defs.h"
+#include "src/core/fixedrecord.h"  // for RecordField
 #include "src/core/logging.h"  // for Fatal
 
 
@@ -65,78 +66,72 @@ inline bool qstarz_bl_1000_is_trackpoint_type(BL1000_POINT_TYPE type)
          );
 }
 
+/* The fields of the 64 byte log entry. */
+namespace bl1000
+{
+using gpsbabel::RecordField;
+using FixStatus = RecordField<quint8, 0>;
+using Rcr = RecordField<qint8, 1>;
+using Milliseconds = RecordField<quint16, 2>;
+using Latitude = RecordField<double, 4>;
+using Longitude = RecordField<double, 12>;
+using Time = RecordField<quint32, 20>;
+using Speed = RecordField<float, 24>;
+using Altitude = RecordField<float, 28>;
+using Heading = RecordField<float, 32>;
+using Gx = RecordField<qint16, 36>;
+using Gy = RecordField<qint16, 38>;
+using Gz = RecordField<qint16, 40>;
+using MaxSNR = RecordField<quint16, 42>;
+using Hdop = RecordField<float, 44>;
+using Vdop = RecordField<float, 48>;
+using SatelliteCountView = RecordField<qint8, 52>;
+using SatelliteCountUsed = RecordField<qint8, 53>;
+using FixQuality = RecordField<quint8, 54>;
+using BatteryPercent = RecordField<quint8, 55>;
+// 56-63 unused
+} // namespace bl1000
+
 void
-QstarzBL1000Format::qstarz_bl_1000_read(QDataStream& stream)
+QstarzBL1000Format::qstarz_bl_1000_read(const QByteArray& data)
 {
+  const Records records(data);
+  if (records.has_remainder()) {
+    fatal(FatalMsg() << MYNAME << ": File format error on " << fname << ". Perhaps this isn't a Qstarz BL-1000 file");
+  }
+
   auto* track_route = new route_head;
 
   track_add_head(track_route);
 
-  while (!stream.atEnd()) {
-    qstarz_bl_1000_read_record(stream, track_route);
+  track_reserve_wpts(track_route, records.count());
+  for (qsizetype i = 0; i < records.count(); ++i) {
+    qstarz_bl_1000_read_record(records, i, track_route);
   }
 }
 
 void
-QstarzBL1000Format::qstarz_bl_1000_read_record(QDataStream& stream, route_head* track_route)
+QstarzBL1000Format::qstarz_bl_1000_read_record(const Records& records, qsizetype i, route_head* track_route)
 {
-  // Value fields in 64-byte log entry
-  quint8                fixStatus;                // 0
-  qint8                 rcr;                      // 1
-  quint16               milliseconds;             // 2-3
-  double                dLatitude;                // 4-11
-  double                dLongitude;               // 12-19
-  quint32               time;                     // 20-23
-  float                 speed;                    // 24-27
-  float                 altitude;                 // 28-31
-  float                 heading;                  // 32-35
-  qint16                gx;                       // 36-37
-  qint16                gy;                       // 38-39
-  qint16                gz;                       // 40-41
-  quint16               maxSNR;                   // 42-43
-  float                 hdop;                     // 44-47
-  float                 vdop;                     // 48-51
-  qint8                 satelliteCountView;       // 52
-  qint8                 satelliteCountUsed;       // 53
-  quint8                fixQuality;               // 54
-  quint8              	batteryPercent;           // 55
-  quint32               unused1;                  // 56-59
-  quint32               unused2;                  // 60-64
-
-  stream >> fixStatus;
-  stream >> rcr;
-  stream >> milliseconds;
-
-  stream.setFloatingPointPrecision(QDataStream::DoublePrecision);
-  stream >> dLatitude;
-  stream >> dLongitude;
-
-  stream >> time;
-
-  stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
-  stream >> speed;
-  stream >> altitude;
-  stream >> heading;
-
-  stream >> gx;
-  stream >> gy;
-  stream >> gz;
-  stream >> maxSNR;
-
-  stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
-  stream >> hdop;
-  stream >> vdop;
-
-  stream >> satelliteCountView;
-  stream >> satelliteCountUsed;
-  stream >> fixQuality;
-  stream >> batteryPercent;
-  stream >> unused1;
-  stream >> unused2;
-
-  if (stream.status() != QDataStream::Ok) {
-    fatal(FatalMsg() << MYNAME << ": File format error on " << fname << ". Perhaps this isn't a Qstarz BL-1000 file");
-  }
+  const quint8 fixStatus = records.get<bl1000::FixStatus>(i);
+  const qint8 rcr = records.get<bl1000::Rcr>(i);
+  const quint16 milliseconds = records.get<bl1000::Milliseconds>(i);
+  const double dLatitude = records.get<bl1000::Latitude>(i);
+  const double dLongitude = records.get<bl1000::Longitude>(i);
+  const quint32 time = records.get<bl1000::Time>(i);
+  const float speed = records.get<bl1000::Speed>(i);
+  const float altitude = records.get<bl1000::Altitude>(i);
+  const float heading = records.get<bl1000::Heading>(i);
+  const qint16 gx = records.get<bl1000::Gx>(i);
+  const qint16 gy = records.get<bl1000::Gy>(i);
+  const qint16 gz = records.get<bl1000::Gz>(i);
+  const quint16 maxSNR = records.get<bl1000::MaxSNR>(i);
+  const float hdop = records.get<bl1000::Hdop>(i);
+  const float vdop = records.get<bl1000::Vdop>(i);
+  const qint8 satelliteCountView = records.get<bl1000::SatelliteCountView>(i);
+  const qint8 satelliteCountUsed = records.get<bl1000::SatelliteCountUsed>(i);
+  const quint8 fixQuality = records.get<bl1000::FixQuality>(i);
+  const quint8 batteryPercent = records.get<bl1000::BatteryPercent>(i);
 
   BL1000_POINT_TYPE type;
 
@@ -276,11 +271,8 @@ QstarzBL1000Format::read()
     fatal(FatalMsg() << MYNAME << ": Error opening file " << fname);
   }
 
-  QDataStream stream(&file);
-
-  stream.setByteOrder(QDataStream::LittleEndian);
-
-  qstarz_bl_1000_read(stream);
-
+  const QByteArray data = file.readAll();
   file.close();
+
+  qstarz_bl_1000_read(data);
 }
@@ -26,14 +26,15 @@
 #ifndef QSTARZ_BL1000_H_INCLUDED_
 #define QSTARZ_BL1000_H_INCLUDED_
 
-#include <QDataStream>         // for QDataStream
+#include <QByteArray>          // for QByteArray
 #include <QString>             // for QString
 #include <QVector>             // for QVector
-#include <QtGlobal>            // for qint8, quint16, quint8
+#include <QtGlobal>            // for qint8, quint16, quint8, qsizetype
 
 #include "defs.h"              // for ff_cap, ff_cap_read, ff_cap_none, ff_type, ff_type_file, route_head
 #include "format.h"            // for Format
 #include "formspec.h"          // for FormatSpecificData, kFsQstarzBl1000
+#include "src/core/fixedrecord.h"  // for FixedRecords
 
 struct qstarz_bl_1000_fsdata : FormatSpecificData {
   qstarz_bl_1000_fsdata() : FormatSpecificData(kFsQstarzBl1000) {}
@@ -43,6 +44,8 @@ struct qstarz_bl_1000_fsdata : FormatSpecificData {
     return new qstarz_bl_1000_fsdata(*this);
   }
 
+  std::size_t memory_usage() const override {return sizeof(*this);}
+
   char rcr{}; // record reason. possible values are listed in switch-case in .cc file
   float accelerationX{}; // horizonal acceleration value measured in acceleration due to gravity or g
   float accelerationY{}; // vertical acceleration value measured in acceleration due to gravity or g
@@ -73,7 +76,9 @@ public:
 
   void rd_init(const QString& fname) override {}
   void read() override;
-  void qstarz_bl_1000_read(QDataStream& stream);
-  void qstarz_bl_1000_read_record(QDataStream& stream, route_head* track_route);
+  using Records = gpsbabel::FixedRecords<64>;
+
+  void qstarz_bl_1000_read(const QByteArray& data);
+  void qstarz_bl_1000_read_record(const Records& records, qsizetype i, route_head* track_route);
 };
 #endif
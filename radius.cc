@@ -21,40 +21,91 @@
 
 #include "radius.h"
 
+#include <algorithm>        // for max, partial_sort, stable_sort
 #include <cstdlib>          // for strtod
 #include <utility>          // for as_const
+#include <vector>           // for vector
 
+#include <QList>            // for QList
 #include <QString>          // for QString
-#include <QtGlobal>         // QAddConst<>::Type, foreach
+#include <QVector>          // for QVector
+#include <QtGlobal>         // for qsizetype
 
 #include "defs.h"           // for Waypoint, del_marked_wpts, route_add_head, route_add_wpt, waypt_add, waypt_sort, waypt_swap, xstrtoi, route_head, WaypointList, kMilesPerKilometer
+#include "src/core/scheduler.h"  // for parallel_for
 
 
 #if FILTERS_ENABLED
 
 void RadiusFilter::process()
 {
-  foreach (Waypoint* waypointp, *global_waypoint_list) {
-    double dist = radtomiles(gcdist(waypointp->position(),
-                                    home_pos->position()));
+  QList<Waypoint*> wpts;
+  wpts.reserve(global_waypoint_list->count());
+  for (Waypoint* waypointp : std::as_const(*global_waypoint_list)) {
+    wpts.append(waypointp);
+  }
+  const qsizetype nelems = wpts.size();
+
+  /* The distances don't depend on each other, so they may be measured side by side. */
+  std::vector<double> distances(nelems);
+  QVector<double> latitudes;
+  QVector<double> longitudes;
+  latitudes.reserve(nelems);
+  longitudes.reserve(nelems);
+  for (const Waypoint* wpt : std::as_const(wpts)) {
+    latitudes.append(wpt->latitude);
+    longitudes.append(wpt->longitude);
+  }
+  const PositionRad home = home_pos->position();
+  auto measure = [home, &latitudes, &longitudes, &distances](qsizetype begin, qsizetype end)->void {
+    gcdist_to(latitudes.constData() + begin, longitudes.constData() + begin, end - begin,
+              home, distances.data() + begin);
+    for (qsizetype i = begin; i < end; ++i) {
+      distances[i] = radtomiles(distances[i]);
+    }
+  };
+  const int threads = (opt_threads != nullptr) ? xstrtoi(opt_threads, nullptr, 10) : 1;
+  if ((threads > 1) && (nelems >= kParallelMin)) {
+    gpsbabel::parallel_for(nelems, (nelems + threads - 1) / threads, measure);
+  } else {
+    measure(0, nelems);
+  }
 
-    if ((dist >= pos_dist) == (exclopt == nullptr)) {
-      waypointp->wpt_flags.marked_for_deletion = 1;
+  std::vector<Ranked> ranked;
+  for (qsizetype i = 0; i < nelems; ++i) {
+    if ((distances[i] >= pos_dist) == (exclopt == nullptr)) {
+      wpts.at(i)->wpt_flags.marked_for_deletion = 1;
     } else {
-      auto* ed = new extra_data;
-      ed->distance = dist;
-      waypointp->extra_data = ed;
+      ranked.push_back({distances[i], static_cast<qsizetype>(ranked.size()), wpts.at(i)});
     }
   }
   del_marked_wpts();
 
+  /*
+   * Ties keep their input order, as a stable sort would.  Only the
+   * nearest maxct points are kept, so only those need to be ordered.
+   */
+  auto keep = static_cast<qsizetype>(ranked.size());
+  if ((maxctarg != nullptr) && (maxct < keep)) {
+    keep = std::max(maxct, 0);
+  }
   if (nosort == nullptr) {
-    auto dist_comp_lambda = [](const Waypoint* a, const Waypoint* b)->bool {
-      const auto* aed = static_cast<const extra_data*>(a->extra_data);
-      const auto* bed = static_cast<const extra_data*>(b->extra_data);
-      return aed->distance < bed->distance;
+    auto dist_comp_lambda = [](const Ranked& a, const Ranked& b)->bool {
+      if (a.distance < b.distance) {
+        return true;
+      }
+      if (b.distance < a.distance) {
+        return false;
+      }
+      return a.order < b.order;
     };
-    waypt_sort(dist_comp_lambda);
+    if (keep < static_cast<qsizetype>(ranked.size())) {
+      std::partial_sort(ranked.begin(), ranked.begin() + keep, ranked.end(), dist_comp_lambda);
+    } else {
+      std::stable_sort(ranked.begin(), ranked.end(), [](const Ranked& a, const Ranked& b)->bool {
+        return a.distance < b.distance;
+      });
+    }
   }
 
   route_head* rte_head = nullptr;
@@ -65,20 +116,17 @@ void RadiusFilter::process()
   }
 
   /*
-   * Create an list of remaining waypoints.
-   * Delete them, add them to the global waypoint list, or add them
+   * Take the remaining waypoints off the global list.
+   * Delete them, add them back to the global waypoint list, or add them
    * to a new route.
    */
 
   WaypointList comp;
   waypt_swap(comp);
 
-  int i = 0;
-  for (Waypoint* wp : std::as_const(comp)) {
-    delete static_cast<extra_data*>(wp->extra_data);
-    wp->extra_data = nullptr;
-
-    if ((maxctarg != nullptr) && (i >= maxct)) {
+  for (qsizetype i = 0; i < static_cast<qsizetype>(ranked.size()); ++i) {
+    Waypoint* wp = ranked[i].wpt;
+    if (i >= keep) {
       delete wp;
     } else {
       if (routename != nullptr) {
@@ -87,7 +135,6 @@ void RadiusFilter::process()
         waypt_add(wp);
       }
     }
-    ++i;
   }
 }
 
@@ -24,10 +24,11 @@
 
 #include <QString>    // for QString
 #include <QVector>    // for QVector
+#include <QtGlobal>   // for qsizetype
 
 #include "defs.h"     // for arglist_t, ARG_NOMINMAX, ARGTYPE_FLOAT, ARGTYPE_REQUIRED, ARGTYPE_BOOL, ARGTYPE_INT, ARGTYPE_STRING, Waypoint
 #include "filter.h"   // for Filter
-#include "grtcirc.h"  // for RAD, gcdist, radtomiles
+#include "grtcirc.h"  // for RAD, gcdist, gcdist_to, radtomiles
 
 #if FILTERS_ENABLED
 
@@ -45,10 +46,18 @@ public:
 private:
   /* Types */
 
-  struct extra_data {
+  /* A waypoint in the circle, with its place in the input. */
+  struct Ranked {
     double distance;
+    qsizetype order;
+    Waypoint* wpt;
   };
 
+  /* Constants */
+
+  /* Fewer waypoints than this aren't worth starting threads for. */
+  static constexpr qsizetype kParallelMin = 64 * 1024;
+
   /* Member Functions */
 
   /* Data Members */
@@ -61,6 +70,7 @@ private:
   char* nosort = nullptr;
   char* maxctarg = nullptr;
   char* routename = nullptr;
+  char* opt_threads = nullptr;
   int maxct{};
 
   Waypoint* home_pos{};
@@ -94,6 +104,10 @@ private:
       "asroute", &routename,"Put resulting waypoints in route of this name",
       nullptr, ARGTYPE_STRING, nullptr, nullptr, nullptr
     },
+    {
+      "threads", &opt_threads, "Measure large waypoint lists on this many threads",
+      nullptr, ARGTYPE_INT, "1", nullptr, nullptr
+    },
   };
 
 };
@@ -22,7 +22,6 @@
 #include "resample.h"
 
 #include <cmath>                // for round
-#include <optional>             // for optional
 #include <tuple>                // for tuple, tuple_element<>::type
 #include <utility>              // for as_const
 
@@ -30,7 +29,8 @@
 #include <QList>                // for QList<>::const_iterator
 #include <QString>              // for QString
 #include <QTextStream>          // for qSetRealNumberPrecision
-#include <QtGlobal>             // for qDebug, qint64
+#include <QVector>              // for QVector
+#include <QtGlobal>             // for qDebug, qint64, qsizetype
 
 #include "defs.h"               // for Waypoint, route_head, fatal, WaypointList, track_add_wpt, track_disp_all, RouteList, track_add_head, track_del_wpt, track_swap, UrlList, gb_color, global_options, global_opts
 #include "src/core/datetime.h"  // for DateTime
@@ -43,21 +43,21 @@
 #define MYNAME "resample"
 
 
-void ResampleFilter::average_waypoint(Waypoint* wpt, bool zero_stuffed)
+/*
+ * Run one sample through the running average.  The position is given as
+ * an n-vector so zero stuffed samples can pass a zero vector, and the
+ * result replaces latitude, longitude and altitude.
+ */
+void ResampleFilter::average_sample(const gpsbabel::NVector& current_position,
+                                    double& latitude, double& longitude, double& altitude,
+                                    bool zero_stuffed)
 {
   // We filter in the n-vector coordinate system.
   // This removes difficulties at the discontinuity at longitude = +/- 180 degrees,
   // as well as at the singularities at the poles.
   // Our filter is from Gade, 5.3.6. Horizontal geographical mean, equation 17.
-  gpsbabel::NVector current_position;
-  if (wpt->extra_data) { // zero stuffing?
-    current_position = gpsbabel::Vector3D(0.0, 0.0, 0.0);
-    wpt->extra_data = nullptr;
-  } else {
-    current_position = gpsbabel::NVector(wpt->latitude, wpt->longitude);
-  }
-  int current_altitude_valid_count = wpt->altitude != unknown_alt? 1 : 0;
-  double current_altitude =  wpt->altitude != unknown_alt? wpt->altitude : 0.0;
+  int current_altitude_valid_count = altitude != unknown_alt? 1 : 0;
+  double current_altitude =  altitude != unknown_alt? altitude : 0.0;
   auto current = std::tuple(current_position, current_altitude_valid_count, current_altitude);
 
   if (history.isEmpty()) {
@@ -116,65 +116,138 @@ void ResampleFilter::average_waypoint(Waypoint* wpt, bool zero_stuffed)
   }
 
   gpsbabel::NVector normalized_position = accumulated_position / accumulated_position.norm();
-  wpt->latitude = normalized_position.latitude();
-  wpt->longitude = normalized_position.longitude();
+  latitude = normalized_position.latitude();
+  longitude = normalized_position.longitude();
   if (accumulated_altitude_valid_count == average_count) {
-    wpt->altitude = accumulated_altitude * filter_gain;
+    altitude = accumulated_altitude * filter_gain;
   } else {
-    wpt->altitude = unknown_alt;
+    altitude = unknown_alt;
   }
 
   counter = (counter + 1) % average_count;
 }
 
-void ResampleFilter::interpolate_rte(route_head* rte)
+void ResampleFilter::average_waypoint(Waypoint* wpt)
 {
+  average_sample(gpsbabel::NVector(wpt->latitude, wpt->longitude),
+                 wpt->latitude, wpt->longitude, wpt->altitude, false);
+}
+
+/*
+ * Interpolate, average and, when asked to, decimate one track in a single
+ * polyphase pass.
+ *
+ * The upsampled track has interpolate_count samples per input interval,
+ * all but the first of them zero stuffed.  Only the averaged positions of
+ * those samples are kept while filtering, and Waypoints are created just
+ * for the samples that survive decimation.  The results are the same as
+ * zero stuffing the track, averaging it and deleting every sample whose
+ * index is not a multiple of decimate_count.
+ */
+void ResampleFilter::resample_rte(route_head* rte)
+{
+  // Positions that normalizing leaves alone keep their cached n-vector.
+  QVector<gpsbabel::NVector> position = rte->nvectors();
+
   // Steal all the wpts
   WaypointList wptlist;
   track_swap_wpts(rte, wptlist);
+  if (wptlist.empty()) {
+    return;
+  }
+  const QVector<Waypoint*> input(wptlist.cbegin(), wptlist.cend());
+
+  for (qsizetype j = 0; j < input.size(); ++j) {
+    Waypoint* wpt = input.at(j);
+    double latitude = wpt->latitude;
+    double longitude = wpt->longitude;
+    wpt->NormalizePosition();
+    if ((wpt->latitude != latitude) || (wpt->longitude != longitude)) {
+      position[j] = gpsbabel::NVector(wpt->latitude, wpt->longitude);
+    }
+  }
 
-  // And add them back, with zero stuffed points interspersed.
-  bool first = true;
-  const Waypoint* prevwpt;
-  foreach (Waypoint* wpt, wptlist) {
-    if (first) {
-      first = false;
-    } else {
-      std::optional<qint64> timespan;
-      if (prevwpt->creation_time.isValid() && wpt->creation_time.isValid()) {
-        timespan = wpt->creation_time.toMSecsSinceEpoch() -
-                   prevwpt->creation_time.toMSecsSinceEpoch();
+  const qsizetype samples = (input.size() - 1) * interpolate_count + 1;
+  QVector<double> latitude(samples);
+  QVector<double> longitude(samples);
+  QVector<double> altitude(samples);
+
+  // Filter in the forward direction
+  history.clear();
+  for (qsizetype k = 0; k < samples; ++k) {
+    gpsbabel::NVector current_position;
+    if (k % interpolate_count == 0) {
+      const Waypoint* wpt = input.at(k / interpolate_count);
+      current_position = position.at(k / interpolate_count);
+      altitude[k] = wpt->altitude;
+    } else { // zero stuffing
+      current_position = gpsbabel::Vector3D(0.0, 0.0, 0.0);
+      altitude[k] = 0.0;
+    }
+    average_sample(current_position, latitude[k], longitude[k], altitude[k], true);
+  }
+
+  // Filter in the reverse direction
+  if (global_opts.debug_level >= 5) {
+    qDebug() << "Backward pass";
+  }
+  history.clear();
+  for (qsizetype k = samples - 1; k >= 0; --k) {
+    average_sample(gpsbabel::NVector(latitude.at(k), longitude.at(k)),
+                   latitude[k], longitude[k], altitude[k], false);
+  }
+
+  // Add back the samples that survive decimation.  A deleted point that
+  // began a segment passes that on to the next point kept.
+  const int keep_every = decimateopt ? decimate_count : 1;
+  bool inherit_new_trkseg = false;
+  for (qsizetype k = 0; k < samples; ++k) {
+    const qsizetype j = k / interpolate_count;
+    const int n = k % interpolate_count;
+    Waypoint* wpt = input.at(j);
+    if (k % keep_every != 0) {
+      if ((n == 0) && wpt->wpt_flags.new_trkseg) {
+        inherit_new_trkseg = true;
       }
+      continue;
+    }
 
-      // Insert the required points
-      for (int n = 0; n < interpolate_count - 1; ++n) {
-        double frac = static_cast<double>(n + 1) /
+    if (n != 0) {
+      // We create the inserted point from the Waypoint at the
+      // beginning of the span.  We clear some fields but use a
+      // copy of the rest or the interpolated value.
+      const Waypoint* prevwpt = wpt;
+      const Waypoint* nextwpt = input.at(j + 1);
+      wpt = new Waypoint(*prevwpt);
+      wpt->wpt_flags.new_trkseg = 0;
+      wpt->shortname = QString();
+      wpt->description = QString();
+      if (prevwpt->creation_time.isValid() && nextwpt->creation_time.isValid()) {
+        qint64 timespan = nextwpt->creation_time.toMSecsSinceEpoch() -
+                          prevwpt->creation_time.toMSecsSinceEpoch();
+        double frac = static_cast<double>(n) /
                       static_cast<double>(interpolate_count);
-        // We create the inserted point from the Waypoint at the
-        // beginning of the span.  We clear some fields but use a
-        // copy of the rest or the interpolated value.
-        auto* wpt_new = new Waypoint(*prevwpt);
-        wpt_new->wpt_flags.new_trkseg = 0;
-        wpt_new->shortname = QString();
-        wpt_new->description = QString();
-        if (timespan.has_value()) {
-          wpt_new->SetCreationTime(0, prevwpt->creation_time.toMSecsSinceEpoch() +
-                                   round(frac * *timespan));
-        } else {
-          wpt_new->creation_time = gpsbabel::DateTime();
-        }
-        // zero stuff
-        wpt_new->latitude = 0.0;
-        wpt_new->longitude = 0.0;
-        wpt_new->altitude = 0.0;
-        wpt_new->extra_data = &wpt_zero_stuffed;
-        track_add_wpt(rte, wpt_new);
+        wpt->SetCreationTime(0, prevwpt->creation_time.toMSecsSinceEpoch() +
+                             round(frac * timespan));
+      } else {
+        wpt->creation_time = gpsbabel::DateTime();
       }
     }
-    wpt->extra_data = nullptr;
+    if (inherit_new_trkseg) {
+      wpt->wpt_flags.new_trkseg = 1;
+      inherit_new_trkseg = false;
+    }
     track_add_wpt(rte, wpt);
+    wpt->latitude = latitude.at(k);
+    wpt->longitude = longitude.at(k);
+    wpt->altitude = altitude.at(k);
+  }
 
-    prevwpt = wpt;
+  // The dropped input points were still needed to create the points after them.
+  for (qsizetype j = 0; j < input.size(); ++j) {
+    if ((j * interpolate_count) % keep_every != 0) {
+      delete input.at(j);
+    }
   }
 }
 
@@ -197,10 +270,11 @@ void ResampleFilter::process()
       fatal(FatalMsg() << MYNAME ": Found no tracks to operate on.");
     }
 
-    auto interpolate_rte_lambda = [this](const route_head* rte)->void {
-      interpolate_rte(const_cast<route_head*>(rte));
+    auto resample_rte_lambda = [this](const route_head* rte)->void {
+      resample_rte(const_cast<route_head*>(rte));
     };
-    track_disp_all(interpolate_rte_lambda, nullptr, nullptr);
+    track_disp_all(resample_rte_lambda, nullptr, nullptr);
+    return;
   }
 
   if (averageopt) {
@@ -209,7 +283,7 @@ void ResampleFilter::process()
       history.clear();
       for (auto it = rte->waypoint_list.cbegin(); it != rte->waypoint_list.cend(); ++it)
       {
-        average_waypoint(*it, interpolateopt);
+        average_waypoint(*it);
       }
 
       // Filter in the reverse direction
@@ -220,7 +294,7 @@ void ResampleFilter::process()
       history.clear();
       for (auto it = rte->waypoint_list.crbegin(); it != rte->waypoint_list.crend(); ++it)
       {
-        average_waypoint(*it, false);
+        average_waypoint(*it);
       }
     };
 
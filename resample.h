@@ -49,8 +49,11 @@ private:
 
   /* Member Functions */
 
-  void average_waypoint(Waypoint* wpt, bool zero_stuffed);
-  void interpolate_rte(route_head* rte);
+  void average_sample(const gpsbabel::NVector& current_position,
+                      double& latitude, double& longitude, double& altitude,
+                      bool zero_stuffed);
+  void average_waypoint(Waypoint* wpt);
+  void resample_rte(route_head* rte);
   void decimate_rte(const route_head* rte);
 
   /* Data Members */
@@ -60,7 +63,6 @@ private:
   int accumulated_altitude_valid_count{0};
   double accumulated_altitude{0.0};
   double filter_gain{0.0};
-  int wpt_zero_stuffed{};
 
   int counter{0};
   int average_count{0};
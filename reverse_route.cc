@@ -30,34 +30,25 @@
 #define MYNAME "Route reversal filter"
 
 /*
- * reverse_route_wpt fixes up the waypoint flag new_trkseg
+ * In a reversed track a segment starts at the point that ended one, so
+ * the new_trkseg flags move down by one.
  */
-void ReverseRouteFilter::reverse_route_wpt(const Waypoint* waypointp)
+void ReverseRouteFilter::process_route(route_head* rte, bool is_track)
 {
-
-  /* Cast away const-ness */
-  auto* wpp = const_cast<Waypoint*>(waypointp);
-
-  int curr_new_trkseg = waypointp->wpt_flags.new_trkseg;
-  wpp->wpt_flags.new_trkseg = prev_new_trkseg;
-  prev_new_trkseg = curr_new_trkseg;
-}
-
-void ReverseRouteFilter::reverse_route_head(const route_head* rte_hd)
-{
-  /* Cast away const-ness */
-  auto* rh = const_cast<route_head*>(rte_hd);
-  std::reverse(rh->waypoint_list.begin(), rh->waypoint_list.end());
-  prev_new_trkseg = 1;
+  std::reverse(rte->waypoint_list.begin(), rte->waypoint_list.end());
+  if (is_track) {
+    int prev_new_trkseg = 1;
+    for (Waypoint* wpt : rte->waypoint_list) {
+      int curr_new_trkseg = wpt->wpt_flags.new_trkseg;
+      wpt->wpt_flags.new_trkseg = prev_new_trkseg;
+      prev_new_trkseg = curr_new_trkseg;
+    }
+  }
 }
 
 void ReverseRouteFilter::process()
 {
-  WayptFunctor<ReverseRouteFilter> reverse_route_wpt_f(this, &ReverseRouteFilter::reverse_route_wpt);
-  RteHdFunctor<ReverseRouteFilter> reverse_route_head_f(this, &ReverseRouteFilter::reverse_route_head);
-
-  track_disp_all(reverse_route_head_f, nullptr, reverse_route_wpt_f);
-  route_disp_all(reverse_route_head_f, nullptr, nullptr);
+  process_routes();
 }
 
 void ReverseRouteFilter::init()
@@ -37,15 +37,12 @@ public:
   }
   void init() override;
   void process() override;
+  void process_route(route_head* rte, bool is_track) override;
 
 private:
-  int prev_new_trkseg{};
   QVector<arglist_t> args = {
   };
 
-  void reverse_route_wpt(const Waypoint* waypointp);
-  void reverse_route_head(const route_head* rte);
-
 };
 #endif
 #endif // REVERSE_ROUTE_H_INCLUDED_
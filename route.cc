@@ -17,27 +17,46 @@
 
  */
 
+#include <algorithm>            // for max, min
 #include <cassert>              // for assert
-#include <cstddef>              // for nullptr_t
+#include <cmath>                // for isnan, nanf
+#include <cstddef>              // for nullptr_t, size_t
+#include <limits>               // for numeric_limits
+#include <memory>               // for make_unique
 #include <optional>             // for optional, operator>, operator<
-#include <utility>              // for as_const
+#include <utility>              // for move
 
 #include <QDateTime>            // for operator>, QDateTime, operator<
 #include <QList>                // for QList<>::const_iterator
 #include <QString>              // for QString
 #include <QStringLiteral>       // for qMakeStringPrivate, QStringLiteral
 #include <QStringView>          // for QStringView
-#include <QtGlobal>             // for QForeachContainer, qMakeForeachContainer, foreach
+#include <QVector>              // for QVector
+#include <QtGlobal>             // for QForeachContainer, qMakeForeachContainer, foreach, qint64, qsizetype, quint8
 
 #include "defs.h"
 #include "formspec.h"           // for FormatSpecificDataList
-#include "grtcirc.h"            // for RAD, gcdist, heading_true_degrees, radtometers
+#include "grtcirc.h"            // for RAD, gcdist, gcdist_along, heading_true_degrees_along, radtometers
 #include "session.h"            // for curr_session, session_t (ptr only)
+#include "src/core/budget.h"    // for Budget
+#include "src/core/counters.h"  // for Counter
 #include "src/core/datetime.h"  // for DateTime
+#include "src/core/footprint.h" // for heap_bytes
+#include "src/core/nvector.h"   // for NVector
+#include "src/core/objectpool.h" // for ObjectPool
+#include "src/core/packedtrack.h" // for PackedTrack
+#include "src/core/progress.h"  // for Progress
+#include "src/core/timeindex.h" // for TimeIndex
+#include "src/core/trace.h"     // for TraceSpan
 
 
-RouteList* global_route_list;
-RouteList* global_track_list;
+// Thread local so that readers on worker threads can be given their own lists.
+thread_local RouteList* global_route_list;
+thread_local RouteList* global_track_list;
+// The track the last streamed point was added to.
+static const route_head* streamed_track = nullptr;
+
+static gpsbabel::Counter deleted_counter("route.deleted_points");
 
 void
 route_init()
@@ -88,6 +107,7 @@ void
 track_add_head(route_head* rte)
 {
   global_track_list->add_head(rte);
+  streamed_track = nullptr;
 }
 
 void
@@ -111,13 +131,61 @@ route_add_wpt(route_head* rte, Waypoint* wpt, QStringView namepart, int number_d
   if (rte->waypoint_list.empty()) {
     wpt->wpt_flags.new_trkseg = 1;
   }
+  gpsbabel::Progress::points();
+  gpsbabel::Budget::check();
 
   global_route_list->add_wpt(rte, wpt, true, namepart, number_digits);
 }
 
+void
+route_reserve_heads(qsizetype count)
+{
+  global_route_list->reserve_more(count);
+}
+
+void
+track_reserve_heads(qsizetype count)
+{
+  global_track_list->reserve_more(count);
+}
+
+void
+route_reserve_wpts(route_head* rte, qsizetype count)
+{
+  rte->waypoint_list.reserve_more(count);
+}
+
+void
+track_reserve_wpts(route_head* rte, qsizetype count)
+{
+  // Streamed track points never stay in the track.
+  if (waypt_sink() == nullptr) {
+    rte->waypoint_list.reserve_more(count);
+  }
+}
+
 void
 track_add_wpt(route_head* rte, Waypoint* wpt, QStringView namepart, int number_digits)
 {
+  gpsbabel::Progress::points();
+  gpsbabel::Budget::check();
+
+  // When streaming the track stays empty, so the first point is the
+  // first one streamed to it.  The others keep the reader's segment flag.
+  if (PointSink* sink = waypt_sink(); sink != nullptr) {
+    if (!(global_opts.masked_objective & TRKDATAMASK)) {
+      delete wpt;
+      return;
+    }
+    if (rte != streamed_track) {
+      wpt->wpt_flags.new_trkseg = 1;
+      streamed_track = rte;
+    }
+    wpt->NormalizePosition();
+    sink->consume(wpt);
+    return;
+  }
+
   // First point in a track is always a new segment.
   // This improves compatibility when reading from
   // segment-unaware formats.
@@ -142,6 +210,18 @@ track_del_wpt(route_head* rte, Waypoint* wpt)
   global_track_list->del_wpt(rte, wpt);
 }
 
+WaypointList::iterator
+route_del_wpt(route_head* rte, WaypointList::iterator it)
+{
+  return global_route_list->del_wpt(rte, it);
+}
+
+WaypointList::iterator
+track_del_wpt(route_head* rte, WaypointList::iterator it)
+{
+  return global_track_list->del_wpt(rte, it);
+}
+
 void
 route_del_marked_wpts(route_head* rte)
 {
@@ -196,6 +276,36 @@ route_flush_all_tracks()
   global_track_list->flush();
 }
 
+void
+route_use_lists(RouteList* routes, RouteList* tracks)
+{
+  global_route_list = routes;
+  global_track_list = tracks;
+}
+
+void
+route_invalidate_caches()
+{
+  global_route_list->invalidate_caches();
+  global_track_list->invalidate_caches();
+}
+
+void
+track_pack_all()
+{
+  for (route_head* rte : *global_track_list) {
+    rte->pack_points();
+  }
+}
+
+void
+track_unpack_all()
+{
+  for (route_head* rte : *global_track_list) {
+    rte->unpack_points();
+  }
+}
+
 void
 route_deinit()
 {
@@ -235,6 +345,12 @@ route_swap(RouteList& other)
   global_route_list->swap(other);
 }
 
+void
+route_splice(RouteList* src)
+{
+  global_route_list->splice(*src);
+}
+
 void
 track_backup(RouteList** head_bak)
 {
@@ -253,6 +369,124 @@ track_swap(RouteList& other)
   global_track_list->swap(other);
 }
 
+void
+track_splice(RouteList* src)
+{
+  global_track_list->splice(*src);
+}
+
+/*
+ * The fields of a track's points that its statistics are taken from, as
+ * dense columns.  A speed or a time counts only where has_speed or
+ * has_time is set.
+ */
+struct TrackStatColumns {
+  QVector<double> altitude;
+  QVector<double> speed;
+  QVector<quint8> has_speed;
+  QVector<qint64> time;
+  QVector<quint8> has_time;
+  QVector<quint8> heartrate;
+  QVector<quint8> cadence;
+  QVector<float> power;
+};
+
+/*
+ * The minima, maxima and averages of a track over its columns.  Missing
+ * values are replaced by ones that can't win instead of being skipped,
+ * so every loop is a reduction without branches that the compiler can
+ * vectorize.  Sums of integers are exact, and power is summed in point
+ * order, so the results are those of a plain walk over the points.
+ * The earliest and the latest time are returned in *start and *end,
+ * valid only if the track has a time.
+ */
+static void track_stats(const TrackStatColumns& cols, computed_trkdata* tdata, qint64* start, qint64* end)
+{
+  constexpr double kInf = std::numeric_limits<double>::infinity();
+  const qsizetype n = cols.altitude.size();
+
+  double min_alt = kInf;
+  double max_alt = -kInf;
+  qsizetype alt_ct = 0;
+  for (qsizetype i = 0; i < n; ++i) {
+    const bool known = cols.altitude[i] != unknown_alt;
+    min_alt = std::min(min_alt, known ? cols.altitude[i] : kInf);
+    max_alt = std::max(max_alt, known ? cols.altitude[i] : -kInf);
+    alt_ct += known;
+  }
+  if (alt_ct > 0) {
+    tdata->min_alt = min_alt;
+    tdata->max_alt = max_alt;
+  }
+
+  double min_spd = kInf;
+  double max_spd = -kInf;
+  qsizetype spd_ct = 0;
+  for (qsizetype i = 0; i < n; ++i) {
+    const bool known = cols.has_speed[i] != 0;
+    min_spd = std::min(min_spd, known ? cols.speed[i] : kInf);
+    max_spd = std::max(max_spd, known ? cols.speed[i] : -kInf);
+    spd_ct += known;
+  }
+  if (spd_ct > 0) {
+    tdata->min_spd = min_spd;
+    tdata->max_spd = max_spd;
+  }
+
+  qint64 tot_hrt = 0;
+  qsizetype pts_hrt = 0;
+  int min_hrt = 256;
+  int max_hrt = 0;
+  qint64 tot_cad = 0;
+  qsizetype pts_cad = 0;
+  int max_cad = 0;
+  for (qsizetype i = 0; i < n; ++i) {
+    const int hrt = cols.heartrate[i];
+    tot_hrt += hrt;
+    pts_hrt += hrt > 0;
+    min_hrt = std::min(min_hrt, (hrt > 0) ? hrt : 256);
+    max_hrt = std::max(max_hrt, hrt);
+    const int cad = cols.cadence[i];
+    tot_cad += cad;
+    pts_cad += cad > 0;
+    max_cad = std::max(max_cad, cad);
+  }
+  if (pts_hrt > 0) {
+    tdata->avg_hrt = double(tot_hrt) / pts_hrt;
+    tdata->min_hrt = min_hrt;
+    tdata->max_hrt = max_hrt;
+  }
+  if (pts_cad > 0) {
+    tdata->avg_cad = double(tot_cad) / pts_cad;
+    tdata->max_cad = max_cad;
+  }
+
+  double tot_pwr = 0.0;
+  qsizetype pts_pwr = 0;
+  float max_pwr = -std::numeric_limits<float>::infinity();
+  for (qsizetype i = 0; i < n; ++i) {
+    const float pwr = cols.power[i];
+    const bool known = pwr > 0;
+    tot_pwr += known ? pwr : 0.0;
+    pts_pwr += known;
+    max_pwr = std::max(max_pwr, known ? pwr : -std::numeric_limits<float>::infinity());
+  }
+  if (pts_pwr > 0) {
+    tdata->avg_pwr = tot_pwr / pts_pwr;
+    tdata->max_pwr = max_pwr;
+  }
+
+  qint64 min_time = std::numeric_limits<qint64>::max();
+  qint64 max_time = std::numeric_limits<qint64>::min();
+  for (qsizetype i = 0; i < n; ++i) {
+    const bool known = cols.has_time[i] != 0;
+    min_time = std::min(min_time, known ? cols.time[i] : std::numeric_limits<qint64>::max());
+    max_time = std::max(max_time, known ? cols.time[i] : std::numeric_limits<qint64>::min());
+  }
+  *start = min_time;
+  *end = max_time;
+}
+
 /*
  * This really makes more sense for tracks than routes.
  * Run over all the trackpoints, computing heading (course), speed, and
@@ -260,143 +494,315 @@ track_swap(RouteList& other)
  *
  * return a collection of (hopefully interesting) statistics about the track.
  */
-computed_trkdata track_recompute(const route_head* trk)
+static computed_trkdata track_compute(const route_head* trk)
 {
-  const Waypoint* prev = nullptr;
-  int tkpt = 0;
-  int pts_hrt = 0;
-  double tot_hrt = 0.0;
-  int pts_cad = 0;
-  double tot_cad = 0.0;
-  int pts_pwr = 0;
-  double tot_pwr = 0.0;
   computed_trkdata tdata;
 
-  foreach (Waypoint* thisw, trk->waypoint_list) {
+  // The fields are gathered in one pass over the points, the legs are
+  // measured in one pass over the positions.
+  const qsizetype n = trk->waypoint_list.count();
+  QVector<double> latitudes;
+  QVector<double> longitudes;
+  TrackStatColumns cols;
+  latitudes.reserve(n);
+  longitudes.reserve(n);
+  cols.altitude.reserve(n);
+  cols.speed.reserve(n);
+  cols.has_speed.reserve(n);
+  cols.time.reserve(n);
+  cols.has_time.reserve(n);
+  cols.heartrate.reserve(n);
+  cols.cadence.reserve(n);
+  cols.power.reserve(n);
+  bool need_course = false;
+  bool has_time = false;
+  for (const Waypoint* wpt : trk->waypoint_list) {
+    latitudes.append(wpt->latitude);
+    longitudes.append(wpt->longitude);
+    if ((latitudes.size() > 1) && !wpt->course_has_value()) {
+      need_course = true;
+    }
+    cols.altitude.append(wpt->altitude);
+    cols.speed.append(wpt->speed_value_or(0));
+    cols.has_speed.append(wpt->speed_has_value());
+    const gpsbabel::DateTime time = wpt->GetCreationTime();
+    const bool valid = time.isValid();
+    cols.time.append(valid ? time.toMSecsSinceEpoch() : 0);
+    cols.has_time.append(valid);
+    has_time = has_time || valid;
+    cols.heartrate.append(wpt->heartrate);
+    cols.cadence.append(wpt->cadence);
+    cols.power.append(wpt->power);
+  }
+  QVector<double> legs(std::max<qsizetype>(n - 1, 0));
+  gcdist_along(latitudes.constData(), longitudes.constData(), n, legs.data());
+  QVector<double> courses;
+  if (need_course) {
+    courses.resize(legs.size());
+    heading_true_degrees_along(latitudes.constData(), longitudes.constData(), n, courses.data());
+  }
 
-    if (prev != nullptr) {
-      /*
-       * gcdist and heading want radians, not degrees.
-       */
+  // What is filled in on the points themselves goes in point order.
+  qsizetype i = 0;
+  for (Waypoint* thisw : trk->waypoint_list) {
+    if (i > 0) {
       if (!thisw->course_has_value()) {
         // Only recompute course if the waypoint
         // didn't already have a course.
-        thisw->set_course(heading_true_degrees(prev->position(), thisw->position()));
+        thisw->set_course(courses.at(i - 1));
       }
-      double dist = radtometers(gcdist(prev->position(), thisw->position()));
+      double dist = radtometers(legs.at(i - 1));
       tdata.distance_meters += dist;
 
       /*
        * If we've moved as much as a meter,
        * conditionally recompute speeds.
        */
-      if (!thisw->speed_has_value() && (dist > 1)) {
+      if (!cols.has_speed.at(i) && (dist > 1)) {
         // Only recompute speed if the waypoint
         // didn't already have a speed
-        if (thisw->GetCreationTime().isValid() &&
-            prev->GetCreationTime().isValid() &&
-            thisw->GetCreationTime() > prev->GetCreationTime()) {
-          double timed =
-            prev->GetCreationTime().msecsTo(thisw->GetCreationTime()) / 1000.0;
+        if (cols.has_time.at(i) && cols.has_time.at(i - 1) &&
+            (cols.time.at(i) > cols.time.at(i - 1))) {
+          double timed = (cols.time.at(i) - cols.time.at(i - 1)) / 1000.0;
           thisw->set_speed(dist / timed);
+          cols.speed[i] = thisw->speed_value();
+          cols.has_speed[i] = 1;
         }
       }
     }
 
-    if (thisw->speed_has_value()) {
-      if ((!tdata.min_spd) || (thisw->speed_value() < tdata.min_spd)) {
-        tdata.min_spd = thisw->speed_value();
-      }
-      if ((!tdata.max_spd) || (thisw->speed_value() > tdata.max_spd)) {
-        tdata.max_spd = thisw->speed_value();
-      }
+    if (thisw->shortname.isEmpty()) {
+      thisw->shortname = QStringLiteral("%1-%2").arg(trk->rte_name).arg(i);
     }
+    ++i;
+  }
 
-    if (thisw->altitude != unknown_alt) {
-      if ((!tdata.min_alt) || (thisw->altitude < tdata.min_alt)) {
-        tdata.min_alt = thisw->altitude;
+  qint64 start;
+  qint64 end;
+  track_stats(cols, &tdata, &start, &end);
+
+  // The first points with the earliest and the latest time give them,
+  // as a walk comparing the points' times would have.
+  if (has_time) {
+    auto it = trk->waypoint_list.cbegin();
+    bool found_start = false;
+    bool found_end = false;
+    for (qsizetype j = 0; (j < n) && !(found_start && found_end); ++j, ++it) {
+      if (!cols.has_time.at(j)) {
+        continue;
+      }
+      if (!found_start && (cols.time.at(j) == start)) {
+        tdata.start = (*it)->GetCreationTime();
+        found_start = true;
       }
-      if ((!tdata.max_alt) || (thisw->altitude > tdata.max_alt)) {
-        tdata.max_alt = thisw->altitude;
+      if (!found_end && (cols.time.at(j) == end)) {
+        tdata.end = (*it)->GetCreationTime();
+        found_end = true;
       }
     }
+  }
 
-    if (thisw->heartrate > 0) {
-      pts_hrt++;
-      tot_hrt += thisw->heartrate;
-    }
+  return tdata;
+}
 
-    if (thisw->heartrate > 0) {
-      if ((!tdata.min_hrt) || (thisw->heartrate < tdata.min_hrt)) {
-        tdata.min_hrt = thisw->heartrate;
-      }
-      if ((!tdata.max_hrt) || (thisw->heartrate > tdata.max_hrt)) {
-        tdata.max_hrt = thisw->heartrate;
-      }
-    }
+// The statistics are cached on the track until its points change.
+computed_trkdata track_recompute(const route_head* trk)
+{
+  return trk->trkdata();
+}
 
-    if (thisw->cadence > 0) {
-      pts_cad++;
-      tot_cad += thisw->cadence;
-    }
+route_head::route_head() :
+  rte_num(0),
+  // line_color(),
+  line_width(-1),
+  session(curr_session())
+{
+}
 
-    if ((thisw->cadence > 0) && ((!tdata.max_cad) || (thisw->cadence > tdata.max_cad))) {
-      tdata.max_cad = thisw->cadence;
-    }
+route_head::~route_head()
+{
+  waypoint_list.flush();
+  fs.FsChainDestroy();
+}
 
-    if (thisw->power > 0) {
-      pts_pwr++;
-      tot_pwr += thisw->power;
-    }
+std::size_t
+route_head::memory_usage() const
+{
+  return sizeof(*this) + waypoint_list.capacity() * sizeof(Waypoint*) +
+         gpsbabel::heap_bytes(rte_name) + gpsbabel::heap_bytes(rte_desc) +
+         url_list_heap_bytes(rte_urls) + fs.memory_usage() +
+         (packed_ ? packed_->memory_usage() : 0);
+}
 
-    if ((thisw->power > 0) && ((!tdata.max_pwr) || (thisw->power > tdata.max_pwr))) {
-      tdata.max_pwr = thisw->power;
+void
+route_head::pack_points()
+{
+  if (packed_ || waypoint_list.empty()) {
+    return;
+  }
+  auto packed = std::make_unique<gpsbabel::PackedTrack>(waypoint_list.front()->session);
+  for (const Waypoint* wpt : waypoint_list) {
+    if (!packed->append(wpt)) {
+      return;
     }
+  }
+  packed->squeeze();
+  packed_ct_ = waypoint_list.count();
+  packed_ = std::move(packed);
+  waypoint_list.flush();
+  WaypointList none;
+  waypoint_list.swap(none);  // and give back its storage
+  invalidate_cache();
+}
 
-    if (thisw->GetCreationTime().isValid()) {
-      if (!tdata.start.isValid() || (thisw->GetCreationTime() < tdata.start)) {
-        tdata.start = thisw->GetCreationTime();
-      }
+void
+route_head::unpack_points()
+{
+  if (!packed_) {
+    return;
+  }
+  waypoint_list.reserve(packed_ct_);
+  gpsbabel::PackedTrack::Cursor cursor(*packed_);
+  gpsbabel::PackedTrack::Point point;
+  while (cursor.next(&point)) {
+    waypoint_list.add_rte_waypt(0, packed_->waypoint(point), false, {}, 0);
+  }
+  packed_.reset();
+  packed_ct_ = 0;
+  invalidate_cache();
+}
 
-      if (!tdata.end.isValid() || (thisw->GetCreationTime() > tdata.end)) {
-        tdata.end = thisw->GetCreationTime();
-      }
-    }
+void*
+route_head::operator new(std::size_t size)
+{
+  return pool().allocate(size);
+}
 
-    if (thisw->shortname.isEmpty()) {
-      thisw->shortname = QStringLiteral("%1-%2").arg(trk->rte_name).arg(tkpt);
+void
+route_head::operator delete(void* ptr, std::size_t size) noexcept
+{
+  pool().deallocate(ptr, size);
+}
+
+gpsbabel::ObjectPool&
+route_head::pool()
+{
+  static gpsbabel::ObjectPool route_head_pool(sizeof(route_head), 256);
+  return route_head_pool;
+}
+
+const TrackColumns&
+route_head::columns() const
+{
+  if (columns_ == nullptr) {
+    auto cols = std::make_unique<TrackColumns>();
+    const int n = waypoint_list.count();
+    cols->latitude.reserve(n);
+    cols->longitude.reserve(n);
+    cols->altitude.reserve(n);
+    cols->time.reserve(n);
+    cols->speed.reserve(n);
+    for (const Waypoint* wpt : waypoint_list) {
+      cols->latitude.append(wpt->latitude);
+      cols->longitude.append(wpt->longitude);
+      cols->altitude.append(wpt->altitude);
+      cols->time.append(wpt->GetCreationTime().isValid()? wpt->GetCreationTime().toMSecsSinceEpoch() : 0);
+      cols->speed.append(wpt->speed_value_or(std::nanf("")));
     }
-    tkpt++;
-    prev = thisw;
+    columns_ = std::move(cols);
   }
+  return *columns_;
+}
 
-  if (pts_hrt > 0) {
-    tdata.avg_hrt = tot_hrt / pts_hrt;
+const gpsbabel::TimeIndex&
+route_head::time_index() const
+{
+  if (time_index_ == nullptr) {
+    auto index = std::make_unique<gpsbabel::TimeIndex>();
+    const int n = waypoint_list.count();
+    index->reserve(n);
+    int i = 0;
+    for (const Waypoint* wpt : waypoint_list) {
+      if (wpt->GetCreationTime().isValid()) {
+        index->append(wpt->GetCreationTime().toMSecsSinceEpoch(), i);
+      }
+      ++i;
+    }
+    index->finish(n);
+    time_index_ = std::move(index);
   }
+  return *time_index_;
+}
 
-  if (pts_cad > 0) {
-    tdata.avg_cad = tot_cad / pts_cad;
+const QVector<gpsbabel::NVector>&
+route_head::nvectors() const
+{
+  if (nvectors_ == nullptr) {
+    const TrackColumns& cols = columns();
+    nvectors_ = std::make_unique<QVector<gpsbabel::NVector>>(
+                  gpsbabel::NVector::from_degrees(cols.latitude, cols.longitude));
   }
+  return *nvectors_;
+}
 
-  if (pts_pwr > 0) {
-    tdata.avg_pwr = tot_pwr / pts_pwr;
+const route_extent&
+route_head::extent() const
+{
+  if (extent_ == nullptr) {
+    auto ext = std::make_unique<route_extent>();
+    waypt_init_bounds(&ext->bbox);
+    for (const Waypoint* wpt : waypoint_list) {
+      waypt_add_to_bounds(&ext->bbox, wpt);
+      const gpsbabel::DateTime& t = wpt->GetCreationTime();
+      if (t.isValid()) {
+        if ((ext->earliest == nullptr) || (t < ext->earliest->GetCreationTime())) {
+          ext->earliest = wpt;
+        }
+        if ((ext->latest == nullptr) || (t > ext->latest->GetCreationTime())) {
+          ext->latest = wpt;
+        }
+      }
+    }
+    extent_ = std::move(ext);
   }
-
-  return tdata;
+  return *extent_;
 }
 
-route_head::route_head() :
-  rte_num(0),
-  // line_color(),
-  line_width(-1),
-  session(curr_session())
+const computed_trkdata&
+route_head::trkdata() const
 {
+  if (trkdata_ == nullptr) {
+    trkdata_ = std::make_unique<computed_trkdata>(track_compute(this));
+  }
+  return *trkdata_;
 }
 
-route_head::~route_head()
+void
+route_head::store_columns(const TrackColumns& cols)
 {
-  waypoint_list.flush();
-  fs.FsChainDestroy();
+  assert(cols.size() == waypoint_list.count());
+  int i = 0;
+  for (Waypoint* wpt : waypoint_list) {
+    wpt->latitude = cols.latitude.at(i);
+    wpt->longitude = cols.longitude.at(i);
+    wpt->altitude = cols.altitude.at(i);
+    if (cols.time.at(i) != 0) {
+      wpt->SetCreationTime(0, cols.time.at(i));
+    }
+    if (std::isnan(cols.speed.at(i))) {
+      wpt->reset_speed();
+    } else {
+      wpt->set_speed(cols.speed.at(i));
+    }
+    ++i;
+  }
+  if (&cols != columns_.get()) {
+    columns_.reset();
+  }
+  time_index_.reset();
+  nvectors_.reset();
+  extent_.reset();
+  trkdata_.reset();
 }
 
 int RouteList::waypt_count() const
@@ -414,6 +820,14 @@ RouteList::add_head(route_head* rte)
   this->append(rte);
 }
 
+void
+RouteList::reserve_more(qsizetype count)
+{
+  if (count > 0) {
+    reserve(size() + std::min(count, kCapacityHintLimit));
+  }
+}
+
 void
 RouteList::del_head(route_head* rte)
 {
@@ -441,6 +855,7 @@ RouteList::add_wpt(route_head* rte, Waypoint* wpt, bool synth, QStringView namep
 {
   ++waypt_ct;
   rte->waypoint_list.add_rte_waypt(waypt_ct, wpt, synth, namepart, number_digits);
+  rte->invalidate_cache();
 }
 
 void
@@ -448,31 +863,27 @@ RouteList::del_wpt(route_head* rte, Waypoint* wpt)
 {
   rte->waypoint_list.del_rte_waypt(wpt);
   --waypt_ct;
+  rte->invalidate_cache();
+}
+
+WaypointList::iterator
+RouteList::del_wpt(route_head* rte, WaypointList::iterator it)
+{
+  auto next = rte->waypoint_list.del_rte_waypt(it);
+  --waypt_ct;
+  rte->invalidate_cache();
+  return next;
 }
 
 void
 RouteList::del_marked_wpts(route_head* rte)
 {
-  // For lineary complexity build a new list from the points we keep.
-  WaypointList oldlist;
-  swap_wpts(rte, oldlist);
-
-  // mimic trkseg handling from WaypointList::del_rte_waypt
-  bool inherit_new_trkseg = false;
-  for (Waypoint* wpt : std::as_const(oldlist)) {
-    if (wpt->wpt_flags.marked_for_deletion) {
-      if (wpt->wpt_flags.new_trkseg) {
-        inherit_new_trkseg = true;
-      }
-      delete wpt;
-    } else {
-      if (inherit_new_trkseg) {
-        wpt->wpt_flags.new_trkseg = 1;
-        inherit_new_trkseg = false;
-      }
-      add_wpt(rte, wpt, false, u"RPT", 3);
-    }
-  }
+  gpsbabel::TraceSpan span("routes", QStringLiteral("del_marked_wpts"), rte->rte_name);
+  const int before = waypt_ct;
+  del_wpts_if(rte, [](const Waypoint* wpt)->bool {
+    return wpt->wpt_flags.marked_for_deletion;
+  });
+  deleted_counter.add(before - waypt_ct);
 }
 
 void
@@ -520,6 +931,7 @@ RouteList::copy(RouteList** dst) const
     rte_new->session = rte_old->session;
     (*dst)->add_head(rte_new);
     const auto& old_list = rte_old->waypoint_list;
+    rte_new->waypoint_list.reserve(old_list.count());
     for (const auto& old_wpt : old_list) {
       (*dst)->add_wpt(rte_new, new Waypoint(*old_wpt), false, u"RPT", 3);
     }
@@ -546,9 +958,28 @@ void RouteList::swap(RouteList& other)
   other = tmp_list;
 }
 
+void RouteList::splice(RouteList& src)
+{
+  if (&src == this) {
+    return;
+  }
+  append(src);
+  src.clear();
+  waypt_ct += src.waypt_ct;
+  src.waypt_ct = 0;
+}
+
 void RouteList::swap_wpts(route_head* rte, WaypointList& other)
 {
   this->waypt_ct -= rte->rte_waypt_ct();
   this->waypt_ct += other.count();
   rte->waypoint_list.swap(other);
+  rte->invalidate_cache();
+}
+
+void RouteList::invalidate_caches() const
+{
+  for (const route_head* rte : *this) {
+    rte->invalidate_cache();
+  }
 }
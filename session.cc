@@ -22,9 +22,16 @@
 #include "defs.h"
 #include "session.h"
 
-#include <QList>         // for QList
+#include <deque>         // for deque
 
-static QList<session_t> session_list;
+// Waypoints keep pointers to their session, so the sessions must never move.
+static std::deque<session_t> session_list;
+// A reader running on a worker thread uses the session it was given.
+static thread_local const session_t* thread_session = nullptr;
+
+extern thread_local WaypointList* global_waypoint_list;
+extern thread_local RouteList* global_route_list;
+extern thread_local RouteList* global_track_list;
 
 void
 session_init()
@@ -38,21 +45,48 @@ session_exit()
   session_list.clear();
 }
 
-void
+const session_t*
 start_session(const QString& name, const QString& filename)
 {
-  session_list.append(session_t(name, filename));
+  session_list.emplace_back(name, filename);
+  return &session_list.back();
+}
+
+void
+use_session(const session_t* session)
+{
+  thread_session = session;
 }
 
 const session_t*
 curr_session()
 {
-  if (!session_list.isEmpty()) {
-    return &session_list.last();
+  if (thread_session != nullptr) {
+    return thread_session;
+  }
+  if (!session_list.empty()) {
+    return &session_list.back();
   } else {
     fatal("Attempt to fetch session outside of session range.");
   }
 }
 
+ThreadScope::ThreadScope() :
+  session_(thread_session),
+  waypoints_(global_waypoint_list),
+  routes_(global_route_list),
+  tracks_(global_track_list),
+  throws_(fatal_throws())
+{
+}
+
+ThreadScope::~ThreadScope()
+{
+  fatal_set_throws(throws_);
+  route_use_lists(routes_, tracks_);
+  waypt_use_list(waypoints_);
+  thread_session = session_;
+}
+
 /* non public functions */
 
@@ -37,7 +37,36 @@ public:
 void session_init();
 void session_exit();
 
-void start_session(const QString& name, const QString& filename);
+const session_t* start_session(const QString& name, const QString& filename);
+// Make curr_session() on this thread return session, or restore the
+// default of the most recently started session if session is nullptr.
+void use_session(const session_t* session);
 const session_t* curr_session();
 
+class WaypointList;
+class RouteList;
+
+/*
+ * Puts back the session, the waypoint, route and track lists and
+ * whether fatal() throws of the thread that created it when it goes out
+ * of scope.  Tasks that point their thread at data of their own create
+ * one first, as the scheduler may run them on any thread, including one
+ * that is waiting in the middle of other work.
+ */
+class ThreadScope
+{
+public:
+  ThreadScope();
+  ~ThreadScope();
+  ThreadScope(const ThreadScope&) = delete;
+  ThreadScope& operator=(const ThreadScope&) = delete;
+
+private:
+  const session_t* session_;
+  WaypointList* waypoints_;
+  RouteList* routes_;
+  RouteList* tracks_;
+  bool throws_;
+};
+
 #endif  // SESSION_H_INCLUDED_
@@ -21,14 +21,18 @@
  */
 
 #include <cassert>               // for assert
+#include <cstdio>                // for SEEK_CUR, SEEK_END, EOF
+#include <cstring>               // for memcpy, strchr
 
 #include <QByteArray>            // for QByteArray
+#include <QFile>                 // for QFile
+#include <QIODevice>             // for QIODevice, QIODevice::ReadOnly, QIODevice::ReadWrite, QIODevice::Truncate
 #include <QLatin1String>         // for QLatin1String
 #include <QString>               // for QString, Qt::SkipEmptyParts
 #include <QStringList>           // for QStringList
 #include <QVector>               // for QVector
 #include <Qt>                    // for CaseInsensitive
-#include <QtGlobal>              // for qPrintable
+#include <QtGlobal>              // for qPrintable, qint64, qBound, qMax
 
 #include "defs.h"
 #include "shape.h"
@@ -42,6 +46,183 @@
 
 #define MYNAME "shape"
 
+/************************************************************************/
+/*                     Mapped and buffered file hooks                   */
+/*                                                                      */
+/*      Files opened read only are mapped into memory, so reading a     */
+/*      record is a memcpy.  Files opened for writing collect           */
+/*      consecutive writes in a large buffer, which is written out      */
+/*      when a write or read lands somewhere else, when it is full,     */
+/*      and on flush and close.  Shapelib writes records one after      */
+/*      the other and the headers only when the file is closed, so      */
+/*      this turns most of its small writes into a few big ones.        */
+/************************************************************************/
+
+struct ShapeFormat::HookFile {
+  QFile file;
+  const uchar* map{nullptr};
+  qint64 map_size{0};
+  qint64 pos{0};
+  QByteArray wbuf;
+  qint64 wbuf_start{0};
+};
+
+#ifdef SHPAPI_UTF8_HOOKS
+#define SHAPE_DECODE_NAME(name) QString::fromUtf8(name)
+#else
+#define SHAPE_DECODE_NAME(name) QFile::decodeName(name)
+#endif
+
+SAFile
+ShapeFormat::HookFOpen(const char* filename, const char* access, void* /* pvUserData */)
+{
+  auto* hf = new HookFile;
+  hf->file.setFileName(SHAPE_DECODE_NAME(filename));
+
+  QIODevice::OpenMode mode;
+  if (strchr(access, 'w') != nullptr) {
+    mode = QIODevice::ReadWrite | QIODevice::Truncate;
+  } else if (strchr(access, '+') != nullptr) {
+    mode = QIODevice::ReadWrite;
+  } else {
+    mode = QIODevice::ReadOnly;
+  }
+  if (!hf->file.open(mode)) {
+    delete hf;
+    return nullptr;
+  }
+
+  if (mode == QIODevice::ReadOnly) {
+    hf->map_size = hf->file.size();
+    if (hf->map_size > 0) {
+      hf->map = hf->file.map(0, hf->map_size);
+    }
+  } else {
+    hf->wbuf.reserve(kHookBufferSize);
+  }
+  return reinterpret_cast<SAFile>(hf);
+}
+
+bool
+ShapeFormat::HookFlushBuffer(HookFile* hf)
+{
+  if (hf->wbuf.isEmpty()) {
+    return true;
+  }
+  bool ok = hf->file.seek(hf->wbuf_start) &&
+            (hf->file.write(hf->wbuf) == hf->wbuf.size());
+  hf->wbuf.clear();
+  return ok;
+}
+
+SAOffset
+ShapeFormat::HookFRead(void* p, SAOffset size, SAOffset nmemb, SAFile file)
+{
+  auto* hf = reinterpret_cast<HookFile*>(file);
+  if (size == 0) {
+    return 0;
+  }
+  qint64 want = static_cast<qint64>(size * nmemb);
+  qint64 got;
+  if (hf->map != nullptr) {
+    got = qBound(qint64(0), hf->map_size - hf->pos, want);
+    memcpy(p, hf->map + hf->pos, got);
+  } else {
+    if (!HookFlushBuffer(hf) || !hf->file.seek(hf->pos)) {
+      return 0;
+    }
+    got = qMax(qint64(0), hf->file.read(static_cast<char*>(p), want));
+  }
+  hf->pos += got;
+  return got / size;
+}
+
+SAOffset
+ShapeFormat::HookFWrite(const void* p, SAOffset size, SAOffset nmemb, SAFile file)
+{
+  auto* hf = reinterpret_cast<HookFile*>(file);
+  if (hf->map != nullptr) {
+    return 0;
+  }
+  qint64 len = static_cast<qint64>(size * nmemb);
+  if (hf->wbuf.isEmpty() || (hf->pos != hf->wbuf_start + hf->wbuf.size())) {
+    if (!HookFlushBuffer(hf)) {
+      return 0;
+    }
+    hf->wbuf_start = hf->pos;
+  }
+  hf->wbuf.append(static_cast<const char*>(p), len);
+  hf->pos += len;
+  if ((hf->wbuf.size() >= kHookBufferSize) && !HookFlushBuffer(hf)) {
+    return 0;
+  }
+  return nmemb;
+}
+
+SAOffset
+ShapeFormat::HookFSeek(SAFile file, SAOffset offset, int whence)
+{
+  auto* hf = reinterpret_cast<HookFile*>(file);
+  qint64 base = 0;
+  if (whence == SEEK_CUR) {
+    base = hf->pos;
+  } else if (whence == SEEK_END) {
+    base = (hf->map != nullptr) ? hf->map_size :
+           qMax(hf->file.size(), hf->wbuf_start + hf->wbuf.size());
+  }
+  hf->pos = base + static_cast<qint64>(offset);
+  return 0;
+}
+
+SAOffset
+ShapeFormat::HookFTell(SAFile file)
+{
+  return reinterpret_cast<HookFile*>(file)->pos;
+}
+
+int
+ShapeFormat::HookFFlush(SAFile file)
+{
+  auto* hf = reinterpret_cast<HookFile*>(file);
+  return (HookFlushBuffer(hf) && hf->file.flush()) ? 0 : EOF;
+}
+
+int
+ShapeFormat::HookFClose(SAFile file)
+{
+  auto* hf = reinterpret_cast<HookFile*>(file);
+  bool ok = HookFlushBuffer(hf);
+  if (hf->map != nullptr) {
+    hf->file.unmap(const_cast<uchar*>(hf->map));
+  }
+  hf->file.close();
+  delete hf;
+  return ok ? 0 : EOF;
+}
+
+void
+ShapeFormat::SetupGpsbabelHooks(SAHooks* psHooks)
+{
+#ifdef SHPAPI_UTF8_HOOKS
+  SASetupUtf8Hooks(psHooks);
+#else
+  SASetupDefaultHooks(psHooks);
+#endif
+  psHooks->FOpen = HookFOpen;
+  psHooks->FRead = HookFRead;
+  psHooks->FWrite = HookFWrite;
+  psHooks->FSeek = HookFSeek;
+  psHooks->FTell = HookFTell;
+  psHooks->FFlush = HookFFlush;
+  psHooks->FClose = HookFClose;
+}
+
+#ifdef SHPAPI_UTF8_HOOKS
+#define SHAPE_ENCODE_NAME(name) (name).toUtf8().constData()
+#else
+#define SHAPE_ENCODE_NAME(name) qPrintable(name)
+#endif
+
 /************************************************************************/
 /*                              SHPOpenGpsbabel()                       */
 /************************************************************************/
@@ -52,13 +233,8 @@ ShapeFormat::SHPOpenGpsbabel(const QString& pszLayer, const char* pszAccess)
 {
   SAHooks sHooks;
 
-#ifdef SHPAPI_UTF8_HOOKS
-  SASetupUtf8Hooks(&sHooks);
-  return SHPOpenLL(pszLayer.toUtf8().constData(), pszAccess, &sHooks);
-#else
-  SASetupDefaultHooks(&sHooks);
-  return SHPOpenLL(qPrintable(pszLayer), pszAccess, &sHooks);
-#endif
+  SetupGpsbabelHooks(&sHooks);
+  return SHPOpenLL(SHAPE_ENCODE_NAME(pszLayer), pszAccess, &sHooks);
 
 }
 
@@ -75,13 +251,8 @@ ShapeFormat::SHPCreateGpsbabel(const QString& pszLayer, int nShapeType)
 {
   SAHooks sHooks;
 
-#ifdef SHPAPI_UTF8_HOOKS
-  SASetupUtf8Hooks(&sHooks);
-  return SHPCreateLL(pszLayer.toUtf8().constData(), nShapeType, &sHooks);
-#else
-  SASetupDefaultHooks(&sHooks);
-  return SHPCreateLL(qPrintable(pszLayer), nShapeType, &sHooks);
-#endif
+  SetupGpsbabelHooks(&sHooks);
+  return SHPCreateLL(SHAPE_ENCODE_NAME(pszLayer), nShapeType, &sHooks);
 
 }
 
@@ -97,13 +268,8 @@ ShapeFormat::DBFOpenGpsbabel(const QString& pszFilename, const char* pszAccess)
 {
   SAHooks sHooks;
 
-#ifdef SHPAPI_UTF8_HOOKS
-  SASetupUtf8Hooks(&sHooks);
-  return DBFOpenLL(pszFilename.toUtf8().constData(), pszAccess, &sHooks);
-#else
-  SASetupDefaultHooks(&sHooks);
-  return DBFOpenLL(qPrintable(pszFilename), pszAccess, &sHooks);
-#endif
+  SetupGpsbabelHooks(&sHooks);
+  return DBFOpenLL(SHAPE_ENCODE_NAME(pszFilename), pszAccess, &sHooks);
 
 }
 
@@ -119,13 +285,8 @@ ShapeFormat::DBFCreateExGpsbabel(const QString& pszFilename, const char* pszCode
 {
   SAHooks sHooks;
 
-#ifdef SHPAPI_UTF8_HOOKS
-  SASetupUtf8Hooks(&sHooks);
-  return DBFCreateLL(pszFilename.toUtf8().constData(), pszCodePage, &sHooks);
-#else
-  SASetupDefaultHooks(&sHooks);
-  return DBFCreateLL(qPrintable(pszFilename), pszCodePage, &sHooks);
-#endif
+  SetupGpsbabelHooks(&sHooks);
+  return DBFCreateLL(SHAPE_ENCODE_NAME(pszFilename), pszCodePage, &sHooks);
 
 }
 
@@ -24,6 +24,7 @@
 
 #include <QString>              // for QString
 #include <QVector>              // for QVector
+#include <QtGlobal>             // for qsizetype
 
 #include "defs.h"               // for arglist_t, ARGTYPE_STRING, Waypoint, route_head, FF_CAP_RW_ALL, ff_cap, ff_type, ff_type_file
 #include "format.h"             // for Format
@@ -31,7 +32,7 @@
 #if HAVE_LIBSHAPE
 #  include <shapefil.h>
 #else
-#  include "shapelib/shapefil.h"  // for DBFHandle, SHPAPI_CALL, SHPHandle
+#  include "shapelib/shapefil.h"  // for DBFHandle, SHPAPI_CALL, SHPHandle, SAFile, SAHooks, SAOffset
 #endif
 
 
@@ -61,6 +62,25 @@ public:
   void wr_deinit() override;
 
 private:
+  /* Constants */
+
+  static constexpr qsizetype kHookBufferSize = 1024 * 1024;
+
+  /* Types */
+
+  struct HookFile;
+
+  /* Member Functions */
+
+  static SAFile HookFOpen(const char* filename, const char* access, void* pvUserData);
+  static bool HookFlushBuffer(HookFile* hf);
+  static SAOffset HookFRead(void* p, SAOffset size, SAOffset nmemb, SAFile file);
+  static SAOffset HookFWrite(const void* p, SAOffset size, SAOffset nmemb, SAFile file);
+  static SAOffset HookFSeek(SAFile file, SAOffset offset, int whence);
+  static SAOffset HookFTell(SAFile file);
+  static int HookFFlush(SAFile file);
+  static int HookFClose(SAFile file);
+  static void SetupGpsbabelHooks(SAHooks* psHooks);
   static SHPHandle SHPAPI_CALL SHPOpenGpsbabel(const QString& pszLayer, const char* pszAccess);
   static SHPHandle SHPAPI_CALL SHPCreateGpsbabel(const QString& pszLayer, int nShapeType);
   static DBFHandle SHPAPI_CALL DBFOpenGpsbabel(const QString& pszFilename, const char* pszAccess);
@@ -73,6 +93,8 @@ private:
   void poly_point(const Waypoint* wpt);
   void poly_deinit(const route_head* rte);
 
+  /* Data Members */
+
   SHPHandle ihandle{};
   DBFHandle ihandledb{};
   SHPHandle ohandle{};
@@ -0,0 +1,275 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include "shard.h"
+
+#include <algorithm>          // for clamp
+#include <cmath>              // for asinh, floor, isfinite, tan
+#include <functional>         // for function
+#include <numbers>            // for pi
+#include <utility>            // for as_const
+
+#include <QDate>              // for QDate
+#include <QFileInfo>          // for QFileInfo
+#include <QHash>              // for QHash
+#include <QString>            // for QString
+#include <QVector>            // for QVector
+#include <QtGlobal>           // for qint64, qsizetype
+
+#include "defs.h"             // for Waypoint, route_head, fatal, route_range, track_range, waypt_range, WaypointList, RouteList
+#include "session.h"          // for session_t
+
+bool
+Sharder::set_key(const QString& spec)
+{
+  zoom_ = 0;
+  if (spec.isEmpty()) {
+    key_ = Key::none;
+  } else if (spec == u"day") {
+    key_ = Key::day;
+  } else if (spec == u"hour") {
+    key_ = Key::hour;
+  } else if (spec.startsWith(u"tile=")) {
+    bool ok;
+    zoom_ = spec.mid(5).toInt(&ok);
+    if (!ok || (zoom_ < 0) || (zoom_ > 30)) {
+      return false;
+    }
+    key_ = Key::tile;
+  } else if (spec == u"session") {
+    key_ = Key::session;
+  } else if (spec == u"track") {
+    key_ = Key::track;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+QString
+Sharder::shard_fname(const QString& ofname, const QString& key)
+{
+  QString safe = key;
+  for (QChar& c : safe) {
+    if ((c == '/') || (c == '\\') || (c == ':') || (c.unicode() < 0x20)) {
+      c = '_';
+    }
+  }
+  if (ofname.contains(u"%s")) {
+    return QString(ofname).replace(QStringLiteral("%s"), safe);
+  }
+  const QFileInfo info(ofname);
+  const QString suffix = info.suffix();
+  QString base = ofname;
+  if (!suffix.isEmpty()) {
+    base.chop(suffix.size() + 1);
+  }
+  return base + '-' + safe + (suffix.isEmpty() ? QString() : '.' + suffix);
+}
+
+QString
+Sharder::key_of(const Waypoint* wpt, const route_head* rte, KeyCache& cache)
+{
+  qint64 bucket = 0;
+  const void* owner = nullptr;
+  switch (key_) {
+  case Key::day:
+  case Key::hour: {
+    if (!wpt->creation_time.isValid()) {
+      return QStringLiteral("notime");
+    }
+    const qint64 length = (key_ == Key::day) ? 86400000 : 3600000;
+    const qint64 msecs = wpt->creation_time.toMSecsSinceEpoch();
+    bucket = (msecs >= 0) ? (msecs / length) : -((-msecs + length - 1) / length);
+    break;
+  }
+  case Key::tile: {
+    if (!std::isfinite(wpt->latitude) || !std::isfinite(wpt->longitude)) {
+      return QStringLiteral("nowhere");
+    }
+    const qint64 n = qint64(1) << zoom_;
+    const double lat = std::clamp(wpt->latitude, -85.0511287798, 85.0511287798) * std::numbers::pi / 180.0;
+    const auto x = std::clamp<qint64>(std::floor((wpt->longitude + 180.0) / 360.0 * n), 0, n - 1);
+    const auto y = std::clamp<qint64>(std::floor((1.0 - std::asinh(std::tan(lat)) / std::numbers::pi) / 2.0 * n), 0, n - 1);
+    bucket = x * n + y;
+    break;
+  }
+  case Key::session:
+    owner = (rte != nullptr) ? rte->session : wpt->session;
+    break;
+  case Key::track:
+    owner = rte;
+    break;
+  case Key::none:
+    break;
+  }
+  if (!cache.key.isNull() && (cache.bucket == bucket) && (cache.owner == owner)) {
+    return cache.key;
+  }
+
+  QString key;
+  switch (key_) {
+  case Key::day:
+    key = QDate::fromJulianDay(bucket + 2440588).toString(Qt::ISODate);
+    break;
+  case Key::hour: {
+    const qint64 day = (bucket >= 0) ? (bucket / 24) : -((-bucket + 23) / 24);
+    key = QDate::fromJulianDay(day + 2440588).toString(Qt::ISODate) +
+          QStringLiteral("-%1").arg(bucket - day * 24, 2, 10, QLatin1Char('0'));
+    break;
+  }
+  case Key::tile: {
+    const qint64 n = qint64(1) << zoom_;
+    key = QStringLiteral("%1-%2-%3").arg(zoom_).arg(bucket / n).arg(bucket % n);
+    break;
+  }
+  case Key::session: {
+    const auto* session = static_cast<const session_t*>(owner);
+    key = (session != nullptr) ? QFileInfo(session->filename).completeBaseName() : QString();
+    if (key.isEmpty()) {
+      key = QStringLiteral("session");
+    }
+    break;
+  }
+  case Key::track:
+    key = (rte == nullptr) ? QStringLiteral("waypoints") :
+          rte->rte_name.isEmpty() ? QStringLiteral("unnamed") : rte->rte_name;
+    break;
+  case Key::none:
+    break;
+  }
+  cache = {bucket, owner, key};
+  return key;
+}
+
+void
+Sharder::write(const QString& ofname, const std::function<void(const QString&)>& write)
+{
+  extern thread_local RouteList* global_route_list;
+  extern thread_local RouteList* global_track_list;
+
+  /* A run of points of one route or track with the same key. */
+  struct Piece {
+    const route_head* rte;
+    QVector<const Waypoint*> points;
+  };
+
+  struct Shard {
+    QString key;
+    QVector<const Waypoint*> waypoints;
+    QVector<Piece> routes;
+    QVector<Piece> tracks;
+  };
+
+  if (ofname == u"-") {
+    fatal("--shard writes a file per shard, so it can't write to stdout.\n");
+  }
+
+  QVector<Shard> shards;
+  QHash<QString, qsizetype> index;
+  auto shard_of = [&shards, &index](const QString& key)->Shard& {
+    auto it = index.constFind(key);
+    if (it == index.constEnd()) {
+      it = index.insert(key, shards.size());
+      shards.append({key, {}, {}, {}});
+    }
+    return shards[it.value()];
+  };
+
+  KeyCache cache;
+  for (const Waypoint* wpt : waypt_range()) {
+    shard_of(key_of(wpt, nullptr, cache)).waypoints.append(wpt);
+  }
+  auto split = [&](const route_head* rte, QVector<Piece> Shard::* pieces) {
+    QVector<Piece>* current = nullptr;
+    QString current_key;
+    for (const Waypoint* wpt : rte->waypoint_list) {
+      const QString key = key_of(wpt, rte, cache);
+      if ((current == nullptr) || (key != current_key)) {
+        current = &(shard_of(key).*pieces);
+        current->append({rte, {}});
+        current_key = key;
+      }
+      current->last().points.append(wpt);
+    }
+  };
+  for (const route_head* rte : route_range()) {
+    split(rte, &Shard::routes);
+  }
+  for (const route_head* trk : track_range()) {
+    split(trk, &Shard::tracks);
+  }
+
+  WaypointList* const waypoints = global_waypoint_list;
+  RouteList* const routes = global_route_list;
+  RouteList* const tracks = global_track_list;
+  for (const Shard& shard : std::as_const(shards)) {
+    WaypointList shard_waypoints;
+    RouteList shard_routes;
+    RouteList shard_tracks;
+    for (const Waypoint* wpt : shard.waypoints) {
+      shard_waypoints.waypt_add(new Waypoint(*wpt));
+    }
+    auto copy = [](const QVector<Piece>& pieces, RouteList& list) {
+      const route_head* last = nullptr;
+      route_head* head = nullptr;
+      for (const Piece& piece : pieces) {
+        const bool joined = (piece.rte == last);
+        if (!joined) {
+          head = new route_head;
+          head->rte_name = piece.rte->rte_name;
+          head->rte_desc = piece.rte->rte_desc;
+          head->rte_urls = piece.rte->rte_urls;
+          head->rte_num = piece.rte->rte_num;
+          head->fs = piece.rte->fs.FsChainCopy();
+          head->line_color = piece.rte->line_color;
+          head->line_width = piece.rte->line_width;
+          head->session = piece.rte->session;
+          list.add_head(head);
+          last = piece.rte;
+        }
+        for (qsizetype i = 0; i < piece.points.size(); ++i) {
+          auto* wpt = new Waypoint(*piece.points.at(i));
+          if (i == 0) {
+            // Each piece is a segment of its own.
+            wpt->wpt_flags.new_trkseg = 1;
+          }
+          list.add_wpt(head, wpt, false, u"RPT", 3);
+        }
+      }
+    };
+    copy(shard.routes, shard_routes);
+    copy(shard.tracks, shard_tracks);
+
+    waypt_use_list(&shard_waypoints);
+    route_use_lists(&shard_routes, &shard_tracks);
+    try {
+      write(shard_fname(ofname, shard.key));
+    } catch (...) {
+      waypt_use_list(waypoints);
+      route_use_lists(routes, tracks);
+      throw;
+    }
+    waypt_use_list(waypoints);
+    route_use_lists(routes, tracks);
+    shard_waypoints.flush();
+    shard_routes.flush();
+    shard_tracks.flush();
+  }
+}
@@ -0,0 +1,97 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SHARD_H_INCLUDED_
+#define SHARD_H_INCLUDED_
+
+#include <functional>  // for function
+
+#include <QString>     // for QString
+#include <QtGlobal>    // for qint64
+
+#include "defs.h"      // for Waypoint, route_head
+
+/*
+ * --shard splits what a -F output would hold by a key and writes each
+ * part, a shard, to a file of its own.
+ *
+ * The key of a waypoint is that of the point itself.  Routes and tracks
+ * are cut where the key of their points changes, and the pieces with
+ * the same key go to the same shard, a track's pieces as segments of
+ * one track of the same name.  The keys are
+ *   day and hour, of the UTC time, or notime for points without one,
+ *   tile=z, the z-x-y of the Web Mercator tile at zoom z,
+ *   session, the base name of the file the data was read from, and
+ *   track, the name of the route or track, waypoints going to waypoints.
+ *
+ * The data is read once and split in one pass over it.  The shards are
+ * written one after another, each from copies of its points that are
+ * dropped once it is written, so there is one shard file open at a time
+ * and what was read is left as it was for the filters and outputs after.
+ */
+class Sharder
+{
+public:
+  /* Member Functions */
+
+  // False for an unknown key; an empty one turns sharding off.
+  static bool set_key(const QString& spec);
+  static bool enabled()
+  {
+    return key_ != Key::none;
+  }
+
+  // The file of a shard: the key replaces %s in ofname or is appended
+  // to its base name.
+  static QString shard_fname(const QString& ofname, const QString& key);
+
+  // Calls write(fname) for each shard, in the order the keys were first
+  // seen, with the waypoint, route and track lists holding that shard.
+  static void write(const QString& ofname, const std::function<void(const QString&)>& write);
+
+private:
+  /* Types */
+
+  enum class Key {
+    none,
+    day,
+    hour,
+    tile,
+    session,
+    track
+  };
+
+  /* The key last made, so runs of points in one bucket share it. */
+  struct KeyCache {
+    qint64 bucket{};
+    const void* owner{nullptr};
+    QString key;
+  };
+
+  /* Member Functions */
+
+  static QString key_of(const Waypoint* wpt, const route_head* rte, KeyCache& cache);
+
+  /* Data Members */
+
+  static inline Key key_ = Key::none;
+  static inline int zoom_ = 0;
+};
+
+#endif // SHARD_H_INCLUDED_
@@ -30,17 +30,22 @@
 #include <cstdlib>         // for free
 #include <cstring>         // for memset
 #include <numbers>         // for inv_pi, pi
+#include <utility>         // for move
 
 #include <QByteArray>      // for QByteArray
 #include <QChar>           // for QChar
 #include <QLatin1Char>     // for QLatin1Char
+#include <QMutexLocker>    // for QMutexLocker
 #include <QThread>         // for QThread
+#include <QThreadPool>     // for QThreadPool
 #include <QtGlobal>        // for qPrintable
 
 #include "defs.h"
 #include "skytraq.h"
 #include "gbfile.h"        // for gbfclose, gbfopen, gbfread, gbfseek, gbfwrite
 #include "gbser.h"         // for gbser_set_speed, gbser_OK, gbser_deinit
+#include "src/core/logging.h"     // for FatalError
+#include "src/core/objectpool.h"  // for ObjectPool
 
 
 #define MYNAME "skytraq"
@@ -788,6 +793,55 @@ SkytraqBase::process_data_sector(read_state* pst, const uint8_t* buf, int len) c
   return plen;
 }
 
+/*
+ * Decode the blocks queued by skytraq_read_tracks() until it is done or
+ * no more sectors are wanted.  Runs in its own thread.
+ */
+void
+SkytraqBase::decode_sectors(sector_pipe* pipe, read_state* pst) const
+{
+  QMutexLocker lock(&pipe->mutex);
+  for (;;) {
+    while (pipe->blocks.empty() && !pipe->done && !pipe->stop) {
+      pipe->cond.wait(&pipe->mutex);
+    }
+    if (pipe->stop || pipe->blocks.empty()) {
+      return;
+    }
+    auto [first, block] = std::move(pipe->blocks.front());
+    pipe->blocks.pop_front();
+    pipe->busy = true;
+    lock.unlock();
+
+    const auto* buf = reinterpret_cast<const uint8_t*>(block.constData());
+    int got_sectors = block.size() / SECTOR_SIZE;
+    int extra_sectors = 0;
+    bool empty = false;
+    for (int s = 0; s < got_sectors; s++) {
+      db(4, MYNAME ": Decoding sector #%i...\n", first+s);
+      int rc = process_data_sector(pst, buf+s*SECTOR_SIZE, SECTOR_SIZE);
+      /* Only this thread changes sectors_used. */
+      int sectors_used = pipe->sectors_used + extra_sectors;
+      if (rc == 0) {
+        db(1, MYNAME ": Empty sector encountered: apparently only %i sectors are "
+           "used but device reported %i.\n",
+           first+s, sectors_used);
+        empty = true;	/* terminate to avoid reading stale data still in the logger */
+        break;
+      } else if (rc >= (4096-FULL_ITEM_LEN) && first+s+1 >= sectors_used && first+s+1 < pipe->sectors_total) {
+        db(1, MYNAME ": Last sector is nearly full, reading one more sector\n");
+        extra_sectors++;
+      }
+    }
+
+    lock.relock();
+    pipe->sectors_used += extra_sectors;
+    pipe->stop = pipe->stop || empty;
+    pipe->busy = false;
+    pipe->cond.wakeAll();
+  }
+}
+
 /* Note: the buffer is being padded with 0xFFs if necessary so there are always SECTOR_SIZE valid bytes */
 int
 SkytraqBase::skytraq_read_single_sector(unsigned int sector, uint8_t* buf) const
@@ -951,8 +1005,6 @@ SkytraqBase::skytraq_read_tracks() const
   int multi_read_supported = 1;
   gbfile* dumpfile = nullptr;
 
-  state_init(&st);
-
   if (skytraq_get_log_buffer_status(&log_wr_ptr, &sectors_free, &sectors_total) != res_OK) {
     fatal(MYNAME ": Can't get log buffer status\n");
   }
@@ -998,68 +1050,138 @@ SkytraqBase::skytraq_read_tracks() const
   db(1, MYNAME ": Reading log data from device...\n");
   db(1, MYNAME ": start=%d used=%d\n", opt_first_sector_val, sectors_used);
   db(1, MYNAME ": opt_last_sector_val=%d\n", opt_last_sector_val);
-  for (int i = opt_first_sector_val; i < sectors_used; i += got_sectors) {
-    for (t = 0, got_sectors = 0; (t < SECTOR_RETRIES) && (got_sectors <= 0); t++) {
-      if (xstrtoi(opt_read_at_once, nullptr, 10) == 0  ||  multi_read_supported == 0) {
-        rc = skytraq_read_single_sector(i, buffer);
-        if (rc == res_OK) {
-          got_sectors = 1;
-        }
-      } else {
-        /* Try to read read_at_once sectors at once.
-         * If tere aren't any so many interesting ones, read the remainder (sectors_used-i).
-         * And read at least 1 sector.
-         */
-        read_at_once = MAX(MIN(read_at_once, sectors_used-i), 1);
-
-        rc = skytraq_read_multiple_sectors(i, read_at_once, buffer);
-        switch (rc) {
-        case res_OK:
-          got_sectors = read_at_once;
-          read_at_once = MIN(read_at_once*2, xstrtoi(opt_read_at_once, nullptr, 10));
-          break;
+  /*
+   * Sectors are decoded in a second thread while the following ones are
+   * read from the device, so decoding is hidden behind the download.
+   */
+  const bool decode = *opt_no_output != '1';
+  sector_pipe pipe;
+  pipe.sectors_used = sectors_used;
+  pipe.sectors_total = sectors_total;
+  WaypointList waypoints;
+  RouteList routes;
+  RouteList tracks;
+  QThreadPool pool;
+  if (decode) {
+    const session_t* session = curr_session();
+    pool.setMaxThreadCount(1);
+    pool.start([this, &pipe, &st, &waypoints, &routes, &tracks, session]() {
+      gpsbabel::ObjectPool::set_thread_bypass(true);
+      waypt_use_list(&waypoints);
+      route_use_lists(&routes, &tracks);
+      use_session(session);
+      fatal_set_throws(true);
+      state_init(&st);
+      try {
+        decode_sectors(&pipe, &st);
+      } catch (const FatalError& e) {
+        QMutexLocker lock(&pipe.mutex);
+        pipe.error = QString::fromStdString(e.what());
+        pipe.stop = true;
+        pipe.busy = false;
+        pipe.cond.wakeAll();
+      }
+      fatal_set_throws(false);
+      use_session(nullptr);
+      route_use_lists(nullptr, nullptr);
+      waypt_use_list(nullptr);
+      gpsbabel::ObjectPool::set_thread_bypass(false);
+    });
+  } else {
+    state_init(&st);
+  }
+  auto finish_decoding = [&pipe, &pool]() {
+    {
+      QMutexLocker lock(&pipe.mutex);
+      pipe.done = true;
+      pipe.cond.wakeAll();
+    }
+    pool.waitForDone();
+  };
 
-        case res_NACK:
-          db(1, MYNAME ": Device doesn't seem to support reading multiple "
-             "sectors at once, falling back to single read.\n");
-          multi_read_supported = 0;
+  try {
+    for (int i = opt_first_sector_val; ; i += got_sectors) {
+      if (decode) {
+        /* Wait for the decoder to tell whether the last sector read is the last one wanted. */
+        QMutexLocker lock(&pipe.mutex);
+        while (!pipe.stop && (i >= pipe.sectors_used) && (pipe.busy || !pipe.blocks.empty())) {
+          pipe.cond.wait(&pipe.mutex);
+        }
+        if (pipe.stop) {
           break;
-
-        default:
-          /* On failure, try with less sectors */
-          read_at_once = MAX(read_at_once/2, 1);
         }
+        sectors_used = pipe.sectors_used;
+      }
+      if (i >= sectors_used) {
+        break;
       }
-    }
-    if (got_sectors <= 0) {
-      fatal(MYNAME ": Error reading sector %i\n", i);
-    }
 
-    total_sectors_read += got_sectors;
+      for (t = 0, got_sectors = 0; (t < SECTOR_RETRIES) && (got_sectors <= 0); t++) {
+        if (xstrtoi(opt_read_at_once, nullptr, 10) == 0  ||  multi_read_supported == 0) {
+          rc = skytraq_read_single_sector(i, buffer);
+          if (rc == res_OK) {
+            got_sectors = 1;
+          }
+        } else {
+          /* Try to read read_at_once sectors at once.
+           * If tere aren't any so many interesting ones, read the remainder (sectors_used-i).
+           * And read at least 1 sector.
+           */
+          read_at_once = MAX(MIN(read_at_once, sectors_used-i), 1);
+
+          rc = skytraq_read_multiple_sectors(i, read_at_once, buffer);
+          switch (rc) {
+          case res_OK:
+            got_sectors = read_at_once;
+            read_at_once = MIN(read_at_once*2, xstrtoi(opt_read_at_once, nullptr, 10));
+            break;
+
+          case res_NACK:
+            db(1, MYNAME ": Device doesn't seem to support reading multiple "
+               "sectors at once, falling back to single read.\n");
+            multi_read_supported = 0;
+            break;
+
+          default:
+            /* On failure, try with less sectors */
+            read_at_once = MAX(read_at_once/2, 1);
+          }
+        }
+      }
+      if (got_sectors <= 0) {
+        fatal(MYNAME ": Error reading sector %i\n", i);
+      }
 
-    if (dumpfile) {
-      gbfwrite(buffer, SECTOR_SIZE, got_sectors, dumpfile);
-    }
+      total_sectors_read += got_sectors;
 
-    if (*opt_no_output == '1') {
-      continue;		// skip decoding
-    }
+      if (dumpfile) {
+        gbfwrite(buffer, SECTOR_SIZE, got_sectors, dumpfile);
+      }
 
-    for (int s = 0; s < got_sectors; s++) {
-      db(4, MYNAME ": Decoding sector #%i...\n", i+s);
-      rc = process_data_sector(&st, buffer+s*SECTOR_SIZE, SECTOR_SIZE);
-      if (rc == 0) {
-        db(1, MYNAME ": Empty sector encountered: apparently only %i sectors are "
-           "used but device reported %i.\n",
-           i+s, sectors_used);
-        i = sectors_used;	/* terminate to avoid reading stale data still in the logger */
-        break;
-      } else if (rc >= (4096-FULL_ITEM_LEN) && i+s+1 >= sectors_used && i+s+1 < sectors_total) {
-        db(1, MYNAME ": Last sector is nearly full, reading one more sector\n");
-        sectors_used++;
+      if (!decode) {
+        continue;		// skip decoding
       }
+
+      QMutexLocker lock(&pipe.mutex);
+      pipe.blocks.emplace_back(i, QByteArray(reinterpret_cast<const char*>(buffer), got_sectors*SECTOR_SIZE));
+      pipe.cond.wakeAll();
     }
+  } catch (const FatalError&) {
+    /* The decoder must not outlive the pipe. */
+    finish_decoding();
+    throw;
   }
+  finish_decoding();
+
+  if (!pipe.error.isNull()) {
+    waypoints.flush();
+    routes.flush();
+    tracks.flush();
+    fatal(MYNAME ": Decoding the log data failed: %s\n", qPrintable(pipe.error));
+  }
+  waypt_splice(&waypoints);
+  track_splice(&tracks);
+
   free(buffer);
   db(1, MYNAME ": Got %i trackpoints from %i sectors.\n", st.tpn, total_sectors_read);
 
@@ -25,11 +25,16 @@
 #ifndef SKYTRAQ_H_INCLUDED_
 #define SKYTRAQ_H_INCLUDED_
 
-#include <QDateTime>  // for QDateTime
-#include <QString>    // for QString
-#include <QVector>    // for QVector
+#include <QByteArray>      // for QByteArray
+#include <QDateTime>       // for QDateTime
+#include <QMutex>          // for QMutex
+#include <QString>         // for QString
+#include <QVector>         // for QVector
+#include <QWaitCondition>  // for QWaitCondition
 
-#include <cstdint>    // for uint8_t, int32_t, uint32_t, uint16_t, int16_t
+#include <cstdint>         // for uint8_t, int32_t, uint32_t, uint16_t, int16_t
+#include <deque>           // for deque
+#include <utility>         // for pair
 
 #include "defs.h"
 #include "format.h"   // for Format
@@ -50,6 +55,24 @@ protected:
     long x, y, z;
   };
 
+  /*
+   * Hands the sectors read from the device to the decoding thread.  The
+   * decoder ends the download early at an empty sector and extends it by
+   * a sector when the last one is nearly full, so the reader waits for it
+   * before deciding it is done.
+   */
+  struct sector_pipe {
+    QMutex mutex;
+    QWaitCondition cond;
+    std::deque<std::pair<int, QByteArray>> blocks;	/* first sector, data */
+    int sectors_used{0};
+    int sectors_total{0};
+    bool busy{false};		/* the decoder is working on a block */
+    bool stop{false};		/* no more sectors are wanted */
+    bool done{false};		/* no more blocks will be queued */
+    QString error;
+  };
+
   struct full_item {
     uint32_t gps_week;
     uint32_t gps_sec;
@@ -134,6 +157,7 @@ protected:
   Waypoint* make_trackpoint(read_state* st, double lat, double lon, double alt) const;
   int process_data_item(read_state* pst, const item_frame* pitem, int len) const;
   int process_data_sector(read_state* pst, const uint8_t* buf, int len) const;
+  void decode_sectors(sector_pipe* pipe, read_state* pst) const;
   int skytraq_read_single_sector(unsigned int sector, uint8_t* buf) const;
   int skytraq_read_multiple_sectors(int first_sector, unsigned int sector_count, uint8_t* buf) const;
   void skytraq_read_tracks() const;
@@ -56,17 +56,19 @@
 	2008/08/20: added "relative" option, (Carsten Allefeld, carsten.allefeld@googlemail.com)
 */
 
+#include <algorithm>            // for make_heap, max, pop_heap, push_heap
 #include <cassert>
 #include <cstdlib>              // for strtod, strtol
-#include <iterator>             // for prev
+#include <functional>           // for function
+#include <vector>               // for vector
 
 #include <QDateTime>            // for QDateTime
-#include <QHash>                // for QHash
-#include <QMap>                 // for QMap
+#include <QtGlobal>             // for qsizetype
 
 #include "defs.h"
 #include "smplrout.h"
 #include "grtcirc.h"            // for gcdist, linedist, radtometers, radtomiles, linepart
+#include "src/core/budget.h"    // for Budget
 #include "src/core/datetime.h"  // for DateTime
 
 
@@ -134,133 +136,183 @@ double SimplifyRouteFilter::compute_track_error(const neighborhood& nb) const
   return track_error;
 }
 
-void SimplifyRouteFilter::routesimple_head(const route_head* rte)
+bool SimplifyRouteFilter::prepare_route(route_head* rte, bool /* is_track */)
 {
   /* short-circuit if we already have fewer than the max points */
   if ((limit_basis == limit_basis_t::count) && count >= rte->rte_waypt_ct()) {
-    return;
+    return false;
   }
 
   /* short-circuit if the route is impossible to simplify, too. */
   if (2 >= rte->rte_waypt_ct()) {
-    return;
+    return false;
   }
 
-  /* compute all distances */
-  /* sort XTE array, lowest XTE last */
-  Waypoint* pwpt = nullptr;
-  Waypoint* ppwpt = nullptr;
-  WaypointList::size_type pos = 0;
-  neighborhood nb;
-  trackerror te;
-  QMap<trackerror, neighborhood> errormap;
-  QHash<Waypoint*, trackerror> wpthash;
   for (auto* wpt : rte->waypoint_list) {
-    wpt->extra_data = nullptr;
-
     if (metric == metric_t::relative) {
       // check hdop is available for compute_track_error
       if (wpt->hdop == 0) {
         fatal(MYNAME ": relative needs hdop information.\n");
       }
     }
+  }
+  return true;
+}
 
-    if (pwpt != nullptr) {
-      nb.wpt = pwpt;
-      nb.prev = ppwpt;
-      nb.next = wpt;
-
-      te.dist = compute_track_error(nb);
-      te.wptpos = pos;
-
-      errormap.insert(te, nb);
-      wpthash.insert(pwpt, te);
-    }
-
-    ppwpt = pwpt;
-    pwpt = wpt;
-    ++pos;
+/*
+ * The points live in one array, linked to their neighbors by index, and
+ * the errors are kept in a binary heap.  When a point's error changes
+ * a new entry is pushed, and entries that no longer match their point's
+ * stamp are dropped as they reach the top.  The heap is ordered like the
+ * map it replaced, so the same points go in the same order.
+ */
+void SimplifyRouteFilter::eliminate(qsizetype npts,
+                                    const std::function<double(qsizetype prev, qsizetype i, qsizetype next)>& error_of,
+                                    const std::function<bool(qsizetype remaining, double error)>& proceed,
+                                    const std::function<void(qsizetype i)>& deleted)
+{
+  std::vector<node> nodes;
+  nodes.reserve(npts);
+  for (qsizetype i = 0; i < npts; ++i) {
+    nodes.push_back({i - 1, (i + 1 < npts) ? i + 1 : -1, 0});
   }
-  nb.wpt = pwpt;
-  nb.prev = ppwpt;
-  nb.next = nullptr;
 
-  te.dist = compute_track_error(nb);
-  te.wptpos = pos;
+  /* compute all distances */
+  /* the heap keeps the lowest XTE on top */
+  std::vector<trackerror> heap;
+  heap.reserve(2 * npts);
+  for (qsizetype i = 0; i < npts; ++i) {
+    heap.push_back({error_of(nodes[i].prev, i, nodes[i].next), static_cast<WaypointList::size_type>(i), 0});
+  }
+  std::make_heap(heap.begin(), heap.end());
 
-  errormap.insert(te, nb);
-  wpthash.insert(pwpt, te);
+  auto settle = [&heap, &nodes]()->void {
+    while (!heap.empty() && (heap.front().stamp != nodes[heap.front().wptpos].stamp)) {
+      std::pop_heap(heap.begin(), heap.end());
+      heap.pop_back();
+    }
+  };
+  auto update = [&heap, &nodes, &error_of](qsizetype i)->void {
+    node& nd = nodes[i];
+    ++nd.stamp;
+    heap.push_back({error_of(nd.prev, i, nd.next), static_cast<WaypointList::size_type>(i), nd.stamp});
+    std::push_heap(heap.begin(), heap.end());
+  };
 
-  assert(!errormap.isEmpty());
-  double totalerror = errormap.lastKey().dist;
+  qsizetype remaining = npts;
 
   /* while we still have too many records... */
-  while ((!errormap.isEmpty()) &&
-         (((limit_basis == limit_basis_t::count) && (count < errormap.size())) ||
-          ((limit_basis == limit_basis_t::error) && (totalerror < error)))) {
+  while ((remaining > 0) && !heap.empty() && proceed(remaining, heap.front().dist)) {
+    gpsbabel::Budget::check();
 
     /* remove the record with the lowest XTE */
-    neighborhood goner = errormap.last();
-    goner.wpt->wpt_flags.marked_for_deletion = 1;
-    // errormap.remove(lastKey());  // with Qt 5.12.12, 5.15.2 results in asan heap-use-after-free errors in build_extra_tests.sh
-    errormap.erase(std::prev(errormap.cend())); // in Qt6 can use cend().
-    // wpthash.remove(goner.wpt); // removal not necessary
+    std::pop_heap(heap.begin(), heap.end());
+    const qsizetype gonepos = heap.back().wptpos;
+    const node goner = nodes[gonepos];
+    heap.pop_back();
+    deleted(gonepos);
+    --remaining;
 
     /* recompute neighbors of point marked for deletion. */
-    if (goner.prev != nullptr) {
-      assert(wpthash.contains(goner.prev));
-      trackerror terr = wpthash.value(goner.prev);
-      assert(errormap.contains(terr));
-      neighborhood nbh = errormap.value(terr);
-      nbh.next = goner.next;
-      errormap.remove(terr);
-      terr.dist = compute_track_error(nbh);
-      errormap.insert(terr, nbh);
-      wpthash.insert(goner.prev, terr);
+    if (goner.prev >= 0) {
+      nodes[goner.prev].next = goner.next;
+      update(goner.prev);
     }
-    if (goner.next != nullptr) {
-      assert(wpthash.contains(goner.next));
-      trackerror terr = wpthash.value(goner.next);
-      assert(errormap.contains(terr));
-      neighborhood nbh = errormap.value(terr);
-      nbh.prev = goner.prev;
-      errormap.remove(terr);
-      terr.dist = compute_track_error(nbh);
-      errormap.insert(terr, nbh);
-      wpthash.insert(goner.next, terr);
-    }
-
-    /* compute impact of deleting next point */
-    if (limit_basis == limit_basis_t::error) {
-      switch (metric) {
-      case metric_t::crosstrack:
-      case metric_t::relative:
-        totalerror = errormap.lastKey().dist;
-        break;
-      case metric_t::length:
-        totalerror += errormap.lastKey().dist;
-        break;
-      }
+    if (goner.next >= 0) {
+      nodes[goner.next].prev = goner.prev;
+      update(goner.next);
     }
+    settle();
 
   } /* end of too many records loop */
 }
 
-void SimplifyRouteFilter::process()
+void SimplifyRouteFilter::process_route(route_head* rte, bool /* is_track */)
 {
-  auto common_head_lambda = [this](const route_head* rte)->void {
-    routesimple_head(rte);
+  std::vector<Waypoint*> wpts(rte->waypoint_list.cbegin(), rte->waypoint_list.cend());
+
+  auto error_of = [this, &wpts](qsizetype prev, qsizetype i, qsizetype next)->double {
+    return compute_track_error({
+      wpts[i],
+      (prev >= 0) ? wpts[prev] : nullptr,
+      (next >= 0) ? wpts[next] : nullptr
+    });
   };
 
-  auto route_tail_lambda = [](const route_head* rte)->void {
-    route_del_marked_wpts(const_cast<route_head*>(rte));
+  /* compute impact of deleting next point */
+  double totalerror = 0;
+  auto proceed = [this, &totalerror](qsizetype remaining, double next)->bool {
+    if (limit_basis == limit_basis_t::count) {
+      return count < remaining;
+    }
+    switch (metric) {
+    case metric_t::crosstrack:
+    case metric_t::relative:
+      totalerror = next;
+      break;
+    case metric_t::length:
+      totalerror += next;
+      break;
+    }
+    return totalerror < error;
   };
-  route_disp_all(common_head_lambda, route_tail_lambda, nullptr);
 
-  auto track_tail_lambda = [](const route_head* rte)->void {
-    track_del_marked_wpts(const_cast<route_head*>(rte));
+  eliminate(static_cast<qsizetype>(wpts.size()), error_of, proceed, [&wpts](qsizetype i)->void {
+    wpts[i]->wpt_flags.marked_for_deletion = 1;
+  });
+}
+
+/*
+ * error= deletes points while the least error is below it, so a point
+ * goes for every error above the largest least error met up to and
+ * including its deletion.
+ */
+QVector<double> SimplifyRouteFilter::crosstrack_thresholds(const QVector<const Waypoint*>& line)
+{
+  QVector<double> thresholds(line.size(), kHugeValue);
+  if (line.size() <= 2) {
+    return thresholds;
+  }
+
+  auto error_of = [&line](qsizetype prev, qsizetype i, qsizetype next)->double {
+    if ((prev < 0) || (next < 0)) {
+      return kHugeValue;
+    }
+    return radtomiles(linedist(line.at(prev)->position(),
+                               line.at(next)->position(),
+                               line.at(i)->position()));
+  };
+
+  double highest = 0;
+  auto proceed = [&highest](qsizetype /* remaining */, double next)->bool {
+    highest = std::max(highest, next);
+    return next < kHugeValue;
   };
-  track_disp_all(common_head_lambda, track_tail_lambda, nullptr);
+
+  eliminate(line.size(), error_of, proceed, [&thresholds, &highest](qsizetype i)->void {
+    thresholds[i] = highest;
+  });
+  return thresholds;
+}
+
+void SimplifyRouteFilter::finish_route(route_head* rte, bool is_track)
+{
+  if (is_track) {
+    track_del_marked_wpts(rte);
+  } else {
+    route_del_marked_wpts(rte);
+  }
+}
+
+int SimplifyRouteFilter::route_threads() const
+{
+  return (opt_threads != nullptr) ? xstrtoi(opt_threads, nullptr, 10) : 1;
+}
+
+/* Routes and tracks are simplified independently of each other. */
+void SimplifyRouteFilter::process()
+{
+  process_routes();
 }
 
 void SimplifyRouteFilter::init()
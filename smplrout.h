@@ -59,9 +59,12 @@
 #ifndef SMPLROUT_H_INCLUDED_
 #define SMPLROUT_H_INCLUDED_
 
+#include <functional>            // for function
+
 #include <QString>               // for QString
 #include <QStringView>           // for QStringView
 #include <QVector>               // for QVector
+#include <QtGlobal>              // for qsizetype
 
 #include "defs.h"
 #include "filter.h"              // for Filter
@@ -78,6 +81,7 @@ public:
   struct trackerror {
     double dist;
     WaypointList::size_type wptpos;
+    unsigned int stamp;	/* current while it matches the point's stamp */
   };
 
   /* Member Functions */
@@ -88,6 +92,21 @@ public:
   }
   void init() override;
   void process() override;
+  int route_threads() const override;
+  bool prepare_route(route_head* rte, bool is_track) override;
+  void process_route(route_head* rte, bool is_track) override;
+  void finish_route(route_head* rte, bool is_track) override;
+
+  /*
+   * For each point of the line the error, in miles, from which on
+   * error= with the crosstrack metric keeps it, the ends kHugeValue.
+   * One pass gives the points simplify would keep for any error.
+   */
+  static QVector<double> crosstrack_thresholds(const QVector<const Waypoint*>& line);
+
+  /* Constants */
+
+  static constexpr double kHugeValue = 2000000000;
 
 private:
 
@@ -97,19 +116,25 @@ private:
   enum class metric_t {crosstrack, length, relative};
 
   struct neighborhood {
-    Waypoint* wpt;
-    Waypoint* prev;
-    Waypoint* next;
+    const Waypoint* wpt;
+    const Waypoint* prev;
+    const Waypoint* next;
   };
 
-  /* Constants */
-
-  static constexpr double kHugeValue = 2000000000;
+  /* A point of the route, linked to its remaining neighbors by index. */
+  struct node {
+    qsizetype prev;	/* -1 at the start */
+    qsizetype next;	/* -1 at the end */
+    unsigned int stamp;	/* bumped whenever the error is recomputed */
+  };
 
   /* Member Functions */
 
   double compute_track_error(const neighborhood& nb) const;
-  void routesimple_head(const route_head* rte);
+  static void eliminate(qsizetype npts,
+                        const std::function<double(qsizetype prev, qsizetype i, qsizetype next)>& error_of,
+                        const std::function<bool(qsizetype remaining, double error)>& proceed,
+                        const std::function<void(qsizetype i)>& deleted);
 
   /* Data Members */
 
@@ -123,6 +148,7 @@ private:
   char* xteopt = nullptr;
   char* lenopt = nullptr;
   char* relopt = nullptr;
+  char* opt_threads = nullptr;
 
   QVector<arglist_t> args = {
     {
@@ -145,6 +171,10 @@ private:
       "relative", &relopt, "Use relative error", nullptr,
       ARGTYPE_BOOL | ARGTYPE_END_EXCL, ARG_NOMINMAX, nullptr
     },
+    {
+      "threads", &opt_threads, "Simplify routes and tracks on this many threads",
+      nullptr, ARGTYPE_INT, "1", nullptr, nullptr
+    },
   };
 
 };
@@ -21,36 +21,82 @@
 
 #include "sort.h"
 
-#include <QDateTime>            // for QDateTime
-#include <QString>              // for operator<, QString
+#include <limits>                   // for numeric_limits
+#include <utility>                  // for as_const, pair
+
+#include <QDateTime>                // for QDateTime
+#include <QString>                  // for operator<, QString
+#include <QVector>                  // for QVector
+#include <QtGlobal>                 // for qint64, qsizetype, quint64
 
 #include "defs.h"
-#include "geocache.h"           // for Geocache
-#include "src/core/datetime.h"  // for DateTime
+#include "geocache.h"               // for Geocache
+#include "src/core/datetime.h"      // for DateTime
+#include "src/core/parallelsort.h"  // for parallel_stable_sort
 
 
 #if FILTERS_ENABLED
 #define MYNAME "sort"
 
 
-bool SortFilter::sort_comp_wpt_by_description(const Waypoint* a, const Waypoint* b)
+SortFilter::StringKey SortFilter::string_key(const QString& text)
+{
+  // QString compares UTF-16 code units, and a string that runs out
+  // sorts first, as the zero padding does.
+  quint64 prefix = 0;
+  for (qsizetype i = 0; i < 4; ++i) {
+    prefix = (prefix << 16) | ((i < text.size()) ? text.at(i).unicode() : 0);
+  }
+  return {prefix, &text};
+}
+
+SortFilter::StringKey SortFilter::sort_key_wpt_by_description(const Waypoint* wpt)
 {
-  return a->description < b->description;
+  return string_key(wpt->description);
 }
 
-bool SortFilter::sort_comp_wpt_by_gcid(const Waypoint* a, const Waypoint* b)
+long long SortFilter::sort_key_wpt_by_gcid(const Waypoint* wpt)
 {
-  return a->gc_data->id < b->gc_data->id;
+  return wpt->gc_data->id;
 }
 
-bool SortFilter::sort_comp_wpt_by_shortname(const Waypoint* a, const Waypoint* b)
+SortFilter::StringKey SortFilter::sort_key_wpt_by_shortname(const Waypoint* wpt)
 {
-  return a->shortname < b->shortname;
+  return string_key(wpt->shortname);
 }
 
-bool SortFilter::sort_comp_wpt_by_time(const Waypoint* a, const Waypoint* b)
+qint64 SortFilter::sort_key_wpt_by_time(const Waypoint* wpt)
 {
-  return a->GetCreationTime() < b->GetCreationTime();
+  // An invalid QDateTime sorts before every valid one.
+  const QDateTime& time = wpt->GetCreationTime();
+  return time.isValid() ? time.toMSecsSinceEpoch() : std::numeric_limits<qint64>::min();
+}
+
+/*
+ * Stable sort of the waypoints by key, which is looked up once per
+ * waypoint instead of once per comparison.
+ */
+template <typename Key>
+void SortFilter::sort_waypoints(Key (*key)(const Waypoint*)) const
+{
+  using keyed_t = std::pair<Key, Waypoint*>;
+  QVector<keyed_t> keyed;
+  keyed.reserve(waypt_count());
+  waypt_disp_all([&keyed, key](const Waypoint* wpt)->void {
+    keyed.append(keyed_t(key(wpt), const_cast<Waypoint*>(wpt)));
+  });
+
+  const int threads = (opt_threads != nullptr) ? xstrtoi(opt_threads, nullptr, 10) : 1;
+  gpsbabel::parallel_stable_sort(keyed, [](const keyed_t& a, const keyed_t& b)->bool {
+    return a.first < b.first;
+  }, threads);
+
+  QVector<Waypoint*> order;
+  order.reserve(keyed.size());
+  for (const keyed_t& entry : std::as_const(keyed)) {
+    order.append(entry.second);
+  }
+  waypt_reorder(order);
 }
 
 bool SortFilter::sort_comp_rh_by_description(const route_head* a, const route_head* b)
@@ -74,16 +120,16 @@ void SortFilter::process()
   case SortModeWpt::none:
     break;
   case SortModeWpt::description:
-    waypt_sort(sort_comp_wpt_by_description);
+    sort_waypoints(sort_key_wpt_by_description);
     break;
   case SortModeWpt::gcid:
-    waypt_sort(sort_comp_wpt_by_gcid);
+    sort_waypoints(sort_key_wpt_by_gcid);
     break;
   case SortModeWpt::shortname:
-    waypt_sort(sort_comp_wpt_by_shortname);
+    sort_waypoints(sort_key_wpt_by_shortname);
     break;
   case SortModeWpt::time:
-    waypt_sort(sort_comp_wpt_by_time);
+    sort_waypoints(sort_key_wpt_by_time);
     break;
   default:
     fatal(MYNAME ": unknown waypoint sort mode.");
@@ -24,6 +24,7 @@
 
 #include <QString>   // for QString
 #include <QVector>   // for QVector
+#include <QtGlobal>  // for qint64, quint64
 
 #include "defs.h"    // for arglist_t, ARGTYPE_BOOL, ARG_NOMINMAX, Waypoint
 #include "filter.h"  // for Filter
@@ -41,6 +42,10 @@ public:
   {
     return &args;
   }
+  unsigned int fields() const override
+  {
+    return wpt_field_geocache;  // to sort by geocache id
+  }
   void init() override;
   void process() override;
 
@@ -63,12 +68,32 @@ private:
     number
   };
 
+  /*
+   * Orders like the string itself.  The first four UTF-16 code units,
+   * zero padded, decide most comparisons without following text.
+   */
+  struct StringKey {
+    quint64 prefix;
+    const QString* text;
+
+    bool operator<(const StringKey& other) const
+    {
+      if (prefix != other.prefix) {
+        return prefix < other.prefix;
+      }
+      return *text < *other.text;
+    }
+  };
+
   /* Member Functions */
 
-  static bool sort_comp_wpt_by_description(const Waypoint* a, const Waypoint* b);
-  static bool sort_comp_wpt_by_gcid(const Waypoint* a, const Waypoint* b);
-  static bool sort_comp_wpt_by_shortname(const Waypoint* a, const Waypoint* b);
-  static bool sort_comp_wpt_by_time(const Waypoint* a, const Waypoint* b);
+  static StringKey string_key(const QString& text);
+  static StringKey sort_key_wpt_by_description(const Waypoint* wpt);
+  static long long sort_key_wpt_by_gcid(const Waypoint* wpt);
+  static StringKey sort_key_wpt_by_shortname(const Waypoint* wpt);
+  static qint64 sort_key_wpt_by_time(const Waypoint* wpt);
+  template <typename Key>
+  void sort_waypoints(Key (*key)(const Waypoint*)) const;
   static bool sort_comp_rh_by_description(const route_head* a, const route_head* b);
   static bool sort_comp_rh_by_name(const route_head* a, const route_head* b);
   static bool sort_comp_rh_by_number(const route_head* a, const route_head* b);
@@ -89,6 +114,7 @@ private:
   char* opt_sm_trknum{};
   char* opt_sm_trkname{};
   char* opt_sm_trkdesc{};
+  char* opt_threads{};
 
   QVector<arglist_t> args = {
     {
@@ -131,6 +157,10 @@ private:
       "trknum", &opt_sm_trknum, "Sort tracks by number",
       nullptr, ARGTYPE_BEGIN_EXCL | ARGTYPE_BOOL, ARG_NOMINMAX, nullptr
     },
+    {
+      "threads", &opt_threads, "Sort large waypoint lists on this many threads",
+      nullptr, ARGTYPE_INT, "1", nullptr, nullptr
+    },
   };
 
 };
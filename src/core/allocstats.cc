@@ -0,0 +1,163 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <atomic>                 // for atomic, memory_order_relaxed
+#include <cstddef>                // for size_t
+#include <cstdlib>                // for free, malloc
+#include <new>                    // for bad_alloc, nothrow_t
+
+#include "src/core/allocstats.h"
+
+#ifdef GPSBABEL_ALLOCATION_STATS
+
+namespace
+{
+
+std::atomic<qint64> allocation_count{0};
+std::atomic<qint64> allocation_bytes{0};
+std::atomic<qint64> deallocation_count{0};
+
+void* counted_alloc(std::size_t size) noexcept
+{
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+  return std::malloc((size != 0) ? size : 1);
+}
+
+void counted_free(void* ptr) noexcept
+{
+  if (ptr != nullptr) {
+    deallocation_count.fetch_add(1, std::memory_order_relaxed);
+    std::free(ptr);
+  }
+}
+
+} // namespace
+
+void* operator new(std::size_t size)
+{
+  void* ptr = counted_alloc(size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+  void* ptr = counted_alloc(size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t& /* tag */) noexcept
+{
+  return counted_alloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& /* tag */) noexcept
+{
+  return counted_alloc(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+  counted_free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+  counted_free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t /* size */) noexcept
+{
+  counted_free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t /* size */) noexcept
+{
+  counted_free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t& /* tag */) noexcept
+{
+  counted_free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t& /* tag */) noexcept
+{
+  counted_free(ptr);
+}
+
+namespace gpsbabel
+{
+
+bool AllocStats::enabled()
+{
+  return true;
+}
+
+qint64 AllocStats::allocations()
+{
+  return allocation_count.load(std::memory_order_relaxed);
+}
+
+qint64 AllocStats::bytes()
+{
+  return allocation_bytes.load(std::memory_order_relaxed);
+}
+
+qint64 AllocStats::deallocations()
+{
+  return deallocation_count.load(std::memory_order_relaxed);
+}
+
+} // namespace gpsbabel
+
+#else
+
+namespace gpsbabel
+{
+
+bool AllocStats::enabled()
+{
+  return false;
+}
+
+qint64 AllocStats::allocations()
+{
+  return 0;
+}
+
+qint64 AllocStats::bytes()
+{
+  return 0;
+}
+
+qint64 AllocStats::deallocations()
+{
+  return 0;
+}
+
+} // namespace gpsbabel
+
+#endif // GPSBABEL_ALLOCATION_STATS
@@ -0,0 +1,48 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_ALLOCSTATS_H_
+#define SRC_CORE_ALLOCSTATS_H_
+
+#include <QtGlobal>  // for qint64
+
+namespace gpsbabel
+{
+
+/*
+ * Running totals of the heap allocations made through the global
+ * operator new and operator new[].
+ *
+ * They are only kept in builds configured with
+ * GPSBABEL_ALLOCATION_STATS, which replace the global allocation
+ * functions.  Otherwise enabled() is false and the totals stay 0.
+ * Over-aligned allocations are not counted.
+ */
+class AllocStats
+{
+public:
+  static bool enabled();
+  static qint64 allocations();
+  static qint64 bytes();
+  static qint64 deallocations();
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_ALLOCSTATS_H_
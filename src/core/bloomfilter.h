@@ -0,0 +1,97 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_BLOOMFILTER_H_
+#define SRC_CORE_BLOOMFILTER_H_
+
+#include <QVector>   // for QVector
+#include <QtGlobal>  // for quint64, qsizetype
+
+namespace gpsbabel
+{
+
+/*
+ * A set of 64 bit hashes that may answer that it holds a hash it
+ * doesn't hold, but never the other way round.  Sized for count hashes
+ * it takes 10 to 20 bits a hash and answers wrongly for fewer than 1 in
+ * 100 of the hashes it doesn't hold.  The hashes should be well mixed;
+ * the bits are picked by double hashing from the hash and a remix of
+ * it.
+ */
+class BloomFilter
+{
+public:
+  explicit BloomFilter(qsizetype count)
+  {
+    quint64 size = 64;
+    while (size < static_cast<quint64>(count) * kBitsPerHash) {
+      size <<= 1;
+    }
+    mask_ = size - 1;
+    words_.resize(size / 64);
+  }
+
+  /* Adds hash, returns whether it may have been added before. */
+  bool insert(quint64 hash)
+  {
+    const quint64 step = remix(hash) | 1;
+    bool present = true;
+    for (int i = 0; i < kProbes; ++i, hash += step) {
+      const quint64 bit = hash & mask_;
+      quint64& word = words_[bit >> 6];
+      const quint64 flag = quint64{1} << (bit & 63);
+      present = present && ((word & flag) != 0);
+      word |= flag;
+    }
+    return present;
+  }
+
+  bool contains(quint64 hash) const
+  {
+    const quint64 step = remix(hash) | 1;
+    for (int i = 0; i < kProbes; ++i, hash += step) {
+      const quint64 bit = hash & mask_;
+      if ((words_.at(bit >> 6) & (quint64{1} << (bit & 63))) == 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  qsizetype bytes() const {return words_.size() * sizeof(quint64);}
+
+private:
+  static constexpr quint64 kBitsPerHash = 10;
+  static constexpr int kProbes = 7;
+
+  /* The splitmix64 finalizer. */
+  static quint64 remix(quint64 x)
+  {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+
+  QVector<quint64> words_;
+  quint64 mask_;
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_BLOOMFILTER_H_
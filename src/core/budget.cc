@@ -0,0 +1,96 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <QElapsedTimer>          // for QElapsedTimer
+#include <QThread>                // for QThread
+
+#if !__WIN32__
+#include <unistd.h>               // for alarm
+#endif
+
+#include "defs.h"                 // for fatal
+#include "src/core/budget.h"
+#include "src/core/profiler.h"    // for Profiler
+
+namespace gpsbabel
+{
+
+static QElapsedTimer timer;
+static qint64 time_limit_ms = 0;
+static qint64 memory_limit_kb = 0;
+static QThread* owner = nullptr;
+
+void Budget::set_time_limit(qint64 seconds)
+{
+  time_limit_ms = seconds * 1000;
+  timer.start();
+  enable();
+#if !__WIN32__
+  if (hard_stop_) {
+    alarm(seconds + kHardStopGraceSeconds);
+  }
+#endif
+}
+
+void Budget::set_memory_limit(qint64 bytes)
+{
+  memory_limit_kb = bytes / 1024;
+  enable();
+}
+
+void Budget::clear()
+{
+  time_limit_ms = 0;
+  memory_limit_kb = 0;
+  enabled_ = false;
+#if !__WIN32__
+  if (hard_stop_) {
+    alarm(0);
+  }
+#endif
+}
+
+void Budget::enable()
+{
+  owner = QThread::currentThread();
+  calls_ = 0;
+  enabled_ = true;
+}
+
+void Budget::check_limits()
+{
+  if (QThread::currentThread() != owner) {
+    return;
+  }
+  if ((time_limit_ms > 0) && (timer.elapsed() > time_limit_ms)) {
+    enabled_ = false;
+    fatal("The conversion took longer than the %lld seconds allowed by --time-limit.\n",
+          static_cast<long long>(time_limit_ms / 1000));
+  }
+  if (memory_limit_kb > 0) {
+    const qint64 rss_kb = Profiler::peak_rss_kb();
+    if (rss_kb > memory_limit_kb) {
+      enabled_ = false;
+      fatal("The conversion took %lld MB of memory, more than the %lld MB allowed by --memory-limit.\n",
+            static_cast<long long>(rss_kb >> 10), static_cast<long long>(memory_limit_kb >> 10));
+    }
+  }
+}
+
+} // namespace gpsbabel
@@ -0,0 +1,75 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_BUDGET_H_
+#define SRC_CORE_BUDGET_H_
+
+#include <QtGlobal>  // for qint64
+
+namespace gpsbabel
+{
+
+/*
+ * Time and memory limits of a conversion.
+ *
+ * Readers, filters and writers call check() in their loops.  Once a
+ * limit is set, every so many calls compare the time since it was set
+ * and the peak resident memory of the process to the limits, and a run
+ * over one stops with fatal(), which in the library throws a FatalError.
+ * Until then every check is just a test of an inline flag.  Only the
+ * thread that set the limits stops, the helpers of parallel work just
+ * return.
+ *
+ * With set_hard_stop() a run that is past its time limit by
+ * kHardStopGraceSeconds without reaching a check is ended by SIGALRM.
+ * That is for the forked jobs of -J, it would end any other process.
+ */
+class Budget
+{
+public:
+  static constexpr int kHardStopGraceSeconds = 10;
+
+  static void set_time_limit(qint64 seconds);
+  static void set_memory_limit(qint64 bytes);
+  static void set_hard_stop(bool enable) {hard_stop_ = enable;}
+  static void clear();
+  static bool enabled() {return enabled_;}
+
+  static void check()
+  {
+    if (enabled_ && ((++calls_ & kCheckMask) == 0)) {
+      check_limits();
+    }
+  }
+
+private:
+  static constexpr unsigned kCheckMask = 0x3ff;
+
+  static void enable();
+  static void check_limits();
+
+  static inline bool enabled_ = false;
+  static inline bool hard_stop_ = false;
+  // Counted without synchronization, a lost count only delays a check.
+  static inline unsigned calls_ = 0;
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_BUDGET_H_
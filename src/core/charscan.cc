@@ -0,0 +1,215 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <bit>                  // for countr_zero
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define CHARSCAN_SSE2 1
+#include <emmintrin.h>          // for _mm_cmpeq_epi16, _mm_cmpeq_epi8, _mm_loadu_si128, _mm_movemask_epi8, _mm_or_si128, _mm_set1_epi16, _mm_set1_epi8, _mm_and_si128, _mm_packus_epi16, _mm_setzero_si128, _mm_storeu_si128, _mm_unpackhi_epi8, _mm_unpacklo_epi8
+#if defined(__AVX2__)
+#define CHARSCAN_AVX2 1
+#include <immintrin.h>          // for _mm256_cmpeq_epi16, _mm256_cmpeq_epi8, _mm256_loadu_si256, _mm256_movemask_epi8, _mm256_or_si256, _mm256_set1_epi16, _mm256_set1_epi8
+#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define CHARSCAN_NEON 1
+#include <arm_neon.h>           // for vceqq_u16, vceqq_u8, vdupq_n_u16, vdupq_n_u8, vorrq_u8, vld1q_u16, vmaxvq_u16, vorrq_u16, vcombine_u8, vget_high_u8, vget_low_u8, vld1q_u8, vmaxvq_u8, vmovl_u8, vmovn_u16, vst1q_u16, vst1q_u8
+#endif
+
+#include "src/core/charscan.h"
+
+namespace gpsbabel
+{
+
+qsizetype find_first_of(QStringView text, qsizetype from, char16_t a, char16_t b)
+{
+  const char16_t* const begin = text.utf16();
+  const char16_t* const end = begin + text.size();
+  const char16_t* p = begin + from;
+
+#if defined(CHARSCAN_AVX2)
+  const __m256i wide_a = _mm256_set1_epi16(static_cast<short>(a));
+  const __m256i wide_b = _mm256_set1_epi16(static_cast<short>(b));
+  for (; end - p >= 16; p += 16) {
+    const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi16(chunk, wide_a),
+                                         _mm256_cmpeq_epi16(chunk, wide_b));
+    const auto mask = static_cast<unsigned int>(_mm256_movemask_epi8(hits));
+    if (mask != 0) {
+      // Each matching character sets the two bits of its bytes.
+      return (p - begin) + (std::countr_zero(mask) / 2);
+    }
+  }
+#endif
+#if defined(CHARSCAN_SSE2)
+  const __m128i vec_a = _mm_set1_epi16(static_cast<short>(a));
+  const __m128i vec_b = _mm_set1_epi16(static_cast<short>(b));
+  for (; end - p >= 8; p += 8) {
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const __m128i hits = _mm_or_si128(_mm_cmpeq_epi16(chunk, vec_a),
+                                      _mm_cmpeq_epi16(chunk, vec_b));
+    const auto mask = static_cast<unsigned int>(_mm_movemask_epi8(hits));
+    if (mask != 0) {
+      return (p - begin) + (std::countr_zero(mask) / 2);
+    }
+  }
+#elif defined(CHARSCAN_NEON)
+  const uint16x8_t vec_a = vdupq_n_u16(a);
+  const uint16x8_t vec_b = vdupq_n_u16(b);
+  for (; end - p >= 8; p += 8) {
+    const uint16x8_t chunk = vld1q_u16(reinterpret_cast<const uint16_t*>(p));
+    const uint16x8_t hits = vorrq_u16(vceqq_u16(chunk, vec_a), vceqq_u16(chunk, vec_b));
+    if (vmaxvq_u16(hits) != 0) {
+      // The scalar loop below finds which of these eight it was.
+      break;
+    }
+  }
+#endif
+
+  for (; p < end; ++p) {
+    if ((*p == a) || (*p == b)) {
+      return p - begin;
+    }
+  }
+  return text.size();
+}
+
+qsizetype find_first_of(QByteArrayView text, qsizetype from, char a, char b)
+{
+  const char* const begin = text.data();
+  const char* const end = begin + text.size();
+  const char* p = begin + from;
+
+#if defined(CHARSCAN_AVX2)
+  const __m256i wide_a = _mm256_set1_epi8(a);
+  const __m256i wide_b = _mm256_set1_epi8(b);
+  for (; end - p >= 32; p += 32) {
+    const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, wide_a),
+                                         _mm256_cmpeq_epi8(chunk, wide_b));
+    const auto mask = static_cast<unsigned int>(_mm256_movemask_epi8(hits));
+    if (mask != 0) {
+      return (p - begin) + std::countr_zero(mask);
+    }
+  }
+#endif
+#if defined(CHARSCAN_SSE2)
+  const __m128i vec_a = _mm_set1_epi8(a);
+  const __m128i vec_b = _mm_set1_epi8(b);
+  for (; end - p >= 16; p += 16) {
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, vec_a),
+                                      _mm_cmpeq_epi8(chunk, vec_b));
+    const auto mask = static_cast<unsigned int>(_mm_movemask_epi8(hits));
+    if (mask != 0) {
+      return (p - begin) + std::countr_zero(mask);
+    }
+  }
+#elif defined(CHARSCAN_NEON)
+  const uint8x16_t vec_a = vdupq_n_u8(static_cast<uint8_t>(a));
+  const uint8x16_t vec_b = vdupq_n_u8(static_cast<uint8_t>(b));
+  for (; end - p >= 16; p += 16) {
+    const uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+    const uint8x16_t hits = vorrq_u8(vceqq_u8(chunk, vec_a), vceqq_u8(chunk, vec_b));
+    if (vmaxvq_u8(hits) != 0) {
+      // The scalar loop below finds which of these sixteen it was.
+      break;
+    }
+  }
+#endif
+
+  for (; p < end; ++p) {
+    if ((*p == a) || (*p == b)) {
+      return p - begin;
+    }
+  }
+  return text.size();
+}
+
+qsizetype widen_ascii(const char* in, qsizetype len, char16_t* out)
+{
+  qsizetype i = 0;
+
+#if defined(CHARSCAN_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  for (; len - i >= 16; i += 16) {
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    if (_mm_movemask_epi8(chunk) != 0) {
+      break;
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_unpacklo_epi8(chunk, zero));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), _mm_unpackhi_epi8(chunk, zero));
+  }
+#elif defined(CHARSCAN_NEON)
+  for (; len - i >= 16; i += 16) {
+    const uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(in + i));
+    if (vmaxvq_u8(chunk) >= 0x80) {
+      break;
+    }
+    vst1q_u16(reinterpret_cast<uint16_t*>(out + i), vmovl_u8(vget_low_u8(chunk)));
+    vst1q_u16(reinterpret_cast<uint16_t*>(out + i + 8), vmovl_u8(vget_high_u8(chunk)));
+  }
+#endif
+
+  for (; i < len; ++i) {
+    const auto c = static_cast<unsigned char>(in[i]);
+    if (c >= 0x80) {
+      break;
+    }
+    out[i] = c;
+  }
+  return i;
+}
+
+qsizetype narrow_ascii(const char16_t* in, qsizetype len, char* out)
+{
+  qsizetype i = 0;
+
+#if defined(CHARSCAN_SSE2)
+  const __m128i high = _mm_set1_epi16(static_cast<short>(0xff80));
+  const __m128i zero = _mm_setzero_si128();
+  for (; len - i >= 16; i += 16) {
+    const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 8));
+    const __m128i beyond = _mm_and_si128(_mm_or_si128(lo, hi), high);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(beyond, zero)) != 0xffff) {
+      break;
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(lo, hi));
+  }
+#elif defined(CHARSCAN_NEON)
+  for (; len - i >= 16; i += 16) {
+    const uint16x8_t lo = vld1q_u16(reinterpret_cast<const uint16_t*>(in + i));
+    const uint16x8_t hi = vld1q_u16(reinterpret_cast<const uint16_t*>(in + i + 8));
+    if (vmaxvq_u16(vorrq_u16(lo, hi)) >= 0x80) {
+      break;
+    }
+    vst1q_u8(reinterpret_cast<uint8_t*>(out + i), vcombine_u8(vmovn_u16(lo), vmovn_u16(hi)));
+  }
+#endif
+
+  for (; i < len; ++i) {
+    if (in[i] >= 0x80) {
+      break;
+    }
+    out[i] = static_cast<char>(in[i]);
+  }
+  return i;
+}
+
+} // namespace gpsbabel
@@ -0,0 +1,58 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_CHARSCAN_H_
+#define SRC_CORE_CHARSCAN_H_
+
+#include <QByteArrayView>  // for QByteArrayView
+#include <QStringView>     // for QStringView
+#include <QtGlobal>        // for qsizetype
+
+namespace gpsbabel
+{
+
+/*
+ * Find the first of two characters in text, for the field splitters of
+ * the delimited formats, which spend most of their time stepping over
+ * characters that neither separate nor enclose a field.
+ *
+ * Returns the index of the first position at or after from holding a or b,
+ * or text.size() if there is none.  Eight or sixteen characters are
+ * compared at a time where SSE2, AVX2 or NEON is available.
+ */
+qsizetype find_first_of(QStringView text, qsizetype from, char16_t a, char16_t b);
+/*
+ * The same for byte text, such as NMEA sentences, comparing sixteen or
+ * thirty-two bytes at a time.
+ */
+qsizetype find_first_of(QByteArrayView text, qsizetype from, char a, char b);
+
+/*
+ * Copy the leading ASCII of in to out, widening or narrowing each
+ * character, for the single byte codepages, whose text is mostly ASCII.
+ * Returns how many characters were copied, at most len; the next one, if
+ * any, is not ASCII.  Sixteen characters are copied at a time where SSE2
+ * or NEON is available.
+ */
+qsizetype widen_ascii(const char* in, qsizetype len, char16_t* out);
+qsizetype narrow_ascii(const char16_t* in, qsizetype len, char* out);
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_CHARSCAN_H_
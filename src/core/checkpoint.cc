@@ -0,0 +1,112 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <QCryptographicHash>  // for QCryptographicHash, QCryptographicHash::Sha1
+#include <QFile>               // for QFile
+#include <QFileInfo>           // for QFileInfo
+#include <QIODevice>           // for QIODevice
+#include <QJsonDocument>       // for QJsonDocument, QJsonDocument::Compact
+#include <QJsonParseError>     // for QJsonParseError
+#include <QJsonValue>          // for QJsonValue
+#include <QSaveFile>           // for QSaveFile
+
+#include <algorithm>           // for min, max
+
+#include "defs.h"              // for fatal, warning
+#include "src/core/checkpoint.h"
+
+
+namespace gpsbabel
+{
+
+Checkpoint::Checkpoint(const QString& fname, const QString& input, const char* module) :
+  fname_(fname),
+  input_(QFileInfo(input).absoluteFilePath()),
+  module_(module)
+{
+  if (input == "-") {
+    fatal("%s: A checkpoint can not be kept for standard input.\n", module_);
+  }
+
+  QFile file(fname_);
+  if (!file.exists()) {
+    return;
+  }
+  if (!file.open(QIODevice::ReadOnly)) {
+    fatal("%s: Can not read the checkpoint \"%s\".\n", module_, qPrintable(fname_));
+  }
+  QJsonParseError error;
+  const QJsonObject checkpoint = QJsonDocument::fromJson(file.readAll(), &error).object();
+  if (error.error != QJsonParseError::NoError) {
+    warning("%s: Ignoring the checkpoint \"%s\": %s.\n", module_, qPrintable(fname_),
+            qPrintable(error.errorString()));
+    return;
+  }
+
+  const qint64 offset = checkpoint.value("offset").toInteger();
+  if (offset <= 0) {
+    return;
+  }
+  if (checkpoint.value("input").toString() != input_) {
+    warning("%s: The checkpoint \"%s\" is for \"%s\", reading \"%s\" from the start.\n", module_,
+            qPrintable(fname_), qPrintable(checkpoint.value("input").toString()), qPrintable(input_));
+  } else if ((QFileInfo(input_).size() < offset) ||
+             (digest(offset).toHex() != checkpoint.value("digest").toString().toLatin1())) {
+    warning("%s: \"%s\" has changed since the checkpoint, reading it from the start.\n", module_,
+            qPrintable(input_));
+  } else {
+    offset_ = offset;
+    state_ = checkpoint.value("state").toObject();
+  }
+}
+
+QByteArray
+Checkpoint::digest(qint64 offset) const
+{
+  QFile file(input_);
+  if (!file.open(QIODevice::ReadOnly)) {
+    fatal("%s: Can not read \"%s\".\n", module_, qPrintable(input_));
+  }
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(file.read(std::min(offset, kWindow)));
+  if (offset > kWindow) {
+    file.seek(std::max(offset - kWindow, kWindow));
+    hash.addData(file.read(offset - file.pos()));
+  }
+  return hash.result();
+}
+
+void
+Checkpoint::save(qint64 offset, const QJsonObject& state) const
+{
+  QJsonObject checkpoint;
+  checkpoint.insert("input", input_);
+  checkpoint.insert("offset", offset);
+  checkpoint.insert("digest", QString::fromLatin1(digest(offset).toHex()));
+  checkpoint.insert("state", state);
+
+  QSaveFile file(fname_);
+  if (!file.open(QIODevice::WriteOnly) ||
+      (file.write(QJsonDocument(checkpoint).toJson(QJsonDocument::Compact)) < 0) ||
+      (file.write("\n") < 0) || !file.commit()) {
+    fatal("%s: Can not write the checkpoint \"%s\".\n", module_, qPrintable(fname_));
+  }
+}
+
+} // namespace gpsbabel
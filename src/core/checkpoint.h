@@ -0,0 +1,69 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_CHECKPOINT_H_
+#define SRC_CORE_CHECKPOINT_H_
+
+#include <QByteArray>   // for QByteArray
+#include <QJsonObject>  // for QJsonObject
+#include <QString>      // for QString
+#include <QtGlobal>     // for qint64
+
+namespace gpsbabel
+{
+
+/*
+ * Where the last read of a growing, line oriented input stopped, kept in
+ * a small JSON file between runs, see the checkpoint option of nmea,
+ * unicsv and xcsv.
+ *
+ * Besides the offset of the first byte not read yet the file holds a
+ * hash of the bytes at the start of the input and of those just before
+ * the offset, so an input that has been truncated, rotated or replaced
+ * since is read from its start again, and the state the reader needs to
+ * carry on where it stopped, e.g. the last date seen.  Only a few KB of
+ * the input are read to check it, however long it has grown.
+ */
+class Checkpoint
+{
+public:
+  Checkpoint(const QString& fname, const QString& input, const char* module);
+
+  /* The offset to resume at, 0 without a checkpoint that fits the input. */
+  qint64 offset() const {return offset_;}
+  const QJsonObject& state() const {return state_;}
+
+  /* Records that the input has been read up to offset. */
+  void save(qint64 offset, const QJsonObject& state) const;
+
+private:
+  static constexpr qint64 kWindow = 4096;
+
+  QByteArray digest(qint64 offset) const;
+
+  QString fname_;
+  QString input_;
+  const char* module_;
+  qint64 offset_{0};
+  QJsonObject state_;
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_CHECKPOINT_H_
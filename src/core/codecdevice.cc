@@ -27,6 +27,7 @@
 
 #include "defs.h"      // for list_codecs, warning
 #include "codecdevice.h"
+#include "src/core/codepage.h"  // for Codepage
 
 namespace gpsbabel
 {
@@ -53,6 +54,7 @@ bool CodecDevice::open(QIODevice::OpenMode mode)
   if (mode & QIODevice::ReadOnly) {
     decoder_ = codec_->makeDecoder();
   }
+  codepage_ = Codepage::find(codec_);
 
   if (mode & QIODevice::WriteOnly) {
     encoder_ = codec_->makeEncoder();
@@ -92,7 +94,12 @@ qint64 CodecDevice::readData(char* data, qint64 maxlen)
       return -1;
     }
 
-    unicodebuffer_ = decoder_->toUnicode(charbuffer_, bytesread);
+    if (codepage_ != nullptr) {
+      unicodebuffer_.resize(bytesread);
+      codepage_->decode(charbuffer_, bytesread, reinterpret_cast<char16_t*>(unicodebuffer_.data()));
+    } else {
+      unicodebuffer_ = decoder_->toUnicode(charbuffer_, bytesread);
+    }
     unicodebuffer_bytes_ = unicodebuffer_.size() * sizeof(QChar);
     unicodebuffer_data_ = reinterpret_cast<const char*>(unicodebuffer_.constData());
   }
@@ -113,7 +120,7 @@ qint64 CodecDevice::writeData(const char* data, qint64 len)
 
     if (charbuffer_bytes_free_ == 0) {
       static_assert(charbuffer_size_%sizeof(QChar) == 0);
-      QByteArray ba = encoder_->fromUnicode(reinterpret_cast<const QChar*>(charbuffer_), charbuffer_size_/sizeof(QChar));
+      QByteArray ba = encode(reinterpret_cast<const QChar*>(charbuffer_), charbuffer_size_/sizeof(QChar));
       file_->write(ba);
       charbuffer_data_ = charbuffer_;
       charbuffer_bytes_free_ = charbuffer_size_;
@@ -122,12 +129,28 @@ qint64 CodecDevice::writeData(const char* data, qint64 len)
   return len;
 }
 
+/*
+ * A simple codepage encodes from its tables, unless a character isn't in
+ * them or the codec is waiting for the second half of a surrogate pair.
+ */
+QByteArray CodecDevice::encode(const QChar* data, qsizetype count)
+{
+  if ((codepage_ != nullptr) && !encoder_pending_) {
+    QByteArray ba(count, Qt::Uninitialized);
+    if (codepage_->encode(reinterpret_cast<const char16_t*>(data), count, ba.data())) {
+      return ba;
+    }
+  }
+  encoder_pending_ = (count > 0) && data[count - 1].isHighSurrogate();
+  return encoder_->fromUnicode(data, count);
+}
+
 void CodecDevice::close()
 {
   if (charbuffer_bytes_free_ < charbuffer_size_) {
     qint64 bytes = charbuffer_size_ - charbuffer_bytes_free_;
     assert(bytes%sizeof(QChar) == 0);
-    QByteArray ba = encoder_->fromUnicode(reinterpret_cast<const QChar*>(charbuffer_), bytes/sizeof(QChar));
+    QByteArray ba = encode(reinterpret_cast<const QChar*>(charbuffer_), bytes/sizeof(QChar));
     file_->write(ba);
     charbuffer_data_ = charbuffer_;
     charbuffer_bytes_free_ = charbuffer_size_;
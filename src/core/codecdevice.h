@@ -21,13 +21,15 @@
 
 #include <QIODevice>        // for QIODevice
 #include <QIODeviceBase>    // for QIODeviceBase::OpenMode
+#include <QByteArray>       // for QByteArray
 #include <QString>          // for QString
 #include <QTextCodec>       // for QTextCodec
 #include <QTextDecoder>     // for QTextDecoder
 #include <QTextEncoder>     // for QTextEncoder
 #include <QtGlobal>         // for qint64
 
-#include "src/core/file.h"  // for File
+#include "src/core/codepage.h"  // for Codepage
+#include "src/core/file.h"      // for File
 
 namespace gpsbabel
 {
@@ -44,6 +46,7 @@ public:
 private:
   qint64 readData(char* data, qint64 maxlen) override;
   qint64 writeData(const char* data, qint64 len) override;
+  QByteArray encode(const QChar* data, qsizetype count);
 
 private:
   QString fname_;
@@ -53,6 +56,8 @@ private:
   QTextCodec* codec_{nullptr};
   QTextDecoder* decoder_{nullptr};
   QTextEncoder* encoder_{nullptr};
+  const Codepage* codepage_{nullptr};  // if the codec is a simple one
+  bool encoder_pending_{false};        // if encoder_ holds half a pair
   QString unicodebuffer_;
   qint64 unicodebuffer_bytes_{0};
   const char* unicodebuffer_data_{nullptr};
@@ -0,0 +1,155 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <algorithm>              // for find, lower_bound, sort, unique
+#include <iterator>               // for begin, end
+#include <memory>                 // for unique_ptr
+#include <mutex>                  // for lock_guard, mutex
+#include <unordered_map>          // for unordered_map
+
+#include <QByteArray>             // for QByteArray
+#include <QChar>                  // for QChar
+#include <QString>                // for QString
+
+#include "src/core/charscan.h"    // for narrow_ascii, widen_ascii
+#include "src/core/codepage.h"
+
+namespace gpsbabel
+{
+
+namespace
+{
+
+/*
+ * The codecs known to map each byte to a character on its own.  Others,
+ * like Shift_JIS, may only seem to when asked about one byte at a time.
+ */
+constexpr int kSingleByteMibs[] = {
+  3,                          // US-ASCII
+  4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 109, 110, 111, 112,  // ISO-8859-1 to 16
+  2004,                       // hp-roman8
+  2009, 2010, 2011, 2086,     // IBM850, IBM852, IBM437, IBM866
+  2027,                       // macintosh
+  2084, 2088,                 // KOI8-R, KOI8-U
+  2250, 2251, 2252, 2253, 2254, 2255, 2256, 2257, 2258  // windows-1250 to 1258
+};
+
+} // namespace
+
+Codepage::Codepage(QTextCodec* codec)
+{
+  const int mib = codec->mibEnum();
+  if (std::find(std::begin(kSingleByteMibs), std::end(kSingleByteMibs), mib) == std::end(kSingleByteMibs)) {
+    return;
+  }
+
+  from_latin1_.fill(-1);
+  for (int b = 0; b < 256; ++b) {
+    const char byte = static_cast<char>(b);
+    const QString text = codec->toUnicode(&byte, 1);
+    if (text.size() != 1) {
+      return;
+    }
+    const char16_t u = text.at(0).unicode();
+    if ((b < 0x80) && (u != b)) {
+      return;
+    }
+    to_unicode_[b] = u;
+
+    if (u == QChar::ReplacementCharacter) {
+      continue;
+    }
+    const QChar uc(u);
+    const QByteArray encoded = codec->fromUnicode(&uc, 1);
+    if (encoded.size() != 1) {
+      if (b < 0x80) {
+        return;
+      }
+      continue;
+    }
+    if ((b < 0x80) && (encoded.at(0) != byte)) {
+      return;
+    }
+    if (u < 0x100) {
+      from_latin1_[u] = static_cast<unsigned char>(encoded.at(0));
+    } else {
+      from_other_.emplace_back(u, encoded.at(0));
+    }
+  }
+  // Bytes decoded to the same character all encode to the same byte.
+  std::sort(from_other_.begin(), from_other_.end());
+  from_other_.erase(std::unique(from_other_.begin(), from_other_.end()), from_other_.end());
+  valid_ = true;
+}
+
+const Codepage* Codepage::find(QTextCodec* codec)
+{
+  static std::mutex lock;
+  static std::unordered_map<QTextCodec*, std::unique_ptr<Codepage>> codepages;
+
+  if (codec == nullptr) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> guard(lock);
+  auto& codepage = codepages[codec];
+  if (codepage == nullptr) {
+    codepage.reset(new Codepage(codec));
+  }
+  return codepage->valid_ ? codepage.get() : nullptr;
+}
+
+void Codepage::decode(const char* in, qsizetype len, char16_t* out) const
+{
+  qsizetype i = 0;
+  while (i < len) {
+    i += widen_ascii(in + i, len - i, out + i);
+    for (; (i < len) && (static_cast<unsigned char>(in[i]) >= 0x80); ++i) {
+      out[i] = to_unicode_[static_cast<unsigned char>(in[i])];
+    }
+  }
+}
+
+bool Codepage::encode(const char16_t* in, qsizetype len, char* out) const
+{
+  qsizetype i = 0;
+  while (i < len) {
+    i += narrow_ascii(in + i, len - i, out + i);
+    for (; (i < len) && (in[i] >= 0x80); ++i) {
+      const char16_t u = in[i];
+      if (u < 0x100) {
+        if (from_latin1_[u] < 0) {
+          return false;
+        }
+        out[i] = static_cast<char>(from_latin1_[u]);
+      } else {
+        auto it = std::lower_bound(from_other_.cbegin(), from_other_.cend(), u,
+                                   [](const auto& pair, char16_t key) {
+                                     return pair.first < key;
+                                   });
+        if ((it == from_other_.cend()) || (it->first != u)) {
+          return false;
+        }
+        out[i] = it->second;
+      }
+    }
+  }
+  return true;
+}
+
+} // namespace gpsbabel
@@ -0,0 +1,67 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_CODEPAGE_H_
+#define SRC_CORE_CODEPAGE_H_
+
+#include <array>        // for array
+#include <utility>      // for pair
+#include <vector>       // for vector
+
+#include <QTextCodec>   // for QTextCodec
+#include <QtGlobal>     // for qsizetype
+
+namespace gpsbabel
+{
+
+/*
+ * The mapping of a single byte codepage that keeps ASCII as it is, like
+ * ISO-8859-x, windows-125x, the DOS and Mac codepages and US-ASCII, as
+ * tables built once from its QTextCodec.  CodecDevice and TextStream use
+ * it so that such text doesn't go through the generic codec machinery,
+ * and copy runs of ASCII without looking them up at all.
+ *
+ * The tables hold what the codec does with each byte and with each
+ * character one of the bytes is decoded to, so decoding gives what the
+ * codec would.  encode() gives up on any other character, for which the
+ * caller should ask the codec, which may substitute or approximate it.
+ */
+class Codepage
+{
+public:
+  /* The codepage of codec, or nullptr if it isn't such a codepage. */
+  static const Codepage* find(QTextCodec* codec);
+
+  /* len bytes to len characters. */
+  void decode(const char* in, qsizetype len, char16_t* out) const;
+  /* len characters to len bytes, false if one of them has no byte. */
+  bool encode(const char16_t* in, qsizetype len, char* out) const;
+
+private:
+  explicit Codepage(QTextCodec* codec);
+
+  bool valid_{false};
+  std::array<char16_t, 256> to_unicode_{};
+  std::array<short, 256> from_latin1_{};  // U+0000 to U+00FF, -1 for none
+  std::vector<std::pair<char16_t, char>> from_other_;  // sorted
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_CODEPAGE_H_
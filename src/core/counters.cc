@@ -0,0 +1,108 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <cstring>                // for strcmp
+#include <utility>                // for as_const
+
+#include <QHash>                  // for QHash
+#include <QList>                  // for QList
+#include <QMap>                   // for QMap
+#include <QMutex>                 // for QMutex, QMutexLocker
+#include <QString>                // for QString
+#include <QtGlobal>               // for qint64, qPrintable
+
+#include "defs.h"                 // for warning
+#include "src/core/counters.h"
+
+namespace gpsbabel
+{
+
+namespace
+{
+
+/*
+ * The counters defined at namespace scope register themselves while
+ * the program starts, so the list is made on first use.
+ */
+QList<const Counter*>& registry()
+{
+  static QList<const Counter*> counters;
+  return counters;
+}
+
+QMutex mutex;
+QHash<QString, qint64> dynamic_counters;
+
+} // namespace
+
+std::atomic<bool> Counters::enabled_{false};
+
+Counter::Counter(const char* name) : name_(name)
+{
+  registry().append(this);
+}
+
+void Counters::enable()
+{
+  enabled_.store(true, std::memory_order_relaxed);
+}
+
+qint64 Counters::value(const char* name)
+{
+  for (const Counter* counter : std::as_const(registry())) {
+    if (strcmp(counter->name(), name) == 0) {
+      return counter->value();
+    }
+  }
+  return 0;
+}
+
+void Counters::add(const QString& name, qint64 n)
+{
+  if (enabled() && (n != 0)) {
+    QMutexLocker locker(&mutex);
+    dynamic_counters[name] += n;
+  }
+}
+
+/* All counters that counted something, by name. */
+void Counters::dump()
+{
+  if (!enabled()) {
+    return;
+  }
+  QMap<QString, qint64> counts;
+  for (const Counter* counter : std::as_const(registry())) {
+    if (counter->value() != 0) {
+      counts.insert(QString::fromLatin1(counter->name()), counter->value());
+    }
+  }
+  {
+    QMutexLocker locker(&mutex);
+    for (auto it = dynamic_counters.cbegin(); it != dynamic_counters.cend(); ++it) {
+      counts.insert(it.key(), it.value());
+    }
+  }
+  warning("Counters:\n");
+  for (auto it = counts.cbegin(); it != counts.cend(); ++it) {
+    warning("  %-40s %lld\n", qPrintable(it.key()), static_cast<long long>(it.value()));
+  }
+}
+
+} // namespace gpsbabel
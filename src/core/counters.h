@@ -0,0 +1,83 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_COUNTERS_H_
+#define SRC_CORE_COUNTERS_H_
+
+#include <atomic>   // for atomic, memory_order_relaxed
+
+#include <QString>  // for QString
+#include <QtGlobal> // for qint64
+
+namespace gpsbabel
+{
+
+/*
+ * How often the hot paths ran, e.g. how many XML elements were
+ * dispatched or how many distances were computed, printed at exit with
+ * -C or a debug level of 2 or more.
+ *
+ * Counting is off until enable() is called.  While it is off a Counter
+ * costs a test of one flag, so counters can stay in hot code.  Counters
+ * may be bumped on any thread.
+ */
+class Counters
+{
+public:
+  static void enable();
+  static bool enabled() {return enabled_.load(std::memory_order_relaxed);}
+  static qint64 value(const char* name);
+  /* Counters made up at run time, e.g. one per filter. */
+  static void add(const QString& name, qint64 n);
+  static void dump();
+
+private:
+  static std::atomic<bool> enabled_;
+};
+
+/*
+ * A counter with a fixed name, defined at namespace scope next to the
+ * code it counts.  It registers itself on construction.
+ */
+class Counter
+{
+public:
+  explicit Counter(const char* name);
+  Counter(const Counter&) = delete;
+  Counter& operator=(const Counter&) = delete;
+  Counter(Counter&&) = delete;
+  Counter& operator=(Counter&&) = delete;
+
+  void add(qint64 n = 1)
+  {
+    if (Counters::enabled()) {
+      value_.fetch_add(n, std::memory_order_relaxed);
+    }
+  }
+  const char* name() const {return name_;}
+  qint64 value() const {return value_.load(std::memory_order_relaxed);}
+
+private:
+  const char* name_;
+  std::atomic<qint64> value_{0};
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_COUNTERS_H_
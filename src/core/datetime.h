@@ -61,6 +61,21 @@ public:
   DateTime(const QDate& date, const QTime& time) : QDateTime(date, time) {}
   DateTime(const QDateTime& dt) : QDateTime(dt) {}
 
+  // Qt6 stores a Qt::UTC QDateTime as milliseconds since the epoch
+  // inside the object itself, so such a DateTime is pointer sized, never
+  // allocates and is cheap to copy.  Other time specs attach a heap
+  // allocated, reference counted private, so prefer this for per-point
+  // data and convert to other specs only when a format needs them.
+  static DateTime fromMSecsSinceEpochUtc(qint64 msecs)
+  {
+    return QDateTime::fromMSecsSinceEpoch(msecs, Qt::UTC);
+  }
+
+  [[nodiscard]] bool isUtc() const
+  {
+    return timeSpec() == Qt::UTC;
+  }
+
   // Temporary: Override the standard, also handle time_t 0 as invalid.
   [[nodiscard]] bool isValid() const
   {
@@ -91,6 +106,9 @@ public:
   }
 };
 
+// DateTime must not add any state of its own to QDateTime.
+static_assert(sizeof(DateTime) == sizeof(QDateTime));
+
 } // namespace gpsbabel
 
 #endif // DATETIME_H_INCLUDED_
@@ -0,0 +1,137 @@
+/*
+    Copyright (C) 2013 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <QBuffer>                // for QBuffer
+#include <QFile>                  // for QFile
+#include <QFileInfo>              // for QFileInfo
+#include <QIODevice>              // for QIODevice, QIODevice::WriteOnly, QIODevice::Unbuffered
+#include <QStringBuilder>         // for operator%
+#include <cstdio>                 // for stdin, stdout
+
+#include "src/core/file.h"
+#include "src/core/inputmapping.h"  // for InputMapping
+#include "src/core/logging.h"     // for FatalMsg
+#include "src/core/memoryfile.h"  // for MemoryFiles
+#include "src/core/progress.h"    // for Progress
+
+namespace gpsbabel
+{
+
+File::~File()
+{
+  if (in_memory_) {
+    close();
+  }
+}
+
+bool File::open(OpenMode mode)
+{
+  bool status;
+
+  if (MemoryFiles::contains(QFile::fileName())) {
+    in_memory_ = true;
+    if (!(mode & QIODevice::WriteOnly)) {
+      buffer_.setData(MemoryFiles::value(QFile::fileName()));
+    }
+    buffer_.open(mode);
+    // Our buffer is all the buffering there is.
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+  }
+
+  if (QFile::fileName() == "-") {
+    if (mode & QIODevice::WriteOnly) {
+      status = QFile::open(stdout, mode);
+    } else {
+      status = QFile::open(stdin, mode);
+    }
+  } else {
+    if (mode & QIODevice::WriteOnly) {
+      InputMapping::release(QFile::fileName());
+    }
+    status =  QFile::open(mode);
+  }
+
+  if (!status) {
+    fatal(FatalMsg().noquote() << "Cannot open '" %
+      (gpsbabel_testmode() ?
+        QFileInfo(*this).fileName() :
+        QFileInfo(*this).absoluteFilePath()) %
+      "' for " %
+      (mode & QIODevice::WriteOnly ? "write" : "read") %
+      ".  Error was '" %
+      QFile::errorString()  %
+      "'.");
+  }
+  return status;
+}
+
+void File::close()
+{
+  if (!in_memory_) {
+    QFile::close();
+    return;
+  }
+
+  if (isOpen() && (openMode() & QIODevice::WriteOnly)) {
+    MemoryFiles::insert(QFile::fileName(), buffer_.data());
+  }
+  buffer_.close();
+  buffer_.setData(QByteArray());
+  QIODevice::close();
+  in_memory_ = false;
+}
+
+bool File::isSequential() const
+{
+  return in_memory_? false : QFile::isSequential();
+}
+
+qint64 File::size() const
+{
+  return in_memory_? buffer_.size() : QFile::size();
+}
+
+bool File::seek(qint64 pos)
+{
+  if (!in_memory_) {
+    return QFile::seek(pos);
+  }
+  return QIODevice::seek(pos) && buffer_.seek(pos);
+}
+
+bool File::atEnd() const
+{
+  return in_memory_? QIODevice::atEnd() : QFile::atEnd();
+}
+
+qint64 File::readData(char* data, qint64 maxlen)
+{
+  qint64 count = in_memory_? buffer_.read(data, maxlen) : QFile::readData(data, maxlen);
+  if (count > 0) {
+    gpsbabel::Progress::bytes(count);
+  }
+  return count;
+}
+
+qint64 File::writeData(const char* data, qint64 len)
+{
+  return in_memory_? buffer_.write(data, len) : QFile::writeData(data, len);
+}
+
+} // namespace gpsbabel
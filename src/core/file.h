@@ -20,10 +20,12 @@
 #ifndef SRC_CORE_FILE_INCLUDED_H_
 #define SRC_CORE_FILE_INCLUDED_H_
 
+#include <QBuffer>
 #include <QFile>
 #include <QFileInfo>
 #include <QStringBuilder>
 #include <QIODevice>
+#include <QtGlobal>
 #include <cstdio>
 #include "src/core/logging.h"
 #include "defs.h"
@@ -36,36 +38,30 @@ namespace gpsbabel
 class File : public QFile
 {
 public:
-    explicit File(const QString& s) : QFile(s) {}
+  explicit File(const QString& s) : QFile(s) {}
+  ~File() override;
+  File(const File&) = delete;
+  File& operator=(const File&) = delete;
+  File(File&&) = delete;
+  File& operator=(File&&) = delete;
 
   /* in the tradition of gbfile we assume WriteOnly or ReadOnly, not ReadWrite */
-  bool open(OpenMode mode) override {
-    bool status;
+  bool open(OpenMode mode) override;
+  void close() override;
 
-    if (QFile::fileName() == "-") {
-      if (mode & QIODevice::WriteOnly) {
-        status = QFile::open(stdout, mode);
-      } else {
-        status = QFile::open(stdin, mode);
-      }
-    } else {
-      status =  QFile::open(mode);
-    }
+  /* Files registered with MemoryFiles are read from and written to memory. */
+  bool isSequential() const override;
+  qint64 size() const override;
+  bool seek(qint64 pos) override;
+  bool atEnd() const override;
 
-    if (!status) {
-      fatal(FatalMsg().noquote() << "Cannot open '" %
-        (gpsbabel_testmode() ?
-          QFileInfo(*this).fileName() :
-          QFileInfo(*this).absoluteFilePath()) %
-        "' for " %
-        (mode & QIODevice::WriteOnly ? "write" : "read") %
-        ".  Error was '" %
-        QFile::errorString()  %
-        "'.");
-    }
-    return status;
-  }
+protected:
+  qint64 readData(char* data, qint64 maxlen) override;
+  qint64 writeData(const char* data, qint64 len) override;
 
+private:
+  bool in_memory_{false};
+  QBuffer buffer_;
 };
 
 } // namespace gpsbabel
@@ -0,0 +1,107 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_FIXEDRECORD_H_
+#define SRC_CORE_FIXEDRECORD_H_
+
+#include <cstddef>         // for size_t
+#include <type_traits>     // for is_arithmetic_v
+
+#include <QByteArrayView>  // for QByteArrayView
+#include <QtEndian>        // for qFromBigEndian, qFromLittleEndian
+#include <QtGlobal>        // for qsizetype
+
+namespace gpsbabel
+{
+
+/*
+ * Decoding of files made of records of one fixed size, as many loggers
+ * write them.
+ *
+ * A field is described by its type, its offset in the record and its
+ * byte order, e.g.
+ *
+ *   using Latitude = RecordField<double, 4>;
+ *
+ * and read from a FixedRecords view with records.get<Latitude>(i).  The
+ * offsets are checked against the record size at compile time and the
+ * number of whole records once for the buffer, so a field read is just
+ * an unaligned load, plus a byte swap for the other byte order.
+ */
+enum class ByteOrder {
+  little,
+  big
+};
+
+template <typename T, std::size_t Offset, ByteOrder Order = ByteOrder::little>
+struct RecordField {
+  static_assert(std::is_arithmetic_v<T>, "fields are numbers");
+
+  using type = T;
+  static constexpr std::size_t offset = Offset;
+  static constexpr std::size_t end = Offset + sizeof(T);
+
+  static T get(const char* record)
+  {
+    if constexpr (Order == ByteOrder::little) {
+      return qFromLittleEndian<T>(record + Offset);
+    } else {
+      return qFromBigEndian<T>(record + Offset);
+    }
+  }
+};
+
+template <std::size_t Size>
+class FixedRecords
+{
+public:
+  static constexpr std::size_t record_size = Size;
+
+  explicit FixedRecords(QByteArrayView data) : data_(data) {}
+
+  // The number of whole records, any partial record at the end is left out.
+  qsizetype count() const
+  {
+    return data_.size() / static_cast<qsizetype>(Size);
+  }
+  // Whether the data ends with a partial record.
+  bool has_remainder() const
+  {
+    return (data_.size() % static_cast<qsizetype>(Size)) != 0;
+  }
+
+  const char* record(qsizetype i) const
+  {
+    return data_.data() + i * static_cast<qsizetype>(Size);
+  }
+
+  template <typename Field>
+  typename Field::type get(qsizetype i) const
+  {
+    static_assert(Field::end <= Size, "field extends past the end of the record");
+    return Field::get(record(i));
+  }
+
+private:
+  QByteArrayView data_;
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_FIXEDRECORD_H_
@@ -0,0 +1,59 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_FOOTPRINT_H_
+#define SRC_CORE_FOOTPRINT_H_
+
+#include <cstddef>     // for size_t
+
+#include <QByteArray>  // for QByteArray
+#include <QChar>       // for QChar
+#include <QList>       // for QList
+#include <QString>     // for QString
+
+namespace gpsbabel
+{
+
+/*
+ * The heap memory held by the contents of a container, which the
+ * memory_usage() functions of the data add to their own size.  Data
+ * shared with other copies is counted for every copy, and the headers
+ * of the heap blocks and the allocator's overhead are left out, so the
+ * figures are estimates on the high side for copies and on the low
+ * side otherwise.
+ */
+inline std::size_t heap_bytes(const QString& s)
+{
+  return s.capacity() * sizeof(QChar);
+}
+
+inline std::size_t heap_bytes(const QByteArray& b)
+{
+  return b.capacity();
+}
+
+template <typename T>
+std::size_t heap_bytes(const QList<T>& l)
+{
+  return l.capacity() * sizeof(T);
+}
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_FOOTPRINT_H_
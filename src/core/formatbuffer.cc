@@ -0,0 +1,77 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <charconv>     // for to_chars, chars_format
+#include <cmath>        // for isfinite, signbit
+#include <cstdio>       // for snprintf
+
+#include "src/core/formatbuffer.h"
+
+namespace gpsbabel
+{
+
+void FormatBuffer::put_padded(const char* digits, std::size_t len, int width)
+{
+  if (static_cast<int>(len) < width) {
+    std::size_t sign = (*digits == '-') ? 1 : 0;
+    buffer_.append(digits, sign);
+    buffer_.append(width - len, '0');
+    buffer_.append(digits + sign, len - sign);
+  } else {
+    buffer_.append(digits, len);
+  }
+}
+
+FormatBuffer& FormatBuffer::put_int(long long value, int width)
+{
+  char digits[24];
+  auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), value);
+  put_padded(digits, end - digits, width);
+  return *this;
+}
+
+FormatBuffer& FormatBuffer::put_hex(unsigned long long value, int width)
+{
+  static constexpr char hex[] = "0123456789ABCDEF";
+  char digits[16];
+  char* p = digits + sizeof(digits);
+  do {
+    *--p = hex[value & 0xf];
+    value >>= 4;
+  } while (value != 0);
+  put_padded(p, digits + sizeof(digits) - p, width);
+  return *this;
+}
+
+FormatBuffer& FormatBuffer::put_fixed(double value, int precision, int width)
+{
+  char digits[352];  // DBL_MAX has 309 digits before the point
+  if (!std::isfinite(value)) {
+    // Leave the spelling of inf and nan to printf.
+    int len = snprintf(digits, sizeof(digits), "%.*f", precision, value);
+    buffer_.append(digits, len);
+    return *this;
+  }
+  auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), value,
+                                 std::chars_format::fixed, precision);
+  put_padded(digits, end - digits, width);
+  return *this;
+}
+
+} // namespace gpsbabel
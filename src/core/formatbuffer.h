@@ -0,0 +1,85 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_FORMATBUFFER_H_
+#define SRC_CORE_FORMATBUFFER_H_
+
+#include <cstddef>      // for size_t
+#include <string_view>  // for string_view
+
+#include <QByteArray>   // for QByteArray
+#include <QtGlobal>     // for qsizetype
+
+namespace gpsbabel
+{
+
+/*
+ * Text built up one typed field at a time, without a printf format
+ * string to parse.  Numbers are converted with std::to_chars and give
+ * the same text printf does for the conversions named next to them.
+ * Writers fill a buffer with many records before handing it to gbfwrite
+ * or a device, and clear() keeps the storage for the next batch.
+ */
+class FormatBuffer
+{
+public:
+  FormatBuffer& put(char c)
+  {
+    buffer_.append(c);
+    return *this;
+  }
+  FormatBuffer& put(const char* s)
+  {
+    buffer_.append(s);
+    return *this;
+  }
+  FormatBuffer& put(std::string_view s)
+  {
+    buffer_.append(s.data(), s.size());
+    return *this;
+  }
+  FormatBuffer& put(const QByteArray& s)
+  {
+    buffer_.append(s);
+    return *this;
+  }
+
+  /* %d, and with a width %0<width>d */
+  FormatBuffer& put_int(long long value, int width = 0);
+  /* %0<width>X */
+  FormatBuffer& put_hex(unsigned long long value, int width = 0);
+  /* %.<precision>f, and with a width %0<width>.<precision>f */
+  FormatBuffer& put_fixed(double value, int precision, int width = 0);
+
+  const char* data() const {return buffer_.constData();}
+  qsizetype size() const {return buffer_.size();}
+  bool isEmpty() const {return buffer_.isEmpty();}
+  void clear() {buffer_.resize(0);}
+  void truncate(qsizetype size) {buffer_.truncate(size);}
+
+private:
+  /* Appends digits, zero filled after any sign to width characters. */
+  void put_padded(const char* digits, std::size_t len, int width);
+
+  QByteArray buffer_;
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_FORMATBUFFER_H_
@@ -0,0 +1,138 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <cstdint>                // for SIZE_MAX
+#include <utility>                // for as_const
+
+#include <QFile>                  // for QFile
+#include <QFileDevice>            // for QFileDevice::MapPrivateOption
+#include <QFileInfo>              // for QFileInfo
+#include <QIODevice>              // for QIODevice::ReadOnly
+#include <QList>                  // for QList
+#include <QMutex>                 // for QMutex, QMutexLocker
+#include <QString>                // for QString
+#include <QtGlobal>               // for quint64, Q_OS_WIN, Q_UNUSED
+
+#include "src/core/counters.h"    // for Counter
+#include "src/core/inputmapping.h"
+#include "src/core/memoryfile.h"  // for MemoryFiles
+#include "src/core/progress.h"    // for Progress
+
+namespace gpsbabel
+{
+
+namespace
+{
+
+Counter mapped_counter("input.mapped_bytes");
+Counter released_counter("input.released_bytes");
+
+// The mappings that are alive, for release().
+QMutex mutex;
+QList<InputMapping*> live;
+
+} // namespace
+
+InputMapping::~InputMapping()
+{
+  {
+    QMutexLocker locker(&mutex);
+    live.removeOne(this);
+  }
+  file_.unmap(data_);
+}
+
+QExplicitlySharedDataPointer<InputMapping> InputMapping::map(const QFile* file)
+{
+#ifdef Q_OS_WIN
+  // A file that is mapped can't be truncated, even once it's copied.
+  Q_UNUSED(file);
+  return {};
+#else
+  const QString fname = file->fileName();
+  if ((fname == "-") || MemoryFiles::contains(fname) || (file->pos() != 0)) {
+    return {};
+  }
+
+  QExplicitlySharedDataPointer<InputMapping> mapping(new InputMapping);
+  mapping->file_.setFileName(fname);
+  if (!mapping->file_.open(QIODevice::ReadOnly)) {
+    return {};
+  }
+  // Empty files can't be mapped and big ones don't fit in 32 bit memory.
+  mapping->size_ = mapping->file_.size();
+  if ((mapping->size_ == 0) || (static_cast<quint64>(mapping->size_) > SIZE_MAX / 2)) {
+    return {};
+  }
+  mapping->data_ = mapping->file_.map(0, mapping->size_, QFileDevice::MapPrivateOption);
+  if (mapping->data_ == nullptr) {
+    return {};
+  }
+  mapping->path_ = QFileInfo(fname).canonicalFilePath();
+
+  Progress::bytes(mapping->size_);
+  mapped_counter.add(mapping->size_);
+  QMutexLocker locker(&mutex);
+  live.append(mapping.data());
+  return mapping;
+#endif
+}
+
+void InputMapping::release(const QString& fname)
+{
+  QMutexLocker locker(&mutex);
+  if (live.isEmpty()) {
+    return;
+  }
+  const QString path = QFileInfo(fname).canonicalFilePath();
+  if (path.isEmpty()) {
+    return;
+  }
+  for (InputMapping* mapping : std::as_const(live)) {
+    if ((mapping->path_ == path) && !mapping->released_) {
+      mapping->copy_pages();
+    }
+  }
+}
+
+void InputMapping::detach()
+{
+  QMutexLocker locker(&mutex);
+  if (!released_) {
+    copy_pages();
+  }
+}
+
+/*
+ * Writing to a page of a private mapping gives the process its own copy
+ * of it, which no longer changes with the file nor goes away when the
+ * file is truncated.  Writing each byte back is enough.
+ */
+void InputMapping::copy_pages()
+{
+  constexpr qint64 kPageSize = 4096;  // or a part of a page
+  for (qint64 i = 0; i < size_; i += kPageSize) {
+    volatile uchar* p = data_ + i;
+    *p = *p;
+  }
+  released_ = true;
+  released_counter.add(size_);
+}
+
+} // namespace gpsbabel
@@ -0,0 +1,87 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_INPUTMAPPING_H_
+#define SRC_CORE_INPUTMAPPING_H_
+
+#include <QByteArray>   // for QByteArray
+#include <QFile>        // for QFile
+#include <QSharedData>  // for QSharedData, QExplicitlySharedDataPointer
+#include <QString>      // for QString
+#include <QtGlobal>     // for qint64, uchar
+
+namespace gpsbabel
+{
+
+/*
+ * An input file mapped into memory, for text that refers to its bytes
+ * rather than being copied out of it, see Utf8String::fromInput().  The
+ * mapping stays as long as anything refers to it.
+ *
+ * The mapping is private, but until a page is copied it still shows
+ * the file, so another process rewriting or truncating the file would
+ * change the text or fault on it.  Before a file that is mapped is
+ * written release() has every page copied, and the reader calls
+ * detach() once it is done with the file, so the text that refers to
+ * it keeps its bytes whatever becomes of the file.
+ */
+class InputMapping : public QSharedData
+{
+public:
+  /* Special Member Functions */
+
+  InputMapping(const InputMapping&) = delete;
+  InputMapping& operator=(const InputMapping&) = delete;
+  InputMapping(InputMapping&&) = delete;
+  InputMapping& operator=(InputMapping&&) = delete;
+  ~InputMapping();
+
+  /* Member Functions */
+
+  // All of the file that is open for reading at its start, or null if it
+  // is in memory, a pipe, empty, or otherwise can't be mapped.
+  static QExplicitlySharedDataPointer<InputMapping> map(const QFile* file);
+  // To be called before fname is opened for writing.
+  static void release(const QString& fname);
+  // Copies every page, to be called once the file has been read.
+  void detach();
+
+  // Refers to the mapping, so it is only valid as long as the mapping.
+  QByteArray bytes() const
+  {
+    return QByteArray::fromRawData(reinterpret_cast<const char*>(data_), size_);
+  }
+
+private:
+  InputMapping() = default;
+
+  void copy_pages();
+
+  /* Data Members */
+
+  QFile file_;
+  uchar* data_{nullptr};
+  qint64 size_{0};
+  QString path_;  // canonical
+  bool released_{false};
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_INPUTMAPPING_H_
@@ -0,0 +1,352 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <QByteArray>              // for QByteArray
+#include <QChar>                   // for QChar
+#include <QIODevice>               // for QIODevice
+#include <QJsonArray>              // for QJsonArray
+#include <QJsonDocument>           // for QJsonDocument
+#include <QJsonObject>             // for QJsonObject
+#include <QJsonParseError>         // for QJsonParseError, QJsonParseError::NoError
+#include <QJsonValue>              // for QJsonValue
+#include <QString>                 // for QString
+#include <QtGlobal>                // for qsizetype, qint64, qMax
+
+#include "src/core/jsonstream.h"
+
+namespace gpsbabel
+{
+
+JsonArrayStream::JsonArrayStream(QIODevice* device, const QString& array_key) :
+  device_(device),
+  array_key_(array_key)
+{
+}
+
+/*
+ * Make at least count bytes past pos_ available, reading more as needed.
+ * Returns false if the device ends first.
+ */
+bool JsonArrayStream::fill(qsizetype count)
+{
+  while (buf_.size() - pos_ < count) {
+    QByteArray block = device_->read(kBlockSize);
+    if (block.isEmpty()) {
+      return false;
+    }
+    buf_.append(block);
+  }
+  return true;
+}
+
+/*
+ * Step over white space.  Returns false at the end of the input.
+ * Nothing before pos_ is needed between values, so this is where the
+ * consumed part of the buffer is dropped.
+ */
+bool JsonArrayStream::skip_space()
+{
+  if ((pos_ >= kBlockSize) && !keep_) {
+    buf_.remove(0, pos_);
+    consumed_ += pos_;
+    pos_ = 0;
+  }
+  for (;;) {
+    if (!fill(1)) {
+      return false;
+    }
+    const char* data = buf_.constData();
+    while (pos_ < buf_.size()) {
+      char c = data[pos_];
+      if ((c != ' ') && (c != '\t') && (c != '\n') && (c != '\r')) {
+        return true;
+      }
+      ++pos_;
+    }
+  }
+}
+
+bool JsonArrayStream::expect(char c)
+{
+  if (buf_.at(pos_) != c) {
+    fail(QStringLiteral("expected '%1'").arg(QChar::fromLatin1(c)));
+    return false;
+  }
+  ++pos_;
+  return true;
+}
+
+/*
+ * Find the end of the value starting at pos_, following strings and
+ * nesting only.
+ */
+bool JsonArrayStream::scan_value(qsizetype& end)
+{
+  char c = buf_.at(pos_);
+  qsizetype i = pos_;
+  if ((c == '"') || (c == '{') || (c == '[')) {
+    int depth = 0;
+    bool in_string = false;
+    for (;;) {
+      if (!fill(i - pos_ + 1)) {
+        fail(in_string ? QStringLiteral("unterminated string") : QStringLiteral("unterminated value"));
+        return false;
+      }
+      const char* data = buf_.constData();
+      const qsizetype size = buf_.size();
+      for (; i < size; ++i) {
+        c = data[i];
+        if (in_string) {
+          if (c == '\\') {
+            ++i;  // the escaped character, which may be in the next block
+          } else if (c == '"') {
+            in_string = false;
+            if (depth == 0) {
+              end = i + 1;
+              return true;
+            }
+          }
+        } else if (c == '"') {
+          in_string = true;
+        } else if ((c == '{') || (c == '[')) {
+          ++depth;
+        } else if ((c == '}') || (c == ']')) {
+          if (--depth == 0) {
+            end = i + 1;
+            return true;
+          }
+        }
+      }
+    }
+  }
+
+  // A number or literal runs up to the next separator.
+  for (;;) {
+    const char* data = buf_.constData();
+    const qsizetype size = buf_.size();
+    for (; i < size; ++i) {
+      c = data[i];
+      if ((c == ',') || (c == '}') || (c == ']') ||
+          (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r')) {
+        break;
+      }
+    }
+    if ((i < size) || !fill(i - pos_ + 1)) {
+      break;
+    }
+  }
+  if (i == pos_) {
+    fail(QStringLiteral("unexpected character '%1'").arg(QChar::fromLatin1(c)));
+    return false;
+  }
+  end = i;
+  return true;
+}
+
+bool JsonArrayStream::take_value(QJsonValue& value)
+{
+  qsizetype end;
+  if (!scan_value(end)) {
+    return false;
+  }
+
+  // Wrap the value in an array so scalars parse too.
+  QByteArray text;
+  text.reserve(end - pos_ + 2);
+  text.append('[');
+  text.append(buf_.constData() + pos_, end - pos_);
+  text.append(']');
+  QJsonParseError error{};
+  QJsonDocument doc = QJsonDocument::fromJson(text, &error);
+  if (error.error != QJsonParseError::NoError) {
+    pos_ += qMax(0, error.offset - 1);
+    fail(error.errorString());
+    return false;
+  }
+  value = doc.array().at(0);
+  pos_ = end;
+  return true;
+}
+
+void JsonArrayStream::fail(const QString& message)
+{
+  error_ = QStringLiteral("%1 at offset %2").arg(message).arg(consumed_ + pos_);
+  state_ = state_t::done;
+}
+
+bool JsonArrayStream::next(QJsonValue& element)
+{
+  while (state_ != state_t::done) {
+    switch (state_) {
+    case state_t::start:
+      if (!skip_space()) {
+        fail(QStringLiteral("empty document"));
+        return false;
+      }
+      // Skip a UTF-8 byte order mark.
+      if (buf_.startsWith("\xEF\xBB\xBF") && (pos_ == 0)) {
+        pos_ += 3;
+        if (!skip_space()) {
+          fail(QStringLiteral("empty document"));
+          return false;
+        }
+      }
+      if (buf_.at(pos_) != '{') {
+        // Not an object, so there is nothing to stream.
+        state_ = state_t::done;
+        return false;
+      }
+      ++pos_;
+      state_ = state_t::object;
+      first_ = true;
+      break;
+
+    case state_t::object: {
+      if (!skip_space()) {
+        fail(QStringLiteral("unterminated object"));
+        return false;
+      }
+      if (buf_.at(pos_) == '}') {
+        ++pos_;
+        state_ = state_t::done;
+        if (skip_space()) {
+          fail(QStringLiteral("garbage at the end of the document"));
+        }
+        return false;
+      }
+      if (!first_) {
+        if (!expect(',')) {
+          return false;
+        }
+        if (!skip_space()) {
+          fail(QStringLiteral("unterminated object"));
+          return false;
+        }
+      }
+      first_ = false;
+      if (buf_.at(pos_) != '"') {
+        fail(QStringLiteral("expected a member name"));
+        return false;
+      }
+      QJsonValue key;
+      if (!take_value(key)) {
+        return false;
+      }
+      if (!skip_space() || !expect(':')) {
+        if (!has_error()) {
+          fail(QStringLiteral("unterminated object"));
+        }
+        return false;
+      }
+      if (!skip_space()) {
+        fail(QStringLiteral("unterminated object"));
+        return false;
+      }
+      const QString name = key.toString();
+      if ((name == array_key_) && !seen_array_ && (buf_.at(pos_) == '[')) {
+        ++pos_;
+        state_ = state_t::array;
+        first_ = true;
+        seen_array_ = true;
+        break;
+      }
+      QJsonValue value;
+      if (!take_value(value)) {
+        return false;
+      }
+      members_.insert(name, value);
+      if (!peek_name_.isNull() && (name == peek_name_)) {
+        return false;
+      }
+      break;
+    }
+
+    case state_t::array:
+      if (!skip_space()) {
+        fail(QStringLiteral("unterminated array"));
+        return false;
+      }
+      if (buf_.at(pos_) == ']') {
+        ++pos_;
+        state_ = state_t::object;
+        first_ = false;
+        break;
+      }
+      if (!first_) {
+        if (!expect(',')) {
+          return false;
+        }
+        if (!skip_space()) {
+          fail(QStringLiteral("unterminated array"));
+          return false;
+        }
+      }
+      first_ = false;
+      if (peek_name_.isNull()) {
+        return take_value(element);
+      }
+      {
+        qsizetype end;
+        if (!scan_value(end)) {
+          return false;
+        }
+        pos_ = end;
+      }
+      break;
+
+    case state_t::done:
+      break;
+    }
+  }
+  return false;
+}
+
+bool JsonArrayStream::peek_member(const QString& name, QJsonValue& value)
+{
+  // A device that can't seek is started over from what was read of it.
+  const qint64 origin = device_->pos();
+  keep_ = device_->isSequential();
+  peek_name_ = name;
+  QJsonValue element;
+  while (next(element)) {
+  }
+  peek_name_ = QString();
+  const bool found = members_.contains(name);
+  value = members_.value(name);
+  if (has_error()) {
+    keep_ = false;
+    return false;
+  }
+
+  if (keep_) {
+    keep_ = false;
+  } else {
+    device_->seek(origin);
+    buf_.clear();
+    consumed_ = 0;
+  }
+  pos_ = 0;
+  state_ = state_t::start;
+  first_ = true;
+  seen_array_ = false;
+  members_ = QJsonObject();
+  return found;
+}
+
+} // namespace gpsbabel
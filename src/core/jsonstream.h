@@ -0,0 +1,103 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_JSONSTREAM_H_
+#define SRC_CORE_JSONSTREAM_H_
+
+#include <QByteArray>   // for QByteArray
+#include <QIODevice>    // for QIODevice
+#include <QJsonObject>  // for QJsonObject
+#include <QJsonValue>   // for QJsonValue
+#include <QString>      // for QString
+#include <QtGlobal>     // for qsizetype
+
+namespace gpsbabel
+{
+
+/*
+ * Reads the elements of one array member of a JSON document's root
+ * object one at a time, e.g. the features of a GeoJSON FeatureCollection.
+ *
+ * Only one element is held in memory at a time.  The other members of
+ * the root object are kept, and members() holds those seen so far, so a
+ * member that follows the array is only known once next() has returned
+ * false.
+ *
+ * Elements and members are checked as they are decoded.  Members and
+ * elements are located by a scan that only follows strings and nesting,
+ * so errors elsewhere are caught by the scan or not at all.
+ */
+class JsonArrayStream
+{
+public:
+  JsonArrayStream(QIODevice* device, const QString& array_key);
+
+  /* Returns false at the end of the root object or on an error. */
+  bool next(QJsonValue& element);
+
+  /*
+   * Looks for a member of the root object before any element is read,
+   * scanning over the array if the member follows it, and then starts
+   * over from the beginning.  Returns false if the root isn't an object,
+   * has no such member or has_error().
+   */
+  bool peek_member(const QString& name, QJsonValue& value);
+
+  bool seen_array() const {return seen_array_;}
+  const QJsonObject& members() const {return members_;}
+  bool has_error() const {return !error_.isEmpty();}
+  const QString& error_string() const {return error_;}
+
+private:
+  /* Types */
+
+  enum class state_t {start, object, array, done};
+
+  /* Constants */
+
+  static constexpr qsizetype kBlockSize = 64 * 1024;
+
+  /* Member Functions */
+
+  bool fill(qsizetype count);
+  bool skip_space();
+  bool expect(char c);
+  bool scan_value(qsizetype& end);
+  bool take_value(QJsonValue& value);
+  void fail(const QString& message);
+
+  /* Data Members */
+
+  QIODevice* device_;
+  QString array_key_;
+  QByteArray buf_;
+  qsizetype pos_{0};
+  qint64 consumed_{0};     // bytes dropped from the front of buf_
+  state_t state_{state_t::start};
+  bool first_{true};     // no member or element seen yet in the current container
+  bool seen_array_{false};
+  QJsonObject members_;
+  QString error_;
+  QString peek_name_;    // the member peek_member() is looking for
+  bool keep_{false};     // buf_ must hold the whole input to start over
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_JSONSTREAM_H_
@@ -22,6 +22,8 @@
 // A wrapper for QDebug that provides a sensible Warning() and FatalMsg()
 // with convenient functions, stream operators and manipulators.
 
+#include <stdexcept>         // for runtime_error
+
 #include <QDebug>            // for QDebug
 #include <QtGlobal>          // for QtCriticalMsg, QtWarningMsg
 
@@ -49,6 +51,16 @@ public:
   explicit FatalMsg() : QDebug(QtCriticalMsg) {}
 };
 
+/*
+ * Thrown by fatal() instead of exiting after fatal_set_throws(true),
+ * which lets library users survive bad input.
+ */
+class FatalError : public std::runtime_error
+{
+public:
+  using std::runtime_error::runtime_error;
+};
+
 class DebugIndent
 {
 public:
@@ -0,0 +1,56 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <QHash>                  // for QHash
+#include <QMutex>                 // for QMutex
+#include <QMutexLocker>           // for QMutexLocker
+
+#include "src/core/memoryfile.h"
+
+namespace gpsbabel
+{
+
+static QMutex mutex;
+static QHash<QString, QByteArray> files;
+
+bool MemoryFiles::contains(const QString& name)
+{
+  QMutexLocker locker(&mutex);
+  return files.contains(name);
+}
+
+QByteArray MemoryFiles::value(const QString& name)
+{
+  QMutexLocker locker(&mutex);
+  return files.value(name);
+}
+
+void MemoryFiles::insert(const QString& name, const QByteArray& data)
+{
+  QMutexLocker locker(&mutex);
+  files.insert(name, data);
+}
+
+QByteArray MemoryFiles::take(const QString& name)
+{
+  QMutexLocker locker(&mutex);
+  return files.take(name);
+}
+
+} // namespace gpsbabel
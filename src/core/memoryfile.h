@@ -0,0 +1,51 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_MEMORYFILE_H_
+#define SRC_CORE_MEMORYFILE_H_
+
+#include <QByteArray>  // for QByteArray
+#include <QString>     // for QString
+
+namespace gpsbabel
+{
+
+/*
+ * Named in-memory stand-ins for files.
+ *
+ * While a name is registered here gpsbabel::File and gbfopen() read the
+ * registered contents instead of opening a file of that name, and when
+ * a file of that name that was opened for writing is closed its contents
+ * replace the registered ones.  Formats that open files in other ways
+ * are not affected.
+ *
+ * The registry may be used from several threads.
+ */
+class MemoryFiles
+{
+public:
+  static bool contains(const QString& name);
+  static QByteArray value(const QString& name);
+  static void insert(const QString& name, const QByteArray& data);
+  static QByteArray take(const QString& name);
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_MEMORYFILE_H_
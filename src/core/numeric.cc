@@ -0,0 +1,169 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <charconv>             // for from_chars, to_chars, chars_format
+#include <cmath>                // for isfinite
+#include <cstdlib>              // for strtod
+#include <cstring>              // for memcpy, strlen
+#include <system_error>         // for errc
+
+#include <QChar>                // for QChar
+
+#include "src/core/numeric.h"
+
+namespace gpsbabel
+{
+
+/* No double needs more than this many characters to be written exactly
+ * enough to read back, 17 digits plus sign, point and exponent. */
+static constexpr int kMaxNumberLength = 64;
+
+static bool is_space(char c)
+{
+  return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r') || (c == '\f') || (c == '\v');
+}
+
+/* Parses the number at the start of [begin, end), returning the first
+ * character that wasn't used, or begin if there is no number. */
+static const char* parse(const char* begin, const char* end, double* value)
+{
+  const char* p = begin;
+  if ((p < end) && (*p == '+')) {
+    ++p;
+    if ((p < end) && (*p == '-')) {
+      return begin;
+    }
+  }
+  auto [stop, ec] = std::from_chars(p, end, *value, std::chars_format::general);
+  if (ec == std::errc::invalid_argument) {
+    return begin;
+  }
+  if (ec == std::errc::result_out_of_range) {
+    // Let strtod pick between zero and infinity.
+    char buffer[kMaxNumberLength + 1];
+    if ((stop - begin) <= kMaxNumberLength) {
+      std::memcpy(buffer, begin, stop - begin);
+      buffer[stop - begin] = '\0';
+      *value = std::strtod(buffer, nullptr);
+    }
+  }
+  return stop;
+}
+
+double to_double(const char* s, const char** end)
+{
+  const char* start = s;
+  while (is_space(*s)) {
+    ++s;
+  }
+  double value = 0.0;
+  const char* stop = parse(s, s + strlen(s), &value);
+  if ((*stop == 'x') || (*stop == 'X')) {
+    // Hexadecimal, which from_chars only reads without the 0x.
+    char* hex_end;
+    value = std::strtod(start, &hex_end);
+    stop = hex_end;
+  } else if (stop == s) {
+    stop = start;
+    value = 0.0;
+  }
+  if (end != nullptr) {
+    *end = stop;
+  }
+  return value;
+}
+
+/* Copies the ASCII characters at the start of s into buffer, stopping at
+ * white space or anything that can't be part of a number. */
+static int copy_token(QStringView s, char* buffer)
+{
+  int len = 0;
+  while ((len < s.size()) && (len < kMaxNumberLength)) {
+    char16_t c = s.at(len).unicode();
+    if ((c >= 128) || is_space(static_cast<char>(c))) {
+      break;
+    }
+    buffer[len++] = static_cast<char>(c);
+  }
+  return len;
+}
+
+double to_double(QStringView s, bool* ok)
+{
+  s = s.trimmed();
+  char buffer[kMaxNumberLength];
+  int len = copy_token(s, buffer);
+  if (len == kMaxNumberLength) {
+    // Longer than any number needs to be, but still may be one.
+    return s.toDouble(ok);
+  }
+
+  double value = 0.0;
+  bool good = (len == s.size()) && (len > 0) && (parse(buffer, buffer + len, &value) == buffer + len);
+  if (ok != nullptr) {
+    *ok = good;
+  }
+  return good ? value : 0.0;
+}
+
+int scan_doubles(QStringView s, double* values, int count)
+{
+  int found = 0;
+  while (found < count) {
+    while (!s.isEmpty() && s.front().isSpace()) {
+      s = s.mid(1);
+    }
+    char buffer[kMaxNumberLength];
+    int len = copy_token(s, buffer);
+    double value;
+    const char* stop = parse(buffer, buffer + len, &value);
+    if (stop == buffer) {
+      break;
+    }
+    values[found++] = value;
+    s = s.mid(stop - buffer);
+  }
+  return found;
+}
+
+QString to_fixed(double d, int precision)
+{
+  if (!std::isfinite(d)) {
+    return QString::number(d, 'f', precision);
+  }
+  char buffer[352];  // DBL_MAX has 309 digits before the point
+  auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), d,
+                                 std::chars_format::fixed, precision);
+  if (ec != std::errc()) {
+    return QString::number(d, 'f', precision);
+  }
+  return QString::fromLatin1(buffer, end - buffer);
+}
+
+QString to_shortest(double d)
+{
+  if (!std::isfinite(d)) {
+    return QString::number(d);
+  }
+  char buffer[kMaxNumberLength];
+  auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), d);
+  return QString::fromLatin1(buffer, end - buffer);
+}
+
+} // namespace gpsbabel
@@ -0,0 +1,52 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_NUMERIC_H_
+#define SRC_CORE_NUMERIC_H_
+
+#include <QString>      // for QString
+#include <QStringView>  // for QStringView
+
+namespace gpsbabel
+{
+
+/*
+ * Conversions between doubles and text for the per field paths of the
+ * text formats, built on std::from_chars and std::to_chars.  They never
+ * consult the locale and don't need a temporary QByteArray.
+ */
+
+/* As strtod in the C locale: leading white space and a plus sign are
+ * skipped and *end is left at the first character that wasn't used. */
+double to_double(const char* s, const char** end = nullptr);
+/* As QString::toDouble: all of s, less surrounding white space, must be
+ * a number. */
+double to_double(QStringView s, bool* ok = nullptr);
+/* Reads up to count numbers separated by white space from the start of s
+ * the way sscanf(s, "%lf %lf ...") does, returning how many were read. */
+int scan_doubles(QStringView s, double* values, int count);
+
+/* As QString::number(d, 'f', precision). */
+QString to_fixed(double d, int precision);
+/* The shortest text that reads back as exactly d. */
+QString to_shortest(double d);
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_NUMERIC_H_
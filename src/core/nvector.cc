@@ -26,6 +26,9 @@
 #include <cmath>                // for sqrt, atan2, cos, nan, sin, cbrt
 #include <utility>              // for pair
 
+#include <QVector>              // for QVector
+#include <QtGlobal>             // for qsizetype
+
 #include "src/core/vector3d.h"  // for Vector3D
 
 namespace gpsbabel
@@ -62,6 +65,42 @@ NVector::NVector(const Vector3D& v)
   z_ = v.getz();
 }
 
+// The n-vectors of many positions at once, each exactly as the
+// constructor would compute it.
+QVector<NVector> NVector::from_degrees(const QVector<double>& latitudes_degrees, const QVector<double>& longitudes_degrees)
+{
+  const qsizetype count = latitudes_degrees.size();
+  QVector<NVector> result(count);
+  NVector* out = result.data();
+  for (qsizetype i = 0; i < count; ++i) {
+    double latitude_radians = latitudes_degrees.at(i) * kRadiansPerDegree;
+    double longitude_radians = longitudes_degrees.at(i) * kRadiansPerDegree;
+    double cos_latitude = cos(latitude_radians);
+    out[i].x_ = sin(latitude_radians);
+    out[i].y_ = sin(longitude_radians)*cos_latitude;
+    out[i].z_ = -cos(longitude_radians)*cos_latitude;
+  }
+  return result;
+}
+
+// The n-vectors of many positions at once, each exactly as the
+// constructor would compute it.
+QVector<NVector> NVector::from_degrees(const QVector<double>& latitudes_degrees, const QVector<double>& longitudes_degrees)
+{
+  const qsizetype count = latitudes_degrees.size();
+  QVector<NVector> result(count);
+  NVector* out = result.data();
+  for (qsizetype i = 0; i < count; ++i) {
+    double latitude_radians = latitudes_degrees.at(i) * kRadiansPerDegree;
+    double longitude_radians = longitudes_degrees.at(i) * kRadiansPerDegree;
+    double cos_latitude = cos(latitude_radians);
+    out[i].x_ = sin(latitude_radians);
+    out[i].y_ = sin(longitude_radians)*cos_latitude;
+    out[i].z_ = -cos(longitude_radians)*cos_latitude;
+  }
+  return result;
+}
+
 std::pair<NVector, double> PVector::toNVectorAndHeight() const
 {
   // This implements equation 23.
@@ -23,6 +23,8 @@
 #include <numbers>              // for pi
 #include <utility>              // for pair
 
+#include <QVector>              // for QVector
+
 #include "src/core/vector3d.h"  // for Vector3D
 
 namespace gpsbabel
@@ -66,6 +68,8 @@ public:
   NVector(double latitude_degrees, double longitude_degrees);
   NVector(const Vector3D& v);
 
+  static QVector<NVector> from_degrees(const QVector<double>& latitudes_degrees, const QVector<double>& longitudes_degrees);
+
   [[nodiscard]] double latitude() const;
   [[nodiscard]] double longitude() const;
 
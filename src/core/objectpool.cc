@@ -0,0 +1,254 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <algorithm>               // for upper_bound
+#include <atomic>                  // for memory_order_relaxed
+#include <cassert>                 // for assert
+#include <cstddef>                 // for size_t, max_align_t, byte
+#include <cstdlib>                 // for mkstemp
+#include <functional>              // for less
+#include <new>                     // for operator new, operator delete, bad_alloc
+#include <string>                  // for string
+
+#if !__WIN32__
+#include <sys/mman.h>              // for mmap, munmap, MAP_FAILED, MAP_SHARED, PROT_READ, PROT_WRITE
+#include <unistd.h>                // for close, ftruncate, sysconf, unlink, _SC_PAGESIZE
+#endif
+
+#include "src/core/objectpool.h"
+
+namespace gpsbabel
+{
+
+thread_local bool ObjectPool::bypass_ = false;
+std::string ObjectPool::spill_directory_;
+
+#if !__WIN32__
+namespace
+{
+
+/* Mappings of the spill file start on page boundaries. */
+std::size_t page_rounded(std::size_t bytes)
+{
+  static const auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  return ((bytes + page - 1) / page) * page;
+}
+
+/* An unlinked temporary file in dir, or -1. */
+int spill_file(const std::string& dir)
+{
+  std::string name = dir + "/gpsbabel-spill-XXXXXX";
+  int fd = mkstemp(name.data());
+  if (fd >= 0) {
+    unlink(name.c_str());
+  }
+  return fd;
+}
+
+} // namespace
+#endif
+
+/*
+ * Chunks of pools that have none yet come from a spill file in dir from
+ * now on.  Returns false if no file can be made there.
+ */
+bool ObjectPool::set_spill_directory(const std::string& dir)
+{
+#if !__WIN32__
+  int fd = spill_file(dir);
+  if (fd < 0) {
+    return false;
+  }
+  close(fd);
+  spill_directory_ = dir;
+  return true;
+#else
+  (void) dir;
+  return false;
+#endif
+}
+
+ObjectPool::ObjectPool(std::size_t block_size, std::size_t blocks_per_chunk) :
+  requested_size_(block_size),
+  blocks_per_chunk_(blocks_per_chunk)
+{
+  // Every block must be able to hold a free list link and must keep
+  // the blocks that follow it suitably aligned.
+  constexpr std::size_t align = alignof(std::max_align_t);
+  block_size_ = std::max(block_size, sizeof(FreeBlock));
+  block_size_ = ((block_size_ + align - 1) / align) * align;
+}
+
+ObjectPool::~ObjectPool()
+{
+  // If objects are still alive at exit we leak the chunks rather than
+  // pull the memory out from under them.
+  if (live_ == 0) {
+    release_chunks();
+#if !__WIN32__
+    if (spill_fd_ >= 0) {
+      close(spill_fd_);
+    }
+#endif
+  }
+}
+
+void* ObjectPool::allocate(std::size_t size)
+{
+  allocations_.fetch_add(1, std::memory_order_relaxed);
+  if ((size != requested_size_) || bypass_) {
+    return ::operator new(size);
+  }
+
+  if (free_list_ != nullptr) {
+    FreeBlock* block = free_list_;
+    free_list_ = block->next;
+    ++live_;
+    return block;
+  }
+
+  if (next_unused_ == chunk_end_) {
+    if (clients_ == 0) {
+      return ::operator new(size);
+    }
+    add_chunk();
+  }
+
+  void* block = next_unused_;
+  next_unused_ += block_size_;
+  ++live_;
+  return block;
+}
+
+void ObjectPool::deallocate(void* ptr, std::size_t /* size */) noexcept
+{
+  if (ptr == nullptr) {
+    return;
+  }
+
+  if (!owns(ptr)) {
+    ::operator delete(ptr);
+    return;
+  }
+
+  auto* block = static_cast<FreeBlock*>(ptr);
+  block->next = free_list_;
+  free_list_ = block;
+  assert(live_ > 0);
+  if ((--live_ == 0) && (clients_ == 0)) {
+    release_chunks();
+  }
+}
+
+void ObjectPool::release() noexcept
+{
+  assert(clients_ > 0);
+  if ((--clients_ == 0) && (live_ == 0)) {
+    release_chunks();
+  }
+}
+
+bool ObjectPool::owns(const void* ptr) const
+{
+  if (chunks_.empty()) {
+    return false;
+  }
+
+  const auto* p = static_cast<const std::byte*>(ptr);
+  std::less<const std::byte*> less;
+  // Find the last chunk that starts at or before ptr.
+  auto it = std::upper_bound(chunks_.cbegin(), chunks_.cend(), p, less);
+  if (it == chunks_.cbegin()) {
+    return false;
+  }
+  --it;
+  return less(p, *it + (block_size_ * blocks_per_chunk_));
+}
+
+void ObjectPool::add_chunk()
+{
+  if (chunks_.empty()) {
+    chunks_mapped_ = !spill_directory_.empty();
+  }
+  std::byte* chunk;
+  if (chunks_mapped_) {
+    chunk = map_chunk();
+    if (chunk == nullptr) {
+      throw std::bad_alloc();
+    }
+  } else {
+    chunk = static_cast<std::byte*>(::operator new(block_size_ * blocks_per_chunk_));
+  }
+  auto it = std::upper_bound(chunks_.begin(), chunks_.end(), chunk, std::less<std::byte*>());
+  chunks_.insert(it, chunk);
+  next_unused_ = chunk;
+  chunk_end_ = chunk + (block_size_ * blocks_per_chunk_);
+}
+
+/* The next part of the spill file, mapped, or nullptr. */
+std::byte* ObjectPool::map_chunk()
+{
+#if !__WIN32__
+  if (spill_fd_ < 0) {
+    spill_fd_ = spill_file(spill_directory_);
+    if (spill_fd_ < 0) {
+      return nullptr;
+    }
+  }
+  const std::size_t bytes = page_rounded(block_size_ * blocks_per_chunk_);
+  if (ftruncate(spill_fd_, static_cast<off_t>(spill_size_ + bytes)) != 0) {
+    return nullptr;
+  }
+  void* chunk = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, spill_fd_,
+                     static_cast<off_t>(spill_size_));
+  if (chunk == MAP_FAILED) {
+    return nullptr;
+  }
+  spill_size_ += bytes;
+  return static_cast<std::byte*>(chunk);
+#else
+  return nullptr;
+#endif
+}
+
+void ObjectPool::release_chunks() noexcept
+{
+  for (std::byte* chunk : chunks_) {
+#if !__WIN32__
+    if (chunks_mapped_) {
+      munmap(chunk, page_rounded(block_size_ * blocks_per_chunk_));
+      continue;
+    }
+#endif
+    ::operator delete(chunk);
+  }
+#if !__WIN32__
+  if (chunks_mapped_ && (spill_fd_ >= 0)) {
+    // Give the disk space back.
+    (void) ftruncate(spill_fd_, 0);
+  }
+#endif
+  spill_size_ = 0;
+  chunks_.clear();
+  free_list_ = nullptr;
+  next_unused_ = nullptr;
+  chunk_end_ = nullptr;
+}
+
+} // namespace gpsbabel
@@ -0,0 +1,120 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_OBJECTPOOL_H_
+#define SRC_CORE_OBJECTPOOL_H_
+
+#include <atomic>   // for atomic, memory_order_relaxed
+#include <cstddef>  // for size_t, max_align_t, byte
+#include <string>   // for string
+#include <vector>   // for vector
+
+namespace gpsbabel
+{
+
+/*
+ * A fixed size block allocator.
+ *
+ * While at least one client has acquired the pool allocations of exactly
+ * block_size bytes are carved out of large chunks instead of being
+ * individually requested from the heap.  Blocks are recycled through an
+ * intrusive free list, and once the last pooled block has been returned
+ * and no client holds the pool all chunks are released at once.
+ *
+ * Allocations of any other size, or made while the pool is not acquired
+ * and has no spare blocks, fall through to the global operator new, so a
+ * class can route its operator new/delete here unconditionally.
+ *
+ * The pool is not thread safe.  Worker threads must call
+ * set_thread_bypass(true), after which their allocations also go to the
+ * heap.  They may free blocks they allocated that way while the owning
+ * thread is not using the pool.
+ *
+ * allocation_count() counts every allocation request, pooled or not,
+ * from any thread.
+ *
+ * Once set_spill_directory() has been called chunks are mapped from an
+ * unlinked temporary file in that directory instead of coming from the
+ * heap, so under memory pressure the kernel writes them back to the
+ * file rather than swapping or running out of memory.  Only the blocks
+ * themselves live there, not what their objects allocate on the heap.
+ * Without mmap, e.g. on Windows, chunks always come from the heap.
+ */
+class ObjectPool
+{
+public:
+  /* Special Member Functions */
+
+  explicit ObjectPool(std::size_t block_size, std::size_t blocks_per_chunk = 4096);
+  ~ObjectPool();
+  ObjectPool(const ObjectPool&) = delete;
+  ObjectPool& operator=(const ObjectPool&) = delete;
+  ObjectPool(ObjectPool&&) = delete;
+  ObjectPool& operator=(ObjectPool&&) = delete;
+
+  /* Member Functions */
+
+  void* allocate(std::size_t size);
+  void deallocate(void* ptr, std::size_t size) noexcept;
+  void acquire() {++clients_;}
+  void release() noexcept;
+  std::size_t live_blocks() const {return live_;}
+  std::size_t chunk_count() const {return chunks_.size();}
+  std::size_t allocation_count() const {return allocations_.load(std::memory_order_relaxed);}
+  static void set_thread_bypass(bool bypass) {bypass_ = bypass;}
+  static bool thread_bypass() {return bypass_;}
+  static bool set_spill_directory(const std::string& dir);
+
+private:
+  /* Types */
+
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  /* Member Functions */
+
+  bool owns(const void* ptr) const;
+  void add_chunk();
+  std::byte* map_chunk();
+  void release_chunks() noexcept;
+
+  /* Data Members */
+
+  static thread_local bool bypass_;
+  static std::string spill_directory_;
+
+  std::size_t requested_size_;
+  std::size_t block_size_;
+  std::size_t blocks_per_chunk_;
+  std::vector<std::byte*> chunks_;  // sorted by address
+  FreeBlock* free_list_{nullptr};
+  std::byte* next_unused_{nullptr};
+  std::byte* chunk_end_{nullptr};
+  std::size_t live_{0};
+  std::atomic<std::size_t> allocations_{0};
+  int clients_{0};
+  int spill_fd_{-1};
+  std::size_t spill_size_{0};  // bytes of the spill file mapped so far
+  bool chunks_mapped_{false};
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_OBJECTPOOL_H_
@@ -0,0 +1,198 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include "src/core/packedtrack.h"
+
+#include <cmath>            // for llround
+
+#include <QDateTime>        // for QDateTime
+#include <Qt>               // for UTC
+
+#include "defs.h"           // for Waypoint, unknown_alt, fix_unknown
+
+namespace gpsbabel
+{
+
+namespace
+{
+
+void put(QByteArray& data, qint64 value)
+{
+  // zigzag, so small negative differences take as few bytes as positive ones.
+  auto bits = (static_cast<quint64>(value) << 1) ^ static_cast<quint64>(value >> 63);
+  while (bits >= 0x80) {
+    data.append(static_cast<char>(bits | 0x80));
+    bits >>= 7;
+  }
+  data.append(static_cast<char>(bits));
+}
+
+qint64 get(const QByteArray& data, qsizetype* pos)
+{
+  quint64 bits = 0;
+  int shift = 0;
+  quint8 byte;
+  do {
+    byte = data.at((*pos)++);
+    bits |= static_cast<quint64>(byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  return static_cast<qint64>(bits >> 1) ^ -static_cast<qint64>(bits & 1);
+}
+
+/* The value in the given units if it is exactly a whole number of them. */
+bool exact(double value, double scale, qint64* units)
+{
+  if (!std::isfinite(value) || std::fabs(value * scale) > 1e15) {
+    return false;
+  }
+  *units = std::llround(value * scale);
+  return static_cast<double>(*units) / scale == value;
+}
+
+enum : quint8 {
+  kNewTrkseg = 1,
+  kAltitude = 2,
+  kTime = 4
+};
+
+constexpr double kDegreeScale = 1e7;
+constexpr double kAltitudeScale = 10;
+
+} // namespace
+
+bool PackedTrack::plain(const Waypoint* wpt)
+{
+  const wp_flags& flags = wpt->wpt_flags;
+  if (flags.shortname_is_synthetic || flags.fmt_use || flags.is_split ||
+      flags.marked_for_deletion) {
+    return false;
+  }
+  if (!wpt->shortname.isNull() || !wpt->description.isNull() ||
+      !wpt->notes.isNull() || !wpt->icon_descr.isNull() ||
+      wpt->HasUrlLink()) {
+    return false;
+  }
+  if (wpt->temperature_has_value() || wpt->proximity_has_value() ||
+      wpt->course_has_value() || wpt->speed_has_value() ||
+      wpt->geoidheight_has_value() || wpt->depth_has_value()) {
+    return false;
+  }
+  if (wpt->hdop != 0 || wpt->vdop != 0 || wpt->pdop != 0 ||
+      wpt->fix != fix_unknown || wpt->sat != -1 ||
+      wpt->heartrate != 0 || wpt->cadence != 0 ||
+      wpt->power != 0 || wpt->odometer_distance != 0) {
+    return false;
+  }
+  if (!wpt->EmptyGCData() || !wpt->fs.FsChainEmpty() ||
+      wpt->extra_data != nullptr) {
+    return false;
+  }
+  // Other time specs would come back as UTC.  DateTime::isValid() is
+  // false for the first second of the epoch, which is kept too.
+  const QDateTime& time = wpt->creation_time;
+  return !time.isValid() || (time.timeSpec() == Qt::UTC);
+}
+
+bool PackedTrack::append(const Waypoint* wpt)
+{
+  if (wpt->session != session_ || !plain(wpt)) {
+    return false;
+  }
+  qint64 latitude;
+  qint64 longitude;
+  qint64 altitude = 0;
+  if (!exact(wpt->latitude, kDegreeScale, &latitude) ||
+      !exact(wpt->longitude, kDegreeScale, &longitude)) {
+    return false;
+  }
+  quint8 flags = wpt->wpt_flags.new_trkseg ? kNewTrkseg : 0;
+  if (wpt->altitude != unknown_alt) {
+    if (!exact(wpt->altitude, kAltitudeScale, &altitude)) {
+      return false;
+    }
+    flags |= kAltitude;
+  }
+  qint64 time = 0;
+  if (static_cast<const QDateTime&>(wpt->creation_time).isValid()) {
+    time = wpt->creation_time.toMSecsSinceEpoch();
+    flags |= kTime;
+  }
+
+  data_.append(static_cast<char>(flags));
+  put(data_, latitude - latitude_);
+  put(data_, longitude - longitude_);
+  latitude_ = latitude;
+  longitude_ = longitude;
+  if (flags & kAltitude) {
+    put(data_, altitude - altitude_);
+    altitude_ = altitude;
+  }
+  if (flags & kTime) {
+    put(data_, time - time_);
+    time_ = time;
+  }
+  ++count_;
+  return true;
+}
+
+bool PackedTrack::Cursor::next(Point* point)
+{
+  const QByteArray& data = track_.data_;
+  if (pos_ >= data.size()) {
+    return false;
+  }
+  const auto flags = static_cast<quint8>(data.at(pos_++));
+  latitude_ += get(data, &pos_);
+  longitude_ += get(data, &pos_);
+  point->latitude = static_cast<double>(latitude_) / kDegreeScale;
+  point->longitude = static_cast<double>(longitude_) / kDegreeScale;
+  point->has_altitude = flags & kAltitude;
+  if (point->has_altitude) {
+    altitude_ += get(data, &pos_);
+    point->altitude = static_cast<double>(altitude_) / kAltitudeScale;
+  } else {
+    point->altitude = unknown_alt;
+  }
+  point->has_time = flags & kTime;
+  if (point->has_time) {
+    time_ += get(data, &pos_);
+  }
+  point->time = point->has_time ? time_ : 0;
+  point->new_trkseg = flags & kNewTrkseg;
+  return true;
+}
+
+Waypoint* PackedTrack::waypoint(const Point& point) const
+{
+  auto* wpt = new Waypoint;
+  wpt->latitude = point.latitude;
+  wpt->longitude = point.longitude;
+  wpt->altitude = point.altitude;
+  if (point.has_time) {
+    wpt->SetCreationTime(DateTime::fromMSecsSinceEpochUtc(point.time));
+  } else {
+    wpt->creation_time = QDateTime();
+  }
+  wpt->wpt_flags.new_trkseg = point.new_trkseg;
+  wpt->session = session_;
+  return wpt;
+}
+
+} // namespace gpsbabel
@@ -0,0 +1,103 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_PACKEDTRACK_H_
+#define SRC_CORE_PACKEDTRACK_H_
+
+#include <cstddef>     // for size_t
+
+#include <QByteArray>  // for QByteArray
+#include <QtGlobal>    // for qint64, qsizetype
+
+class Waypoint;
+struct session_t;
+
+namespace gpsbabel
+{
+
+/*
+ * The points of a track in a few bytes each, for tracks that are held
+ * between the stages of a run without being looked at, see route_head::
+ * pack_points() and --track-store.
+ *
+ * Only plain points are taken: a position, perhaps an altitude and a
+ * UTC time and the new segment flag, and nothing else, all from one
+ * session.  Latitudes and longitudes are kept in units of 1e-7 degrees,
+ * altitudes in decimetres and times in milliseconds, so only points whose
+ * values are exactly such multiples are plain; the points that come back
+ * are the same as those that went in.  Each value is written as the
+ * zigzag varint of its difference from the one of the point before,
+ * which for a track logged at regular intervals takes a byte or two.
+ *
+ * Cursor decodes the points in order without creating Waypoints,
+ * waypoint() creates the Waypoint of one of them.
+ */
+class PackedTrack
+{
+public:
+  struct Point {
+    double latitude{0};
+    double longitude{0};
+    double altitude{0};
+    qint64 time{0};         // milliseconds since the epoch
+    bool has_altitude{false};
+    bool has_time{false};   // or a null creation time
+    bool new_trkseg{false};
+  };
+
+  class Cursor
+  {
+  public:
+    explicit Cursor(const PackedTrack& track) : track_(track) {}
+    bool next(Point* point);
+
+  private:
+    const PackedTrack& track_;
+    qsizetype pos_{0};
+    qint64 latitude_{0};
+    qint64 longitude_{0};
+    qint64 altitude_{0};
+    qint64 time_{0};
+  };
+
+  explicit PackedTrack(const session_t* session) : session_(session) {}
+
+  static bool plain(const Waypoint* wpt);
+  /* Adds wpt if it is plain and of the track's session. */
+  bool append(const Waypoint* wpt);
+  Waypoint* waypoint(const Point& point) const;
+
+  qsizetype size() const {return count_;}
+  const session_t* session() const {return session_;}
+  std::size_t memory_usage() const {return sizeof(*this) + data_.capacity();}
+  void squeeze() {data_.squeeze();}
+
+private:
+  const session_t* session_;
+  QByteArray data_;
+  qsizetype count_{0};
+  qint64 latitude_{0};
+  qint64 longitude_{0};
+  qint64 altitude_{0};
+  qint64 time_{0};
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_PACKEDTRACK_H_
@@ -0,0 +1,138 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <algorithm>                // for max, min
+#include <cstddef>                  // for size_t
+#include <memory>                   // for make_unique
+#include <utility>                  // for move
+
+#include "defs.h"
+#include "src/core/paralleldeflate.h"
+
+#if HAVE_LIBZ
+#include <zlib.h>
+#elif !ZLIB_INHIBITED
+#include "zlib.h"
+#endif
+
+#if !ZLIB_INHIBITED
+
+namespace gpsbabel
+{
+
+static constexpr qint64 kBlockSize = 128 * 1024;
+static constexpr int kDictionarySize = 32 * 1024;
+
+ParallelDeflate::ParallelDeflate(Sink sink, int threads, int level) :
+  sink_(std::move(sink)),
+  threads_(std::max(threads, 1)),
+  level_(level),
+  crc_(crc32(0, nullptr, 0))
+{
+}
+
+ParallelDeflate::~ParallelDeflate()
+{
+  // Every block waits for its compression as it goes away.
+  blocks_.clear();
+}
+
+void ParallelDeflate::set_defaults(int threads, int level)
+{
+  default_threads_ = threads;
+  default_level_ = level;
+}
+
+void ParallelDeflate::write(const char* data, qint64 len)
+{
+  while (len > 0) {
+    qint64 count = std::min<qint64>(len, kBlockSize - pending_.size());
+    pending_.append(data, count);
+    data += count;
+    len -= count;
+    if (pending_.size() == kBlockSize) {
+      submit(false);
+    }
+  }
+}
+
+void ParallelDeflate::finish()
+{
+  if (!finished_) {
+    submit(true);
+    drain(0);
+    finished_ = true;
+  }
+}
+
+void ParallelDeflate::submit(bool last)
+{
+  auto pending = std::make_unique<PendingBlock>();
+  Block* out = &pending->block;
+  pending->group.run([out, input = pending_, dictionary = dictionary_, level = level_, last]() {
+    z_stream strm{};
+    if (deflateInit2(&strm, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+      fatal("Cannot initialize zlib compression.\n");
+    }
+    if (!dictionary.isEmpty()) {
+      deflateSetDictionary(&strm, reinterpret_cast<const Bytef*>(dictionary.constData()),
+                           dictionary.size());
+    }
+
+    Block block;
+    block.len = input.size();
+    block.crc = crc32(0, reinterpret_cast<const Bytef*>(input.constData()), input.size());
+    block.compressed.resize(deflateBound(&strm, input.size()) + 64);
+    strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.constData()));
+    strm.avail_in = input.size();
+    strm.next_out = reinterpret_cast<Bytef*>(block.compressed.data());
+    strm.avail_out = block.compressed.size();
+    // A sync flush ends every block but the last on a byte boundary, so
+    // the blocks can simply be concatenated.
+    int rc = deflate(&strm, last ? Z_FINISH : Z_SYNC_FLUSH);
+    if ((rc != (last ? Z_STREAM_END : Z_OK)) || (strm.avail_in != 0)) {
+      fatal("zlib returned error %d while compressing.\n", rc);
+    }
+    block.compressed.resize(block.compressed.size() - strm.avail_out);
+    deflateEnd(&strm);
+    *out = std::move(block);
+  });
+  blocks_.push_back(std::move(pending));
+
+  dictionary_ = pending_.right(kDictionarySize);
+  pending_.clear();
+  // Bound the memory held by blocks that are done but not yet written.
+  drain(2 * threads_);
+}
+
+void ParallelDeflate::drain(int keep)
+{
+  while (blocks_.size() > static_cast<std::size_t>(keep)) {
+    blocks_.front()->group.wait();
+    Block block = std::move(blocks_.front()->block);
+    blocks_.pop_front();
+    crc_ = crc32_combine(crc_, block.crc, block.len);
+    size_ += block.len;
+    sink_(block.compressed.constData(), block.compressed.size());
+  }
+}
+
+} // namespace gpsbabel
+
+#endif // !ZLIB_INHIBITED
@@ -0,0 +1,99 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_PARALLELDEFLATE_H_
+#define SRC_CORE_PARALLELDEFLATE_H_
+
+#include <deque>                // for deque
+#include <functional>           // for function
+#include <memory>               // for unique_ptr
+
+#include <QByteArray>           // for QByteArray
+#include <QtGlobal>             // for quint32, quint64
+
+#include "src/core/scheduler.h"  // for TaskGroup
+
+namespace gpsbabel
+{
+
+/*
+ * Deflate compression spread over several threads, as pigz does it.
+ *
+ * The input is cut into blocks that are compressed independently, as
+ * tasks of the scheduler, each primed with the last 32KB of the block
+ * before it, and the results are handed to the sink in order.  At most
+ * twice threads blocks are compressing or waiting to be written.  Together they form one raw deflate
+ * stream; crc() and size() give what a gzip trailer or zip directory
+ * entry needs to describe it.
+ *
+ * set_defaults() holds the thread count and compression level the
+ * writers use, set with -z.
+ */
+class ParallelDeflate
+{
+public:
+  using Sink = std::function<void(const char* data, qint64 len)>;
+
+  ParallelDeflate(Sink sink, int threads, int level);
+  ~ParallelDeflate();
+  ParallelDeflate(const ParallelDeflate&) = delete;
+  ParallelDeflate& operator=(const ParallelDeflate&) = delete;
+
+  void write(const char* data, qint64 len);
+  /* Compresses what is left and ends the deflate stream. */
+  void finish();
+  quint32 crc() const {return crc_;}
+  quint64 size() const {return size_;}
+
+  static void set_defaults(int threads, int level);
+  static int default_threads() {return default_threads_;}
+  static int default_level() {return default_level_;}
+
+private:
+  struct Block {
+    QByteArray compressed;
+    quint32 crc;
+    qint64 len;
+  };
+
+  struct PendingBlock {
+    TaskGroup group;
+    Block block;
+  };
+
+  void submit(bool last);
+  void drain(int keep);
+
+  static inline int default_threads_ = 1;
+  static inline int default_level_ = -1;  // Z_DEFAULT_COMPRESSION
+
+  Sink sink_;
+  int threads_;
+  int level_;
+  QByteArray pending_;
+  QByteArray dictionary_;
+  std::deque<std::unique_ptr<PendingBlock>> blocks_;
+  quint32 crc_;
+  quint64 size_{0};
+  bool finished_{false};
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_PARALLELDEFLATE_H_
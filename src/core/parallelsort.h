@@ -0,0 +1,91 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_PARALLELSORT_H_
+#define SRC_CORE_PARALLELSORT_H_
+
+#include <algorithm>              // for inplace_merge, stable_sort
+
+#include <QVector>                // for QVector
+#include <QtGlobal>               // for qsizetype
+
+#include "src/core/scheduler.h"   // for TaskGroup
+
+namespace gpsbabel
+{
+
+/*
+ * A stable sort of v in up to threads tasks at once.
+ *
+ * The vector is cut into one run per thread, the runs are sorted on
+ * their own and then merged in pairs, a round of merges at a time.
+ * Every step is stable, so the result is the same as std::stable_sort
+ * gives.  Short vectors are sorted on the calling thread.
+ */
+template <typename T, typename Compare>
+void parallel_stable_sort(QVector<T>& v, Compare cmp, int threads)
+{
+  constexpr qsizetype kParallelMin = 64 * 1024;
+
+  const qsizetype count = v.size();
+  if ((threads <= 1) || (count < kParallelMin)) {
+    std::stable_sort(v.begin(), v.end(), cmp);
+    return;
+  }
+
+  T* data = v.data();
+  QVector<qsizetype> bounds;  // run i is [bounds[i], bounds[i + 1])
+  for (int i = 0; i <= threads; ++i) {
+    bounds.append(count * i / threads);
+  }
+
+  TaskGroup group;
+  for (qsizetype i = 0; i + 1 < bounds.size(); ++i) {
+    const qsizetype begin = bounds.at(i);
+    const qsizetype end = bounds.at(i + 1);
+    group.run([data, begin, end, &cmp]() {
+      std::stable_sort(data + begin, data + end, cmp);
+    });
+  }
+  group.wait();
+
+  while (bounds.size() > 2) {
+    QVector<qsizetype> merged;
+    qsizetype i = 0;
+    for (; i + 2 < bounds.size(); i += 2) {
+      const qsizetype begin = bounds.at(i);
+      const qsizetype middle = bounds.at(i + 1);
+      const qsizetype end = bounds.at(i + 2);
+      group.run([data, begin, middle, end, &cmp]() {
+        std::inplace_merge(data + begin, data + middle, data + end, cmp);
+      });
+      merged.append(begin);
+    }
+    if (i + 1 < bounds.size()) {
+      merged.append(bounds.at(i));  // an odd run waits for the next round
+    }
+    merged.append(count);
+    group.wait();
+    bounds = merged;
+  }
+}
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_PARALLELSORT_H_
@@ -0,0 +1,128 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <QFile>                  // for QFile
+#include <QIODevice>              // for QIODevice, QIODevice::WriteOnly, QIODevice::Text
+#include <QJsonDocument>          // for QJsonDocument, QJsonDocument::Indented
+
+#if __WIN32__
+#include <windows.h>              // for GetProcessTimes, GetCurrentProcess, FILETIME
+#include <psapi.h>                // for GetProcessMemoryInfo, PROCESS_MEMORY_COUNTERS
+#else
+#include <sys/resource.h>         // for getrusage, rusage, RUSAGE_SELF
+#endif
+
+#include "src/core/allocstats.h"  // for AllocStats
+#include "src/core/profiler.h"
+
+namespace gpsbabel
+{
+
+void Profiler::begin(const QString& stage, const QString& name, const QString& file,
+                     qint64 points, qint64 allocations)
+{
+  current_ = QJsonObject();
+  current_.insert(QStringLiteral("stage"), stage);
+  current_.insert(QStringLiteral("name"), name);
+  if (!file.isEmpty()) {
+    current_.insert(QStringLiteral("file"), file);
+  }
+  current_.insert(QStringLiteral("points_in"), points);
+  allocations_start_ = allocations;
+  heap_allocations_start_ = AllocStats::allocations();
+  heap_bytes_start_ = AllocStats::bytes();
+  heap_deallocations_start_ = AllocStats::deallocations();
+  cpu_start_ = cpu_seconds();
+  timer_.start();
+}
+
+void Profiler::end(qint64 points, qint64 allocations, qint64 data_bytes)
+{
+  current_.insert(QStringLiteral("wall_seconds"), timer_.nsecsElapsed() / 1.0e9);
+  current_.insert(QStringLiteral("cpu_seconds"), cpu_seconds() - cpu_start_);
+  current_.insert(QStringLiteral("points_out"), points);
+  current_.insert(QStringLiteral("allocations"), allocations - allocations_start_);
+  current_.insert(QStringLiteral("data_bytes"), data_bytes);
+  if (AllocStats::enabled()) {
+    current_.insert(QStringLiteral("heap_allocations"), AllocStats::allocations() - heap_allocations_start_);
+    current_.insert(QStringLiteral("heap_bytes"), AllocStats::bytes() - heap_bytes_start_);
+    current_.insert(QStringLiteral("heap_deallocations"), AllocStats::deallocations() - heap_deallocations_start_);
+  }
+  current_.insert(QStringLiteral("peak_rss_kb"), peak_rss_kb());
+  stages_.append(current_);
+  current_ = QJsonObject();
+}
+
+bool Profiler::write(const QString& filename) const
+{
+  QJsonObject root;
+  root.insert(QStringLiteral("stages"), stages_);
+  root.insert(QStringLiteral("peak_rss_kb"), peak_rss_kb());
+  root.insert(QStringLiteral("sessions"), sessions_);
+
+  QFile file(filename);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    return false;
+  }
+  file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+  return true;
+}
+
+double Profiler::cpu_seconds()
+{
+#if __WIN32__
+  FILETIME creation;
+  FILETIME exit;
+  FILETIME kernel;
+  FILETIME user;
+  if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+    return 0.0;
+  }
+  auto ticks = [](const FILETIME& ft)->double {
+    return ((static_cast<quint64>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime) / 1.0e7;
+  };
+  return ticks(kernel) + ticks(user);
+#else
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1.0e6 +
+         usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1.0e6;
+#endif
+}
+
+qint64 Profiler::peak_rss_kb()
+{
+#if __WIN32__
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return 0;
+  }
+  return counters.PeakWorkingSetSize / 1024;
+#else
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+  return usage.ru_maxrss;        // kilobytes elsewhere
+#endif
+#endif
+}
+
+} // namespace gpsbabel
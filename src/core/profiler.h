@@ -0,0 +1,69 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_PROFILER_H_
+#define SRC_CORE_PROFILER_H_
+
+#include <QElapsedTimer>  // for QElapsedTimer
+#include <QJsonArray>     // for QJsonArray
+#include <QJsonObject>    // for QJsonObject
+#include <QString>        // for QString
+#include <QtGlobal>       // for qint64
+
+namespace gpsbabel
+{
+
+/*
+ * Collects wall time, CPU time, point counts, allocation counts and the
+ * peak resident set size of a sequence of stages, e.g. the readers,
+ * filters and writers of one run, and writes them out as JSON.
+ *
+ * Point and allocation counts and the size of the data held are
+ * supplied by the caller, which knows what is worth counting.  CPU time and the resident set size are those
+ * of the whole process.  In builds with GPSBABEL_ALLOCATION_STATS every
+ * heap allocation is counted as well, see AllocStats.
+ */
+class Profiler
+{
+public:
+  void begin(const QString& stage, const QString& name, const QString& file,
+             qint64 points, qint64 allocations);
+  void end(qint64 points, qint64 allocations, qint64 data_bytes);
+  /* The data held at the end, by session, reported as is. */
+  void set_sessions(const QJsonArray& sessions) {sessions_ = sessions;}
+  bool write(const QString& filename) const;
+
+private:
+  static double cpu_seconds();
+  static qint64 peak_rss_kb();
+
+  QJsonArray stages_;
+  QJsonArray sessions_;
+  QJsonObject current_;
+  QElapsedTimer timer_;
+  double cpu_start_{0.0};
+  qint64 allocations_start_{0};
+  qint64 heap_allocations_start_{0};
+  qint64 heap_bytes_start_{0};
+  qint64 heap_deallocations_start_{0};
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_PROFILER_H_
@@ -0,0 +1,118 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <QByteArray>             // for QByteArray
+#include <QElapsedTimer>          // for QElapsedTimer
+#include <QMutex>                 // for QMutex
+#include <QMutexLocker>           // for QMutexLocker
+#include <QString>                // for QString
+
+#if __WIN32__
+#include <io.h>                   // for _write
+#else
+#include <unistd.h>               // for write
+#endif
+
+#include "src/core/progress.h"
+
+namespace gpsbabel
+{
+
+/* Readers may run on several threads at once. */
+static QMutex mutex;
+static int progress_fd = -1;
+static int progress_interval_ms = 200;
+static QElapsedTimer timer;
+static qint64 last_update_ms = 0;
+static qint64 total_bytes = 0;
+static qint64 total_points = 0;
+static qint64 step_done = 0;
+static qint64 step_total = 0;
+static bool dirty = false;
+
+void Progress::set_fd(int fd, int interval_ms)
+{
+  QMutexLocker locker(&mutex);
+  progress_fd = fd;
+  progress_interval_ms = interval_ms;
+  timer.start();
+  last_update_ms = 0;
+  enabled_ = (fd >= 0);
+}
+
+void Progress::add(qint64 bytes, qint64 points)
+{
+  QMutexLocker locker(&mutex);
+  total_bytes += bytes;
+  total_points += points;
+  dirty = true;
+  update(false);
+}
+
+void Progress::set_step(qint64 done, qint64 total)
+{
+  QMutexLocker locker(&mutex);
+  step_done = done;
+  step_total = total;
+  dirty = true;
+  update(done >= total);
+}
+
+void Progress::finish()
+{
+  if (enabled_) {
+    QMutexLocker locker(&mutex);
+    update(true);
+  }
+}
+
+/* Called with the mutex held. */
+void Progress::update(bool force)
+{
+  const qint64 now_ms = timer.elapsed();
+  if (!dirty || (!force && ((now_ms - last_update_ms) < progress_interval_ms))) {
+    return;
+  }
+  last_update_ms = now_ms;
+  dirty = false;
+
+  const double seconds = now_ms / 1000.0;
+  QString line = QStringLiteral("{\"elapsed_seconds\":%1,\"bytes\":%2,\"points\":%3")
+                 .arg(QString::number(seconds, 'f', 3), QString::number(total_bytes),
+                      QString::number(total_points));
+  if (seconds > 0.0) {
+    line += QStringLiteral(",\"bytes_per_second\":%1,\"points_per_second\":%2")
+            .arg(QString::number(total_bytes / seconds, 'f', 0),
+                 QString::number(total_points / seconds, 'f', 0));
+  }
+  if (step_total > 0) {
+    line += QStringLiteral(",\"done\":%1,\"total\":%2")
+            .arg(QString::number(step_done), QString::number(step_total));
+  }
+  line += QStringLiteral("}\n");
+
+  const QByteArray bytes = line.toUtf8();
+#if __WIN32__
+  (void) _write(progress_fd, bytes.constData(), bytes.size());
+#else
+  (void) write(progress_fd, bytes.constData(), bytes.size());
+#endif
+}
+
+} // namespace gpsbabel
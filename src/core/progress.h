@@ -0,0 +1,74 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_PROGRESS_H_
+#define SRC_CORE_PROGRESS_H_
+
+#include <QtGlobal>  // for qint64
+
+namespace gpsbabel
+{
+
+/*
+ * Progress reporting for supervising processes.
+ *
+ * Readers and writers report the bytes and points they handle, and
+ * transfers report how far along they are.  Once set_fd() has been
+ * called a JSON object per line with the totals so far and the current
+ * throughput is written to that file descriptor, at most every
+ * interval_ms milliseconds and once more by finish().  Until then every
+ * report is just a test of an inline flag.
+ */
+class Progress
+{
+public:
+  static void set_fd(int fd, int interval_ms = 200);
+  static bool enabled() {return enabled_;}
+
+  static void bytes(qint64 count)
+  {
+    if (enabled_) {
+      add(count, 0);
+    }
+  }
+  static void points(qint64 count = 1)
+  {
+    if (enabled_) {
+      add(0, count);
+    }
+  }
+  static void step(qint64 done, qint64 total)
+  {
+    if (enabled_) {
+      set_step(done, total);
+    }
+  }
+  static void finish();
+
+private:
+  static void add(qint64 bytes, qint64 points);
+  static void set_step(qint64 done, qint64 total);
+  static void update(bool force);
+
+  static inline bool enabled_ = false;
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_PROGRESS_H_
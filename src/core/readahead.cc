@@ -0,0 +1,181 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <algorithm>            // for min
+#include <cstdlib>              // for exit
+#include <cstring>              // for memcpy
+#include <utility>              // for move, exchange
+
+#include "defs.h"               // for fatal_set_throws, fatal_throws
+#include "src/core/logging.h"   // for FatalError
+#include "src/core/readahead.h"
+
+namespace gpsbabel
+{
+
+ReadAhead::ReadAhead(Source source, int depth, qint64 block_size) :
+  source_(std::move(source)),
+  depth_(std::max(depth, 1)),
+  block_size_(block_size)
+{
+}
+
+ReadAhead::~ReadAhead()
+{
+  stop();
+}
+
+void ReadAhead::start(qint64 position)
+{
+  stop();
+  position_ = position;
+  stopping_ = false;
+  ended_ = false;
+  error_ = nullptr;
+  thread_ = std::thread(&ReadAhead::fill, this);
+}
+
+void ReadAhead::stop()
+{
+  if (thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    changed_.notify_all();
+    thread_.join();
+  }
+  blocks_.clear();
+  offset_ = 0;
+  pushback_ = -1;
+}
+
+void ReadAhead::fill()
+{
+  // A fatal() in the source must not exit from this thread while the
+  // reader is in the middle of something, so it is handed to the reader.
+  fatal_set_throws(true);
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      changed_.wait(lock, [this]() {
+        return stopping_ || (static_cast<int>(blocks_.size()) <= depth_);
+      });
+      if (stopping_) {
+        return;
+      }
+    }
+
+    QByteArray block(block_size_, Qt::Uninitialized);
+    qint64 count;
+    std::exception_ptr error;
+    try {
+      count = source_(block.data(), block_size_);
+    } catch (const FatalError&) {
+      count = -1;
+      error = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (count <= 0) {
+      error_ = error;
+      ended_ = true;
+      changed_.notify_all();
+      return;
+    }
+    block.truncate(count);
+    blocks_.push_back(std::move(block));
+    changed_.notify_all();
+  }
+}
+
+bool ReadAhead::ready(std::unique_lock<std::mutex>& lock)
+{
+  for (;;) {
+    // Retire the block that has been consumed.
+    if (!blocks_.empty() && (offset_ == blocks_.front().size())) {
+      blocks_.pop_front();
+      offset_ = 0;
+      changed_.notify_all();
+    }
+    if (!blocks_.empty()) {
+      return true;
+    }
+    if (error_) {
+      report(lock);
+    }
+    if (ended_ || !thread_.joinable()) {
+      return false;
+    }
+    changed_.wait(lock);
+  }
+}
+
+void ReadAhead::report(std::unique_lock<std::mutex>& lock)
+{
+  std::exception_ptr error = std::exchange(error_, nullptr);
+  lock.unlock();
+  // fatal() has reported the error already.
+  if (!fatal_throws()) {
+    exit(1);
+  }
+  std::rethrow_exception(error);
+}
+
+qint64 ReadAhead::read(char* data, qint64 maxlen)
+{
+  qint64 done = 0;
+  if ((pushback_ != -1) && (maxlen > 0)) {
+    *data = static_cast<char>(pushback_);
+    pushback_ = -1;
+    ++done;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while ((done < maxlen) && ready(lock)) {
+    const QByteArray& block = blocks_.front();
+    qint64 count = std::min<qint64>(maxlen - done, block.size() - offset_);
+    memcpy(data + done, block.constData() + offset_, count);
+    offset_ += count;
+    done += count;
+  }
+  position_ += done;
+  return done;
+}
+
+bool ReadAhead::unget(char c)
+{
+  if ((pushback_ != -1) || (position_ == 0)) {
+    return false;
+  }
+  pushback_ = static_cast<unsigned char>(c);
+  --position_;
+  return true;
+}
+
+bool ReadAhead::atEnd()
+{
+  if (pushback_ != -1) {
+    return false;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  return !ready(lock);
+}
+
+} // namespace gpsbabel
@@ -0,0 +1,100 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_READAHEAD_H_
+#define SRC_CORE_READAHEAD_H_
+
+#include <condition_variable>  // for condition_variable
+#include <deque>               // for deque
+#include <exception>           // for exception_ptr
+#include <functional>          // for function
+#include <mutex>               // for mutex
+#include <thread>              // for thread
+
+#include <QByteArray>          // for QByteArray
+#include <QtGlobal>            // for qint64
+
+namespace gpsbabel
+{
+
+/*
+ * Reads a source ahead of its reader on a background thread.
+ *
+ * Up to depth blocks are read while the reader is busy decoding the
+ * ones before them, so slow storage and decompression overlap with
+ * parsing.  The source is only called from the background thread while
+ * the read ahead is running; call stop() before touching it directly,
+ * e.g. to seek, and start() again with its new position.
+ *
+ * A fatal() in the source ends the stream, and read() and atEnd() report
+ * it on the reader's thread as if the source had been called there.
+ *
+ * set_depth() holds the depth readers use, set with -R.  Zero, the
+ * default, disables reading ahead.
+ */
+class ReadAhead
+{
+public:
+  /* Reads at most maxlen bytes, returning 0 at the end and <0 on errors. */
+  using Source = std::function<qint64(char* data, qint64 maxlen)>;
+
+  ReadAhead(Source source, int depth, qint64 block_size = 256 * 1024);
+  ~ReadAhead();
+  ReadAhead(const ReadAhead&) = delete;
+  ReadAhead& operator=(const ReadAhead&) = delete;
+
+  void start(qint64 position = 0);
+  void stop();
+
+  qint64 read(char* data, qint64 maxlen);
+  bool unget(char c);
+  bool atEnd();
+  qint64 pos() const {return position_;}
+
+  static void set_depth(int depth) {default_depth_ = depth;}
+  static int depth() {return default_depth_;}
+
+private:
+  void fill();
+  /* Waits until a block is available or the source is exhausted. */
+  bool ready(std::unique_lock<std::mutex>& lock);
+  /* Reports an error from the background thread on the reader's thread. */
+  void report(std::unique_lock<std::mutex>& lock);
+
+  static inline int default_depth_ = 0;
+
+  Source source_;
+  int depth_;
+  qint64 block_size_;
+  qint64 position_{0};
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  std::deque<QByteArray> blocks_;  // blocks_.front() is being consumed
+  qint64 offset_{0};               // into blocks_.front()
+  bool ended_{false};
+  std::exception_ptr error_;       // the source failed, ended_ is set
+  bool stopping_{false};
+  int pushback_{-1};
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_READAHEAD_H_
@@ -0,0 +1,160 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <QCryptographicHash>  // for QCryptographicHash, QCryptographicHash::Sha256
+#include <QDataStream>         // for QDataStream, QDataStream::Ok, QDataStream::Qt_6_2
+#include <QDateTime>           // for QDateTime
+#include <QDir>                // for QDir, QDir::Files, QDir::Time
+#include <QFile>               // for QFile
+#include <QFileDevice>         // for QFileDevice::FileModificationTime
+#include <QFileInfo>           // for QFileInfo
+#include <QFileInfoList>       // for QFileInfoList
+#include <QIODevice>           // for QIODevice
+#include <QList>               // for QList
+#include <QSaveFile>           // for QSaveFile
+
+#include "defs.h"              // for fatal, warning
+#include "src/core/resultcache.h"
+
+
+#define MYNAME "resultcache"
+
+namespace gpsbabel
+{
+
+ResultCache::ResultCache(const QString& dir, qint64 max_bytes) :
+  dir_(dir),
+  max_bytes_(max_bytes)
+{
+  if (!QDir().mkpath(dir_)) {
+    fatal(MYNAME ": Can not make the cache directory \"%s\".\n", qPrintable(dir_));
+  }
+}
+
+QString
+ResultCache::entry_name(const QByteArray& key) const
+{
+  return QDir(dir_).filePath(QString::fromLatin1(key.toHex()) + kSuffix);
+}
+
+bool
+ResultCache::fetch(const QByteArray& key, const QStringList& outputs) const
+{
+  QFile file(entry_name(key));
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_6_2);
+  quint32 magic = 0;
+  quint32 version = 0;
+  quint32 count = 0;
+  stream >> magic >> version >> count;
+  QList<QByteArray> contents;
+  if ((magic == kMagic) && (version == kVersion) && (count == static_cast<quint32>(outputs.size()))) {
+    for (quint32 i = 0; (i < count) && (stream.status() == QDataStream::Ok); ++i) {
+      QByteArray data;
+      stream >> data;
+      contents.append(data);
+    }
+  }
+  if ((stream.status() != QDataStream::Ok) || (contents.size() != outputs.size())) {
+    warning(MYNAME ": Ignoring the damaged entry \"%s\".\n", qPrintable(file.fileName()));
+    return false;
+  }
+
+  // The entry is the most recently used now.
+  file.setFileTime(QDateTime::currentDateTimeUtc(), QFileDevice::FileModificationTime);
+
+  for (int i = 0; i < outputs.size(); ++i) {
+    QSaveFile out(outputs.at(i));
+    if (!out.open(QIODevice::WriteOnly) ||
+        (out.write(contents.at(i)) != contents.at(i).size()) || !out.commit()) {
+      fatal(MYNAME ": Can not write \"%s\".\n", qPrintable(outputs.at(i)));
+    }
+  }
+  return true;
+}
+
+void
+ResultCache::store(const QByteArray& key, const QStringList& outputs) const
+{
+  QList<QByteArray> contents;
+  qint64 size = 0;
+  for (const QString& output : outputs) {
+    QFile file(output);
+    if (!file.open(QIODevice::ReadOnly)) {
+      return;
+    }
+    contents.append(file.readAll());
+    size += contents.last().size();
+  }
+  if (size > max_bytes_) {
+    return;
+  }
+
+  // A failure to keep the outputs doesn't fail the conversion.
+  QSaveFile file(entry_name(key));
+  if (!file.open(QIODevice::WriteOnly)) {
+    warning(MYNAME ": Can not write \"%s\".\n", qPrintable(file.fileName()));
+    return;
+  }
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_6_2);
+  stream << kMagic << kVersion << static_cast<quint32>(contents.size());
+  for (const QByteArray& data : contents) {
+    stream << data;
+  }
+  if ((stream.status() != QDataStream::Ok) || !file.commit()) {
+    warning(MYNAME ": Can not write \"%s\".\n", qPrintable(file.fileName()));
+    return;
+  }
+  evict();
+}
+
+void
+ResultCache::evict() const
+{
+  // Newest first, the entries past the size given go.
+  const QFileInfoList entries = QDir(dir_).entryInfoList({QStringLiteral("*") + kSuffix},
+                                QDir::Files, QDir::Time);
+  qint64 total = 0;
+  for (const QFileInfo& entry : entries) {
+    total += entry.size();
+    if (total > max_bytes_) {
+      QFile::remove(entry.absoluteFilePath());
+    }
+  }
+}
+
+QByteArray
+ResultCache::file_digest(const QString& fname)
+{
+  QFile file(fname);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return QByteArray();
+  }
+  QCryptographicHash hash(QCryptographicHash::Sha256);
+  if (!hash.addData(&file)) {
+    return QByteArray();
+  }
+  return hash.result();
+}
+
+} // namespace gpsbabel
@@ -0,0 +1,68 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_RESULTCACHE_H_
+#define SRC_CORE_RESULTCACHE_H_
+
+#include <QByteArray>   // for QByteArray
+#include <QString>      // for QString
+#include <QStringList>  // for QStringList
+#include <QtGlobal>     // for qint64, quint32
+
+namespace gpsbabel
+{
+
+/*
+ * The output files of earlier conversions, kept in a directory, see -k.
+ *
+ * Every entry is a file named by the hex of its key, which the caller
+ * makes from everything the outputs depend on, and holds the contents of
+ * all outputs of one conversion in the order they were written.  An
+ * entry that is used is touched, and once the entries take more than
+ * the size given the least recently used ones are removed.
+ */
+class ResultCache
+{
+public:
+  ResultCache(const QString& dir, qint64 max_bytes);
+
+  /* Writes the outputs kept for key, returns false if there are none. */
+  bool fetch(const QByteArray& key, const QStringList& outputs) const;
+
+  /* Keeps the outputs as they are now for key. */
+  void store(const QByteArray& key, const QStringList& outputs) const;
+
+  /* The SHA-256 of the contents of fname, empty if it can't be read. */
+  static QByteArray file_digest(const QString& fname);
+
+private:
+  static constexpr quint32 kMagic = 0x47425243;  // "GBRC"
+  static constexpr quint32 kVersion = 1;
+  static constexpr char kSuffix[] = ".result";
+
+  QString entry_name(const QByteArray& key) const;
+  void evict() const;
+
+  QString dir_;
+  qint64 max_bytes_;
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_RESULTCACHE_H_
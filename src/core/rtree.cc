@@ -0,0 +1,144 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <algorithm>            // for max, min, sort
+#include <cmath>                // for ceil, isfinite, sqrt
+#include <utility>              // for as_const, move
+
+#include <QVarLengthArray>      // for QVarLengthArray
+#include <QVector>              // for QVector
+#include <QtGlobal>             // for qsizetype
+
+#include "src/core/rtree.h"
+
+namespace gpsbabel
+{
+
+RTree::RTree(const QVector<Box>& boxes) : boxes_(boxes)
+{
+  QVector<Entry> entries;
+  entries.reserve(boxes_.size());
+  for (qsizetype i = 0; i < boxes_.size(); ++i) {
+    const Box& b = boxes_.at(i);
+    if (std::isfinite(b.min_latitude) && std::isfinite(b.max_latitude) &&
+        std::isfinite(b.min_longitude) && std::isfinite(b.max_longitude)) {
+      entries.append({b, i});
+    }
+  }
+  if (entries.isEmpty()) {
+    return;
+  }
+
+  QVector<qsizetype> level = pack(std::move(entries), true);
+  while (level.size() > 1) {
+    QVector<Entry> parents;
+    parents.reserve(level.size());
+    for (qsizetype id : std::as_const(level)) {
+      parents.append({nodes_.at(id).box, id});
+    }
+    level = pack(std::move(parents), false);
+  }
+  root_ = level.first();
+}
+
+void RTree::extend(Box& box, const Box& other)
+{
+  box.min_latitude = std::min(box.min_latitude, other.min_latitude);
+  box.max_latitude = std::max(box.max_latitude, other.max_latitude);
+  box.min_longitude = std::min(box.min_longitude, other.min_longitude);
+  box.max_longitude = std::max(box.max_longitude, other.max_longitude);
+}
+
+/*
+ * Order the entries so that every run of kFanout of them is a compact
+ * tile: slices of whole tiles by the longitude of the centers, and the
+ * entries of each slice by latitude.  Ties keep the order of the links,
+ * so the tree doesn't depend on the sort.
+ */
+void RTree::tile(QVector<Entry>& entries)
+{
+  auto by_longitude = [](const Entry& a, const Entry& b) {
+    const double ca = a.box.min_longitude + a.box.max_longitude;
+    const double cb = b.box.min_longitude + b.box.max_longitude;
+    return (ca < cb) || ((ca == cb) && (a.link < b.link));
+  };
+  auto by_latitude = [](const Entry& a, const Entry& b) {
+    const double ca = a.box.min_latitude + a.box.max_latitude;
+    const double cb = b.box.min_latitude + b.box.max_latitude;
+    return (ca < cb) || ((ca == cb) && (a.link < b.link));
+  };
+
+  const qsizetype tiles = (entries.size() + kFanout - 1) / kFanout;
+  const auto slices = static_cast<qsizetype>(std::ceil(std::sqrt(static_cast<double>(tiles))));
+  const qsizetype per_slice = slices * kFanout;
+  std::sort(entries.begin(), entries.end(), by_longitude);
+  for (qsizetype begin = 0; begin < entries.size(); begin += per_slice) {
+    const qsizetype end = std::min(begin + per_slice, entries.size());
+    std::sort(entries.begin() + begin, entries.begin() + end, by_latitude);
+  }
+}
+
+/* Group the tiled entries into nodes, returning the new nodes in order. */
+QVector<qsizetype> RTree::pack(QVector<Entry> entries, bool leaf)
+{
+  tile(entries);
+  QVector<qsizetype> packed;
+  packed.reserve((entries.size() + kFanout - 1) / kFanout);
+  for (qsizetype begin = 0; begin < entries.size(); begin += kFanout) {
+    Node node;
+    node.box = entries.at(begin).box;
+    node.first = links_.size();
+    node.count = std::min(kFanout, entries.size() - begin);
+    node.leaf = leaf;
+    for (qsizetype i = begin; i < begin + node.count; ++i) {
+      extend(node.box, entries.at(i).box);
+      links_.append(entries.at(i).link);
+    }
+    packed.append(nodes_.size());
+    nodes_.append(node);
+  }
+  return packed;
+}
+
+void RTree::containing(double latitude, double longitude, QVector<qsizetype>& found) const
+{
+  found.clear();
+  if ((root_ < 0) || !nodes_.at(root_).box.contains(latitude, longitude)) {
+    return;
+  }
+
+  QVarLengthArray<qsizetype, 64> pending{root_};
+  while (!pending.isEmpty()) {
+    const Node& node = nodes_.at(pending.back());
+    pending.removeLast();
+    for (qsizetype i = node.first; i < node.first + node.count; ++i) {
+      const qsizetype link = links_.at(i);
+      if (node.leaf) {
+        if (boxes_.at(link).contains(latitude, longitude)) {
+          found.append(link);
+        }
+      } else if (nodes_.at(link).box.contains(latitude, longitude)) {
+        pending.append(link);
+      }
+    }
+  }
+  std::sort(found.begin(), found.end());
+}
+
+} // namespace gpsbabel
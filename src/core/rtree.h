@@ -0,0 +1,108 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_RTREE_H_
+#define SRC_CORE_RTREE_H_
+
+#include <QVector>   // for QVector
+#include <QtGlobal>  // for qsizetype
+
+namespace gpsbabel
+{
+
+/*
+ * An R-tree over a fixed set of boxes in latitude and longitude, given
+ * in degrees and identified by their index.
+ *
+ * The tree is packed once with the sort-tile-recursive method: the
+ * boxes are sorted into vertical slices by the longitude of their
+ * centers and each slice by latitude, kFanout to a node, and likewise
+ * the nodes of every level until one is left.  Like SpatialIndex it is
+ * a snapshot that holds no pointers.  Longitudes aren't wrapped, so a
+ * box can't cross the antimeridian.
+ *
+ * containing() finds the boxes a point is in, borders included, in
+ * index order.  Boxes with a non-finite corner are never found.
+ */
+class RTree
+{
+public:
+  /* Types */
+
+  struct Box {
+    double min_latitude{};
+    double max_latitude{};
+    double min_longitude{};
+    double max_longitude{};
+
+    bool contains(double latitude, double longitude) const
+    {
+      return (latitude >= min_latitude) && (latitude <= max_latitude) &&
+             (longitude >= min_longitude) && (longitude <= max_longitude);
+    }
+  };
+
+  /* Special Member Functions */
+
+  explicit RTree(const QVector<Box>& boxes);
+
+  /* Member Functions */
+
+  qsizetype size() const {return boxes_.size();}
+  /* Replaces the contents of found, so a caller can reuse one vector. */
+  void containing(double latitude, double longitude, QVector<qsizetype>& found) const;
+
+private:
+  /* Types */
+
+  /* A box or a node with the box around it, while the tree is packed. */
+  struct Entry {
+    Box box;
+    qsizetype link{};
+  };
+
+  /* The children of a node are links_[first, first + count). */
+  struct Node {
+    Box box;
+    qsizetype first{};
+    qsizetype count{};
+    bool leaf{};  // the children are boxes rather than nodes
+  };
+
+  /* Constants */
+
+  static constexpr qsizetype kFanout = 16;
+
+  /* Member Functions */
+
+  static void extend(Box& box, const Box& other);
+  static void tile(QVector<Entry>& entries);
+  QVector<qsizetype> pack(QVector<Entry> entries, bool leaf);
+
+  /* Data Members */
+
+  QVector<Box> boxes_;
+  QVector<Node> nodes_;
+  QVector<qsizetype> links_;
+  qsizetype root_{-1};
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_RTREE_H_
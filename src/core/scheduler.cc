@@ -0,0 +1,296 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <algorithm>              // for max, min
+#include <cstdlib>                // for exit
+#include <utility>                // for move, exchange
+
+#include <QThread>                // for QThread
+
+#if __WIN32__
+#include <windows.h>              // for GetProcessAffinityMask, GetCurrentProcess, DWORD_PTR
+#include <bitset>                 // for bitset
+#elif defined(__linux__)
+#include <sched.h>                // for sched_getaffinity, cpu_set_t, CPU_COUNT, CPU_ZERO
+#endif
+
+#include "defs.h"                 // for fatal_set_throws, fatal_throws
+#include "src/core/logging.h"     // for FatalError
+#include "src/core/objectpool.h"  // for ObjectPool
+#include "src/core/scheduler.h"
+
+namespace gpsbabel
+{
+
+thread_local std::size_t Scheduler::slot_ = 0;
+
+Scheduler& Scheduler::instance()
+{
+  // Never destroyed, so that exit() from any thread doesn't join workers
+  // that may be busy.
+  static auto* scheduler = new Scheduler;
+  return *scheduler;
+}
+
+void Scheduler::set_threads(int threads)
+{
+  Scheduler& scheduler = instance();
+  if (scheduler.started_.load(std::memory_order_acquire)) {
+    scheduler.stop();
+  }
+  threads_ = std::max(threads, 0);
+}
+
+int Scheduler::threads()
+{
+  return (threads_ > 0) ? threads_ : available_cpus();
+}
+
+int Scheduler::available_cpus()
+{
+  static const int cpus = []() {
+#if __WIN32__
+    DWORD_PTR process_mask = 0;
+    DWORD_PTR system_mask = 0;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask) && (process_mask != 0)) {
+      return static_cast<int>(std::bitset<8 * sizeof(DWORD_PTR)>(process_mask).count());
+    }
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+      return std::max(CPU_COUNT(&set), 1);
+    }
+#endif
+    return std::max(QThread::idealThreadCount(), 1);
+  }();
+  return cpus;
+}
+
+/* Called with lock_ held. */
+void Scheduler::start()
+{
+  const int count = threads();
+  for (int i = 0; i < count; ++i) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  started_.store(true, std::memory_order_release);
+  for (int i = 1; i < count; ++i) {
+    workers_.emplace_back(&Scheduler::work, this, static_cast<std::size_t>(i));
+  }
+}
+
+void Scheduler::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+  workers_.clear();
+  queues_.clear();
+  stopping_ = false;
+  started_.store(false, std::memory_order_release);
+}
+
+void Scheduler::submit(Task task)
+{
+  if (!started_.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (!started_.load(std::memory_order_relaxed)) {
+      start();
+    }
+  }
+
+  Queue& queue = *queues_.at(slot_);
+  {
+    std::lock_guard<std::mutex> lock(queue.lock);
+    queue.tasks.push_back(std::move(task));
+    queued_.fetch_add(1, std::memory_order_release);
+  }
+  // Idle workers and waiting threads alike may take it.
+  std::lock_guard<std::mutex> lock(lock_);
+  wake_.notify_all();
+}
+
+/*
+ * The newest task of the calling thread's own queue, or else the oldest
+ * of another queue.
+ */
+bool Scheduler::pop(Task& task)
+{
+  if (!started_.load(std::memory_order_acquire) || (queued_.load(std::memory_order_acquire) == 0)) {
+    return false;
+  }
+  const std::size_t count = queues_.size();
+  for (std::size_t i = 0; i < count; ++i) {
+    Queue& queue = *queues_.at((slot_ + i) % count);
+    std::lock_guard<std::mutex> lock(queue.lock);
+    if (queue.tasks.empty()) {
+      continue;
+    }
+    if (i == 0) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    } else {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    }
+    queued_.fetch_sub(1, std::memory_order_acq_rel);
+    return true;
+  }
+  return false;
+}
+
+void Scheduler::execute(Task& task)
+{
+  const bool bypass = ObjectPool::thread_bypass();
+  const bool throws = fatal_throws();
+  ObjectPool::set_thread_bypass(true);
+  // A fatal error ends the task, not the process, see TaskGroup::wait().
+  fatal_set_throws(true);
+  try {
+    task.work();
+  } catch (...) {
+    task.group->fail(std::current_exception());
+  }
+  fatal_set_throws(throws);
+  ObjectPool::set_thread_bypass(bypass);
+  // Let go of whatever the task holds before its group may go away.
+  task.work = nullptr;
+  task.group->finish();
+}
+
+void Scheduler::work(std::size_t slot)
+{
+  slot_ = slot;
+  for (;;) {
+    Task task;
+    while (pop(task)) {
+      execute(task);
+    }
+    std::unique_lock<std::mutex> lock(lock_);
+    wake_.wait(lock, [this]() {
+      return stopping_ || (queued_.load(std::memory_order_acquire) > 0);
+    });
+    if (stopping_) {
+      return;
+    }
+  }
+}
+
+TaskGroup::~TaskGroup()
+{
+  try {
+    wait();
+  } catch (...) {
+    // Whoever wanted to know has called wait() already.
+  }
+}
+
+void TaskGroup::run(std::function<void()> work)
+{
+  pending_.fetch_add(1, std::memory_order_relaxed);
+  Scheduler::Task task{std::move(work), this};
+  if (Scheduler::threads() <= 1) {
+    Scheduler::execute(task);
+  } else {
+    Scheduler::instance().submit(std::move(task));
+  }
+}
+
+void TaskGroup::wait()
+{
+  Scheduler& scheduler = Scheduler::instance();
+  while (pending_.load(std::memory_order_acquire) > 0) {
+    // Whatever is queued may be what this group waits for.
+    Scheduler::Task task;
+    if (scheduler.pop(task)) {
+      Scheduler::execute(task);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(scheduler.lock_);
+    scheduler.wake_.wait(lock, [this, &scheduler]() {
+      return (pending_.load(std::memory_order_acquire) == 0) ||
+             (scheduler.queued_.load(std::memory_order_acquire) > 0);
+    });
+  }
+
+  std::exception_ptr error;
+  {
+    std::lock_guard<std::mutex> lock(error_lock_);
+    error = std::exchange(error_, nullptr);
+  }
+  if (error) {
+    try {
+      std::rethrow_exception(error);
+    } catch (const FatalError&) {
+      // fatal() has reported the error already.
+      if (!fatal_throws()) {
+        exit(1);
+      }
+      throw;
+    }
+  }
+}
+
+void TaskGroup::finish()
+{
+  Scheduler& scheduler = Scheduler::instance();
+  if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    // The group may be gone as soon as its waiter sees zero, so only
+    // the scheduler is touched from here on.
+    std::lock_guard<std::mutex> lock(scheduler.lock_);
+    scheduler.wake_.notify_all();
+  }
+}
+
+void TaskGroup::fail(std::exception_ptr error)
+{
+  std::lock_guard<std::mutex> lock(error_lock_);
+  if (!error_) {
+    error_ = std::move(error);
+  }
+}
+
+void parallel_for(qsizetype count, qsizetype chunk,
+                  const std::function<void(qsizetype begin, qsizetype end)>& work)
+{
+  chunk = std::max<qsizetype>(chunk, 1);
+  if ((count <= chunk) || (Scheduler::threads() <= 1)) {
+    if (count > 0) {
+      work(0, count);
+    }
+    return;
+  }
+
+  TaskGroup group;
+  for (qsizetype begin = 0; begin < count; begin += chunk) {
+    const qsizetype end = std::min(begin + chunk, count);
+    group.run([&work, begin, end]() {
+      work(begin, end);
+    });
+  }
+  group.wait();
+}
+
+} // namespace gpsbabel
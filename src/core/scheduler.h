@@ -0,0 +1,175 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_SCHEDULER_H_
+#define SRC_CORE_SCHEDULER_H_
+
+#include <atomic>              // for atomic
+#include <condition_variable>  // for condition_variable
+#include <cstddef>             // for size_t
+#include <deque>               // for deque
+#include <exception>           // for exception_ptr
+#include <functional>          // for function
+#include <memory>              // for unique_ptr
+#include <mutex>               // for mutex
+#include <thread>              // for thread
+#include <vector>              // for vector
+
+#include <QVector>             // for QVector
+#include <QtGlobal>            // for qsizetype
+
+namespace gpsbabel
+{
+
+class TaskGroup;
+
+/*
+ * The threads that formats, filters and the stages of a run share.
+ *
+ * Work is submitted as the tasks of a TaskGroup.  Every worker has a
+ * queue of its own: the tasks it submits go to the back, and it takes
+ * its next task from the back too, so nested work stays with the data
+ * that is already in its cache.  An idle worker steals from the front
+ * of the other queues, where the oldest and usually largest tasks wait.
+ * Threads that aren't workers share one more queue.  A thread waiting
+ * for a group runs queued tasks meanwhile, so groups may be nested
+ * without running out of threads.
+ *
+ * threads() counts the waiting thread, so there are one fewer workers.
+ * By default there are as many threads as CPUs the process may run on,
+ * which honours taskset and the like; --threads sets the number.  With
+ * one thread every task runs as soon as it is submitted, on the thread
+ * that submits it, so the results are those of a serial run.  Workers
+ * are only started on first use, so the -J server can fork before that.
+ *
+ * Tasks run with ObjectPool's thread bypass set on whichever thread runs
+ * them, and with fatal() throwing a FatalError instead of exiting, see
+ * TaskGroup.  Anything else a task changes about its thread, e.g. its
+ * lists, it must put back before it returns.  Work that blocks on other work,
+ * like the stages of a pipeline, belongs on threads of its own.
+ */
+class Scheduler
+{
+public:
+  static Scheduler& instance();
+
+  /* Zero restores the default.  Must not be called while tasks run. */
+  static void set_threads(int threads);
+  static int threads();
+  static int available_cpus();
+
+private:
+  friend class TaskGroup;
+
+  /* Types */
+
+  struct Task {
+    std::function<void()> work;
+    TaskGroup* group{nullptr};
+  };
+
+  struct Queue {
+    std::mutex lock;
+    std::deque<Task> tasks;
+  };
+
+  /* Member Functions */
+
+  Scheduler() = default;
+  void start();
+  void stop();
+  void submit(Task task);
+  bool pop(Task& task);
+  static void execute(Task& task);
+  void work(std::size_t slot);
+
+  /* Data Members */
+
+  static inline int threads_ = 0;
+  static thread_local std::size_t slot_;  // 0 for threads that aren't workers
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> workers_;
+  std::atomic<bool> started_{false};
+  std::atomic<int> queued_{0};
+  std::mutex lock_;
+  std::condition_variable wake_;
+  bool stopping_{false};
+};
+
+/*
+ * Tasks that are waited for together.
+ *
+ * run() hands a task to the scheduler and wait() returns once all tasks
+ * run so far are done, rethrowing the first exception any of them threw.
+ * A FatalError is only rethrown to a thread where fatal() throws; on any
+ * other wait() exits, as fatal() would have there.  The destructor waits
+ * too, but drops any exception.
+ */
+class TaskGroup
+{
+public:
+  TaskGroup() = default;
+  ~TaskGroup();
+  TaskGroup(const TaskGroup&) = delete;
+  TaskGroup& operator=(const TaskGroup&) = delete;
+
+  void run(std::function<void()> work);
+  void wait();
+
+private:
+  friend class Scheduler;
+
+  void finish();
+  void fail(std::exception_ptr error);
+
+  std::atomic<int> pending_{0};
+  std::mutex error_lock_;
+  std::exception_ptr error_;
+};
+
+/*
+ * Calls work(begin, end) on consecutive ranges of [0, count), each of
+ * chunk indices but perhaps the last, as tasks of one group, and waits
+ * for them.  Each index must be independent of the others.  Fewer than
+ * two chunks run on the calling thread.
+ */
+void parallel_for(qsizetype count, qsizetype chunk,
+                  const std::function<void(qsizetype begin, qsizetype end)>& work);
+
+/*
+ * work(i) for every i in [0, count), in that order whichever thread
+ * computed them, chunk indices to a task.
+ */
+template <typename T, typename Work>
+QVector<T> parallel_map(qsizetype count, qsizetype chunk, Work work)
+{
+  QVector<T> results(count);
+  T* out = results.data();
+  parallel_for(count, chunk, [out, &work](qsizetype begin, qsizetype end) {
+    for (qsizetype i = begin; i < end; ++i) {
+      out[i] = work(i);
+    }
+  });
+  return results;
+}
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_SCHEDULER_H_
@@ -0,0 +1,240 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <algorithm>                // for max, min, nth_element, sort, stable_sort, lower_bound, upper_bound
+#include <cmath>                    // for abs, ceil, cos, floor, isfinite, sin, sqrt
+#include <numbers>                  // for pi
+#include <utility>                  // for pair
+
+#include <QHash>                    // for QHash
+#include <QVector>                  // for QVector
+#include <QtGlobal>                 // for qint64, qsizetype
+
+#include "src/core/spatialindex.h"
+
+namespace gpsbabel
+{
+
+SpatialIndex::SpatialIndex(const QVector<double>& latitudes, const QVector<double>& longitudes, double radius) :
+  cell_(std::max(radius * kSlack, kMinCell)),
+  latitudes_(latitudes),
+  longitudes_(longitudes)
+{
+  const qsizetype count = latitudes_.size();
+  x_.resize(count);
+  y_.resize(count);
+  z_.resize(count);
+  by_latitude_.reserve(count);
+  for (qsizetype i = 0; i < count; ++i) {
+    if (!std::isfinite(latitudes_.at(i)) || !std::isfinite(longitudes_.at(i))) {
+      all_finite_ = false;
+      continue;
+    }
+    unit_vector(latitudes_.at(i), longitudes_.at(i), x_[i], y_[i], z_[i]);
+    grid_[cell_of(x_.at(i), y_.at(i), z_.at(i))].append(i);
+    by_latitude_.append(i);
+  }
+  std::stable_sort(by_latitude_.begin(), by_latitude_.end(), [this](qsizetype a, qsizetype b) {
+    return latitudes_.at(a) < latitudes_.at(b);
+  });
+}
+
+void SpatialIndex::unit_vector(double latitude, double longitude, double& x, double& y, double& z)
+{
+  double lat = latitude * std::numbers::pi / 180.0;
+  double lon = longitude * std::numbers::pi / 180.0;
+  x = std::cos(lat) * std::cos(lon);
+  y = std::cos(lat) * std::sin(lon);
+  z = std::sin(lat);
+}
+
+SpatialIndex::Cell SpatialIndex::cell_of(double x, double y, double z) const
+{
+  return Cell{
+    static_cast<qint64>(std::floor(x / cell_)),
+    static_cast<qint64>(std::floor(y / cell_)),
+    static_cast<qint64>(std::floor(z / cell_))
+  };
+}
+
+double SpatialIndex::chord2(qsizetype i, double x, double y, double z) const
+{
+  double dx = x_.at(i) - x;
+  double dy = y_.at(i) - y;
+  double dz = z_.at(i) - z;
+  return dx * dx + dy * dy + dz * dz;
+}
+
+/*
+ * Call visit with the points of every occupied cell no more than reach
+ * cells from center along each axis.  A wide reach walks the occupied
+ * cells rather than the whole cube around center.
+ */
+template <typename F>
+void SpatialIndex::visit_cells(const Cell& center, qint64 reach, F&& visit) const
+{
+  const qint64 side = 2 * reach + 1;
+  if ((reach > 1024) || (side * side * side > grid_.size())) {
+    for (auto it = grid_.cbegin(); it != grid_.cend(); ++it) {
+      const Cell& c = it.key();
+      if ((std::abs(c.x - center.x) <= reach) && (std::abs(c.y - center.y) <= reach) &&
+          (std::abs(c.z - center.z) <= reach)) {
+        visit(it.value());
+      }
+    }
+    return;
+  }
+  for (qint64 dx = -reach; dx <= reach; ++dx) {
+    for (qint64 dy = -reach; dy <= reach; ++dy) {
+      for (qint64 dz = -reach; dz <= reach; ++dz) {
+        auto it = grid_.constFind(Cell{center.x + dx, center.y + dy, center.z + dz});
+        if (it != grid_.cend()) {
+          visit(it.value());
+        }
+      }
+    }
+  }
+}
+
+/*
+ * A chord is never longer than its arc, so every point within radius
+ * (in radians) lies no more than radius away along each axis.
+ */
+QVector<qsizetype> SpatialIndex::within(double latitude, double longitude, double radius) const
+{
+  QVector<qsizetype> result;
+  if (!std::isfinite(latitude) || !std::isfinite(longitude) || !(radius >= 0.0)) {
+    return result;
+  }
+  double x;
+  double y;
+  double z;
+  unit_vector(latitude, longitude, x, y, z);
+  const double reach_size = radius * kSlack;
+  const qint64 reach = (reach_size <= cell_) ? 1 :
+                       static_cast<qint64>(std::min(std::ceil(reach_size / cell_), 1.0e9));
+  visit_cells(cell_of(x, y, z), reach, [&result](const QVector<qsizetype>& points) {
+    result.append(points);
+  });
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+/*
+ * The cells are searched in shells around the query point.  A point not
+ * yet seen after shell s is in a cell at least s + 1 away along some
+ * axis, so it is at least s cells away, and the search stops once count
+ * points are known to be closer than that.
+ */
+QVector<qsizetype> SpatialIndex::nearest(double latitude, double longitude, qsizetype count) const
+{
+  QVector<qsizetype> result;
+  if ((count <= 0) || grid_.isEmpty() || !std::isfinite(latitude) || !std::isfinite(longitude)) {
+    return result;
+  }
+  double x;
+  double y;
+  double z;
+  unit_vector(latitude, longitude, x, y, z);
+  const Cell center = cell_of(x, y, z);
+
+  qint64 max_reach = 0;
+  for (auto it = grid_.cbegin(); it != grid_.cend(); ++it) {
+    const Cell& c = it.key();
+    max_reach = std::max({max_reach, std::abs(c.x - center.x), std::abs(c.y - center.y),
+                          std::abs(c.z - center.z)});
+  }
+
+  QVector<std::pair<double, qsizetype>> found;
+  auto take = [this, &found, x, y, z](const QVector<qsizetype>& points) {
+    for (qsizetype i : points) {
+      found.append({chord2(i, x, y, z), i});
+    }
+  };
+  for (qint64 s = 0; s <= max_reach; ++s) {
+    const qint64 side = 2 * s + 1;
+    if ((s > 1024) || (side * side * side > grid_.size())) {
+      // Few occupied cells are left, so take them all at once.
+      for (auto it = grid_.cbegin(); it != grid_.cend(); ++it) {
+        const Cell& c = it.key();
+        if (std::max({std::abs(c.x - center.x), std::abs(c.y - center.y),
+                      std::abs(c.z - center.z)}) >= s) {
+          take(it.value());
+        }
+      }
+      break;
+    }
+    for (qint64 dx = -s; dx <= s; ++dx) {
+      for (qint64 dy = -s; dy <= s; ++dy) {
+        const bool face = (std::abs(dx) == s) || (std::abs(dy) == s);
+        const qint64 step = (face || (s == 0)) ? 1 : 2 * s;
+        for (qint64 dz = -s; dz <= s; dz += step) {
+          auto it = grid_.constFind(Cell{center.x + dx, center.y + dy, center.z + dz});
+          if (it != grid_.cend()) {
+            take(it.value());
+          }
+        }
+      }
+    }
+    if (found.size() >= count) {
+      std::nth_element(found.begin(), found.begin() + (count - 1), found.end());
+      const double bound = s * cell_ / kSlack;
+      if (std::sqrt(found.at(count - 1).first) < bound) {
+        break;
+      }
+    }
+  }
+
+  std::sort(found.begin(), found.end());
+  const qsizetype n = std::min(count, found.size());
+  result.reserve(n);
+  for (qsizetype i = 0; i < n; ++i) {
+    result.append(found.at(i).second);
+  }
+  return result;
+}
+
+/*
+ * A box with min_longitude above max_longitude crosses the antimeridian.
+ */
+QVector<qsizetype> SpatialIndex::in_box(double min_latitude, double max_latitude,
+                                        double min_longitude, double max_longitude) const
+{
+  QVector<qsizetype> result;
+  auto first = std::lower_bound(by_latitude_.cbegin(), by_latitude_.cend(), min_latitude,
+  [this](qsizetype i, double lat) {
+    return latitudes_.at(i) < lat;
+  });
+  auto last = std::upper_bound(first, by_latitude_.cend(), max_latitude,
+  [this](double lat, qsizetype i) {
+    return lat < latitudes_.at(i);
+  });
+  const bool wraps = min_longitude > max_longitude;
+  for (auto it = first; it != last; ++it) {
+    double lon = longitudes_.at(*it);
+    if (wraps ? ((lon >= min_longitude) || (lon <= max_longitude)) :
+        ((lon >= min_longitude) && (lon <= max_longitude))) {
+      result.append(*it);
+    }
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+} // namespace gpsbabel
@@ -0,0 +1,108 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_SPATIALINDEX_H_
+#define SRC_CORE_SPATIALINDEX_H_
+
+#include <cstddef>   // for size_t
+
+#include <QHash>     // for QHash, qHashMulti
+#include <QVector>   // for QVector
+#include <QtGlobal>  // for qint64, qsizetype
+
+namespace gpsbabel
+{
+
+/*
+ * A grid over the unit vectors of a fixed set of points, given as
+ * latitudes and longitudes in degrees and identified by their index.
+ *
+ * The index is a snapshot: it holds no pointers to the points, so a
+ * caller that changes the positions must build a new one.  The cells
+ * are cubes a little wider than the radius passed to the constructor,
+ * so a radius query of up to that size visits 27 cells.
+ *
+ * within() returns candidates, a superset of the points inside the
+ * radius, for the caller to check with its own distance function.
+ * nearest() and in_box() are exact.  All results are in index order,
+ * except nearest() which orders by distance and then index.
+ *
+ * Points with a non-finite position are left out of the grid;
+ * all_finite() tells whether there were any.
+ */
+class SpatialIndex
+{
+public:
+  /* Special Member Functions */
+
+  SpatialIndex(const QVector<double>& latitudes, const QVector<double>& longitudes, double radius);
+
+  /* Member Functions */
+
+  qsizetype size() const {return x_.size();}
+  bool all_finite() const {return all_finite_;}
+  QVector<qsizetype> within(double latitude, double longitude, double radius) const;
+  QVector<qsizetype> nearest(double latitude, double longitude, qsizetype count) const;
+  QVector<qsizetype> in_box(double min_latitude, double max_latitude,
+                            double min_longitude, double max_longitude) const;
+
+private:
+  /* Types */
+
+  /* A cube of the grid. */
+  struct Cell {
+    qint64 x{};
+    qint64 y{};
+    qint64 z{};
+
+    bool operator==(const Cell& other) const = default;
+    friend size_t qHash(const Cell& c, size_t seed = 0) noexcept
+    {
+      return qHashMulti(seed, c.x, c.y, c.z);
+    }
+  };
+
+  /* Constants */
+
+  static constexpr double kMinCell = 1.0e-9;  // radians, keeps the cell numbers in range
+  static constexpr double kSlack = 1.001;     // so rounding can't move a close pair apart
+
+  /* Member Functions */
+
+  static void unit_vector(double latitude, double longitude, double& x, double& y, double& z);
+  Cell cell_of(double x, double y, double z) const;
+  double chord2(qsizetype i, double x, double y, double z) const;
+  template <typename F> void visit_cells(const Cell& center, qint64 reach, F&& visit) const;
+
+  /* Data Members */
+
+  double cell_;
+  bool all_finite_{true};
+  QVector<double> latitudes_;
+  QVector<double> longitudes_;
+  QVector<double> x_;
+  QVector<double> y_;
+  QVector<double> z_;
+  QVector<qsizetype> by_latitude_;  // finite points sorted by latitude, then index
+  QHash<Cell, QVector<qsizetype>> grid_;
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_SPATIALINDEX_H_
@@ -0,0 +1,41 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include "src/core/stringpool.h"
+
+namespace gpsbabel
+{
+
+QString StringPool::intern(const QString& str)
+{
+  // Keep the null/empty distinction some formats rely on.
+  if (str.isEmpty()) {
+    return str;
+  }
+
+  if (auto it = pool_.constFind(str); it != pool_.constEnd()) {
+    return *it;
+  }
+  if (pool_.size() < max_entries_) {
+    pool_.insert(str);
+  }
+  return str;
+}
+
+} // namespace gpsbabel
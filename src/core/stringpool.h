@@ -0,0 +1,55 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_STRINGPOOL_H_
+#define SRC_CORE_STRINGPOOL_H_
+
+#include <QSet>      // for QSet
+#include <QString>   // for QString
+#include <QtGlobal>  // for qsizetype
+
+namespace gpsbabel
+{
+
+/*
+ * QString's implicit sharing only helps when one instance is copied, but
+ * readers build equal strings independently, e.g. the same symbol name
+ * for every point.  Interning returns a previously seen equal string so
+ * all of them share one buffer.
+ *
+ * This is meant for low-cardinality fields.  To bound the cost of
+ * misuse the pool stops growing after max_entries distinct strings and
+ * returns further new strings unchanged.
+ */
+class StringPool
+{
+public:
+  explicit StringPool(qsizetype max_entries = 4096) : max_entries_(max_entries) {}
+
+  QString intern(const QString& str);
+  void clear() {pool_.clear();}
+
+private:
+  QSet<QString> pool_;
+  qsizetype max_entries_;
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_STRINGPOOL_H_
@@ -20,28 +20,87 @@
 
 #include <QtGlobal>          // for qint64
 
+#include <QByteArray>        // for QByteArray
 #include <QByteArrayView>    // for QByteArrayView
+#include <QChar>             // for QChar, QChar::ReplacementCharacter
+#include <QLatin1Char>       // for QLatin1Char
 #include <QFile>             // for QFile
 #include <QFlags>            // for QFlags
 #include <QIODevice>         // for QIODevice
 #include <QIODeviceBase>           // for QIODeviceBase::OpenMode
 #include <QStringConverter>  // for QStringConverter, QStringConverter::Utf8, QStringConverter::Encoding, QStringConverter::Utf16
+#include <QStringDecoder>    // for QStringDecoder
+#include <QTextCodec>        // for QTextCodec
 
+#include <cstring>           // for memchr, memmove
+#include <memory>            // for make_unique
 #include <optional>          // for optional
 
 #include "defs.h"            // for fatal, list_codecs
 #include "src/core/textstream.h"
+#include "src/core/codepage.h"  // for Codepage
 #include "src/core/file.h"   // for File
 
 
 namespace gpsbabel
 {
 
+static constexpr qsizetype kFastBufferSize = 256 * 1024;
+
 void TextStream::open(const QString& fname, QIODevice::OpenMode mode, const char* module, const char* codec_name)
 {
   std::optional<QStringConverter::Encoding> encoding = QStringConverter::encodingForName(codec_name);
   bool use_stringconverter = encoding.has_value();
 
+  fast_ = Fast::off;
+  if ((mode & QFile::ReadOnly) && !(mode & QFile::WriteOnly)) {
+    if (encoding.has_value() && (encoding.value() == QStringConverter::Utf8)) {
+      fast_ = Fast::utf8;
+    } else if (QByteArray(codec_name).compare("US-ASCII", Qt::CaseInsensitive) == 0) {
+      fast_ = Fast::ascii;
+    } else if (!encoding.has_value()) {
+      codepage_ = gpsbabel::Codepage::find(QTextCodec::codecForName(codec_name));
+      if (codepage_ != nullptr) {
+        fast_ = Fast::codepage;
+      }
+    }
+  }
+  if (fast_ != Fast::off) {
+    file_ = new gpsbabel::File(fname);
+    file_->open(mode);
+    /* A UTF-16 or UTF-32 byte order mark wins over the codec, as
+     * autodetection does below.  A UTF-8 one is skipped, or with a
+     * codepage wins too.
+     */
+    const QByteArray start = file_->peek(4);
+    std::optional<QStringConverter::Encoding> bom = QStringConverter::encodingForData(start);
+    if (!bom.has_value() ||
+        ((bom.value() == QStringConverter::Utf8) && (fast_ != Fast::codepage))) {
+      if (bom.has_value()) {
+        file_->skip(3);
+      }
+      buffer_.resize(kFastBufferSize);
+      begin_ = end_ = 0;
+      base_ = file_->pos();
+      eof_ = false;
+      decoder_ = QStringDecoder(QStringConverter::Utf8, QStringConverter::Flag::Stateless);
+      if (gpsbabel::ReadAhead::depth() > 0) {
+        ahead_ = std::make_unique<gpsbabel::ReadAhead>([this](char* data, qint64 maxlen) {
+          return file_->read(data, maxlen);
+        }, gpsbabel::ReadAhead::depth());
+        ahead_->start(file_->pos());
+      }
+      return;
+    }
+    fast_ = Fast::off;
+    setDevice(file_);
+    setEncoding(bom.value());
+    if (bom.value() == QStringConverter::Utf8) {
+      setAutoDetectUnicode(true);
+    }
+    return;
+  }
+
   /* When reading autodetect unicode.
    * The requested codec may not be supported by QStringConverter,
    * but autodetection may switch to a converter that is.
@@ -87,14 +146,199 @@ void TextStream::open(const QString& fname, QIODevice::OpenMode mode, const char
   }
 }
 
+bool TextStream::nextLine(QByteArrayView* line)
+{
+  for (;;) {
+    const char* data = buffer_.constData();
+    const auto* nl = static_cast<const char*>(memchr(data + begin_, '\n', end_ - begin_));
+    if (nl != nullptr) {
+      qsizetype len = nl - (data + begin_);
+      // Like QTextStream, only a \r that comes before the \n is dropped.
+      qsizetype trimmed = ((len > 0) && (nl[-1] == '\r')) ? len - 1 : len;
+      *line = QByteArrayView(data + begin_, trimmed);
+      begin_ += len + 1;
+      line_ended_ = true;
+      return true;
+    }
+
+    if (eof_) {
+      if (begin_ == end_) {
+        return false;
+      }
+      *line = QByteArrayView(data + begin_, end_ - begin_);
+      begin_ = end_;
+      line_ended_ = false;
+      return true;
+    }
+
+    /* Keep the partial line and read more behind it. */
+    if (begin_ > 0) {
+      memmove(buffer_.data(), buffer_.constData() + begin_, end_ - begin_);
+      base_ += begin_;
+      end_ -= begin_;
+      begin_ = 0;
+    }
+    if (end_ == buffer_.size()) {
+      buffer_.resize(buffer_.size() * 2);
+    }
+    qint64 count = fetch(buffer_.data() + end_, buffer_.size() - end_);
+    if (count <= 0) {
+      eof_ = true;
+    } else {
+      end_ += count;
+    }
+  }
+}
+
+qint64 TextStream::fetch(char* data, qint64 maxlen)
+{
+  return ahead_ ? ahead_->read(data, maxlen) : file_->read(data, maxlen);
+}
+
+QString TextStream::readLine()
+{
+  if (fast_ == Fast::off) {
+    return QTextStream::readLine();
+  }
+  QString line;
+  if (!readLineInto(&line)) {
+    return QString();
+  }
+  return line;
+}
+
+bool TextStream::readLineInto(QString* line)
+{
+  if (fast_ == Fast::off) {
+    return QTextStream::readLineInto(line);
+  }
+
+  QByteArrayView bytes;
+  if (!nextLine(&bytes)) {
+    if (line != nullptr) {
+      line->clear();
+    }
+    return false;
+  }
+  if (line != nullptr) {
+    decode(bytes, line);
+  }
+  return true;
+}
+
+void TextStream::decode(QByteArrayView bytes, QString* text)
+{
+  /* Reuse the storage of text, a UTF-16 string never needs more code
+   * units than the UTF-8 or codepage it came from has bytes. */
+  text->resize(bytes.size());
+  QChar* out = text->data();
+  if (fast_ == Fast::utf8) {
+    QChar* out_end = decoder_.appendToBuffer(out, bytes);
+    text->truncate(out_end - out);
+  } else if (fast_ == Fast::codepage) {
+    codepage_->decode(bytes.data(), bytes.size(), reinterpret_cast<char16_t*>(out));
+  } else {
+    const auto* in = reinterpret_cast<const unsigned char*>(bytes.data());
+    for (qsizetype i = 0; i < bytes.size(); ++i) {
+      out[i] = (in[i] < 128) ? QChar(QLatin1Char(in[i])) : QChar(QChar::ReplacementCharacter);
+    }
+  }
+}
+
+QString TextStream::readAll()
+{
+  if (fast_ == Fast::off) {
+    return QTextStream::readAll();
+  }
+
+  /* All of the rest is decoded at once, so no character is split. */
+  QByteArray bytes(buffer_.constData() + begin_, end_ - begin_);
+  base_ += end_;
+  begin_ = end_ = 0;
+  while (!eof_) {
+    qint64 count = fetch(buffer_.data(), buffer_.size());
+    if (count <= 0) {
+      eof_ = true;
+    } else {
+      bytes.append(buffer_.constData(), count);
+      base_ += count;
+    }
+  }
+  QString text;
+  decode(bytes, &text);
+  return text;
+}
+
+bool TextStream::readLineInto(QByteArrayView* line)
+{
+  if ((fast_ == Fast::off) || (fast_ == Fast::codepage)) {
+    fatal("TextStream: byte lines are only available from UTF-8 or US-ASCII input.\n");
+  }
+  QByteArrayView bytes;
+  bool ok = nextLine(&bytes);
+  if (line != nullptr) {
+    *line = ok ? bytes : QByteArrayView();
+  }
+  return ok;
+}
+
+bool TextStream::atEnd()
+{
+  if (fast_ == Fast::off) {
+    return QTextStream::atEnd();
+  }
+  if (begin_ < end_) {
+    return false;
+  }
+  if (!eof_) {
+    base_ += end_;
+    begin_ = end_ = 0;
+    qint64 count = fetch(buffer_.data(), buffer_.size());
+    if (count > 0) {
+      end_ = count;
+      return false;
+    }
+    eof_ = true;
+  }
+  return true;
+}
+
+qint64 TextStream::bytePos() const
+{
+  return (fast_ == Fast::off) ? -1 : base_ + begin_;
+}
+
+bool TextStream::seekBytes(qint64 offset)
+{
+  if (fast_ == Fast::off) {
+    return false;
+  }
+  if (ahead_) {
+    ahead_->stop();
+  }
+  if (!file_->seek(offset)) {
+    return false;
+  }
+  if (ahead_) {
+    ahead_->start(offset);
+  }
+  base_ = offset;
+  begin_ = end_ = 0;
+  eof_ = false;
+  return true;
+}
+
 void TextStream::close()
 {
   flush();
+  ahead_.reset();
   if (file_ != nullptr) {
     file_->close();
     delete file_;
     file_ = nullptr;
   }
+  fast_ = Fast::off;
+  buffer_.clear();
   if (device_ != nullptr) {
     device_->close();
     delete device_;
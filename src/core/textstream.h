@@ -20,27 +20,87 @@
 #define SRC_CORE_TEXTSTREAM_INCLUDED_H_
 
 
+#include <QByteArray>              // for QByteArray
+#include <QByteArrayView>          // for QByteArrayView
 #include <QIODevice>               // for QIODevice
 #include <QIODeviceBase>           // for QIODeviceBase::OpenMode
 #include <QString>                 // for QString
+#include <QStringDecoder>          // for QStringDecoder
 #include <QTextStream>             // for QTextStream
 
+#include <memory>                  // for unique_ptr
+
 #include "src/core/codecdevice.h"  // for CodecDevice
+#include "src/core/codepage.h"     // for Codepage
 #include "src/core/file.h"         // for File
+#include "src/core/readahead.h"    // for ReadAhead
 
 
 namespace gpsbabel
 {
 
+/*
+ * UTF-8, US-ASCII and single byte codepage input is not read through
+ * QTextStream.  Lines are found with memchr in a large buffer and decoded
+ * straight into the caller's string, which keeps its storage from line to
+ * line with readLineInto.  readLineInto(QByteArrayView*) skips decoding
+ * entirely for readers of UTF-8 or US-ASCII that only need bytes; the
+ * view lasts until the next read.
+ * With -R that input is also read ahead on a background thread.
+ * bytePos() and seekBytes() let readers resume such input where an
+ * earlier run stopped, see Checkpoint.
+ * Other input, and all output, goes through QTextStream as before.
+ *
+ * Only the readers declared here know about the fast path, so the ones
+ * of QTextStream that don't are deleted.
+ */
 class TextStream : public QTextStream
 {
 public:
   void open(const QString& fname, QIODevice::OpenMode mode, const char* module, const char* codec = "UTF-8");
   void close();
 
+  QString readLine();
+  bool readLineInto(QString* line);
+  bool readLineInto(QByteArrayView* line);
+  QString readAll();
+  bool atEnd();
+
+  QString read(qint64 maxlen) = delete;
+  QString readLine(qint64 maxlen) = delete;
+  bool readLineInto(QString* line, qint64 maxlen) = delete;
+  qint64 pos() const = delete;
+  bool seek(qint64 pos) = delete;
+  void skipWhiteSpace() = delete;
+  template <typename T>
+  TextStream& operator>>(T& value) = delete;
+
+  /* The file offset of the next line, -1 for input QTextStream reads. */
+  qint64 bytePos() const;
+  bool seekBytes(qint64 offset);
+  /* Whether the last line read was ended by a line break, not by the end. */
+  bool lineEnded() const {return line_ended_;}
+
 private:
+  enum class Fast {off, utf8, ascii, codepage};
+
+  bool nextLine(QByteArrayView* line);
+  void decode(QByteArrayView bytes, QString* text);
+  qint64 fetch(char* data, qint64 maxlen);
+
   gpsbabel::File* file_{nullptr};
   gpsbabel::CodecDevice* device_{nullptr};
+
+  Fast fast_{Fast::off};
+  const gpsbabel::Codepage* codepage_{nullptr};
+  QByteArray buffer_;
+  qsizetype begin_{0};  // start of the unread data in buffer_
+  qsizetype end_{0};    // end of the valid data in buffer_
+  qint64 base_{0};      // file offset of buffer_[0]
+  bool line_ended_{false};
+  bool eof_{false};
+  QStringDecoder decoder_;
+  std::unique_ptr<gpsbabel::ReadAhead> ahead_;
 };
 
 } // namespace gpsbabel
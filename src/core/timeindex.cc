@@ -0,0 +1,117 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <algorithm>              // for is_sorted, lower_bound, max, stable_sort, upper_bound
+#include <numeric>                // for iota
+
+#include <QVector>                // for QVector
+#include <QtGlobal>               // for qint64, qsizetype
+
+#include "src/core/timeindex.h"
+
+namespace gpsbabel
+{
+
+void TimeIndex::reserve(qsizetype count)
+{
+  times_.reserve(count);
+  positions_.reserve(count);
+}
+
+void TimeIndex::append(qint64 msecs, qsizetype position)
+{
+  times_.append(msecs);
+  positions_.append(position);
+}
+
+void TimeIndex::finish(qsizetype list_size)
+{
+  ordered_ = (times_.size() == list_size) && std::is_sorted(times_.cbegin(), times_.cend());
+  if (!std::is_sorted(times_.cbegin(), times_.cend())) {
+    QVector<qsizetype> order(times_.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](qsizetype a, qsizetype b) {
+      return times_.at(a) < times_.at(b);
+    });
+    QVector<qint64> times;
+    QVector<qsizetype> positions;
+    times.reserve(order.size());
+    positions.reserve(order.size());
+    for (qsizetype i : order) {
+      times.append(times_.at(i));
+      positions.append(positions_.at(i));
+    }
+    times_.swap(times);
+    positions_.swap(positions);
+  }
+  max_gap_ = 0;
+  for (qsizetype i = 1; i < times_.size(); ++i) {
+    max_gap_ = std::max(max_gap_, times_.at(i) - times_.at(i - 1));
+  }
+}
+
+/* The first entry at or after msecs, or size() if there is none. */
+qsizetype TimeIndex::lower_bound(qint64 msecs) const
+{
+  return std::lower_bound(times_.cbegin(), times_.cend(), msecs) - times_.cbegin();
+}
+
+/* The first entry after msecs, or size() if there is none. */
+qsizetype TimeIndex::upper_bound(qint64 msecs) const
+{
+  return std::upper_bound(times_.cbegin(), times_.cend(), msecs) - times_.cbegin();
+}
+
+/*
+ * The entry closest in time to msecs, or -1 if the index is empty.
+ * Of several entries as close the one first in list order wins.
+ */
+qsizetype TimeIndex::nearest(qint64 msecs) const
+{
+  if (times_.isEmpty()) {
+    return -1;
+  }
+  qsizetype after = lower_bound(msecs);
+  if (after == 0) {
+    return 0;
+  }
+  // The first of the entries at the latest time before msecs.
+  qsizetype before = lower_bound(times_.at(after - 1));
+  if (after == times_.size()) {
+    return before;
+  }
+  qint64 before_diff = msecs - times_.at(before);
+  qint64 after_diff = times_.at(after) - msecs;
+  if ((before_diff < after_diff) ||
+      ((before_diff == after_diff) && (positions_.at(before) < positions_.at(after)))) {
+    return before;
+  }
+  return after;
+}
+
+/* Linear interpolation of a value between two points in time. */
+double TimeIndex::interpolate(qint64 t0, double v0, qint64 t1, double v1, qint64 msecs)
+{
+  if (t1 == t0) {
+    return v1;
+  }
+  return v0 + (v1 - v0) * static_cast<double>(msecs - t0) / static_cast<double>(t1 - t0);
+}
+
+} // namespace gpsbabel
@@ -0,0 +1,74 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_TIMEINDEX_H_
+#define SRC_CORE_TIMEINDEX_H_
+
+#include <QVector>   // for QVector
+#include <QtGlobal>  // for qint64, qsizetype
+
+namespace gpsbabel
+{
+
+/*
+ * The timestamps of a list of points in time order, for binary search.
+ *
+ * Points are appended with their time in milliseconds since the epoch
+ * and their position in the list; points without a time are left out.
+ * finish() sorts the entries, keeping list order among equal times, and
+ * must be called before any lookup.
+ *
+ * ordered() is true if every point had a time and the times never
+ * decrease, in which case entry i is list position i.
+ */
+class TimeIndex
+{
+public:
+  /* Member Functions */
+
+  void reserve(qsizetype count);
+  void append(qint64 msecs, qsizetype position);
+  void finish(qsizetype list_size);
+
+  qsizetype size() const {return times_.size();}
+  bool isEmpty() const {return times_.isEmpty();}
+  bool ordered() const {return ordered_;}
+  qint64 time(qsizetype entry) const {return times_.at(entry);}
+  qsizetype position(qsizetype entry) const {return positions_.at(entry);}
+  qint64 first_time() const {return times_.isEmpty() ? 0 : times_.first();}
+  qint64 last_time() const {return times_.isEmpty() ? 0 : times_.last();}
+  qint64 max_gap() const {return max_gap_;}
+
+  qsizetype lower_bound(qint64 msecs) const;
+  qsizetype upper_bound(qint64 msecs) const;
+  qsizetype nearest(qint64 msecs) const;
+  static double interpolate(qint64 t0, double v0, qint64 t1, double v1, qint64 msecs);
+
+private:
+  /* Data Members */
+
+  QVector<qint64> times_;
+  QVector<qsizetype> positions_;
+  qint64 max_gap_{0};  // longest time between neighbouring entries
+  bool ordered_{true};
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_TIMEINDEX_H_
@@ -0,0 +1,131 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <algorithm>              // for max
+#include <atomic>                 // for atomic, atomic_int, memory_order_relaxed, memory_order_release
+#include <utility>                // for as_const
+
+#include <QElapsedTimer>          // for QElapsedTimer
+#include <QFile>                  // for QFile
+#include <QIODevice>              // for QIODevice, QIODevice::WriteOnly, QIODevice::Text
+#include <QJsonArray>             // for QJsonArray
+#include <QJsonDocument>          // for QJsonDocument, QJsonDocument::Compact
+#include <QJsonObject>            // for QJsonObject
+#include <QMutex>                 // for QMutex, QMutexLocker
+#include <QVector>                // for QVector
+
+#include "src/core/trace.h"
+
+namespace gpsbabel
+{
+
+namespace
+{
+
+struct Event {
+  const char* category;
+  QString name;
+  QString detail;
+  qint64 begin_us;
+  qint64 end_us;
+  int tid;
+};
+
+QElapsedTimer timer;
+QMutex mutex;
+QVector<Event> events;
+
+/* The threads are numbered in the order they first record a span. */
+int thread_id()
+{
+  static std::atomic_int next{1};
+  thread_local int id = next.fetch_add(1, std::memory_order_relaxed);
+  return id;
+}
+
+} // namespace
+
+std::atomic<bool> Trace::enabled_{false};
+
+void Trace::start()
+{
+  if (!enabled()) {
+    timer.start();
+    thread_id(); // the starting thread is thread 1
+    enabled_.store(true, std::memory_order_release);
+  }
+}
+
+qint64 Trace::now_us()
+{
+  return timer.nsecsElapsed() / 1000;
+}
+
+void Trace::record(const char* category, const QString& name, const QString& detail,
+                   qint64 begin_us, qint64 end_us)
+{
+  const int tid = thread_id();
+  QMutexLocker locker(&mutex);
+  events.append({category, name, detail, begin_us, end_us, tid});
+}
+
+bool Trace::write(const QString& filename)
+{
+  QJsonArray trace_events;
+  QMutexLocker locker(&mutex);
+  int threads = 0;
+  for (const Event& event : std::as_const(events)) {
+    QJsonObject obj;
+    obj.insert(QStringLiteral("name"), event.name);
+    obj.insert(QStringLiteral("cat"), QString::fromLatin1(event.category));
+    obj.insert(QStringLiteral("ph"), QStringLiteral("X"));
+    obj.insert(QStringLiteral("ts"), event.begin_us);
+    obj.insert(QStringLiteral("dur"), event.end_us - event.begin_us);
+    obj.insert(QStringLiteral("pid"), 1);
+    obj.insert(QStringLiteral("tid"), event.tid);
+    if (!event.detail.isEmpty()) {
+      obj.insert(QStringLiteral("args"), QJsonObject{{QStringLiteral("detail"), event.detail}});
+    }
+    trace_events.append(obj);
+    threads = std::max(threads, event.tid);
+  }
+  for (int tid = 1; tid <= threads; ++tid) {
+    const QString name = (tid == 1) ? QStringLiteral("main") : QStringLiteral("worker %1").arg(tid - 1);
+    trace_events.append(QJsonObject{
+      {QStringLiteral("name"), QStringLiteral("thread_name")},
+      {QStringLiteral("ph"), QStringLiteral("M")},
+      {QStringLiteral("pid"), 1},
+      {QStringLiteral("tid"), tid},
+      {QStringLiteral("args"), QJsonObject{{QStringLiteral("name"), name}}}
+    });
+  }
+
+  QJsonObject root;
+  root.insert(QStringLiteral("traceEvents"), trace_events);
+  root.insert(QStringLiteral("displayTimeUnit"), QStringLiteral("ms"));
+
+  QFile file(filename);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    return false;
+  }
+  file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+  return true;
+}
+
+} // namespace gpsbabel
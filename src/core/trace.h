@@ -0,0 +1,89 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_TRACE_H_
+#define SRC_CORE_TRACE_H_
+
+#include <atomic>   // for atomic, memory_order_acquire
+
+#include <QString>  // for QString
+#include <QtGlobal> // for qint64
+
+namespace gpsbabel
+{
+
+/*
+ * Spans of a run in the Chrome trace event format, which Perfetto and
+ * chrome://tracing show as a timeline with one row per thread.
+ *
+ * Tracing is off until start() is called.  While it is off a TraceSpan
+ * costs a test of one flag, so spans can stay in hot code.  Spans may
+ * be recorded on any thread.
+ */
+class Trace
+{
+public:
+  static void start();
+  static bool enabled() {return enabled_.load(std::memory_order_acquire);}
+  static qint64 now_us();
+  static void record(const char* category, const QString& name, const QString& detail,
+                     qint64 begin_us, qint64 end_us);
+  static bool write(const QString& filename);
+
+private:
+  static std::atomic<bool> enabled_;
+};
+
+/*
+ * Records the time from its construction to its destruction as a span.
+ * The detail, e.g. a format and file name, is shown with the span.
+ */
+class TraceSpan
+{
+public:
+  TraceSpan(const char* category, const QString& name, const QString& detail = QString())
+  {
+    if (Trace::enabled()) {
+      category_ = category;
+      name_ = name;
+      detail_ = detail;
+      begin_us_ = Trace::now_us();
+    }
+  }
+  ~TraceSpan()
+  {
+    if (begin_us_ >= 0) {
+      Trace::record(category_, name_, detail_, begin_us_, Trace::now_us());
+    }
+  }
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+  TraceSpan(TraceSpan&&) = delete;
+  TraceSpan& operator=(TraceSpan&&) = delete;
+
+private:
+  const char* category_{nullptr};
+  QString name_;
+  QString detail_;
+  qint64 begin_us_{-1};
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_TRACE_H_
@@ -0,0 +1,162 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_UTF8STRING_H_
+#define SRC_CORE_UTF8STRING_H_
+
+#include <utility>     // for move
+
+#include <QByteArray>   // for QByteArray
+#include <QSharedData>  // for QExplicitlySharedDataPointer
+#include <QString>      // for QString
+#include <QtGlobal>     // for qsizetype
+
+#include "src/core/inputmapping.h"  // for InputMapping
+
+namespace gpsbabel
+{
+
+/*
+ * Text kept as UTF-8, for the waypoint fields that are mostly ASCII and
+ * mostly read and written as UTF-8.  It takes half the memory of a
+ * QString for such text, and utf8() and fromUtf8() move the bytes of a
+ * reader or writer that works in UTF-8 through without transcoding.
+ *
+ * Like DateTime for QDateTime it stands in for a QString: it is made from
+ * one implicitly and converts to one on demand, so a field can be moved
+ * over without touching the code that uses it as a QString.  The
+ * conversion decodes the bytes every time, so code that uses the text
+ * repeatedly should keep its own QString.  A null QString stays null.
+ *
+ * Made with fromInput() it refers to the bytes of a mapped input and
+ * keeps the mapping, so text that is only carried from input to output
+ * is never copied.  Changing it makes a copy of its own.
+ */
+class Utf8String
+{
+public:
+  Utf8String() = default;
+  Utf8String(const QString& s) : bytes_(from_qstring(s)) {}
+
+  static Utf8String fromUtf8(QByteArray utf8)
+  {
+    Utf8String s;
+    s.bytes_ = std::move(utf8);
+    return s;
+  }
+  // size must not be 0 so the string isn't taken for a null one.
+  static Utf8String fromInput(InputMapping* source, const char* data, qsizetype size)
+  {
+    Utf8String s;
+    s.bytes_ = QByteArray::fromRawData(data, size);
+    s.source_ = source;
+    return s;
+  }
+
+  operator QString() const
+  {
+    return toString();
+  }
+  [[nodiscard]] QString toString() const
+  {
+    return bytes_.isNull()? QString() : QString::fromUtf8(bytes_);
+  }
+  // Only valid as long as the string, for it may refer to an input.
+  [[nodiscard]] const QByteArray& utf8() const
+  {
+    return bytes_;
+  }
+  [[nodiscard]] QByteArray toUtf8() const
+  {
+    return source_? QByteArray(bytes_.constData(), bytes_.size()) : bytes_;
+  }
+
+  [[nodiscard]] bool isEmpty() const
+  {
+    return bytes_.isEmpty();
+  }
+  [[nodiscard]] bool isNull() const
+  {
+    return bytes_.isNull();
+  }
+  /* The size in bytes, not in characters. */
+  [[nodiscard]] qsizetype byteSize() const
+  {
+    return bytes_.size();
+  }
+  void clear()
+  {
+    bytes_.clear();
+    source_.reset();
+  }
+
+  Utf8String& operator+=(const QString& s)
+  {
+    // Appending to bytes that refer to the input copies them.
+    bytes_ += s.toUtf8();
+    source_.reset();
+    return *this;
+  }
+
+  friend bool operator==(const Utf8String& lhs, const Utf8String& rhs)
+  {
+    return lhs.bytes_ == rhs.bytes_;
+  }
+  friend bool operator!=(const Utf8String& lhs, const Utf8String& rhs)
+  {
+    return lhs.bytes_ != rhs.bytes_;
+  }
+  friend bool operator==(const Utf8String& lhs, const QString& rhs)
+  {
+    return lhs.toString() == rhs;
+  }
+  friend bool operator!=(const Utf8String& lhs, const QString& rhs)
+  {
+    return lhs.toString() != rhs;
+  }
+  friend bool operator==(const QString& lhs, const Utf8String& rhs)
+  {
+    return lhs == rhs.toString();
+  }
+  friend bool operator!=(const QString& lhs, const Utf8String& rhs)
+  {
+    return lhs != rhs.toString();
+  }
+
+private:
+  static QByteArray from_qstring(const QString& s)
+  {
+    if (s.isNull()) {
+      return {};
+    }
+    QByteArray utf8 = s.toUtf8();
+    if (utf8.isNull()) {
+      // An empty QString isn't null, so neither is its UTF-8.
+      utf8 = QByteArray("");
+    }
+    return utf8;
+  }
+
+  QByteArray bytes_;
+  QExplicitlySharedDataPointer<InputMapping> source_;  // what bytes_ refers to
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_UTF8STRING_H_
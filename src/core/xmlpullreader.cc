@@ -0,0 +1,1013 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <algorithm>                  // for count, find_if_not, min
+#include <cstddef>                    // for ptrdiff_t, size_t
+#include <cstring>                    // for memchr
+#include <string_view>                // for string_view
+#include <unordered_map>              // for unordered_map
+#include <utility>                    // for move
+#include <vector>                     // for vector
+
+#include <QChar>                      // for QChar
+#include <QFile>                      // for QFile
+#include <QLatin1Char>                // for QLatin1Char
+#include <QLatin1String>              // for QLatin1String
+#include <QTextCodec>                 // for QTextCodec
+#include <QXmlStreamReader>           // for QXmlStreamReader, QXmlStreamNamespaceDeclaration, QXmlStreamReader::Characters, QXmlStreamReader::EndDocument, QXmlStreamReader::EndElement, QXmlStreamReader::IncludeChildElements, QXmlStreamReader::Invalid, QXmlStreamReader::NoToken, QXmlStreamReader::StartDocument, QXmlStreamReader::StartElement
+
+#include "src/core/inputmapping.h"    // for InputMapping
+#include "src/core/utf8string.h"      // for Utf8String
+#include "src/core/xmlpullreader.h"
+
+namespace gpsbabel
+{
+
+namespace
+{
+
+class QtXmlPullReader : public XmlPullReader
+{
+public:
+  explicit QtXmlPullReader(QIODevice* device) : reader_(device) {}
+  explicit QtXmlPullReader(const QByteArray& data) : reader_(data) {}
+  explicit QtXmlPullReader(const QString& text) : reader_(text) {}
+
+  TokenType readNext() override
+  {
+    return reader_.readNext();
+  }
+  TokenType tokenType() const override
+  {
+    return reader_.tokenType();
+  }
+  bool atEnd() const override
+  {
+    return reader_.atEnd();
+  }
+
+  QStringView name() const override
+  {
+    return reader_.name();
+  }
+  QStringView qualifiedName() const override
+  {
+    return reader_.qualifiedName();
+  }
+  QStringView namespaceUri() const override
+  {
+    return reader_.namespaceUri();
+  }
+  QStringView text() const override
+  {
+    return reader_.text();
+  }
+  QStringView documentEncoding() const override
+  {
+    return reader_.documentEncoding();
+  }
+  QXmlStreamAttributes attributes() const override
+  {
+    return reader_.attributes();
+  }
+  QXmlStreamNamespaceDeclarations namespaceDeclarations() const override
+  {
+    return reader_.namespaceDeclarations();
+  }
+
+  bool hasError() const override
+  {
+    return reader_.hasError();
+  }
+  QString errorString() const override
+  {
+    return reader_.errorString();
+  }
+  qint64 lineNumber() const override
+  {
+    return reader_.lineNumber();
+  }
+  qint64 columnNumber() const override
+  {
+    return reader_.columnNumber();
+  }
+
+  QString readElementText() override
+  {
+    return reader_.readElementText(QXmlStreamReader::IncludeChildElements);
+  }
+  void skipCurrentElement() override
+  {
+    reader_.skipCurrentElement();
+  }
+
+private:
+  QXmlStreamReader reader_;
+};
+
+/*
+ * Everything the tokens refer to stays in data_, which is never changed
+ * once parsing has begun, so names, attribute values and text are kept
+ * as views of it until they are needed as UTF-16.
+ */
+class FastXmlPullReader : public XmlPullReader
+{
+public:
+  explicit FastXmlPullReader(QIODevice* device) : device_(device) {}
+  explicit FastXmlPullReader(QByteArray data) : data_(std::move(data)) {}
+  FastXmlPullReader(const FastXmlPullReader&) = delete;
+  FastXmlPullReader& operator=(const FastXmlPullReader&) = delete;
+  ~FastXmlPullReader() override
+  {
+    // Text read by reference outlives the reader, but must not change
+    // with the file after it.
+    if (input_ && (input_->ref.loadRelaxed() > 1)) {
+      input_->detach();
+    }
+  }
+
+  TokenType readNext() override;
+  TokenType tokenType() const override
+  {
+    return token_;
+  }
+  bool atEnd() const override
+  {
+    return (token_ == QXmlStreamReader::EndDocument) || (token_ == QXmlStreamReader::Invalid);
+  }
+
+  QStringView name() const override;
+  QStringView qualifiedName() const override;
+  QStringView namespaceUri() const override
+  {
+    return uri_;
+  }
+  QStringView text() const override;
+  Utf8String textReference() const override;
+  QStringView documentEncoding() const override
+  {
+    return encoding_;
+  }
+  QXmlStreamAttributes attributes() const override;
+  QXmlStreamNamespaceDeclarations namespaceDeclarations() const override;
+
+  bool hasError() const override
+  {
+    return token_ == QXmlStreamReader::Invalid;
+  }
+  QString errorString() const override
+  {
+    return error_;
+  }
+  qint64 lineNumber() const override;
+  qint64 columnNumber() const override;
+
+private:
+  /* Types */
+
+  enum class Content {
+    text,
+    attribute,
+    cdata
+  };
+
+  struct Name {
+    std::string_view key;
+    std::string_view prefix;
+    QString qualified;
+    qsizetype local{0};  // where the name without its prefix begins
+  };
+
+  struct Element {
+    int name;
+    int namespaces;  // the declarations in scope without its own
+    QStringView uri;
+  };
+
+  struct Namespace {
+    std::string_view prefix;
+    QString uri;
+  };
+
+  struct Attribute {
+    int name;
+    std::string_view value;
+  };
+
+  /* Member Functions */
+
+  bool start();
+  TokenType fail(const char* at, const QString& message);
+  TokenType start_tag();
+  TokenType end_tag();
+  bool skip_declaration();
+  const char* find(std::string_view what) const;
+  std::string_view scan_name();
+  void skip_space();
+  int intern(std::string_view key);
+  const QString* resolve(std::string_view prefix) const;
+  const char* where() const;
+  static void decode(std::string_view in, QString& out, Content content);
+  static bool is_plain(std::string_view in, Content content);
+  static QChar* decode_reference(const unsigned char*& p, const unsigned char* end, QChar* out);
+
+  /* Data Members */
+
+  QIODevice* device_{nullptr};  // read at the first token
+  QExplicitlySharedDataPointer<InputMapping> input_;  // what data_ refers to, if mapped
+  QByteArray data_;
+  const char* pos_{nullptr};
+  const char* end_{nullptr};
+  TokenType token_{QXmlStreamReader::NoToken};
+  bool pending_end_{false};   // the start tag ended with />
+  bool pending_pop_{false};   // the element ended with the last token
+  bool root_closed_{false};
+  int current_{-1};
+  int current_namespaces_{0};
+  QStringView uri_;
+  std::string_view text_span_;
+  Content text_content_{Content::text};
+  mutable QString text_;
+  mutable bool text_decoded_{false};
+  QString encoding_;
+  QString error_;
+  const char* error_at_{nullptr};
+
+  std::vector<Name> names_;
+  std::unordered_map<std::string_view, int> name_index_;
+  std::vector<Element> open_;
+  std::vector<Namespace> namespaces_;
+  std::vector<Attribute> attributes_;
+};
+
+constexpr bool is_space(char c)
+{
+  return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+}
+
+XmlPullReader::TokenType FastXmlPullReader::readNext()
+{
+  if (atEnd()) {
+    return token_;
+  }
+  if (pending_pop_) {
+    pending_pop_ = false;
+    namespaces_.resize(open_.back().namespaces);
+    open_.pop_back();
+    root_closed_ = open_.empty();
+  }
+  current_ = -1;
+  uri_ = QStringView();
+  text_span_ = std::string_view();
+  text_decoded_ = false;
+
+  if (token_ == QXmlStreamReader::NoToken) {
+    if (!start()) {
+      return token_;
+    }
+    return token_ = QXmlStreamReader::StartDocument;
+  }
+
+  if (pending_end_) {
+    pending_end_ = false;
+    pending_pop_ = true;
+    current_ = open_.back().name;
+    uri_ = open_.back().uri;
+    return token_ = QXmlStreamReader::EndElement;
+  }
+
+  for (;;) {
+    if (pos_ == end_) {
+      if (!open_.empty() || !root_closed_) {
+        return fail(pos_, QStringLiteral("Premature end of document."));
+      }
+      return token_ = QXmlStreamReader::EndDocument;
+    }
+
+    if (*pos_ != '<') {
+      const auto* lt = static_cast<const char*>(memchr(pos_, '<', end_ - pos_));
+      if (lt == nullptr) {
+        lt = end_;
+      }
+      const std::string_view run(pos_, lt - pos_);
+      if (open_.empty()) {
+        // Only white space may surround the root element.
+        if (std::find_if_not(run.cbegin(), run.cend(), is_space) != run.cend()) {
+          return fail(pos_, root_closed_ ? QStringLiteral("Extra content at end of document.") :
+                      QStringLiteral("Start tag expected."));
+        }
+        pos_ = lt;
+        continue;
+      }
+      pos_ = lt;
+      text_span_ = run;
+      text_content_ = Content::text;
+      return token_ = QXmlStreamReader::Characters;
+    }
+
+    const std::string_view markup(pos_, end_ - pos_);
+    if (markup.starts_with("</")) {
+      return end_tag();
+    }
+    if (markup.starts_with("<!--")) {
+      const char* close = find("-->");
+      if (close == nullptr) {
+        return fail(end_, QStringLiteral("Premature end of document."));
+      }
+      pos_ = close + 3;
+      continue;
+    }
+    if (markup.starts_with("<![CDATA[")) {
+      if (open_.empty()) {
+        return fail(pos_, QStringLiteral("Start tag expected."));
+      }
+      const char* close = find("]]>");
+      if (close == nullptr) {
+        return fail(end_, QStringLiteral("Premature end of document."));
+      }
+      text_span_ = std::string_view(pos_ + 9, close - (pos_ + 9));
+      text_content_ = Content::cdata;
+      pos_ = close + 3;
+      return token_ = QXmlStreamReader::Characters;
+    }
+    if (markup.starts_with("<?")) {
+      const char* close = find("?>");
+      if (close == nullptr) {
+        return fail(end_, QStringLiteral("Premature end of document."));
+      }
+      pos_ = close + 2;
+      continue;
+    }
+    if (markup.starts_with("<!")) {
+      if (!skip_declaration()) {
+        return fail(end_, QStringLiteral("Premature end of document."));
+      }
+      continue;
+    }
+    return start_tag();
+  }
+}
+
+/*
+ * Converts anything but UTF-8 to it, as told by a byte order mark or the
+ * XML declaration, and skips the byte order mark.
+ */
+bool FastXmlPullReader::start()
+{
+  if (device_ != nullptr) {
+    if (const auto* file = qobject_cast<const QFile*>(device_); file != nullptr) {
+      input_ = InputMapping::map(file);
+    }
+    data_ = input_ ? input_->bytes() : device_->readAll();
+  }
+  bool converted = false;
+  QTextCodec* codec = QTextCodec::codecForUtfText(data_, nullptr);
+  if ((codec != nullptr) && (codec->mibEnum() != 106)) {
+    data_ = codec->toUnicode(data_).toUtf8();
+    input_.reset();
+    converted = true;
+  }
+  std::string_view doc(data_.constData(), data_.size());
+  if (doc.starts_with("\xef\xbb\xbf")) {
+    doc.remove_prefix(3);
+  }
+
+  if (doc.starts_with("<?xml") && (doc.size() > 5) && is_space(doc[5])) {
+    const std::string_view decl = doc.substr(0, doc.find("?>"));
+    auto pos = decl.find("encoding");
+    if (pos != std::string_view::npos) {
+      pos = decl.find_first_of("\"'", pos);
+      if (pos != std::string_view::npos) {
+        const auto close = decl.find(decl[pos], pos + 1);
+        if (close != std::string_view::npos) {
+          const std::string_view encoding = decl.substr(pos + 1, close - pos - 1);
+          encoding_ = QString::fromLatin1(encoding.data(), encoding.size());
+        }
+      }
+    }
+  }
+
+  if (!converted && !encoding_.isEmpty() &&
+      (encoding_.compare(QLatin1String("UTF-8"), Qt::CaseInsensitive) != 0) &&
+      (encoding_.compare(QLatin1String("US-ASCII"), Qt::CaseInsensitive) != 0) &&
+      (encoding_.compare(QLatin1String("ASCII"), Qt::CaseInsensitive) != 0)) {
+    codec = QTextCodec::codecForName(encoding_.toLatin1());
+    if (codec == nullptr) {
+      fail(data_.constData(), QStringLiteral("Encoding %1 is unsupported").arg(encoding_));
+      return false;
+    }
+    if (codec->mibEnum() != 106) {
+      data_ = codec->toUnicode(data_).toUtf8();
+      input_.reset();
+      doc = std::string_view(data_.constData(), data_.size());
+      if (doc.starts_with("\xef\xbb\xbf")) {
+        doc.remove_prefix(3);
+      }
+    }
+  }
+
+  pos_ = doc.data();
+  end_ = doc.data() + doc.size();
+  return true;
+}
+
+XmlPullReader::TokenType FastXmlPullReader::fail(const char* at, const QString& message)
+{
+  error_ = message;
+  error_at_ = at;
+  return token_ = QXmlStreamReader::Invalid;
+}
+
+XmlPullReader::TokenType FastXmlPullReader::start_tag()
+{
+  const char* const at = pos_;
+  ++pos_;
+  const std::string_view key = scan_name();
+  if (key.empty()) {
+    return fail(at, QStringLiteral("Invalid XML name."));
+  }
+  if (root_closed_) {
+    return fail(at, QStringLiteral("Extra content at end of document."));
+  }
+
+  const int namespaces = static_cast<int>(namespaces_.size());
+  attributes_.clear();
+  for (;;) {
+    skip_space();
+    if (pos_ == end_) {
+      return fail(pos_, QStringLiteral("Premature end of document."));
+    }
+    if (*pos_ == '>') {
+      ++pos_;
+      break;
+    }
+    if (*pos_ == '/') {
+      if ((end_ - pos_ < 2) || (pos_[1] != '>')) {
+        return fail(pos_, QStringLiteral("Expected '>', but got '%1'.").arg(QChar::fromLatin1(*pos_)));
+      }
+      pos_ += 2;
+      pending_end_ = true;
+      break;
+    }
+
+    const std::string_view attribute = scan_name();
+    skip_space();
+    if (attribute.empty() || (pos_ == end_) || (*pos_ != '=')) {
+      return fail(pos_, QStringLiteral("Invalid attribute in start tag."));
+    }
+    ++pos_;
+    skip_space();
+    if ((pos_ == end_) || ((*pos_ != '"') && (*pos_ != '\''))) {
+      return fail(pos_, QStringLiteral("Invalid attribute in start tag."));
+    }
+    const auto* close = static_cast<const char*>(memchr(pos_ + 1, *pos_, end_ - pos_ - 1));
+    if (close == nullptr) {
+      return fail(end_, QStringLiteral("Premature end of document."));
+    }
+    const std::string_view value(pos_ + 1, close - pos_ - 1);
+    pos_ = close + 1;
+
+    if (attribute == "xmlns") {
+      namespaces_.push_back({std::string_view(), QString()});
+    } else if (attribute.starts_with("xmlns:")) {
+      namespaces_.push_back({attribute.substr(6), QString()});
+    } else {
+      attributes_.push_back({intern(attribute), value});
+      continue;
+    }
+    decode(value, namespaces_.back().uri, Content::attribute);
+  }
+
+  const int name = intern(key);
+  const QString* uri = resolve(names_.at(name).prefix);
+  if (uri == nullptr) {
+    const std::string_view prefix = names_.at(name).prefix;
+    return fail(at, QStringLiteral("Namespace prefix %1 not declared")
+                .arg(QString::fromUtf8(prefix.data(), prefix.size())));
+  }
+  open_.push_back({name, namespaces, QStringView(*uri)});
+  current_ = name;
+  current_namespaces_ = namespaces;
+  uri_ = open_.back().uri;
+  return token_ = QXmlStreamReader::StartElement;
+}
+
+XmlPullReader::TokenType FastXmlPullReader::end_tag()
+{
+  const char* const at = pos_;
+  pos_ += 2;
+  const std::string_view key = scan_name();
+  skip_space();
+  if (pos_ == end_) {
+    return fail(pos_, QStringLiteral("Premature end of document."));
+  }
+  if (*pos_ != '>') {
+    return fail(pos_, QStringLiteral("Expected '>', but got '%1'.").arg(QChar::fromLatin1(*pos_)));
+  }
+  ++pos_;
+  if (open_.empty() || (names_.at(open_.back().name).key != key)) {
+    return fail(at, QStringLiteral("Opening and ending tag mismatch."));
+  }
+  pending_pop_ = true;
+  current_ = open_.back().name;
+  uri_ = open_.back().uri;
+  return token_ = QXmlStreamReader::EndElement;
+}
+
+/* Skips a <!DOCTYPE> and the like, internal subset and all. */
+bool FastXmlPullReader::skip_declaration()
+{
+  int depth = 0;
+  char quote = '\0';
+  for (const char* p = pos_ + 2; p < end_; ++p) {
+    if (quote != '\0') {
+      if (*p == quote) {
+        quote = '\0';
+      }
+      continue;
+    }
+    switch (*p) {
+    case '"':
+    case '\'':
+      quote = *p;
+      break;
+    case '[':
+      ++depth;
+      break;
+    case ']':
+      --depth;
+      break;
+    case '>':
+      if (depth <= 0) {
+        pos_ = p + 1;
+        return true;
+      }
+      break;
+    default:
+      break;
+    }
+  }
+  return false;
+}
+
+const char* FastXmlPullReader::find(std::string_view what) const
+{
+  const std::string_view rest(pos_, end_ - pos_);
+  const auto pos = rest.find(what);
+  return (pos == std::string_view::npos) ? nullptr : pos_ + pos;
+}
+
+std::string_view FastXmlPullReader::scan_name()
+{
+  const char* const begin = pos_;
+  while ((pos_ != end_) && !is_space(*pos_) && (*pos_ != '>') && (*pos_ != '/') &&
+         (*pos_ != '=') && (*pos_ != '<')) {
+    ++pos_;
+  }
+  return std::string_view(begin, pos_ - begin);
+}
+
+void FastXmlPullReader::skip_space()
+{
+  while ((pos_ != end_) && is_space(*pos_)) {
+    ++pos_;
+  }
+}
+
+/* The index of a name in names_, decoding it the first time it is seen. */
+int FastXmlPullReader::intern(std::string_view key)
+{
+  const auto found = name_index_.find(key);
+  if (found != name_index_.end()) {
+    return found->second;
+  }
+
+  Name name;
+  name.key = key;
+  name.qualified = QString::fromUtf8(key.data(), key.size());
+  const auto colon = key.find(':');
+  if (colon != std::string_view::npos) {
+    name.prefix = key.substr(0, colon);
+    name.local = name.qualified.indexOf(QLatin1Char(':')) + 1;
+  }
+  const int index = static_cast<int>(names_.size());
+  names_.push_back(std::move(name));
+  name_index_.emplace(key, index);
+  return index;
+}
+
+/* The namespace of a prefix, the default namespace for none. */
+const QString* FastXmlPullReader::resolve(std::string_view prefix) const
+{
+  static const QString kNoNamespace;
+  static const QString kXmlNamespace = QStringLiteral("http://www.w3.org/XML/1998/namespace");
+
+  for (auto it = namespaces_.crbegin(); it != namespaces_.crend(); ++it) {
+    if (it->prefix == prefix) {
+      return &it->uri;
+    }
+  }
+  if (prefix.empty()) {
+    return &kNoNamespace;
+  }
+  if (prefix == "xml") {
+    return &kXmlNamespace;
+  }
+  return nullptr;
+}
+
+QStringView FastXmlPullReader::name() const
+{
+  if (current_ < 0) {
+    return QStringView();
+  }
+  const Name& name = names_.at(current_);
+  return QStringView(name.qualified).mid(name.local);
+}
+
+QStringView FastXmlPullReader::qualifiedName() const
+{
+  if (current_ < 0) {
+    return QStringView();
+  }
+  return names_.at(current_).qualified;
+}
+
+QStringView FastXmlPullReader::text() const
+{
+  if (token_ != QXmlStreamReader::Characters) {
+    return QStringView();
+  }
+  if (!text_decoded_) {
+    // Keeps the capacity of text_ from one token to the next.
+    text_.resize(0);
+    decode(text_span_, text_, text_content_);
+    text_decoded_ = true;
+  }
+  return text_;
+}
+
+Utf8String FastXmlPullReader::textReference() const
+{
+  if ((token_ != QXmlStreamReader::Characters) || !input_) {
+    return {};
+  }
+  constexpr auto is_ascii_space = [](char c) {
+    return (c == ' ') || ((c >= '\t') && (c <= '\r'));
+  };
+  std::string_view text = text_span_;
+  while (!text.empty() && is_ascii_space(text.front())) {
+    text.remove_prefix(1);
+  }
+  while (!text.empty() && is_ascii_space(text.back())) {
+    text.remove_suffix(1);
+  }
+  // Other white space than ASCII's would have been trimmed as well.
+  if (text.empty() || (static_cast<unsigned char>(text.front()) >= 0x80) ||
+      (static_cast<unsigned char>(text.back()) >= 0x80) || !is_plain(text, text_content_)) {
+    return {};
+  }
+  return Utf8String::fromInput(input_.data(), text.data(), static_cast<qsizetype>(text.size()));
+}
+
+QXmlStreamAttributes FastXmlPullReader::attributes() const
+{
+  QXmlStreamAttributes attrs;
+  if (token_ != QXmlStreamReader::StartElement) {
+    return attrs;
+  }
+  attrs.reserve(attributes_.size());
+  for (const auto& attribute : attributes_) {
+    QString value;
+    decode(attribute.value, value, Content::attribute);
+    attrs.append(names_.at(attribute.name).qualified, value);
+  }
+  return attrs;
+}
+
+QXmlStreamNamespaceDeclarations FastXmlPullReader::namespaceDeclarations() const
+{
+  QXmlStreamNamespaceDeclarations declarations;
+  if (token_ != QXmlStreamReader::StartElement) {
+    return declarations;
+  }
+  for (auto i = static_cast<std::size_t>(current_namespaces_); i < namespaces_.size(); ++i) {
+    const Namespace& ns = namespaces_.at(i);
+    declarations.append(QXmlStreamNamespaceDeclaration(
+                          QString::fromUtf8(ns.prefix.data(), ns.prefix.size()), ns.uri));
+  }
+  return declarations;
+}
+
+const char* FastXmlPullReader::where() const
+{
+  return (token_ == QXmlStreamReader::Invalid) ? error_at_ : pos_;
+}
+
+qint64 FastXmlPullReader::lineNumber() const
+{
+  if (where() == nullptr) {
+    return 0;
+  }
+  return std::count(data_.constData(), where(), '\n') + 1;
+}
+
+qint64 FastXmlPullReader::columnNumber() const
+{
+  const char* const at = where();
+  if (at == nullptr) {
+    return 0;
+  }
+  const char* line = at;
+  while ((line != data_.constData()) && (line[-1] != '\n')) {
+    --line;
+  }
+  return at - line;
+}
+
+/*
+ * Appends the UTF-16 of in to out, with references replaced in text and
+ * attribute values and the line ends and, in attribute values, the white
+ * space changed as XML would.  There is never more UTF-16 than UTF-8, so
+ * out grows just once.
+ */
+void FastXmlPullReader::decode(std::string_view in, QString& out, Content content)
+{
+  const qsizetype size = out.size();
+  out.resize(size + static_cast<qsizetype>(in.size()));
+  QChar* const begin = out.data();
+  QChar* d = begin + size;
+
+  const auto* p = reinterpret_cast<const unsigned char*>(in.data());
+  const auto* const end = p + in.size();
+  while (p < end) {
+    char32_t c = *p++;
+    if (c < 0x80) {
+      if ((c == '&') && (content != Content::cdata)) {
+        d = decode_reference(p, end, d);
+        continue;
+      }
+      if (c == '\r') {
+        if ((p < end) && (*p == '\n')) {
+          ++p;
+        }
+        c = '\n';
+      }
+      if ((content == Content::attribute) && ((c == '\n') || (c == '\t'))) {
+        c = ' ';
+      }
+      *d++ = QChar(static_cast<char16_t>(c));
+      continue;
+    }
+
+    // The lead byte tells the length, and the second byte's range rules
+    // out overlong forms, surrogates and anything past U+10FFFF.
+    int more = 0;
+    unsigned char low = 0x80;
+    unsigned char high = 0xbf;
+    if ((c >= 0xc2) && (c <= 0xdf)) {
+      more = 1;
+      c &= 0x1f;
+    } else if ((c >= 0xe0) && (c <= 0xef)) {
+      more = 2;
+      low = (c == 0xe0) ? 0xa0 : 0x80;
+      high = (c == 0xed) ? 0x9f : 0xbf;
+      c &= 0x0f;
+    } else if ((c >= 0xf0) && (c <= 0xf4)) {
+      more = 3;
+      low = (c == 0xf0) ? 0x90 : 0x80;
+      high = (c == 0xf4) ? 0x8f : 0xbf;
+      c &= 0x07;
+    }
+    if ((more == 0) || (end - p < more) || (*p < low) || (*p > high)) {
+      *d++ = QChar::ReplacementCharacter;
+      continue;
+    }
+    const unsigned char* q = p;
+    for (int i = 0; i < more; ++i, ++q) {
+      if ((i > 0) && ((*q & 0xc0) != 0x80)) {
+        break;
+      }
+      c = (c << 6) | (*q & 0x3f);
+    }
+    if (q != p + more) {
+      *d++ = QChar::ReplacementCharacter;
+      continue;
+    }
+    p = q;
+    if (c > 0xffff) {
+      *d++ = QChar(QChar::highSurrogate(c));
+      *d++ = QChar(QChar::lowSurrogate(c));
+    } else {
+      *d++ = QChar(static_cast<char16_t>(c));
+    }
+  }
+  out.resize(d - begin);
+}
+
+/*
+ * Whether decode() would give just the UTF-16 of in: it has no
+ * references or carriage returns and is well formed UTF-8.
+ */
+bool FastXmlPullReader::is_plain(std::string_view in, Content content)
+{
+  const auto* p = reinterpret_cast<const unsigned char*>(in.data());
+  const auto* const end = p + in.size();
+  while (p < end) {
+    const unsigned char c = *p++;
+    if (c < 0x80) {
+      if ((c == '\r') || ((c == '&') && (content != Content::cdata)) ||
+          ((content == Content::attribute) && ((c == '\n') || (c == '\t')))) {
+        return false;
+      }
+      continue;
+    }
+
+    int more = 0;
+    unsigned char low = 0x80;
+    unsigned char high = 0xbf;
+    if ((c >= 0xc2) && (c <= 0xdf)) {
+      more = 1;
+    } else if ((c >= 0xe0) && (c <= 0xef)) {
+      more = 2;
+      low = (c == 0xe0) ? 0xa0 : 0x80;
+      high = (c == 0xed) ? 0x9f : 0xbf;
+    } else if ((c >= 0xf0) && (c <= 0xf4)) {
+      more = 3;
+      low = (c == 0xf0) ? 0x90 : 0x80;
+      high = (c == 0xf4) ? 0x8f : 0xbf;
+    }
+    if ((more == 0) || (end - p < more) || (*p < low) || (*p > high)) {
+      return false;
+    }
+    for (int i = 1; i < more; ++i) {
+      if ((p[i] & 0xc0) != 0x80) {
+        return false;
+      }
+    }
+    p += more;
+  }
+  return true;
+}
+
+/*
+ * Writes the character of the reference that p, just past its '&',
+ * begins, and moves p past its ';'.  Anything but a predefined entity or
+ * a character reference is left as it is.
+ */
+QChar* FastXmlPullReader::decode_reference(const unsigned char*& p, const unsigned char* end, QChar* out)
+{
+  const auto* semicolon = static_cast<const unsigned char*>(memchr(p, ';', std::min<std::ptrdiff_t>(end - p, 12)));
+  if (semicolon != nullptr) {
+    const std::string_view ref(reinterpret_cast<const char*>(p), semicolon - p);
+    char16_t entity = 0;
+    if (ref == "lt") {
+      entity = '<';
+    } else if (ref == "gt") {
+      entity = '>';
+    } else if (ref == "amp") {
+      entity = '&';
+    } else if (ref == "quot") {
+      entity = '"';
+    } else if (ref == "apos") {
+      entity = '\'';
+    }
+    if (entity != 0) {
+      p = semicolon + 1;
+      *out++ = QChar(entity);
+      return out;
+    }
+
+    if (ref.starts_with('#') && (ref.size() > 1)) {
+      const bool hex = (ref[1] == 'x');
+      const std::string_view digits = ref.substr(hex ? 2 : 1);
+      char32_t c = 0;
+      bool ok = !digits.empty();
+      for (char digit : digits) {
+        int value = -1;
+        if ((digit >= '0') && (digit <= '9')) {
+          value = digit - '0';
+        } else if (hex && (digit >= 'a') && (digit <= 'f')) {
+          value = digit - 'a' + 10;
+        } else if (hex && (digit >= 'A') && (digit <= 'F')) {
+          value = digit - 'A' + 10;
+        }
+        if ((value < 0) || (c > 0x10ffff)) {
+          ok = false;
+          break;
+        }
+        c = c * (hex ? 16 : 10) + value;
+      }
+      ok = ok && (c != 0) && (c <= 0x10ffff) && !QChar::isSurrogate(c);
+      if (ok) {
+        p = semicolon + 1;
+        if (c > 0xffff) {
+          *out++ = QChar(QChar::highSurrogate(c));
+          *out++ = QChar(QChar::lowSurrogate(c));
+        } else {
+          *out++ = QChar(static_cast<char16_t>(c));
+        }
+        return out;
+      }
+    }
+  }
+  *out++ = QChar(u'&');
+  return out;
+}
+
+} // namespace
+
+bool XmlPullReader::parse_backend(const QString& name, Backend* backend)
+{
+  if (name == QLatin1String("qt")) {
+    *backend = Backend::qt;
+  } else if (name == QLatin1String("fast")) {
+    *backend = Backend::fast;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+std::unique_ptr<XmlPullReader> XmlPullReader::create(QIODevice* device, Backend backend)
+{
+  if (backend == Backend::fast) {
+    return std::make_unique<FastXmlPullReader>(device);
+  }
+  return std::make_unique<QtXmlPullReader>(device);
+}
+
+std::unique_ptr<XmlPullReader> XmlPullReader::create(const QByteArray& data, Backend backend)
+{
+  if (backend == Backend::fast) {
+    return std::make_unique<FastXmlPullReader>(data);
+  }
+  return std::make_unique<QtXmlPullReader>(data);
+}
+
+std::unique_ptr<XmlPullReader> XmlPullReader::create(const QString& text)
+{
+  return std::make_unique<QtXmlPullReader>(text);
+}
+
+QString XmlPullReader::readElementText()
+{
+  QString result;
+  for (int depth = 1; depth > 0;) {
+    switch (readNext()) {
+    case QXmlStreamReader::Characters:
+    case QXmlStreamReader::EntityReference:
+      result += text();
+      break;
+    case QXmlStreamReader::StartElement:
+      ++depth;
+      break;
+    case QXmlStreamReader::EndElement:
+      --depth;
+      break;
+    case QXmlStreamReader::EndDocument:
+    case QXmlStreamReader::Invalid:
+      return result;
+    default:
+      break;
+    }
+  }
+  return result;
+}
+
+void XmlPullReader::skipCurrentElement()
+{
+  for (int depth = 1; depth > 0;) {
+    switch (readNext()) {
+    case QXmlStreamReader::StartElement:
+      ++depth;
+      break;
+    case QXmlStreamReader::EndElement:
+      --depth;
+      break;
+    case QXmlStreamReader::EndDocument:
+    case QXmlStreamReader::Invalid:
+      return;
+    default:
+      break;
+    }
+  }
+}
+
+} // namespace gpsbabel
@@ -0,0 +1,134 @@
+/*
+    Copyright (C) 2026 Robert Lipe, gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_XMLPULLREADER_H_
+#define SRC_CORE_XMLPULLREADER_H_
+
+#include <memory>                // for unique_ptr
+
+#include <QByteArray>            // for QByteArray
+#include <QIODevice>             // for QIODevice
+#include <QString>               // for QString
+#include <QStringView>           // for QStringView
+#include <QXmlStreamAttributes>  // for QXmlStreamAttributes
+#include <QXmlStreamReader>      // for QXmlStreamReader, QXmlStreamNamespaceDeclarations
+#include <QtGlobal>              // for qint64
+
+#include "src/core/utf8string.h" // for Utf8String
+
+namespace gpsbabel
+{
+
+/*
+ * The tokens of an XML document one at a time, as QXmlStreamReader
+ * reports them with namespace processing, for the readers of GPX and of
+ * the formats built on XmlGenericReader.
+ *
+ * The qt backend is a QXmlStreamReader.  The fast backend parses the
+ * UTF-8 of the whole document in place: names are decoded once per
+ * distinct name, text and attributes only when asked for, and beyond
+ * the nesting of elements and the namespace prefixes nothing is checked.
+ * Unknown entities are kept as they are written, malformed UTF-8 becomes
+ * U+FFFD, and comments, processing instructions and the DTD are skipped.
+ * It is meant for trusted, machine written files.  Other encodings are
+ * converted to UTF-8 first.  The namespace prefix of an attribute is
+ * kept in its qualified name but not resolved.
+ *
+ * The backend is chosen with --xml-parser.  Names, text and namespace
+ * URIs are valid until the next token is read.  The fast backend maps a
+ * file it reads from, if it can, and textReference() gives text that
+ * needs no decoding as a Utf8String referring to the mapping.
+ */
+class XmlPullReader
+{
+public:
+  /* Types */
+
+  enum class Backend {
+    qt,
+    fast
+  };
+
+  using TokenType = QXmlStreamReader::TokenType;
+
+  /* Special Member Functions */
+
+  XmlPullReader() = default;
+  virtual ~XmlPullReader() = default;
+  XmlPullReader(const XmlPullReader&) = delete;
+  XmlPullReader& operator=(const XmlPullReader&) = delete;
+  XmlPullReader(XmlPullReader&&) = delete;
+  XmlPullReader& operator=(XmlPullReader&&) = delete;
+
+  /* Member Functions */
+
+  static void set_default_backend(Backend backend)
+  {
+    default_backend_ = backend;
+  }
+  static Backend default_backend()
+  {
+    return default_backend_;
+  }
+  static bool parse_backend(const QString& name, Backend* backend);
+
+  // The fast backend reads all of the device with the first token.
+  static std::unique_ptr<XmlPullReader> create(QIODevice* device,
+      Backend backend = default_backend());
+  static std::unique_ptr<XmlPullReader> create(const QByteArray& data,
+      Backend backend = default_backend());
+  // Text that is already decoded always goes to QXmlStreamReader.
+  static std::unique_ptr<XmlPullReader> create(const QString& text);
+
+  virtual TokenType readNext() = 0;
+  virtual TokenType tokenType() const = 0;
+  virtual bool atEnd() const = 0;
+
+  virtual QStringView name() const = 0;
+  virtual QStringView qualifiedName() const = 0;
+  virtual QStringView namespaceUri() const = 0;
+  virtual QStringView text() const = 0;
+  // The text trimmed as QString::trimmed() would, referring to the input,
+  // or a null string if it would have to be copied.
+  virtual Utf8String textReference() const
+  {
+    return {};
+  }
+  virtual QStringView documentEncoding() const = 0;
+  virtual QXmlStreamAttributes attributes() const = 0;
+  virtual QXmlStreamNamespaceDeclarations namespaceDeclarations() const = 0;
+
+  virtual bool hasError() const = 0;
+  virtual QString errorString() const = 0;
+  virtual qint64 lineNumber() const = 0;
+  virtual qint64 columnNumber() const = 0;
+
+  // Like QXmlStreamReader's with IncludeChildElements.
+  virtual QString readElementText();
+  virtual void skipCurrentElement();
+
+private:
+  /* Data Members */
+
+  static inline Backend default_backend_ = Backend::qt;
+};
+
+} // namespace gpsbabel
+
+#endif // SRC_CORE_XMLPULLREADER_H_
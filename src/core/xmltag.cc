@@ -19,12 +19,17 @@
 
  */
 
+#include <cstddef>                      // for size_t
+
+#include <QByteArray>                   // for QByteArray
 #include <QString>                      // for QString
 #include <QStringView>                  // for QStringView
 #include <Qt>                           // for CaseInsensitive
 #include <QXmlStreamAttribute>          // for QXmlStreamAttribute
 #include <QXmlStreamAttributes>         // for QXmlStreamAttributes
+#include <QXmlStreamReader>             // for QXmlStreamReader, QXmlStreamReader::Characters, QXmlStreamReader::EndElement, QXmlStreamReader::StartElement
 
+#include "src/core/footprint.h"         // for heap_bytes
 #include "src/core/xmltag.h"
 
 
@@ -35,6 +40,7 @@
 XmlTag* XmlTag::xml_next(const XmlTag* root)
 {
   XmlTag* cur = this;
+  cur->expand();
   if (cur->child) {
     cur = cur->child;
   } else if (cur->sibling) {
@@ -105,11 +111,25 @@ copy_xml_tag(XmlTag** copy, const XmlTag* src, XmlTag* parent)
   res->cdata = (src->cdata);
   res->parentcdata = (src->parentcdata);
   res->attributes = src->attributes;
+  res->raw = src->raw;
   res->parent = parent;
   copy_xml_tag(&(res->sibling), src->sibling, parent);
   copy_xml_tag(&(res->child), src->child, res);
 }
 
+static std::size_t
+xml_tag_memory_usage(const XmlTag* tag)
+{
+  std::size_t bytes = 0;
+  for (; tag != nullptr; tag = tag->sibling) {
+    bytes += sizeof(XmlTag) + gpsbabel::heap_bytes(tag->tagname) +
+             gpsbabel::heap_bytes(tag->cdata) + gpsbabel::heap_bytes(tag->parentcdata) +
+             gpsbabel::heap_bytes(tag->attributes) + gpsbabel::heap_bytes(tag->raw) +
+             xml_tag_memory_usage(tag->child);
+  }
+  return bytes;
+}
+
 fs_xml::~fs_xml()
 {
   free_xml_tag(tag);
@@ -121,3 +141,105 @@ fs_xml* fs_xml::clone() const
   copy_xml_tag(&(copy->tag), tag, nullptr);
   return copy;
 }
+
+std::size_t fs_xml::memory_usage() const
+{
+  return sizeof(*this) + gpsbabel::heap_bytes(raw) + xml_tag_memory_usage(tag);
+}
+
+/* Stores a text run where GpxFormat::gpx_cdata would have. */
+static void
+set_xml_text(XmlTag* cur, QString& text)
+{
+  if (cur && !text.isEmpty()) {
+    if (cur->child) {
+      XmlTag* last = cur->child;
+      while (last->sibling) {
+        last = last->sibling;
+      }
+      last->parentcdata = text.trimmed();
+    } else {
+      cur->cdata = text.trimmed();
+    }
+  }
+  text.clear();
+}
+
+/*
+ * Builds the elements serialized in raw as the children of parent or,
+ * without a parent, as a chain of siblings starting at *first.
+ */
+static void
+build_xml_tags(const QByteArray& raw, XmlTag* parent, XmlTag** first)
+{
+  // The siblings need a common root to be read as a document.
+  QXmlStreamReader reader;
+  reader.setNamespaceProcessing(false);
+  reader.addData(QByteArrayLiteral("<raw>"));
+  reader.addData(raw);
+  reader.addData(QByteArrayLiteral("</raw>"));
+
+  XmlTag* cur = parent;
+  XmlTag* last_root = nullptr;
+  QString text;
+  int depth = 0;
+  while (!reader.atEnd()) {
+    switch (reader.readNext()) {
+    case QXmlStreamReader::StartElement:
+      if (depth++ > 0) {
+        set_xml_text(cur, text);
+        auto* new_tag = new XmlTag;
+        new_tag->tagname = reader.qualifiedName().toString();
+        new_tag->attributes = reader.attributes();
+        if (cur) {
+          if (cur->child) {
+            XmlTag* last = cur->child;
+            while (last->sibling) {
+              last = last->sibling;
+            }
+            last->sibling = new_tag;
+          } else {
+            cur->child = new_tag;
+          }
+          new_tag->parent = cur;
+        } else if (last_root) {
+          last_root->sibling = new_tag;
+          last_root = new_tag;
+        } else {
+          *first = new_tag;
+          last_root = new_tag;
+        }
+        cur = new_tag;
+      }
+      break;
+    case QXmlStreamReader::EndElement:
+      set_xml_text(cur, text);
+      if (--depth > 0) {
+        cur = cur->parent;
+      }
+      break;
+    case QXmlStreamReader::Characters:
+      text += reader.text();
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+void XmlTag::expand()
+{
+  if (!raw.isEmpty()) {
+    QByteArray content;
+    content.swap(raw);
+    build_xml_tags(content, this, nullptr);
+  }
+}
+
+XmlTag* fs_xml::tree() const
+{
+  if (!tag && !raw.isEmpty()) {
+    build_xml_tags(raw, nullptr, &tag);
+  }
+  return tag;
+}
@@ -19,6 +19,7 @@
 #ifndef SRC_CORE_XMLTAG_H
 #define SRC_CORE_XMLTAG_H
 
+#include <QByteArray>            // for QByteArray
 #include <QString>               // for QString
 #include <QStringView>           // for QStringView
 #include <QXmlStreamAttributes>  // for QXmlStreamAttributes
@@ -35,6 +36,7 @@ public:
   XmlTag* xml_findnext(const XmlTag* root, QStringView name);
   XmlTag* xml_findfirst(QStringView name);
   QString xml_attribute(const QString& attrname) const;
+  void expand();
 
   /* Data Members */
 
@@ -42,6 +44,10 @@ public:
   QString cdata;
   QString parentcdata;
   QXmlStreamAttributes attributes;
+  /* The content, children and text, as UTF-8 XML in the form of
+   * fs_xml::raw until expand() builds the children from it.  The reader
+   * keeps bulky subtrees like geocache logs this way. */
+  QByteArray raw;
   XmlTag* parent{nullptr};
   XmlTag* sibling{nullptr};
   XmlTag* child{nullptr};
@@ -64,7 +70,17 @@ public:
   ~fs_xml() override;
 
   fs_xml* clone() const override;
-
-  XmlTag* tag{nullptr};
+  std::size_t memory_usage() const override;
+
+  /* The elements as a tree, built from raw on first use if they were
+   * kept as text. */
+  XmlTag* tree() const;
+  bool empty() const {return (tag == nullptr) && raw.isEmpty();}
+
+  mutable XmlTag* tag{nullptr};
+  /* Sibling elements as UTF-8 XML, the way GpxFormat keeps passed
+   * through elements if asked to, each text run trimmed.  Namespace
+   * declarations are plain attributes. */
+  QByteArray raw;
 };
 #endif // SRC_CORE_XMLTAG_H
@@ -23,6 +23,7 @@
 
 #include "defs.h"
 #include "src/core/logging.h"
+#include "src/core/paralleldeflate.h"
 #ifdef HAVE_LIBMINIZIP
 #include <minizip/zip.h>
 #else
@@ -31,6 +32,7 @@
 
 #include <QFile>
 #include <QDebug>
+#include <QByteArray>
 
 ZipArchive::ZipArchive(QString filename)
 : filename_(filename), valid_(false) {
@@ -61,12 +63,16 @@ bool ZipArchive::Add(QString item_to_add) {
   }
 
   zip_fileinfo zi = {{ 0 }};
+  int threads = gpsbabel::ParallelDeflate::default_threads();
+  int level = gpsbabel::ParallelDeflate::default_level();
 
-  int err = zipOpenNewFileInZip64(zipfile_, CSTR(item_to_add), &zi,
+  // With more than one thread we compress ourselves and hand minizip
+  // the raw deflate stream.
+  int err = zipOpenNewFileInZip2(zipfile_, CSTR(item_to_add), &zi,
    NULL,0,NULL,0,NULL,
    Z_DEFLATED,
-   Z_DEFAULT_STRATEGY,
-   Z_DEFAULT_COMPRESSION);
+   level,
+   threads > 1);
   if (err) {
     Fatal() << "Error adding" << item_to_add <<  "to zip file";
   }
@@ -78,6 +84,20 @@ bool ZipArchive::Add(QString item_to_add) {
 
   // Be lazy and read the whole file back into memory (again).
   QByteArray b = src.readAll();
+  if (threads > 1) {
+    gpsbabel::ParallelDeflate deflater([this, &item_to_add](const char* data, qint64 len) {
+      if (zipWriteInFileInZip(zipfile_, data, len)) {
+        Fatal() << "Error writing" << item_to_add << "to zip";
+      }
+    }, threads, level);
+    deflater.write(b.constData(), b.size());
+    deflater.finish();
+    if (zipCloseFileInZipRaw(zipfile_, deflater.size(), deflater.crc())) {
+      Fatal() << "Error closing" << item_to_add << "to zip";
+    }
+    return false;
+  }
+
   if (zipWriteInFileInZip(zipfile_, b.constData(), b.size())) {
     Fatal() << "Error writing" << item_to_add << "to zip";
   }
@@ -95,3 +115,156 @@ bool ZipArchive::Add(QStringList items_to_add) {
   return false;
 }
 
+ZipEntryReader::ZipEntryReader(const QString& zipfile)
+{
+  unzfile_ = unzOpen64(CSTR(zipfile));
+}
+
+ZipEntryReader::~ZipEntryReader()
+{
+  ZipEntryReader::close();
+  if (unzfile_) {
+    unzClose(unzfile_);
+  }
+}
+
+QStringList ZipEntryReader::entries()
+{
+  QStringList names;
+  if (!unzfile_) {
+    return names;
+  }
+  for (int err = unzGoToFirstFile(unzfile_); err == UNZ_OK; err = unzGoToNextFile(unzfile_)) {
+    unz_file_info64 info;
+    char name[1024];
+    if (unzGetCurrentFileInfo64(unzfile_, &info, name, sizeof(name),
+                                NULL, 0, NULL, 0) == UNZ_OK) {
+      names.append(QString::fromUtf8(name));
+    }
+  }
+  return names;
+}
+
+bool ZipEntryReader::openEntry(const QString& entry)
+{
+  if (!unzfile_ || isOpen()) {
+    return false;
+  }
+  if (unzLocateFile(unzfile_, CSTR(entry), 1) != UNZ_OK) {
+    return false;
+  }
+  if (unzOpenCurrentFile(unzfile_) != UNZ_OK) {
+    return false;
+  }
+  return QIODevice::open(QIODevice::ReadOnly);
+}
+
+void ZipEntryReader::close()
+{
+  if (isOpen()) {
+    unzCloseCurrentFile(unzfile_);
+    QIODevice::close();
+  }
+}
+
+qint64 ZipEntryReader::readData(char* data, qint64 maxlen)
+{
+  // unzReadCurrentFile counts in unsigned ints.
+  unsigned int len = qMin<qint64>(maxlen, 1 << 30);
+  int result = unzReadCurrentFile(unzfile_, data, len);
+  if (result < 0) {
+    setErrorString(QStringLiteral("zip read error %1").arg(result));
+    return -1;
+  }
+  return result;
+}
+
+qint64 ZipEntryReader::writeData(const char* /* data */, qint64 /* len */)
+{
+  return -1;
+}
+
+ZipEntryWriter::ZipEntryWriter(const QString& zipfile, const QString& entry)
+: filename_(zipfile), entry_(entry)
+{
+}
+
+ZipEntryWriter::~ZipEntryWriter()
+{
+  ZipEntryWriter::close();
+}
+
+bool ZipEntryWriter::open(QIODevice::OpenMode mode)
+{
+  if (isOpen() || !(mode & QIODevice::WriteOnly) || (mode & QIODevice::ReadOnly)) {
+    return false;
+  }
+  zipfile_ = zipOpen64(CSTR(filename_), APPEND_STATUS_CREATE);
+  if (!zipfile_) {
+    return false;
+  }
+
+  zip_fileinfo zi = {{ 0 }};
+  int threads = gpsbabel::ParallelDeflate::default_threads();
+  int level = gpsbabel::ParallelDeflate::default_level();
+  if (zipOpenNewFileInZip2(zipfile_, CSTR(entry_), &zi,
+                           NULL, 0, NULL, 0, NULL,
+                           Z_DEFLATED, level, threads > 1)) {
+    zipClose(zipfile_, NULL);
+    zipfile_ = nullptr;
+    return false;
+  }
+  if (threads > 1) {
+    deflater_ = new gpsbabel::ParallelDeflate([this](const char* data, qint64 len) {
+      if (zipWriteInFileInZip(zipfile_, data, len)) {
+        Fatal() << "Error writing" << entry_ << "to" << filename_;
+      }
+    }, threads, level);
+  }
+  return QIODevice::open(mode);
+}
+
+void ZipEntryWriter::close()
+{
+  if (!isOpen()) {
+    return;
+  }
+  QIODevice::close();
+
+  int err;
+  if (deflater_) {
+    deflater_->finish();
+    err = zipCloseFileInZipRaw(zipfile_, deflater_->size(), deflater_->crc());
+    delete deflater_;
+    deflater_ = nullptr;
+  } else {
+    err = zipCloseFileInZip(zipfile_);
+  }
+  if (err || zipClose(zipfile_, NULL)) {
+    Fatal() << "Error closing" << filename_;
+  }
+  zipfile_ = nullptr;
+}
+
+qint64 ZipEntryWriter::readData(char* /* data */, qint64 /* maxlen */)
+{
+  return -1;
+}
+
+qint64 ZipEntryWriter::writeData(const char* data, qint64 len)
+{
+  if (deflater_) {
+    deflater_->write(data, len);
+    return len;
+  }
+  // zipWriteInFileInZip counts in unsigned ints.
+  for (qint64 done = 0; done < len;) {
+    unsigned int n = qMin<qint64>(len - done, 1 << 30);
+    if (zipWriteInFileInZip(zipfile_, data + done, n)) {
+      setErrorString(QStringLiteral("Error writing %1 to %2").arg(entry_, filename_));
+      return -1;
+    }
+    done += n;
+  }
+  return len;
+}
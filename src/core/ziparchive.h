@@ -19,15 +19,26 @@
 
  */
 
+#ifndef SRC_CORE_ZIPARCHIVE_H_
+#define SRC_CORE_ZIPARCHIVE_H_
+
+#include <QIODevice>
 #include <QString>
 #include <QStringList>
 #include "defs.h"
 #ifdef HAVE_LIBMINIZIP
+#include <minizip/unzip.h>
 #include <minizip/zip.h>
 #else
+#include "zlib/contrib/minizip/unzip.h"
 #include "zlib/contrib/minizip/zip.h"
 #endif
 
+namespace gpsbabel
+{
+class ParallelDeflate;
+} // namespace gpsbabel
+
 class  ZipArchive
 {
  public:
@@ -44,3 +55,52 @@ private:
   bool valid_;
   zipFile zipfile_;
 };
+
+// Reads one member of a zip archive, inflating it as it is read.
+class ZipEntryReader : public QIODevice
+{
+ public:
+  explicit ZipEntryReader(const QString& zipfile);
+  ~ZipEntryReader() override;
+  ZipEntryReader(const ZipEntryReader&) = delete;
+  ZipEntryReader& operator=(const ZipEntryReader&) = delete;
+
+  bool isValid() const {return unzfile_ != nullptr;}
+  QStringList entries();
+  bool openEntry(const QString& entry);
+  bool isSequential() const override {return true;}
+  void close() override;
+
+ protected:
+  qint64 readData(char* data, qint64 maxlen) override;
+  qint64 writeData(const char* data, qint64 len) override;
+
+ private:
+  unzFile unzfile_;
+};
+
+// Writes a zip archive holding a single member, deflating it as it is written.
+class ZipEntryWriter : public QIODevice
+{
+ public:
+  ZipEntryWriter(const QString& zipfile, const QString& entry);
+  ~ZipEntryWriter() override;
+  ZipEntryWriter(const ZipEntryWriter&) = delete;
+  ZipEntryWriter& operator=(const ZipEntryWriter&) = delete;
+
+  bool open(QIODevice::OpenMode mode) override;
+  bool isSequential() const override {return true;}
+  void close() override;
+
+ protected:
+  qint64 readData(char* data, qint64 maxlen) override;
+  qint64 writeData(const char* data, qint64 len) override;
+
+ private:
+  QString filename_;
+  QString entry_;
+  zipFile zipfile_{nullptr};
+  gpsbabel::ParallelDeflate* deflater_{nullptr};
+};
+
+#endif // SRC_CORE_ZIPARCHIVE_H_
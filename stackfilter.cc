@@ -37,22 +37,21 @@ void StackFilter::process()
     tmp_elt->next = stack;
     stack = tmp_elt;
 
-    waypt_list_ptr = &(tmp_elt->waypts);
-    waypt_backup(&waypt_list_ptr);
-    if (!opt_copy) {
-      waypt_flush_all();
-    }
+    if (opt_copy) {
+      waypt_list_ptr = &(tmp_elt->waypts);
+      waypt_backup(&waypt_list_ptr);
 
-    route_list_ptr = &(tmp_elt->routes);
-    route_backup(&route_list_ptr);
-    if (!opt_copy) {
-      route_flush_all_routes();
-    }
+      route_list_ptr = &(tmp_elt->routes);
+      route_backup(&route_list_ptr);
 
-    route_list_ptr = &(tmp_elt->tracks);
-    track_backup(&route_list_ptr);
-    if (!opt_copy) {
-      route_flush_all_tracks();
+      route_list_ptr = &(tmp_elt->tracks);
+      track_backup(&route_list_ptr);
+    } else {
+      // The new element is empty, so swapping moves everything onto
+      // the stack without copying it.
+      waypt_swap(tmp_elt->waypts);
+      route_swap(tmp_elt->routes);
+      track_swap(tmp_elt->tracks);
     }
 
   } else if (opt_pop) {
@@ -61,12 +60,9 @@ void StackFilter::process()
       fatal(MYNAME ": stack empty\n");
     }
     if (opt_append) {
-      waypt_append(&(stack->waypts));
-      stack->waypts.flush();
-      route_append(&(stack->routes));
-      stack->routes.flush();
-      track_append(&(stack->tracks));
-      stack->tracks.flush();
+      waypt_splice(&(stack->waypts));
+      route_splice(&(stack->routes));
+      track_splice(&(stack->tracks));
     } else if (opt_discard) {
       stack->waypts.flush();
       stack->routes.flush();
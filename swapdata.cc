@@ -38,11 +38,22 @@ void SwapDataFilter::swapdata_cb(const Waypoint* ref)
 * %%%        global callbacks called by gpsbabel main process              %%% *
 *******************************************************************************/
 
+void SwapDataFilter::process_point(Waypoint* wpt)
+{
+  swapdata_cb(wpt);
+}
+
 void SwapDataFilter::process()	/* this procedure must be present in vecs */
 {
-  waypt_disp_all(swapdata_cb);
-  route_disp_all(nullptr, nullptr, swapdata_cb);
-  track_disp_all(nullptr, nullptr, swapdata_cb);
+  for (Waypoint* wpt : waypt_range()) {
+    swapdata_cb(wpt);
+  }
+  for (Waypoint* wpt : route_points()) {
+    swapdata_cb(wpt);
+  }
+  for (Waypoint* wpt : track_points()) {
+    swapdata_cb(wpt);
+  }
 }
 
 #endif // FILTERS_ENABLED
@@ -38,6 +38,11 @@ public:
     return &args;
   }
   void process() override;
+  bool can_process_points() const override
+  {
+    return true;
+  }
+  void process_point(Waypoint* wpt) override;
 
 private:
   QVector<arglist_t> args = {
@@ -109,10 +109,10 @@ TextFormat::text_disp(const Waypoint* wpt)
               .arg((wpt->gc_data->diff%10) ? ".5" : "")
               .arg((int)(wpt->gc_data->terr / 10))
               .arg((wpt->gc_data->terr%10) ? ".5" : "");
-    if (!wpt->gc_data->desc_short.utf_string.isEmpty()) {
+    if (!wpt->gc_data->desc_short.isEmpty()) {
       *file_out << "\n" << wpt->gc_data->desc_short.strip_html() << "\n";
     }
-    if (!wpt->gc_data->desc_long.utf_string.isEmpty()) {
+    if (!wpt->gc_data->desc_long.isEmpty()) {
       *file_out << "\n" << wpt->gc_data->desc_long.strip_html() << "\n";
     }
     if (!wpt->gc_data->hint.isEmpty()) {
@@ -129,9 +129,9 @@ TextFormat::text_disp(const Waypoint* wpt)
   }
 
   if (includelogs) {
-    const auto* fs_gpx = reinterpret_cast<fs_xml*>(wpt->fs.FsChainFind(kFsGpx));
-    if (fs_gpx && fs_gpx->tag) {
-      XmlTag* root = fs_gpx->tag;
+    const auto* fs_gpx = reinterpret_cast<const fs_xml*>(wpt->fs.FsChainFind(kFsGpx));
+    if (fs_gpx && fs_gpx->tree()) {
+      XmlTag* root = fs_gpx->tree();
       XmlTag* curlog = root->xml_findfirst(u"groundspeak:log");
       while (curlog) {
         *file_out << "\n";
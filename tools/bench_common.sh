@@ -0,0 +1,50 @@
+#
+# Helpers shared by the benchmark scripts, to be sourced by bash.
+#
+# Sets up BENCHTEMP, a scratch directory removed on exit.  If
+# BENCH_TIMEOUT is set to a number of seconds, run() stops commands
+# that take longer than that, provided timeout(1) is installed.
+#
+
+BENCHTEMP=$(mktemp -d "${TMPDIR:-/tmp}/gpsbabel-bench.XXXXXX")
+trap 'rm -rf "${BENCHTEMP}"' EXIT
+
+# Peak RSS needs GNU time, without it the field is null.
+if /usr/bin/time -f %M -o /dev/null true 2>/dev/null; then
+  HAVE_TIME=1
+else
+  HAVE_TIME=0
+fi
+
+# run name command...
+# Runs the command, leaving its wall time in seconds in ELAPSED, its
+# peak RSS in kB (or null) in RSS and its exit status in STATUS.
+# A command stopped by BENCH_TIMEOUT has STATUS 124.
+run()
+{
+  local name=$1
+  shift
+  local start end
+  local limit=()
+  if [ -n "${BENCH_TIMEOUT}" ] && command -v timeout >/dev/null; then
+    limit=(timeout "${BENCH_TIMEOUT}")
+  fi
+  start=$(date +%s%N)
+  if [ ${HAVE_TIME} -eq 1 ]; then
+    /usr/bin/time -f %M -o "${BENCHTEMP}/${name}.rss" "${limit[@]}" "$@" >/dev/null 2>"${BENCHTEMP}/${name}.err"
+    STATUS=$?
+    RSS=$(tail -n 1 "${BENCHTEMP}/${name}.rss")
+  else
+    "${limit[@]}" "$@" >/dev/null 2>"${BENCHTEMP}/${name}.err"
+    STATUS=$?
+    RSS=null
+  fi
+  end=$(date +%s%N)
+  ELAPSED=$(awk -v s="${start}" -v e="${end}" 'BEGIN { printf "%.6f", (e - s) / 1e9 }')
+}
+
+# rate amount seconds
+rate()
+{
+  awk -v a="$1" -v s="$2" 'BEGIN { if (s > 0) printf "%.3f", a / s; else print "null" }'
+}
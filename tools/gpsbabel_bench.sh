@@ -0,0 +1,88 @@
+#!/bin/bash
+#
+# Measure the read and write throughput of every file format that can
+# both read and write waypoints, tracks or routes.
+#
+# The data sets are made by the random format, so a given point count
+# and seed always make the same data.  For each format and data type
+# the data is written once and read back once.  Results are written as
+# JSON, one object per format and data type.
+#
+# usage: gpsbabel_bench.sh [-p gpsbabel] [-n points] [-s seed] [-o results.json]
+#
+
+GPSBABEL=./gpsbabel
+POINTS=100000
+SEED=1
+OUTPUT=gpsbabel-bench.json
+
+while getopts "p:n:s:o:" opt; do
+  case "${opt}" in
+    p) GPSBABEL=${OPTARG} ;;
+    n) POINTS=${OPTARG} ;;
+    s) SEED=${OPTARG} ;;
+    o) OUTPUT=${OPTARG} ;;
+    *) echo "usage: $0 [-p gpsbabel] [-n points] [-s seed] [-o results.json]" >&2; exit 1 ;;
+  esac
+done
+
+source "$(dirname "${BASH_SOURCE[0]}")/bench_common.sh"
+
+{
+  printf '{\n'
+  printf '  "version": "%s",\n' "$("${GPSBABEL}" -V 2>/dev/null | tr -d '\n' | sed 's/^ *//;s/"/\\"/g')"
+  printf '  "points": %d,\n' "${POINTS}"
+  printf '  "seed": %d,\n' "${SEED}"
+  printf '  "results": [\n'
+
+  first=1
+  types=(w t r)
+  names=(waypoints tracks routes)
+  "${GPSBABEL}" -^2 | awk -F'\t' '$1 == "file" { print $2 "\t" $3 }' > "${BENCHTEMP}/formats"
+  while IFS=$'\t' read -r caps fmt; do
+    for i in 0 1 2; do
+      if [ "${caps:$((i * 2)):2}" != "rw" ]; then
+        continue
+      fi
+      type=${types[$i]}
+      data="${BENCHTEMP}/data.${fmt}.${type}"
+
+      # The write figures include making the random data.
+      run write "${GPSBABEL}" "-${type}" -i "random,points=${POINTS},seed=${SEED},nodelay" -f /dev/null -o "${fmt}" -F "${data}"
+      write_status=${STATUS}
+      write_seconds=${ELAPSED}
+      write_rss=${RSS}
+      bytes=0
+      if [ -f "${data}" ]; then
+        bytes=$(wc -c < "${data}")
+      fi
+
+      if [ "${write_status}" -eq 0 ]; then
+        run read "${GPSBABEL}" "-${type}" -i "${fmt}" -f "${data}"
+      else
+        STATUS=${write_status}; ELAPSED=0; RSS=null
+      fi
+      read_status=${STATUS}
+
+      if [ ${first} -eq 0 ]; then
+        printf ',\n'
+      fi
+      first=0
+      printf '    {"format": "%s", "type": "%s", "bytes": %d, ' "${fmt}" "${names[$i]}" "${bytes}"
+      if [ "${write_status}" -eq 0 ] && [ "${read_status}" -eq 0 ]; then
+        printf '"ok": true, '
+      else
+        printf '"ok": false, '
+      fi
+      printf '"write": {"seconds": %s, "mb_per_s": %s, "points_per_s": %s, "peak_rss_kb": %s}, ' \
+        "${write_seconds}" "$(rate "$((bytes))e-6" "${write_seconds}")" "$(rate "${POINTS}" "${write_seconds}")" "${write_rss}"
+      printf '"read": {"seconds": %s, "mb_per_s": %s, "points_per_s": %s, "peak_rss_kb": %s}}' \
+        "${ELAPSED}" "$(rate "$((bytes))e-6" "${ELAPSED}")" "$(rate "${POINTS}" "${ELAPSED}")" "${RSS}"
+      rm -f "${data}"
+      echo "${fmt} ${names[$i]}: write ${write_seconds}s read ${ELAPSED}s" >&2
+    done
+  done < "${BENCHTEMP}/formats"
+
+  printf '\n  ]\n'
+  printf '}\n'
+} > "${OUTPUT}"
@@ -0,0 +1,123 @@
+#!/bin/bash
+#
+# Measure how the run time and memory of the filters grow with the
+# number of points.
+#
+# Each filter runs over random data sets of every size given, and the
+# time of just reading the same data set is measured as a baseline.
+# For every size after the first, "exponent" is the slope of the net
+# time against the point count on a log-log scale: about 1 for a linear
+# filter and about 2 for a quadratic one.  Once a filter runs into the
+# time limit its larger sizes are skipped.  Results are written as JSON.
+#
+# usage: gpsbabel_filter_bench.sh [-p gpsbabel] [-n "sizes"] [-s seed]
+#                                 [-t seconds] [-f "filters"] [-o results.json]
+#
+
+GPSBABEL=./gpsbabel
+SIZES="1000 10000 100000 1000000 10000000"
+SEED=1
+BENCH_TIMEOUT=600
+FILTERS=""
+OUTPUT=gpsbabel-filter-bench.json
+
+while getopts "p:n:s:t:f:o:" opt; do
+  case "${opt}" in
+    p) GPSBABEL=${OPTARG} ;;
+    n) SIZES=${OPTARG} ;;
+    s) SEED=${OPTARG} ;;
+    t) BENCH_TIMEOUT=${OPTARG} ;;
+    f) FILTERS=${OPTARG} ;;
+    o) OUTPUT=${OPTARG} ;;
+    *) echo "usage: $0 [-p gpsbabel] [-n \"sizes\"] [-s seed] [-t seconds] [-f \"filters\"] [-o results.json]" >&2; exit 1 ;;
+  esac
+done
+
+source "$(dirname "${BASH_SOURCE[0]}")/bench_common.sh"
+
+# A polygon and an arc crossing much of the globe, so that the random
+# data, which starts anywhere, is partly inside them.
+printf '%s\n' "-60 -150" "-60 150" "60 150" "60 -150" "-60 -150" > "${BENCHTEMP}/polygon.txt"
+awk 'BEGIN { for (i = 0; i <= 100; i++) printf "%.3f %.3f\n", -80 + 1.6 * i, -170 + 3.4 * i }' > "${BENCHTEMP}/arc.txt"
+
+# name, data type and filter invocation.
+BENCHMARKS=(
+  "position        -w position,distance=100m"
+  "duplicate       -w duplicate,location"
+  "radius          -w radius,lat=0,lon=0,distance=5000"
+  "polygon         -w polygon,file=${BENCHTEMP}/polygon.txt"
+  "arcdist         -w arc,file=${BENCHTEMP}/arc.txt,distance=100"
+  "simplify        -t simplify,count=1000"
+  "interpolate     -t interpolate,distance=0.05k"
+  "resample        -t resample,average=4"
+  "track-merge     -t track,merge"
+  "track-split     -t track,split"
+  "sort            -w sort,time"
+  "height          -t height,add=10"
+)
+
+# The net time of a run is its time less that of its baseline.
+net()
+{
+  awk -v t="$1" -v b="$2" 'BEGIN { d = t - b; printf "%.6f", (d > 0) ? d : 0 }'
+}
+
+# exponent n0 t0 n1 t1
+exponent()
+{
+  awk -v n0="$1" -v t0="$2" -v n1="$3" -v t1="$4" \
+    'BEGIN { if ((t0 > 0) && (t1 > 0)) printf "%.3f", log(t1 / t0) / log(n1 / n0); else print "null" }'
+}
+
+declare -A BASELINE
+for type in w t; do
+  for n in ${SIZES}; do
+    run baseline "${GPSBABEL}" "-${type}" -i "random,points=${n},seed=${SEED},nodelay" -f /dev/null
+    BASELINE[${type}${n}]=${ELAPSED}
+  done
+done
+
+{
+  printf '{\n'
+  printf '  "version": "%s",\n' "$("${GPSBABEL}" -V 2>/dev/null | tr -d '\n' | sed 's/^ *//;s/"/\\"/g')"
+  printf '  "seed": %d,\n' "${SEED}"
+  printf '  "timeout": %s,\n' "${BENCH_TIMEOUT}"
+  printf '  "results": [\n'
+
+  first=1
+  for bench in "${BENCHMARKS[@]}"; do
+    read -r name type filter <<< "${bench}"
+    if [ -n "${FILTERS}" ] && [[ " ${FILTERS} " != *" ${name} "* ]]; then
+      continue
+    fi
+    if [ ${first} -eq 0 ]; then
+      printf ',\n'
+    fi
+    first=0
+    printf '    {"filter": "%s", "args": "%s", "runs": [' "${name}" "${filter}"
+    prev_n=""
+    prev_t=""
+    sep=""
+    for n in ${SIZES}; do
+      run filter "${GPSBABEL}" "${type}" -i "random,points=${n},seed=${SEED},nodelay" -f /dev/null -x "${filter}"
+      baseline=${BASELINE[${type#-}${n}]}
+      seconds=$(net "${ELAPSED}" "${baseline}")
+      printf '%s\n      {"points": %d, "ok": %s, "seconds": %s, "baseline_seconds": %s, "net_seconds": %s, "points_per_s": %s, "peak_rss_kb": %s, "exponent": %s}' \
+        "${sep}" "${n}" "$([ "${STATUS}" -eq 0 ] && echo true || echo false)" \
+        "${ELAPSED}" "${baseline}" "${seconds}" "$(rate "${n}" "${seconds}")" "${RSS}" \
+        "$([ -n "${prev_n}" ] && exponent "${prev_n}" "${prev_t}" "${n}" "${seconds}" || echo null)"
+      sep=","
+      echo "${name} ${n}: ${ELAPSED}s" >&2
+      if [ "${STATUS}" -eq 124 ]; then
+        echo "${name}: stopped after ${BENCH_TIMEOUT}s, skipping larger sizes" >&2
+        break
+      fi
+      prev_n=${n}
+      prev_t=${seconds}
+    done
+    printf '\n    ]}'
+  done
+
+  printf '\n  ]\n'
+  printf '}\n'
+} > "${OUTPUT}"
@@ -0,0 +1,99 @@
+#!/bin/bash
+#
+# Fail if a conversion has become slower than its baseline.
+#
+# Every case converts random data generated with a fixed seed.  Each is
+# run three times and the best time counts.  A case fails if its
+# points/s fall more than the threshold below the rate stored in the
+# baseline file.  With -u the measured rates are written to the baseline
+# instead.  Cases missing from the baseline pass.
+#
+# The baseline file has one "case points_per_s" line per case.  Rates
+# depend on the machine, so keep a baseline per machine.
+#
+# usage: perf_gate.sh [-p gpsbabel] [-b baseline] [-t percent] [-n points] [-u] [case...]
+#
+
+GPSBABEL=./gpsbabel
+BASELINE=perf_baseline.txt
+THRESHOLD=25
+POINTS=200000
+UPDATE=0
+
+while getopts "p:b:t:n:u" opt; do
+  case "${opt}" in
+    p) GPSBABEL=${OPTARG} ;;
+    b) BASELINE=${OPTARG} ;;
+    t) THRESHOLD=${OPTARG} ;;
+    n) POINTS=${OPTARG} ;;
+    u) UPDATE=1 ;;
+    *) echo "usage: $0 [-p gpsbabel] [-b baseline] [-t percent] [-n points] [-u] [case...]" >&2; exit 1 ;;
+  esac
+done
+shift $((OPTIND - 1))
+
+source "$(dirname "${BASH_SOURCE[0]}")/bench_common.sh"
+
+# name and arguments, INPUT stands for the generated input file of the
+# same type and OUTPUT for a scratch output file.
+CASES=(
+  "gpx-read         -t -i gpx -f INPUT.gpx"
+  "gpx-write        -t -i gpx -f INPUT.gpx -o gpx -F OUTPUT"
+  "kml-write        -t -i gpx -f INPUT.gpx -o kml -F OUTPUT"
+  "unicsv-read      -w -i unicsv -f INPUT.csv"
+  "unicsv-write     -w -i gpx -f INPUT.wpt.gpx -o unicsv -F OUTPUT"
+  "gdb-write        -t -i gpx -f INPUT.gpx -o gdb -F OUTPUT"
+  "geojson-write    -w -i gpx -f INPUT.wpt.gpx -o geojson -F OUTPUT"
+  "track-filter     -t -i gpx -f INPUT.gpx -x track,sdistance=1k"
+  "simplify-filter  -t -i gpx -f INPUT.gpx -x simplify,error=0.01k"
+)
+
+"${GPSBABEL}" -t -i "random,points=${POINTS},seed=1,nodelay" -f /dev/null -o gpx -F "${BENCHTEMP}/INPUT.gpx" || exit 1
+"${GPSBABEL}" -w -i "random,points=${POINTS},seed=1,nodelay" -f /dev/null -o gpx -F "${BENCHTEMP}/INPUT.wpt.gpx" || exit 1
+"${GPSBABEL}" -w -i gpx -f "${BENCHTEMP}/INPUT.wpt.gpx" -o unicsv -F "${BENCHTEMP}/INPUT.csv" || exit 1
+
+failed=0
+declare -A MEASURED
+for case in "${CASES[@]}"; do
+  read -r name args <<< "${case}"
+  if [ $# -gt 0 ] && [[ " $* " != *" ${name} "* ]]; then
+    continue
+  fi
+  args=${args//INPUT/${BENCHTEMP}/INPUT}
+  args=${args//OUTPUT/${BENCHTEMP}/OUTPUT}
+  best=""
+  for i in 1 2 3; do
+    # shellcheck disable=SC2086
+    run "${name}" "${GPSBABEL}" ${args}
+    if [ "${STATUS}" -ne 0 ]; then
+      echo "${name}: gpsbabel failed:" >&2
+      cat "${BENCHTEMP}/${name}.err" >&2
+      failed=1
+      continue 2
+    fi
+    best=$(awk -v a="${ELAPSED}" -v b="${best}" 'BEGIN { print ((b == "") || (a < b)) ? a : b }')
+  done
+  rate=$(rate "${POINTS}" "${best}")
+  MEASURED[${name}]=${rate}
+
+  expected=$(awk -v n="${name}" '$1 == n { print $2 }' "${BASELINE}" 2>/dev/null)
+  if [ ${UPDATE} -eq 1 ] || [ -z "${expected}" ]; then
+    echo "${name}: ${rate} points/s"
+  elif awk -v r="${rate}" -v e="${expected}" -v t="${THRESHOLD}" 'BEGIN { exit !(r < e * (1 - t / 100)) }'; then
+    echo "${name}: ${rate} points/s, more than ${THRESHOLD}% below the baseline of ${expected}" >&2
+    failed=1
+  else
+    echo "${name}: ${rate} points/s, baseline ${expected}"
+  fi
+done
+
+if [ ${UPDATE} -eq 1 ]; then
+  touch "${BASELINE}"
+  for name in "${!MEASURED[@]}"; do
+    awk -v n="${name}" '$1 != n' "${BASELINE}" > "${BENCHTEMP}/baseline"
+    echo "${name} ${MEASURED[${name}]}" >> "${BENCHTEMP}/baseline"
+    sort "${BENCHTEMP}/baseline" > "${BASELINE}"
+  done
+fi
+
+exit ${failed}
@@ -75,7 +75,6 @@
 #include <cstdio>               // for printf, SEEK_CUR, SEEK_SET
 #include <cmath>                // for abs
 #include <cstring>              // for strlen, strncmp
-#include <vector>               // for vector
 
 #include <QByteArray>           // for QByteArray
 #include <QScopedArrayPointer>  // for QScopedArrayPointer
@@ -255,20 +254,14 @@ void TpoFormatBase::tpo_read_2_x()
 
     /* number of route points */
     short waypoint_count = gbfgetint16(tpo_file_in);
-
-    /* allocate temporary memory for the waypoint deltas */
-    std::vector<short> lat_delta(waypoint_count);
-    std::vector<short> lon_delta(waypoint_count);
-
-    for (int j = 0; j < waypoint_count; j++) {
-
-      /* get this point's longitude delta from the first waypoint */
-      lon_delta[j] = gbfgetint16(tpo_file_in);
-
-      /* get this point's latitude delta from the first waypoint */
-      lat_delta[j] = gbfgetint16(tpo_file_in);
+    if (waypoint_count < 0) {
+      fatal(MYNAME ": Found a track with %d points.\n", waypoint_count);
     }
 
+    /* each point's longitude and latitude delta from the first waypoint,
+       read in one go */
+    const QByteArray deltas = gbfreadbuf(4 * waypoint_count, tpo_file_in);
+
     /* 8 bytes - longitude delta to degrees scale  */
     double lon_scale = gbfgetdbl(tpo_file_in);
 
@@ -285,14 +278,16 @@ void TpoFormatBase::tpo_read_2_x()
     gbfread(&buff[0], 1, 2, tpo_file_in);
 
     /* multiply all the deltas by the scaling factors to determine the waypoint positions */
+    track_reserve_wpts(track_temp, waypoint_count);
     for (int j = 0; j < waypoint_count; j++) {
+      const char* delta = deltas.constData() + 4 * j;
 
       auto* waypoint_temp = new Waypoint;
       double amt;
       /* convert incoming NAD27/CONUS coordinates to WGS84 */
       GPS_Math_Known_Datum_To_WGS84_M(
-        first_lat-lat_delta[j] * lat_scale,
-        first_lon+lon_delta[j] * lon_scale,
+        first_lat-le_read16(delta + 2) * lat_scale,
+        first_lon+le_read16(delta) * lon_scale,
         0.0,
         &waypoint_temp->latitude,
         &waypoint_temp->longitude,
@@ -533,6 +528,17 @@ void TpoFormatBase::tpo_process_tracks()
       }
     }
 
+    // What every track of this style gets, made once per style.
+    styles[ii].rgb = QString::asprintf("%02x%02x%02x",
+                                       styles[ii].color[0],
+                                       styles[ii].color[1],
+                                       styles[ii].color[2]);
+    styles[ii].description = QString("Style=%1, Width=%2, Dashed=%3, Color=#%4")
+                             .arg(styles[ii].name)
+                             .arg(styles[ii].wide)
+                             .arg(styles[ii].dash)
+                             .arg(styles[ii].rgb);
+
     if constexpr(debug) {
       printf("Track style %u: color=#%02x%02x%02x, width=%d, dashed=%d, name=%s\n",
              ii, styles[ii].color[0], styles[ii].color[1], styles[ii].color[2], styles[ii].wide, styles[ii].dash, qPrintable(styles[ii].name));
@@ -606,10 +612,7 @@ void TpoFormatBase::tpo_process_tracks()
     track_temp->rte_name = track_name;
 
     // RGB line_color expressed for html=rrggbb and kml=bbggrr - not assigned before 2012
-    auto rgb = QString::asprintf("%02x%02x%02x",
-                                 styles[track_style].color[0],
-                                 styles[track_style].color[1],
-                                 styles[track_style].color[2]);
+    const QString& rgb = styles[track_style].rgb;
     int bbggrr = styles[track_style].color[2] << 16 |
                  styles[track_style].color[1] << 8 |
                  styles[track_style].color[0];
@@ -634,11 +637,7 @@ void TpoFormatBase::tpo_process_tracks()
     }
 
     // Track description
-    track_temp->rte_desc = QString("Style=%1, Width=%2, Dashed=%3, Color=#%4")
-                           .arg(styles[track_style].name)
-                           .arg(styles[track_style].wide)
-                           .arg(styles[track_style].dash)
-                           .arg(rgb);
+    track_temp->rte_desc = styles[track_style].description;
 
     // Route number
     track_temp->rte_num = ii + 1;
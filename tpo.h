@@ -96,6 +96,8 @@ protected:
     uint8_t color[3] {0, 0, 0}; // keep R/G/B values separate because line_color needs BGR
     uint8_t wide{0};
     uint8_t dash{0};
+    QString rgb;                // rrggbb
+    QString description;        // the rte_desc of its tracks
   };
 
   /* Member Functions */
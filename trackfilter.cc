@@ -22,15 +22,18 @@
 
 static constexpr bool TRACKF_DBG = false;
 
-#include <algorithm>                       // for_each, sort, stable_sort
+#include <algorithm>                       // for for_each, is_sorted, max, min, sort, stable_sort
 #include <cassert>                         // for assert
 #include <cmath>                           // for nan
 #include <cstdio>                          // for printf
 #include <cstdlib>                         // for abs
 #include <cstring>                         // for strlen, strchr, strcmp
 #include <ctime>                           // for gmtime, strftime, time_t, tm
+#include <functional>                      // for greater
 #include <iterator>                        // for next
-#include <utility>                         // for as_const
+#include <queue>                           // for priority_queue
+#include <utility>                         // for as_const, pair
+#include <vector>                          // for vector
 
 #include <QByteArray>                      // for QByteArray
 #include <QChar>                           // for QChar
@@ -42,14 +45,16 @@ static constexpr bool TRACKF_DBG = false;
 #include <QRegularExpressionMatch>         // for QRegularExpressionMatch
 #include <QString>                         // for QString
 #include <Qt>                              // for UTC, CaseInsensitive
-#include <QtGlobal>                        // for foreach, qPrintable, QAddConst<>::Type, qint64
+#include <QVector>                         // for QVector
+#include <QtGlobal>                        // for foreach, qPrintable, QAddConst<>::Type, qint64, qsizetype
 
 #include "defs.h"
 #include "trackfilter.h"
 
-#include "grtcirc.h"                       // for RAD, gcdist, radtometers, heading_true_degrees
+#include "grtcirc.h"                       // for RAD, gcdist, gcdist_meters_below, radtometers, heading_true_degrees_along
 #include "src/core/datetime.h"             // for DateTime
 #include "src/core/logging.h"              // for FatalMsg
+#include "src/core/scheduler.h"            // for parallel_for
 
 
 #if FILTERS_ENABLED || MINIMAL_FILTERS
@@ -64,13 +69,30 @@ int TrackFilter::trackfilter_opt_count()
   int res = 0;
 
   for (const auto& arg : std::as_const(args)) {
-    if (*arg.argval != nullptr) {
+    // threads only says how to do the work, it is not an operation.
+    if ((*arg.argval != nullptr) && (arg.argval != &opt_threads)) {
       res++;
     }
   }
   return res;
 }
 
+/*
+ * Call work on ranges of [0, count), on several threads if asked to and
+ * there are enough track points.  Each index must be independent of the
+ * others, so the result does not depend on the number of threads.
+ */
+void TrackFilter::run_chunks(qsizetype count, qsizetype points, const std::function<void(qsizetype, qsizetype)>& work) const
+{
+  const int threads = (opt_threads != nullptr) ? xstrtoi(opt_threads, nullptr, 10) : 1;
+  if ((threads > 1) && (count > 1) && (points >= kParallelMin)) {
+    // Smaller chunks than one per thread even out tracks of different sizes.
+    gpsbabel::parallel_for(count, count / (4 * threads), work);
+  } else {
+    work(0, count);
+  }
+}
+
 qint64 TrackFilter::trackfilter_parse_time_opt(const char* arg)
 {
   qint64 result = 0;
@@ -128,11 +150,6 @@ bool TrackFilter::trackfilter_init_sort_cb(const route_head* ha, const route_hea
   return trackfilter_get_first_time(ha) < trackfilter_get_first_time(hb);
 }
 
-bool TrackFilter::trackfilter_merge_sort_cb(const Waypoint* wa, const Waypoint* wb)
-{
-  return wa->GetCreationTime() < wb->GetCreationTime();
-}
-
 fix_type TrackFilter::trackfilter_parse_fix(int* nsats)
 {
   if (!opt_fix) {
@@ -358,26 +375,36 @@ void TrackFilter::trackfilter_merge()
 
     int original_waypt_count = track_waypt_count();
 
-    QList<Waypoint*> buff;
+    // Each track becomes a run of points ordered by time.  Tracks from
+    // loggers are nearly always in order already, the others are sorted
+    // on their own, and then the runs are merged.
+    using merge_point_t = std::pair<qint64, Waypoint*>;
+    QVector<QVector<merge_point_t>> runs;
+    runs.reserve(track_list.size());
 
     auto it = track_list.cbegin();
-    while (it != track_list.cend()) { /* put all points into temp buffer */
+    while (it != track_list.cend()) { /* put all points into the runs */
       route_head* track = *it;
       // steal all the wpts
       WaypointList wpts;
       track_swap_wpts(track, wpts);
-      // add them to the buff or delete them
+      // add them to the run or delete them
+      QVector<merge_point_t> run;
+      run.reserve(wpts.count());
       foreach (Waypoint* wpt, wpts) {
         if (wpt->creation_time.isValid()) {
           // we will put the merged points in one track segment,
           // as it isn't clear how track segments in the original tracks
           // should relate to the merged track.
           wpt->wpt_flags.new_trkseg = 0;
-          buff.append(wpt);
+          run.append(merge_point_t(wpt->GetCreationTime().toMSecsSinceEpoch(), wpt));
         } else {
           delete wpt;
         }
       }
+      if (!run.isEmpty()) {
+        runs.append(std::move(run));
+      }
       if (it != track_list.cbegin()) {
         track_del_head(track);
         it = static_cast<RouteList::const_iterator>(track_list.erase(it));
@@ -386,17 +413,46 @@ void TrackFilter::trackfilter_merge()
       }
     }
 
-    std::stable_sort(buff.begin(), buff.end(), trackfilter_merge_sort_cb);
+    auto by_time = [](const merge_point_t& a, const merge_point_t& b)->bool {
+      return a.first < b.first;
+    };
+    QVector<merge_point_t>* run_data = runs.data();
+    run_chunks(runs.size(), original_waypt_count, [run_data, &by_time](qsizetype begin, qsizetype end)->void {
+      for (qsizetype i = begin; i < end; ++i) {
+        QVector<merge_point_t>& run = run_data[i];
+        if (!std::is_sorted(run.cbegin(), run.cend(), by_time)) {
+          std::stable_sort(run.begin(), run.end(), by_time);
+        }
+      }
+    });
+
+    // Merge the runs.  Equal times are taken from the earlier run first,
+    // which keeps the order a stable sort of all the points would give.
+    using head_t = std::pair<qint64, int>; // time of the next point, run
+    std::priority_queue<head_t, std::vector<head_t>, std::greater<head_t>> heads;
+    QVector<qsizetype> pos(runs.size(), 0);
+    for (int i = 0; i < runs.size(); ++i) {
+      heads.emplace(runs.at(i).first().first, i);
+    }
 
-    const Waypoint* prev = nullptr;
+    bool have_prev = false;
+    qint64 prev_time = 0;
 
-    for (auto* wpt : buff) {
-      if ((prev == nullptr) || (prev->GetCreationTime() != wpt->GetCreationTime())) {
+    while (!heads.empty()) {
+      const int i = heads.top().second;
+      heads.pop();
+      const QVector<merge_point_t>& run = runs.at(i);
+      const auto& [time, wpt] = run.at(pos[i]);
+      if (!have_prev || (prev_time != time)) {
         track_add_wpt(master, wpt);
-        prev = wpt;
+        have_prev = true;
+        prev_time = time;
       } else {
         delete wpt;
       }
+      if (++pos[i] < run.size()) {
+        heads.emplace(run.at(pos[i]).first, i);
+      }
     }
 
     if (master->rte_waypt_empty()) {
@@ -503,53 +559,64 @@ void TrackFilter::trackfilter_split()
     WaypointList buff;
     track_swap_wpts(master, buff);
     assert(!buff.empty()); // enforced above
-
-    trackfilter_split_init_rte_name(master, buff.front()->GetCreationTime());
-
-    route_head* curr = master;	/* will be reset by first new track */
-
-    // add the first waypoint to the first track
-    track_add_wpt(curr, buff.front());
-    // and add subsequent waypoints to the first track or a new track
-    for (auto prev_it = buff.cbegin(), it = std::next(buff.cbegin()); it != buff.cend(); ++prev_it, ++it) {
-      const Waypoint* prev_wpt = *prev_it;
-      Waypoint* wpt = *it;
-
-      bool new_track_flag;
-
-      if ((opt_interval == 0) && (opt_distance == 0)) {
-//      FIXME: This whole function needs to be reconsidered for arbitrary time.
-        new_track_flag = prev_wpt->GetCreationTime().toLocalTime().date() !=
-                         wpt->GetCreationTime().toLocalTime().date();
-        if constexpr(TRACKF_DBG) {
-          if (new_track_flag) {
-            printf(MYNAME ": new day %s\n", qPrintable(wpt->GetCreationTime().toLocalTime().date().toString(Qt::ISODate)));
+    const QVector<Waypoint*> points(buff.cbegin(), buff.cend());
+
+    // Find the points that start a new track.  Each gap only depends on
+    // the points on either side of it.
+    QVector<char> new_track(points.size(), 0);
+    run_chunks(points.size(), points.size(), [&points, &new_track, interval, distance, this](qsizetype begin, qsizetype end)->void {
+      for (qsizetype i = std::max<qsizetype>(begin, 1); i < end; ++i) {
+        const Waypoint* prev_wpt = points.at(i - 1);
+        const Waypoint* wpt = points.at(i);
+
+        bool new_track_flag;
+
+        if ((opt_interval == 0) && (opt_distance == 0)) {
+//        FIXME: This whole function needs to be reconsidered for arbitrary time.
+          new_track_flag = prev_wpt->GetCreationTime().toLocalTime().date() !=
+                           wpt->GetCreationTime().toLocalTime().date();
+          if constexpr(TRACKF_DBG) {
+            if (new_track_flag) {
+              printf(MYNAME ": new day %s\n", qPrintable(wpt->GetCreationTime().toLocalTime().date().toString(Qt::ISODate)));
+            }
           }
-        }
-      } else {
-        new_track_flag = true;
-
-        if (distance > 0) {
-          double curdist = radtometers(
-                             gcdist(prev_wpt->position(), wpt->position()));
-          if (curdist <= distance) {
-            new_track_flag = false;
-          } else if constexpr(TRACKF_DBG) {
-            printf(MYNAME ": sdistance, %g > %g\n", curdist, distance);
+        } else {
+          new_track_flag = true;
+
+          if (distance > 0) {
+            double curdist = radtometers(
+                               gcdist(prev_wpt->position(), wpt->position()));
+            if (curdist <= distance) {
+              new_track_flag = false;
+            } else if constexpr(TRACKF_DBG) {
+              printf(MYNAME ": sdistance, %g > %g\n", curdist, distance);
+            }
           }
-        }
 
-        if (interval > 0) {
-          double tr_interval = 0.001 * prev_wpt->GetCreationTime().msecsTo(wpt->GetCreationTime());
-          if (tr_interval <= interval) {
-            new_track_flag = false;
-          } else if constexpr(TRACKF_DBG) {
-            printf(MYNAME ": split, %g > %g\n", tr_interval, interval);
+          if (interval > 0) {
+            double tr_interval = 0.001 * prev_wpt->GetCreationTime().msecsTo(wpt->GetCreationTime());
+            if (tr_interval <= interval) {
+              new_track_flag = false;
+            } else if constexpr(TRACKF_DBG) {
+              printf(MYNAME ": split, %g > %g\n", tr_interval, interval);
+            }
           }
-        }
 
+        }
+        new_track[i] = new_track_flag;
       }
-      if (new_track_flag) {
+    });
+
+    trackfilter_split_init_rte_name(master, points.front()->GetCreationTime());
+
+    route_head* curr = master;	/* will be reset by first new track */
+
+    // add the first waypoint to the first track
+    track_add_wpt(curr, points.front());
+    // and add subsequent waypoints to the first track or a new track
+    for (qsizetype i = 1; i < points.size(); ++i) {
+      Waypoint* wpt = points.at(i);
+      if (new_track.at(i)) {
         if constexpr(TRACKF_DBG) {
           printf(MYNAME ": splitting new track\n");
         }
@@ -599,16 +666,32 @@ void TrackFilter::trackfilter_move()
 
 void TrackFilter::trackfilter_synth()
 {
-  PositionDeg last_course_pos;
-  PositionDeg last_speed_pos;
-  gpsbabel::DateTime last_speed_time;
   int nsats = 0;
 
   fix_type fix = trackfilter_parse_fix(&nsats);
 
-  for (auto* track : std::as_const(track_list)) {
+  // Every track starts over, so the tracks can be done in any order.
+  auto synth_track = [this, fix, nsats](const route_head* track)->void {
+    // Every course is the heading from the point before.
+    QVector<double> courses;
+    if (opt_course) {
+      const int n = track->rte_waypt_ct();
+      QVector<double> latitudes;
+      QVector<double> longitudes;
+      latitudes.reserve(n);
+      longitudes.reserve(n);
+      for (const Waypoint* wpt : track->waypoint_list) {
+        latitudes.append(wpt->latitude);
+        longitudes.append(wpt->longitude);
+      }
+      courses.resize(std::max(n - 1, 0));
+      heading_true_degrees_along(latitudes.constData(), longitudes.constData(), n, courses.data());
+    }
+    qsizetype leg = 0;
+    PositionDeg last_speed_pos;
+    gpsbabel::DateTime last_speed_time;
     bool first = true;
-    foreach (Waypoint* wpt, track->waypoint_list) {
+    for (Waypoint* wpt : std::as_const(track->waypoint_list)) {
       if (opt_fix) {
         wpt->fix = fix;
         if (wpt->sat == 0) {
@@ -623,14 +706,11 @@ void TrackFilter::trackfilter_synth()
           wpt->reset_speed();
         }
         first = false;
-        last_course_pos = wpt->position();
         last_speed_pos = wpt->position();
         last_speed_time = wpt->GetCreationTime();
       } else {
         if (opt_course) {
-          wpt->set_course(heading_true_degrees(last_course_pos,
-                                               wpt->position()));
-          last_course_pos = wpt->position();
+          wpt->set_course(courses.at(leg++));
         }
         if (opt_speed) {
           if (last_speed_time.msecsTo(wpt->GetCreationTime()) != 0) {
@@ -654,7 +734,13 @@ void TrackFilter::trackfilter_synth()
         }
       }
     }
-  }
+  };
+
+  run_chunks(track_list.size(), track_waypt_count(), [this, &synth_track](qsizetype begin, qsizetype end)->void {
+    for (qsizetype i = begin; i < end; ++i) {
+      synth_track(track_list.at(i));
+    }
+  });
 }
 
 
@@ -706,26 +792,31 @@ void TrackFilter::trackfilter_range()
 
   int original_waypt_count = track_waypt_count();
 
+  run_chunks(track_list.size(), original_waypt_count, [this, &start, &stop](qsizetype begin, qsizetype end)->void {
+    for (qsizetype i = begin; i < end; ++i) {
+      for (Waypoint* wpt : std::as_const(track_list.at(i)->waypoint_list)) {
+        bool inside;
+        if (wpt->creation_time.isValid()) {
+          bool after_start = !start.isValid() || (wpt->GetCreationTime() >= start);
+          bool before_stop = !stop.isValid() || (wpt->GetCreationTime() <= stop);
+          inside = after_start && before_stop;
+        } else {
+          // If the time is mangled so horribly that it's
+          // negative, toss it.
+          inside = false;
+        }
+
+        if (!inside) {
+          wpt->wpt_flags.marked_for_deletion = 1;
+        }
+      }
+    }
+  });
+
   auto it = track_list.cbegin();
   while (it != track_list.cend()) {
     route_head* track = *it;
 
-    foreach (Waypoint* wpt, track->waypoint_list) {
-      bool inside;
-      if (wpt->creation_time.isValid()) {
-        bool after_start = !start.isValid() || (wpt->GetCreationTime() >= start);
-        bool before_stop = !stop.isValid() || (wpt->GetCreationTime() <= stop);
-        inside = after_start && before_stop;
-      } else {
-        // If the time is mangled so horribly that it's
-        // negative, toss it.
-        inside = false;
-      }
-
-      if (!inside) {
-        wpt->wpt_flags.marked_for_deletion = 1;
-      }
-    }
     // delete marked wpts
     track_del_marked_wpts(track);
 
@@ -862,23 +953,44 @@ TrackFilter::faketime_t TrackFilter::trackfilter_faketime_check(const char* time
 void TrackFilter::trackfilter_faketime()
 {
   assert(opt_faketime != nullptr);
-  faketime_t faketime = trackfilter_faketime_check(opt_faketime);
+  const faketime_t faketime = trackfilter_faketime_check(opt_faketime);
+
+  // The times run on from track to track, so first count how many steps
+  // come before each track.
+  QVector<qint64> first_step(track_list.size());
+  qint64 steps = 0;
+  for (qsizetype i = 0; i < track_list.size(); ++i) {
+    first_step[i] = steps;
+    const route_head* track = track_list.at(i);
+    if (faketime.force) {
+      steps += track->rte_waypt_ct();
+    } else {
+      for (const Waypoint* wpt : std::as_const(track->waypoint_list)) {
+        if (!wpt->creation_time.isValid()) {
+          ++steps;
+        }
+      }
+    }
+  }
 
-  for (auto* track : std::as_const(track_list)) {
-    foreach (Waypoint* wpt, track->waypoint_list) {
+  run_chunks(track_list.size(), track_waypt_count(), [this, &faketime, &first_step](qsizetype begin, qsizetype end)->void {
+    for (qsizetype i = begin; i < end; ++i) {
+      QDateTime time = faketime.start.addMSecs(faketime.step * first_step.at(i));
+      for (Waypoint* wpt : std::as_const(track_list.at(i)->waypoint_list)) {
 
-      if (!wpt->creation_time.isValid() || faketime.force) {
-        wpt->creation_time = faketime.start;
-        faketime.start = faketime.start.addMSecs(faketime.step);
+        if (!wpt->creation_time.isValid() || faketime.force) {
+          wpt->creation_time = time;
+          time = time.addMSecs(faketime.step);
+        }
       }
     }
-  }
+  });
 }
 
 bool TrackFilter::trackfilter_points_are_same(const Waypoint* wpta, const Waypoint* wptb)
 {
   return
-    radtometers(gcdist(wpta->position(), wptb->position())) < kDistanceLimit &&
+    gcdist_meters_below(wpta->position(), wptb->position(), kDistanceLimit) &&
     std::abs(wpta->altitude - wptb->altitude) < 20 &&
     wpta->courses_equal(*wptb) &&
     wpta->speeds_equal(*wptb) &&
@@ -887,12 +999,12 @@ bool TrackFilter::trackfilter_points_are_same(const Waypoint* wpta, const Waypoi
     wpta->temperatures_equal(*wptb);
 }
 
-void TrackFilter::trackfilter_segment_head(const route_head* rte)
+void TrackFilter::trackfilter_segment_mark(const route_head* rte)
 {
   double avg_dist = 0;
   const Waypoint* prev_wpt = nullptr;
 
-  const auto wptlist = rte->waypoint_list;
+  const auto& wptlist = rte->waypoint_list;
   for (auto it = wptlist.cbegin(); it != wptlist.cend(); ++it) {
     auto* wpt = *it;
     if (it != wptlist.cbegin()) {
@@ -926,7 +1038,6 @@ void TrackFilter::trackfilter_segment_head(const route_head* rte)
     }
     prev_wpt = wpt;
   }
-  track_del_marked_wpts(const_cast<route_head*>(rte));
 }
 
 /*******************************************************************************
@@ -956,7 +1067,18 @@ void TrackFilter::init()
 
   // Perform segmenting first.
   if (opt_segment) {
-    track_disp_all(trackfilter_segment_head, nullptr, nullptr);
+    QVector<route_head*> tracks;
+    track_disp_all([&tracks](const route_head* rte)->void {
+      tracks.append(const_cast<route_head*>(rte));
+    }, nullptr, nullptr);
+    run_chunks(tracks.size(), track_waypt_count(), [&tracks](qsizetype begin, qsizetype end)->void {
+      for (qsizetype i = begin; i < end; ++i) {
+        trackfilter_segment_mark(tracks.at(i));
+      }
+    });
+    for (route_head* rte : std::as_const(tracks)) {
+      track_del_marked_wpts(rte);
+    }
   }
 
   track_list.clear();
@@ -22,11 +22,13 @@
 #ifndef TRACKFILTER_H_INCLUDED_
 #define TRACKFILTER_H_INCLUDED_
 
+#include <functional>           // for function
+
 #include <QDateTime>            // for QDateTime
 #include <QList>                // for QList
 #include <QString>              // for QString
 #include <QVector>              // for QVector
-#include <QtGlobal>             // for qint64
+#include <QtGlobal>             // for qint64, qsizetype
 
 #include "defs.h"               // for ARG_NOMINMAX, route_head (ptr only), ARG...
 #include "filter.h"             // for Filter
@@ -58,6 +60,7 @@ private:
   /* Constants */
 
   static constexpr double kDistanceLimit = 1.11319; // for points to be considered the same, meters.
+  static constexpr qsizetype kParallelMin = 16 * 1024; // track points
   static constexpr char TRACKFILTER_PACK_OPTION[] = "pack";
   static constexpr char TRACKFILTER_SPLIT_OPTION[] = "split";
   static constexpr char TRACKFILTER_SDIST_OPTION[] = "sdistance";
@@ -76,13 +79,14 @@ private:
   static constexpr char TRACKFILTER_FAKETIME_OPTION[] = "faketime";
   static constexpr char TRACKFILTER_DISCARD_OPTION[] = "discard";
   static constexpr char TRACKFILTER_MINPOINTS_OPTION[] = "minimum_points";
+  static constexpr char TRACKFILTER_THREADS_OPTION[] = "threads";
 
   /* Member Functions */
 
   int trackfilter_opt_count();
+  void run_chunks(qsizetype count, qsizetype points, const std::function<void(qsizetype, qsizetype)>& work) const;
   static qint64 trackfilter_parse_time_opt(const char* arg);
   static bool trackfilter_init_sort_cb(const route_head* ha, const route_head* hb);
-  static bool trackfilter_merge_sort_cb(const Waypoint* wa, const Waypoint* wb);
   fix_type trackfilter_parse_fix(int* nsats);
   static QDateTime trackfilter_get_first_time(const route_head* track);
   static QDateTime trackfilter_get_last_time(const route_head* track);
@@ -103,7 +107,7 @@ private:
   static faketime_t trackfilter_faketime_check(const char* timestr);
   void trackfilter_faketime();
   static bool trackfilter_points_are_same(const Waypoint* wpta, const Waypoint* wptb);
-  static void trackfilter_segment_head(const route_head* rte);
+  static void trackfilter_segment_mark(const route_head* rte);
 
   /* Data Members */
 
@@ -125,6 +129,7 @@ private:
   char* opt_faketime = nullptr;
   char* opt_discard = nullptr;
   char* opt_minpoints = nullptr;
+  char* opt_threads = nullptr;
   int minimum_points{0};
 
   QVector<arglist_t> args = {
@@ -214,6 +219,11 @@ private:
       "Discard tracks with fewer than these points",
       nullptr, ARGTYPE_INT, "0", "50", nullptr
     },
+    {
+      TRACKFILTER_THREADS_OPTION, &opt_threads,
+      "Work on large track lists on this many threads",
+      nullptr, ARGTYPE_INT, "1", nullptr, nullptr
+    },
   };
 
   QList<route_head*> track_list;
@@ -33,7 +33,7 @@
 
 #define MYNAME "transform"
 
-void TransformFilter::transform_waypoints()
+void TransformFilter::transform_waypoints(bool move)
 {
   auto* rte = new route_head;
   switch (current_target) {
@@ -44,9 +44,16 @@ void TransformFilter::transform_waypoints()
     track_add_head(rte);
     break;
   }
-  foreach (Waypoint* wpt, *global_waypoint_list) {
+  // Points that are moved are taken out of the waypoint list first.
+  WaypointList moved;
+  if (move) {
+    waypt_swap(moved);
+  }
+  foreach (Waypoint* wpt, move ? moved : *global_waypoint_list) {
 
-    wpt = new Waypoint(*wpt);
+    if (!move) {
+      wpt = new Waypoint(*wpt);
+    }
     if (timeless) {
       wpt->SetCreationTime(gpsbabel::DateTime());
     }
@@ -96,7 +103,12 @@ void TransformFilter::transform_trk_disp_hdr_cb(const route_head* trk)
 
 void TransformFilter::transform_any_disp_wpt_cb(const Waypoint* wpt)
 {
-  auto* temp = new Waypoint(*wpt);
+  transform_any_wpt(new Waypoint(*wpt));
+}
+
+/* Add temp, which is taken over, to the target. */
+void TransformFilter::transform_any_wpt(Waypoint* temp)
+{
   if (timeless) {
     temp->SetCreationTime(gpsbabel::DateTime());
   }
@@ -109,16 +121,46 @@ void TransformFilter::transform_any_disp_wpt_cb(const Waypoint* wpt)
   }
 }
 
-void TransformFilter::transform_routes()
+/*
+ * When the routes are deleted afterwards their points are moved to the
+ * target instead of copied, leaving the routes empty.
+ */
+void TransformFilter::transform_routes(bool move)
 {
+  if (move) {
+    auto move_rte = [this](const route_head* rte)->void {
+      transform_rte_disp_hdr_cb(rte);
+      WaypointList wpts;
+      route_swap_wpts(const_cast<route_head*>(rte), wpts);
+      foreach (Waypoint* wpt, wpts) {
+        transform_any_wpt(wpt);
+      }
+    };
+    route_disp_all(move_rte, nullptr, nullptr);
+    return;
+  }
+
   WayptFunctor<TransformFilter> transform_any_disp_wpt_cb_f(this, &TransformFilter::transform_any_disp_wpt_cb);
   RteHdFunctor<TransformFilter> transform_rte_disp_hdr_cb_f(this, &TransformFilter::transform_rte_disp_hdr_cb);
 
   route_disp_all(transform_rte_disp_hdr_cb_f, nullptr, transform_any_disp_wpt_cb_f);
 }
 
-void TransformFilter::transform_tracks()
+void TransformFilter::transform_tracks(bool move)
 {
+  if (move) {
+    auto move_trk = [this](const route_head* trk)->void {
+      transform_trk_disp_hdr_cb(trk);
+      WaypointList wpts;
+      track_swap_wpts(const_cast<route_head*>(trk), wpts);
+      foreach (Waypoint* wpt, wpts) {
+        transform_any_wpt(wpt);
+      }
+    };
+    track_disp_all(move_trk, nullptr, nullptr);
+    return;
+  }
+
   WayptFunctor<TransformFilter> transform_any_disp_wpt_cb_f(this, &TransformFilter::transform_any_disp_wpt_cb);
   RteHdFunctor<TransformFilter> transform_trk_disp_hdr_cb_f(this, &TransformFilter::transform_trk_disp_hdr_cb);
 
@@ -146,13 +188,13 @@ void TransformFilter::process()
     current_target = 'W';
     switch (toupper(*opt_waypts)) {
     case 'R':
-      transform_routes();
+      transform_routes(delete_after);
       if (delete_after) {
         route_flush_all_routes();
       }
       break;
     case 'T':
-      transform_tracks();
+      transform_tracks(delete_after);
       if (delete_after) {
         route_flush_all_tracks();
       }
@@ -165,13 +207,13 @@ void TransformFilter::process()
     current_target = 'R';
     switch (toupper(*opt_routes)) {
     case 'W':
-      transform_waypoints();
+      transform_waypoints(delete_after);
       if (delete_after) {
         waypt_flush_all();
       }
       break;
     case 'T':
-      transform_tracks();
+      transform_tracks(delete_after);
       if (delete_after) {
         route_flush_all_tracks();
       }
@@ -184,13 +226,13 @@ void TransformFilter::process()
     current_target = 'T';
     switch (toupper(*opt_tracks)) {
     case 'W':
-      transform_waypoints();
+      transform_waypoints(delete_after);
       if (delete_after) {
         waypt_flush_all();
       }
       break;
     case 'R':
-      transform_routes();
+      transform_routes(delete_after);
       if (delete_after) {
         route_flush_all_routes();
       }
@@ -86,12 +86,13 @@ private:
     }
   };
 
-  void transform_waypoints();
+  void transform_waypoints(bool move);
   void transform_rte_disp_hdr_cb(const route_head* rte);
   void transform_trk_disp_hdr_cb(const route_head* trk);
   void transform_any_disp_wpt_cb(const Waypoint* wpt);
-  void transform_routes();
-  void transform_tracks();
+  void transform_any_wpt(Waypoint* temp);
+  void transform_routes(bool move);
+  void transform_tracks(bool move);
 
 };
 
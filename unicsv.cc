@@ -21,19 +21,29 @@
 
 #include "unicsv.h"
 
+#include <algorithm>               // for count, max, min
 #include <cmath>                   // for fabs, lround
 #include <cstdio>                  // for NULL, sscanf
+#include <cstdlib>                 // for strtod
+#include <cstring>                 // for memchr, strchr
 #include <ctime>                   // for tm
-#include <utility>                 // for as_const
+#include <memory>                  // for unique_ptr, make_unique
+#include <optional>                // for optional
+#include <utility>                 // for as_const, move
+#include <vector>                  // for vector
 
 #include <QByteArray>              // for QByteArray
+#include <QByteArrayView>          // for QByteArrayView
 #include <QChar>                   // for QChar
 #include <QDateTime>               // for QDateTime
 #include <QIODevice>               // for QIODevice, QIODevice::ReadOnly, QIODevice::WriteOnly
+#include <QJsonObject>             // for QJsonObject
 #include <QLatin1Char>             // for QLatin1Char
 #include <QList>                   // for QList, QList<>::const_iterator
 #include <QString>                 // for QString, operator!=, operator==
+#include <QStringConverter>        // for QStringConverter
 #include <QStringList>             // for QStringList
+#include <QStringView>             // for QStringView
 #include <QTextStream>             // for QTextStream, operator<<, qSetRealNumberPrecision, qSetFieldWidth, QTextStream::FixedNotation
 #include <QTime>                   // for QTime
 #include <QVector>                 // for QVector
@@ -46,10 +56,16 @@
 #include "garmin_fs.h"             // for garmin_fs_t
 #include "garmin_tables.h"         // for gt_lookup_datum_index, gt_get_mps_grid_longname, gt_lookup_grid_type
 #include "geocache.h"              // for Geocache, Geocache::status_t, Geoc...
-#include "jeeps/gpsmath.h"         // for GPS_Math_UKOSMap_To_WGS84_H, GPS_Math_EN_To_UKOSNG_Map, GPS_Math_Known_Datum_To_UTM_EN, GPS_Math_Known_Datum_To_WGS84_M, GPS_Math_Swiss_EN_To_WGS84, GPS_Math_UTM_EN_To_Known_Datum, GPS_Math_WGS84_To_Known_Datum_M, GPS_Math_WGS84_To_Swiss_EN, GPS_Math_WGS...
-#include "session.h"               // for session_t
+#include "jeeps/gpsmath.h"         // for GPS_Math_UKOSMap_To_WGS84_H, GPS_Math_EN_To_UKOSNG_Map, GPS_Math_Known_Datum_To_UTM_Setup, GPS_Math_Known_Datum_To_WGS84_Setup, GPS_Math_Swiss_EN_To_WGS84, GPS_Math_UTM_EN_To_Known_Datum, GPS_Math_WGS84_To_Known_Datum_Setup, GPS_Math_WGS84_To_Swiss_EN, GPS_Math_WGS...
+#include "session.h"               // for session_t, ThreadScope
+#include "src/core/budget.h"       // for Budget
+#include "src/core/checkpoint.h"   // for Checkpoint
 #include "src/core/datetime.h"     // for DateTime
-#include "src/core/logging.h"      // for Warning, Fatal
+#include "src/core/file.h"         // for File
+#include "src/core/logging.h"      // for Warning, Fatal, FatalError
+#include "src/core/memoryfile.h"   // for MemoryFiles
+#include "src/core/numeric.h"      // for to_double
+#include "src/core/scheduler.h"    // for TaskGroup
 #include "src/core/textstream.h"   // for TextStream
 
 
@@ -224,6 +240,130 @@ UnicsvFormat::unicsv_parse_gc_code(const QString& str)
   return res;
 }
 
+/*
+ * The fast paths below only take the plain numeric layouts that our
+ * sscanf patterns would accept, and hand anything else, including all the
+ * errors, to the sscanf based parsers so they behave as before.
+ */
+namespace
+{
+
+enum class ScanResult {match, no_match, unsure};
+
+bool unicsv_is_digit(QChar c)
+{
+  return (c >= '0') && (c <= '9');
+}
+
+/* An unsigned number as %d reads it, skipping white space first. */
+ScanResult unicsv_scan_int(QStringView str, qsizetype& pos, int& value)
+{
+  while ((pos < str.size()) && ((str.at(pos) == ' ') || (str.at(pos) == '\t'))) {
+    ++pos;
+  }
+  if (pos >= str.size()) {
+    return ScanResult::no_match;
+  }
+  QChar c = str.at(pos);
+  if (!unicsv_is_digit(c)) {
+    return ((c == '+') || (c == '-') || c.isSpace()) ? ScanResult::unsure : ScanResult::no_match;
+  }
+  value = 0;
+  for (int digits = 0; (pos < str.size()) && unicsv_is_digit(str.at(pos)); ++digits, ++pos) {
+    if (digits == 9) {
+      return ScanResult::unsure;	/* leave overflow to sscanf */
+    }
+    value = value * 10 + (str.at(pos).unicode() - '0');
+  }
+  return ScanResult::match;
+}
+
+/* A separator as %1[...] matches it. */
+ScanResult unicsv_scan_sep(QStringView str, qsizetype& pos, const char* seps, char& sep)
+{
+  if ((pos < str.size()) && (str.at(pos).unicode() < 0x80) &&
+      (strchr(seps, str.at(pos).toLatin1()) != nullptr)) {
+    sep = str.at(pos++).toLatin1();
+    return ScanResult::match;
+  }
+  return ScanResult::no_match;
+}
+
+} // namespace
+
+/* "%d%1[-.//]%d%1[-.//]%d%n" */
+std::optional<QDate>
+UnicsvFormat::unicsv_parse_date_fast(QStringView str, qsizetype* consumed)
+{
+  int p[3];
+  char sep = 0;
+  qsizetype pos = 0;
+  for (int i = 0; i < 3; ++i) {
+    ScanResult r = unicsv_scan_int(str, pos, p[i]);
+    if ((r == ScanResult::match) && (i < 2)) {
+      r = unicsv_scan_sep(str, pos, "-./", sep);
+    }
+    if (r != ScanResult::match) {
+      if ((r == ScanResult::no_match) && (consumed != nullptr)) {
+        *consumed = 0;
+        return QDate();
+      }
+      return std::nullopt;
+    }
+  }
+
+  int year;
+  int month;
+  int day;
+  if ((p[0] > 99) || (sep == '-')) {
+    year = p[0];
+    month = p[1];
+    day = p[2];
+  } else if (sep == '.') {
+    day = p[0];
+    month = p[1];
+    year = p[2];
+  } else {
+    day = p[1];
+    month = p[0];
+    year = p[2];
+  }
+  if ((p[0] < 100) && (p[1] < 100) && (p[2] < 100)) {
+    year += (year < 70) ? 2000 : 1900;
+  }
+  if ((month > 12) || (month < 1) || (day > 31) || (day < 1)) {
+    if (consumed != nullptr) {
+      *consumed = 0;
+      return QDate();
+    }
+    return std::nullopt;
+  }
+  QDate result(year, month, day);
+  if (!result.isValid()) {
+    return std::nullopt;
+  }
+  if (consumed != nullptr) {
+    *consumed = pos;
+  }
+  return result;
+}
+
+QDate
+UnicsvFormat::unicsv_parse_date(QStringView str, qsizetype* consumed)
+{
+  if (std::optional<QDate> result = unicsv_parse_date_fast(str, consumed); result.has_value()) {
+    return *result;
+  }
+  QByteArray utf8 = str.toUtf8();
+  if (consumed == nullptr) {
+    return unicsv_parse_date(utf8.constData(), nullptr);
+  }
+  int lconsumed = 0;
+  QDate result = unicsv_parse_date(utf8.constData(), &lconsumed);
+  *consumed = QString::fromUtf8(utf8.constData(), lconsumed).size();
+  return result;
+}
+
 QDate
 UnicsvFormat::unicsv_parse_date(const char* str, int* consumed)
 {
@@ -319,10 +459,77 @@ UnicsvFormat::unicsv_parse_time(const char* str, QDate& date)
   return result;
 }
 
+/* "%d%*1[.://]%d%*1[.://]%d%lf", after an optional date */
+std::optional<QTime>
+UnicsvFormat::unicsv_parse_time_fast(QStringView str, QDate& date)
+{
+  qsizetype consumed = 0;
+  std::optional<QDate> ldate = unicsv_parse_date_fast(str, &consumed);
+  if (!ldate.has_value()) {
+    return std::nullopt;
+  }
+  qsizetype pos = 0;
+  if (consumed && ldate->isValid()) {
+    pos = consumed;
+  }
+
+  int hms[3];
+  char sep;
+  for (int i = 0; i < 3; ++i) {
+    ScanResult r = unicsv_scan_int(str, pos, hms[i]);
+    if ((r == ScanResult::match) && (i < 2)) {
+      r = unicsv_scan_sep(str, pos, ".:/", sep);
+    }
+    if (r != ScanResult::match) {
+      return std::nullopt;
+    }
+  }
+
+  int msec = 0;
+  while ((pos < str.size()) && ((str.at(pos) == ' ') || (str.at(pos) == '\t'))) {
+    ++pos;
+  }
+  if ((pos < str.size()) && (str.at(pos) == '.')) {
+    /* A fraction the way %lf reads it, then truncated to msec. */
+    char buf[32];
+    std::size_t len = 0;
+    buf[len++] = '0';
+    buf[len++] = '.';
+    for (++pos; (pos < str.size()) && unicsv_is_digit(str.at(pos)); ++pos) {
+      if (len == sizeof(buf) - 1) {
+        return std::nullopt;
+      }
+      buf[len++] = str.at(pos).toLatin1();
+    }
+    if ((len == 2) || ((pos < str.size()) && ((str.at(pos) == 'e') || (str.at(pos) == 'E')))) {
+      return std::nullopt;
+    }
+    buf[len] = '\0';
+    msec = strtod(buf, nullptr) * 1000.0;
+  } else if (pos < str.size()) {
+    QChar c = str.at(pos);
+    if (unicsv_is_digit(c) || c.isSpace() || (c.unicode() < 0x80 && strchr("+-iInN", c.toLatin1()) != nullptr)) {
+      return std::nullopt;
+    }
+  }
+
+  QTime result(hms[0], hms[1], hms[2], msec);
+  if (!result.isValid()) {
+    return std::nullopt;
+  }
+  if (consumed && ldate->isValid()) {
+    date = *ldate;
+  }
+  return result;
+}
+
 QTime
-UnicsvFormat::unicsv_parse_time(const QString& str, QDate& date)
+UnicsvFormat::unicsv_parse_time(QStringView str, QDate& date)
 {
-  return unicsv_parse_time(CSTR(str), date);
+  if (std::optional<QTime> result = unicsv_parse_time_fast(str, date); result.has_value()) {
+    return *result;
+  }
+  return unicsv_parse_time(str.toUtf8().constData(), date);
 }
 
 Geocache::status_t
@@ -449,6 +656,75 @@ UnicsvFormat::unicsv_fondle_header(QString header)
       }
     }
   }
+
+  if (opt_columns) {
+    unicsv_project_fields(opt_columns);
+  }
+}
+
+/*
+ * Ignore the columns whose fields weren't asked for with the 'columns'
+ * option.  The position is always read, and asking for any date or time
+ * field keeps all of them as they only make sense together.
+ */
+void
+UnicsvFormat::unicsv_project_fields(const QString& columns)
+{
+  auto is_datetime = [](field_e type)->bool {
+    switch (type) {
+    case fld_utc_date:
+    case fld_utc_time:
+    case fld_date:
+    case fld_time:
+    case fld_datetime:
+    case fld_iso_time:
+    case fld_year:
+    case fld_month:
+    case fld_day:
+    case fld_hour:
+    case fld_min:
+    case fld_sec:
+      return true;
+    default:
+      return false;
+    }
+  };
+
+  std::bitset<fld_terminator> keep;
+  for (QString name : columns.toLower().split('+')) {
+    name = name.trimmed();
+    if (name.isEmpty()) {
+      continue;
+    }
+    const field_t* f = &fields_def[0];
+    while (!f->name.isEmpty() && !unicsv_compare_fields(name, f)) {
+      f++;
+    }
+    if (f->name.isEmpty()) {
+      fatal(FatalMsg() << MYNAME << ": Unknown field" << name << "in option 'columns'");
+    }
+    if (f->type != fld_terminator) {
+      keep[f->type] = true;
+    }
+  }
+  for (int type = 0; type < fld_terminator; ++type) {
+    if (keep[type] && is_datetime(static_cast<field_e>(type))) {
+      for (int t = 0; t < fld_terminator; ++t) {
+        keep[t] = keep[t] || is_datetime(static_cast<field_e>(t));
+      }
+      break;
+    }
+  }
+  keep[fld_latitude] = keep[fld_longitude] = keep[fld_ns] = keep[fld_ew] = true;
+  keep[fld_utm_zone] = keep[fld_utm_zone_char] = keep[fld_utm_northing] = keep[fld_utm_easting] = keep[fld_utm] = true;
+  keep[fld_bng] = keep[fld_bng_zone] = keep[fld_bng_northing] = keep[fld_bng_easting] = true;
+  keep[fld_swiss] = keep[fld_swiss_northing] = keep[fld_swiss_easting] = true;
+
+  for (auto& type : unicsv_fields_tab) {
+    if ((type != fld_terminator) && !keep[type]) {
+      type = fld_terminator;
+    }
+  }
 }
 
 void
@@ -465,7 +741,9 @@ UnicsvFormat::rd_init(const QString& fname)
 
   unicsv_track = unicsv_route = nullptr;
   unicsv_datum_idx = gt_lookup_datum_index(opt_datum, MYNAME);
+  unicsv_datum_transform = GPS_Math_Known_Datum_To_WGS84_Setup(unicsv_datum_idx);
 
+  rd_fname = fname;
   fin = new gpsbabel::TextStream;
   fin->open(fname, QIODevice::ReadOnly, MYNAME, opt_codec);
   unicsv_lineno = 0;
@@ -489,6 +767,7 @@ UnicsvFormat::rd_deinit()
   delete fin;
   fin = nullptr;
   unicsv_fields_tab.clear();
+  icon_pool.clear();
 }
 
 void
@@ -522,17 +801,22 @@ UnicsvFormat::unicsv_parse_one_line(const QString& ibuf)
   wpt->longitude = kUnicsvUnknown;
 
   int column = -1;
-  const QStringList values = csv_linesplit(ibuf, unicsv_fieldsep, kUnicsvQuoteChar, unicsv_lineno, CsvQuoteMethod::rfc4180);
-  for (auto value : values) {
+  csv_linesplit(ibuf, unicsv_fieldsep, kUnicsvQuoteChar, unicsv_lineno,
+                split_fields, split_scratch, CsvQuoteMethod::rfc4180);
+  for (const auto field : std::as_const(split_fields)) {
     if (++column >= unicsv_fields_tab.size()) {
       break;  /* ignore extra fields on line */
     }
 
     checked++;
-    value = value.trimmed();
-    if (value.isEmpty()) {
+    if (unicsv_fields_tab[column] == fld_terminator) {
+      continue;  /* unhandled or unwanted column */
+    }
+    QStringView trimmed = field.trimmed();
+    if (trimmed.isEmpty()) {
       continue;  /* skip empty columns */
     }
+    const QString value = trimmed.toString();
     switch (unicsv_fields_tab[column]) {
 
     case fld_time:
@@ -590,11 +874,11 @@ UnicsvFormat::unicsv_parse_one_line(const QString& ibuf)
       break;
 
     case fld_utm_easting:
-      utm_easting = value.toDouble();
+      utm_easting = gpsbabel::to_double(value);
       break;
 
     case fld_utm_northing:
-      utm_northing = value.toDouble();
+      utm_northing = gpsbabel::to_double(value);
       break;
 
     case fld_utm_zone_char:
@@ -622,11 +906,11 @@ UnicsvFormat::unicsv_parse_one_line(const QString& ibuf)
       break;
 
     case fld_bng_northing:
-      bng_northing = value.toDouble();
+      bng_northing = gpsbabel::to_double(value);
       break;
 
     case fld_bng_easting:
-      bng_easting = value.toDouble();
+      bng_easting = gpsbabel::to_double(value);
       break;
 
     case fld_swiss:
@@ -638,29 +922,29 @@ UnicsvFormat::unicsv_parse_one_line(const QString& ibuf)
       break;
 
     case fld_swiss_easting:
-      swiss_easting = value.toDouble();
+      swiss_easting = gpsbabel::to_double(value);
       break;
 
     case fld_swiss_northing:
-      swiss_northing = value.toDouble();
+      swiss_northing = gpsbabel::to_double(value);
       break;
 
     case fld_hdop:
-      wpt->hdop = value.toDouble();
+      wpt->hdop = gpsbabel::to_double(value);
       if (unicsv_detect) {
         unicsv_data_type = trkdata;
       }
       break;
 
     case fld_pdop:
-      wpt->pdop = value.toDouble();
+      wpt->pdop = gpsbabel::to_double(value);
       if (unicsv_detect) {
         unicsv_data_type = trkdata;
       }
       break;
 
     case fld_vdop:
-      wpt->vdop = value.toDouble();
+      wpt->vdop = gpsbabel::to_double(value);
       if (unicsv_detect) {
         unicsv_data_type = trkdata;
       }
@@ -694,7 +978,7 @@ UnicsvFormat::unicsv_parse_one_line(const QString& ibuf)
 
     case fld_utc_date:
       if (need_datetime && !utc_date.isValid()) {
-        utc_date = unicsv_parse_date(CSTR(value), nullptr);
+        utc_date = unicsv_parse_date(value, nullptr);
       }
       break;
 
@@ -714,21 +998,21 @@ UnicsvFormat::unicsv_parse_one_line(const QString& ibuf)
       break;
 
     case fld_course:
-      wpt->set_course(value.toDouble());
+      wpt->set_course(gpsbabel::to_double(value));
       if (unicsv_detect) {
         unicsv_data_type = trkdata;
       }
       break;
 
     case fld_temperature:
-      d = value.toDouble();
+      d = gpsbabel::to_double(value);
       if (fabs(d) < 999999) {
         wpt->set_temperature(d);
       }
       break;
 
     case fld_temperature_f:
-      d = value.toDouble();
+      d = gpsbabel::to_double(value);
       if (fabs(d) < 999999) {
         wpt->set_temperature(FAHRENHEIT_TO_CELSIUS(d));
       }
@@ -749,7 +1033,7 @@ UnicsvFormat::unicsv_parse_one_line(const QString& ibuf)
       break;
 
     case fld_power:
-      wpt->power = value.toDouble();
+      wpt->power = gpsbabel::to_double(value);
       if (unicsv_detect) {
         unicsv_data_type = trkdata;
       }
@@ -768,7 +1052,7 @@ UnicsvFormat::unicsv_parse_one_line(const QString& ibuf)
       break;
 
     case fld_symbol:
-      wpt->icon_descr = value;
+      wpt->icon_descr = icon_pool.intern(value);
       break;
 
     case fld_iso_time:
@@ -784,7 +1068,7 @@ UnicsvFormat::unicsv_parse_one_line(const QString& ibuf)
 
     case fld_date:
       if (need_datetime && !local_date.isValid()) {
-        local_date = unicsv_parse_date(CSTR(value), nullptr);
+        local_date = unicsv_parse_date(value, nullptr);
       }
       break;
 
@@ -911,10 +1195,10 @@ UnicsvFormat::unicsv_parse_one_line(const QString& ibuf)
         gc_data->set_container(value);
         break;
       case fld_gc_terr:
-        gc_data->terr = value.toDouble() * 10;
+        gc_data->terr = gpsbabel::to_double(value) * 10;
         break;
       case fld_gc_diff:
-        gc_data->diff = value.toDouble() * 10;
+        gc_data->diff = gpsbabel::to_double(value) * 10;
         break;
       case fld_gc_is_archived:
         gc_data->is_archived = unicsv_parse_status(value);
@@ -1040,8 +1324,8 @@ UnicsvFormat::unicsv_parse_one_line(const QString& ibuf)
   if ((src_datum != kDatumWGS84) &&
       (wpt->latitude != kUnicsvUnknown) && (wpt->longitude != kUnicsvUnknown)) {
     double alt;
-    GPS_Math_Known_Datum_To_WGS84_M(wpt->latitude, wpt->longitude, 0.0,
-                                    &wpt->latitude, &wpt->longitude, &alt, src_datum);
+    unicsv_datum_transform.convert(wpt->latitude, wpt->longitude, 0.0,
+                                   &wpt->latitude, &wpt->longitude, &alt);
   }
 
   switch (unicsv_data_type) {
@@ -1073,7 +1357,17 @@ UnicsvFormat::read()
     return;
   }
 
+  if (opt_checkpoint != nullptr) {
+    read_incremental();
+    return;
+  }
+
+  if ((opt_threads != nullptr) && read_parallel(xstrtoi(opt_threads, nullptr, 10))) {
+    return;
+  }
+
   while ((buff = fin->readLine(), !buff.isNull())) {
+    gpsbabel::Budget::check();
     ++unicsv_lineno;
     buff = buff.trimmed();
     if (buff.isEmpty() || buff.startsWith('#')) {
@@ -1083,6 +1377,213 @@ UnicsvFormat::read()
   }
 }
 
+/*
+ * Reads only the lines added since the checkpoint, the header having
+ * been read by rd_init as always.  A last line without a line break may
+ * still be being written, so it is left for the next run.
+ */
+void
+UnicsvFormat::read_incremental()
+{
+  gpsbabel::Checkpoint checkpoint(opt_checkpoint, rd_fname, MYNAME);
+  qint64 resume = fin->bytePos();
+  if (resume < 0) {
+    fatal(MYNAME ": A checkpoint can only be kept for UTF-8 or US-ASCII input.\n");
+  }
+  if (checkpoint.offset() > resume) {
+    fin->seekBytes(checkpoint.offset());
+    resume = checkpoint.offset();
+    unicsv_lineno = checkpoint.state().value("line").toInt();
+  }
+
+  QString buff;
+  while (fin->readLineInto(&buff) && fin->lineEnded()) {
+    ++unicsv_lineno;
+    resume = fin->bytePos();
+    buff = buff.trimmed();
+    if (buff.isEmpty() || buff.startsWith('#')) {
+      continue;
+    }
+    unicsv_parse_one_line(buff);
+  }
+
+  checkpoint.save(resume, {{"line", unicsv_lineno}});
+}
+
+/* The UTF-8 lines from begin to end, as read() would take them from fin. */
+void
+UnicsvFormat::unicsv_parse_lines(const char* begin, const char* end)
+{
+  while (begin < end) {
+    const auto* eol = static_cast<const char*>(memchr(begin, '\n', end - begin));
+    const char* next = (eol == nullptr) ? end : eol + 1;
+    ++unicsv_lineno;
+    QString buff = QString::fromUtf8(begin, ((eol == nullptr) ? end : eol) - begin).trimmed();
+    if (!buff.isEmpty() && !buff.startsWith('#')) {
+      unicsv_parse_one_line(buff);
+    }
+    begin = next;
+  }
+}
+
+/*
+ * Reads the data lines in runs on several threads, each with its own
+ * parser started in the state ours has after the first data line.  A
+ * line can change that state, by letting a column turn out to hold ISO
+ * times or the points turn out to be a track, so a run whose parser
+ * didn't start in the state ours is in when we get to it is read again
+ * here.  The points are spliced in in file order.
+ */
+bool
+UnicsvFormat::read_parallel(int threads)
+{
+  // Runs smaller than this aren't worth a thread.
+  constexpr qint64 kMinChunkSize = 64 * 1024;
+
+  if ((threads < 2) || (waypt_sink() != nullptr) || (unicsv_data_type == rtedata) ||
+      (rd_fname == "-") || gpsbabel::MemoryFiles::contains(rd_fname) ||
+      ((opt_codec != nullptr) && (QByteArray(opt_codec).compare("UTF-8", Qt::CaseInsensitive) != 0))) {
+    return false;
+  }
+  gpsbabel::File file(rd_fname);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  const qint64 size = file.size();
+  if (size < 2 * kMinChunkSize) {
+    return false;
+  }
+  uchar* map = file.map(0, size);
+  if (map == nullptr) {
+    return false;
+  }
+  const char* data = reinterpret_cast<const char*>(map);
+  const char* end = data + size;
+
+  // Only UTF-8, which fin reads with any byte order mark skipped.
+  const char* begin = data;
+  std::optional<QStringConverter::Encoding> bom =
+    QStringConverter::encodingForData(QByteArrayView(data, 4));
+  if (bom.has_value()) {
+    if (bom.value() != QStringConverter::Utf8) {
+      file.unmap(map);
+      return false;
+    }
+    begin += 3;
+  }
+  // Skip what rd_init took from fin.
+  for (int i = 0; (i < unicsv_lineno) && (begin < end); ++i) {
+    const auto* eol = static_cast<const char*>(memchr(begin, '\n', end - begin));
+    begin = (eol == nullptr) ? end : eol + 1;
+  }
+  // The first data line most likely settles the state.
+  const int points_before = waypt_count() + track_waypt_count();
+  while ((begin < end) && (waypt_count() + track_waypt_count() == points_before)) {
+    const auto* eol = static_cast<const char*>(memchr(begin, '\n', end - begin));
+    const char* next = (eol == nullptr) ? end : eol + 1;
+    unicsv_parse_lines(begin, next);
+    begin = next;
+  }
+
+  const qint64 target = std::max((end - begin) / (threads * 4), kMinChunkSize);
+  std::vector<std::unique_ptr<ParallelChunk>> chunks;
+  int lineno = unicsv_lineno;
+  while (begin < end) {
+    const char* split = begin + std::min<qint64>(target, end - begin);
+    const auto* eol = static_cast<const char*>(memchr(split, '\n', end - split));
+    const char* next = (eol == nullptr) ? end : eol + 1;
+    auto chunk = std::make_unique<ParallelChunk>();
+    chunk->begin = begin;
+    chunk->end = next;
+    chunk->lineno = lineno;
+    lineno += std::count(begin, next, '\n');
+    chunks.push_back(std::move(chunk));
+    begin = next;
+  }
+
+  const session_t* session = curr_session();
+  gpsbabel::TaskGroup group;
+  for (const auto& chunk : chunks) {
+    auto parser = std::make_unique<UnicsvFormat>();
+    for (int i = 0; i < unicsv_args.size(); ++i) {
+      *parser->unicsv_args.at(i).argval = *unicsv_args.at(i).argval;
+    }
+    parser->unicsv_fields_tab = unicsv_fields_tab;
+    parser->unicsv_altscale = unicsv_altscale;
+    parser->unicsv_depthscale = unicsv_depthscale;
+    parser->unicsv_proximityscale = unicsv_proximityscale;
+    parser->unicsv_fieldsep = unicsv_fieldsep;
+    parser->unicsv_lineno = chunk->lineno;
+    parser->unicsv_data_type = unicsv_data_type;
+    parser->unicsv_datum_idx = unicsv_datum_idx;
+    parser->unicsv_datum_transform = unicsv_datum_transform;
+    parser->unicsv_detect = unicsv_detect;
+    parser->utc_offset = utc_offset;
+    chunk->parser = std::move(parser);
+    ParallelChunk* c = chunk.get();
+    group.run([c, session]() {
+      read_chunk(*c, session);
+    });
+  }
+  // A fatal error in a run only gets here when fatal() throws, as in
+  // the library, and then everything the runs read is let go of first.
+  try {
+    group.wait();
+  } catch (const FatalError&) {
+    for (const auto& chunk : chunks) {
+      chunk->waypoints.flush();
+      chunk->tracks.flush();
+    }
+    file.unmap(map);
+    throw;
+  }
+
+  const QVector<field_e> start_fields_tab = unicsv_fields_tab;
+  const gpsdata_type start_data_type = unicsv_data_type;
+  for (const auto& chunk : chunks) {
+    UnicsvFormat* parser = chunk->parser.get();
+    if ((unicsv_fields_tab != start_fields_tab) || (unicsv_data_type != start_data_type)) {
+      chunk->waypoints.flush();
+      chunk->tracks.flush();
+      unicsv_parse_lines(chunk->begin, chunk->end);
+      continue;
+    }
+
+    waypt_splice(&chunk->waypoints);
+    if (parser->unicsv_track != nullptr) {
+      WaypointList points;
+      chunk->tracks.swap_wpts(parser->unicsv_track, points);
+      if (unicsv_track == nullptr) {
+        unicsv_track = new route_head;
+        track_add_head(unicsv_track);
+      }
+      WaypointList track_points;
+      track_swap_wpts(unicsv_track, track_points);
+      track_points.splice(points);
+      track_swap_wpts(unicsv_track, track_points);
+    }
+    chunk->tracks.flush();
+    unicsv_fields_tab = parser->unicsv_fields_tab;
+    unicsv_data_type = parser->unicsv_data_type;
+    unicsv_lineno = parser->unicsv_lineno;
+  }
+  file.unmap(map);
+  return true;
+}
+
+void
+UnicsvFormat::read_chunk(ParallelChunk& chunk, const session_t* session)
+{
+  const ThreadScope scope;
+  waypt_use_list(&chunk.waypoints);
+  route_use_lists(&chunk.routes, &chunk.tracks);
+  use_session(session);
+
+  UnicsvFormat* parser = chunk.parser.get();
+  parser->unicsv_parse_lines(chunk.begin, chunk.end);
+  parser->icon_pool.clear();
+}
+
 /* =========================================================================== */
 
 [[noreturn]] void UnicsvFormat::unicsv_fatal_outside(const Waypoint* wpt) const
@@ -1274,6 +1775,72 @@ UnicsvFormat::unicsv_waypt_enum_cb(const Waypoint* wpt)
   }
 }
 
+/*
+ * Sets the output columns from the field names given with the 'fields'
+ * option, so write() doesn't have to look at every point first.  The
+ * columns keep their usual order and position is always written.
+ */
+void
+UnicsvFormat::unicsv_fixed_outp_flags(const QString& fields)
+{
+  const QStringList names = fields.toLower().split('+');
+  for (QString name : names) {
+    name = name.trimmed();
+    if (name.isEmpty()) {
+      continue;
+    }
+    const field_t* f = &fields_def[0];
+    while (!f->name.isEmpty() && !unicsv_compare_fields(name, f)) {
+      f++;
+    }
+    if (f->name.isEmpty()) {
+      fatal(FatalMsg() << MYNAME << ": Unknown output field" << name);
+    }
+
+    switch (f->type) {
+    case fld_latitude:
+    case fld_longitude:
+    case fld_utm_zone:
+    case fld_utm_zone_char:
+    case fld_utm_northing:
+    case fld_utm_easting:
+    case fld_utm:
+    case fld_bng:
+    case fld_bng_zone:
+    case fld_bng_northing:
+    case fld_bng_easting:
+    case fld_swiss:
+    case fld_swiss_northing:
+    case fld_swiss_easting:
+    case fld_ns:
+    case fld_ew:
+      break;
+    case fld_datetime:
+    case fld_iso_time:
+      unicsv_outp_flags[fld_date] = true;
+      unicsv_outp_flags[fld_time] = true;
+      break;
+    case fld_utc_date:
+    case fld_year:
+    case fld_month:
+    case fld_day:
+      unicsv_outp_flags[fld_date] = true;
+      break;
+    case fld_utc_time:
+    case fld_hour:
+    case fld_min:
+    case fld_sec:
+      unicsv_outp_flags[fld_time] = true;
+      break;
+    case fld_temperature_f:
+      unicsv_outp_flags[fld_temperature] = true;
+      break;
+    default:
+      unicsv_outp_flags[f->type] = true;
+    }
+  }
+}
+
 void
 UnicsvFormat::unicsv_waypt_disp_cb(const Waypoint* wpt)
 {
@@ -1291,8 +1858,8 @@ UnicsvFormat::unicsv_waypt_disp_cb(const Waypoint* wpt)
     lon = wpt->longitude;
     alt = wpt->altitude;
   } else {
-    GPS_Math_WGS84_To_Known_Datum_M(wpt->latitude, wpt->longitude, 0.0,
-                                    &lat, &lon, &alt, unicsv_datum_idx);
+    unicsv_datum_transform.convert(wpt->latitude, wpt->longitude, 0.0,
+                                   &lat, &lon, &alt);
   }
 
   *fout << unicsv_waypt_ct << unicsv_fieldsep;
@@ -1338,8 +1905,7 @@ UnicsvFormat::unicsv_waypt_disp_cb(const Waypoint* wpt)
     double north;
     double east;
 
-    if (! GPS_Math_Known_Datum_To_UTM_EN(lat, lon,
-                                         &east, &north, &zone, &zonec, unicsv_datum_idx)) {
+    if (! unicsv_utm.convert(lat, lon, &east, &north, &zone, &zonec)) {
       unicsv_fatal_outside(wpt);
     }
     *fout << QStringLiteral("%1").arg(zone, 2, 10, QLatin1Char('0')) << unicsv_fieldsep
@@ -1674,15 +2240,14 @@ UnicsvFormat::unicsv_waypt_disp_cb(const Waypoint* wpt)
 void
 UnicsvFormat::wr_init(const QString& fname)
 {
-  if (opt_fields) {
-    fatal(FatalMsg() << MYNAME <<
-          ": option 'fields' is not supported on output");
-  }
   fout = new gpsbabel::TextStream;
   fout->open(fname, QIODevice::WriteOnly, MYNAME, opt_codec);
   fout->setRealNumberNotation(QTextStream::FixedNotation);
 
   unicsv_outp_flags.reset();
+  if (opt_fields) {
+    unicsv_fixed_outp_flags(opt_fields);
+  }
   unicsv_grid_idx = grid_unknown;
   unicsv_datum_idx = kDatumWGS84;
   unicsv_fieldsep = kUnicsvFieldSep;
@@ -1713,6 +2278,8 @@ UnicsvFormat::wr_init(const QString& fname)
   } else {
     unicsv_datum_idx = gt_lookup_datum_index(opt_datum, MYNAME);
   }
+  unicsv_datum_transform = GPS_Math_WGS84_To_Known_Datum_Setup(unicsv_datum_idx);
+  unicsv_utm = GPS_Math_Known_Datum_To_UTM_Setup(unicsv_datum_idx);
 
   llprec = xstrtoi(opt_prec, nullptr, 10);
   utc_offset = (opt_utc == nullptr)? 0 : xstrtoi(opt_utc, nullptr, 10) * SECONDS_PER_HOUR;
@@ -1750,15 +2317,21 @@ UnicsvFormat::write()
   case wptdata:
   case unknown_gpsdata:
     unicsv_check_modes(doing_rtes || doing_trks);
-    waypt_disp_all(unicsv_waypt_enum_cb_lambda);
+    if (!opt_fields) {
+      waypt_disp_all(unicsv_waypt_enum_cb_lambda);
+    }
     break;
   case trkdata:
     unicsv_check_modes(doing_rtes);
-    track_disp_all(nullptr, nullptr, unicsv_waypt_enum_cb_lambda);
+    if (!opt_fields) {
+      track_disp_all(nullptr, nullptr, unicsv_waypt_enum_cb_lambda);
+    }
     break;
   case rtedata:
     unicsv_check_modes(doing_trks);
-    route_disp_all(nullptr, nullptr, unicsv_waypt_enum_cb_lambda);
+    if (!opt_fields) {
+      route_disp_all(nullptr, nullptr, unicsv_waypt_enum_cb_lambda);
+    }
     break;
   case posndata:
     fatal(FatalMsg() << MYNAME << ": Realtime positioning not supported.");
@@ -23,16 +23,23 @@
 
 #include <bitset>                 // for bitset
 #include <cstdint>                // for uint32_t
+#include <memory>                 // for unique_ptr
+#include <optional>               // for optional
 
 #include <QDate>                  // for QDate
 #include <QDateTime>              // for QDateTime
+#include <QList>                  // for QList
 #include <QString>                // for QString
+#include <QStringView>            // for QStringView
 #include <QTime>                  // for QTime
 #include <QVector>                // for QVector
 
 #include "defs.h"
 #include "format.h"               // for Format
 #include "geocache.h"             // for Geocache, Geocache::status_t
+#include "jeeps/gpsmath.h"        // for GPS_Molodensky, GPS_UTM
+#include "session.h"              // for session_t
+#include "src/core/stringpool.h"  // for StringPool
 #include "src/core/textstream.h"  // for TextStream
 
 
@@ -60,6 +67,14 @@ public:
   void wr_init(const QString& fname) override;
   void write() override;
   void wr_deinit() override;
+  bool rd_can_stream() const override
+  {
+    return true;
+  }
+  bool wr_can_run_concurrently() const override
+  {
+    return true;
+  }
 
 private:
   /* Types */
@@ -146,6 +161,16 @@ private:
     uint32_t options;
   };
 
+  struct ParallelChunk {
+    const char* begin{nullptr};
+    const char* end{nullptr};
+    int lineno{0};	// lines before begin
+    std::unique_ptr<UnicsvFormat> parser;
+    WaypointList waypoints;
+    RouteList routes;
+    RouteList tracks;
+  };
+
   /* Constants */
 
   /* "kUnicsvFieldSep" and "kUnicsvLineSep" are only used by the writer */
@@ -165,18 +190,27 @@ private:
   /* Member Functions */
 
   static long long int unicsv_parse_gc_code(const QString& str);
+  static std::optional<QDate> unicsv_parse_date_fast(QStringView str, qsizetype* consumed);
+  static QDate unicsv_parse_date(QStringView str, qsizetype* consumed);
   static QDate unicsv_parse_date(const char* str, int* consumed);
+  static std::optional<QTime> unicsv_parse_time_fast(QStringView str, QDate& date);
+  static QTime unicsv_parse_time(QStringView str, QDate& date);
   static QTime unicsv_parse_time(const char* str, QDate& date);
-  static QTime unicsv_parse_time(const QString& str, QDate& date);
   static Geocache::status_t unicsv_parse_status(const QString& str);
   QDateTime unicsv_adjust_time(QDate date, QTime time, bool is_localtime) const;
   static bool unicsv_compare_fields(const QString& s, const field_t* f);
   void unicsv_fondle_header(QString header);
+  void unicsv_project_fields(const QString& columns);
   void unicsv_parse_one_line(const QString& ibuf);
+  void unicsv_parse_lines(const char* begin, const char* end);
+  bool read_parallel(int threads);
+  void read_incremental();
+  static void read_chunk(ParallelChunk& chunk, const session_t* session);
   [[noreturn]] void unicsv_fatal_outside(const Waypoint* wpt) const;
   void unicsv_print_str(const QString& s) const;
   void unicsv_print_date_time(const QDateTime& idt) const;
   void unicsv_waypt_enum_cb(const Waypoint* wpt);
+  void unicsv_fixed_outp_flags(const QString& fields);
   void unicsv_waypt_disp_cb(const Waypoint* wpt);
   static void unicsv_check_modes(bool test);
 
@@ -190,14 +224,20 @@ private:
   double unicsv_proximityscale{};
   const char* unicsv_fieldsep{nullptr};
   int unicsv_lineno{0};
+  QString rd_fname;
+  QList<QStringView> split_fields;	/* csv_linesplit buffers, reused per line */
+  QString split_scratch;
   gpsbabel::TextStream* fin{nullptr};
   gpsbabel::TextStream* fout{nullptr};
+  gpsbabel::StringPool icon_pool;
   gpsdata_type unicsv_data_type{unknown_gpsdata};
   route_head* unicsv_track{nullptr};
   route_head* unicsv_route{nullptr};
   std::bitset<fld_terminator> unicsv_outp_flags;
   grid_type unicsv_grid_idx{grid_unknown};
   int unicsv_datum_idx{};
+  GPS_Molodensky unicsv_datum_transform;  // to WGS 84 when reading, from it when writing
+  GPS_UTM unicsv_utm;                     // on the datum's ellipse, for writing
   char* opt_datum{nullptr};
   char* opt_grid{nullptr};
   char* opt_utc{nullptr};
@@ -206,6 +246,9 @@ private:
   char* opt_prec{nullptr};
   char* opt_fields{nullptr};
   char* opt_codec{nullptr};
+  char* opt_threads{nullptr};
+  char* opt_columns{nullptr};
+  char* opt_checkpoint{nullptr};
   int unicsv_waypt_ct{};
   char unicsv_detect{};
   int llprec{};
@@ -244,6 +287,21 @@ private:
       "codec", &opt_codec, "codec to use for reading and writing strings (default UTF-8)",
       "UTF-8", ARGTYPE_STRING, ARG_NOMINMAX, nullptr
     },
+    {
+      "threads", &opt_threads,
+      "Read large files on this many threads",
+      nullptr, ARGTYPE_INT, "1", nullptr, nullptr
+    },
+    {
+      "columns", &opt_columns,
+      "Only read these input fields, separated by '+'",
+      nullptr, ARGTYPE_STRING, ARG_NOMINMAX, nullptr
+    },
+    {
+      "checkpoint", &opt_checkpoint,
+      "Only read what was appended since this checkpoint",
+      nullptr, ARGTYPE_OUTFILE, ARG_NOMINMAX, nullptr
+    },
   };
 
 };
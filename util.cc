@@ -20,13 +20,13 @@
  */
 
 #include <algorithm>                    // for sort
-#include <cctype>                       // for isspace, tolower
+#include <array>                        // for array
 #include <cerrno>                       // for errno
 #include <climits>                      // for INT_MAX, INT_MIN
 #include <cmath>                        // for fabs, floor
 #include <cstdio>                       // for size_t, vsnprintf, FILE, fopen, printf, sprintf, stderr, stdin, stdout
 #include <cstdlib>                      // for abs, calloc, free, malloc, realloc
-#include <cstring>                      // for strlen, strcat, strstr, memcpy, strcmp, strcpy, strdup, strchr, strerror
+#include <cstring>                      // for strlen, strcat, memcpy, strcmp, strcpy, strdup, strchr, strerror
 #include <utility>                      // for as_const
 
 #include <QByteArray>                   // for QByteArray
@@ -313,6 +313,55 @@ le_write32(void* ptr, const unsigned value)
   p[3] = value >> 24;
 }
 
+namespace
+{
+
+/*
+ * The offset from UTC of the local times in an hour of a day, if all of
+ * them have it and each of them is there exactly once, i.e. no change of
+ * the zone's rules comes near.  Zone rules are slow to resolve, and logs
+ * in local time have runs of points in the same hour, so the answer for
+ * a few recent hours is kept.
+ */
+bool local_offset(QDate date, int hour, int* offset)
+{
+  struct Bucket {
+    qint64 hour{-1};
+    int offset{0};
+    bool fixed{false};
+  };
+  static thread_local std::array<Bucket, 64> cache;
+
+  const qint64 key = (date.toJulianDay() * 24) + hour;
+  Bucket& bucket = cache[key % cache.size()];
+  if (bucket.hour != key) {
+    constexpr qint64 kMsecsPerHour = 60 * 60 * 1000;
+    auto offset_at = [](qint64 msecs)->int {
+      return QDateTime::fromMSecsSinceEpoch(msecs, Qt::LocalTime).offsetFromUtc();
+    };
+
+    bucket.hour = key;
+    bucket.fixed = false;
+    const QDateTime start(date, QTime(hour, 0), Qt::LocalTime);
+    if (start.isValid()) {
+      // Changes shift local time by at most a few hours, so with the same
+      // offset from three hours before to four after there is none.
+      const qint64 msecs = start.toMSecsSinceEpoch();
+      bucket.offset = start.offsetFromUtc();
+      bucket.fixed = (offset_at(msecs - 3 * kMsecsPerHour) == bucket.offset) &&
+                     (offset_at(msecs + 4 * kMsecsPerHour) == bucket.offset);
+    }
+  }
+  *offset = bucket.offset;
+  return bucket.fixed;
+}
+
+} // namespace
+
+/*
+ * Local times, unless forced to an offset, come back as the same instant
+ * in Qt::UTC, which is much cheaper to work with than Qt::LocalTime.
+ */
 QDateTime
 make_datetime(QDate date, QTime time, bool is_localtime, bool force_utc, int utc_offset)
 {
@@ -337,6 +386,17 @@ make_datetime(QDate date, QTime time, bool is_localtime, bool force_utc, int utc
     timespec = Qt::UTC;
   }
 
+  if ((timespec == Qt::LocalTime) && (date.isValid() || time.isValid())) {
+    const QDate day = date.isValid() ? date : QDate(1970, 1, 1);
+    const QTime clock = time.isValid() ? time : QTime(0, 0);
+    int local = 0;
+    if (local_offset(day, clock.hour(), &local)) {
+      const qint64 msecs = ((day.toJulianDay() - QDate(1970, 1, 1).toJulianDay()) * 86400000LL) +
+                           clock.msecsSinceStartOfDay() - (local * 1000LL);
+      return QDateTime::fromMSecsSinceEpoch(msecs, Qt::UTC);
+    }
+  }
+
   if (date.isValid() && time.isValid()) {
     result = QDateTime(date, time, timespec, offset);
   } else if (time.isValid()) {
@@ -349,6 +409,9 @@ make_datetime(QDate date, QTime time, bool is_localtime, bool force_utc, int utc
     result = date.startOfDay(timespec, offset);
   }
 
+  if ((timespec == Qt::LocalTime) && result.isValid()) {
+    result = result.toUTC();
+  }
   return result;
 }
 
@@ -752,6 +815,36 @@ pretty_deg_format(double lat, double lon, char fmt, const char* sep, bool html)
 
 
 
+namespace
+{
+
+/*
+ * Overwrites s from pos on with text, as far as s goes.
+ */
+void overwrite(QString& s, qsizetype pos, const char* text)
+{
+  for (; *text && (pos < s.size()); ++text, ++pos) {
+    s[pos] = QLatin1Char(*text);
+  }
+}
+
+/*
+ * The ASCII letters of in in lower case, and everything else as it is, so
+ * that a position in one is the same position in the other.
+ */
+QString ascii_lower(const QString& in)
+{
+  QString out(in);
+  for (QChar& c : out) {
+    if ((c >= 'A') && (c <= 'Z')) {
+      c = QChar(c.unicode() + ('a' - 'A'));
+    }
+  }
+  return out;
+}
+
+} // namespace
+
 /*
  * Get rid of potentially nasty HTML that would influence another record
  * that includes;
@@ -762,85 +855,45 @@ pretty_deg_format(double lat, double lon, char fmt, const char* sep, bool html)
 QString
 strip_nastyhtml(const QString& in)
 {
-  char* returnstr = xstrdup(in);
-  char* lcstr = xstrdup(in.toLower());
-
-  while (char* lcp = strstr(lcstr, "<body>")) {
-    char* sp = returnstr + (lcp - lcstr) ; /* becomes <!   > */
-    sp++;
-    *sp++ = '!';
-    *sp++ = ' ';
-    *sp++ = ' ';
-    *sp++ = ' ';
-    *lcp = '*';         /* so we wont find it again */
+  QString returnstr(in);
+  QString lcstr = ascii_lower(in);
+
+  /* Each tag found is marked in lcstr so we won't find it again. */
+  auto find = [&lcstr](QLatin1String tag)->qsizetype {
+    qsizetype pos = lcstr.indexOf(tag);
+    if (pos >= 0) {
+      lcstr[pos] = '*';
+    }
+    return pos;
+  };
+
+  for (qsizetype pos; (pos = find(QLatin1String("<body>"))) >= 0;) {
+    overwrite(returnstr, pos + 1, "!   ");  /* becomes <!   > */
   }
-  while (char* lcp = strstr(lcstr, "<body")) {   /* becomes <!--        --> */
-    char* sp = returnstr + (lcp - lcstr) ;
-    sp++;
-    *sp++ = '!';
-    *sp++ = '-';
-    *sp++ = '-';
-    while ((*sp) && (*sp != '>')) {
-      sp++;
+  for (qsizetype pos; (pos = find(QLatin1String("<body"))) >= 0;) {
+    overwrite(returnstr, pos + 1, "!--");  /* becomes <!--        --> */
+    qsizetype end = returnstr.indexOf('>', pos + 4);
+    if (end < 0) {
+      end = returnstr.size();
     }
-    *--sp = '-';
-    *--sp = '-';
-    *lcp = '*';         /* so we wont find it again */
+    overwrite(returnstr, end - 2, "--");
   }
-  while (char* lcp = strstr(lcstr, "</body>")) {
-    char* sp = returnstr + (lcp - lcstr) ; /* becomes <!---- */
-    sp++;
-    *sp++ = '!';
-    *sp++ = '-';
-    *sp++ = '-';
-    *sp++ = '-';
-    *sp++ = '-';
-    *lcp = '*';         /* so we wont find it again */
+  for (qsizetype pos; (pos = find(QLatin1String("</body>"))) >= 0;) {
+    overwrite(returnstr, pos + 1, "!----");  /* becomes <!---- */
   }
-  while (char* lcp = strstr(lcstr, "</html>")) {
-    char* sp = returnstr + (lcp - lcstr) ; /* becomes </---- */
-    sp++;
-    *sp++ = '!';
-    *sp++ = '-';
-    *sp++ = '-';
-    *sp++ = '-';
-    *sp++ = '-';
-    *lcp = '*';         /* so we wont find it again */
+  for (qsizetype pos; (pos = find(QLatin1String("</html>"))) >= 0;) {
+    overwrite(returnstr, pos + 1, "!----");  /* becomes </---- */
   }
-  while (char* lcp = strstr(lcstr, "<style")) {
-    char* sp = returnstr + (lcp - lcstr) ; /* becomes <!--   */
-    sp++;
-    *sp++ = '!';
-    *sp++ = '-';
-    *sp++ = '-';
-    *sp++ = ' ';
-    *sp++ = ' ';
-    *sp = ' ';
-    *lcp = '*';         /* so we wont find it again */
+  for (qsizetype pos; (pos = find(QLatin1String("<style"))) >= 0;) {
+    overwrite(returnstr, pos + 1, "!--   ");  /* becomes <!--   */
   }
-  while (char* lcp = strstr(lcstr, "</style>")) {
-    char* sp = returnstr + (lcp - lcstr) ; /* becomes    --> */
-    *sp++ = ' ';
-    *sp++ = ' ';
-    *sp++ = ' ';
-    *sp++ = ' ';
-    *sp++ = ' ';
-    *sp++ = '-';
-    *sp++ = '-';
-    *lcp = '*';         /* so we wont find it again */
+  for (qsizetype pos; (pos = find(QLatin1String("</style>"))) >= 0;) {
+    overwrite(returnstr, pos, "     --");  /* becomes    --> */
   }
-  while (char* lcp = strstr(lcstr, "<image")) {
-    char* sp = returnstr + (lcp - lcstr) ; /* becomes <img */
-    sp+=3;
-    *sp++ = 'g';
-    *sp++ = ' ';
-    *sp++ = ' ';
-    *lcp = '*';
+  for (qsizetype pos; (pos = find(QLatin1String("<image"))) >= 0;) {
+    overwrite(returnstr, pos + 3, "g  ");  /* becomes <img */
   }
-  xfree(lcstr);
-  QString rv(returnstr);
-  xfree(returnstr);
-  return rv;
+  return returnstr;
 }
 
 /*
@@ -859,82 +912,99 @@ QString strip_html(const QString& utfstring)
   doc.setHtml(utfstring);
   return doc.toPlainText().simplified();
 #else
-  char* out;
-  char* instr;
-  char tag[8];
-  unsigned short int taglen = 0;
-
-  char* incopy = instr = xstrdup(utfstring);
   /*
-   * We only shorten, so just dupe the input buf for space.
+   * One pass over the UTF-16, into a string that is never longer than
+   * the input.  Tags and entities are only ever matched on ASCII, so this
+   * is what going through UTF-8 byte by byte gave.
    */
-  char* outstring = out = xstrdup(utfstring);
+  auto is_space = [](QChar c)->bool {
+    return (c == ' ') || ((c >= '\t') && (c <= '\r'));
+  };
 
+  QString out;
+  out.reserve(utfstring.size());
+  constexpr qsizetype kMaxTag = 7;  // longer tags are cut short
+  char16_t tag[kMaxTag + 1];
+  qsizetype taglen = 0;
+
+  auto tag_is = [&tag, &taglen](const char* s)->bool {
+    qsizetype i = 0;
+    for (; s[i]; ++i) {
+      if ((i >= taglen) || (tag[i] != static_cast<unsigned char>(s[i]))) {
+        return false;
+      }
+    }
+    return i == taglen;
+  };
+  auto tag_starts = [&tag, &taglen](const char* s)->bool {
+    for (qsizetype i = 0; s[i]; ++i) {
+      if ((i >= taglen) || (tag[i] != static_cast<unsigned char>(s[i]))) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  const QChar* in = utfstring.constData();
+  const QChar* const end = in + utfstring.size();
   tag[0] = 0;
-  while (*instr) {
-    if ((*instr == '<') || (*instr == '&')) {
-      tag[0] = *instr;
+  /* Like the C string this once was, stop at a NUL. */
+  while ((in < end) && (*in != QChar::Null)) {
+    const QChar c = *in;
+    if ((c == '<') || (c == '&')) {
+      tag[0] = c.unicode();
       taglen = 0;
     }
 
     if (! tag[0]) {
-      if (*instr == '\n') {
-        *out++ = ' ';
+      if (c == '\n') {
+        out.append(' ');
         do {
-          instr++;
-        } while (isspace(*instr));
+          ++in;
+        } while ((in < end) && is_space(*in));
         continue;
-      } else {
-        *out++ = *instr;
       }
-    } else {
-      if (taglen < (sizeof(tag)-1)) {
-        tag[taglen++] = tolower(*instr);
-        tag[taglen] = 0;
+      out.append(c);
+    } else if (taglen < kMaxTag) {
+      char16_t u = c.unicode();
+      if ((u >= 'A') && (u <= 'Z')) {
+        u += 'a' - 'A';
       }
+      tag[taglen++] = u;
+      tag[taglen] = 0;
     }
 
-    if (((tag[0] == '<') && (*instr == '>')) ||
-        ((tag[0] == '&') && (*instr == ';'))) {
-      if (! strcmp(tag, "&amp;")) {
-        *out++ = '&';
-      } else if (! strcmp(tag, "&lt;")) {
-        *out++ = '<';
-      } else if (! strcmp(tag, "&gt;")) {
-        *out++ = '>';
-      } else if (! strcmp(tag, "&quot;")) {
-        *out++ = '"';
-      } else if (! strcmp(tag, "&nbsp;")) {
-        *out++ = ' ';
-      } else if (! strcmp(tag, "&deg;")) {
-        *out++ = 'd';
-        *out++ = 'e';
-        *out++ = 'g';
-      } else if ((tag[0]=='<') && (tag[1]=='p')) {
-        *out++ = '\n';
-      } else if ((tag[0]=='<') && (tag[1]=='b') && (tag[2]=='r')) {
-        *out++ = '\n';
-      } else if ((tag[0]=='<') && (tag[1]=='/') && (tag[2]=='t') && (tag[3]=='r')) {
-        *out++ = '\n';
-      } else if ((tag[0]=='<') && (tag[1]=='/') && (tag[2]=='t') && (tag[3]=='d')) {
-        *out++ = ' ';
-      } else if ((tag[0]=='<') && (tag[1]=='i') && (tag[2]=='m') && (tag[3]=='g')) {
-        *out++ = '[';
-        *out++ = 'I';
-        *out++ = 'M';
-        *out++ = 'G';
-        *out++ = ']';
+    if (((tag[0] == '<') && (c == '>')) ||
+        ((tag[0] == '&') && (c == ';'))) {
+      if (tag_is("&amp;")) {
+        out.append('&');
+      } else if (tag_is("&lt;")) {
+        out.append('<');
+      } else if (tag_is("&gt;")) {
+        out.append('>');
+      } else if (tag_is("&quot;")) {
+        out.append('"');
+      } else if (tag_is("&nbsp;")) {
+        out.append(' ');
+      } else if (tag_is("&deg;")) {
+        out.append(QLatin1String("deg"));
+      } else if (tag_starts("<p")) {
+        out.append('\n');
+      } else if (tag_starts("<br")) {
+        out.append('\n');
+      } else if (tag_starts("</tr")) {
+        out.append('\n');
+      } else if (tag_starts("</td")) {
+        out.append(' ');
+      } else if (tag_starts("<img")) {
+        out.append(QLatin1String("[IMG]"));
       }
 
       tag[0] = 0;
     }
-    instr++;
+    ++in;
   }
-  *out++ = 0;
-  xfree(incopy);
-  QString rv(outstring);
-  xfree(outstring);
-  return rv;
+  return out;
 #endif
 }
 
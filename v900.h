@@ -58,6 +58,10 @@ public:
   void rd_init(const QString& fname) override;
   void read() override;
   void rd_deinit() override;
+  bool rd_can_run_concurrently() const override
+  {
+    return true;
+  }
 
 private:
   /* Types */
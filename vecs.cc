@@ -27,6 +27,9 @@
 #include <QDir>                // for QDir, QDir::Files, QDir::Name
 #include <QFileInfo>           // for QFileInfo
 #include <QFileInfoList>       // for QFileInfoList
+#include <QJsonArray>          // for QJsonArray
+#include <QJsonDocument>       // for QJsonDocument, QJsonDocument::Compact
+#include <QJsonObject>         // for QJsonObject
 #include <QString>             // for QString
 #include <QStringList>         // for QStringList
 #include <QVector>             // for QVector
@@ -35,20 +38,23 @@
 
 #include <algorithm>           // for sort
 #include <cassert>             // for assert
-#include <cstdio>              // for printf, putchar, sscanf
+#include <cstdio>              // for printf, putchar, fputs, stdout, sscanf
+#include <memory>              // for make_shared, unique_ptr
 #include <type_traits>         // for is_base_of
 #include <utility>             // for as_const
 
 #include "defs.h"              // for arglist_t, ff_vecs_t, ff_cap, fatal, CSTR, ARGTYPE_TYPEMASK, case_ignore_strcmp, global_options, global_opts, warning, xfree, ARGTYPE_BOOL, ff_cap_read, ff_cap_write, ARGTYPE_HIDDEN, ff_type_internal, xstrdup, ARGTYPE_INT, ARGTYPE_REQUIRED, ARGTYPE_FLOAT
 #include "dg-100.h"            // for Dg100FileFormat, Dg100SerialFormat, Dg200FileFormat, Dg200SerialFormat
 #include "exif.h"              // for ExifFormat
+#include "flatgeobuf.h"        // for FlatgeobufFormat
 #include "format.h"            // for Format
 #include "garmin.h"            // for GarminFormat
 #include "garmin_fit.h"        // for GarminFitFormat
 #include "garmin_gpi.h"        // for GarminGPIFormat
 #include "garmin_txt.h"        // for GarminTxtFormat
 #include "garmin_xt.h"         // for GarminXTFormat
-#include "gbversion.h"         // for WEB_DOC_DIR
+#include "gbcache.h"           // for GbcacheFormat
+#include "gbversion.h"         // for WEB_DOC_DIR, VERSION, kVersionSHA
 #include "gdb.h"               // for GdbFormat
 #include "geojson.h"           // for GeoJsonFormat
 #include "globalsat_sport.h"   // for GlobalsatSportFormat
@@ -63,6 +69,7 @@
 #include "kml.h"               // for KmlFormat
 #include "lowranceusr.h"       // for LowranceusrFormat
 #include "mtk_logger.h"        // for MtkFormat, MtkM241Format, MtkFileFormat, MtkM241FileFormat
+#include "mvt.h"               // for MvtFormat
 #include "nmea.h"              // for NmeaFormat
 #include "osm.h"               // for OsmFormat
 #include "ozi.h"               // for OziFormat
@@ -92,59 +99,74 @@ Format* fmtfactory(const QString& filename)
 }
 
 struct Vecs::Impl {
+  template <typename T>
+  class Lazy : public LazyFormat
+  {
+    static_assert(std::is_base_of<Format, T>::value, "T must be derived from Format");
+
+    Format* construct() const override
+    {
+      return new T;
+    }
+  };
+
   /*
    * Having these LegacyFormat instances be non-static data members
    * prevents the static initialization order fiasco because
    * the static vec that is used to construct a legacy format
    * instance is guaranteed to have already constructed when an instance
-   * of this class is constructed.
+   * of this class is constructed.  They are only constructed when first
+   * used, as most runs use just one or two of them.
    */
-  GpxFormat gpx_fmt;
-  GarminFormat garmin_fmt;
-  GdbFormat gdb_fmt;
-  NmeaFormat nmea_fmt;
-  OziFormat ozi_fmt;
-  KmlFormat kml_fmt;
+  Lazy<GpxFormat> gpx_fmt;
+  Lazy<GarminFormat> garmin_fmt;
+  Lazy<GdbFormat> gdb_fmt;
+  Lazy<NmeaFormat> nmea_fmt;
+  Lazy<OziFormat> ozi_fmt;
+  Lazy<KmlFormat> kml_fmt;
+  Lazy<GbcacheFormat> gbcache_fmt;
 #if MAXIMAL_ENABLED
-  LowranceusrFormat lowranceusr_fmt;
-  Tpo2Format tpo2_fmt;
-  Tpo3Format tpo3_fmt;
+  Lazy<LowranceusrFormat> lowranceusr_fmt;
+  Lazy<Tpo2Format> tpo2_fmt;
+  Lazy<Tpo3Format> tpo3_fmt;
 #if SHAPELIB_ENABLED
-  ShapeFormat shape_fmt;
+  Lazy<ShapeFormat> shape_fmt;
 #endif
-  TextFormat text_fmt;
-  HtmlFormat html_fmt;
-  IgcFormat igc_fmt;
-  MtkFormat mtk_fmt;
-  MtkFileFormat mtk_ffmt;
-  MtkM241Format mtk_m241_fmt;
-  MtkM241FileFormat mtk_m241_ffmt;
+  Lazy<TextFormat> text_fmt;
+  Lazy<HtmlFormat> html_fmt;
+  Lazy<IgcFormat> igc_fmt;
+  Lazy<MtkFormat> mtk_fmt;
+  Lazy<MtkFileFormat> mtk_ffmt;
+  Lazy<MtkM241Format> mtk_m241_fmt;
+  Lazy<MtkM241FileFormat> mtk_m241_ffmt;
 #endif // MAXIMAL_ENABLED
 #if MAXIMAL_ENABLED
-  UnicsvFormat unicsv_fmt;
-  GtmFormat gtm_fmt;
+  Lazy<UnicsvFormat> unicsv_fmt;
+  Lazy<GtmFormat> gtm_fmt;
 #if CSVFMTS_ENABLED
-  GarminTxtFormat garmin_txt_fmt;
+  Lazy<GarminTxtFormat> garmin_txt_fmt;
 #endif // CSVFMTS_ENABLED
-  GtrnctrFormat gtc_fmt;
-  GarminGPIFormat garmin_gpi_fmt;
-  RandomFormat random_fmt;
-  Dg100SerialFormat dg100_fmt;
-  Dg100FileFormat dg100_ffmt;
-  Dg200SerialFormat dg200_fmt;
-  Dg200FileFormat dg200_ffmt;
-  OsmFormat osm_fmt;
-  ExifFormat exif_fmt;
-  HumminbirdFormat humminbird_fmt;
-  HumminbirdHTFormat humminbird_ht_fmt;
-  SkytraqFormat skytraq_fmt;
-  SkytraqfileFormat skytraq_ffmt;
-  MinihomerFormat miniHomer_fmt;
-  SubripFormat subrip_fmt;
-  GarminXTFormat format_garmin_xt_fmt;
-  GarminFitFormat format_fit_fmt;
-  GeoJsonFormat geojson_fmt;
-  GlobalsatSportFormat globalsat_sport_fmt;
+  Lazy<GtrnctrFormat> gtc_fmt;
+  Lazy<GarminGPIFormat> garmin_gpi_fmt;
+  Lazy<RandomFormat> random_fmt;
+  Lazy<Dg100SerialFormat> dg100_fmt;
+  Lazy<Dg100FileFormat> dg100_ffmt;
+  Lazy<Dg200SerialFormat> dg200_fmt;
+  Lazy<Dg200FileFormat> dg200_ffmt;
+  Lazy<OsmFormat> osm_fmt;
+  Lazy<ExifFormat> exif_fmt;
+  Lazy<HumminbirdFormat> humminbird_fmt;
+  Lazy<HumminbirdHTFormat> humminbird_ht_fmt;
+  Lazy<SkytraqFormat> skytraq_fmt;
+  Lazy<SkytraqfileFormat> skytraq_ffmt;
+  Lazy<MinihomerFormat> miniHomer_fmt;
+  Lazy<SubripFormat> subrip_fmt;
+  Lazy<GarminXTFormat> format_garmin_xt_fmt;
+  Lazy<GarminFitFormat> format_fit_fmt;
+  Lazy<GeoJsonFormat> geojson_fmt;
+  Lazy<FlatgeobufFormat> flatgeobuf_fmt;
+  Lazy<MvtFormat> mvt_fmt;
+  Lazy<GlobalsatSportFormat> globalsat_sport_fmt;
 #endif // MAXIMAL_ENABLED
 
   const QVector<vecs_t> vec_list {
@@ -209,6 +231,13 @@ struct Vecs::Impl {
       "kml",
       nullptr,
     },
+    {
+      &gbcache_fmt,
+      "gbcache",
+      "GPSBabel binary cache",
+      "gbc",
+      nullptr,
+    },
 #if MAXIMAL_ENABLED
     {
       &lowranceusr_fmt,
@@ -464,6 +493,20 @@ struct Vecs::Impl {
       "json",
       nullptr,
     },
+    {
+      &flatgeobuf_fmt,
+      "flatgeobuf",
+      "FlatGeobuf",
+      "fgb",
+      nullptr,
+    },
+    {
+      &mvt_fmt,
+      "mvt",
+      "Mapbox Vector Tiles directory",
+      nullptr,
+      nullptr,
+    },
     {
       &globalsat_sport_fmt,
       "globalsat",
@@ -529,13 +572,17 @@ void Vecs::init_vec(Format* fmt)
   }
 }
 
-void Vecs::init_vecs()
+Format* Vecs::LazyFormat::get()
 {
-  for (const auto& vec : d_ptr_->vec_list) {
-    if (vec.vec != nullptr) {
-      init_vec(vec.vec);
-    }
+  if (fmt_ == nullptr) {
+    fmt_.reset(construct());
+    init_vec(fmt_.get());
   }
+  return fmt_.get();
+}
+
+void Vecs::init_vecs()
+{
   style_list = create_style_vec();
 }
 
@@ -621,8 +668,8 @@ void Vecs::exit_vec(Format* fmt)
 void Vecs::exit_vecs()
 {
   for (const auto& vec : d_ptr_->vec_list) {
-    if (vec.vec != nullptr) {
-      exit_vec(vec.vec);
+    if ((vec.vec != nullptr) && (vec.vec->get_if_constructed() != nullptr)) {
+      exit_vec(vec.vec->get_if_constructed());
     }
   }
   style_list.clear();
@@ -630,21 +677,22 @@ void Vecs::exit_vecs()
 }
 
 void Vecs::assign_option(const QString& module, arglist_t* arg, const QString& val)
+{
+  set_option(arg, convert_option(module, arg, val));
+}
+
+/*
+ * The value val assigns to arg, checked and in its canonical form, or a
+ * null string if it leaves arg unset.
+ */
+QString Vecs::convert_option(const QString& module, const arglist_t* arg, const QString& val)
 {
   if (arg->argval == nullptr) {
     fatal("%s: No local variable defined for option \"%s\"!\n", qPrintable(module), qPrintable(arg->argstring));
   }
 
-  if (arg->argvalptr != nullptr) {
-    xfree(arg->argvalptr);
-    arg->argvalptr = nullptr;
-  }
-  if (arg->argval) {
-    *arg->argval = nullptr;
-  }
-
   if (val.isNull()) {
-    return;
+    return QString();
   }
 
   QString rval(val);
@@ -697,9 +745,25 @@ void Vecs::assign_option(const QString& module, arglist_t* arg, const QString& v
 
   if (((arg->argtype & ARGTYPE_TYPEMASK) == ARGTYPE_BOOL) &&
       rval.startsWith('0') && (arg->defaultvalue == nullptr)) {
-    return;
+    return QString();
+  }
+  return rval;
+}
+
+/* Assigns a value from convert_option(). */
+void Vecs::set_option(arglist_t* arg, const QString& converted)
+{
+  if (arg->argvalptr != nullptr) {
+    xfree(arg->argvalptr);
+    arg->argvalptr = nullptr;
+  }
+  if (arg->argval) {
+    *arg->argval = nullptr;
+  }
+
+  if (!converted.isNull()) {
+    *arg->argval = arg->argvalptr = xstrdup(converted);
   }
-  *arg->argval = arg->argvalptr = xstrdup(rval);
 }
 
 void Vecs::disp_vec_options(const QString& vecname, const QVector<arglist_t>* args)
@@ -737,19 +801,22 @@ void Vecs::validate_options(const QStringList& options, const QVector<arglist_t>
   }
 }
 
-void Vecs::prepare_format(const fmtinfo_t& fmtdata)
+/*
+ * The converted value of every argument: the one given in the options,
+ * else the one of the inifile, else the default.
+ */
+QVector<QString> Vecs::resolve_options(const fmtinfo_t& fmtdata, const QVector<arglist_t>* args)
 {
-  QVector<arglist_t>* args = fmtdata->get_args();
-
   validate_options(fmtdata.options, args, fmtdata.fmtname);
 
+  QVector<QString> values;
   if (args && !args->isEmpty()) {
-    assert(args->isDetached());
-    for (auto& arg : *args) {
+    values.reserve(args->size());
+    for (const auto& arg : *args) {
       if (!fmtdata.options.isEmpty()) {
         const QString opt = get_option(fmtdata.options, arg.argstring);
         if (!opt.isNull()) {
-          assign_option(fmtdata.fmtname, &arg, opt);
+          values.append(convert_option(fmtdata.fmtname, &arg, opt));
           continue;
         }
       }
@@ -758,12 +825,27 @@ void Vecs::prepare_format(const fmtinfo_t& fmtdata)
         qopt = inifile_readstr(global_opts.inifile, "Common format settings", arg.argstring);
       }
       if (qopt.isNull()) {
-        assign_option(fmtdata.fmtname, &arg, arg.defaultvalue);
+        values.append(convert_option(fmtdata.fmtname, &arg, arg.defaultvalue));
       } else {
-        assign_option(fmtdata.fmtname, &arg, qopt);
+        values.append(convert_option(fmtdata.fmtname, &arg, qopt));
       }
     }
   }
+  return values;
+}
+
+void Vecs::prepare_format(const fmtinfo_t& fmtdata)
+{
+  QVector<arglist_t>* args = fmtdata->get_args();
+
+  const QVector<QString> values = fmtdata.resolved_options ?
+                                  *fmtdata.resolved_options : resolve_options(fmtdata, args);
+  if (args && !args->isEmpty()) {
+    assert(args->isDetached());
+    for (qsizetype i = 0; i < args->size(); ++i) {
+      set_option(&(*args)[i], values.at(i));
+    }
+  }
 
   if (global_opts.debug_level >= 1) {
     disp_vec_options(fmtdata.fmtname, args);
@@ -778,9 +860,44 @@ void Vecs::prepare_format(const fmtinfo_t& fmtdata)
    */
   auto* xcsvfmt = dynamic_cast<XcsvFormat*>(fmtdata.fmt);
   if (xcsvfmt != nullptr) {
-    xcsvfmt->xcsv_setup_internal_style(fmtdata.style_filename);
+    xcsvfmt->xcsv_setup_internal_style(fmtdata.style_filename, fmtdata.style);
+  }
+#endif // CSVFMTS_ENABLED
+}
+
+/*
+ * Does what prepare_format() would do for fmtdata ahead of time, so that
+ * it can be prepared many times without the cost: the options are
+ * checked, looked up in the inifile and converted, and the style of an
+ * xcsv format is read.  Later changes of the inifile are not seen.
+ */
+void Vecs::compile_format(fmtinfo_t& fmtdata)
+{
+  Format* fmt = fmtdata.isDynamic() ? fmtdata.factory(QString()) : fmtdata.fmt;
+  const QVector<arglist_t>* args = fmt->get_args();
+  auto values = std::make_shared<const QVector<QString>>(resolve_options(fmtdata, args));
+  fmtdata.resolved_options = values;
+  fmtdata.style.reset();
+
+#if CSVFMTS_ENABLED
+  if (dynamic_cast<XcsvFormat*>(fmt) != nullptr) {
+    QString style_filename = fmtdata.style_filename;
+    if (style_filename.isEmpty() && (args != nullptr)) {
+      for (qsizetype i = 0; i < args->size(); ++i) {
+        if (args->at(i).argstring == QLatin1String("style")) {
+          style_filename = values->at(i);
+        }
+      }
+    }
+    if (!style_filename.isEmpty()) {
+      fmtdata.style = std::make_shared<const XcsvStyle>(XcsvStyle::xcsv_read_style(style_filename));
+    }
   }
 #endif // CSVFMTS_ENABLED
+
+  if (fmtdata.isDynamic()) {
+    delete fmt;
+  }
 }
 
 Vecs::fmtinfo_t Vecs::find_vec(const QString& fmtargstring)
@@ -796,7 +913,7 @@ Vecs::fmtinfo_t Vecs::find_vec(const QString& fmtargstring)
       continue;
     }
 
-    return {vec.vec, vec.name, nullptr, options, vec.factory};
+    return {(vec.vec != nullptr)? vec.vec->get() : nullptr, vec.name, nullptr, options, vec.factory, nullptr, nullptr};
   }
 
   /*
@@ -808,7 +925,8 @@ Vecs::fmtinfo_t Vecs::find_vec(const QString& fmtargstring)
       continue;
     }
 
-    return {d_ptr_->vec_list.at(0).vec, svec.name, svec.style_filename, options, d_ptr_->vec_list.at(0).factory};
+    const vecs_t& xcsv = d_ptr_->vec_list.at(0);
+    return {(xcsv.vec != nullptr)? xcsv.vec->get() : nullptr, svec.name, svec.style_filename, options, xcsv.factory, nullptr, nullptr};
   }
 
   /*
@@ -885,7 +1003,7 @@ QVector<Vecs::vecinfo_t> Vecs::sort_and_unify_vecs() const
 
   /* Gather relevant information for normal formats. */
   for (const auto& vec : d_ptr_->vec_list) {
-    Format* fmt = (vec.factory != nullptr)? vec.factory("") : vec.vec;
+    Format* fmt = (vec.factory != nullptr)? vec.factory("") : vec.vec->get();
     vecinfo_t info;
     info.name = vec.name;
     info.desc = vec.desc;
@@ -915,7 +1033,7 @@ QVector<Vecs::vecinfo_t> Vecs::sort_and_unify_vecs() const
    */
   assert(d_ptr_->vec_list.at(0).name.compare("xcsv", Qt::CaseInsensitive) == 0);
 
-  Format* xcsvfmt = (d_ptr_->vec_list.at(0).factory != nullptr)? d_ptr_->vec_list.at(0).factory("") : d_ptr_->vec_list.at(0).vec;
+  Format* xcsvfmt = (d_ptr_->vec_list.at(0).factory != nullptr)? d_ptr_->vec_list.at(0).factory("") : d_ptr_->vec_list.at(0).vec->get();
   /* The style formats use a modified xcsv argument list that doesn't include
    * the option to set the style file.  Make sure we know which entry in
    * the argument list that is.
@@ -1011,29 +1129,27 @@ void Vecs::disp_vec(const QString& vecname) const
   }
 }
 
-/*
- * Additional information for V1.
- * Output format type at front of line.
- */
-void Vecs::disp_v1(ff_type t)
+QString Vecs::type_name(ff_type t)
 {
-  const char* tstring;
-
   switch (t) {
   case ff_type_file:
-    tstring = "file";
-    break;
+    return "file";
   case ff_type_serial:
-    tstring = "serial";
-    break;
+    return "serial";
   case ff_type_internal:
-    tstring = "internal";
-    break;
+    return "internal";
   default:
-    tstring = "unknown";
-    break;
+    return "unknown";
   }
-  printf("%s\t", tstring);
+}
+
+/*
+ * Additional information for V1.
+ * Output format type at front of line.
+ */
+void Vecs::disp_v1(ff_type t)
+{
+  printf("%s\t", CSTR(type_name(t)));
 }
 
 void Vecs::disp_v2(const vecinfo_t& v)
@@ -1063,13 +1179,18 @@ const char* Vecs::name_option(uint32_t type)
   return at[0];
 }
 
-void Vecs::disp_help_url(const vecinfo_t& vec, const QString& argstring)
+QString Vecs::help_url(const vecinfo_t& vec, const QString& argstring)
 {
-  printf("\t" WEB_DOC_DIR "/fmt_%s.html", CSTR(vec.name));
+  QString url = QStringLiteral(WEB_DOC_DIR "/fmt_%1.html").arg(vec.name);
   if (!argstring.isEmpty()) {
-    printf("#fmt_%s_o_%s", CSTR(vec.name), CSTR(argstring));
+    url += QStringLiteral("#fmt_%1_o_%2").arg(vec.name, argstring);
   }
-  printf("\n");
+  return url;
+}
+
+void Vecs::disp_help_url(const vecinfo_t& vec, const QString& argstring)
+{
+  printf("\t%s\n", CSTR(help_url(vec, argstring)));
 }
 
 
@@ -1093,6 +1214,57 @@ void Vecs::disp_v3(const vecinfo_t& vec)
   }
 }
 
+/*
+ * Version 4 has what version 3 has, as a single line of JSON: an object
+ * with the catalog version, the gpsbabel version and build, and an
+ * array of the formats, each with its array of options.  Hidden options
+ * are left out.
+ */
+void Vecs::disp_v4(const QVector<vecinfo_t>& svp)
+{
+  QJsonArray formats;
+  for (const auto& vec : svp) {
+    QJsonArray options;
+    for (const auto& arg : vec.arginfo) {
+      if (!(arg.argtype & ARGTYPE_HIDDEN)) {
+        options.append(QJsonObject{
+          {"name", arg.argstring},
+          {"description", arg.helpstring},
+          {"type", name_option(arg.argtype)},
+          {"default", arg.defaultvalue},
+          {"min", arg.minvalue},
+          {"max", arg.maxvalue},
+          {"url", help_url(vec, arg.argstring)}
+        });
+      }
+    }
+    QString caps;
+    for (const auto& i : vec.cap) {
+      caps.append((i & ff_cap_read) ? 'r' : '-');
+      caps.append((i & ff_cap_write) ? 'w' : '-');
+    }
+    formats.append(QJsonObject{
+      {"type", type_name(vec.type)},
+      {"caps", caps},
+      {"name", vec.name},
+      {"extensions", QJsonArray::fromStringList(vec.extensions.split('/', Qt::SkipEmptyParts))},
+      {"description", vec.desc},
+      {"parent", vec.parent},
+      {"url", help_url(vec, QString())},
+      {"options", options}
+    });
+  }
+
+  const QJsonObject catalog{
+    {"version", 1},
+    {"gpsbabel", VERSION},
+    {"build", kVersionSHA},
+    {"formats", formats}
+  };
+  fputs(QJsonDocument(catalog).toJson(QJsonDocument::Compact).constData(), stdout);
+  putchar('\n');
+}
+
 /*
  *  Display the available formats in a format that's easy to machine
  *  parse.   Typically invoked by programs like graphical wrappers to
@@ -1130,6 +1302,9 @@ void Vecs::disp_formats(int version) const
       }
     }
     break;
+  case 4:
+    disp_v4(svp);
+    break;
   default:
     ;
   }
@@ -1203,7 +1378,7 @@ bool Vecs::validate_args(const QString& name, const QVector<arglist_t>* args)
 
 bool Vecs::validate_vec(const vecs_t& vec)
 {
-  Format* fmt = (vec.factory != nullptr)? vec.factory("") : vec.vec;
+  Format* fmt = (vec.factory != nullptr)? vec.factory("") : vec.vec->get();
   bool ok = validate_args(vec.name, fmt->get_args());
   if (vec.factory != nullptr) {
     delete fmt;
@@ -22,6 +22,7 @@
 #define VECS_H_INCLUDED_
 
 #include <cstdint>      // for uint32_t
+#include <memory>       // for shared_ptr, unique_ptr
 
 #include <QList>        // for QList
 #include <QString>      // for QString
@@ -31,6 +32,8 @@
 #include "defs.h"
 #include "format.h"
 
+class XcsvStyle;
+
 
 class Vecs
 {
@@ -59,6 +62,10 @@ public:
     QString style_filename;
     QStringList options;
     FormatFactory factory{nullptr};
+    // Set by compile_format(): the converted value of every option, in
+    // the order of the format's arguments, and the style of xcsv formats.
+    std::shared_ptr<const QVector<QString>> resolved_options;
+    std::shared_ptr<const XcsvStyle> style;
   };
 
   /* Special Member Functions */
@@ -77,10 +84,13 @@ public:
   static void exit_vec(Format* fmt);
   void exit_vecs();
   static void assign_option(const QString& module, arglist_t* arg, const QString& val);
+  static QString convert_option(const QString& module, const arglist_t* arg, const QString& val);
+  static void set_option(arglist_t* arg, const QString& converted);
   static void disp_vec_options(const QString& vecname, const QVector<arglist_t>* args);
   static void validate_options(const QStringList& options, const QVector<arglist_t>* args, const QString& name);
   static QString get_option(const QStringList& options, const QString& argname);
   static void prepare_format(const fmtinfo_t& data);
+  static void compile_format(fmtinfo_t& data);
   fmtinfo_t find_vec(const QString& fmtargstring);
   void disp_vec(const QString& vecname = QString()) const;
   static const char* name_option(uint32_t type);
@@ -93,8 +103,34 @@ private:
 
   struct Impl;                   // Not defined here
 
+  /*
+   * The formats without a factory have a single instance that lives for
+   * the rest of the run once it has been constructed, which happens the
+   * first time it is asked for.
+   */
+  class LazyFormat
+  {
+  public:
+    LazyFormat() = default;
+    virtual ~LazyFormat() = default;
+    LazyFormat(const LazyFormat&) = delete;
+    LazyFormat& operator=(const LazyFormat&) = delete;
+    LazyFormat(LazyFormat&&) = delete;
+    LazyFormat& operator=(LazyFormat&&) = delete;
+
+    Format* get();
+    Format* get_if_constructed() const {
+      return fmt_.get();
+    }
+
+  private:
+    virtual Format* construct() const = 0;
+
+    std::unique_ptr<Format> fmt_;
+  };
+
   struct vecs_t {
-    Format* vec;
+    LazyFormat* vec;
     QString name;
     QString desc;
     QString extensions; // list of possible extensions separated by '/', first is output default for GUI.
@@ -146,12 +182,16 @@ private:
   static bool is_integer(const QString& val);
   static bool is_float(const QString& val);
   static bool is_bool(const QString& val);
+  static QVector<QString> resolve_options(const fmtinfo_t& fmtdata, const QVector<arglist_t>* args);
   static QVector<style_vec_t> create_style_vec();
   QVector<vecinfo_t> sort_and_unify_vecs() const;
+  static QString type_name(ff_type t);
   static void disp_v1(ff_type t);
   static void disp_v2(const vecinfo_t& v);
+  static QString help_url(const vecinfo_t& vec, const QString& argstring);
   static void disp_help_url(const vecinfo_t& vec, const QString& argstring);
   static void disp_v3(const vecinfo_t& vec);
+  static void disp_v4(const QVector<vecinfo_t>& svp);
   static bool validate_vec(const vecs_t& vec);
 
   /* Data Members */
@@ -19,20 +19,25 @@
 
  */
 
+#include <algorithm>            // for copy, find_if, max, min
 #include <cassert>              // for assert
+#include <charconv>             // for to_chars
 #include <cmath>                // for fabs
+#include <cstddef>              // for size_t
 #include <cstdio>               // for fflush, fprintf, stdout
-#include <utility>              // for as_const
+#include <utility>              // for as_const, exchange, move
 
 #include <QChar>                // for QChar
 #include <QDateTime>            // for QDateTime
 #include <QDebug>               // for QDebug
 #include <QLatin1Char>          // for QLatin1Char
+#include <QLatin1String>        // for QLatin1String
 #include <QList>                // for QList<>::const_iterator
 #include <QString>              // for QString, operator==
 #include <QStringLiteral>       // for qMakeStringPrivate, QStringLiteral
 #include <QStringView>          // for QStringView
 #include <QTime>                // for QTime
+#include <QVector>              // for QVector
 #include <QtGlobal>             // for QForeachContainer, qMakeForeachContainer, foreach, qint64
 
 #include "defs.h"
@@ -41,13 +46,25 @@
 #include "geocache.h"           // for Geocache
 #include "grtcirc.h"            // for RAD, gcdist, heading_true_degrees, radtometers
 #include "session.h"            // for curr_session, session_t
+#include "src/core/budget.h"    // for Budget
+#include "src/core/counters.h"  // for Counter
 #include "src/core/datetime.h"  // for DateTime
+#include "src/core/footprint.h" // for heap_bytes
 #include "src/core/logging.h"   // for FatalMsg
+#include "src/core/objectpool.h" // for ObjectPool
+#include "src/core/progress.h"  // for Progress
+#include "src/core/trace.h"     // for TraceSpan
 
 
-WaypointList* global_waypoint_list;
+// Thread local so that readers on worker threads can be given their own list.
+thread_local WaypointList* global_waypoint_list;
+static PointSink* point_sink = nullptr;
+
+static gpsbabel::Counter copy_counter("waypoint.copies");
+static gpsbabel::Counter deleted_counter("waypoint.deleted");
 
 Geocache Waypoint::empty_gc_data;
+const UrlList Waypoint::empty_urls;
 
 void
 waypt_init()
@@ -58,7 +75,45 @@ waypt_init()
 void
 waypt_add(Waypoint* wpt)
 {
+  gpsbabel::Progress::points();
+  gpsbabel::Budget::check();
   global_waypoint_list->waypt_add(wpt);
+  if (point_sink != nullptr) {
+    // The list was only used to fill in any missing fields.
+    global_waypoint_list->waypt_del(wpt);
+    if (global_opts.masked_objective & WPTDATAMASK) {
+      point_sink->consume(wpt);
+    } else {
+      delete wpt;
+    }
+  }
+}
+
+void
+waypt_reserve(qsizetype count)
+{
+  // Streamed waypoints never stay in the list.
+  if (point_sink == nullptr) {
+    global_waypoint_list->reserve_more(count);
+  }
+}
+
+void
+waypt_use_list(WaypointList* list)
+{
+  global_waypoint_list = list;
+}
+
+void
+waypt_set_sink(PointSink* sink)
+{
+  point_sink = sink;
+}
+
+PointSink*
+waypt_sink()
+{
+  return point_sink;
 }
 
 void
@@ -82,8 +137,19 @@ waypt_count()
 void
 waypt_status_disp(int total_ct, int myct)
 {
-  fprintf(stdout, "%d/%d/%d\r", myct*100/total_ct, myct, total_ct);
-  fflush(stdout);
+  gpsbabel::Progress::step(myct, total_ct);
+
+  /*
+   * Only redraw the terminal line when the percentage moves; transfers
+   * call this for every point and a flush per point is not free.
+   */
+  static thread_local int last_percent = -1;
+  int percent = myct * 100 / total_ct;
+  if ((percent != last_percent) || (myct >= total_ct)) {
+    last_percent = (myct >= total_ct) ? -1 : percent;
+    fprintf(stdout, "%d/%d/%d\r", percent, myct, total_ct);
+    fflush(stdout);
+  }
 }
 
 void
@@ -133,6 +199,32 @@ waypt_add_to_bounds(bounds* bounds, const Waypoint* waypointp)
   }
 }
 
+/*
+ * Widen dst to take in src, as if the points src was computed from had
+ * been added to dst one by one.
+ */
+void
+waypt_merge_bounds(bounds* dst, const bounds& src)
+{
+  if (src.max_lat > dst->max_lat) {
+    dst->max_lat = src.max_lat;
+  }
+  if (src.max_lon > dst->max_lon) {
+    dst->max_lon = src.max_lon;
+  }
+  if (src.min_lat < dst->min_lat) {
+    dst->min_lat = src.min_lat;
+  }
+  if (src.min_lon < dst->min_lon) {
+    dst->min_lon = src.min_lon;
+  }
+  if (src.min_alt < dst->min_alt) {
+    dst->min_alt = src.min_alt;
+  }
+  if (src.max_alt > dst->max_alt) {
+    dst->max_alt = src.max_alt;
+  }
+}
 
 /*
  *  Makes another pass over the data to compute bounding
@@ -188,6 +280,18 @@ waypt_swap(WaypointList& other)
   global_waypoint_list->swap(other);
 }
 
+void
+waypt_splice(WaypointList* src)
+{
+  global_waypoint_list->splice(*src);
+}
+
+void
+waypt_reorder(const QVector<Waypoint*>& order)
+{
+  global_waypoint_list->reorder(order);
+}
+
 void
 waypt_add_url(Waypoint* wpt, const QString& link, const QString& url_link_text)
 {
@@ -363,12 +467,8 @@ waypt_course(const Waypoint* A, const Waypoint* B)
 }
 
 Waypoint::Waypoint() :
-  geoidheight(0),
-  depth(0),
-  proximity(0),
   course(0),
   speed(0),
-  temperature(0),
   latitude(0),  // These should probably use some invalid data, but
   longitude(0), // it looks like we have code that relies on them being zero.
   altitude(unknown_alt),
@@ -389,27 +489,21 @@ Waypoint::Waypoint() :
 
 Waypoint::~Waypoint()
 {
-  if (gc_data != &Waypoint::empty_gc_data) {
-    delete gc_data;
-  }
+  ReleaseGCData();
   fs.FsChainDestroy();
 }
 
 Waypoint::Waypoint(const Waypoint& other) :
-  geoidheight(other.geoidheight),
-  depth(other.depth),
-  proximity(other.proximity),
   course(other.course),
   speed(other.speed),
-  temperature(other.temperature),
   opt_flags(other.opt_flags),
+  cold_data(other.cold_data),
   latitude(other.latitude),
   longitude(other.longitude),
   altitude(other.altitude),
   shortname(other.shortname),
   description(other.description),
   notes(other.notes),
-  urls(other.urls),
   icon_descr(other.icon_descr),
   creation_time(other.creation_time),
   wpt_flags(other.wpt_flags),
@@ -426,16 +520,17 @@ Waypoint::Waypoint(const Waypoint& other) :
   session(other.session),
   extra_data(other.extra_data)
 {
-  // deep copy geocache data unless it is the special static empty_gc_data.
-  if (other.gc_data != &Waypoint::empty_gc_data) {
-    gc_data = new Geocache(*other.gc_data);
+  // share geocache data unless it is the special static empty_gc_data.
+  if (gc_data != &Waypoint::empty_gc_data) {
+    gc_data->ref.ref();
   }
 
-  // deep copy fs chain data.
+  // share fs chain data, it is cloned when changed.
   fs = other.fs.FsChainCopy();
 
   // note: session is not deep copied.
   // note: extra_data is not deep copied.
+  copy_counter.add();
 }
 
 Waypoint& Waypoint::operator=(const Waypoint& rhs)
@@ -443,22 +538,18 @@ Waypoint& Waypoint::operator=(const Waypoint& rhs)
   if (this != &rhs) {
 
     // deallocate
-    if (gc_data != &Waypoint::empty_gc_data) {
-      delete gc_data;
-    }
+    ReleaseGCData();
     fs.FsChainDestroy();
 
     // allocate and copy
     latitude = rhs.latitude;
     longitude = rhs.longitude;
     altitude = rhs.altitude;
-    geoidheight = rhs.geoidheight;
-    depth = rhs.depth;
-    proximity = rhs.proximity;
+    opt_flags = rhs.opt_flags;
+    cold_data = rhs.cold_data;
     shortname = rhs.shortname;
     description = rhs.description;
     notes = rhs.notes;
-    urls = rhs.urls;
     wpt_flags = rhs.wpt_flags;
     icon_descr = rhs.icon_descr;
     creation_time = rhs.creation_time;
@@ -472,42 +563,186 @@ Waypoint& Waypoint::operator=(const Waypoint& rhs)
     heartrate = rhs.heartrate;
     cadence = rhs.cadence;
     power = rhs.power;
-    temperature = rhs.temperature;
     odometer_distance = rhs.odometer_distance;
     gc_data = rhs.gc_data;
     session = rhs.session;
     extra_data = rhs.extra_data;
-    // deep copy geocache data unless it is the special static empty_gc_data.
-    if (rhs.gc_data != &Waypoint::empty_gc_data) {
-      gc_data = new Geocache(*rhs.gc_data);
+    // share geocache data unless it is the special static empty_gc_data.
+    if (gc_data != &Waypoint::empty_gc_data) {
+      gc_data->ref.ref();
     }
 
-    // deep copy fs chain data.
+    // share fs chain data, it is cloned when changed.
     fs = rhs.fs.FsChainCopy();
 
     // note: session is not deep copied.
     // note: extra_data is not deep copied.
+    copy_counter.add();
   }
 
   return *this;
 }
 
+Waypoint::Waypoint(Waypoint&& other) noexcept :
+  course(other.course),
+  speed(other.speed),
+  opt_flags(std::exchange(other.opt_flags, op_flags())),
+  cold_data(std::move(other.cold_data)),
+  latitude(other.latitude),
+  longitude(other.longitude),
+  altitude(other.altitude),
+  shortname(std::move(other.shortname)),
+  description(std::move(other.description)),
+  notes(std::move(other.notes)),
+  icon_descr(std::move(other.icon_descr)),
+  creation_time(std::move(other.creation_time)),
+  wpt_flags(other.wpt_flags),
+  hdop(other.hdop),
+  vdop(other.vdop),
+  pdop(other.pdop),
+  fix(other.fix),
+  sat(other.sat),
+  heartrate(other.heartrate),
+  cadence(other.cadence),
+  power(other.power),
+  odometer_distance(other.odometer_distance),
+  // take over the geocache data and the fs chain, leaving other with none.
+  gc_data(std::exchange(other.gc_data, &Waypoint::empty_gc_data)),
+  fs(std::exchange(other.fs, FormatSpecificDataList())),
+  session(other.session),
+  extra_data(other.extra_data)
+{
+}
+
+Waypoint& Waypoint::operator=(Waypoint&& rhs) noexcept
+{
+  if (this != &rhs) {
+
+    // deallocate
+    ReleaseGCData();
+    fs.FsChainDestroy();
+
+    // take over
+    latitude = rhs.latitude;
+    longitude = rhs.longitude;
+    altitude = rhs.altitude;
+    opt_flags = std::exchange(rhs.opt_flags, op_flags());
+    cold_data = std::move(rhs.cold_data);
+    shortname = std::move(rhs.shortname);
+    description = std::move(rhs.description);
+    notes = std::move(rhs.notes);
+    wpt_flags = rhs.wpt_flags;
+    icon_descr = std::move(rhs.icon_descr);
+    creation_time = std::move(rhs.creation_time);
+    hdop = rhs.hdop;
+    vdop = rhs.vdop;
+    pdop = rhs.pdop;
+    course = rhs.course;
+    speed = rhs.speed;
+    fix = rhs.fix;
+    sat = rhs.sat;
+    heartrate = rhs.heartrate;
+    cadence = rhs.cadence;
+    power = rhs.power;
+    odometer_distance = rhs.odometer_distance;
+    gc_data = std::exchange(rhs.gc_data, &Waypoint::empty_gc_data);
+    fs = std::exchange(rhs.fs, FormatSpecificDataList());
+    session = rhs.session;
+    extra_data = rhs.extra_data;
+  }
+
+  return *this;
+}
+
+void*
+Waypoint::operator new(std::size_t size)
+{
+  return pool().allocate(size);
+}
+
+void
+Waypoint::operator delete(void* ptr, std::size_t size) noexcept
+{
+  pool().deallocate(ptr, size);
+}
+
+gpsbabel::ObjectPool&
+Waypoint::pool()
+{
+  static gpsbabel::ObjectPool waypoint_pool(sizeof(Waypoint));
+  return waypoint_pool;
+}
+
+AllocationArena::AllocationArena()
+{
+  Waypoint::pool().acquire();
+  route_head::pool().acquire();
+}
+
+AllocationArena::~AllocationArena()
+{
+  route_head::pool().release();
+  Waypoint::pool().release();
+}
+
+Waypoint::ColdData*
+Waypoint::AllocColdData()
+{
+  if (!cold_data) {
+    cold_data = new ColdData;
+  }
+  return cold_data.data();  // detaches a shared record
+}
+
 bool
 Waypoint::HasUrlLink() const
 {
-  return urls.HasUrlLink();
+  return GetUrlList().HasUrlLink();
 }
 
 const UrlLink&
 Waypoint::GetUrlLink() const
 {
-  return urls.GetUrlLink();
+  return GetUrlList().GetUrlLink();
+}
+
+const UrlList&
+Waypoint::GetUrlList() const
+{
+  return cold_data? cold_data->urls : empty_urls;
+}
+
+/* The heap bytes of a list of URLs. */
+std::size_t
+url_list_heap_bytes(const UrlList& urls)
+{
+  std::size_t bytes = gpsbabel::heap_bytes(urls);
+  for (const auto& url : urls) {
+    bytes += gpsbabel::heap_bytes(url.url_) + gpsbabel::heap_bytes(url.url_link_text_) +
+             gpsbabel::heap_bytes(url.url_link_type_);
+  }
+  return bytes;
+}
+
+std::size_t
+Waypoint::memory_usage() const
+{
+  std::size_t bytes = sizeof(*this) + gpsbabel::heap_bytes(shortname) +
+                      gpsbabel::heap_bytes(description) + gpsbabel::heap_bytes(notes.utf8()) +
+                      gpsbabel::heap_bytes(icon_descr) + fs.memory_usage();
+  if (cold_data) {
+    bytes += sizeof(ColdData) + url_list_heap_bytes(cold_data->urls);
+  }
+  if (gc_data != &Waypoint::empty_gc_data) {
+    bytes += gc_data->memory_usage();
+  }
+  return bytes;
 }
 
 void
 Waypoint::AddUrlLink(const UrlLink& l)
 {
-  urls.AddUrlLink(l);
+  AllocColdData()->urls.AddUrlLink(l);
 }
 
 QString
@@ -541,7 +776,9 @@ Waypoint::SetCreationTime(const gpsbabel::DateTime& t)
 void
 Waypoint::SetCreationTime(qint64 t, qint64 ms)
 {
-  creation_time.setMSecsSinceEpoch((t * 1000) + ms);
+  // Build a fresh UTC time rather than inherit whatever time spec the
+  // previous value had; UTC is the compact representation.
+  creation_time = gpsbabel::DateTime::fromMSecsSinceEpochUtc((t * 1000) + ms);
 }
 
 Geocache*
@@ -549,10 +786,25 @@ Waypoint::AllocGCData()
 {
   if (gc_data == &Waypoint::empty_gc_data) {
     gc_data = new Geocache;
+    gc_data->ref.ref();
+  } else if (gc_data->ref.loadRelaxed() > 1) {
+    // Shared with a copy, so make our own before it is changed.
+    auto* own = new Geocache(*gc_data);
+    own->ref.ref();
+    gc_data->ref.deref();
+    gc_data = own;
   }
   return gc_data;
 }
 
+void
+Waypoint::ReleaseGCData()
+{
+  if ((gc_data != &Waypoint::empty_gc_data) && !gc_data->ref.deref()) {
+    delete gc_data;
+  }
+}
+
 int
 Waypoint::EmptyGCData() const
 {
@@ -635,6 +887,33 @@ WaypointList::waypt_add(Waypoint* wpt)
     }
   }
 
+  if (name_index_valid) {
+    index_name(wpt);
+  }
+}
+
+/*
+ * namepart followed by number zero padded to digits, as
+ * QStringLiteral("%1%2").arg(namepart).arg(number, digits, 10, QChar('0'))
+ * would give, built in one allocation.  Routes made from long tracks
+ * name every point this way.
+ */
+static QString synth_rte_name(QStringView namepart, int number, int digits)
+{
+  if ((number < 0) || (digits < 0)) {
+    return QStringLiteral("%1%2").arg(namepart).arg(number, digits, 10, QChar('0'));
+  }
+  char buffer[16];
+  auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), number);
+  const qsizetype len = end - buffer;
+  QString name;
+  name.reserve(namepart.size() + std::max<qsizetype>(len, digits));
+  name.append(namepart);
+  for (qsizetype i = len; i < digits; ++i) {
+    name.append(QLatin1Char('0'));
+  }
+  name.append(QLatin1String(buffer, len));
+  return name;
 }
 
 void
@@ -645,33 +924,58 @@ WaypointList::add_rte_waypt(int waypt_ct, Waypoint* wpt, bool synth, QStringView
   wpt->NormalizePosition();
 
   if (synth && wpt->shortname.isEmpty()) {
-    wpt->shortname = QStringLiteral("%1%2").arg(namepart).arg(waypt_ct, number_digits, 10, QChar('0'));
+    wpt->shortname = synth_rte_name(namepart, waypt_ct, number_digits);
     wpt->wpt_flags.shortname_is_synthetic = 1;
   }
+
+  if (name_index_valid) {
+    index_name(wpt);
+  }
 }
 
 void
 WaypointList::waypt_del(Waypoint* wpt)
 {
-  const int idx = this->indexOf(wpt);
+  // Realtime writers add a point, write, and then delete that point,
+  // so look at the end before searching.
+  const int idx = (!isEmpty() && (last() == wpt))? size() - 1 : this->indexOf(wpt);
   assert(idx >= 0);
-  removeAt(idx);
+  waypt_del(begin() + idx);
+}
+
+WaypointList::iterator
+WaypointList::waypt_del(iterator it)
+{
+  invalidate_name_index();
+  return erase(it);
 }
 
 void
 WaypointList::del_marked_wpts()
 {
-  // For lineary complexity build a new list from the points we keep.
-  WaypointList oldlist;
-  swap(oldlist);
+  gpsbabel::TraceSpan span("waypoints", QStringLiteral("del_marked_wpts"));
+  // Filters call this whether or not they marked anything, so leave the
+  // list alone unless there is something to remove.
+  auto dst = std::find_if(begin(), end(), [](const Waypoint* wpt)->bool {
+    return wpt->wpt_flags.marked_for_deletion;
+  });
+  if (dst == end()) {
+    return;
+  }
 
-  for (Waypoint* wpt : std::as_const(oldlist)) {
+  // Compact in place, keeping the order; the points we keep have been
+  // through waypt_add() already.
+  for (auto src = dst; src != end(); ++src) {
+    Waypoint* wpt = *src;
     if (wpt->wpt_flags.marked_for_deletion) {
       delete wpt;
     } else {
-      waypt_add(wpt);
+      *dst++ = wpt;
     }
   }
+  deleted_counter.add(end() - dst);
+  erase(dst, end());
+  invalidate_name_index();
 }
 
 void
@@ -679,12 +983,20 @@ WaypointList::del_rte_waypt(Waypoint* wpt)
 {
   const int idx = indexOf(wpt);
   assert(idx >= 0);
-  if (wpt->wpt_flags.new_trkseg && ((idx+1) < size())) {
-    auto* wpt_next = at(idx+1);
+  del_rte_waypt(begin() + idx);
+}
+
+WaypointList::iterator
+WaypointList::del_rte_waypt(iterator it)
+{
+  Waypoint* wpt = *it;
+  invalidate_name_index();
+  if (wpt->wpt_flags.new_trkseg && ((it + 1) != end())) {
+    auto* wpt_next = *(it + 1);
     wpt_next->wpt_flags.new_trkseg = 1;
   }
   wpt->wpt_flags.new_trkseg = 0;
-  removeAt(idx);
+  return erase(it);
 }
 
 /*
@@ -701,21 +1013,67 @@ WaypointList::waypt_compute_bounds(bounds* bounds) const
   }
 }
 
+void
+WaypointList::reserve_more(qsizetype count)
+{
+  if (count > 0) {
+    reserve(size() + std::min(count, kCapacityHintLimit));
+  }
+}
+
+void
+WaypointList::index_name(Waypoint* wpt) const
+{
+  // Keep the first waypoint with a given name, as a linear search would.
+  if (!name_index.contains(wpt->shortname)) {
+    name_index.insert(wpt->shortname, wpt);
+  }
+}
+
+void
+WaypointList::invalidate_name_index() const
+{
+  name_index.clear();
+  name_index_valid = false;
+}
+
 Waypoint*
 WaypointList::find_waypt_by_name(const QString& name) const
 {
-  foreach (Waypoint* waypointp, *this) {
-    if (waypointp->shortname == name) {
-      return waypointp;
+  if (!name_index_valid) {
+    name_index.reserve(count());
+    foreach (Waypoint* waypointp, *this) {
+      index_name(waypointp);
     }
+    name_index_valid = true;
+  }
+
+  Waypoint* waypointp = name_index.value(name, nullptr);
+  if ((waypointp != nullptr) && (waypointp->shortname == name)) {
+    return waypointp;
   }
 
-  return nullptr;
+  // Waypoints may be renamed in place after they were indexed, which the
+  // index can't see, so only a hit that still matches is trusted.  The
+  // rest is answered by a linear search, and the index is rebuilt on the
+  // next lookup if it turns out to be stale.
+  auto it = std::find_if(cbegin(), cend(), [&name](const Waypoint* wpt) {
+    return wpt->shortname == name;
+  });
+  if (it == cend()) {
+    if (waypointp != nullptr) {
+      invalidate_name_index();
+    }
+    return nullptr;
+  }
+  invalidate_name_index();
+  return *it;
 }
 
 void
 WaypointList::flush()
 {
+  invalidate_name_index();
   while (!isEmpty()) {
     delete takeFirst();
   }
@@ -728,6 +1086,7 @@ WaypointList::copy(WaypointList** dst) const
     *dst = new WaypointList;
   }
 
+  (*dst)->reserve((*dst)->size() + size());
   foreach (const Waypoint* wpt_old, *this) {
     (*dst)->waypt_add(new Waypoint(*wpt_old));
   }
@@ -743,6 +1102,7 @@ WaypointList::restore(WaypointList* src)
 
   *this = *src;
   src->clear();
+  src->invalidate_name_index();
 }
 
 void WaypointList::swap(WaypointList& other)
@@ -751,3 +1111,26 @@ void WaypointList::swap(WaypointList& other)
   *this = other;
   other = tmp_list;
 }
+
+void WaypointList::reorder(const QVector<Waypoint*>& order)
+{
+  assert(order.size() == size());
+  std::copy(order.cbegin(), order.cend(), begin());
+  invalidate_name_index();
+}
+
+void WaypointList::splice(WaypointList& src)
+{
+  if (&src == this) {
+    return;
+  }
+  reserve(size() + src.size());
+  for (Waypoint* wpt : std::as_const(src)) {
+    append(wpt);
+    if (name_index_valid) {
+      index_name(wpt);
+    }
+  }
+  src.clear();
+  src.invalidate_name_index();
+}
@@ -25,27 +25,36 @@
 
 #include "xcsv.h"
 
-#include <cctype>                  // for isdigit, tolower
-#include <cmath>                   // for fabs, pow
+#include <algorithm>               // for count, max, min
+#include <cctype>                  // for isdigit, isspace, tolower
+#include <cmath>                   // for fabs, pow, isfinite, signbit
 #include <cstdio>                  // for snprintf, sscanf
 #include <cstdint>                 // for uint32_t
 #include <cstdlib>                 // for strtod
-#include <cstring>                 // for strlen, strncmp, strcmp
+#include <cstring>                 // for memchr, strchr, strlen, strncmp, strcmp
 #include <ctime>                   // for gmtime, localtime, time_t, mktime, strftime
+#include <memory>                  // for unique_ptr, make_unique
 #include <optional>                // for optional
-#include <utility>                 // for as_const
+#include <utility>                 // for as_const, move
+#include <vector>                  // for vector
 
 #include <QByteArray>              // for QByteArray
+#include <QByteArrayView>          // for QByteArrayView
 #include <QChar>                   // for QChar
 #include <QDate>                   // for QDate
 #include <QDateTime>               // for QDateTime
 #include <QDebug>                  // for QDebug
 #include <QHash>                   // for QHash
 #include <QIODevice>               // for QIODevice, operator|, QIODevice::ReadOnly, QIODevice::Text, QIODevice::WriteOnly
+#include <QJsonObject>             // for QJsonObject
 #include <QList>                   // for QList
+#include <QMutex>                  // for QMutex
+#include <QMutexLocker>            // for QMutexLocker
 #include <QRegularExpression>      // for QRegularExpression
 #include <QString>                 // for QString, operator+, operator==
+#include <QStringConverter>        // for QStringConverter
 #include <QStringList>             // for QStringList
+#include <QStringView>             // for QStringView
 #include <QTextStream>             // for QTextStream
 #include <Qt>                      // for CaseInsensitive
 #include <QtGlobal>                // for qRound, qPrintable
@@ -56,11 +65,17 @@
 #include "garmin_fs.h"             // for garmin_fs_t
 #include "geocache.h"              // for Geocache, Geocache::status_t, Geoc...
 #include "grtcirc.h"               // for RAD, gcdist, radtometers
-#include "jeeps/gpsmath.h"         // for GPS_Math_WGS84_To_UTM_EN, GPS_Lookup_Datum_Index, GPS_Math_Known_Datum_To_WGS84_M, GPS_Math_UTM_EN_To_Known_Datum, GPS_Math_WGS84_To_Known_Datum_M, GPS_Math_WGS84_To_UKOSMap_H
+#include "jeeps/gpsmath.h"         // for GPS_Math_WGS84_To_UTM_EN, GPS_Lookup_Datum_Index, GPS_Math_Known_Datum_To_WGS84_Setup, GPS_Math_UTM_EN_To_Known_Datum, GPS_Math_WGS84_To_Known_Datum_Setup, GPS_Math_WGS84_To_UKOSMap_H
 #include "jeeps/gpsport.h"         // for int32
-#include "session.h"               // for session_t
+#include "session.h"               // for session_t, ThreadScope
+#include "src/core/budget.h"       // for Budget
+#include "src/core/checkpoint.h"   // for Checkpoint
 #include "src/core/datetime.h"     // for DateTime
-#include "src/core/logging.h"      // for FatalMsg
+#include "src/core/file.h"         // for File
+#include "src/core/logging.h"      // for FatalMsg, FatalError
+#include "src/core/memoryfile.h"   // for MemoryFiles
+#include "src/core/numeric.h"      // for to_double
+#include "src/core/scheduler.h"    // for TaskGroup
 #include "src/core/textstream.h"   // for TextStream
 #include "strptime.h"              // for strptime
 
@@ -247,7 +262,7 @@ XcsvStyle::xcsv_ofield_add(XcsvStyle* style, const QString& qkey, const QString&
 }
 
 QDate
-XcsvFormat::yyyymmdd_to_time(const QString& s)
+XcsvFormat::yyyymmdd_to_time(QStringView s)
 {
   return QDate::fromString(s, u"yyyyMMdd");
 }
@@ -258,6 +273,186 @@ XcsvFormat::xcsv_adjust_time(const QDate date, const QTime time, bool is_localti
   return make_datetime(date, time, is_localtime, opt_utc != nullptr, utc_offset);
 }
 
+/*
+ * xcsv_compile_time_layout - Turn a strftime format of plain numeric
+ * conversions into a layout that xcsv_scan_time_layout() can match without
+ * strptime.  Formats with anything else, or with conversions that
+ * sscanftime() wouldn't turn into a date and time, give an empty layout.
+ */
+QList<XcsvFormat::xcsv_time_part>
+XcsvFormat::xcsv_compile_time_layout(const QByteArray& format)
+{
+  QList<xcsv_time_part> layout;
+  QByteArray seen;
+  for (qsizetype i = 0; i < format.size(); ++i) {
+    char c = format.at(i);
+    xcsv_time_part part;
+    if (c == '%') {
+      if (++i == format.size()) {
+        return {};
+      }
+      c = format.at(i);
+      if (c == '%') {
+        part.literal = c;
+      } else if ((strchr("YymdHMS", c) != nullptr) && !seen.contains(c)) {
+        part.conv = c;
+        seen.append(c);
+      } else {
+        return {};
+      }
+    } else if (isspace(static_cast<unsigned char>(c)) || (c & 0x80)) {
+      return {};
+    } else {
+      part.literal = c;
+    }
+    layout.append(part);
+  }
+
+  bool year = seen.contains('Y') != seen.contains('y');
+  if (seen.isEmpty() || (seen.contains('Y') && seen.contains('y')) ||
+      (seen.contains('d') && !seen.contains('m')) || (seen.contains('m') && !year) ||
+      (seen.contains('M') && !seen.contains('H')) || (seen.contains('S') && !seen.contains('M'))) {
+    return {};
+  }
+  return layout;
+}
+
+/*
+ * xcsv_scan_time_layout - Match a value against a compiled time layout the
+ * way strptime would.  Returns false, leaving date and time alone, if the
+ * value doesn't fit for whatever reason.
+ */
+bool
+XcsvFormat::xcsv_scan_time_layout(QStringView value, const QList<xcsv_time_part>& layout,
+                                  QDate& date, QTime& time)
+{
+  int tm_year = -1;
+  int month = -1;
+  int day = -1;
+  int hour = -1;
+  int min = -1;
+  int sec = -1;
+  qsizetype pos = 0;
+  for (const auto& part : layout) {
+    if (part.conv == '\0') {
+      if ((pos >= value.size()) || (value.at(pos) != QChar(part.literal))) {
+        return false;
+      }
+      ++pos;
+      continue;
+    }
+
+    int from = 0;
+    int to = 99;
+    int width = 2;
+    switch (part.conv) {
+    case 'Y':
+      to = 9999;
+      width = 4;
+      break;
+    case 'm':
+      from = 1;
+      to = 12;
+      break;
+    case 'd':
+      from = 1;
+      to = 31;
+      break;
+    case 'H':
+      to = 23;
+      break;
+    case 'M':
+      to = 59;
+      break;
+    case 'S':
+      to = 61;
+      break;
+    default:
+      break;
+    }
+    // Leading white space and all the failures are left to strptime.
+    if ((pos >= value.size()) || (value.at(pos) < '0') || (value.at(pos) > '9')) {
+      return false;
+    }
+    int val = 0;
+    do {
+      val = val * 10 + (value.at(pos++).unicode() - '0');
+    } while ((--width > 0) && (val * 10 <= to) && (pos < value.size()) &&
+             (value.at(pos) >= '0') && (value.at(pos) <= '9'));
+    if ((val < from) || (val > to)) {
+      return false;
+    }
+
+    switch (part.conv) {
+    case 'Y':
+      tm_year = val - 1900;
+      break;
+    case 'y':
+      tm_year = (val >= 69) ? val : val + 100;
+      break;
+    case 'm':
+      month = val;
+      break;
+    case 'd':
+      day = val;
+      break;
+    case 'H':
+      hour = val;
+      break;
+    case 'M':
+      min = val;
+      break;
+    case 'S':
+      sec = val;
+      break;
+    default:
+      break;
+    }
+  }
+
+  QTime time_result;
+  if (hour >= 0) {
+    time_result = QTime(hour, std::max(min, 0), std::max(sec, 0));
+    if (!time_result.isValid()) {
+      return false;
+    }
+  }
+  QDate date_result;
+  if (month >= 0 || day >= 0 || tm_year != -1) {
+    if (tm_year < 0) {
+      return false;
+    }
+    int year = (tm_year >= 70)? tm_year + 1900 : tm_year + 2000;
+    date_result = QDate(year, std::max(month, 1), std::max(day, 1));
+    if (!date_result.isValid()) {
+      return false;
+    }
+  }
+
+  if (time_result.isValid()) {
+    time = time_result;
+  }
+  if (date_result.isValid()) {
+    date = date_result;
+  }
+  return true;
+}
+
+/*
+ * xcsv_parse_time - Parse a GMT_TIME or LOCAL_TIME field.
+ */
+void
+XcsvFormat::xcsv_parse_time(QStringView value, const xcsv_ifield& field, QDate& date, QTime& time)
+{
+  if (value.isEmpty()) {
+    return;
+  }
+  if (!field.time_layout.isEmpty() && xcsv_scan_time_layout(value, field.time_layout, date, time)) {
+    return;
+  }
+  sscanftime(value.toUtf8().constData(), field.fmp->printfc.constData(), date, time);
+}
+
 /*
  * sscanftime - Parse a date buffer using strftime format
  */
@@ -370,29 +565,110 @@ XcsvFormat::gmsd_init(Waypoint* wpt)
 }
 
 /*****************************************************************************/
-/* xcsv_parse_val() - parse incoming data into the waypt structure.          */
-/* usage: xcsv_parse_val("-123.34", *waypt, *field_map)                      */
+/* xcsv_compile_ifields() - resolve everything about the input fields that   */
+/*                   doesn't depend on the data, once per file.              */
 /*****************************************************************************/
 void
-XcsvFormat::xcsv_parse_val(const QString& value, Waypoint* wpt, const XcsvStyle::field_map& fmp,
-                           xcsv_parse_data* parse_data, const int line_no)
+XcsvFormat::xcsv_compile_ifields()
 {
-  QString enclosure = "";
-  Geocache* gc_data = nullptr;
+  ifields.clear();
+  ifields.reserve(xcsv_style->ifields.size());
+  for (const auto& fmp : xcsv_style->ifields) {
+    if (fmp.printfc.isNull()) {
+      fatal(MYNAME ": xcsv style '%s' is missing format specifier", fmp.key.constData());
+    }
 
-  if (fmp.printfc.isNull()) {
-    fatal(MYNAME ": xcsv style '%s' is missing format specifier", fmp.key.constData());
-  }
+    xcsv_ifield field;
+    field.fmp = &fmp;
+    field.token = fmp.hashed_key;
+    if (fmp.printfc == "\"%s\"") {
+      field.enclosure = "\"";
+    }
 
-  if (0 == strcmp(fmp.printfc.constData(), "\"%s\"")) {
-    enclosure = "\"";
+    switch (field.token) {
+    // These convert the QString itself.
+    case XcsvStyle::XT_IGNORE:
+    case XcsvStyle::XT_CONSTANT:
+    case XcsvStyle::XT_ANYNAME:
+    case XcsvStyle::XT_INDEX:
+    case XcsvStyle::XT_SHORTNAME:
+    case XcsvStyle::XT_DESCRIPTION:
+    case XcsvStyle::XT_NOTES:
+    case XcsvStyle::XT_URL:
+    case XcsvStyle::XT_URL_LINK_TEXT:
+    case XcsvStyle::XT_ICON_DESCR:
+    case XcsvStyle::XT_LAT_HUMAN_READABLE:
+    case XcsvStyle::XT_LON_HUMAN_READABLE:
+    case XcsvStyle::XT_LATLON_HUMAN_READABLE:
+    case XcsvStyle::XT_EXCEL_TIME:
+    case XcsvStyle::XT_TIMET_TIME:
+    case XcsvStyle::XT_TIMET_TIME_MS:
+    case XcsvStyle::XT_YYYYMMDD_TIME:
+    case XcsvStyle::XT_ISO_TIME:
+    case XcsvStyle::XT_ISO_TIME_MS:
+    case XcsvStyle::XT_NET_TIME:
+    case XcsvStyle::XT_GEOCACHE_LAST_FOUND:
+    case XcsvStyle::XT_GEOCACHE_TYPE:
+    case XcsvStyle::XT_GEOCACHE_CONTAINER:
+    case XcsvStyle::XT_GEOCACHE_HINT:
+    case XcsvStyle::XT_GEOCACHE_PLACER:
+    case XcsvStyle::XT_GEOCACHE_ISAVAILABLE:
+    case XcsvStyle::XT_GEOCACHE_ISARCHIVED:
+    case XcsvStyle::XT_ROUTE_NAME:
+    case XcsvStyle::XT_TRACK_NAME:
+    case XcsvStyle::XT_COUNTRY:
+    case XcsvStyle::XT_STATE:
+    case XcsvStyle::XT_CITY:
+    case XcsvStyle::XT_STREET_ADDR:
+    case XcsvStyle::XT_POSTAL_CODE:
+    case XcsvStyle::XT_PHONE_NR:
+    case XcsvStyle::XT_FACILITY:
+    case XcsvStyle::XT_EMAIL:
+      field.wants_utf8 = false;
+      break;
+    case XcsvStyle::XT_GMT_TIME:
+    case XcsvStyle::XT_LOCAL_TIME:
+      field.time_layout = xcsv_compile_time_layout(fmp.printfc);
+      field.wants_utf8 = false;
+      break;
+    case XcsvStyle::XT_unused:
+      // LAT_10E and LON_10E carry their scale in the keyword.
+      if (fmp.key.startsWith("LON_10E")) {
+        field.scaled = &Waypoint::longitude;
+      } else if (fmp.key.startsWith("LAT_10E")) {
+        field.scaled = &Waypoint::latitude;
+      }
+      if (field.scaled != nullptr) {
+        field.divisor = pow(10.0, strtod(fmp.key.constData() + 7, nullptr));
+      }
+      break;
+    default:
+      break;
+    }
+    ifields.append(field);
   }
+}
+
+/*****************************************************************************/
+/* xcsv_parse_val() - parse incoming data into the waypt structure.          */
+/* usage: xcsv_parse_val("-123.34", *waypt, ifields.at(0))                   */
+/*****************************************************************************/
+void
+XcsvFormat::xcsv_parse_val(QStringView value, Waypoint* wpt, const xcsv_ifield& field,
+                           xcsv_parse_data* parse_data, const int line_no)
+{
+  const XcsvStyle::field_map& fmp = *field.fmp;
+  const QString& enclosure = field.enclosure;
+  Geocache* gc_data = nullptr;
 
   // TODO: eliminate this char string usage.
-  QByteArray value_utf8 = value.toUtf8();
+  QByteArray value_utf8;
+  if (field.wants_utf8) {
+    value_utf8 = value.toUtf8();
+  }
   const char* s = value_utf8.constData();
 
-  switch (fmp.hashed_key) {
+  switch (field.token) {
   case XcsvStyle::XT_IGNORE:
     /* IGNORE -- Categorically ignore this... */
     break;
@@ -412,28 +688,28 @@ XcsvFormat::xcsv_parse_val(const QString& value, Waypoint* wpt, const XcsvStyle:
     wpt->description = csv_stringtrim(value, enclosure, 0);
     break;
   case XcsvStyle::XT_NOTES:
-    wpt->notes = value.trimmed();
+    wpt->notes = value.trimmed().toString();
     break;
   case XcsvStyle::XT_URL:
     if (!parse_data->link_) {
       parse_data->link_ = new UrlLink;
     }
-    parse_data->link_->url_ = value.trimmed();
+    parse_data->link_->url_ = value.trimmed().toString();
     break;
   case XcsvStyle::XT_URL_LINK_TEXT:
     if (!parse_data->link_) {
       parse_data->link_ = new UrlLink;
     }
-    parse_data->link_->url_link_text_ = value.trimmed();
+    parse_data->link_->url_link_text_ = value.trimmed().toString();
     break;
   case XcsvStyle::XT_ICON_DESCR:
-    wpt->icon_descr = value.trimmed();
+    wpt->icon_descr = value.trimmed().toString();
     break;
 
   /* LATITUDE CONVERSIONS**************************************************/
   case XcsvStyle::XT_LAT_DECIMAL:
     /* latitude as a pure decimal value */
-    wpt->latitude = strtod(s, nullptr);
+    wpt->latitude = gpsbabel::to_double(s);
     break;
   case XcsvStyle::XT_LAT_DECIMALDIR:
   case XcsvStyle::XT_LAT_DIRDECIMAL:
@@ -442,22 +718,22 @@ XcsvFormat::xcsv_parse_val(const QString& value, Waypoint* wpt, const XcsvStyle:
     break;
   case XcsvStyle::XT_LAT_INT32DEG:
     /* latitude as a 32 bit integer offset */
-    wpt->latitude = intdeg_to_dec((int) strtod(s, nullptr));
+    wpt->latitude = intdeg_to_dec((int) gpsbabel::to_double(s));
     break;
   case XcsvStyle::XT_LAT_HUMAN_READABLE:
-    human_to_dec(value, &wpt->latitude, &wpt->longitude, 1);
+    human_to_dec(value.toString(), &wpt->latitude, &wpt->longitude, 1);
     break;
   case XcsvStyle::XT_LAT_DDMMDIR:
     wpt->latitude = ddmmdir_to_degrees(s);
     break;
   case XcsvStyle::XT_LAT_NMEA:
-    wpt->latitude = ddmm2degrees(strtod(s, nullptr));
+    wpt->latitude = ddmm2degrees(gpsbabel::to_double(s));
     break;
   // XT_LAT_10E is handled outside the switch.
   /* LONGITUDE CONVERSIONS ***********************************************/
   case XcsvStyle::XT_LON_DECIMAL:
     /* longitude as a pure decimal value */
-    wpt->longitude = strtod(s, nullptr);
+    wpt->longitude = gpsbabel::to_double(s);
     break;
   case XcsvStyle::XT_LON_DECIMALDIR:
   case XcsvStyle::XT_LON_DIRDECIMAL:
@@ -466,21 +742,21 @@ XcsvFormat::xcsv_parse_val(const QString& value, Waypoint* wpt, const XcsvStyle:
     break;
   case XcsvStyle::XT_LON_INT32DEG:
     /* longitude as a 32 bit integer offset  */
-    wpt->longitude = intdeg_to_dec((int) strtod(s, nullptr));
+    wpt->longitude = intdeg_to_dec((int) gpsbabel::to_double(s));
     break;
   case XcsvStyle::XT_LON_HUMAN_READABLE:
-    human_to_dec(value, &wpt->latitude, &wpt->longitude, 2);
+    human_to_dec(value.toString(), &wpt->latitude, &wpt->longitude, 2);
     break;
   case XcsvStyle::XT_LON_DDMMDIR:
     wpt->longitude = ddmmdir_to_degrees(s);
     break;
   case XcsvStyle::XT_LON_NMEA:
-    wpt->longitude = ddmm2degrees(strtod(s, nullptr));
+    wpt->longitude = ddmm2degrees(gpsbabel::to_double(s));
     break;
   // case XcsvStyle::XT_LON_10E is handled outside the switch.
   /* LAT AND LON CONVERSIONS ********************************************/
   case XcsvStyle::XT_LATLON_HUMAN_READABLE:
-    human_to_dec(value, &wpt->latitude, &wpt->longitude, 0);
+    human_to_dec(value.toString(), &wpt->latitude, &wpt->longitude, 0);
     break;
   /* DIRECTIONS **********************************************************/
   case XcsvStyle::XT_LAT_DIR:
@@ -519,29 +795,29 @@ XcsvFormat::xcsv_parse_val(const QString& value, Waypoint* wpt, const XcsvStyle:
     parse_data->utm_zonec = s[strlen(s) - 1];
     break;
   case XcsvStyle::XT_UTM_EASTING:
-    parse_data->utm_easting = strtod(s, nullptr);
+    parse_data->utm_easting = gpsbabel::to_double(s);
     break;
   case XcsvStyle::XT_UTM_NORTHING:
-    parse_data->utm_northing = strtod(s, nullptr);
+    parse_data->utm_northing = gpsbabel::to_double(s);
     break;
   case XcsvStyle::XT_UTM: {
-    char* ss;
+    const char* ss;
     int i = 0;
 
-    parse_data->utm_zone = strtod(s, &ss);
+    parse_data->utm_zone = gpsbabel::to_double(s, &ss);
     parse_data->utm_zonec = ss[i];
     ss++;
-    parse_data->utm_easting = strtod(ss, &ss);
+    parse_data->utm_easting = gpsbabel::to_double(ss, &ss);
     while (*ss && !isdigit(*ss)) {
       ss++;
     }
-    parse_data->utm_northing = strtod(ss, nullptr);
+    parse_data->utm_northing = gpsbabel::to_double(ss);
   }
   break;
   /* ALTITUDE CONVERSIONS ************************************************/
   case XcsvStyle::XT_ALT_FEET: {
-    char* endptr;
-    double val = strtod(s, &endptr);
+    const char* endptr;
+    double val = gpsbabel::to_double(s, &endptr);
     if ((val == 0 && s==endptr)) {
       wpt->altitude = unknown_alt;
     } else {
@@ -553,8 +829,8 @@ XcsvFormat::xcsv_parse_val(const QString& value, Waypoint* wpt, const XcsvStyle:
   }
   break;
   case XcsvStyle::XT_ALT_METERS: {
-    char* endptr;
-    double val = strtod(s, &endptr);
+    const char* endptr;
+    double val = gpsbabel::to_double(s, &endptr);
     if ((val == 0 && s==endptr)) {
       wpt->altitude = unknown_alt;
     } else {
@@ -568,19 +844,19 @@ XcsvFormat::xcsv_parse_val(const QString& value, Waypoint* wpt, const XcsvStyle:
 
   /* PATH CONVERSIONS ************************************************/
   case XcsvStyle::XT_PATH_SPEED:
-    wpt->set_speed(strtod(s, nullptr));
+    wpt->set_speed(gpsbabel::to_double(s));
     break;
   case XcsvStyle::XT_PATH_SPEED_KPH:
-    wpt->set_speed(KPH_TO_MPS(strtod(s, nullptr)));
+    wpt->set_speed(KPH_TO_MPS(gpsbabel::to_double(s)));
     break;
   case XcsvStyle::XT_PATH_SPEED_MPH:
-    wpt->set_speed(MPH_TO_MPS(strtod(s, nullptr)));
+    wpt->set_speed(MPH_TO_MPS(gpsbabel::to_double(s)));
     break;
   case XcsvStyle::XT_PATH_SPEED_KNOTS:
-    wpt->set_speed(KNOTS_TO_MPS(strtod(s, nullptr)));
+    wpt->set_speed(KNOTS_TO_MPS(gpsbabel::to_double(s)));
     break;
   case XcsvStyle::XT_PATH_COURSE:
-    wpt->set_course(strtod(s, nullptr));
+    wpt->set_course(gpsbabel::to_double(s));
     break;
 
   /* TIME CONVERSIONS ***************************************************/
@@ -592,7 +868,7 @@ XcsvFormat::xcsv_parse_val(const QString& value, Waypoint* wpt, const XcsvStyle:
       wpt->SetCreationTime(0, excel_to_timetms(et));
       parse_data->need_datetime = false;
     } else if (!value.isEmpty()) {
-      warning("parse of string '%s' on line number %d as EXCEL_TIME failed.\n", s, line_no);
+      warning("parse of string '%s' on line number %d as EXCEL_TIME failed.\n", qPrintable(value.toString()), line_no);
     }
   }
   break;
@@ -604,7 +880,7 @@ XcsvFormat::xcsv_parse_val(const QString& value, Waypoint* wpt, const XcsvStyle:
       wpt->SetCreationTime(tt);
       parse_data->need_datetime = false;
     } else if (!value.isEmpty()) {
-      warning("parse of string '%s' on line number %d as TIMET_TIME failed.\n", s, line_no);
+      warning("parse of string '%s' on line number %d as TIMET_TIME failed.\n", qPrintable(value.toString()), line_no);
     }
   }
   break;
@@ -616,7 +892,7 @@ XcsvFormat::xcsv_parse_val(const QString& value, Waypoint* wpt, const XcsvStyle:
       wpt->SetCreationTime(0, tt);
       parse_data->need_datetime = false;
     } else if (!value.isEmpty()) {
-      warning("parse of string '%s' on line number %d as TIMET_TIME_MS failed.\n", s, line_no);
+      warning("parse of string '%s' on line number %d as TIMET_TIME_MS failed.\n", qPrintable(value.toString()), line_no);
     }
   }
   break;
@@ -624,14 +900,14 @@ XcsvFormat::xcsv_parse_val(const QString& value, Waypoint* wpt, const XcsvStyle:
     parse_data->utc_date = yyyymmdd_to_time(value);
     break;
   case XcsvStyle::XT_GMT_TIME:
-    sscanftime(s, fmp.printfc.constData(), parse_data->utc_date, parse_data->utc_time);
+    xcsv_parse_time(value, field, parse_data->utc_date, parse_data->utc_time);
     break;
   case XcsvStyle::XT_LOCAL_TIME:
-    sscanftime(s, fmp.printfc.constData(), parse_data->local_date, parse_data->local_time);
+    xcsv_parse_time(value, field, parse_data->local_date, parse_data->local_time);
     break;
   case XcsvStyle::XT_ISO_TIME:
   case XcsvStyle::XT_ISO_TIME_MS:
-    wpt->SetCreationTime(QDateTime::fromString(value, Qt::ISODateWithMs));
+    wpt->SetCreationTime(QDateTime::fromString(value.toString(), Qt::ISODateWithMs));
     parse_data->need_datetime = false;
     break;
   case XcsvStyle::XT_NET_TIME: {
@@ -641,7 +917,7 @@ XcsvFormat::xcsv_parse_val(const QString& value, Waypoint* wpt, const XcsvStyle:
       wpt->SetCreationTime(dotnet_time_to_qdatetime(dnt));
       parse_data->need_datetime = false;
     } else if (!value.isEmpty()) {
-      warning("parse of string '%s' on line number %d as NET_TIME failed.\n", s, line_no);
+      warning("parse of string '%s' on line number %d as NET_TIME failed.\n", qPrintable(value.toString()), line_no);
     }
   }
   break;
@@ -654,24 +930,24 @@ XcsvFormat::xcsv_parse_val(const QString& value, Waypoint* wpt, const XcsvStyle:
   /* GEOCACHING STUFF ***************************************************/
   case XcsvStyle::XT_GEOCACHE_DIFF:
     /* Geocache Difficulty as an int */
-    wpt->AllocGCData()->diff = strtod(s, nullptr) * 10;
+    wpt->AllocGCData()->diff = gpsbabel::to_double(s) * 10;
     break;
   case XcsvStyle::XT_GEOCACHE_TERR:
     /* Geocache Terrain as an int */
-    wpt->AllocGCData()->terr = strtod(s, nullptr) * 10;
+    wpt->AllocGCData()->terr = gpsbabel::to_double(s) * 10;
     break;
   case XcsvStyle::XT_GEOCACHE_TYPE:
     /* Geocache Type */
-    wpt->AllocGCData()->set_type(value);
+    wpt->AllocGCData()->set_type(value.toString());
     break;
   case XcsvStyle::XT_GEOCACHE_CONTAINER:
-    wpt->AllocGCData()->set_container(value);
+    wpt->AllocGCData()->set_container(value.toString());
     break;
   case XcsvStyle::XT_GEOCACHE_HINT:
-    wpt->AllocGCData()->hint = value.trimmed();
+    wpt->AllocGCData()->hint = value.trimmed().toString();
     break;
   case XcsvStyle::XT_GEOCACHE_PLACER:
-    wpt->AllocGCData()->placer = value.trimmed();
+    wpt->AllocGCData()->placer = value.trimmed().toString();
     break;
   case XcsvStyle::XT_GEOCACHE_ISAVAILABLE:
     gc_data = wpt->AllocGCData();
@@ -696,13 +972,13 @@ XcsvFormat::xcsv_parse_val(const QString& value, Waypoint* wpt, const XcsvStyle:
 
   /* GPS STUFF *******************************************************/
   case XcsvStyle::XT_GPS_HDOP:
-    wpt->hdop = strtod(s, nullptr);
+    wpt->hdop = gpsbabel::to_double(s);
     break;
   case XcsvStyle::XT_GPS_VDOP:
-    wpt->vdop = strtod(s, nullptr);
+    wpt->vdop = gpsbabel::to_double(s);
     break;
   case XcsvStyle::XT_GPS_PDOP:
-    wpt->pdop = strtod(s, nullptr);
+    wpt->pdop = gpsbabel::to_double(s);
     break;
   case XcsvStyle::XT_GPS_SAT:
     wpt->sat = xstrtoi(s, nullptr, 10);
@@ -734,16 +1010,16 @@ XcsvFormat::xcsv_parse_val(const QString& value, Waypoint* wpt, const XcsvStyle:
 
   /* OTHER STUFF ***************************************************/
   case XcsvStyle::XT_PATH_DISTANCE_METERS:
-    wpt->odometer_distance = strtod(s, nullptr);
+    wpt->odometer_distance = gpsbabel::to_double(s);
     break;
   case XcsvStyle::XT_PATH_DISTANCE_KM:
-    wpt->odometer_distance = strtod(s, nullptr) * 1000.0;
+    wpt->odometer_distance = gpsbabel::to_double(s) * 1000.0;
     break;
   case XcsvStyle::XT_PATH_DISTANCE_MILES:
-    wpt->odometer_distance = MILES_TO_METERS(strtod(s, nullptr));
+    wpt->odometer_distance = MILES_TO_METERS(gpsbabel::to_double(s));
     break;
   case XcsvStyle::XT_PATH_DISTANCE_NAUTICAL_MILES:
-    wpt->odometer_distance = NMILES_TO_METERS(strtod(s, nullptr));
+    wpt->odometer_distance = NMILES_TO_METERS(gpsbabel::to_double(s));
     break;
   case XcsvStyle::XT_HEART_RATE:
     wpt->heartrate = xstrtoi(s, nullptr, 10);
@@ -752,13 +1028,13 @@ XcsvFormat::xcsv_parse_val(const QString& value, Waypoint* wpt, const XcsvStyle:
     wpt->cadence = xstrtoi(s, nullptr, 10);
     break;
   case XcsvStyle::XT_POWER:
-    wpt->power = strtod(s, nullptr);
+    wpt->power = gpsbabel::to_double(s);
     break;
   case XcsvStyle::XT_TEMPERATURE:
-    wpt->set_temperature(strtod(s, nullptr));
+    wpt->set_temperature(gpsbabel::to_double(s));
     break;
   case XcsvStyle::XT_TEMPERATURE_F:
-    wpt->set_temperature(FAHRENHEIT_TO_CELSIUS(strtod(s, nullptr)));
+    wpt->set_temperature(FAHRENHEIT_TO_CELSIUS(gpsbabel::to_double(s)));
     break;
   /* GMSD ****************************************************************/
   case XcsvStyle::XT_COUNTRY: {
@@ -802,10 +1078,8 @@ XcsvFormat::xcsv_parse_val(const QString& value, Waypoint* wpt, const XcsvStyle:
   }
   break;
   case XcsvStyle::XT_unused:
-    if (strncmp(fmp.key.constData(), "LON_10E", 7) == 0) {
-      wpt->longitude = strtod(s, nullptr) / pow(10.0, strtod(fmp.key.constData()+7, nullptr));
-    } else if (strncmp(fmp.key.constData(), "LAT_10E", 7) == 0) {
-      wpt->latitude = strtod(s, nullptr) / pow(10.0, strtod(fmp.key.constData()+7, nullptr));
+    if (field.scaled != nullptr) {
+      wpt->*field.scaled = gpsbabel::to_double(s) / field.divisor;
     } else {
       warning(MYNAME ": Unknown style directive: %s\n", fmp.key.constData());
     }
@@ -824,139 +1098,392 @@ XcsvFormat::xcsv_parse_val(const QString& value, Waypoint* wpt, const XcsvStyle:
 void
 XcsvFormat::read()
 {
-  int linecount = 0;
-  route_head* rte = nullptr;
-  route_head* trk = nullptr;
+  if (opt_checkpoint != nullptr) {
+    read_incremental();
+    return;
+  }
+
+  if ((opt_threads != nullptr) && read_parallel(xstrtoi(opt_threads, nullptr, 10))) {
+    return;
+  }
 
   while (true) {
     QString buff = xcsv_file->stream.readLine();
     if (buff.isNull()) {
       break;
     }
-    linecount++;
-    /* Whack trailing space; leading space may matter if our field sep
-     * is whitespace and we have leading whitespace.
-     */
-    // This could be hoisted out as a generic rtrim() if we need such a thing.
-    while (buff.size() > 0 && buff.at(buff.size() - 1).isSpace()) {
-      buff.chop(1);
-    }
+    gpsbabel::Budget::check();
+    xcsv_read_line(buff);
+  }
+  xcsv_read_epilogue(true);
+}
 
-    /* skip over x many lines on the top for the prologue... */
-    if ((linecount - 1) < xcsv_style->prologue.count()) {
-      continue;
-    }
+/*
+ * Reads only the lines added since the checkpoint.  The prologue was
+ * skipped by the run that read the start of the file.  A last line
+ * without a line break may still be being written, so it is left for
+ * the next run.
+ */
+void
+XcsvFormat::read_incremental()
+{
+  if (!xcsv_style->epilogue.isEmpty()) {
+    fatal(MYNAME ": A checkpoint can not be kept for a style with an epilogue.\n");
+  }
+  gpsbabel::Checkpoint checkpoint(opt_checkpoint, xcsv_file->fname, MYNAME);
+  qint64 resume = xcsv_file->stream.bytePos();
+  if (resume < 0) {
+    fatal(MYNAME ": A checkpoint can only be kept for UTF-8 or US-ASCII input.\n");
+  }
+  if (checkpoint.offset() > resume) {
+    xcsv_file->stream.seekBytes(checkpoint.offset());
+    resume = checkpoint.offset();
+    rd_linecount = checkpoint.state().value("line").toInt();
+  }
 
-    /* We should skip over epilogue lines also.  Since we don't want to
-     * pre-read the file to know how many data lines we should be seeing,
-     * we take this cheap shot at the data and cross our fingers.
-     */
-    for (const auto& ogp : std::as_const(xcsv_style->epilogue)) {
-      if (ogp.startsWith(buff)) {
-        buff.clear();
-        break;
-      }
-    }
-    if (!buff.isEmpty()) {
-      auto* wpt_tmp = new Waypoint;
-      // initialize parse data for accumulation of line results from all fields in this line.
-      xcsv_parse_data parse_data;
-      const QStringList values = csv_linesplit(buff, xcsv_style->field_delimiter,
-                                 xcsv_style->field_encloser, linecount);
+  QString buff;
+  while (xcsv_file->stream.readLineInto(&buff) && xcsv_file->stream.lineEnded()) {
+    resume = xcsv_file->stream.bytePos();
+    xcsv_read_line(buff);
+  }
 
-      if (xcsv_style->ifields.isEmpty()) {
-        fatal(MYNAME ": attempt to read, but style '%s' has no IFIELDs in it.\n", qPrintable(xcsv_style->description)? qPrintable(xcsv_style->description) : "unknown");
-      }
+  checkpoint.save(resume, {{"line", rd_linecount}});
+}
+
+/*****************************************************************************/
+/* xcsv_read_line() - parse one line of the file, which may be part of the   */
+/*                   prologue or the epilogue.                               */
+/*****************************************************************************/
+void
+XcsvFormat::xcsv_read_line(QString& buff)
+{
+  ++rd_linecount;
+  /* Whack trailing space; leading space may matter if our field sep
+   * is whitespace and we have leading whitespace.
+   */
+  // This could be hoisted out as a generic rtrim() if we need such a thing.
+  while (buff.size() > 0 && buff.at(buff.size() - 1).isSpace()) {
+    buff.chop(1);
+  }
+
+  /* skip over x many lines on the top for the prologue... */
+  if ((rd_linecount - 1) < xcsv_style->prologue.count()) {
+    return;
+  }
 
-      int ifield_idx = 0;
+  if (buff.isEmpty()) {
+    return;
+  }
+  if (xcsv_style->epilogue.isEmpty()) {
+    xcsv_parse_line(buff, rd_linecount);
+    return;
+  }
 
-      /* now rip the line apart */
-      for (const auto& value : values) {
-        const XcsvStyle::field_map& fmp = xcsv_style->ifields.at(ifield_idx++);
-        xcsv_parse_val(value, wpt_tmp, fmp, &parse_data, linecount);
+  /* Epilogue lines can only be among the last lines of the file, so hold
+   * back as many lines as the epilogue has and only check those, in
+   * xcsv_read_epilogue(), once the end is reached.
+   */
+  if (rd_lookbehind.size() == xcsv_style->epilogue.size()) {
+    auto [line_no, line] = rd_lookbehind.takeFirst();
+    xcsv_parse_line(line, line_no);
+  }
+  rd_lookbehind.append({rd_linecount, buff});
+}
 
-        if (ifield_idx >= xcsv_style->ifields.size()) {
-          /* no more fields, stop parsing! */
+/*****************************************************************************/
+/* xcsv_read_epilogue() - parse the lines xcsv_read_line() held back, but    */
+/*                   if at_end skip those that are part of the epilogue.     */
+/*****************************************************************************/
+void
+XcsvFormat::xcsv_read_epilogue(bool at_end)
+{
+  for (auto& [line_no, line] : rd_lookbehind) {
+    /* Since we don't want to pre-read the file to know how many data
+     * lines we should be seeing, we take this cheap shot at the data
+     * and cross our fingers.
+     */
+    bool is_epilogue = false;
+    if (at_end) {
+      for (const auto& ogp : std::as_const(xcsv_style->epilogue)) {
+        if (ogp.startsWith(line)) {
+          is_epilogue = true;
           break;
         }
       }
+    }
+    if (!is_epilogue) {
+      xcsv_parse_line(line, line_no);
+    }
+  }
+  rd_lookbehind.clear();
+}
 
+/*****************************************************************************/
+/* xcsv_parse_line() - parse one data line into a point.                     */
+/*****************************************************************************/
+void
+XcsvFormat::xcsv_parse_line(const QString& buff, int line_no)
+{
+  auto* wpt_tmp = new Waypoint;
+  // initialize parse data for accumulation of line results from all fields in this line.
+  xcsv_parse_data parse_data;
+  csv_linesplit(buff, xcsv_style->field_delimiter, xcsv_style->field_encloser,
+                line_no, split_fields, split_scratch);
+
+  if (ifields.isEmpty()) {
+    fatal(MYNAME ": attempt to read, but style '%s' has no IFIELDs in it.\n", qPrintable(xcsv_style->description)? qPrintable(xcsv_style->description) : "unknown");
+  }
 
-      if (parse_data.need_datetime) {
-        if (parse_data.utc_date.isValid() && parse_data.utc_time.isValid()) {
-          wpt_tmp->SetCreationTime(xcsv_adjust_time(parse_data.utc_date, parse_data.utc_time, false));
-        } else if (parse_data.local_date.isValid() && parse_data.local_time.isValid()) {
-          wpt_tmp->SetCreationTime(xcsv_adjust_time(parse_data.local_date, parse_data.local_time, true));
-        } else if (parse_data.utc_date.isValid()) {
-          wpt_tmp->SetCreationTime(xcsv_adjust_time(parse_data.utc_date, parse_data.utc_time, false));
-        } else if (parse_data.local_date.isValid()) {
-          wpt_tmp->SetCreationTime(xcsv_adjust_time(parse_data.local_date, parse_data.local_time, true));
-        } else if (parse_data.utc_time.isValid()) {
-          wpt_tmp->SetCreationTime(xcsv_adjust_time(parse_data.utc_date, parse_data.utc_time, false));
-        } else if (parse_data.local_time.isValid()) {
-          wpt_tmp->SetCreationTime(xcsv_adjust_time(parse_data.local_date, parse_data.local_time, true));
-        }
-      }
+  int ifield_idx = 0;
 
-      // If XT_LAT_DIR(XT_LON_DIR) was an input field, and the latitude(longitude) is positive,
-      // assume the latitude(longitude) was the absolute value and take the sign from XT_LAT_DIR(XT_LON_DIR).
-      if (parse_data.lat_dir_positive.has_value() && !(*parse_data.lat_dir_positive) && (wpt_tmp->latitude > 0.0)) {
-        wpt_tmp->latitude = -wpt_tmp->latitude;
-      }
-      if (parse_data.lon_dir_positive.has_value() && !(*parse_data.lon_dir_positive) && (wpt_tmp->longitude > 0.0)) {
-        wpt_tmp->longitude = -wpt_tmp->longitude;
-      }
+  /* now rip the line apart */
+  for (const auto value : std::as_const(split_fields)) {
+    xcsv_parse_val(value, wpt_tmp, ifields.at(ifield_idx++), &parse_data, line_no);
 
-      if ((xcsv_file->gps_datum_idx > -1) && (xcsv_file->gps_datum_idx != kDatumWGS84)) {
-        double alt;
-        GPS_Math_Known_Datum_To_WGS84_M(wpt_tmp->latitude, wpt_tmp->longitude, 0.0,
-                                        &wpt_tmp->latitude, &wpt_tmp->longitude, &alt, xcsv_file->gps_datum_idx);
-      }
+    if (ifield_idx >= ifields.size()) {
+      /* no more fields, stop parsing! */
+      break;
+    }
+  }
 
-      if (parse_data.utm_easting || parse_data.utm_northing) {
-        GPS_Math_UTM_EN_To_Known_Datum(&wpt_tmp->latitude,
-                                       &wpt_tmp->longitude,
-                                       parse_data.utm_easting, parse_data.utm_northing,
-                                       parse_data.utm_zone, parse_data.utm_zonec,
-                                       kDatumWGS84);
-      }
 
-      if (parse_data.link_) {
-        wpt_tmp->AddUrlLink(*parse_data.link_);
-        delete parse_data.link_;
-        parse_data.link_ = nullptr;
+  if (parse_data.need_datetime) {
+    if (parse_data.utc_date.isValid() && parse_data.utc_time.isValid()) {
+      wpt_tmp->SetCreationTime(xcsv_adjust_time(parse_data.utc_date, parse_data.utc_time, false));
+    } else if (parse_data.local_date.isValid() && parse_data.local_time.isValid()) {
+      wpt_tmp->SetCreationTime(xcsv_adjust_time(parse_data.local_date, parse_data.local_time, true));
+    } else if (parse_data.utc_date.isValid()) {
+      wpt_tmp->SetCreationTime(xcsv_adjust_time(parse_data.utc_date, parse_data.utc_time, false));
+    } else if (parse_data.local_date.isValid()) {
+      wpt_tmp->SetCreationTime(xcsv_adjust_time(parse_data.local_date, parse_data.local_time, true));
+    } else if (parse_data.utc_time.isValid()) {
+      wpt_tmp->SetCreationTime(xcsv_adjust_time(parse_data.utc_date, parse_data.utc_time, false));
+    } else if (parse_data.local_time.isValid()) {
+      wpt_tmp->SetCreationTime(xcsv_adjust_time(parse_data.local_date, parse_data.local_time, true));
+    }
+  }
+
+  // If XT_LAT_DIR(XT_LON_DIR) was an input field, and the latitude(longitude) is positive,
+  // assume the latitude(longitude) was the absolute value and take the sign from XT_LAT_DIR(XT_LON_DIR).
+  if (parse_data.lat_dir_positive.has_value() && !(*parse_data.lat_dir_positive) && (wpt_tmp->latitude > 0.0)) {
+    wpt_tmp->latitude = -wpt_tmp->latitude;
+  }
+  if (parse_data.lon_dir_positive.has_value() && !(*parse_data.lon_dir_positive) && (wpt_tmp->longitude > 0.0)) {
+    wpt_tmp->longitude = -wpt_tmp->longitude;
+  }
+
+  if ((xcsv_file->gps_datum_idx > -1) && (xcsv_file->gps_datum_idx != kDatumWGS84)) {
+    double alt;
+    xcsv_file->datum_transform.convert(wpt_tmp->latitude, wpt_tmp->longitude, 0.0,
+                                       &wpt_tmp->latitude, &wpt_tmp->longitude, &alt);
+  }
+
+  if (parse_data.utm_easting || parse_data.utm_northing) {
+    GPS_Math_UTM_EN_To_Known_Datum(&wpt_tmp->latitude,
+                                   &wpt_tmp->longitude,
+                                   parse_data.utm_easting, parse_data.utm_northing,
+                                   parse_data.utm_zone, parse_data.utm_zonec,
+                                   kDatumWGS84);
+  }
+
+  if (parse_data.link_) {
+    wpt_tmp->AddUrlLink(*parse_data.link_);
+    delete parse_data.link_;
+    parse_data.link_ = nullptr;
+  }
+
+  switch (xcsv_style->datatype) {
+  case unknown_gpsdata:
+  case wptdata:
+    waypt_add(wpt_tmp);
+    break;
+  case trkdata:
+    if ((rd_track == nullptr) || parse_data.new_track) {
+      if (rd_track == nullptr) {
+        rd_first_track_new = parse_data.new_track;
       }
+      rd_track = new route_head;
+      track_add_head(rd_track);
+    }
+    if (!parse_data.trk_name.isEmpty()) {
+      rd_track->rte_name = parse_data.trk_name;
+    }
+    track_add_wpt(rd_track, wpt_tmp);
+    break;
+  case rtedata:
+    if (rd_route == nullptr) {
+      rd_route = new route_head;
+      route_add_head(rd_route);
+    }
+    if (!parse_data.rte_name.isEmpty()) {
+      rd_route->rte_name = parse_data.rte_name;
+    }
+    route_add_wpt(rd_route, wpt_tmp);
+    break;
+  default:
+    ;
+  }
+}
 
-      switch (xcsv_style->datatype) {
-      case unknown_gpsdata:
-      case wptdata:
-        waypt_add(wpt_tmp);
-        break;
-      case trkdata:
-        if ((trk == nullptr) || parse_data.new_track) {
-          trk = new route_head;
-          track_add_head(trk);
-        }
-        if (!parse_data.trk_name.isEmpty()) {
-          trk->rte_name = parse_data.trk_name;
-        }
-        track_add_wpt(trk, wpt_tmp);
-        break;
-      case rtedata:
-        if (rte == nullptr) {
-          rte = new route_head;
-          route_add_head(rte);
-        }
-        if (!parse_data.rte_name.isEmpty()) {
-          rte->rte_name = parse_data.rte_name;
+/*****************************************************************************/
+/* xcsv_read_lines() - parse the UTF-8 lines from begin to end, as read()    */
+/*                   would take them from the stream.                        */
+/*****************************************************************************/
+void
+XcsvFormat::xcsv_read_lines(const char* begin, const char* end)
+{
+  while (begin < end) {
+    const auto* eol = static_cast<const char*>(memchr(begin, '\n', end - begin));
+    QString buff = QString::fromUtf8(begin, ((eol == nullptr) ? end : eol) - begin);
+    xcsv_read_line(buff);
+    begin = (eol == nullptr) ? end : eol + 1;
+  }
+}
+
+/*
+ * Reads the file in runs of lines on several threads, each with its own
+ * parser, and splices the points in in file order.  Lines don't depend on
+ * each other except that a track continues from one line to the next
+ * unless TRACK_NEW says otherwise, so a run's first track is joined to the
+ * last one before it.
+ */
+bool
+XcsvFormat::read_parallel(int threads)
+{
+  // Runs smaller than this aren't worth a thread.
+  constexpr qint64 kMinChunkSize = 64 * 1024;
+
+  const QString& fname = xcsv_file->fname;
+  if ((threads < 2) || (waypt_sink() != nullptr) || (xcsv_style->datatype == rtedata) ||
+      (fname == "-") || gpsbabel::MemoryFiles::contains(fname) ||
+      (!xcsv_style->codecname.isEmpty() &&
+       (xcsv_style->codecname.compare(u"UTF-8", Qt::CaseInsensitive) != 0))) {
+    return false;
+  }
+  gpsbabel::File file(fname);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  const qint64 size = file.size();
+  if (size < 2 * kMinChunkSize) {
+    return false;
+  }
+  uchar* map = file.map(0, size);
+  if (map == nullptr) {
+    return false;
+  }
+  const char* data = reinterpret_cast<const char*>(map);
+  const char* end = data + size;
+
+  // Only UTF-8, which the stream reads with any byte order mark skipped.
+  const char* begin = data;
+  std::optional<QStringConverter::Encoding> bom =
+    QStringConverter::encodingForData(QByteArrayView(data, 4));
+  if (bom.has_value()) {
+    if (bom.value() != QStringConverter::Utf8) {
+      file.unmap(map);
+      return false;
+    }
+    begin += 3;
+  }
+
+  const qint64 target = std::max((end - begin) / (threads * 4), kMinChunkSize);
+  std::vector<std::unique_ptr<ParallelChunk>> chunks;
+  int linecount = 0;
+  while (begin < end) {
+    const char* split = begin + std::min<qint64>(target, end - begin);
+    const auto* eol = static_cast<const char*>(memchr(split, '\n', end - split));
+    const char* next = (eol == nullptr) ? end : eol + 1;
+    if (end - next < kMinChunkSize) {
+      next = end;	/* keep any epilogue in the last run */
+    }
+    auto chunk = std::make_unique<ParallelChunk>();
+    chunk->begin = begin;
+    chunk->end = next;
+    chunk->linecount = linecount;
+    linecount += std::count(begin, next, '\n');
+    chunks.push_back(std::move(chunk));
+    begin = next;
+  }
+  chunks.back()->last = true;
+
+  const session_t* session = curr_session();
+  gpsbabel::TaskGroup group;
+  for (const auto& chunk : chunks) {
+    auto parser = std::make_unique<XcsvFormat>();
+    for (int i = 0; i < xcsv_args.size(); ++i) {
+      *parser->xcsv_args.at(i).argval = *xcsv_args.at(i).argval;
+    }
+    parser->xcsv_style = xcsv_style;
+    parser->ifields = ifields;
+    parser->xcsv_file = new XcsvFile;
+    parser->xcsv_file->gps_datum_idx = xcsv_file->gps_datum_idx;
+    parser->xcsv_file->datum_transform = xcsv_file->datum_transform;
+    parser->utc_offset = utc_offset;
+    parser->rd_linecount = chunk->linecount;
+    chunk->parser = std::move(parser);
+    ParallelChunk* c = chunk.get();
+    group.run([c, session]() {
+      read_chunk(*c, session);
+    });
+  }
+  // A fatal error in a run only gets here when fatal() throws, as in
+  // the library, and then everything the runs read is let go of first.
+  try {
+    group.wait();
+  } catch (const FatalError&) {
+    for (const auto& chunk : chunks) {
+      chunk->waypoints.flush();
+      chunk->tracks.flush();
+      delete chunk->parser->xcsv_file;
+      chunk->parser->xcsv_file = nullptr;
+      chunk->parser->xcsv_style = nullptr;
+    }
+    file.unmap(map);
+    throw;
+  }
+  file.unmap(map);
+
+  for (const auto& chunk : chunks) {
+    XcsvFormat* parser = chunk->parser.get();
+    waypt_splice(&chunk->waypoints);
+    if (!chunk->tracks.empty()) {
+      route_head* first = chunk->tracks.front();
+      if ((rd_track != nullptr) && !parser->rd_first_track_new) {
+        WaypointList points;
+        chunk->tracks.swap_wpts(first, points);
+        WaypointList track_points;
+        track_swap_wpts(rd_track, track_points);
+        track_points.splice(points);
+        track_swap_wpts(rd_track, track_points);
+        if (!first->rte_name.isEmpty()) {
+          rd_track->rte_name = first->rte_name;
         }
-        route_add_wpt(rte, wpt_tmp);
-        break;
-      default:
-        ;
+        chunk->tracks.del_head(first);
       }
+      if (!chunk->tracks.empty()) {
+        rd_track = chunk->tracks.back();
+      }
+      track_splice(&chunk->tracks);
     }
+    rd_linecount = parser->rd_linecount;
+    delete parser->xcsv_file;
+    parser->xcsv_file = nullptr;
+    parser->xcsv_style = nullptr;
   }
+  return true;
+}
+
+void
+XcsvFormat::read_chunk(ParallelChunk& chunk, const session_t* session)
+{
+  const ThreadScope scope;
+  waypt_use_list(&chunk.waypoints);
+  route_use_lists(&chunk.routes, &chunk.tracks);
+  use_session(session);
+
+  chunk.parser->xcsv_read_lines(chunk.begin, chunk.end);
+  chunk.parser->xcsv_read_epilogue(chunk.last);
 }
 
 void
@@ -977,6 +1504,162 @@ XcsvFormat::xcsv_resetpathlen(const route_head* head)
   }
 }
 
+/*****************************************************************************/
+/* xcsv_compile_ofields() - take the printf conversions of the output        */
+/*                  fields apart once per file, see xcsv_format_double().    */
+/*****************************************************************************/
+void
+XcsvFormat::xcsv_compile_ofields()
+{
+  if (xcsv_style->field_delimiter == u"\\w") {
+    wr_delimiter = " ";
+  } else {
+    wr_delimiter = xcsv_style->field_delimiter;
+  }
+
+  ofields.clear();
+  ofields.reserve(xcsv_style->ofields.size());
+  for (const auto& fmp : xcsv_style->ofields) {
+    xcsv_ofield field;
+    field.fmp = &fmp;
+    field.val = QString::fromUtf8(fmp.val);
+    field.smuggle_quotes = (fmp.printfc == "\"%s\"");
+    xcsv_compile_printfc(fmp.printfc, field);
+
+    switch (fmp.hashed_key) {
+    case XcsvStyle::XT_IGNORE:
+      field.constant = QString::asprintf(fmp.printfc.constData(), "");
+      break;
+    case XcsvStyle::XT_CONSTANT: {
+      auto cp = XcsvStyle::xcsv_get_char_from_constant_table(fmp.val.constData());
+      if (!cp.isEmpty()) {
+        field.constant = QString::asprintf(fmp.printfc.constData(), CSTR(cp));
+      } else {
+        field.constant = QString::asprintf(fmp.printfc.constData(), fmp.val.constData());
+      }
+    }
+    break;
+    case XcsvStyle::XT_unused:
+      if (fmp.key.startsWith("LON_10E")) {
+        field.scaled = &Waypoint::longitude;
+      } else if (fmp.key.startsWith("LAT_10E")) {
+        field.scaled = &Waypoint::latitude;
+      }
+      if (field.scaled != nullptr) {
+        field.scale = pow(10.0, strtod(fmp.key.constData() + 7, nullptr));
+      }
+      break;
+    default:
+      break;
+    }
+    ofields.append(field);
+  }
+}
+
+/*
+ * xcsv_compile_printfc - Split a printf format with at most one %s or %f
+ * conversion into the literal text around it and the conversion's flags,
+ * width and precision.  Anything else is left to QString::asprintf.
+ */
+void
+XcsvFormat::xcsv_compile_printfc(const QByteArray& printfc, xcsv_ofield& field)
+{
+  QByteArray prefix;
+  QByteArray suffix;
+  QByteArray* text = &prefix;
+  field.conv = xcsv_ofield::conversion::none;
+  for (qsizetype i = 0; i < printfc.size(); ++i) {
+    if (printfc.at(i) != '%') {
+      text->append(printfc.at(i));
+      continue;
+    }
+    if (++i == printfc.size()) {
+      field.conv = xcsv_ofield::conversion::other;
+      return;
+    }
+    if (printfc.at(i) == '%') {
+      text->append('%');
+      continue;
+    }
+    if (text == &suffix) {
+      field.conv = xcsv_ofield::conversion::other;
+      return;
+    }
+
+    for (; (i < printfc.size()) && ((printfc.at(i) == '-') || (printfc.at(i) == '0')); ++i) {
+      if (printfc.at(i) == '-') {
+        field.left_adjusted = true;
+      } else {
+        field.zero_padded = true;
+      }
+    }
+    for (; (i < printfc.size()) && isdigit(static_cast<unsigned char>(printfc.at(i))); ++i) {
+      field.width = field.width * 10 + (printfc.at(i) - '0');
+    }
+    if ((i < printfc.size()) && (printfc.at(i) == '.')) {
+      field.precision = 0;
+      for (++i; (i < printfc.size()) && isdigit(static_cast<unsigned char>(printfc.at(i))); ++i) {
+        field.precision = field.precision * 10 + (printfc.at(i) - '0');
+      }
+    }
+    bool is_long = (i < printfc.size()) && (printfc.at(i) == 'l');
+    if (is_long) {
+      ++i;
+    }
+    if ((i < printfc.size()) && (printfc.at(i) == 'f')) {
+      field.conv = xcsv_ofield::conversion::fixed;
+      if (field.precision < 0) {
+        field.precision = 6;
+      }
+    } else if ((i < printfc.size()) && (printfc.at(i) == 's') && !is_long && !field.zero_padded &&
+               (field.precision < 0)) {	/* asprintf cuts a precision in UTF-8 bytes */
+      field.conv = xcsv_ofield::conversion::string;
+    } else {
+      field.conv = xcsv_ofield::conversion::other;
+      return;
+    }
+    text = &suffix;
+  }
+  field.prefix = QString::fromUtf8(prefix);
+  field.suffix = QString::fromUtf8(suffix);
+}
+
+/* What QString::asprintf(fmp.printfc, value) gives, for a %f conversion. */
+QString
+XcsvFormat::xcsv_format_double(const xcsv_ofield& field, double value)
+{
+  // Leave the sign of zero and non-finite values to asprintf.
+  if ((field.conv != xcsv_ofield::conversion::fixed) || !std::isfinite(value) ||
+      ((value == 0.0) && std::signbit(value))) {
+    return QString::asprintf(field.fmp->printfc.constData(), value);
+  }
+  QString number = QString::number(value, 'f', field.precision);
+  if (number.size() < field.width) {
+    if (field.left_adjusted) {
+      number = number.leftJustified(field.width);
+    } else if (field.zero_padded) {
+      number.insert((value < 0) ? 1 : 0, QString(field.width - number.size(), '0'));
+    } else {
+      number = number.rightJustified(field.width);
+    }
+  }
+  return field.prefix + number + field.suffix;
+}
+
+/* What QString::asprintf(fmp.printfc, CSTR(value)) gives, for a %s conversion. */
+QString
+XcsvFormat::xcsv_format_str(const xcsv_ofield& field, const QString& value)
+{
+  if (field.conv != xcsv_ofield::conversion::string) {
+    return QString::asprintf(field.fmp->printfc.constData(), CSTR(value));
+  }
+  QString str = value;
+  if (str.size() < field.width) {
+    str = field.left_adjusted ? str.leftJustified(field.width) : str.rightJustified(field.width);
+  }
+  return field.prefix + str + field.suffix;
+}
+
 /*****************************************************************************/
 /* xcsv_waypt_pr() - write output file, handling output conversions          */
 /*                  (the output meat)                                        */
@@ -1000,13 +1683,6 @@ XcsvFormat::xcsv_waypt_pr(const Waypoint* wpt)
   latitude = wpt->latitude;
   longitude = wpt->longitude;
 
-  QString write_delimiter;
-  if (xcsv_style->field_delimiter == u"\\w") {
-    write_delimiter = " ";
-  } else {
-    write_delimiter = xcsv_style->field_delimiter;
-  }
-
   QString description;
   QString shortname;
   if (wpt->shortname.isEmpty() || global_opts.synthesize_shortnames) {
@@ -1038,12 +1714,13 @@ XcsvFormat::xcsv_waypt_pr(const Waypoint* wpt)
 
   if ((xcsv_file->gps_datum_idx > -1) && (xcsv_file->gps_datum_idx != kDatumWGS84)) {
     double alt;
-    GPS_Math_WGS84_To_Known_Datum_M(latitude, longitude, 0.0,
-                                    &latitude, &longitude, &alt, xcsv_file->gps_datum_idx);
+    xcsv_file->datum_transform.convert(latitude, longitude, 0.0,
+                                       &latitude, &longitude, &alt);
   }
 
   int i = 0;
-  for (const auto& fmp : std::as_const(xcsv_style->ofields)) {
+  for (const auto& field : std::as_const(ofields)) {
+    const XcsvStyle::field_map& fmp = *field.fmp;
     double lat = latitude;
     double lon = longitude;
     /*
@@ -1055,7 +1732,7 @@ XcsvFormat::xcsv_waypt_pr(const Waypoint* wpt)
     int field_is_unknown = 0;
 
     if ((i != 0) && !(fmp.options & XcsvStyle::options_nodelim)) {
-      xcsv_file->stream << write_delimiter;
+      xcsv_file->stream << wr_delimiter;
     }
 
     if (fmp.options & XcsvStyle::options_absolute) {
@@ -1068,23 +1745,16 @@ XcsvFormat::xcsv_waypt_pr(const Waypoint* wpt)
     switch (fmp.hashed_key) {
     case XcsvStyle::XT_IGNORE:
       /* IGNORE -- Write the char printf conversion */
-      buff = QString::asprintf(fmp.printfc.constData(), "");
+      buff = field.constant;
       break;
     case XcsvStyle::XT_INDEX:
       buff = QString::asprintf(fmp.printfc.constData(), waypt_out_count + xstrtoi(fmp.val.constData(), nullptr, 10));
       break;
-    case XcsvStyle::XT_CONSTANT: {
-      auto cp = XcsvStyle::xcsv_get_char_from_constant_table(fmp.val.constData());
-      if (!cp.isEmpty()) {
-        buff = QString::asprintf(fmp.printfc.constData(), CSTR(cp));
-      } else {
-        buff = QString::asprintf(fmp.printfc.constData(), fmp.val.constData());
-      }
-    }
-    break;
+    case XcsvStyle::XT_CONSTANT:
+      buff = field.constant;
+      break;
     case XcsvStyle::XT_SHORTNAME:
-      buff = QString::asprintf(fmp.printfc.constData(),
-                               shortname.isEmpty() ? fmp.val.constData() : CSTR(shortname));
+      buff = xcsv_format_str(field, shortname.isEmpty() ? field.val : shortname);
 
       break;
     case XcsvStyle::XT_ANYNAME: {
@@ -1099,19 +1769,17 @@ XcsvFormat::xcsv_waypt_pr(const Waypoint* wpt)
         anyname = wpt->notes;
       }
       if (anyname.isEmpty()) {
-        anyname = fmp.val.constData();
+        anyname = field.val;
       }
-      buff = QString::asprintf(fmp.printfc.constData(), CSTR(anyname));
+      buff = xcsv_format_str(field, anyname);
     }
 
     break;
     case XcsvStyle::XT_DESCRIPTION:
-      buff = QString::asprintf(fmp.printfc.constData(),
-                               description.isEmpty() ? fmp.val.constData() : CSTR(description));
+      buff = xcsv_format_str(field, description.isEmpty() ? field.val : description);
       break;
     case XcsvStyle::XT_NOTES:
-      buff = QString::asprintf(fmp.printfc.constData(),
-                               wpt->notes.isEmpty() ? fmp.val.constData() : CSTR(wpt->notes));
+      buff = xcsv_format_str(field, wpt->notes.isEmpty() ? field.val : wpt->notes);
       break;
     case XcsvStyle::XT_URL: {
       if (xcsv_urlbase) {
@@ -1119,29 +1787,26 @@ XcsvFormat::xcsv_waypt_pr(const Waypoint* wpt)
       }
       if (wpt->HasUrlLink()) {
         const UrlLink& l = wpt->GetUrlLink();
-        buff += QString::asprintf(fmp.printfc.constData(), CSTR(l.url_));
+        buff += xcsv_format_str(field, l.url_);
       } else {
-        buff += QString::asprintf(fmp.printfc.constData(), fmp.val.constData() && *fmp.val.constData() ? fmp.val.constData() : "\"\"");
+        buff += xcsv_format_str(field, field.val.isEmpty() ? QStringLiteral("\"\"") : field.val);
       }
     }
     break;
     case XcsvStyle::XT_URL_LINK_TEXT:
       if (wpt->HasUrlLink()) {
         const UrlLink& l = wpt->GetUrlLink();
-        buff = QString::asprintf(fmp.printfc.constData(),
-                                 !l.url_link_text_.isEmpty() ? CSTR(l.url_link_text_) : fmp.val.constData());
+        buff = xcsv_format_str(field, !l.url_link_text_.isEmpty() ? l.url_link_text_ : field.val);
       }
       break;
     case XcsvStyle::XT_ICON_DESCR:
-      buff = QString::asprintf(fmp.printfc.constData(),
-                               (!wpt->icon_descr.isNull()) ?
-                               CSTR(wpt->icon_descr) : fmp.val.constData());
+      buff = xcsv_format_str(field, (!wpt->icon_descr.isNull()) ? wpt->icon_descr : field.val);
       break;
 
     /* LATITUDE CONVERSION***********************************************/
     case XcsvStyle::XT_LAT_DECIMAL:
       /* latitude as a pure decimal value */
-      buff = QString::asprintf(fmp.printfc.constData(), lat);
+      buff = xcsv_format_double(field, lat);
       break;
     case XcsvStyle::XT_LAT_DECIMALDIR:
       /* latitude as a decimal value with N/S after it */
@@ -1167,13 +1832,13 @@ XcsvFormat::xcsv_waypt_pr(const Waypoint* wpt)
       buff = dec_to_human(fmp.printfc.constData(), "SN", lat);
       break;
     case XcsvStyle::XT_LAT_NMEA:
-      buff = QString::asprintf(fmp.printfc.constData(), degrees2ddmm(lat));
+      buff = xcsv_format_double(field, degrees2ddmm(lat));
       break;
     // case XcsvStyle::XT_LAT_10E is handled outside the switch.
     /* LONGITUDE CONVERSIONS*********************************************/
     case XcsvStyle::XT_LON_DECIMAL:
       /* longitude as a pure decimal value */
-      buff = QString::asprintf(fmp.printfc.constData(), lon);
+      buff = xcsv_format_double(field, lon);
       break;
     case XcsvStyle::XT_LON_DECIMALDIR:
       /* latitude as a decimal value with N/S after it */
@@ -1207,7 +1872,7 @@ XcsvFormat::xcsv_waypt_pr(const Waypoint* wpt)
       buff = buff.simplified();
       break;
     case XcsvStyle::XT_LON_NMEA:
-      buff = QString::asprintf(fmp.printfc.constData(), degrees2ddmm(lon));
+      buff = xcsv_format_double(field, degrees2ddmm(lon));
       break;
     // case XcsvStyle::XT_LON_10E is handled outside the switch.
     /* DIRECTIONS *******************************************************/
@@ -1264,27 +1929,25 @@ XcsvFormat::xcsv_waypt_pr(const Waypoint* wpt)
     case XcsvStyle::XT_UTM_NORTHING:
       GPS_Math_WGS84_To_UTM_EN(wpt->latitude, wpt->longitude,
                                &utme, &utmn, &utmz, &utmzc);
-      buff = QString::asprintf(fmp.printfc.constData(), utmn);
+      buff = xcsv_format_double(field, utmn);
       break;
     case XcsvStyle::XT_UTM_EASTING:
       GPS_Math_WGS84_To_UTM_EN(wpt->latitude, wpt->longitude,
                                &utme, &utmn, &utmz, &utmzc);
-      buff = QString::asprintf(fmp.printfc.constData(), utme);
+      buff = xcsv_format_double(field, utme);
       break;
 
     /* ALTITUDE CONVERSIONS**********************************************/
     case XcsvStyle::XT_ALT_FEET:
       /* altitude in feet as a decimal value */
       if (wpt->altitude != unknown_alt) {
-        buff = QString::asprintf(fmp.printfc.constData(),
-                                 METERS_TO_FEET(wpt->altitude));
+        buff = xcsv_format_double(field, METERS_TO_FEET(wpt->altitude));
       }
       break;
     case XcsvStyle::XT_ALT_METERS:
       /* altitude in meters as a decimal value */
       if (wpt->altitude != unknown_alt) {
-        buff = QString::asprintf(fmp.printfc.constData(),
-                                 wpt->altitude);
+        buff = xcsv_format_double(field, wpt->altitude);
       }
       break;
 
@@ -1294,58 +1957,58 @@ XcsvFormat::xcsv_waypt_pr(const Waypoint* wpt)
     case XcsvStyle::XT_PATH_DISTANCE_MILES:
       /* path (route/track) distance in miles */
       if (wpt->odometer_distance) {
-        buff = QString::asprintf(fmp.printfc.constData(), METERS_TO_MILES(wpt->odometer_distance));
+        buff = xcsv_format_double(field, METERS_TO_MILES(wpt->odometer_distance));
       } else {
-        buff = QString::asprintf(fmp.printfc.constData(), METERS_TO_MILES(pathdist));
+        buff = xcsv_format_double(field, METERS_TO_MILES(pathdist));
       }
       break;
     case XcsvStyle::XT_PATH_DISTANCE_NAUTICAL_MILES:
       /* path (route/track) distance in miles */
       if (wpt->odometer_distance) {
-        buff = QString::asprintf(fmp.printfc.constData(), METERS_TO_NMILES(wpt->odometer_distance));
+        buff = xcsv_format_double(field, METERS_TO_NMILES(wpt->odometer_distance));
       } else {
-        buff = QString::asprintf(fmp.printfc.constData(), METERS_TO_NMILES(pathdist));
+        buff = xcsv_format_double(field, METERS_TO_NMILES(pathdist));
       }
       break;
     case XcsvStyle::XT_PATH_DISTANCE_METERS:
       /* path (route/track) distance in meters */
       if (wpt->odometer_distance) {
-        buff = QString::asprintf(fmp.printfc.constData(), wpt->odometer_distance);
+        buff = xcsv_format_double(field, wpt->odometer_distance);
       } else {
-        buff = QString::asprintf(fmp.printfc.constData(), pathdist);
+        buff = xcsv_format_double(field, pathdist);
       }
       break;
     case XcsvStyle::XT_PATH_DISTANCE_KM:
       /* path (route/track) distance in kilometers */
       if (wpt->odometer_distance) {
-        buff = QString::asprintf(fmp.printfc.constData(), wpt->odometer_distance / 1000.0);
+        buff = xcsv_format_double(field, wpt->odometer_distance / 1000.0);
       } else {
-        buff = QString::asprintf(fmp.printfc.constData(), pathdist / 1000.0);
+        buff = xcsv_format_double(field, pathdist / 1000.0);
       }
       break;
     case XcsvStyle::XT_PATH_SPEED:
       if (wpt->speed_has_value()) {
-        buff = QString::asprintf(fmp.printfc.constData(), wpt->speed_value());
+        buff = xcsv_format_double(field, wpt->speed_value());
       }
       break;
     case XcsvStyle::XT_PATH_SPEED_KPH:
       if (wpt->speed_has_value()) {
-        buff = QString::asprintf(fmp.printfc.constData(), MPS_TO_KPH(wpt->speed_value()));
+        buff = xcsv_format_double(field, MPS_TO_KPH(wpt->speed_value()));
       }
       break;
     case XcsvStyle::XT_PATH_SPEED_MPH:
       if (wpt->speed_has_value()) {
-        buff = QString::asprintf(fmp.printfc.constData(), MPS_TO_MPH(wpt->speed_value()));
+        buff = xcsv_format_double(field, MPS_TO_MPH(wpt->speed_value()));
       }
       break;
     case XcsvStyle::XT_PATH_SPEED_KNOTS:
       if (wpt->speed_has_value()) {
-        buff = QString::asprintf(fmp.printfc.constData(), MPS_TO_KNOTS(wpt->speed_value()));
+        buff = xcsv_format_double(field, MPS_TO_KNOTS(wpt->speed_value()));
       }
       break;
     case XcsvStyle::XT_PATH_COURSE:
       if (wpt->course_has_value()) {
-        buff = QString::asprintf(fmp.printfc.constData(), wpt->course_value());
+        buff = xcsv_format_double(field, wpt->course_value());
       }
       break;
 
@@ -1364,24 +2027,24 @@ XcsvFormat::xcsv_waypt_pr(const Waypoint* wpt)
     /* POWER CONVERSION***********************************************/
     case XcsvStyle::XT_POWER:
       if (wpt->power) {
-        buff = QString::asprintf(fmp.printfc.constData(), wpt->power);
+        buff = xcsv_format_double(field, wpt->power);
       }
       break;
     case XcsvStyle::XT_TEMPERATURE:
       if (wpt->temperature_has_value()) {
-        buff = QString::asprintf(fmp.printfc.constData(), wpt->temperature_value());
+        buff = xcsv_format_double(field, wpt->temperature_value());
       }
       break;
     case XcsvStyle::XT_TEMPERATURE_F:
       if (wpt->temperature_has_value()) {
-        buff = QString::asprintf(fmp.printfc.constData(), CELSIUS_TO_FAHRENHEIT(wpt->temperature_value()));
+        buff = xcsv_format_double(field, CELSIUS_TO_FAHRENHEIT(wpt->temperature_value()));
       }
       break;
     /* TIME CONVERSIONS**************************************************/
     case XcsvStyle::XT_EXCEL_TIME:
       /* creation time as an excel (double) time */
       if (wpt->GetCreationTime().isValid()) {
-        buff = QString::asprintf(fmp.printfc.constData(), timetms_to_excel(wpt->GetCreationTime().toMSecsSinceEpoch()));
+        buff = xcsv_format_double(field, timetms_to_excel(wpt->GetCreationTime().toMSecsSinceEpoch()));
       }
       break;
     case XcsvStyle::XT_TIMET_TIME:
@@ -1428,48 +2091,48 @@ XcsvFormat::xcsv_waypt_pr(const Waypoint* wpt)
     /* GEOCACHE STUFF **************************************************/
     case XcsvStyle::XT_GEOCACHE_DIFF:
       /* Geocache Difficulty as a double */
-      buff = QString::asprintf(fmp.printfc.constData(), wpt->gc_data->diff / 10.0);
+      buff = xcsv_format_double(field, wpt->gc_data->diff / 10.0);
       field_is_unknown = !wpt->gc_data->diff;
       break;
     case XcsvStyle::XT_GEOCACHE_TERR:
       /* Geocache Terrain as a double */
-      buff = QString::asprintf(fmp.printfc.constData(), wpt->gc_data->terr / 10.0);
+      buff = xcsv_format_double(field, wpt->gc_data->terr / 10.0);
       field_is_unknown = !wpt->gc_data->terr;
       break;
     case XcsvStyle::XT_GEOCACHE_CONTAINER:
       /* Geocache Container */
-      buff = QString::asprintf(fmp.printfc.constData(), CSTR(wpt->gc_data->get_container()));
+      buff = xcsv_format_str(field, wpt->gc_data->get_container());
       field_is_unknown = wpt->gc_data->container == Geocache::container_t::gc_unknown;
       break;
     case XcsvStyle::XT_GEOCACHE_TYPE:
       /* Geocache Type */
-      buff = QString::asprintf(fmp.printfc.constData(), CSTR(wpt->gc_data->get_type()));
+      buff = xcsv_format_str(field, wpt->gc_data->get_type());
       field_is_unknown = wpt->gc_data->type == Geocache::type_t::gt_unknown;
       break;
     case XcsvStyle::XT_GEOCACHE_HINT:
-      buff = QString::asprintf(fmp.printfc.constData(), CSTR(wpt->gc_data->hint));
+      buff = xcsv_format_str(field, wpt->gc_data->hint);
       field_is_unknown = !wpt->gc_data->hint.isEmpty();
       break;
     case XcsvStyle::XT_GEOCACHE_PLACER:
-      buff = QString::asprintf(fmp.printfc.constData(), CSTR(wpt->gc_data->placer));
+      buff = xcsv_format_str(field, wpt->gc_data->placer);
       field_is_unknown = !wpt->gc_data->placer.isEmpty();
       break;
     case XcsvStyle::XT_GEOCACHE_ISAVAILABLE:
       if (wpt->gc_data->is_available == Geocache::status_t::gs_false) {
-        buff = QString::asprintf(fmp.printfc.constData(), "False");
+        buff = xcsv_format_str(field, QStringLiteral("False"));
       } else if (wpt->gc_data->is_available == Geocache::status_t::gs_true) {
-        buff = QString::asprintf(fmp.printfc.constData(), "True");
+        buff = xcsv_format_str(field, QStringLiteral("True"));
       } else {
-        buff = QString::asprintf(fmp.printfc.constData(), "Unknown");
+        buff = xcsv_format_str(field, QStringLiteral("Unknown"));
       }
       break;
     case XcsvStyle::XT_GEOCACHE_ISARCHIVED:
       if (wpt->gc_data->is_archived == Geocache::status_t::gs_false) {
-        buff = QString::asprintf(fmp.printfc.constData(), "False");
+        buff = xcsv_format_str(field, QStringLiteral("False"));
       } else if (wpt->gc_data->is_archived == Geocache::status_t::gs_true) {
-        buff = QString::asprintf(fmp.printfc.constData(), "True");
+        buff = xcsv_format_str(field, QStringLiteral("True"));
       } else {
-        buff = QString::asprintf(fmp.printfc.constData(), "Unknown");
+        buff = xcsv_format_str(field, QStringLiteral("Unknown"));
       }
       break;
     /* Tracks and Routes ***********************************************/
@@ -1484,26 +2147,26 @@ XcsvFormat::xcsv_waypt_pr(const Waypoint* wpt)
       break;
     case XcsvStyle::XT_TRACK_NAME:
       if (csv_track) {
-        buff = QString::asprintf(fmp.printfc.constData(), CSTR(csv_track->rte_name));
+        buff = xcsv_format_str(field, csv_track->rte_name);
       }
       break;
     case XcsvStyle::XT_ROUTE_NAME:
       if (csv_route) {
-        buff = QString::asprintf(fmp.printfc.constData(), CSTR(csv_route->rte_name));
+        buff = xcsv_format_str(field, csv_route->rte_name);
       }
       break;
 
     /* GPS STUFF *******************************************************/
     case XcsvStyle::XT_GPS_HDOP:
-      buff = QString::asprintf(fmp.printfc.constData(), wpt->hdop);
+      buff = xcsv_format_double(field, wpt->hdop);
       field_is_unknown = !wpt->hdop;
       break;
     case XcsvStyle::XT_GPS_VDOP:
-      buff = QString::asprintf(fmp.printfc.constData(), wpt->vdop);
+      buff = xcsv_format_double(field, wpt->vdop);
       field_is_unknown = !wpt->vdop;
       break;
     case XcsvStyle::XT_GPS_PDOP:
-      buff = QString::asprintf(fmp.printfc.constData(), wpt->pdop);
+      buff = xcsv_format_double(field, wpt->pdop);
       field_is_unknown = !wpt->pdop;
       break;
     case XcsvStyle::XT_GPS_SAT:
@@ -1539,56 +2202,56 @@ XcsvFormat::xcsv_waypt_pr(const Waypoint* wpt)
     /* GMSD ************************************************************/
     case XcsvStyle::XT_COUNTRY: {
       const garmin_fs_t* gmsd = garmin_fs_t::find(wpt);
-      buff = QString::asprintf(fmp.printfc.constData(), CSTR(garmin_fs_t::get_country(gmsd, "")));
+      buff = xcsv_format_str(field, garmin_fs_t::get_country(gmsd, ""));
     }
     break;
     case XcsvStyle::XT_STATE: {
       const garmin_fs_t* gmsd = garmin_fs_t::find(wpt);
-      buff = QString::asprintf(fmp.printfc.constData(), CSTR(garmin_fs_t::get_state(gmsd, "")));
+      buff = xcsv_format_str(field, garmin_fs_t::get_state(gmsd, ""));
     }
     break;
     case XcsvStyle::XT_CITY: {
       const garmin_fs_t* gmsd = garmin_fs_t::find(wpt);
-      buff = QString::asprintf(fmp.printfc.constData(), CSTR(garmin_fs_t::get_city(gmsd, "")));
+      buff = xcsv_format_str(field, garmin_fs_t::get_city(gmsd, ""));
     }
     break;
     case XcsvStyle::XT_POSTAL_CODE: {
       const garmin_fs_t* gmsd = garmin_fs_t::find(wpt);
-      buff = QString::asprintf(fmp.printfc.constData(), CSTR(garmin_fs_t::get_postal_code(gmsd, "")));
+      buff = xcsv_format_str(field, garmin_fs_t::get_postal_code(gmsd, ""));
     }
     break;
     case XcsvStyle::XT_STREET_ADDR: {
       const garmin_fs_t* gmsd = garmin_fs_t::find(wpt);
-      buff = QString::asprintf(fmp.printfc.constData(), CSTR(garmin_fs_t::get_addr(gmsd, "")));
+      buff = xcsv_format_str(field, garmin_fs_t::get_addr(gmsd, ""));
     }
     break;
     case XcsvStyle::XT_PHONE_NR: {
       const garmin_fs_t* gmsd = garmin_fs_t::find(wpt);
-      buff = QString::asprintf(fmp.printfc.constData(), CSTR(garmin_fs_t::get_phone_nr(gmsd, "")));
+      buff = xcsv_format_str(field, garmin_fs_t::get_phone_nr(gmsd, ""));
     }
     break;
     case XcsvStyle::XT_FACILITY: {
       const garmin_fs_t* gmsd = garmin_fs_t::find(wpt);
-      buff = QString::asprintf(fmp.printfc.constData(), CSTR(garmin_fs_t::get_facility(gmsd, "")));
+      buff = xcsv_format_str(field, garmin_fs_t::get_facility(gmsd, ""));
     }
     break;
     case XcsvStyle::XT_EMAIL: {
       const garmin_fs_t* gmsd = garmin_fs_t::find(wpt);
-      buff = QString::asprintf(fmp.printfc.constData(), CSTR(garmin_fs_t::get_email(gmsd, "")));
+      buff = xcsv_format_str(field, garmin_fs_t::get_email(gmsd, ""));
     }
     break;
     /* specials */
     case XcsvStyle::XT_FILENAME:
-      buff = QString::asprintf(fmp.printfc.constData(), CSTR(wpt->session->filename));
+      buff = xcsv_format_str(field, wpt->session->filename);
       break;
     case XcsvStyle::XT_FORMAT:
-      buff = QString::asprintf(fmp.printfc.constData(), CSTR(wpt->session->name));
+      buff = xcsv_format_str(field, wpt->session->name);
       break;
     case XcsvStyle::XT_unused:
-      if (strncmp(fmp.key.constData(), "LON_10E", 7) == 0) {
-        buff = QString::asprintf(fmp.printfc.constData(), lon * pow(10.0, strtod(fmp.key.constData()+7, nullptr)));
-      } else if (strncmp(fmp.key.constData(), "LAT_10E", 7) == 0) {
-        buff = QString::asprintf(fmp.printfc.constData(), lat * pow(10.0, strtod(fmp.key.constData()+7, nullptr)));
+      if (field.scaled == &Waypoint::longitude) {
+        buff = xcsv_format_double(field, lon * field.scale);
+      } else if (field.scaled == &Waypoint::latitude) {
+        buff = xcsv_format_double(field, lat * field.scale);
       }
       break;
     default:
@@ -1609,7 +2272,7 @@ XcsvFormat::xcsv_waypt_pr(const Waypoint* wpt)
     /* As a special case (pronounced "horrible hack") we allow
      * ""%s"" to smuggle bad characters through.
      */
-    if (0 == strcmp(fmp.printfc.constData(), "\"%s\"")) {
+    if (field.smuggle_quotes) {
       obuff = '"' + obuff + '"';
     }
     xcsv_file->stream << obuff;
@@ -1843,9 +2506,25 @@ XcsvStyle::xcsv_parse_style_line(XcsvStyle* style, QString line)
   }
 }
 
+/*
+ * The bundled styles are resources that can't change while we run, so
+ * each of them is only parsed the first time it is used, by a format or
+ * by the format list.  Style files given with style= are read every time.
+ */
 XcsvStyle
 XcsvStyle::xcsv_read_style(const QString& fname)
 {
+  static QMutex bundled_mutex;
+  static QHash<QString, XcsvStyle> bundled_styles;
+
+  const bool bundled = fname.startsWith(u":/");
+  if (bundled) {
+    QMutexLocker locker(&bundled_mutex);
+    if (auto it = bundled_styles.constFind(fname); it != bundled_styles.constEnd()) {
+      return *it;
+    }
+  }
+
   XcsvStyle style;
 
   gpsbabel::TextStream stream;
@@ -1861,13 +2540,19 @@ XcsvStyle::xcsv_read_style(const QString& fname)
     style.ofields = style.ifields;
   }
 
+  if (bundled) {
+    QMutexLocker locker(&bundled_mutex);
+    bundled_styles.insert(fname, style);
+  }
   return style;
 }
 
 void
-XcsvFormat::xcsv_setup_internal_style(const QString& style_filename)
+XcsvFormat::xcsv_setup_internal_style(const QString& style_filename,
+                                      std::shared_ptr<const XcsvStyle> compiled)
 {
   intstylefile = style_filename;
+  compiled_style = std::move(compiled);
 }
 
 void
@@ -1877,7 +2562,9 @@ XcsvFormat::rd_init(const QString& fname)
    * if we don't have an internal style defined, we need to
    * read it from a user-supplied style file, or die trying.
    */
-  if (!intstylefile.isEmpty()) {
+  if (compiled_style) {
+    xcsv_style = new XcsvStyle(*compiled_style);
+  } else if (!intstylefile.isEmpty()) {
     xcsv_style = new XcsvStyle(XcsvStyle::xcsv_read_style(intstylefile));
   } else {
     if (!styleopt) {
@@ -1886,6 +2573,11 @@ XcsvFormat::rd_init(const QString& fname)
 
     xcsv_style = new XcsvStyle(XcsvStyle::xcsv_read_style(styleopt));
   }
+  xcsv_compile_ifields();
+  rd_linecount = 0;
+  rd_lookbehind.clear();
+  rd_route = nullptr;
+  rd_track = nullptr;
 
   if ((xcsv_style->datatype == 0) || (xcsv_style->datatype == wptdata)) {
     if (global_opts.masked_objective & (TRKDATAMASK|RTEDATAMASK)) {
@@ -1913,6 +2605,7 @@ XcsvFormat::rd_init(const QString& fname)
   if (xcsv_file->gps_datum_idx < 0) {
     fatal(MYNAME ": datum \"%s\" is not supported.", qPrintable(datum_name));
   }
+  xcsv_file->datum_transform = GPS_Math_Known_Datum_To_WGS84_Setup(xcsv_file->gps_datum_idx);
 
   utc_offset = (opt_utc == nullptr)? 0 : xstrtoi(opt_utc, nullptr, 10) * SECONDS_PER_HOUR;
 }
@@ -1924,6 +2617,7 @@ XcsvFormat::rd_deinit()
   delete xcsv_file;
   xcsv_file = nullptr;
 
+  ifields.clear();
   delete xcsv_style;
   xcsv_style = nullptr;
 }
@@ -1935,7 +2629,9 @@ XcsvFormat::wr_init(const QString& fname)
    * if we don't have an internal style defined, we need to
    * read it from a user-supplied style file, or die trying.
    */
-  if (!intstylefile.isEmpty()) {
+  if (compiled_style) {
+    xcsv_style = new XcsvStyle(*compiled_style);
+  } else if (!intstylefile.isEmpty()) {
     xcsv_style = new XcsvStyle(XcsvStyle::xcsv_read_style(intstylefile));
   } else {
     if (!styleopt) {
@@ -1944,6 +2640,7 @@ XcsvFormat::wr_init(const QString& fname)
 
     xcsv_style = new XcsvStyle(XcsvStyle::xcsv_read_style(styleopt));
   }
+  xcsv_compile_ofields();
 
   xcsv_file = new XcsvFile;
   if (xcsv_style->codecname.isEmpty()) {
@@ -1995,6 +2692,7 @@ XcsvFormat::wr_init(const QString& fname)
   if (xcsv_file->gps_datum_idx < 0) {
     fatal(MYNAME ": datum \"%s\" is not supported.", qPrintable(datum_name));
   }
+  xcsv_file->datum_transform = GPS_Math_WGS84_To_Known_Datum_Setup(xcsv_file->gps_datum_idx);
 }
 
 void
@@ -2009,6 +2707,7 @@ XcsvFormat::wr_deinit()
   xcsv_file->stream.close();
   delete xcsv_file;
   xcsv_file = nullptr;
+  ofields.clear();
 
   delete xcsv_style;
   xcsv_style = nullptr;
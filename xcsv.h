@@ -22,8 +22,9 @@
 #define XCSV_H_INCLUDED_
 
 #include <ctime>
+#include <memory>                 // for shared_ptr, unique_ptr
 #include <optional>               // for optional
-#include <utility>                // for move
+#include <utility>                // for move, pair
 
 #include <QByteArray>             // for QByteArray
 #include <QDate>                  // for QDate
@@ -32,6 +33,7 @@
 #include <QList>                  // for QList
 #include <QString>                // for QString
 #include <QStringList>            // for QStringList
+#include <QStringView>            // for QStringView
 #include <QTime>                  // for QTime
 #include <QVector>                // for QVector
 #include <QtGlobal>               // for qRound64
@@ -39,7 +41,9 @@
 #include "defs.h"
 #include "format.h"               // for Format
 #include "garmin_fs.h"            // for garmin_fs_t
+#include "jeeps/gpsmath.h"        // for GPS_Molodensky
 #include "mkshort.h"              // for MakeShort
+#include "session.h"              // for session_t
 #include "src/core/datetime.h"    // for DateTime
 #include "src/core/textstream.h"  // for TextStream
 
@@ -290,8 +294,14 @@ public:
   void wr_position_init(const QString& fname) override;
   void wr_position(Waypoint* wpt) override;
   void wr_position_deinit() override;
+  bool rd_can_run_concurrently() const override
+  {
+    return true;
+  }
 
-  void xcsv_setup_internal_style(const QString& style_filename);
+  // A compiled style, if given, is used instead of reading the style file.
+  void xcsv_setup_internal_style(const QString& style_filename,
+                                 std::shared_ptr<const XcsvStyle> compiled = nullptr);
 
 private:
   /* Types */
@@ -305,6 +315,7 @@ private:
     gpsbabel::TextStream stream;
     QString fname;
     int gps_datum_idx{-1};		/* result of GPS_Lookup_Datum_Index */
+    GPS_Molodensky datum_transform;	/* to WGS 84 when reading, from it when writing */
     MakeShort mkshort_handle;
   };
 
@@ -326,6 +337,53 @@ private:
     bool need_datetime{true};
   };
 
+  struct ParallelChunk {
+    const char* begin{nullptr};
+    const char* end{nullptr};
+    int linecount{0};	/* lines before begin */
+    bool last{false};	/* runs to the end of the file */
+    std::unique_ptr<XcsvFormat> parser;
+    WaypointList waypoints;
+    RouteList routes;
+    RouteList tracks;
+  };
+
+  /* a conversion or literal character of a GMT_TIME or LOCAL_TIME format */
+  struct xcsv_time_part {
+    char conv{'\0'};		/* one of "YymdHMS", or '\0' for a literal */
+    char literal{'\0'};
+  };
+
+  /* an input field with what doesn't depend on the data resolved */
+  struct xcsv_ifield {
+    const XcsvStyle::field_map* fmp{nullptr};
+    XcsvStyle::xcsv_token token{XcsvStyle::XT_unused};
+    QString enclosure;
+    bool wants_utf8{true};		/* the conversion works on a char string */
+    double Waypoint::* scaled{nullptr};	/* LAT_10E and LON_10E target */
+    double divisor{1.0};
+    QList<xcsv_time_part> time_layout;	/* empty if only strptime will do */
+  };
+
+  /* an output field with its printf conversion taken apart */
+  struct xcsv_ofield {
+    enum class conversion {none, string, fixed, other};
+
+    const XcsvStyle::field_map* fmp{nullptr};
+    QString val;			/* the default value */
+    QString constant;		/* the whole output of IGNORE and CONSTANT */
+    bool smuggle_quotes{false};	/* printfc is "%s" in quotes */
+    double Waypoint::* scaled{nullptr};	/* LAT_10E and LON_10E source */
+    double scale{1.0};
+    conversion conv{conversion::other};	/* other goes through QString::asprintf */
+    QString prefix;
+    QString suffix;
+    int width{0};
+    int precision{-1};
+    bool left_adjusted{false};
+    bool zero_padded{false};
+  };
+
   /* Constants */
 
   static constexpr char lat_dir(double a)
@@ -349,14 +407,29 @@ private:
 
   /* Member Functions */
 
-  static QDate yyyymmdd_to_time(const QString& s);
+  static QDate yyyymmdd_to_time(QStringView s);
   QDateTime xcsv_adjust_time(QDate date, QTime time, bool is_localtime) const;
+  static QList<xcsv_time_part> xcsv_compile_time_layout(const QByteArray& format);
+  static bool xcsv_scan_time_layout(QStringView value, const QList<xcsv_time_part>& layout, QDate& date, QTime& time);
+  static void xcsv_parse_time(QStringView value, const xcsv_ifield& field, QDate& date, QTime& time);
   static void sscanftime(const char* s, const char* format, QDate& date, QTime& time);
   static QString writetime(const char* format, time_t t, bool gmt);
   static QString writetime(const char* format, const gpsbabel::DateTime& t, bool gmt);
   static long int time_to_yyyymmdd(const QDateTime& t);
   static garmin_fs_t* gmsd_init(Waypoint* wpt);
-  static void xcsv_parse_val(const QString& value, Waypoint* wpt, const XcsvStyle::field_map& fmp, xcsv_parse_data* parse_data, int line_no);
+  void xcsv_compile_ifields();
+  void xcsv_compile_ofields();
+  static void xcsv_compile_printfc(const QByteArray& printfc, xcsv_ofield& field);
+  static QString xcsv_format_double(const xcsv_ofield& field, double value);
+  static QString xcsv_format_str(const xcsv_ofield& field, const QString& value);
+  void xcsv_read_line(QString& buff);
+  void xcsv_read_epilogue(bool at_end);
+  void xcsv_parse_line(const QString& buff, int line_no);
+  void xcsv_read_lines(const char* begin, const char* end);
+  bool read_parallel(int threads);
+  void read_incremental();
+  static void read_chunk(ParallelChunk& chunk, const session_t* session);
+  static void xcsv_parse_val(QStringView value, Waypoint* wpt, const xcsv_ifield& field, xcsv_parse_data* parse_data, int line_no);
   void xcsv_resetpathlen(const route_head* head);
   void xcsv_waypt_pr(const Waypoint* wpt);
   QString xcsv_replace_tokens(const QString& original) const;
@@ -365,6 +438,16 @@ private:
 
   XcsvFile* xcsv_file{nullptr};
   const XcsvStyle* xcsv_style{nullptr};
+  QList<xcsv_ifield> ifields;
+  QList<xcsv_ofield> ofields;
+  QString wr_delimiter;
+  QList<QStringView> split_fields;	/* csv_linesplit buffers, reused per line */
+  QString split_scratch;
+  int rd_linecount{0};
+  QList<std::pair<int, QString>> rd_lookbehind;	/* line numbers and lines */
+  route_head* rd_route{nullptr};
+  route_head* rd_track{nullptr};
+  bool rd_first_track_new{false};	/* TRACK_NEW started the first track */
   double pathdist = 0;
   std::optional<PositionDeg> old_position;
 
@@ -381,9 +464,12 @@ private:
   char* xcsv_urlbase = nullptr;
   char* opt_datum = nullptr;
   char* opt_utc = nullptr;
+  char* opt_threads = nullptr;
+  char* opt_checkpoint = nullptr;
   int utc_offset{};
 
   QString intstylefile;
+  std::shared_ptr<const XcsvStyle> compiled_style;
 
   QVector<arglist_t> xcsv_args = {
     {
@@ -423,6 +509,16 @@ private:
       "utc",   &opt_utc,   "Write timestamps with offset x to UTC time",
       nullptr, ARGTYPE_INT, "-14", "+14", nullptr
     },
+    {
+      "threads", &opt_threads,
+      "Read large files on this many threads",
+      nullptr, ARGTYPE_INT, "1", nullptr, nullptr
+    },
+    {
+      "checkpoint", &opt_checkpoint,
+      "Only read what was appended since this checkpoint",
+      nullptr, ARGTYPE_OUTFILE, ARG_NOMINMAX, nullptr
+    },
   };
 
 };
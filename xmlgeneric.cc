@@ -29,17 +29,25 @@
 #include <QLatin1Char>           // for QLatin1Char
 #include <QStringView>           // for QStringView
 #include <QTextCodec>            // for QTextCodec
-#include <QXmlStreamAttributes>  // for QXmlStreamAttributes, QXmlStreamReader::Characters, QXmlStreamReader::EndElement, QXmlStreamReader::IncludeChildElements, QXmlStreamReader::StartDocument, QXmlStreamReader::StartElement
-#include <QXmlStreamReader>      // for QXmlStreamReader
+#include <QXmlStreamAttributes>  // for QXmlStreamAttributes
+#include <QXmlStreamReader>      // for QXmlStreamReader, QXmlStreamReader::Characters, QXmlStreamReader::EndElement, QXmlStreamReader::StartDocument, QXmlStreamReader::StartElement
 //#include <QtCore>                // for QHash, QIODeviceBase::ReadOnly
 #include <QtGlobal>              // for qPrintable
 
 #include "defs.h"                // for fatal
+#include "src/core/budget.h"     // for Budget
+#include "src/core/counters.h"   // for Counter
 #include "src/core/file.h"       // for File
+#include "src/core/trace.h"      // for TraceSpan
+#include "src/core/xmlpullreader.h"  // for XmlPullReader
 
 
 #define MYNAME "XML Reader"
 
+static gpsbabel::Counter elements_counter("xml.elements");
+static gpsbabel::Counter paths_counter("xml.paths");
+static gpsbabel::Counter regex_counter("xml.regex_matches");
+
 /***********************************************************************
  * These implement a simple interface for "generic" XML that
  * maps reasonably close to  1:1 between XML tags and internal data
@@ -50,18 +58,65 @@
  * xml strains and insulates us from a lot of the grubbiness of expat.
  */
 
-XmlGenericReader::XgCallbackBase*
-XmlGenericReader::xml_tbl_lookup(const QString& tag, xg_cb_type cb_type)
+// The first table entry of each type whose pattern matches the path wins.
+XmlGenericReader::xg_path_callbacks
+XmlGenericReader::xml_tbl_match(const QString& tag) const
 {
+  xg_path_callbacks cbs{};
   for (const auto& tm : std::as_const(xg_tag_tbl)) {
-    if (cb_type == tm.cb_type) {
-      QRegularExpressionMatch match = tm.tag_re.match(tag);
-      if (match.hasMatch()) {
-        return tm.tag_cb.get();
-      }
+    auto& cb = cbs[static_cast<int>(tm.cb_type)];
+    if (cb != nullptr) {
+      continue;
+    }
+    if (!tm.tag_is_literal) {
+      regex_counter.add();
+    }
+    bool matched = tm.tag_is_literal ? (tm.tag_literal == tag) :
+                   tm.tag_re.match(tag).hasMatch();
+    if (matched) {
+      cb = tm.tag_cb.get();
     }
   }
-  return nullptr;
+  return cbs;
+}
+
+// Start over with just the root, whose path is empty.
+void
+XmlGenericReader::xml_path_reset()
+{
+  xg_path_tree.clear();
+  xg_path_node root;
+  root.callbacks = xml_tbl_match(root.path);
+  xg_path_tree.append(root);
+}
+
+// Find the child of a path node, adding it the first time it is seen.
+// Documents repeat the same few element paths over and over, so the
+// patterns are matched once per distinct path and nothing is allocated
+// for elements on a known path.
+XmlGenericReader::xg_path_child
+XmlGenericReader::xml_path_child(int parent, QStringView qualified_name, QStringView name)
+{
+  for (const auto& child : std::as_const(xg_path_tree[parent].children)) {
+    if (child.qualified_name == qualified_name) {
+      return child;
+    }
+  }
+
+  xg_path_child child;
+  child.qualified_name = qualified_name.toString();
+  child.shortcut = xml_shortcut(name);
+  child.node = parent;
+  if (child.shortcut == xg_shortcut::sc_none) {
+    xg_path_node node;
+    node.path = xg_path_tree.at(parent).path + QLatin1Char('/') + child.qualified_name;
+    node.callbacks = xml_tbl_match(node.path);
+    paths_counter.add();
+    child.node = xg_path_tree.size();
+    xg_path_tree.append(node);
+  }
+  xg_path_tree[parent].children.append(child);
+  return child;
 }
 
 void
@@ -90,6 +145,7 @@ XmlGenericReader::xml_common_init(const QString& fname, const char* encoding,
       xg_shortcut_taglist.insert(QString::fromUtf8(*skiplist), xg_shortcut::sc_skip);
     }
   }
+  xml_path_reset();
 }
 
 XmlGenericReader::xg_shortcut
@@ -103,12 +159,14 @@ XmlGenericReader::xml_shortcut(QStringView name)
 }
 
 void
-XmlGenericReader::xml_run_parser(QXmlStreamReader& reader)
+XmlGenericReader::xml_run_parser(gpsbabel::XmlPullReader& reader)
 {
+  gpsbabel::TraceSpan span("xml", QStringLiteral("xml_run_parser"));
   XgCallbackBase* cb;
-  QString current_tag;
+  QList<xg_open_element> open_elements;
 
   while (!reader.atEnd()) {
+    gpsbabel::Budget::check();
     switch (reader.tokenType()) {
     case QXmlStreamReader::StartDocument:
       if (!reader.documentEncoding().isEmpty()) {
@@ -122,48 +180,55 @@ XmlGenericReader::xml_run_parser(QXmlStreamReader& reader)
       }
       break;
 
-    case QXmlStreamReader::StartElement:
-      switch (xml_shortcut(reader.name())) {
+    case QXmlStreamReader::StartElement: {
+      elements_counter.add();
+      int parent = open_elements.isEmpty() ? 0 : open_elements.constLast().node;
+      const xg_path_child child = xml_path_child(parent, reader.qualifiedName(), reader.name());
+      switch (child.shortcut) {
       case xg_shortcut::sc_skip:
         reader.skipCurrentElement();
         goto readnext;
       case xg_shortcut::sc_ignore:
+        // The element is left out of the path, its children are not.
+        open_elements.append({parent, true});
         goto readnext;
       default:
         break;
       }
 
-      current_tag.append(QLatin1Char('/'));
-      current_tag.append(reader.qualifiedName());
+      open_elements.append({child.node, false});
+      const xg_path_callbacks callbacks = xg_path_tree.at(child.node).callbacks;
 
-      cb = xml_tbl_lookup(current_tag, xg_cb_type::cb_start);
+      cb = callbacks[static_cast<int>(xg_cb_type::cb_start)];
       if (cb) {
         const QXmlStreamAttributes attrs = reader.attributes();
         (*cb)(nullptr, &attrs);
       }
 
-      cb = xml_tbl_lookup(current_tag, xg_cb_type::cb_cdata);
+      cb = callbacks[static_cast<int>(xg_cb_type::cb_cdata)];
       if (cb) {
-        QString c = reader.readElementText(QXmlStreamReader::IncludeChildElements);
+        QString c = reader.readElementText();
         // readElementText advances the tokenType to QXmlStreamReader::EndElement,
         // thus we will not process the EndElement case as we will issue a readNext first.
         // does a caller ever expect to be able to use both a cb_cdata and a
         // cb_end callback?
         (*cb)(c, nullptr);
-        current_tag.chop(reader.qualifiedName().length() + 1);
+        open_elements.removeLast();
       }
       break;
+    }
 
     case QXmlStreamReader::EndElement:
-      if (xml_shortcut(reader.name()) == xg_shortcut::sc_skip) {
+      if (open_elements.isEmpty()) {
         goto readnext;
       }
-
-      cb = xml_tbl_lookup(current_tag, xg_cb_type::cb_end);
-      if (cb) {
-        (*cb)(reader.name().toString(), nullptr);
+      if (!open_elements.constLast().ignored) {
+        cb = xg_path_tree.at(open_elements.constLast().node).callbacks[static_cast<int>(xg_cb_type::cb_end)];
+        if (cb) {
+          (*cb)(reader.name().toString(), nullptr);
+        }
       }
-      current_tag.chop(reader.qualifiedName().length() + 1);
+      open_elements.removeLast();
       break;
 
     case QXmlStreamReader::Characters:
@@ -188,15 +253,21 @@ void XmlGenericReader::xml_read()
 
   file.open(QIODevice::ReadOnly);
 
-  QXmlStreamReader reader(&file);
+  xml_read(&file);
+}
+
+// Parses from an already open device, e.g. a member of a zip archive.
+void XmlGenericReader::xml_read(QIODevice* device)
+{
+  const auto reader = gpsbabel::XmlPullReader::create(device);
 
-  xml_run_parser(reader);
-  if (reader.hasError())  {
+  xml_run_parser(*reader);
+  if (reader->hasError())  {
     fatal(MYNAME " :Read error: %s (%s, line %lld, col %lld)\n",
-          qPrintable(reader.errorString()),
-          qPrintable(file.fileName()),
-          reader.lineNumber(),
-          reader.columnNumber());
+          qPrintable(reader->errorString()),
+          qPrintable(rd_fname),
+          reader->lineNumber(),
+          reader->columnNumber());
   }
 }
 
@@ -213,15 +284,15 @@ void XmlGenericReader::xml_readstring(const char* str)
 {
   reader_data.append(str);
 
-  QXmlStreamReader reader(reader_data);
+  const auto reader = gpsbabel::XmlPullReader::create(reader_data);
 
-  xml_run_parser(reader);
-  if (reader.hasError())  {
+  xml_run_parser(*reader);
+  if (reader->hasError())  {
     fatal(MYNAME " :Read error: %s (%s, line %lld, col %lld)\n",
-          qPrintable(reader.errorString()),
+          qPrintable(reader->errorString()),
           "unknown",
-          reader.lineNumber(),
-          reader.columnNumber());
+          reader->lineNumber(),
+          reader->columnNumber());
   }
 }
 
@@ -229,9 +300,9 @@ void XmlGenericReader::xml_readstring(const char* str)
 // encoding because the source is already Qt's internal UTF-16.
 void XmlGenericReader::xml_readunicode(const QString& str)
 {
-  QXmlStreamReader reader(str);
+  const auto reader = gpsbabel::XmlPullReader::create(str);
 
-  xml_run_parser(reader);
+  xml_run_parser(*reader);
 }
 
 /******************************************/
@@ -22,18 +22,21 @@
 #ifndef XMLGENERIC_H_INCLUDED_
 #define XMLGENERIC_H_INCLUDED_
 
+#include <array>                 // for array
 #include <cassert>               // for assert
 #include <memory>                // for make_shared, shared_ptr
 
 #include <QByteArray>            // for QByteArray
 #include <QHash>                 // for QHash
+#include <QIODevice>             // for QIODevice
 #include <QList>                 // for QList
 #include <QRegularExpression>    // for QRegularExpression
 #include <QString>               // for QString
 #include <QStringView>           // for QStringView
 #include <QTextCodec>            // for QTextCodec
 #include <QXmlStreamAttributes>  // for QXmlStreamAttributes
-#include <QXmlStreamReader>      // for QXmlStreamReader
+
+#include "src/core/xmlpullreader.h"  // for XmlPullReader
 
 
 enum class xg_cb_type {
@@ -97,6 +100,7 @@ public:
   }
 
   void xml_read();
+  void xml_read(QIODevice* device);
   void xml_readstring(const char* str);
   void xml_readprefixstring(const char* str);
   void xml_readunicode(const QString& str);
@@ -151,27 +155,55 @@ private:
   struct xg_tag_map_entry {
     std::shared_ptr<XgCallbackBase> tag_cb{nullptr};
     xg_cb_type cb_type{xg_cb_type::cb_unknown};
+    bool tag_is_literal{false};  // the pattern has no regex syntax
+    QString tag_literal;
     QRegularExpression tag_re;
   };
 
+  // the callbacks for one element path, indexed by xg_cb_type.
+  using xg_path_callbacks = std::array<XgCallbackBase*, 4>;
+
   enum class xg_shortcut {
     sc_none = 0,
     sc_skip,
     sc_ignore
   };
 
+  // Element paths are kept as a tree of the paths seen so far, each node
+  // holding its callbacks, so the parser only has to track a stack of
+  // node indices.
+  struct xg_path_child {
+    QString qualified_name;
+    int node{0};  // the parent itself for ignored elements
+    xg_shortcut shortcut{xg_shortcut::sc_none};
+  };
+
+  struct xg_path_node {
+    QString path;
+    xg_path_callbacks callbacks{};
+    QList<xg_path_child> children;
+  };
+
+  struct xg_open_element {
+    int node;
+    bool ignored;
+  };
+
   /* Member Functions */
 
-  XgCallbackBase* xml_tbl_lookup(const QString& tag, xg_cb_type cb_type);
+  xg_path_callbacks xml_tbl_match(const QString& tag) const;
+  xg_path_child xml_path_child(int parent, QStringView qualified_name, QStringView name);
+  void xml_path_reset();
   void xml_common_init(const QString& fname, const char* encoding,
                        const char* const* ignorelist, const char* const* skiplist);
   xg_shortcut xml_shortcut(QStringView name);
-  void xml_run_parser(QXmlStreamReader& reader);
+  void xml_run_parser(gpsbabel::XmlPullReader& reader);
 
   // translate xg_fmt_map_entries to xg_tag_map_entries.
   template<class MyFormat>
   void build_xg_tag_map(MyFormat* instance, const QList<xg_fmt_map_entry<MyFormat>>& map)
   {
+    static const QRegularExpression re_syntax(R"([\\^$.|?*+()[\]{}])");
     xg_tag_tbl.clear();
     for (const auto& entry : map) {
       xg_tag_map_entry tme;
@@ -180,17 +212,25 @@ private:
       } else {
         tme.tag_cb = std::make_shared<XgFunctionPtrCallback>(entry.tag_fp_cb);
       }
-      QRegularExpression re(QRegularExpression::anchoredPattern(entry.tag_pattern));
-      assert(re.isValid());
+      QString pattern = QString::fromUtf8(entry.tag_pattern);
+      if (!pattern.contains(re_syntax)) {
+        tme.tag_is_literal = true;
+        tme.tag_literal = pattern;
+      } else {
+        QRegularExpression re(QRegularExpression::anchoredPattern(pattern));
+        assert(re.isValid());
+        tme.tag_re = re;
+      }
       tme.cb_type = entry.cb_type;
-      tme.tag_re = re;
       xg_tag_tbl.append(tme);
     }
+    xml_path_reset();
   }
 
   /* Data Members */
 
   QList<xg_tag_map_entry> xg_tag_tbl;
+  QList<xg_path_node> xg_path_tree;
   QHash<QString, xg_shortcut> xg_shortcut_taglist;
 
   QString rd_fname;
@@ -68,4 +68,29 @@ else()
   else()
     message(FATAL_ERROR "GPSBABEL_WITH_ZLIB=no|findpackage|pkgconfig|included*|custom")
   endif()
+
+  # minizip reads and writes the zip archives behind KMZ.
+  if(NOT GPSBABEL_WITH_ZLIB STREQUAL "custom")
+    add_library(minizip STATIC
+      zlib/contrib/minizip/ioapi.c
+      zlib/contrib/minizip/unzip.c
+      zlib/contrib/minizip/zip.c
+      zlib/contrib/minizip/crypt.h
+      zlib/contrib/minizip/ioapi.h
+      zlib/contrib/minizip/unzip.h
+      zlib/contrib/minizip/zip.h
+    )
+    target_compile_definitions(minizip PRIVATE NOCRYPT NOUNCRYPT)
+    if(APPLE)
+      target_compile_definitions(minizip PRIVATE USE_FILE32API)
+    endif()
+    if(MSVC)
+      target_compile_definitions(minizip PRIVATE _CRT_SECURE_NO_WARNINGS)
+      target_compile_options(minizip PRIVATE -wd4100 -wd4267)
+    endif()
+    target_link_libraries(minizip PRIVATE ${LIBS})
+    list(APPEND LIBS minizip)
+    list(APPEND ZLIB src/core/ziparchive.cc)
+    target_compile_definitions(gpsbabel PRIVATE MINIZIP_ENABLED)
+  endif()
 endif()